@@ -24,8 +24,11 @@ namespace pip3D
   struct CameraConfig
   {
     float aspectEps;
+    // Moves smaller than this many pixels on screen keep the renderer's
+    // cached matrices; 0 rebuilds on any change.
+    float jitterPixels;
 
-    CameraConfig() : aspectEps(1e-6f) {}
+    CameraConfig() : aspectEps(1e-6f), jitterPixels(0.25f) {}
   };
 
   struct CameraAnimation
@@ -1,17 +1,192 @@
 #include "Core.h"
+#include "Jobs.h"
+
+#if defined(PIP3D_HOST) && !defined(ARDUINO_ARCH_ESP32)
+#include <mutex>
+#endif
 
 namespace pip3D
 {
     EventSystem::Listener EventSystem::listeners[MAX_LISTENERS];
+    uint8_t EventSystem::heads[TYPE_LISTS];
     int EventSystem::listenerCount = 0;
+    uint8_t EventSystem::dispatchDepth = 0;
+    bool EventSystem::cleanupPending = false;
+
+    EventSystem::PendingEvent EventSystem::queue[QUEUE_SIZE];
+    uint16_t EventSystem::queueHead = 0;
+    uint16_t EventSystem::queueCount = 0;
+    uint32_t EventSystem::droppedCount = 0;
+
+    namespace
+    {
+#ifdef ARDUINO_ARCH_ESP32
+        portMUX_TYPE s_queueLock = portMUX_INITIALIZER_UNLOCKED;
+#define PIP3D_EVENT_LOCK() portENTER_CRITICAL(&s_queueLock)
+#define PIP3D_EVENT_UNLOCK() portEXIT_CRITICAL(&s_queueLock)
+#elif defined(PIP3D_HOST)
+        std::mutex s_queueLock;
+#define PIP3D_EVENT_LOCK() s_queueLock.lock()
+#define PIP3D_EVENT_UNLOCK() s_queueLock.unlock()
+#else
+#define PIP3D_EVENT_LOCK()
+#define PIP3D_EVENT_UNLOCK()
+#endif
+
+        // Allocations come from both cores (the worker grows band and
+        // physics scratch), so the counters get their own lock.
+        MemModuleStats s_memStats[MemUtils::MODULE_SLOTS];
+#ifdef ARDUINO_ARCH_ESP32
+        portMUX_TYPE s_memLock = portMUX_INITIALIZER_UNLOCKED;
+#define PIP3D_MEM_LOCK() portENTER_CRITICAL(&s_memLock)
+#define PIP3D_MEM_UNLOCK() portEXIT_CRITICAL(&s_memLock)
+#elif defined(PIP3D_HOST)
+        std::mutex s_memLock;
+#define PIP3D_MEM_LOCK() s_memLock.lock()
+#define PIP3D_MEM_UNLOCK() s_memLock.unlock()
+#else
+#define PIP3D_MEM_LOCK()
+#define PIP3D_MEM_UNLOCK()
+#endif
+
+        const char *const s_memModuleNames[MemUtils::MODULE_SLOTS] = {
+            "core", "render", "physics", "camera", "scene", "resources", "perf", "user"};
+    }
+
+    void MemUtils::recordAlloc(uint8_t slot, size_t size)
+    {
+        PIP3D_MEM_LOCK();
+        MemModuleStats &s = s_memStats[slot];
+        s.liveBytes += static_cast<uint32_t>(size);
+        s.liveBlocks++;
+        s.allocCount++;
+        if (s.liveBytes > s.highWater)
+            s.highWater = s.liveBytes;
+        PIP3D_MEM_UNLOCK();
+    }
+
+    void MemUtils::recordFree(uint8_t slot, size_t size)
+    {
+        PIP3D_MEM_LOCK();
+        MemModuleStats &s = s_memStats[slot < MODULE_SLOTS ? slot : MODULE_SLOTS - 1];
+        s.liveBytes -= static_cast<uint32_t>(size);
+        s.liveBlocks--;
+        PIP3D_MEM_UNLOCK();
+    }
+
+    void MemUtils::recordFailure(uint8_t slot)
+    {
+        PIP3D_MEM_LOCK();
+        s_memStats[slot].failCount++;
+        PIP3D_MEM_UNLOCK();
+    }
+
+    MemModuleStats MemUtils::moduleStats(uint16_t module)
+    {
+        MemModuleStats total = {};
+        PIP3D_MEM_LOCK();
+        for (uint8_t i = 0; i < MODULE_SLOTS; ++i)
+        {
+            if (!(module & (1u << i)))
+                continue;
+            const MemModuleStats &s = s_memStats[i];
+            total.liveBytes += s.liveBytes;
+            total.highWater += s.highWater;
+            total.liveBlocks += s.liveBlocks;
+            total.allocCount += s.allocCount;
+            total.failCount += s.failCount;
+        }
+        PIP3D_MEM_UNLOCK();
+        return total;
+    }
+
+    void MemUtils::resetHighWater()
+    {
+        PIP3D_MEM_LOCK();
+        for (uint8_t i = 0; i < MODULE_SLOTS; ++i)
+            s_memStats[i].highWater = s_memStats[i].liveBytes;
+        PIP3D_MEM_UNLOCK();
+    }
+
+    void MemUtils::logStats()
+    {
+        for (uint8_t i = 0; i < MODULE_SLOTS; ++i)
+        {
+            const MemModuleStats s = moduleStats(static_cast<uint16_t>(1u << i));
+            if (s.allocCount == 0 && s.failCount == 0)
+                continue;
+            LOGI(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
+                 "mem %-9s live=%u (%u blocks) peak=%u allocs=%u failed=%u",
+                 s_memModuleNames[i],
+                 static_cast<unsigned int>(s.liveBytes),
+                 static_cast<unsigned int>(s.liveBlocks),
+                 static_cast<unsigned int>(s.highWater),
+                 static_cast<unsigned int>(s.allocCount),
+                 static_cast<unsigned int>(s.failCount));
+        }
+        LOGI(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
+             "mem heap free=%u largest=%u psram free=%u",
+             static_cast<unsigned int>(getFreeHeap()),
+             static_cast<unsigned int>(getLargestFreeBlock()),
+             static_cast<unsigned int>(getFreePSRAM()));
+    }
+
+    void EventSystem::emit(EventType type, void *data)
+    {
+        if (JobSystem::isWorkerThread())
+        {
+            post(type, data);
+            return;
+        }
+        dispatch(type, data);
+    }
+
+    bool EventSystem::post(EventType type, void *data)
+    {
+        bool queued = false;
+        PIP3D_EVENT_LOCK();
+        if (queueCount < QUEUE_SIZE)
+        {
+            queue[(queueHead + queueCount) % QUEUE_SIZE] = {type, data};
+            queueCount++;
+            queued = true;
+        }
+        else
+        {
+            droppedCount++;
+        }
+        PIP3D_EVENT_UNLOCK();
+        return queued;
+    }
+
+    int EventSystem::dispatchDeferred()
+    {
+        PIP3D_EVENT_LOCK();
+        int remaining = queueCount;
+        PIP3D_EVENT_UNLOCK();
+
+        // Events posted by the callbacks themselves wait for the next call.
+        int dispatched = 0;
+        while (remaining-- > 0)
+        {
+            PIP3D_EVENT_LOCK();
+            const PendingEvent ev = queue[queueHead];
+            queueHead = static_cast<uint16_t>((queueHead + 1) % QUEUE_SIZE);
+            queueCount--;
+            PIP3D_EVENT_UNLOCK();
 
-    Profiler::Section Profiler::sections[MAX_SECTIONS];
-    int Profiler::sectionCount = 0;
-    int Profiler::currentSection = -1;
+            dispatch(ev.type, ev.data);
+            dispatched++;
+        }
+        return dispatched;
+    }
 
-    ResourceManager::Resource ResourceManager::resources[MAX_RESOURCES];
-    int ResourceManager::resourceCount = 0;
-    size_t ResourceManager::totalMemory = 0;
-    size_t ResourceManager::maxMemory = 1024 * 1024;
+    int EventSystem::getPendingCount()
+    {
+        PIP3D_EVENT_LOCK();
+        const int count = queueCount;
+        PIP3D_EVENT_UNLOCK();
+        return count;
+    }
 
 }
@@ -8,6 +8,7 @@
 #include <cstdlib>
 #include <cstring>
 #include "Debug/Logging.h"
+#include "Debug/Profiler.h"
 
 namespace pip3D
 {
@@ -37,13 +38,91 @@ namespace pip3D
         : width(w), height(h), cs(cs_), dc(dc_), rst(rst_) {}
   };
 
-  // Global screen configuration (physical display resolution)
-  static constexpr uint16_t SCREEN_WIDTH = 480;
-  static constexpr uint16_t SCREEN_HEIGHT = 320;
+  // Physical display resolution
+  static constexpr uint16_t PANEL_WIDTH = 480;
+  static constexpr uint16_t PANEL_HEIGHT = 320;
+
+  // Reduced render resolution for fill-rate bound panels: the engine renders
+  // at PANEL / scale (1 or 2 per axis) and the flush pixel- and line-doubles.
+  // Interlaced rendering is half height, writing the even panel lines one
+  // frame and the odd ones the next.
+#ifndef PIP3D_RENDER_SCALE_X
+#define PIP3D_RENDER_SCALE_X 1
+#endif
+#ifndef PIP3D_RENDER_SCALE_Y
+#define PIP3D_RENDER_SCALE_Y 1
+#endif
+#ifndef PIP3D_RENDER_INTERLACED
+#define PIP3D_RENDER_INTERLACED 0
+#endif
+  static constexpr uint8_t RENDER_SCALE_X = PIP3D_RENDER_SCALE_X;
+  static constexpr uint8_t RENDER_SCALE_Y = PIP3D_RENDER_INTERLACED ? 2 : PIP3D_RENDER_SCALE_Y;
+  static constexpr bool RENDER_INTERLACED = PIP3D_RENDER_INTERLACED != 0;
+  static_assert((RENDER_SCALE_X == 1 || RENDER_SCALE_X == 2) && (RENDER_SCALE_Y == 1 || RENDER_SCALE_Y == 2),
+                "PIP3D_RENDER_SCALE_X/Y must be 1 or 2");
+
+  // Render resolution; everything but the display flush works in it.
+  static constexpr uint16_t SCREEN_WIDTH = PANEL_WIDTH / RENDER_SCALE_X;
+  static constexpr uint16_t SCREEN_HEIGHT = PANEL_HEIGHT / RENDER_SCALE_Y;
 
   // Banded rendering configuration: number of horizontal bands and band height
-  static constexpr uint16_t SCREEN_BAND_COUNT = 2;
+#ifndef PIP3D_SCREEN_BAND_COUNT
+#define PIP3D_SCREEN_BAND_COUNT 2
+#endif
+  static constexpr uint16_t SCREEN_BAND_COUNT = PIP3D_SCREEN_BAND_COUNT;
   static constexpr uint16_t SCREEN_BAND_HEIGHT = SCREEN_HEIGHT / SCREEN_BAND_COUNT;
+  static_assert(SCREEN_HEIGHT % SCREEN_BAND_COUNT == 0, "SCREEN_HEIGHT must be divisible by SCREEN_BAND_COUNT");
+
+  // Rows allocated for a band in the band framebuffer and depth buffers.
+  // Anything above SCREEN_BAND_HEIGHT lets the renderer balance band
+  // heights (Renderer::setBandBalancing); 0 keeps bands fixed.
+#ifndef PIP3D_SCREEN_BAND_CAPACITY
+#define PIP3D_SCREEN_BAND_CAPACITY 0
+#endif
+#if PIP3D_SCREEN_BAND_CAPACITY == 0
+  static constexpr uint16_t SCREEN_BAND_CAPACITY = SCREEN_BAND_HEIGHT;
+#else
+  static constexpr uint16_t SCREEN_BAND_CAPACITY =
+      PIP3D_SCREEN_BAND_CAPACITY <= SCREEN_BAND_HEIGHT ? SCREEN_BAND_HEIGHT
+      : PIP3D_SCREEN_BAND_CAPACITY >= SCREEN_HEIGHT    ? SCREEN_HEIGHT
+                                                       : PIP3D_SCREEN_BAND_CAPACITY;
+#endif
+
+  // Where the bands of the current frame start: band b covers rows
+  // [top[b], top[b + 1]). Uniform unless the renderer balances bands, and
+  // only changed between frames.
+  struct BandLayout
+  {
+    int16_t top[SCREEN_BAND_COUNT + 1];
+
+    BandLayout() { reset(); }
+
+    void reset()
+    {
+      for (int b = 0; b <= SCREEN_BAND_COUNT; ++b)
+        top[b] = static_cast<int16_t>(b * SCREEN_BAND_HEIGHT);
+    }
+
+    __attribute__((always_inline)) inline int16_t height(int band) const
+    {
+      return static_cast<int16_t>(top[band + 1] - top[band]);
+    }
+
+    // Band holding row y; rows off screen go to the first or last band.
+    __attribute__((always_inline)) inline int bandAt(int y) const
+    {
+      int b = 0;
+      while (b + 1 < SCREEN_BAND_COUNT && y >= top[b + 1])
+        ++b;
+      return b;
+    }
+  };
+
+  __attribute__((always_inline)) inline BandLayout &bandLayout()
+  {
+    static BandLayout layout;
+    return layout;
+  }
 
   // Per-frame band state used by the renderer and rasterizer.
   // currentBandOffsetY: top Y coordinate (in full-screen space) of the active band.
@@ -60,6 +139,32 @@ namespace pip3D
     return h;
   }
 
+  // Framebuffer pixel storage. With PIP3D_PIXEL_NATIVE_BE=1 pixels are kept
+  // as byte-swapped (big-endian) RGB565, the order SPI panels expect, so
+  // drivers can DMA bands straight out of the framebuffer. Colors stay
+  // plain RGB565 everywhere else; encode on write, decode on read-back.
+#ifndef PIP3D_PIXEL_NATIVE_BE
+#define PIP3D_PIXEL_NATIVE_BE 0
+#endif
+
+  template <bool NativeBigEndian>
+  struct PixelCodec
+  {
+    static constexpr bool NATIVE_BE = NativeBigEndian;
+
+    static constexpr __attribute__((always_inline)) inline uint16_t encode(uint16_t rgb565)
+    {
+      return NativeBigEndian ? static_cast<uint16_t>((rgb565 >> 8) | (rgb565 << 8)) : rgb565;
+    }
+
+    static constexpr __attribute__((always_inline)) inline uint16_t decode(uint16_t pixel)
+    {
+      return encode(pixel);
+    }
+  };
+
+  typedef PixelCodec<PIP3D_PIXEL_NATIVE_BE != 0> PixelFormat;
+
   struct alignas(2) Color
   {
     uint16_t rgb565;
@@ -453,8 +558,37 @@ namespace pip3D
     __attribute__((always_inline)) inline uint32_t area() const { return width * height; }
   };
 
+#ifndef PIP3D_MEM_TELEMETRY
+#define PIP3D_MEM_TELEMETRY 1
+#endif
+
+  // Where an allocation may live. The *_FIRST policies fall back to the
+  // other kind of RAM; the rest fail instead.
+  enum MemPlacement : uint8_t
+  {
+    MEM_PSRAM_FIRST = 0,
+    MEM_INTERNAL_FIRST,
+    MEM_INTERNAL,
+    MEM_DMA,
+    MEM_PSRAM
+  };
+
+  // Per LOG_MODULE_* totals of the MemUtils allocators. allocCount only
+  // moves when something is allocated, so a steady state shows as a
+  // constant count between frames.
+  struct MemModuleStats
+  {
+    uint32_t liveBytes;
+    uint32_t highWater;
+    uint32_t liveBlocks;
+    uint32_t allocCount;
+    uint32_t failCount;
+  };
+
   struct MemUtils
   {
+    static constexpr uint8_t MODULE_SLOTS = 8;
+
     static size_t getFreeHeap() { return ESP.getFreeHeap(); }
     static size_t getFreePSRAM() { return ESP.getFreePsram(); }
     static size_t getLargestFreeBlock() { return ESP.getMaxAllocHeap(); }
@@ -479,25 +613,53 @@ namespace pip3D
         free(ptr);
     }
 
-    static void *allocData(size_t size, size_t align = 16)
+    // Allocates with the given placement and charges the block to module
+    // (one LOG_MODULE_* bit). Released with freeData().
+    static void *alloc(size_t size, MemPlacement placement,
+                       uint16_t module = ::pip3D::Debug::LOG_MODULE_CORE, size_t align = 16)
     {
       if (size == 0)
       {
         return nullptr;
       }
 
-#ifdef PIP3D_USE_PSRAM
-      if (psramFound())
+#if PIP3D_MEM_TELEMETRY
+      if (align < sizeof(BlockHeader))
+        align = sizeof(BlockHeader);
+      uint8_t *raw = static_cast<uint8_t *>(rawAlloc(size + align, placement, align));
+      const uint8_t slot = moduleSlot(module);
+      if (!raw)
       {
-        void *ptr = heap_caps_aligned_alloc(align, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-        if (ptr)
-        {
-          return ptr;
-        }
+        recordFailure(slot);
+        return nullptr;
       }
+      uint8_t *ptr = raw + align;
+      BlockHeader *header = reinterpret_cast<BlockHeader *>(ptr) - 1;
+      header->size = static_cast<uint32_t>(size);
+      header->offset = static_cast<uint16_t>(align);
+      header->slot = slot;
+      header->placement = placement;
+      header->magic = BLOCK_MAGIC;
+      recordAlloc(slot, size);
+      return ptr;
+#else
+      (void)module;
+      return rawAlloc(size, placement, align);
 #endif
+    }
 
-      return heap_caps_aligned_alloc(align, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    static void *allocData(size_t size, size_t align = 16,
+                           uint16_t module = ::pip3D::Debug::LOG_MODULE_CORE)
+    {
+      return alloc(size, MEM_PSRAM_FIRST, module, align);
+    }
+
+    // Internal SRAM first, PSRAM only when that fails; for small buffers
+    // touched per pixel. Released with freeData().
+    static void *allocFast(size_t size, size_t align = 16,
+                           uint16_t module = ::pip3D::Debug::LOG_MODULE_CORE)
+    {
+      return alloc(size, MEM_INTERNAL_FIRST, module, align);
     }
 
     static void freeData(void *ptr)
@@ -506,13 +668,88 @@ namespace pip3D
       {
         return;
       }
+#if PIP3D_MEM_TELEMETRY
+      BlockHeader *header = static_cast<BlockHeader *>(ptr) - 1;
+      if (unlikely(header->magic != BLOCK_MAGIC))
+      {
+        LOGE(::pip3D::Debug::LOG_MODULE_CORE,
+             "MemUtils::freeData: %p was not allocated by MemUtils", ptr);
+        return;
+      }
+      header->magic = 0;
+      recordFree(header->slot, header->size);
+      heap_caps_free(static_cast<uint8_t *>(ptr) - header->offset);
+#else
       heap_caps_free(ptr);
+#endif
     }
 
     static bool isInPSRAM(void *ptr)
     {
-      return ((uint32_t)ptr >= 0x3F800000 && (uint32_t)ptr < 0x3FC00000);
+      return ((uintptr_t)ptr >= 0x3F800000 && (uintptr_t)ptr < 0x3FC00000);
     }
+
+    // Totals of one module (a LOG_MODULE_* bit), or of all of them for
+    // LOG_MODULE_ALL. Zero when built without PIP3D_MEM_TELEMETRY.
+    static MemModuleStats moduleStats(uint16_t module);
+    static void resetHighWater();
+    static void logStats();
+
+  private:
+    struct BlockHeader
+    {
+      uint32_t size;
+      uint16_t offset;
+      uint8_t slot;
+      uint8_t placement;
+      uint32_t magic;
+      uint32_t reserved;
+    };
+
+    static constexpr uint32_t BLOCK_MAGIC = 0x4D335049u;
+
+    static void *rawAlloc(size_t size, MemPlacement placement, size_t align)
+    {
+      const uint32_t internalCaps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+      void *ptr = nullptr;
+      switch (placement)
+      {
+      case MEM_DMA:
+        return heap_caps_aligned_alloc(align, size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+      case MEM_INTERNAL:
+        return heap_caps_aligned_alloc(align, size, internalCaps);
+      case MEM_PSRAM:
+#ifdef PIP3D_USE_PSRAM
+        if (psramFound())
+          return heap_caps_aligned_alloc(align, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+        return nullptr;
+      case MEM_INTERNAL_FIRST:
+        ptr = heap_caps_aligned_alloc(align, size, internalCaps);
+#ifdef PIP3D_USE_PSRAM
+        if (!ptr && psramFound())
+          ptr = heap_caps_aligned_alloc(align, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+        return ptr;
+      case MEM_PSRAM_FIRST:
+      default:
+#ifdef PIP3D_USE_PSRAM
+        if (psramFound())
+          ptr = heap_caps_aligned_alloc(align, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+        return ptr ? ptr : heap_caps_aligned_alloc(align, size, internalCaps);
+      }
+    }
+
+    static uint8_t moduleSlot(uint16_t module)
+    {
+      const uint8_t slot = module ? static_cast<uint8_t>(__builtin_ctz(module)) : 0;
+      return slot < MODULE_SLOTS ? slot : MODULE_SLOTS - 1;
+    }
+
+    static void recordAlloc(uint8_t slot, size_t size);
+    static void recordFree(uint8_t slot, size_t size);
+    static void recordFailure(uint8_t slot);
   };
 
   struct CoreConfig
@@ -580,452 +817,161 @@ namespace pip3D
     EVENT_USER_CUSTOM = 100
   };
 
+#ifndef PIP3D_EVENT_MAX_LISTENERS
+#define PIP3D_EVENT_MAX_LISTENERS 32
+#endif
+
+// Events posted from the worker core and not yet dispatched.
+#ifndef PIP3D_EVENT_QUEUE_SIZE
+#define PIP3D_EVENT_QUEUE_SIZE 32
+#endif
+
+  typedef void (*EventCallback)(EventType, void *);
+
+  // Listeners are linked into one list per built-in type, so emit() only
+  // visits listeners of that type; custom types share the last list and are
+  // matched exactly. Events emitted on the job worker are queued instead and
+  // run by dispatchDeferred() on the main core, once per frame.
   struct EventSystem
   {
   private:
     struct Listener
     {
-      void (*callback)(EventType, void *);
+      EventCallback callback;
       void *userData;
+      EventType type;
+      uint8_t next; // slot + 1, 0 ends the list
       bool active;
     };
 
-    static constexpr int MAX_LISTENERS = 32;
-    static Listener listeners[MAX_LISTENERS];
-    static int listenerCount;
-
-  public:
-    static bool subscribe(EventType type, void (*callback)(EventType, void *), void *userData = nullptr)
-    {
-      if (listenerCount >= MAX_LISTENERS)
-        return false;
-
-      listeners[listenerCount] = {callback, userData, true};
-      listenerCount++;
-      return true;
-    }
-
-    static void unsubscribe(void (*callback)(EventType, void *))
-    {
-      for (int i = 0; i < listenerCount; i++)
-      {
-        if (listeners[i].callback == callback)
-        {
-          listeners[i].active = false;
-        }
-      }
-    }
-
-    static void emit(EventType type, void *data = nullptr)
-    {
-      for (int i = 0; i < listenerCount; i++)
-      {
-        if (listeners[i].active && listeners[i].callback)
-        {
-          listeners[i].callback(type, data ? data : listeners[i].userData);
-        }
-      }
-    }
-
-    static void cleanup()
-    {
-      int writeIdx = 0;
-      for (int readIdx = 0; readIdx < listenerCount; readIdx++)
-      {
-        if (listeners[readIdx].active)
-        {
-          if (writeIdx != readIdx)
-          {
-            listeners[writeIdx] = listeners[readIdx];
-          }
-          writeIdx++;
-        }
-      }
-      listenerCount = writeIdx;
-    }
-
-    static int getListenerCount() { return listenerCount; }
-  };
-
-  struct Profiler
-  {
-  private:
-    struct Section
+    struct PendingEvent
     {
-      const char *name;
-      uint32_t startTime;
-      uint32_t totalTime;
-      uint32_t callCount;
-      bool active;
+      EventType type;
+      void *data;
     };
 
-    static constexpr int MAX_SECTIONS = 16;
-    static Section sections[MAX_SECTIONS];
-    static int sectionCount;
-    static int currentSection;
-
-  public:
-    static void beginSection(const char *name)
-    {
-      if (!name)
-        return;
-      int idx = -1;
-
-      for (int i = 0; i < sectionCount; i++)
-      {
-        if (strcmp(sections[i].name, name) == 0)
-        {
-          idx = i;
-          break;
-        }
-      }
-
-      if (idx == -1 && sectionCount < MAX_SECTIONS)
-      {
-        idx = sectionCount++;
-        sections[idx] = {name, 0, 0, 0, false};
-      }
-
-      if (idx != -1)
-      {
-        sections[idx].startTime = micros();
-        sections[idx].active = true;
-        currentSection = idx;
-      }
-    }
-
-    static void endSection()
-    {
-      if (currentSection >= 0 && currentSection < sectionCount)
-      {
-        Section &sec = sections[currentSection];
-        if (sec.active)
-        {
-          uint32_t elapsed = micros() - sec.startTime;
-          sec.totalTime += elapsed;
-          sec.callCount++;
-          sec.active = false;
-        }
-      }
-      currentSection = -1;
-    }
-
-    static void printReport()
-    {
-      uint32_t totalFrameTime = 0;
-
-      for (int i = 0; i < sectionCount; i++)
-      {
-        totalFrameTime += sections[i].totalTime;
-      }
+    static constexpr int MAX_LISTENERS = PIP3D_EVENT_MAX_LISTENERS;
+    static constexpr int QUEUE_SIZE = PIP3D_EVENT_QUEUE_SIZE;
+    static constexpr int TYPE_LISTS = EVENT_FPS_CHANGED + 2;
+    static_assert(MAX_LISTENERS > 0 && MAX_LISTENERS < 255, "PIP3D_EVENT_MAX_LISTENERS must fit a uint8_t link");
 
-      for (int i = 0; i < sectionCount; i++)
-      {
-        Section &sec = sections[i];
-        if (sec.callCount > 0)
-        {
-          float avgTime = sec.totalTime / (float)sec.callCount;
-          float percentage = totalFrameTime > 0 ? (sec.totalTime * 100.0f / totalFrameTime) : 0;
-
-          LOGI(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
-               "%s: %.2fms avg, %d calls, %.1f%%",
-               sec.name,
-               avgTime / 1000.0f,
-               sec.callCount,
-               percentage);
-        }
-      }
+    static Listener listeners[MAX_LISTENERS];
+    static uint8_t heads[TYPE_LISTS];
+    static int listenerCount;
+    static uint8_t dispatchDepth;
+    static bool cleanupPending;
 
-      LOGI(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
-           "Total: %.2fms", totalFrameTime / 1000.0f);
-    }
+    static PendingEvent queue[QUEUE_SIZE];
+    static uint16_t queueHead;
+    static uint16_t queueCount;
+    static uint32_t droppedCount;
 
-    static void reset()
+    static int listFor(EventType type)
     {
-      for (int i = 0; i < sectionCount; i++)
-      {
-        sections[i].totalTime = 0;
-        sections[i].callCount = 0;
-        sections[i].active = false;
-      }
-      currentSection = -1;
+      return (type >= 0 && type <= EVENT_FPS_CHANGED) ? static_cast<int>(type) : TYPE_LISTS - 1;
     }
 
-    static float getSectionTime(const char *name)
+    static void dispatch(EventType type, void *data)
     {
-      for (int i = 0; i < sectionCount; i++)
+      ++dispatchDepth;
+      for (uint8_t link = heads[listFor(type)]; link; link = listeners[link - 1].next)
       {
-        if (strcmp(sections[i].name, name) == 0 && sections[i].callCount > 0)
-        {
-          return sections[i].totalTime / (float)sections[i].callCount / 1000.0f;
-        }
+        const Listener &l = listeners[link - 1];
+        if (l.active && l.type == type)
+          l.callback(type, data ? data : l.userData);
       }
-      return 0.0f;
+      if (--dispatchDepth == 0 && cleanupPending)
+        cleanup();
     }
-  };
-
-  enum ResourceType
-  {
-    RES_TEXTURE = 0,
-    RES_MESH = 1,
-    RES_SOUND = 2,
-    RES_DATA = 3
-  };
-
-  struct ResourceManager
-  {
-  private:
-    struct Resource
-    {
-      const char *path;
-      void *data;
-      size_t size;
-      ResourceType type;
-      uint32_t refCount;
-      uint32_t lastAccess;
-      bool loaded;
-    };
-
-    static constexpr int MAX_RESOURCES = 64;
-    static Resource resources[MAX_RESOURCES];
-    static int resourceCount;
-    static size_t totalMemory;
-    static size_t maxMemory;
 
   public:
-    static void init(size_t maxMem = 1024 * 1024)
-    {
-      maxMemory = maxMem;
-      totalMemory = 0;
-      resourceCount = 0;
-
-      for (int i = 0; i < MAX_RESOURCES; i++)
-      {
-        resources[i] = {nullptr, nullptr, 0, RES_DATA, 0, 0, false};
-      }
-
-      LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
-           "ResourceManager initialized, maxMem=%u bytes, maxResources=%d",
-           static_cast<unsigned int>(maxMemory),
-           MAX_RESOURCES);
-    }
-
-    static void *load(const char *path, ResourceType type, size_t size)
+    // Main core only, like unsubscribe().
+    static bool subscribe(EventType type, EventCallback callback, void *userData = nullptr)
     {
-      if (!path)
-      {
-        LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
-             "ResourceManager::load called with null path (type=%d, size=%u)",
-             static_cast<int>(type),
-             static_cast<unsigned int>(size));
-        return nullptr;
-      }
-      int idx = findResource(path);
-
-      if (idx != -1)
-      {
-        resources[idx].refCount++;
-        resources[idx].lastAccess = millis();
-        LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
-             "Resource '%s' already loaded, refCount=%u", path, resources[idx].refCount);
-        return resources[idx].data;
-      }
-
-      if (resourceCount >= MAX_RESOURCES)
-      {
-        cleanup();
-        if (resourceCount >= MAX_RESOURCES)
-        {
-          LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
-               "ResourceManager capacity exceeded while loading '%s' (MAX_RESOURCES=%d)",
-               path,
-               MAX_RESOURCES);
-          return nullptr;
-        }
-      }
+      if (!callback)
+        return false;
 
-      if (totalMemory + size > maxMemory)
+      int slot = -1;
+      for (int i = 0; i < MAX_LISTENERS; i++)
       {
-        freeOldest();
-        if (totalMemory + size > maxMemory)
+        if (!listeners[i].callback)
         {
-          LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
-               "Not enough memory to load resource '%s' (size=%u, used=%u, max=%u)",
-               path,
-               static_cast<unsigned int>(size),
-               static_cast<unsigned int>(totalMemory),
-               static_cast<unsigned int>(maxMemory));
-          return nullptr;
+          slot = i;
+          break;
         }
       }
+      if (slot < 0)
+        return false;
 
-      void *data = MemUtils::allocAligned(size);
-      if (!data)
-      {
-        LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
-             "MemUtils::allocAligned failed for resource '%s' (size=%u)",
-             path,
-             static_cast<unsigned int>(size));
-        return nullptr;
-      }
-
-      idx = resourceCount++;
-      resources[idx] = {path, data, size, type, 1, millis(), true};
-      totalMemory += size;
-
-      LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
-           "Loaded resource '%s' (type=%d, size=%u bytes, totalMemory=%u/%u)",
-           path,
-           static_cast<int>(type),
-           static_cast<unsigned int>(size),
-           static_cast<unsigned int>(totalMemory),
-           static_cast<unsigned int>(maxMemory));
-
-      EventType ev = EVENT_USER_CUSTOM;
-      if (type == RES_TEXTURE)
-        ev = EVENT_TEXTURE_LOADED;
-      else if (type == RES_MESH)
-        ev = EVENT_MESH_LOADED;
-      EventSystem::emit(ev, (void *)path);
-      return data;
+      listeners[slot] = {callback, userData, type, 0, true};
+      uint8_t *link = &heads[listFor(type)];
+      while (*link)
+        link = &listeners[*link - 1].next;
+      *link = static_cast<uint8_t>(slot + 1);
+      listenerCount++;
+      return true;
     }
 
-    static void unload(const char *path)
+    // Safe from inside a callback: the slot is only reused once the current
+    // dispatch has returned.
+    static void unsubscribe(EventCallback callback)
     {
-      int idx = findResource(path);
-      if (idx != -1)
+      for (int i = 0; i < MAX_LISTENERS; i++)
       {
-        Resource &res = resources[idx];
-        if (--res.refCount == 0)
-        {
-          MemUtils::freeAligned(res.data);
-          totalMemory -= res.size;
-          res.loaded = false;
-          res.data = nullptr;
-
-          LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
-               "Unloaded resource '%s' (size=%u bytes, totalMemory=%u/%u)",
-               res.path ? res.path : "<null>",
-               static_cast<unsigned int>(res.size),
-               static_cast<unsigned int>(totalMemory),
-               static_cast<unsigned int>(maxMemory));
-        }
-        else
+        if (listeners[i].active && listeners[i].callback == callback)
         {
-          LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
-               "Decreased refCount for resource '%s' to %u",
-               res.path ? res.path : "<null>",
-               static_cast<unsigned int>(res.refCount));
+          listeners[i].active = false;
+          listenerCount--;
+          cleanupPending = true;
         }
       }
-      else
-      {
-        LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
-             "Attempt to unload unknown resource '%s'", path ? path : "<null>");
-      }
+      if (dispatchDepth == 0 && cleanupPending)
+        cleanup();
     }
 
-    static void unloadAll()
-    {
-      for (int i = 0; i < resourceCount; i++)
-      {
-        if (resources[i].loaded && resources[i].data)
-        {
-          MemUtils::freeAligned(resources[i].data);
-        }
-      }
-      resourceCount = 0;
-      totalMemory = 0;
+    // Runs the listeners now, or queues the event when called on the job
+    // worker.
+    static void emit(EventType type, void *data = nullptr);
 
-      LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
-           "All resources unloaded, memory usage reset to 0");
-    }
+    // Queues the event for dispatchDeferred(); any core. False when the
+    // queue is full and the event was dropped.
+    static bool post(EventType type, void *data = nullptr);
 
-    static size_t getMemoryUsage() { return totalMemory; }
-    static size_t getMaxMemory() { return maxMemory; }
-    static int getResourceCount() { return resourceCount; }
+    // Dispatches the events queued before the call, on the calling core.
+    // Returns how many were dispatched.
+    static int dispatchDeferred();
 
-    static void printStatus()
+    // Frees the slots of unsubscribed listeners.
+    static void cleanup()
     {
-      LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
-           "Resources: %d/%d, Memory: %u/%u KB",
-           resourceCount,
-           MAX_RESOURCES,
-           static_cast<unsigned int>(totalMemory / 1024u),
-           static_cast<unsigned int>(maxMemory / 1024u));
-
-      for (int i = 0; i < resourceCount; i++)
+      if (dispatchDepth)
       {
-        if (resources[i].loaded)
-        {
-          LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
-               "  %s: %u bytes, refs=%u",
-               resources[i].path ? resources[i].path : "<null>",
-               static_cast<unsigned int>(resources[i].size),
-               static_cast<unsigned int>(resources[i].refCount));
-        }
+        cleanupPending = true;
+        return;
       }
-    }
 
-  private:
-    static int findResource(const char *path)
-    {
-      for (int i = 0; i < resourceCount; i++)
+      for (int t = 0; t < TYPE_LISTS; t++)
       {
-        if (resources[i].loaded && strcmp(resources[i].path, path) == 0)
+        uint8_t *link = &heads[t];
+        while (*link)
         {
-          return i;
-        }
-      }
-      return -1;
-    }
-
-    static void cleanup()
-    {
-      int writeIdx = 0;
-      for (int readIdx = 0; readIdx < resourceCount; readIdx++)
-      {
-        if (resources[readIdx].loaded && resources[readIdx].refCount > 0)
-        {
-          if (writeIdx != readIdx)
+          Listener &l = listeners[*link - 1];
+          if (l.active)
           {
-            resources[writeIdx] = resources[readIdx];
+            link = &l.next;
+            continue;
           }
-          writeIdx++;
-        }
-        else if (resources[readIdx].data)
-        {
-          MemUtils::freeAligned(resources[readIdx].data);
-          totalMemory -= resources[readIdx].size;
+          *link = l.next;
+          l.callback = nullptr;
+          l.next = 0;
         }
       }
-      resourceCount = writeIdx;
+      cleanupPending = false;
     }
 
-    static void freeOldest()
-    {
-      uint32_t oldestTime = UINT32_MAX;
-      int oldestIdx = -1;
-
-      for (int i = 0; i < resourceCount; i++)
-      {
-        if (resources[i].loaded && resources[i].refCount == 0 &&
-            resources[i].lastAccess < oldestTime)
-        {
-          oldestTime = resources[i].lastAccess;
-          oldestIdx = i;
-        }
-      }
-
-      if (oldestIdx != -1)
-      {
-        Resource &res = resources[oldestIdx];
-        MemUtils::freeAligned(res.data);
-        totalMemory -= res.size;
-        res.loaded = false;
-        res.data = nullptr;
-      }
-    }
+    static int getListenerCount() { return listenerCount; }
+    static int getPendingCount();
+    static uint32_t getDroppedCount() { return droppedCount; }
   };
 
   using DisplayConfig = Display;
@@ -15,8 +15,49 @@
 #define LOG_DEFAULT_LEVEL 1
 #endif
 
+// Hot-path logging only records the format pointer and raw arguments;
+// formatting and serial output happen in a low-priority drain task.
+#ifndef PIP3D_LOG_DEFERRED
+#define PIP3D_LOG_DEFERRED 1
+#endif
+
+#ifndef PIP3D_LOG_QUEUE_SIZE
+#define PIP3D_LOG_QUEUE_SIZE 64
+#endif
+
+#ifndef PIP3D_LOG_ARG_BYTES
+#define PIP3D_LOG_ARG_BYTES 32
+#endif
+
+#ifndef PIP3D_LOG_TEXT_BYTES
+#define PIP3D_LOG_TEXT_BYTES 32
+#endif
+
+#ifndef PIP3D_LOG_TASK_PRIORITY
+#define PIP3D_LOG_TASK_PRIORITY 0
+#endif
+
+#ifndef PIP3D_LOG_TASK_CORE
+#define PIP3D_LOG_TASK_CORE 0
+#endif
+
+#ifndef PIP3D_LOG_FLUSH_INTERVAL_MS
+#define PIP3D_LOG_FLUSH_INTERVAL_MS 20
+#endif
+
+#ifndef PIP3D_ENABLE_PROFILER
+#define PIP3D_ENABLE_PROFILER PIP3D_ENABLE_DEBUG
+#endif
+
 #ifndef ENABLE_DEBUG_DRAW
 #define ENABLE_DEBUG_DRAW 0
 #endif
 
+// Pixel-level rasterizer counters and the overdraw heatmap (FillStats.h).
+// Flat spans leave the depth kernel for the counting loop, so band times
+// read somewhat high while this is on.
+#ifndef ENABLE_FILL_STATS
+#define ENABLE_FILL_STATS 0
+#endif
+
 #endif
@@ -342,7 +342,7 @@ namespace pip3D
                     continue;
 
                 uint8_t thickness = ln.thickness == 0 ? 1 : ln.thickness;
-                drawLine2D(fb, viewport, x0, y0, x1, y1, ln.color, thickness);
+                drawLine2D(fb, viewport, x0, y0, x1, y1, PixelFormat::encode(ln.color), thickness);
             }
         }
 
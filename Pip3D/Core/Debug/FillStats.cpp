@@ -0,0 +1,194 @@
+#include "FillStats.h"
+#include "Logging.h"
+#include "../Core.h"
+#include <string.h>
+
+namespace pip3D
+{
+
+#if ENABLE_FILL_STATS
+
+    FillCounters FillStats::counters[FillStats::CORE_COUNT];
+    FillStats::OpenBand FillStats::openBands[FillStats::CORE_COUNT] = {{-1, 0, {}}, {-1, 0, {}}};
+    FillBandStats FillStats::bands[FillStats::MAX_BANDS];
+    FillStats::HeatSlot FillStats::heatSlots[FillStats::HEAT_SLOTS];
+    uint8_t FillStats::nextHeatSlot = 0;
+    bool FillStats::heatmapEnabled = false;
+
+    namespace
+    {
+        constexpr size_t HEAT_BYTES = static_cast<size_t>(SCREEN_WIDTH) * SCREEN_BAND_CAPACITY;
+
+        // Black for untouched pixels, then blue through red; white from
+        // HEAT_LEVELS fragments up.
+        const uint16_t HEAT_COLORS[FillStats::HEAT_LEVELS + 1] = {
+            Color::fromRGB888(0, 0, 0).rgb565,
+            Color::fromRGB888(0, 0, 160).rgb565,
+            Color::fromRGB888(0, 120, 255).rgb565,
+            Color::fromRGB888(0, 200, 0).rgb565,
+            Color::fromRGB888(200, 220, 0).rgb565,
+            Color::fromRGB888(255, 140, 0).rgb565,
+            Color::fromRGB888(255, 40, 0).rgb565,
+            Color::fromRGB888(200, 0, 120).rgb565,
+            Color::fromRGB888(255, 255, 255).rgb565,
+        };
+    }
+
+    void FillStats::beginFrame()
+    {
+        memset(counters, 0, sizeof(counters));
+    }
+
+    FillCounters FillStats::frame()
+    {
+        FillCounters sum = {};
+        for (int i = 0; i < CORE_COUNT; ++i)
+        {
+            sum.triangles += counters[i].triangles;
+            sum.fragmentsTested += counters[i].fragmentsTested;
+            sum.depthFailed += counters[i].depthFailed;
+            sum.pixelsWritten += counters[i].pixelsWritten;
+            sum.pixelsBlended += counters[i].pixelsBlended;
+        }
+        return sum;
+    }
+
+    const FillBandStats &FillStats::band(int index)
+    {
+        static const FillBandStats none = {};
+        return index >= 0 && index < MAX_BANDS ? bands[index] : none;
+    }
+
+    bool FillStats::setHeatmap(bool enabled)
+    {
+        if (!enabled)
+        {
+            heatmapEnabled = false;
+            for (int i = 0; i < HEAT_SLOTS; ++i)
+            {
+                MemUtils::freeData(heatSlots[i].counts);
+                heatSlots[i].counts = nullptr;
+                heatSlots[i].frameBuffer = nullptr;
+            }
+            return true;
+        }
+
+        for (int i = 0; i < HEAT_SLOTS; ++i)
+        {
+            if (!heatSlots[i].counts)
+                heatSlots[i].counts = static_cast<uint8_t *>(MemUtils::allocFast(HEAT_BYTES, 4, ::pip3D::Debug::LOG_MODULE_PERFORMANCE));
+            if (!heatSlots[i].counts)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "FillStats::setHeatmap: failed to allocate %u bytes of heat counts",
+                     static_cast<unsigned int>(HEAT_BYTES));
+                setHeatmap(false);
+                return false;
+            }
+        }
+        heatmapEnabled = true;
+        return true;
+    }
+
+    bool FillStats::heatmap()
+    {
+        return heatmapEnabled;
+    }
+
+    void FillStats::beginBand(int index, const uint16_t *frameBuffer)
+    {
+        OpenBand &open = openBands[core()];
+        open.index = index;
+        open.base = counters[core()];
+        open.start = static_cast<uint32_t>(micros());
+
+        if (!heatmapEnabled || !frameBuffer)
+            return;
+
+        // Band buffers alternate between the same two pointers, so each
+        // settles on its own slot after the first frame.
+        int slot = -1;
+        for (int i = 0; i < HEAT_SLOTS && slot < 0; ++i)
+        {
+            if (heatSlots[i].frameBuffer == frameBuffer)
+                slot = i;
+        }
+        if (slot < 0)
+        {
+            slot = nextHeatSlot;
+            nextHeatSlot = static_cast<uint8_t>((nextHeatSlot + 1) % HEAT_SLOTS);
+            heatSlots[slot].frameBuffer = frameBuffer;
+        }
+        memset(heatSlots[slot].counts, 0, HEAT_BYTES);
+    }
+
+    void FillStats::endBand(int index)
+    {
+        OpenBand &open = openBands[core()];
+        if (open.index != index)
+            return;
+        open.index = -1;
+        if (index < 0 || index >= MAX_BANDS)
+            return;
+
+        const FillCounters &now = counters[core()];
+        FillBandStats &b = bands[index];
+        b.triangles = now.triangles - open.base.triangles;
+        b.fragmentsTested = now.fragmentsTested - open.base.fragmentsTested;
+        b.pixelsWritten = now.pixelsWritten - open.base.pixelsWritten;
+        b.micros = static_cast<uint32_t>(micros()) - open.start;
+    }
+
+    void FillStats::resolveHeatmap(uint16_t *frameBuffer, size_t pixels)
+    {
+        const uint8_t *counts = heatFor(frameBuffer);
+        if (!counts || !frameBuffer)
+            return;
+        if (pixels > HEAT_BYTES)
+            pixels = HEAT_BYTES;
+
+        uint16_t palette[HEAT_LEVELS + 1];
+        for (int i = 0; i <= HEAT_LEVELS; ++i)
+            palette[i] = PixelFormat::encode(HEAT_COLORS[i]);
+
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            const uint8_t c = counts[i];
+            frameBuffer[i] = palette[c < HEAT_LEVELS ? c : HEAT_LEVELS];
+        }
+    }
+
+#else
+
+    void FillStats::beginFrame() {}
+
+    FillCounters FillStats::frame()
+    {
+        FillCounters none = {};
+        return none;
+    }
+
+    const FillBandStats &FillStats::band(int)
+    {
+        static const FillBandStats none = {};
+        return none;
+    }
+
+    bool FillStats::setHeatmap(bool enabled)
+    {
+        if (enabled)
+        {
+            LOGW(::pip3D::Debug::LOG_MODULE_RENDER,
+                 "FillStats::setHeatmap: build with ENABLE_FILL_STATS=1 for the overdraw heatmap");
+        }
+        return !enabled;
+    }
+
+    bool FillStats::heatmap() { return false; }
+    void FillStats::beginBand(int, const uint16_t *) {}
+    void FillStats::endBand(int) {}
+    void FillStats::resolveHeatmap(uint16_t *, size_t) {}
+
+#endif
+
+}
@@ -0,0 +1,162 @@
+#ifndef PIP3D_FILL_STATS_H
+#define PIP3D_FILL_STATS_H
+
+#include "DebugConfig.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#if ENABLE_FILL_STATS && defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif ENABLE_FILL_STATS && defined(PIP3D_HOST)
+#include "../Jobs.h"
+#endif
+
+#ifndef PIP3D_FILL_STATS_MAX_BANDS
+#define PIP3D_FILL_STATS_MAX_BANDS 16
+#endif
+
+namespace pip3D
+{
+
+    struct FillCounters
+    {
+        uint32_t triangles;
+        uint32_t fragmentsTested;
+        uint32_t depthFailed;
+        uint32_t pixelsWritten;
+        uint32_t pixelsBlended;
+    };
+
+    struct FillBandStats
+    {
+        uint32_t triangles;
+        uint32_t fragmentsTested;
+        uint32_t pixelsWritten;
+        uint32_t micros;
+    };
+
+    // Rasterizer counters, compiled in with ENABLE_FILL_STATS. Spans add to
+    // per-core totals, so both band cores count without sharing a line; a
+    // band's share is what its core counted between beginBand and endBand.
+    // With the heatmap on, every band is replaced by a color for how many
+    // fragments were depth tested at each pixel.
+    class FillStats
+    {
+    public:
+        static constexpr int CORE_COUNT = 2;
+        static constexpr int MAX_BANDS = PIP3D_FILL_STATS_MAX_BANDS;
+        // One heat buffer per band buffer in flight (front and back).
+        static constexpr int HEAT_SLOTS = 2;
+        // Counts from here up share the hottest color.
+        static constexpr uint8_t HEAT_LEVELS = 8;
+
+        // Clears the counters; called once per frame by the renderer.
+        static void beginFrame();
+
+        // Sum over both cores since beginFrame().
+        static FillCounters frame();
+        static const FillBandStats &band(int index);
+
+        static bool setHeatmap(bool enabled);
+        static bool heatmap();
+
+        static void beginBand(int index, const uint16_t *frameBuffer);
+        static void endBand(int index);
+        // Overwrites the band with its heat colors; no-op while the heatmap
+        // is off.
+        static void resolveHeatmap(uint16_t *frameBuffer, size_t pixels);
+
+#if ENABLE_FILL_STATS
+        __attribute__((always_inline)) static inline void addTriangle()
+        {
+            ++counters[core()].triangles;
+        }
+
+        __attribute__((always_inline)) static inline void addSpan(uint32_t tested, uint32_t failed, bool blended)
+        {
+            FillCounters &c = counters[core()];
+            c.fragmentsTested += tested;
+            c.depthFailed += failed;
+            if (blended)
+                c.pixelsBlended += tested - failed;
+            else
+                c.pixelsWritten += tested - failed;
+        }
+
+        // Per-pixel fragment counts of the band rendered into frameBuffer,
+        // nullptr while the heatmap is off.
+        __attribute__((always_inline)) static inline uint8_t *heatFor(const uint16_t *frameBuffer)
+        {
+            if (!heatmapEnabled)
+                return nullptr;
+            for (int i = 0; i < HEAT_SLOTS; ++i)
+            {
+                if (heatSlots[i].frameBuffer == frameBuffer)
+                    return heatSlots[i].counts;
+            }
+            return nullptr;
+        }
+
+    private:
+        struct HeatSlot
+        {
+            const uint16_t *frameBuffer;
+            uint8_t *counts;
+        };
+
+        struct OpenBand
+        {
+            int index;
+            uint32_t start;
+            FillCounters base;
+        };
+
+        static FillCounters counters[CORE_COUNT];
+        static OpenBand openBands[CORE_COUNT];
+        static FillBandStats bands[MAX_BANDS];
+        static HeatSlot heatSlots[HEAT_SLOTS];
+        static uint8_t nextHeatSlot;
+        static bool heatmapEnabled;
+
+        __attribute__((always_inline)) static inline int core()
+        {
+#ifdef ARDUINO_ARCH_ESP32
+            return xPortGetCoreID() & (CORE_COUNT - 1);
+#elif defined(PIP3D_HOST)
+            return JobSystem::isWorkerThread() ? 0 : 1;
+#else
+            return 0;
+#endif
+        }
+#endif
+    };
+
+#if ENABLE_FILL_STATS
+    // Times and counts the enclosing scope as one band on the calling core.
+    struct FillBandScope
+    {
+        int index;
+
+        FillBandScope(int bandIndex, const uint16_t *frameBuffer) : index(bandIndex)
+        {
+            FillStats::beginBand(bandIndex, frameBuffer);
+        }
+
+        ~FillBandScope()
+        {
+            FillStats::endBand(index);
+        }
+    };
+
+#define PIP3D_FILL_BAND(index, frameBuffer) ::pip3D::FillBandScope pip3dFillBand_(index, frameBuffer)
+#else
+#define PIP3D_FILL_BAND(index, frameBuffer) \
+    do                                      \
+    {                                       \
+    } while (0)
+#endif
+
+}
+
+#endif
@@ -1,6 +1,14 @@
 #include "Logging.h"
 #include <Arduino.h>
 #include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <atomic>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
 
 #if ENABLE_LOGGING
 
@@ -71,6 +79,9 @@ namespace pip3D
                 g_state.startMicros = micros();
                 g_state.initialized = true;
             }
+#if PIP3D_LOG_DEFERRED
+            startDrainTask();
+#endif
         }
 
         void Logger::setLevel(LogLevel level)
@@ -199,41 +210,621 @@ namespace pip3D
             return true;
         }
 
+        static_assert((PIP3D_LOG_QUEUE_SIZE & (PIP3D_LOG_QUEUE_SIZE - 1)) == 0,
+                      "PIP3D_LOG_QUEUE_SIZE must be a power of two");
+        static_assert(PIP3D_LOG_TEXT_BYTES <= 255, "PIP3D_LOG_TEXT_BYTES must fit a byte offset");
+
+        static constexpr uint32_t LOG_QUEUE_SIZE = PIP3D_LOG_QUEUE_SIZE;
+        static constexpr uint32_t LOG_QUEUE_MASK = LOG_QUEUE_SIZE - 1;
+        static constexpr size_t LOG_LINE_BYTES = 288;
+
+        // One deferred log call: the format pointer (string literals live in
+        // flash for the program lifetime), the raw variadic arguments packed
+        // back to back, and copies of any %s strings.
+        struct LogRecord
+        {
+            const char *fmt;
+            uint32_t timestamp;
+            uint16_t module;
+            uint8_t level;
+            uint8_t argBytes;
+            uint8_t textBytes;
+            uint8_t args[PIP3D_LOG_ARG_BYTES];
+            char text[PIP3D_LOG_TEXT_BYTES];
+        };
+
+        // Same bounded MPMC scheme as the job queue, so both cores and ISRs
+        // can log without taking a lock.
+        struct LogSlot
+        {
+            std::atomic<uint32_t> sequence;
+            LogRecord record;
+        };
+
+        static LogSlot s_logQueue[LOG_QUEUE_SIZE];
+        static std::atomic<uint32_t> s_logEnqueuePos(0);
+        static std::atomic<uint32_t> s_logDequeuePos(0);
+        static std::atomic<uint32_t> s_logDropped(0);
+        static uint32_t s_logReportedDropped = 0;
+        static bool s_logQueueReady = false;
+        static bool s_logDeferred = false;
+
+#ifdef ARDUINO_ARCH_ESP32
+        static TaskHandle_t s_logTask = nullptr;
+#endif
+
+        enum ArgKind : uint8_t
+        {
+            ARG_INVALID,
+            ARG_INT,
+            ARG_LONG,
+            ARG_LLONG,
+            ARG_INTMAX,
+            ARG_SIZE,
+            ARG_PTRDIFF,
+            ARG_DOUBLE,
+            ARG_STRING,
+            ARG_POINTER
+        };
+
+        struct FormatSpec
+        {
+            const char *begin;
+            const char *end;
+            uint8_t stars;
+            ArgKind kind;
+        };
+
+        // Parses the conversion starting at '%'. Returns false for anything
+        // the deferred path cannot replay (%n, long double, malformed specs).
+        static bool parseSpec(const char *p, FormatSpec &spec)
+        {
+            spec.begin = p++;
+            spec.stars = 0;
+            spec.kind = ARG_INVALID;
+
+            while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+                ++p;
+            if (*p == '*')
+            {
+                ++spec.stars;
+                ++p;
+            }
+            while (*p >= '0' && *p <= '9')
+                ++p;
+            if (*p == '.')
+            {
+                ++p;
+                if (*p == '*')
+                {
+                    ++spec.stars;
+                    ++p;
+                }
+                while (*p >= '0' && *p <= '9')
+                    ++p;
+            }
+
+            ArgKind intKind = ARG_INT;
+            bool longDouble = false;
+            switch (*p)
+            {
+            case 'h':
+                ++p;
+                if (*p == 'h')
+                    ++p;
+                break;
+            case 'l':
+                ++p;
+                intKind = ARG_LONG;
+                if (*p == 'l')
+                {
+                    ++p;
+                    intKind = ARG_LLONG;
+                }
+                break;
+            case 'j':
+                ++p;
+                intKind = ARG_INTMAX;
+                break;
+            case 'z':
+                ++p;
+                intKind = ARG_SIZE;
+                break;
+            case 't':
+                ++p;
+                intKind = ARG_PTRDIFF;
+                break;
+            case 'L':
+                ++p;
+                longDouble = true;
+                break;
+            default:
+                break;
+            }
+
+            switch (*p)
+            {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+            case 'c':
+                spec.kind = intKind;
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                if (!longDouble)
+                    spec.kind = ARG_DOUBLE;
+                break;
+            case 's':
+                spec.kind = ARG_STRING;
+                break;
+            case 'p':
+                spec.kind = ARG_POINTER;
+                break;
+            default:
+                break;
+            }
+
+            spec.end = p + 1;
+            return spec.kind != ARG_INVALID;
+        }
+
+        static bool pushArg(LogRecord &rec, const void *value, size_t size)
+        {
+            if (rec.argBytes + size > sizeof(rec.args))
+                return false;
+            memcpy(rec.args + rec.argBytes, value, size);
+            rec.argBytes = static_cast<uint8_t>(rec.argBytes + size);
+            return true;
+        }
+
+        // A string that does not fit the remaining text space fails the
+        // capture, so the record is written synchronously instead.
+        static bool pushString(LogRecord &rec, const char *str)
+        {
+            if (rec.textBytes >= sizeof(rec.text))
+                return false;
+            const uint8_t offset = rec.textBytes;
+            if (!str)
+                str = "(null)";
+            const size_t room = sizeof(rec.text) - offset - 1;
+            const size_t len = strlen(str);
+            if (len > room || !pushArg(rec, &offset, sizeof(offset)))
+                return false;
+            memcpy(rec.text + offset, str, len);
+            rec.text[offset + len] = '\0';
+            rec.textBytes = static_cast<uint8_t>(offset + len + 1);
+            return true;
+        }
+
+        template <typename T>
+        static bool captureValue(LogRecord &rec, va_list &args)
+        {
+            T value = va_arg(args, T);
+            return pushArg(rec, &value, sizeof(value));
+        }
+
+        static bool captureArgs(LogRecord &rec, const char *fmt, va_list &args)
+        {
+            rec.argBytes = 0;
+            rec.textBytes = 0;
+            for (const char *p = fmt; *p;)
+            {
+                if (*p != '%')
+                {
+                    ++p;
+                    continue;
+                }
+                if (p[1] == '%')
+                {
+                    p += 2;
+                    continue;
+                }
+
+                FormatSpec spec;
+                if (!parseSpec(p, spec))
+                    return false;
+                for (uint8_t i = 0; i < spec.stars; ++i)
+                {
+                    if (!captureValue<int>(rec, args))
+                        return false;
+                }
+
+                bool ok = false;
+                switch (spec.kind)
+                {
+                case ARG_INT:
+                    ok = captureValue<int>(rec, args);
+                    break;
+                case ARG_LONG:
+                    ok = captureValue<long>(rec, args);
+                    break;
+                case ARG_LLONG:
+                    ok = captureValue<long long>(rec, args);
+                    break;
+                case ARG_INTMAX:
+                    ok = captureValue<intmax_t>(rec, args);
+                    break;
+                case ARG_SIZE:
+                    ok = captureValue<size_t>(rec, args);
+                    break;
+                case ARG_PTRDIFF:
+                    ok = captureValue<ptrdiff_t>(rec, args);
+                    break;
+                case ARG_DOUBLE:
+                    ok = captureValue<double>(rec, args);
+                    break;
+                case ARG_POINTER:
+                    ok = captureValue<void *>(rec, args);
+                    break;
+                case ARG_STRING:
+                    ok = pushString(rec, va_arg(args, const char *));
+                    break;
+                default:
+                    break;
+                }
+                if (!ok)
+                    return false;
+                p = spec.end;
+            }
+            return true;
+        }
+
+        template <typename T>
+        static T readArg(const LogRecord &rec, size_t &offset)
+        {
+            T value;
+            memcpy(&value, rec.args + offset, sizeof(value));
+            offset += sizeof(value);
+            return value;
+        }
+
+        template <typename T>
+        static int emitValue(char *dst, size_t size, const char *spec, const int *stars, uint8_t starCount, T value)
+        {
+            if (starCount == 0)
+                return snprintf(dst, size, spec, value);
+            if (starCount == 1)
+                return snprintf(dst, size, spec, stars[0], value);
+            return snprintf(dst, size, spec, stars[0], stars[1], value);
+        }
+
+        // Replays a captured record through snprintf one conversion at a
+        // time, using the same spec parser as the capture side.
+        static void formatRecord(const LogRecord &rec, char *out, size_t size)
+        {
+            size_t len = 0;
+            size_t offset = 0;
+            for (const char *p = rec.fmt; *p && len + 1 < size;)
+            {
+                if (*p != '%')
+                {
+                    out[len++] = *p++;
+                    continue;
+                }
+                if (p[1] == '%')
+                {
+                    out[len++] = '%';
+                    p += 2;
+                    continue;
+                }
+
+                FormatSpec spec;
+                parseSpec(p, spec);
+                char specText[24];
+                size_t specLen = static_cast<size_t>(spec.end - spec.begin);
+                if (specLen >= sizeof(specText))
+                    specLen = sizeof(specText) - 1;
+                memcpy(specText, spec.begin, specLen);
+                specText[specLen] = '\0';
+
+                int stars[2] = {0, 0};
+                for (uint8_t i = 0; i < spec.stars; ++i)
+                    stars[i] = readArg<int>(rec, offset);
+
+                char *dst = out + len;
+                const size_t room = size - len;
+                int written = 0;
+                switch (spec.kind)
+                {
+                case ARG_INT:
+                    written = emitValue(dst, room, specText, stars, spec.stars, readArg<int>(rec, offset));
+                    break;
+                case ARG_LONG:
+                    written = emitValue(dst, room, specText, stars, spec.stars, readArg<long>(rec, offset));
+                    break;
+                case ARG_LLONG:
+                    written = emitValue(dst, room, specText, stars, spec.stars, readArg<long long>(rec, offset));
+                    break;
+                case ARG_INTMAX:
+                    written = emitValue(dst, room, specText, stars, spec.stars, readArg<intmax_t>(rec, offset));
+                    break;
+                case ARG_SIZE:
+                    written = emitValue(dst, room, specText, stars, spec.stars, readArg<size_t>(rec, offset));
+                    break;
+                case ARG_PTRDIFF:
+                    written = emitValue(dst, room, specText, stars, spec.stars, readArg<ptrdiff_t>(rec, offset));
+                    break;
+                case ARG_DOUBLE:
+                    written = emitValue(dst, room, specText, stars, spec.stars, readArg<double>(rec, offset));
+                    break;
+                case ARG_POINTER:
+                    written = emitValue(dst, room, specText, stars, spec.stars, readArg<void *>(rec, offset));
+                    break;
+                case ARG_STRING:
+                    written = emitValue(dst, room, specText, stars, spec.stars,
+                                        static_cast<const char *>(rec.text + readArg<uint8_t>(rec, offset)));
+                    break;
+                default:
+                    break;
+                }
+
+                if (written > 0)
+                    len += static_cast<size_t>(written) < room ? static_cast<size_t>(written) : room - 1;
+                p = spec.end;
+            }
+            out[len] = '\0';
+        }
+
+        static void writeLine(uint16_t module, LogLevel level, uint32_t timestamp, const char *message)
+        {
+            char line[LOG_LINE_BYTES];
+            int len = 0;
+            if (g_state.timestamps)
+            {
+                uint32_t dt = g_state.startMicros == 0u ? 0u : timestamp - g_state.startMicros;
+                uint32_t ms = dt / 1000u;
+                len = snprintf(line, sizeof(line), "[%lu.%03u] ",
+                               static_cast<unsigned long>(ms / 1000u),
+                               static_cast<unsigned int>(ms % 1000u));
+            }
+            snprintf(line + len, sizeof(line) - len, "%s %s: %s",
+                     levelToString(level), moduleToString(module), message);
+            Serial.println(line);
+        }
+
+        static void resetLogQueue()
+        {
+            for (uint32_t i = 0; i < LOG_QUEUE_SIZE; ++i)
+            {
+                s_logQueue[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            s_logEnqueuePos.store(0, std::memory_order_relaxed);
+            s_logDequeuePos.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            s_logQueueReady = true;
+        }
+
+        // Claims a slot and fills it in place. On failure nothing is published.
+        static bool logQueuePush(uint16_t module, LogLevel level, const char *fmt, va_list &args)
+        {
+            uint32_t pos = s_logEnqueuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                LogSlot &slot = s_logQueue[pos & LOG_QUEUE_MASK];
+                uint32_t seq = slot.sequence.load(std::memory_order_acquire);
+                int32_t diff = static_cast<int32_t>(seq - pos);
+                if (diff == 0)
+                {
+                    if (s_logEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        LogRecord &rec = slot.record;
+                        rec.fmt = fmt;
+                        rec.timestamp = micros();
+                        rec.module = module;
+                        rec.level = static_cast<uint8_t>(level);
+                        if (!captureArgs(rec, fmt, args))
+                        {
+                            // The slot is already claimed; publish it as an
+                            // empty record so the consumer skips over it.
+                            rec.fmt = nullptr;
+                            slot.sequence.store(pos + 1, std::memory_order_release);
+                            return false;
+                        }
+                        slot.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    s_logDropped.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+                else
+                {
+                    pos = s_logEnqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        static bool logQueuePop(LogRecord &out)
+        {
+            uint32_t pos = s_logDequeuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                LogSlot &slot = s_logQueue[pos & LOG_QUEUE_MASK];
+                uint32_t seq = slot.sequence.load(std::memory_order_acquire);
+                int32_t diff = static_cast<int32_t>(seq - (pos + 1));
+                if (diff == 0)
+                {
+                    if (s_logDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        out = slot.record;
+                        slot.sequence.store(pos + LOG_QUEUE_SIZE, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = s_logDequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        static void logDirect(uint16_t module, LogLevel level, const char *fmt, va_list args)
+        {
+            char buffer[256];
+            vsnprintf(buffer, sizeof(buffer), fmt, args);
+            writeLine(module, level, micros(), buffer);
+        }
+
         void Logger::log(uint16_t module, LogLevel level, const char *fmt, ...)
         {
             if (!isEnabled(module, level))
                 return;
             if (!g_state.initialized)
                 init(g_state.level, g_state.modules, g_state.timestamps);
-            if (g_state.timestamps)
-            {
-                uint32_t now = micros();
-                uint32_t dt = g_state.startMicros == 0u ? 0u : now - g_state.startMicros;
-                uint32_t ms = dt / 1000u;
-                uint32_t s = ms / 1000u;
-                uint16_t msRem = static_cast<uint16_t>(ms % 1000u);
-                Serial.print('[');
-                Serial.print(static_cast<unsigned long>(s));
-                Serial.print('.');
-                if (msRem < 100u)
-                    Serial.print('0');
-                if (msRem < 10u)
-                    Serial.print('0');
-                Serial.print(static_cast<unsigned long>(msRem));
-                Serial.print("] ");
-            }
-            Serial.print(levelToString(level));
-            Serial.print(' ');
-            Serial.print(moduleToString(module));
-            Serial.print(": ");
-            char buffer[256];
+
             va_list args;
             va_start(args, fmt);
-            vsnprintf(buffer, sizeof(buffer), fmt, args);
+            if (s_logDeferred)
+            {
+                va_list capture;
+                va_copy(capture, args);
+                const bool queued = logQueuePush(module, level, fmt, capture);
+                va_end(capture);
+                if (queued)
+                {
+                    va_end(args);
+                    return;
+                }
+            }
+            logDirect(module, level, fmt, args);
             va_end(args);
-            Serial.println(buffer);
         }
 
+        void Logger::setDeferred(bool enabled)
+        {
+            if (enabled && !s_logQueueReady)
+                resetLogQueue();
+            if (!enabled && s_logDeferred)
+            {
+                s_logDeferred = false;
+                flush();
+                return;
+            }
+            s_logDeferred = enabled;
+        }
+
+        bool Logger::getDeferred()
+        {
+            return s_logDeferred;
+        }
+
+        uint32_t Logger::flush(uint32_t maxRecords)
+        {
+            if (!s_logQueueReady)
+                return 0;
+
+            uint32_t written = 0;
+            LogRecord rec;
+            char message[256];
+            while (written < maxRecords && logQueuePop(rec))
+            {
+                if (!rec.fmt)
+                    continue;
+                formatRecord(rec, message, sizeof(message));
+                writeLine(rec.module, static_cast<LogLevel>(rec.level), rec.timestamp, message);
+                ++written;
+            }
+
+            const uint32_t dropped = s_logDropped.load(std::memory_order_relaxed);
+            if (dropped != s_logReportedDropped)
+            {
+                snprintf(message, sizeof(message), "log queue overflow, %lu records dropped",
+                         static_cast<unsigned long>(dropped - s_logReportedDropped));
+                s_logReportedDropped = dropped;
+                writeLine(LOG_MODULE_CORE, LOG_LEVEL_WARNING, micros(), message);
+            }
+            return written;
+        }
+
+        uint32_t Logger::getDroppedCount()
+        {
+            return s_logDropped.load(std::memory_order_relaxed);
+        }
+
+        uint32_t Logger::getPendingCount()
+        {
+            return s_logEnqueuePos.load(std::memory_order_relaxed) -
+                   s_logDequeuePos.load(std::memory_order_relaxed);
+        }
+
+#ifdef ARDUINO_ARCH_ESP32
+
+        static void logDrainLoop(void *param)
+        {
+            (void)param;
+            for (;;)
+            {
+                Logger::flush();
+                vTaskDelay(pdMS_TO_TICKS(PIP3D_LOG_FLUSH_INTERVAL_MS));
+            }
+        }
+
+        bool Logger::startDrainTask()
+        {
+            if (s_logTask)
+                return true;
+            if (!s_logQueueReady)
+                resetLogQueue();
+
+            const uint32_t STACK_SIZE = 3072;
+            BaseType_t res = xTaskCreatePinnedToCore(
+                logDrainLoop,
+                "Pip3DLogDrain",
+                STACK_SIZE,
+                nullptr,
+                PIP3D_LOG_TASK_PRIORITY,
+                &s_logTask,
+                PIP3D_LOG_TASK_CORE);
+
+            if (res != pdPASS)
+            {
+                s_logTask = nullptr;
+                s_logDeferred = false;
+                return false;
+            }
+
+            s_logDeferred = true;
+            return true;
+        }
+
+        void Logger::stopDrainTask()
+        {
+            if (!s_logTask)
+                return;
+            vTaskDelete(s_logTask);
+            s_logTask = nullptr;
+            setDeferred(false);
+        }
+
+#else
+
+        bool Logger::startDrainTask()
+        {
+            return false;
+        }
+
+        void Logger::stopDrainTask()
+        {
+        }
+
+#endif
+
     }
 }
 
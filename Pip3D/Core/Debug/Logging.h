@@ -57,6 +57,19 @@ namespace pip3D
             static bool getTimestampsEnabled();
             static bool isEnabled(uint16_t module, LogLevel level);
             static void log(uint16_t module, LogLevel level, const char *fmt, ...);
+
+            // Deferred mode queues records for flush(); when it is off, or a
+            // record does not fit its slot, log() writes synchronously.
+            static void setDeferred(bool enabled);
+            static bool getDeferred();
+            static bool startDrainTask();
+            static void stopDrainTask();
+
+            // Formats and writes up to maxRecords queued records. Call it from
+            // an idle hook or loop() when the drain task is not running.
+            static uint32_t flush(uint32_t maxRecords = 0xFFFFFFFFu);
+            static uint32_t getDroppedCount();
+            static uint32_t getPendingCount();
         };
 
     }
@@ -0,0 +1,451 @@
+#include "Profiler.h"
+#include "Logging.h"
+#include <Arduino.h>
+#include <string.h>
+#include <atomic>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif defined(PIP3D_HOST)
+#include "../Jobs.h"
+#include <mutex>
+#endif
+
+namespace pip3D
+{
+
+    namespace
+    {
+        struct OpenZone
+        {
+            uint32_t start;
+            uint16_t zone;
+        };
+
+        // Nesting stack of one core. Tasks sharing a core must not interleave
+        // zones, which holds for the render loop and the job worker.
+        struct CoreState
+        {
+            OpenZone open[Profiler::MAX_DEPTH];
+            int depth;
+            uint32_t offset;
+            bool calibrated;
+        };
+
+        const char *s_zoneNames[Profiler::MAX_ZONES];
+        uint16_t s_zoneCount = 0;
+        ProfileZoneStats s_stats[Profiler::MAX_ZONES][Profiler::CORE_COUNT];
+        CoreState s_cores[Profiler::CORE_COUNT];
+
+        ProfileEvent s_events[Profiler::EVENT_COUNT];
+        std::atomic<uint32_t> s_eventWrite(0);
+        std::atomic<uint32_t> s_droppedEvents(0);
+
+        ProfileFrame s_frames[Profiler::FRAME_COUNT];
+        uint32_t s_completedFrames = 0;
+        uint32_t s_frameStart = 0;
+        uint32_t s_frameFirstEvent = 0;
+        bool s_frameOpen = false;
+
+        const ProfileZoneStats s_emptyStats = {0, 0, 0, 0, 0};
+
+#ifdef ARDUINO_ARCH_ESP32
+        portMUX_TYPE s_zoneLock = portMUX_INITIALIZER_UNLOCKED;
+#elif defined(PIP3D_HOST)
+        std::mutex s_zoneLock;
+#endif
+
+        int findZone(const char *name)
+        {
+            for (uint16_t i = 0; i < s_zoneCount; ++i)
+            {
+                if (s_zoneNames[i] == name || strcmp(s_zoneNames[i], name) == 0)
+                    return i;
+            }
+            return -1;
+        }
+
+        struct StreamWriter
+        {
+            ProfilerWriteFunc write;
+            void *userData;
+            uint8_t buffer[64];
+            size_t length;
+
+            void put(const void *data, size_t size)
+            {
+                const uint8_t *bytes = static_cast<const uint8_t *>(data);
+                while (size > 0)
+                {
+                    size_t chunk = sizeof(buffer) - length;
+                    if (chunk > size)
+                        chunk = size;
+                    memcpy(buffer + length, bytes, chunk);
+                    length += chunk;
+                    bytes += chunk;
+                    size -= chunk;
+                    if (length == sizeof(buffer))
+                        flush();
+                }
+            }
+
+            template <typename T>
+            void put(T value)
+            {
+                put(&value, sizeof(value));
+            }
+
+            void flush()
+            {
+                if (length > 0)
+                    write(buffer, length, userData);
+                length = 0;
+            }
+        };
+
+        void serialWrite(const uint8_t *data, size_t size, void *userData)
+        {
+            (void)userData;
+            Serial.write(data, size);
+        }
+    }
+
+    uint8_t Profiler::currentCore()
+    {
+#ifdef ARDUINO_ARCH_ESP32
+        const uint8_t core = static_cast<uint8_t>(xPortGetCoreID());
+        return core < CORE_COUNT ? core : CORE_COUNT - 1;
+#elif defined(PIP3D_HOST)
+        // Same split as the device: job worker on core 0, the rest on 1.
+        return JobSystem::isWorkerThread() ? 0 : CORE_COUNT - 1;
+#else
+        return 0;
+#endif
+    }
+
+    uint32_t Profiler::cyclesPerMicrosecond()
+    {
+#ifdef ARDUINO_ARCH_ESP32
+        return getCpuFrequencyMhz();
+#else
+        return 1;
+#endif
+    }
+
+    // Each core's cycle counter runs from its own reset; the first read on
+    // a core anchors it to micros() so both cores share one timeline.
+    uint32_t Profiler::now()
+    {
+#ifdef ARDUINO_ARCH_ESP32
+        CoreState &core = s_cores[currentCore()];
+        if (!core.calibrated)
+        {
+            core.offset = ESP.getCycleCount() - static_cast<uint32_t>(micros()) * cyclesPerMicrosecond();
+            core.calibrated = true;
+        }
+        return ESP.getCycleCount() - core.offset;
+#else
+        return static_cast<uint32_t>(micros());
+#endif
+    }
+
+    float Profiler::cyclesToMs(uint32_t cycles)
+    {
+        return cycles / (cyclesPerMicrosecond() * 1000.0f);
+    }
+
+    uint16_t Profiler::intern(const char *name)
+    {
+        if (!name)
+            return INVALID_ZONE;
+
+#ifdef ARDUINO_ARCH_ESP32
+        portENTER_CRITICAL(&s_zoneLock);
+#elif defined(PIP3D_HOST)
+        s_zoneLock.lock();
+#endif
+        int idx = findZone(name);
+        if (idx < 0 && s_zoneCount < MAX_ZONES)
+        {
+            idx = s_zoneCount;
+            s_zoneNames[idx] = name;
+            memset(s_stats[idx], 0, sizeof(s_stats[idx]));
+            ++s_zoneCount;
+        }
+#ifdef ARDUINO_ARCH_ESP32
+        portEXIT_CRITICAL(&s_zoneLock);
+#elif defined(PIP3D_HOST)
+        s_zoneLock.unlock();
+#endif
+
+        if (idx < 0)
+        {
+            LOGW(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
+                 "Profiler::intern: zone table full, '%s' not tracked", name);
+            return INVALID_ZONE;
+        }
+        return static_cast<uint16_t>(idx);
+    }
+
+    void Profiler::begin(uint16_t zone)
+    {
+        CoreState &core = s_cores[currentCore()];
+        const int depth = core.depth++;
+        if (depth < MAX_DEPTH)
+        {
+            core.open[depth].zone = zone;
+            core.open[depth].start = now();
+        }
+    }
+
+    void Profiler::end()
+    {
+        const uint32_t t = now();
+        const uint8_t coreId = currentCore();
+        CoreState &core = s_cores[coreId];
+        if (core.depth <= 0)
+            return;
+
+        const int depth = --core.depth;
+        if (depth >= MAX_DEPTH)
+        {
+            s_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const OpenZone &open = core.open[depth];
+        if (open.zone >= s_zoneCount)
+            return;
+
+        const uint32_t duration = t - open.start;
+        ProfileZoneStats &stats = s_stats[open.zone][coreId];
+        ++stats.callCount;
+        stats.totalCycles += duration;
+        stats.frameCycles += duration;
+        if (duration > stats.maxCycles)
+            stats.maxCycles = duration;
+
+        const uint32_t idx = s_eventWrite.fetch_add(1, std::memory_order_relaxed);
+        ProfileEvent &ev = s_events[idx & (EVENT_COUNT - 1)];
+        ev.start = open.start;
+        ev.duration = duration;
+        ev.zone = open.zone;
+        ev.core = coreId;
+        ev.depth = static_cast<uint8_t>(depth);
+    }
+
+    void Profiler::frameMark()
+    {
+        const uint32_t t = now();
+        const uint32_t write = s_eventWrite.load(std::memory_order_relaxed);
+
+        if (s_frameOpen)
+        {
+            ProfileFrame &frame = s_frames[s_completedFrames % FRAME_COUNT];
+            frame.index = s_completedFrames;
+            frame.start = s_frameStart;
+            frame.duration = t - s_frameStart;
+            frame.firstEvent = s_frameFirstEvent;
+            frame.eventCount = write - s_frameFirstEvent;
+            ++s_completedFrames;
+
+            for (uint16_t z = 0; z < s_zoneCount; ++z)
+            {
+                for (int c = 0; c < CORE_COUNT; ++c)
+                {
+                    s_stats[z][c].lastFrameCycles = s_stats[z][c].frameCycles;
+                    s_stats[z][c].frameCycles = 0;
+                }
+            }
+        }
+
+        s_frameStart = t;
+        s_frameFirstEvent = write;
+        s_frameOpen = true;
+    }
+
+    uint16_t Profiler::getZoneCount()
+    {
+        return s_zoneCount;
+    }
+
+    const char *Profiler::getZoneName(uint16_t zone)
+    {
+        return zone < s_zoneCount ? s_zoneNames[zone] : "";
+    }
+
+    const ProfileZoneStats &Profiler::getZoneStats(uint16_t zone, uint8_t core)
+    {
+        if (zone >= s_zoneCount || core >= CORE_COUNT)
+            return s_emptyStats;
+        return s_stats[zone][core];
+    }
+
+    float Profiler::getZoneFrameTime(uint16_t zone, int core)
+    {
+        if (zone >= s_zoneCount)
+            return 0.0f;
+        if (core >= 0)
+            return core < CORE_COUNT ? cyclesToMs(s_stats[zone][core].lastFrameCycles) : 0.0f;
+
+        uint32_t cycles = 0;
+        for (int c = 0; c < CORE_COUNT; ++c)
+            cycles += s_stats[zone][c].lastFrameCycles;
+        return cyclesToMs(cycles);
+    }
+
+    bool Profiler::getFrame(uint32_t framesAgo, ProfileFrame &out)
+    {
+        if (framesAgo >= FRAME_COUNT || framesAgo >= s_completedFrames)
+            return false;
+
+        const ProfileFrame &frame = s_frames[(s_completedFrames - 1 - framesAgo) % FRAME_COUNT];
+        const uint32_t write = s_eventWrite.load(std::memory_order_relaxed);
+        if (write - frame.firstEvent > EVENT_COUNT)
+            return false;
+        out = frame;
+        return true;
+    }
+
+    const ProfileEvent &Profiler::getEvent(uint32_t index)
+    {
+        return s_events[index & (EVENT_COUNT - 1)];
+    }
+
+    uint32_t Profiler::getDroppedEvents()
+    {
+        return s_droppedEvents.load(std::memory_order_relaxed);
+    }
+
+    // Layout: "P3DP", u8 version, u8 cores, u16 cycles/us, u16 zones,
+    // zones as (u8 length, name), u16 frames, then per frame (oldest first)
+    // u32 index, u32 start, u32 duration, u16 events and 12-byte events
+    // (u32 start, u32 duration, u16 zone, u8 core, u8 depth).
+    void Profiler::dumpBinary(ProfilerWriteFunc write, void *userData, uint32_t frames)
+    {
+        if (!write)
+            return;
+
+        StreamWriter out = {write, userData, {}, 0};
+        out.put("P3DP", 4);
+        out.put(static_cast<uint8_t>(1));
+        out.put(static_cast<uint8_t>(CORE_COUNT));
+        out.put(static_cast<uint16_t>(cyclesPerMicrosecond()));
+        out.put(s_zoneCount);
+        for (uint16_t z = 0; z < s_zoneCount; ++z)
+        {
+            size_t len = strlen(s_zoneNames[z]);
+            if (len > 255)
+                len = 255;
+            out.put(static_cast<uint8_t>(len));
+            out.put(s_zoneNames[z], len);
+        }
+
+        ProfileFrame frame;
+        uint16_t frameCount = 0;
+        while (frameCount < frames && getFrame(frameCount, frame))
+            ++frameCount;
+        out.put(frameCount);
+
+        for (int f = frameCount - 1; f >= 0; --f)
+        {
+            if (!getFrame(static_cast<uint32_t>(f), frame))
+                frame.eventCount = 0;
+            const uint16_t eventCount = frame.eventCount > 0xFFFFu ? 0xFFFFu : static_cast<uint16_t>(frame.eventCount);
+            out.put(frame.index);
+            out.put(frame.start);
+            out.put(frame.duration);
+            out.put(eventCount);
+            for (uint16_t e = 0; e < eventCount; ++e)
+            {
+                const ProfileEvent &ev = getEvent(frame.firstEvent + e);
+                out.put(ev.start);
+                out.put(ev.duration);
+                out.put(ev.zone);
+                out.put(ev.core);
+                out.put(ev.depth);
+            }
+        }
+        out.flush();
+    }
+
+    void Profiler::dumpBinary(uint32_t frames)
+    {
+        dumpBinary(serialWrite, nullptr, frames);
+    }
+
+    void Profiler::printReport()
+    {
+        ProfileFrame frame;
+        if (getFrame(0, frame))
+        {
+            LOGI(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
+                 "Frame %lu: %.2fms, %lu zones",
+                 static_cast<unsigned long>(frame.index),
+                 cyclesToMs(frame.duration),
+                 static_cast<unsigned long>(frame.eventCount));
+        }
+
+        for (uint16_t z = 0; z < s_zoneCount; ++z)
+        {
+            for (int c = 0; c < CORE_COUNT; ++c)
+            {
+                const ProfileZoneStats &stats = s_stats[z][c];
+                if (stats.callCount == 0)
+                    continue;
+
+                LOGI(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
+                     "%s [core %d]: %.3fms avg, %.3fms max, %.3fms last frame, %lu calls",
+                     s_zoneNames[z],
+                     c,
+                     static_cast<float>(stats.totalCycles / stats.callCount) / (cyclesPerMicrosecond() * 1000.0f),
+                     cyclesToMs(stats.maxCycles),
+                     cyclesToMs(stats.lastFrameCycles),
+                     static_cast<unsigned long>(stats.callCount));
+            }
+        }
+    }
+
+    void Profiler::reset()
+    {
+        memset(s_stats, 0, sizeof(s_stats));
+        for (int c = 0; c < CORE_COUNT; ++c)
+            s_cores[c].depth = 0;
+        s_eventWrite.store(0, std::memory_order_relaxed);
+        s_droppedEvents.store(0, std::memory_order_relaxed);
+        s_completedFrames = 0;
+        s_frameOpen = false;
+    }
+
+    void Profiler::beginSection(const char *name)
+    {
+        begin(intern(name));
+    }
+
+    void Profiler::endSection()
+    {
+        end();
+    }
+
+    float Profiler::getSectionTime(const char *name)
+    {
+        if (!name)
+            return 0.0f;
+        const int zone = findZone(name);
+        if (zone < 0)
+            return 0.0f;
+
+        uint64_t cycles = 0;
+        uint32_t calls = 0;
+        for (int c = 0; c < CORE_COUNT; ++c)
+        {
+            cycles += s_stats[zone][c].totalCycles;
+            calls += s_stats[zone][c].callCount;
+        }
+        if (calls == 0)
+            return 0.0f;
+        return static_cast<float>(cycles / calls) / (cyclesPerMicrosecond() * 1000.0f);
+    }
+
+}
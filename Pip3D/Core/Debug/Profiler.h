@@ -0,0 +1,164 @@
+#ifndef PIP3D_PROFILER_H
+#define PIP3D_PROFILER_H
+
+#include "DebugConfig.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef PIP3D_PROFILER_MAX_ZONES
+#define PIP3D_PROFILER_MAX_ZONES 32
+#endif
+
+#ifndef PIP3D_PROFILER_MAX_DEPTH
+#define PIP3D_PROFILER_MAX_DEPTH 16
+#endif
+
+#ifndef PIP3D_PROFILER_EVENTS
+#define PIP3D_PROFILER_EVENTS 256
+#endif
+
+#ifndef PIP3D_PROFILER_FRAMES
+#define PIP3D_PROFILER_FRAMES 16
+#endif
+
+#ifndef PIP3D_PROFILER_CORES
+#define PIP3D_PROFILER_CORES 2
+#endif
+
+static_assert((PIP3D_PROFILER_EVENTS & (PIP3D_PROFILER_EVENTS - 1)) == 0,
+              "PIP3D_PROFILER_EVENTS must be a power of two");
+
+namespace pip3D
+{
+
+    typedef void (*ProfilerWriteFunc)(const uint8_t *data, size_t size, void *userData);
+
+    // One closed zone. Timestamps are CPU cycles on a timeline shared by
+    // both cores; depth is the nesting level on the core that ran it.
+    struct ProfileEvent
+    {
+        uint32_t start;
+        uint32_t duration;
+        uint16_t zone;
+        uint8_t core;
+        uint8_t depth;
+    };
+
+    // Events [firstEvent, firstEvent + eventCount) of the event ring were
+    // closed during this frame.
+    struct ProfileFrame
+    {
+        uint32_t index;
+        uint32_t start;
+        uint32_t duration;
+        uint32_t firstEvent;
+        uint32_t eventCount;
+    };
+
+    struct ProfileZoneStats
+    {
+        uint32_t callCount;
+        uint32_t maxCycles;
+        uint32_t frameCycles;
+        uint32_t lastFrameCycles;
+        uint64_t totalCycles;
+    };
+
+    // Scoped-zone profiler. Zone names are interned once per call site
+    // (see PIP3D_PROFILE_ZONE), begin/end keep a per-core nesting stack and
+    // every closed zone lands in a ring that frameMark() slices into frames.
+    struct Profiler
+    {
+        static constexpr uint16_t INVALID_ZONE = 0xFFFFu;
+        static constexpr int MAX_ZONES = PIP3D_PROFILER_MAX_ZONES;
+        static constexpr int MAX_DEPTH = PIP3D_PROFILER_MAX_DEPTH;
+        static constexpr uint32_t EVENT_COUNT = PIP3D_PROFILER_EVENTS;
+        static constexpr uint32_t FRAME_COUNT = PIP3D_PROFILER_FRAMES;
+        static constexpr int CORE_COUNT = PIP3D_PROFILER_CORES;
+
+        // Returns the id for name, registering it on first use. The string
+        // must outlive the profiler (normally a literal).
+        static uint16_t intern(const char *name);
+
+        static void begin(uint16_t zone);
+        static void end();
+
+        // Closes the current frame and starts the next one.
+        static void frameMark();
+
+        static uint32_t now();
+        static uint8_t currentCore();
+        static uint32_t cyclesPerMicrosecond();
+        static float cyclesToMs(uint32_t cycles);
+
+        static uint16_t getZoneCount();
+        static const char *getZoneName(uint16_t zone);
+        static const ProfileZoneStats &getZoneStats(uint16_t zone, uint8_t core);
+
+        // Milliseconds spent in zone during the last completed frame,
+        // summed over cores when core is negative.
+        static float getZoneFrameTime(uint16_t zone, int core = -1);
+
+        // framesAgo = 0 is the last completed frame. Fails once its events
+        // have been overwritten by newer ones.
+        static bool getFrame(uint32_t framesAgo, ProfileFrame &out);
+        static const ProfileEvent &getEvent(uint32_t index);
+        static uint32_t getDroppedEvents();
+
+        // Compact little-endian stream of zone names and the last frames,
+        // for offline flame graphs.
+        static void dumpBinary(ProfilerWriteFunc write, void *userData, uint32_t frames = FRAME_COUNT);
+        static void dumpBinary(uint32_t frames = FRAME_COUNT);
+
+        static void printReport();
+        static void reset();
+
+        // Name-based API kept for existing callers; prefer the zone macros.
+        static void beginSection(const char *name);
+        static void endSection();
+        static float getSectionTime(const char *name);
+    };
+
+    struct ProfileScope
+    {
+        explicit ProfileScope(uint16_t zone)
+        {
+            Profiler::begin(zone);
+        }
+
+        ~ProfileScope()
+        {
+            Profiler::end();
+        }
+
+        ProfileScope(const ProfileScope &) = delete;
+        ProfileScope &operator=(const ProfileScope &) = delete;
+    };
+
+}
+
+#define PIP3D_PROFILE_CONCAT_INNER(a, b) a##b
+#define PIP3D_PROFILE_CONCAT(a, b) PIP3D_PROFILE_CONCAT_INNER(a, b)
+
+#if PIP3D_ENABLE_PROFILER
+
+#define PIP3D_PROFILE_ZONE(name)                                                                         \
+    static const uint16_t PIP3D_PROFILE_CONCAT(pip3dZoneId_, __LINE__) = ::pip3D::Profiler::intern(name); \
+    ::pip3D::ProfileScope PIP3D_PROFILE_CONCAT(pip3dZoneScope_, __LINE__)(PIP3D_PROFILE_CONCAT(pip3dZoneId_, __LINE__))
+
+#define PIP3D_PROFILE_FRAME() ::pip3D::Profiler::frameMark()
+
+#else
+
+#define PIP3D_PROFILE_ZONE(name) \
+    do                           \
+    {                            \
+    } while (0)
+#define PIP3D_PROFILE_FRAME() \
+    do                        \
+    {                         \
+    } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef FIXEDPOOL_H
+#define FIXEDPOOL_H
+
+#include "Core.h"
+#include "Debug/Logging.h"
+#include <new>
+#include <utility>
+
+namespace pip3D
+{
+
+    // Typed pool of count objects in one block allocated up front. Slots
+    // are recycled through an intrusive free list, so acquire() and
+    // release() never touch the heap and never move live objects.
+    template <typename T>
+    class FixedPool
+    {
+    private:
+        union Slot
+        {
+            Slot *next;
+            alignas(T) uint8_t storage[sizeof(T)];
+        };
+
+        Slot *slots;
+        Slot *freeList;
+        uint16_t capacity;
+        uint16_t used;
+        uint16_t highWater;
+
+    public:
+        FixedPool() : slots(nullptr), freeList(nullptr), capacity(0), used(0), highWater(0) {}
+
+        ~FixedPool()
+        {
+            release();
+        }
+
+        FixedPool(const FixedPool &) = delete;
+        FixedPool &operator=(const FixedPool &) = delete;
+
+        // Objects still acquired must have been destroyed before.
+        bool init(uint16_t count, MemPlacement placement,
+                  uint16_t owner = ::pip3D::Debug::LOG_MODULE_CORE)
+        {
+            release();
+            if (count == 0)
+                return true;
+
+            slots = static_cast<Slot *>(MemUtils::alloc(sizeof(Slot) * count, placement, owner,
+                                                         alignof(Slot) > 16 ? alignof(Slot) : 16));
+            if (!slots)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_CORE,
+                     "FixedPool::init: could not allocate %u x %u bytes",
+                     static_cast<unsigned int>(count),
+                     static_cast<unsigned int>(sizeof(Slot)));
+                return false;
+            }
+            capacity = count;
+            for (uint16_t i = 0; i < count; ++i)
+                slots[i].next = i + 1 < count ? &slots[i + 1] : nullptr;
+            freeList = slots;
+            return true;
+        }
+
+        void release()
+        {
+            if (unlikely(used != 0))
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_CORE,
+                     "FixedPool::release: %u objects still acquired",
+                     static_cast<unsigned int>(used));
+            }
+            MemUtils::freeData(slots);
+            slots = nullptr;
+            freeList = nullptr;
+            capacity = 0;
+            used = 0;
+        }
+
+        // Constructs an object in a free slot; nullptr when the pool is full.
+        template <typename... Args>
+        T *acquire(Args &&...args)
+        {
+            if (unlikely(!freeList))
+                return nullptr;
+            Slot *slot = freeList;
+            freeList = slot->next;
+            if (++used > highWater)
+                highWater = used;
+            return new (slot->storage) T(std::forward<Args>(args)...);
+        }
+
+        void destroy(T *obj)
+        {
+            if (!obj)
+                return;
+            obj->~T();
+            Slot *slot = reinterpret_cast<Slot *>(obj);
+            slot->next = freeList;
+            freeList = slot;
+            --used;
+        }
+
+        bool owns(const T *obj) const
+        {
+            const Slot *slot = reinterpret_cast<const Slot *>(obj);
+            return slots && slot >= slots && slot < slots + capacity;
+        }
+
+        bool full() const { return freeList == nullptr; }
+        uint16_t getCapacity() const { return capacity; }
+        uint16_t getUsed() const { return used; }
+        uint16_t getHighWater() const { return highWater; }
+    };
+
+}
+
+#endif
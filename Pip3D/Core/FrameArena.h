@@ -0,0 +1,180 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include "Core.h"
+#include "Debug/Logging.h"
+#include <new>
+
+namespace pip3D
+{
+
+    // Bump allocator for per-frame and per-step scratch data. Everything handed out stays
+    // valid until the next reset(); the arena itself never frees pieces.
+    class FrameArena
+    {
+    private:
+        uint8_t *base;
+        size_t capacity;
+        size_t offset;
+        size_t highWater;
+        bool owned;
+
+        void releaseOwned()
+        {
+            if (owned)
+                MemUtils::freeData(base);
+            base = nullptr;
+            capacity = 0;
+            offset = 0;
+            owned = false;
+        }
+
+    public:
+        FrameArena() : base(nullptr), capacity(0), offset(0), highWater(0), owned(false) {}
+
+        ~FrameArena()
+        {
+            releaseOwned();
+        }
+
+        FrameArena(const FrameArena &) = delete;
+        FrameArena &operator=(const FrameArena &) = delete;
+
+        // Allocates the backing store, charged to module in MemUtils stats.
+        bool init(size_t bytes, MemPlacement placement = MEM_INTERNAL,
+                  uint16_t module = ::pip3D::Debug::LOG_MODULE_CORE)
+        {
+            releaseOwned();
+            if (bytes == 0)
+                return true;
+
+            base = static_cast<uint8_t *>(MemUtils::alloc(bytes, placement, module));
+            if (!base)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_CORE,
+                     "FrameArena::init: could not allocate %u bytes",
+                     static_cast<unsigned int>(bytes));
+                return false;
+            }
+            capacity = bytes;
+            owned = true;
+            return true;
+        }
+
+        // Uses caller-owned memory; it must outlive the arena.
+        void attach(void *memory, size_t bytes)
+        {
+            releaseOwned();
+            base = static_cast<uint8_t *>(memory);
+            capacity = memory ? bytes : 0;
+        }
+
+        void reset()
+        {
+            offset = 0;
+        }
+
+        // Returns nullptr when the request does not fit.
+        void *alloc(size_t size, size_t align = alignof(max_align_t))
+        {
+            const uintptr_t start = reinterpret_cast<uintptr_t>(base) + offset;
+            const size_t pad = (align - (start & (align - 1))) & (align - 1);
+            if (!base || pad + size > capacity - offset)
+                return nullptr;
+
+            void *ptr = base + offset + pad;
+            offset += pad + size;
+            if (offset > highWater)
+                highWater = offset;
+            return ptr;
+        }
+
+        template <typename T>
+        T *allocArray(size_t count)
+        {
+            if (count == 0)
+                return nullptr;
+            T *ptr = static_cast<T *>(alloc(count * sizeof(T), alignof(T)));
+            if (!ptr)
+                return nullptr;
+            for (size_t i = 0; i < count; ++i)
+                new (ptr + i) T();
+            return ptr;
+        }
+
+        // Upper bound of what allocArray<T>(count) consumes.
+        template <typename T>
+        static constexpr size_t arraySize(size_t count)
+        {
+            return count * sizeof(T) + alignof(T) - 1;
+        }
+
+        size_t getCapacity() const { return capacity; }
+        size_t getUsed() const { return offset; }
+        size_t getHighWater() const { return highWater; }
+        bool isOwned() const { return owned; }
+    };
+
+    // Fixed-capacity array over arena memory with the subset of the
+    // std::vector interface the scratch code uses. Elements must be
+    // trivially destructible; nothing is freed.
+    template <typename T>
+    class ArenaArray
+    {
+    private:
+        T *items;
+        size_t count;
+        size_t cap;
+
+    public:
+        ArenaArray() : items(nullptr), count(0), cap(0) {}
+
+        void bind(T *storage, size_t capacity)
+        {
+            items = storage;
+            cap = storage ? capacity : 0;
+            count = 0;
+        }
+
+        bool bind(FrameArena &arena, size_t capacity)
+        {
+            bind(arena.allocArray<T>(capacity), capacity);
+            return capacity == 0 || items != nullptr;
+        }
+
+        __attribute__((always_inline)) inline T &operator[](size_t i) { return items[i]; }
+        __attribute__((always_inline)) inline const T &operator[](size_t i) const { return items[i]; }
+
+        T *data() { return items; }
+        const T *data() const { return items; }
+        size_t size() const { return count; }
+        size_t capacity() const { return cap; }
+        bool empty() const { return count == 0; }
+        void clear() { count = 0; }
+
+        T &back() { return items[count - 1]; }
+
+        bool push_back(const T &value)
+        {
+            if (unlikely(count >= cap))
+                return false;
+            items[count++] = value;
+            return true;
+        }
+
+        void resize(size_t n)
+        {
+            count = n <= cap ? n : cap;
+        }
+
+        void assign(size_t n, const T &value)
+        {
+            resize(n);
+            for (size_t i = 0; i < count; ++i)
+                items[i] = value;
+        }
+    };
+
+}
+
+#endif
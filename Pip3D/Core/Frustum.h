@@ -128,6 +128,28 @@ namespace pip3D
             return true;
         }
 
+        // Same test, starting at the plane that rejected this sphere last
+        // time; a rejection records its plane there. Objects that stay out
+        // of view usually stay out past the same plane, so they cost one
+        // plane test instead of up to six.
+        __attribute__((always_inline)) inline bool testSphereCoherent(const Vector3 &center, float radius, uint8_t &lastPlane) const
+        {
+            const uint8_t first = lastPlane < 6 ? lastPlane : 0;
+            if (unlikely(planes[first].distanceToPoint(center) < -radius))
+                return false;
+            for (uint8_t i = 0; i < 6; ++i)
+            {
+                if (i == first)
+                    continue;
+                if (unlikely(planes[i].distanceToPoint(center) < -radius))
+                {
+                    lastPlane = i;
+                    return false;
+                }
+            }
+            return true;
+        }
+
         CullingResult testSphereDetailed(const Vector3 &center, float radius) const
         {
             int insideCount = 0;
@@ -181,6 +203,44 @@ namespace pip3D
             return true;
         }
 
+        // CULLED if any plane rejects the box, VISIBLE if every plane keeps
+        // it whole, PARTIAL otherwise.
+        CullingResult classifyAABB(const Vector3 &min, const Vector3 &max) const
+        {
+            uint8_t lastPlane = 0;
+            return classifyAABB(min, max, lastPlane);
+        }
+
+        // As above, testing lastPlane first and recording the rejecting
+        // plane there (see testSphereCoherent).
+        CullingResult classifyAABB(const Vector3 &min, const Vector3 &max, uint8_t &lastPlane) const
+        {
+            const uint8_t first = lastPlane < 6 ? lastPlane : 0;
+            bool inside = true;
+            for (uint8_t k = 0; k < 6; ++k)
+            {
+                // k == 0 visits the remembered plane, k == first visits plane 0.
+                const uint8_t i = k == 0 ? first : (k == first ? 0 : k);
+                const FrustumPlane &pl = planes[i];
+                const Vector3 p(
+                    pl.n.x > 0 ? max.x : min.x,
+                    pl.n.y > 0 ? max.y : min.y,
+                    pl.n.z > 0 ? max.z : min.z);
+                if (unlikely(pl.distanceToPoint(p) < 0))
+                {
+                    lastPlane = i;
+                    return CULLED;
+                }
+                const Vector3 q(
+                    pl.n.x > 0 ? min.x : max.x,
+                    pl.n.y > 0 ? min.y : max.y,
+                    pl.n.z > 0 ? min.z : max.z);
+                if (pl.distanceToPoint(q) < 0)
+                    inside = false;
+            }
+            return inside ? VISIBLE : PARTIAL;
+        }
+
         __attribute__((always_inline)) inline bool testPoint(const Vector3 &p) const
         {
             return planes[NEAR].distanceToPoint(p) >= 0 &&
@@ -196,6 +256,7 @@ namespace pip3D
         void extract(const Matrix4x4 &vp) { extractFromViewProjection(vp); }
 
         bool sphere(const Vector3 &center, float radius) const { return testSphere(center, radius); }
+        bool sphere(const Vector3 &center, float radius, uint8_t &lastPlane) const { return testSphereCoherent(center, radius, lastPlane); }
         bool box(const Vector3 &min, const Vector3 &max) const { return testAABB(min, max); }
         bool point(const Vector3 &p) const { return testPoint(p); }
         CullingResult cull(const Vector3 &center, float radius) const { return testSphereDetailed(center, radius); }
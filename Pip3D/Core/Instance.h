@@ -2,30 +2,49 @@
 #define INSTANCE_H
 
 #include "../Math/Math.h"
+#include "../Math/Collision.h"
 #include "../Geometry/Mesh.h"
+#include "../Geometry/MeshLOD.h"
 #include "../Core/Debug/Logging.h"
 #include "Frustum.h"
+#include "InstanceBVH.h"
 #include <vector>
 #include <algorithm>
+#include <new>
 
 #ifndef likely
 #define likely(x) __builtin_expect(!!(x), 1)
 #define unlikely(x) __builtin_expect(!!(x), 0)
 #endif
 
+// Instances allocated together by InstanceManager.
+#ifndef PIP3D_INSTANCE_CHUNK_SIZE
+#define PIP3D_INSTANCE_CHUNK_SIZE 32
+#endif
+
+// drawInstances() keeps depth order when more meshes than this are visible.
+#ifndef PIP3D_INSTANCE_MAX_MESH_GROUPS
+#define PIP3D_INSTANCE_MAX_MESH_GROUPS 32
+#endif
+
 namespace pip3D
 {
 
+    class InstanceManager;
+
     class MeshInstance
     {
     private:
         Mesh *sourceMesh;
+        MeshLOD *lodChain;
+        uint8_t lodLevel;
         Matrix4x4 localTransform;
         Vector3 position;
         Quaternion rotation;
         Vector3 scale;
         Color instanceColor;
         bool visible;
+        bool occluder;
         bool transformDirty;
 
         mutable Vector3 cachedWorldCenter;
@@ -33,20 +52,48 @@ namespace pip3D
         mutable bool boundsDirty;
 
         size_t managerIndex;
+        InstanceManager *owner;
+        int32_t bvhLeaf;
+        bool bvhMoved;
+
+        // Unique across all instances, so caches keyed by address notice reuse.
+        uint32_t version;
+
+        // Temporal culling state: the frustum plane that rejected the
+        // instance last, and the renderer frame it was last drawn in.
+        uint8_t cullPlane;
+        uint32_t visibleFrame;
 
         friend class InstanceManager;
 
+        static uint32_t nextVersion()
+        {
+            static uint32_t counter = 0;
+            return ++counter;
+        }
+
+        void markTransformDirty();
+
     public:
         MeshInstance(Mesh *mesh = nullptr)
             : sourceMesh(mesh),
+              lodChain(nullptr),
+              lodLevel(0),
               position(0, 0, 0),
               rotation(),
               scale(1, 1, 1),
               instanceColor(Color::WHITE),
               visible(true),
+              occluder(false),
               transformDirty(true),
               boundsDirty(true),
-              managerIndex((size_t)-1)
+              managerIndex((size_t)-1),
+              owner(nullptr),
+              bvhLeaf(InstanceBVH::NULL_NODE),
+              bvhMoved(false),
+              version(nextVersion()),
+              cullPlane(0),
+              visibleFrame(0)
         {
             localTransform.identity();
         }
@@ -54,27 +101,67 @@ namespace pip3D
         void reset(Mesh *mesh)
         {
             sourceMesh = mesh;
+            lodChain = nullptr;
+            lodLevel = 0;
             position = Vector3(0, 0, 0);
             rotation = Quaternion();
             scale = Vector3(1, 1, 1);
             instanceColor = Color::WHITE;
             visible = true;
+            occluder = false;
             transformDirty = true;
             boundsDirty = true;
+            version = nextVersion();
+            cullPlane = 0;
+            visibleFrame = 0;
             localTransform.identity();
         }
 
         void setMesh(Mesh *mesh)
         {
             sourceMesh = mesh;
-            transformDirty = boundsDirty = true;
+            lodChain = nullptr;
+            lodLevel = 0;
+            markTransformDirty();
         }
         Mesh *getMesh() const { return sourceMesh; }
 
+        // Level 0 of the chain becomes the mesh used for bounds and picking;
+        // the renderer swaps in coarser levels by projected size.
+        void setLOD(MeshLOD *chain)
+        {
+            if (!chain || chain->numLevels() == 0)
+            {
+                lodChain = nullptr;
+                lodLevel = 0;
+                return;
+            }
+            lodChain = chain;
+            lodLevel = 0;
+            sourceMesh = chain->mesh(0);
+            markTransformDirty();
+        }
+        MeshLOD *getLOD() const { return lodChain; }
+        uint8_t getLODLevel() const { return lodLevel; }
+
+        // Picks the level for this radius with the chain's hysteresis.
+        void selectLOD(float radiusPixels)
+        {
+            if (lodChain)
+                lodLevel = lodChain->select(radiusPixels, lodLevel);
+        }
+        Mesh *lodMesh() const
+        {
+            return lodChain ? lodChain->mesh(lodLevel) : sourceMesh;
+        }
+
+        // Changes whenever the mesh or the transform does.
+        uint32_t transformVersion() const { return version; }
+
         void setPosition(const Vector3 &pos)
         {
             position = pos;
-            transformDirty = boundsDirty = true;
+            markTransformDirty();
         }
         void setPosition(float x, float y, float z)
         {
@@ -84,18 +171,18 @@ namespace pip3D
         void setRotation(const Quaternion &rot)
         {
             rotation = rot;
-            transformDirty = boundsDirty = true;
+            markTransformDirty();
         }
         void setEuler(float pitch, float yaw, float roll)
         {
             rotation = Quaternion::fromEuler(pitch * DEG2RAD, yaw * DEG2RAD, roll * DEG2RAD);
-            transformDirty = boundsDirty = true;
+            markTransformDirty();
         }
 
         void setScale(const Vector3 &scl)
         {
             scale = scl;
-            transformDirty = boundsDirty = true;
+            markTransformDirty();
         }
         void setScale(float uniform)
         {
@@ -109,8 +196,7 @@ namespace pip3D
         void rotate(const Quaternion &deltaRot)
         {
             rotation = rotation * deltaRot;
-            transformDirty = true;
-            boundsDirty = true;
+            markTransformDirty();
         }
 
         void setColor(const Color &c) { instanceColor = c; }
@@ -119,6 +205,16 @@ namespace pip3D
         void hide() { visible = false; }
         bool isVisible() const { return visible && sourceMesh; }
 
+        // Frame stamps come from Renderer; 0 means never drawn.
+        void markVisible(uint32_t frame) { visibleFrame = frame; }
+        bool wasVisibleSince(uint32_t frame) const { return visibleFrame != 0 && visibleFrame >= frame; }
+        uint8_t &frustumCullPlane() { return cullPlane; }
+
+        // Large occluders are drawn first by Renderer::drawInstances and are
+        // never occlusion-tested themselves.
+        void setOccluder(bool value) { occluder = value; }
+        bool isOccluder() const { return occluder; }
+
         void updateTransform()
         {
             if (!transformDirty)
@@ -233,11 +329,60 @@ namespace pip3D
         }
     };
 
+    // Instances live in fixed chunks that never move, so the pointers handed
+    // out stay valid and the ones walked by culling and sorting sit next to
+    // each other instead of across the heap. Chunks are charged to
+    // LOG_MODULE_SCENE; reserve() sets everything up front.
     class InstanceManager
     {
     private:
         std::vector<MeshInstance *> instances;
         std::vector<MeshInstance *> pool;
+        std::vector<MeshInstance *> chunks;
+
+        // Scratch of groupByMesh().
+        std::vector<const Mesh *> groupMeshes;
+        std::vector<uint16_t> groupOf;
+        std::vector<uint32_t> groupStart;
+        std::vector<MeshInstance *> grouped;
+
+        // Instances whose bounds changed since the last refreshBVH().
+        std::vector<MeshInstance *> moved;
+        InstanceBVH bvh;
+
+        friend class MeshInstance;
+
+        bool addChunk()
+        {
+            MeshInstance *chunk = static_cast<MeshInstance *>(
+                MemUtils::allocFast(sizeof(MeshInstance) * PIP3D_INSTANCE_CHUNK_SIZE, 16,
+                                    ::pip3D::Debug::LOG_MODULE_SCENE));
+            if (!chunk)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_SCENE,
+                     "InstanceManager: could not allocate a chunk of %u instances",
+                     static_cast<unsigned int>(PIP3D_INSTANCE_CHUNK_SIZE));
+                return false;
+            }
+            for (size_t i = 0; i < PIP3D_INSTANCE_CHUNK_SIZE; ++i)
+                new (chunk + i) MeshInstance();
+            chunks.push_back(chunk);
+            // Reversed so the chunk is handed out in address order.
+            pool.reserve(pool.size() + PIP3D_INSTANCE_CHUNK_SIZE);
+            for (size_t i = PIP3D_INSTANCE_CHUNK_SIZE; i-- > 0;)
+                pool.push_back(&chunk[i]);
+            return true;
+        }
+
+        void detach(MeshInstance *inst)
+        {
+            if (inst->bvhLeaf != InstanceBVH::NULL_NODE)
+                bvh.remove(inst->bvhLeaf);
+            inst->bvhLeaf = InstanceBVH::NULL_NODE;
+            inst->bvhMoved = false;
+            inst->owner = nullptr;
+            inst->managerIndex = (size_t)-1;
+        }
 
     public:
         InstanceManager()
@@ -251,37 +396,51 @@ namespace pip3D
 
         void destroyAll()
         {
-            for (auto *inst : instances)
-            {
-                delete inst;
-            }
             instances.clear();
+            moved.clear();
+            bvh.clear();
+            pool.clear();
 
-            for (auto *inst : pool)
+            for (auto *chunk : chunks)
             {
-                delete inst;
+                for (size_t i = 0; i < PIP3D_INSTANCE_CHUNK_SIZE; ++i)
+                    chunk[i].~MeshInstance();
+                MemUtils::freeData(chunk);
             }
-            pool.clear();
+            chunks.clear();
 
             instances.shrink_to_fit();
             pool.shrink_to_fit();
+            chunks.shrink_to_fit();
         }
 
-        MeshInstance *create(Mesh *mesh)
+        // Grows the chunks and bookkeeping to hold count instances, so
+        // create() and remove() stay off the heap until that is exceeded.
+        bool reserve(size_t count)
         {
-            MeshInstance *inst;
-            if (!pool.empty())
-            {
-                inst = pool.back();
-                pool.pop_back();
-                inst->reset(mesh);
-            }
-            else
+            while (instances.size() + pool.size() < count)
             {
-                inst = new MeshInstance(mesh);
+                if (!addChunk())
+                    return false;
             }
+            instances.reserve(count);
+            moved.reserve(count);
+            return true;
+        }
+
+        MeshInstance *create(Mesh *mesh)
+        {
+            if (pool.empty() && !addChunk())
+                return nullptr;
+
+            MeshInstance *inst = pool.back();
+            pool.pop_back();
+            inst->reset(mesh);
             inst->managerIndex = instances.size();
+            inst->owner = this;
             instances.push_back(inst);
+            inst->bvhMoved = true;
+            moved.push_back(inst);
             return inst;
         }
 
@@ -289,10 +448,14 @@ namespace pip3D
         {
             std::vector<MeshInstance *> result;
             result.reserve(count);
+            reserve(instances.size() + count);
 
             for (size_t i = 0; i < count; i++)
             {
-                result.push_back(create(mesh));
+                MeshInstance *inst = create(mesh);
+                if (!inst)
+                    break;
+                result.push_back(inst);
             }
 
             return result;
@@ -333,7 +496,16 @@ namespace pip3D
             instances[index] = last;
             last->managerIndex = index;
             instances.pop_back();
-            inst->managerIndex = (size_t)-1;
+            if (inst->bvhMoved)
+            {
+                auto it = std::find(moved.begin(), moved.end(), inst);
+                if (it != moved.end())
+                {
+                    *it = moved.back();
+                    moved.pop_back();
+                }
+            }
+            detach(inst);
             pool.push_back(inst);
         }
 
@@ -342,27 +514,95 @@ namespace pip3D
             return instances;
         }
 
-        void cull(const Frustum &frustum, std::vector<MeshInstance *> &result) const
+        // Brings the BVH up to date with instances moved since the last
+        // call. Leaves are reinserted only when an instance leaves its fat
+        // bounds; called implicitly by cull() and raycast().
+        void refreshBVH()
         {
-            result.clear();
-
-            for (auto *inst : instances)
+            for (auto *inst : moved)
             {
-                if (likely(inst->isVisible() && frustum.sphere(inst->center(), inst->radius())))
+                if (!inst->bvhMoved)
+                    continue;
+                inst->bvhMoved = false;
+
+                if (unlikely(!inst->sourceMesh))
                 {
-                    result.push_back(inst);
+                    if (inst->bvhLeaf != InstanceBVH::NULL_NODE)
+                        bvh.remove(inst->bvhLeaf);
+                    inst->bvhLeaf = InstanceBVH::NULL_NODE;
+                    continue;
                 }
+
+                const Vector3 c = inst->center();
+                const float r = inst->radius();
+                if (inst->bvhLeaf == InstanceBVH::NULL_NODE)
+                    inst->bvhLeaf = bvh.insert(inst, c, r);
+                else
+                    inst->bvhLeaf = bvh.update(inst->bvhLeaf, c, r);
             }
+            moved.clear();
+        }
+
+        // Result order follows the tree; use cullOrdered() for depth order.
+        void cull(const Frustum &frustum, std::vector<MeshInstance *> &result)
+        {
+            cullOrdered(frustum, Vector3(0, 0, 0), result);
+        }
+
+        // Hierarchical cull through the BVH. Result is roughly front to back
+        // as seen from eye; subtrees fully inside the frustum skip the
+        // per-instance sphere test.
+        void cullOrdered(const Frustum &frustum, const Vector3 &eye, std::vector<MeshInstance *> &result)
+        {
+            result.clear();
+            refreshBVH();
+
+            bvh.cull(frustum, eye,
+                     [&frustum, &result](MeshInstance *inst, bool fullyInside)
+                     {
+                         if (unlikely(!inst->isVisible()))
+                             return;
+                         if (fullyInside || frustum.sphere(inst->center(), inst->radius(), inst->cullPlane))
+                             result.push_back(inst);
+                     });
+        }
+
+        // Nearest visible instance whose bounding sphere the ray hits within
+        // maxDistance, or nullptr.
+        MeshInstance *raycast(const Ray &ray, float maxDistance, float &outDistance)
+        {
+            refreshBVH();
+
+            MeshInstance *best = nullptr;
+            float bestT = maxDistance;
+            bvh.raycast(ray, maxDistance,
+                        [&ray, &best, &bestT](MeshInstance *inst, float &limit)
+                        {
+                            if (!inst->isVisible())
+                                return;
+                            float t;
+                            if (ray.intersects(CollisionSphere(inst->center(), inst->radius()), t) && t < limit)
+                            {
+                                limit = t;
+                                bestT = t;
+                                best = inst;
+                            }
+                        });
+            if (best)
+                outDistance = bestT;
+            return best;
         }
 
         void clear()
         {
             for (auto *inst : instances)
             {
-                inst->managerIndex = (size_t)-1;
+                detach(inst);
                 pool.push_back(inst);
             }
             instances.clear();
+            moved.clear();
+            bvh.clear();
         }
 
         void hideAll()
@@ -392,10 +632,52 @@ namespace pip3D
         MeshInstance *spawn(Mesh *mesh, float x, float y, float z)
         {
             MeshInstance *inst = create(mesh);
-            inst->at(x, y, z);
+            if (inst)
+                inst->at(x, y, z);
             return inst;
         }
 
+        // Stable reorder of insts[first..last) into runs sharing a mesh (the
+        // LOD level drawn last), runs ordered by their nearest member when
+        // the input is front to back. Leaves the order alone past
+        // PIP3D_INSTANCE_MAX_MESH_GROUPS distinct meshes.
+        void groupByMesh(std::vector<MeshInstance *> &insts, size_t first = 0, size_t last = (size_t)-1)
+        {
+            const size_t n = last < insts.size() ? last : insts.size();
+            if (first >= n || n - first < 2)
+                return;
+
+            groupMeshes.clear();
+            groupOf.resize(n);
+            for (size_t i = first; i < n; ++i)
+            {
+                const Mesh *mesh = insts[i]->lodMesh();
+                size_t g = 0;
+                while (g < groupMeshes.size() && groupMeshes[g] != mesh)
+                    ++g;
+                if (g == groupMeshes.size())
+                {
+                    if (groupMeshes.size() >= PIP3D_INSTANCE_MAX_MESH_GROUPS)
+                        return;
+                    groupMeshes.push_back(mesh);
+                }
+                groupOf[i] = static_cast<uint16_t>(g);
+            }
+            if (groupMeshes.size() < 2)
+                return;
+
+            groupStart.assign(groupMeshes.size() + 1, 0);
+            for (size_t i = first; i < n; ++i)
+                ++groupStart[groupOf[i] + 1];
+            for (size_t g = 1; g < groupStart.size(); ++g)
+                groupStart[g] += groupStart[g - 1];
+
+            grouped.resize(n - first);
+            for (size_t i = first; i < n; ++i)
+                grouped[groupStart[groupOf[i]]++] = insts[i];
+            std::copy(grouped.begin(), grouped.end(), insts.begin() + first);
+        }
+
         void sort(const Vector3 &cameraPos, std::vector<MeshInstance *> &insts)
         {
             std::sort(insts.begin(), insts.end(),
@@ -410,6 +692,17 @@ namespace pip3D
         size_t count() const { return instances.size(); }
     };
 
+    inline void MeshInstance::markTransformDirty()
+    {
+        transformDirty = boundsDirty = true;
+        version = nextVersion();
+        if (owner && !bvhMoved)
+        {
+            bvhMoved = true;
+            owner->moved.push_back(this);
+        }
+    }
+
 }
 
 #endif
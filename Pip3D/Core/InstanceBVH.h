@@ -0,0 +1,408 @@
+#ifndef INSTANCEBVH_H
+#define INSTANCEBVH_H
+
+#include "../Math/Math.h"
+#include "../Math/Collision.h"
+#include "Frustum.h"
+#include <vector>
+#include <stdint.h>
+
+// Fat AABB margin as a fraction of the instance radius, so small motions
+// do not touch the tree.
+#ifndef PIP3D_BVH_FAT_MARGIN
+#define PIP3D_BVH_FAT_MARGIN 0.25f
+#endif
+
+namespace pip3D
+{
+
+    class MeshInstance;
+
+    // Dynamic AABB tree over mesh instances. Leaves hold fat bounds and
+    // are reinserted only when an instance leaves them; inserts pick the
+    // cheapest sibling by surface area and keep the tree balanced with
+    // AVL-style rotations.
+    class InstanceBVH
+    {
+    public:
+        static constexpr int32_t NULL_NODE = -1;
+
+    private:
+        struct Node
+        {
+            AABB box;
+            MeshInstance *instance;
+            int32_t parent;
+            int32_t child1;
+            int32_t child2;
+            int32_t height;
+            // Frustum plane that last rejected this node, tested first.
+            uint8_t cullPlane;
+
+            __attribute__((always_inline)) inline bool isLeaf() const { return child1 == NULL_NODE; }
+        };
+
+        struct StackEntry
+        {
+            int32_t node;
+            bool inside;
+        };
+
+        std::vector<Node> nodes;
+        int32_t root;
+        int32_t freeList;
+        size_t leafCount;
+        std::vector<StackEntry> stack;
+
+        static float area(const AABB &b)
+        {
+            const Vector3 d = b.max - b.min;
+            return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+
+        static AABB combine(const AABB &a, const AABB &b)
+        {
+            AABB r = a;
+            r.merge(b);
+            return r;
+        }
+
+        static bool containsBox(const AABB &outer, const AABB &inner)
+        {
+            return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+                   inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+        }
+
+        int32_t allocateNode()
+        {
+            int32_t id;
+            if (freeList != NULL_NODE)
+            {
+                id = freeList;
+                freeList = nodes[id].parent;
+            }
+            else
+            {
+                id = static_cast<int32_t>(nodes.size());
+                nodes.push_back(Node());
+            }
+            Node &n = nodes[id];
+            n.instance = nullptr;
+            n.parent = NULL_NODE;
+            n.child1 = NULL_NODE;
+            n.child2 = NULL_NODE;
+            n.height = 0;
+            n.cullPlane = 0;
+            return id;
+        }
+
+        void freeNode(int32_t id)
+        {
+            nodes[id].parent = freeList;
+            nodes[id].height = -1;
+            freeList = id;
+        }
+
+        void insertLeaf(int32_t leaf)
+        {
+            if (root == NULL_NODE)
+            {
+                root = leaf;
+                nodes[root].parent = NULL_NODE;
+                return;
+            }
+
+            const AABB leafBox = nodes[leaf].box;
+            int32_t index = root;
+            while (!nodes[index].isLeaf())
+            {
+                const Node &n = nodes[index];
+                const float a = area(n.box);
+                const float combinedArea = area(combine(n.box, leafBox));
+                const float cost = 2.0f * combinedArea;
+                const float inheritance = 2.0f * (combinedArea - a);
+
+                float cost1 = area(combine(leafBox, nodes[n.child1].box)) + inheritance;
+                if (!nodes[n.child1].isLeaf())
+                    cost1 -= area(nodes[n.child1].box);
+                float cost2 = area(combine(leafBox, nodes[n.child2].box)) + inheritance;
+                if (!nodes[n.child2].isLeaf())
+                    cost2 -= area(nodes[n.child2].box);
+
+                if (cost < cost1 && cost < cost2)
+                    break;
+                index = cost1 < cost2 ? n.child1 : n.child2;
+            }
+
+            const int32_t sibling = index;
+            const int32_t oldParent = nodes[sibling].parent;
+            const int32_t newParent = allocateNode();
+            nodes[newParent].parent = oldParent;
+            nodes[newParent].box = combine(leafBox, nodes[sibling].box);
+            nodes[newParent].height = nodes[sibling].height + 1;
+            nodes[newParent].child1 = sibling;
+            nodes[newParent].child2 = leaf;
+            nodes[sibling].parent = newParent;
+            nodes[leaf].parent = newParent;
+
+            if (oldParent != NULL_NODE)
+            {
+                if (nodes[oldParent].child1 == sibling)
+                    nodes[oldParent].child1 = newParent;
+                else
+                    nodes[oldParent].child2 = newParent;
+            }
+            else
+            {
+                root = newParent;
+            }
+
+            refit(nodes[leaf].parent);
+        }
+
+        void removeLeaf(int32_t leaf)
+        {
+            if (leaf == root)
+            {
+                root = NULL_NODE;
+                return;
+            }
+
+            const int32_t parent = nodes[leaf].parent;
+            const int32_t grandParent = nodes[parent].parent;
+            const int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+            if (grandParent != NULL_NODE)
+            {
+                if (nodes[grandParent].child1 == parent)
+                    nodes[grandParent].child1 = sibling;
+                else
+                    nodes[grandParent].child2 = sibling;
+                nodes[sibling].parent = grandParent;
+                freeNode(parent);
+                refit(grandParent);
+            }
+            else
+            {
+                root = sibling;
+                nodes[sibling].parent = NULL_NODE;
+                freeNode(parent);
+            }
+        }
+
+        void refit(int32_t index)
+        {
+            while (index != NULL_NODE)
+            {
+                index = balance(index);
+                Node &n = nodes[index];
+                n.height = 1 + (nodes[n.child1].height > nodes[n.child2].height ? nodes[n.child1].height : nodes[n.child2].height);
+                n.box = combine(nodes[n.child1].box, nodes[n.child2].box);
+                index = n.parent;
+            }
+        }
+
+        // Rotates the taller grandchild up when the children of a differ
+        // in height by more than one; returns the subtree's new root.
+        int32_t balance(int32_t a)
+        {
+            Node &A = nodes[a];
+            if (A.isLeaf() || A.height < 2)
+                return a;
+
+            const int32_t b = A.child1;
+            const int32_t c = A.child2;
+            const int32_t diff = nodes[c].height - nodes[b].height;
+
+            if (diff > 1)
+                return rotateUp(a, c, b);
+            if (diff < -1)
+                return rotateUp(a, b, c);
+            return a;
+        }
+
+        // Promotes child 'up' of a above a; 'other' stays under a.
+        int32_t rotateUp(int32_t a, int32_t up, int32_t other)
+        {
+            Node &A = nodes[a];
+            Node &U = nodes[up];
+            const int32_t f = U.child1;
+            const int32_t g = U.child2;
+
+            U.child1 = a;
+            U.parent = A.parent;
+            A.parent = up;
+
+            if (U.parent != NULL_NODE)
+            {
+                if (nodes[U.parent].child1 == a)
+                    nodes[U.parent].child1 = up;
+                else
+                    nodes[U.parent].child2 = up;
+            }
+            else
+            {
+                root = up;
+            }
+
+            // Keep the taller grandchild under 'up', hand the other to a.
+            int32_t keep = f;
+            int32_t give = g;
+            if (nodes[f].height < nodes[g].height)
+            {
+                keep = g;
+                give = f;
+            }
+
+            U.child2 = keep;
+            if (A.child1 == up)
+                A.child1 = give;
+            else
+                A.child2 = give;
+            nodes[give].parent = a;
+
+            A.box = combine(nodes[other].box, nodes[give].box);
+            A.height = 1 + (nodes[other].height > nodes[give].height ? nodes[other].height : nodes[give].height);
+            U.box = combine(A.box, nodes[keep].box);
+            U.height = 1 + (A.height > nodes[keep].height ? A.height : nodes[keep].height);
+            return up;
+        }
+
+    public:
+        InstanceBVH() : root(NULL_NODE), freeList(NULL_NODE), leafCount(0) {}
+
+        void clear()
+        {
+            nodes.clear();
+            root = NULL_NODE;
+            freeList = NULL_NODE;
+            leafCount = 0;
+        }
+
+        static AABB fatten(const Vector3 &center, float radius)
+        {
+            const float r = radius * (1.0f + PIP3D_BVH_FAT_MARGIN);
+            return AABB(Vector3(center.x - r, center.y - r, center.z - r),
+                        Vector3(center.x + r, center.y + r, center.z + r));
+        }
+
+        int32_t insert(MeshInstance *instance, const Vector3 &center, float radius)
+        {
+            const int32_t leaf = allocateNode();
+            nodes[leaf].box = fatten(center, radius);
+            nodes[leaf].instance = instance;
+            insertLeaf(leaf);
+            ++leafCount;
+            return leaf;
+        }
+
+        void remove(int32_t leaf)
+        {
+            if (leaf < 0 || leaf >= static_cast<int32_t>(nodes.size()) || !nodes[leaf].isLeaf())
+                return;
+            removeLeaf(leaf);
+            freeNode(leaf);
+            --leafCount;
+        }
+
+        // Refreshes a leaf after its instance moved. Returns the leaf id,
+        // which changes only when the instance left its fat bounds.
+        int32_t update(int32_t leaf, const Vector3 &center, float radius)
+        {
+            const AABB tight(Vector3(center.x - radius, center.y - radius, center.z - radius),
+                             Vector3(center.x + radius, center.y + radius, center.z + radius));
+            if (containsBox(nodes[leaf].box, tight))
+                return leaf;
+
+            MeshInstance *instance = nodes[leaf].instance;
+            remove(leaf);
+            return insert(instance, center, radius);
+        }
+
+        size_t size() const { return leafCount; }
+
+        int32_t height() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+
+        // Calls visit(instance, fullyInside) for every leaf whose fat bounds
+        // touch the frustum. Nearer children are walked first, which yields
+        // an approximate front-to-back order. fullyInside means the frustum
+        // holds the leaf whole, so its own test can be skipped.
+        template <typename Visit>
+        void cull(const Frustum &frustum, const Vector3 &eye, Visit visit)
+        {
+            if (root == NULL_NODE)
+                return;
+
+            stack.clear();
+            stack.push_back({root, false});
+            while (!stack.empty())
+            {
+                const StackEntry e = stack.back();
+                stack.pop_back();
+                Node &n = nodes[e.node];
+
+                bool inside = e.inside;
+                if (!inside)
+                {
+                    const CullingResult r = frustum.classifyAABB(n.box.min, n.box.max, n.cullPlane);
+                    if (r == CULLED)
+                        continue;
+                    inside = (r == VISIBLE);
+                }
+
+                if (n.isLeaf())
+                {
+                    visit(n.instance, inside);
+                    continue;
+                }
+
+                const float d1 = (nodes[n.child1].box.center() - eye).lengthSquared();
+                const float d2 = (nodes[n.child2].box.center() - eye).lengthSquared();
+                if (d1 <= d2)
+                {
+                    stack.push_back({n.child2, inside});
+                    stack.push_back({n.child1, inside});
+                }
+                else
+                {
+                    stack.push_back({n.child1, inside});
+                    stack.push_back({n.child2, inside});
+                }
+            }
+        }
+
+        // Calls hit(instance, maxDistance) for leaves whose bounds the ray
+        // enters before maxDistance; hit may shrink maxDistance to prune.
+        template <typename Hit>
+        void raycast(const Ray &ray, float maxDistance, Hit hit)
+        {
+            if (root == NULL_NODE)
+                return;
+
+            stack.clear();
+            stack.push_back({root, false});
+            while (!stack.empty())
+            {
+                const int32_t id = stack.back().node;
+                stack.pop_back();
+                const Node &n = nodes[id];
+
+                float tMin, tMax;
+                if (!ray.intersects(n.box, tMin, tMax) || tMax < 0.0f || tMin > maxDistance)
+                    continue;
+
+                if (n.isLeaf())
+                {
+                    hit(n.instance, maxDistance);
+                    continue;
+                }
+
+                stack.push_back({n.child1, false});
+                stack.push_back({n.child2, false});
+            }
+        }
+    };
+
+}
+
+#endif
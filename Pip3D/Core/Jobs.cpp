@@ -1,70 +1,62 @@
 #include "Jobs.h"
 
+#if defined(PIP3D_HOST) && !defined(ARDUINO_ARCH_ESP32)
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#endif
+
 namespace pip3D
 {
-#ifdef ARDUINO_ARCH_ESP32
-
-    static constexpr int MAX_JOBS = 32;
+    namespace
+    {
+        struct ParallelForChunk
+        {
+            ParallelForFunc func;
+            void *userData;
+            uint32_t begin;
+            uint32_t end;
+        };
 
-    static Job s_jobQueue[MAX_JOBS];
-    static volatile int s_head = 0;
-    static volatile int s_tail = 0;
+        void parallelForChunkFunc(void *userData)
+        {
+            ParallelForChunk *chunk = static_cast<ParallelForChunk *>(userData);
+            chunk->func(chunk->begin, chunk->end, chunk->userData);
+        }
+    }
 
-    static TaskHandle_t s_workerTask = nullptr;
-    static SemaphoreHandle_t s_queueMutex = nullptr;
-    static SemaphoreHandle_t s_jobSemaphore = nullptr;
+#if defined(ARDUINO_ARCH_ESP32) || defined(PIP3D_HOST)
 
-    static bool s_initialized = false;
-    static bool s_enabled = false;
+    static constexpr uint32_t MAX_JOBS = PIP3D_JOB_QUEUE_SIZE;
+    static constexpr uint32_t JOB_MASK = MAX_JOBS - 1;
 
-    static inline bool queueEmpty()
+    // Bounded MPMC ring: each slot's sequence tells producers and consumers
+    // whose turn it is, so neither side needs a lock.
+    struct JobSlot
     {
-        return s_head == s_tail;
-    }
+        std::atomic<uint32_t> sequence;
+        Job job;
+    };
 
-    static inline bool queueFull()
-    {
-        int nextHead = s_head + 1;
-        if (nextHead >= MAX_JOBS)
-            nextHead = 0;
-        return nextHead == s_tail;
-    }
+    static JobSlot s_jobQueue[MAX_JOBS];
+    static std::atomic<uint32_t> s_enqueuePos(0);
+    static std::atomic<uint32_t> s_dequeuePos(0);
+    static std::atomic<bool> s_workerIdle(false);
 
-    bool JobSystem::init()
-    {
-#if CONFIG_FREERTOS_UNICORE
-        s_enabled = false;
-        LOGW(::pip3D::Debug::LOG_MODULE_CORE,
-             "JobSystem disabled: FreeRTOS unicore configuration");
-        return false;
-#else
-        if (s_initialized)
-        {
-            s_enabled = true;
-            return true;
-        }
+    static bool s_initialized = false;
+    static bool s_enabled = false;
 
-        s_queueMutex = xSemaphoreCreateMutex();
-        if (!s_queueMutex)
-        {
-            LOGE(::pip3D::Debug::LOG_MODULE_CORE,
-                 "JobSystem::init failed: could not create queue mutex");
-            return false;
-        }
+#ifdef ARDUINO_ARCH_ESP32
 
-        s_jobSemaphore = xSemaphoreCreateCounting(MAX_JOBS, 0);
-        if (!s_jobSemaphore)
-        {
-            vSemaphoreDelete(s_queueMutex);
-            s_queueMutex = nullptr;
-            LOGE(::pip3D::Debug::LOG_MODULE_CORE,
-                 "JobSystem::init failed: could not create job semaphore");
-            return false;
-        }
+    static TaskHandle_t s_workerTask = nullptr;
 
+    static bool startWorker(JobFunc loop)
+    {
         const uint32_t STACK_SIZE = 4096;
         BaseType_t res = xTaskCreatePinnedToCore(
-            JobSystem::workerLoop,
+            loop,
             "Pip3DJobWorker",
             STACK_SIZE,
             nullptr,
@@ -74,53 +66,241 @@ namespace pip3D
 
         if (res != pdPASS)
         {
-            vSemaphoreDelete(s_queueMutex);
-            vSemaphoreDelete(s_jobSemaphore);
-            s_queueMutex = nullptr;
-            s_jobSemaphore = nullptr;
             s_workerTask = nullptr;
             LOGE(::pip3D::Debug::LOG_MODULE_CORE,
                  "JobSystem::init failed: xTaskCreatePinnedToCore returned %d",
                  (int)res);
             return false;
         }
+        return true;
+    }
 
-        s_head = 0;
-        s_tail = 0;
-        s_initialized = true;
-        s_enabled = true;
+    static void stopWorker()
+    {
+        if (s_workerTask)
+        {
+            vTaskDelete(s_workerTask);
+            s_workerTask = nullptr;
+        }
+    }
+
+    static inline void wakeWorker()
+    {
+        xTaskNotifyGive(s_workerTask);
+    }
+
+    // Returns false when the worker should exit; the task never does.
+    static inline bool sleepWorker(bool idle)
+    {
+        if (idle)
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        else
+            vTaskDelay(1);
         return true;
     }
+
+    static inline bool onWorker()
+    {
+        return s_workerTask && xTaskGetCurrentTaskHandle() == s_workerTask;
+    }
+
+#else
+
+    // Host builds: a thread stands in for the core 0 task and a condition
+    // variable for its task notification.
+    static std::thread s_workerThread;
+    static thread_local bool s_onWorkerThread = false;
+    static std::mutex s_wakeLock;
+    static std::condition_variable s_wakeSignal;
+    static bool s_wakePending = false;
+    static bool s_stopWorker = false;
+    static bool s_exitHookSet = false;
+
+    static void stopWorker()
+    {
+        if (!s_workerThread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(s_wakeLock);
+            s_stopWorker = true;
+        }
+        s_wakeSignal.notify_one();
+        s_workerThread.join();
+    }
+
+    // Programs returning from main() without useDualCore(false) would
+    // otherwise leave a running thread to static teardown.
+    static void stopWorkerAtExit()
+    {
+        s_enabled = false;
+        if (s_onWorkerThread)
+            s_workerThread.detach();
+        else
+            stopWorker();
+    }
+
+    static bool startWorker(JobFunc loop)
+    {
+        s_stopWorker = false;
+        s_wakePending = false;
+        s_workerThread = std::thread([loop]
+                                     {
+                                         s_onWorkerThread = true;
+                                         loop(nullptr); });
+        // Statics built before the worker started outlive it.
+        if (!s_exitHookSet)
+            s_exitHookSet = std::atexit(stopWorkerAtExit) == 0;
+        return true;
+    }
+
+    static inline void wakeWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(s_wakeLock);
+            s_wakePending = true;
+        }
+        s_wakeSignal.notify_one();
+    }
+
+    static inline bool sleepWorker(bool idle)
+    {
+        std::unique_lock<std::mutex> lock(s_wakeLock);
+        if (idle)
+            s_wakeSignal.wait(lock, []
+                              { return s_wakePending || s_stopWorker; });
+        else
+            s_wakeSignal.wait_for(lock, std::chrono::milliseconds(1), []
+                                  { return s_stopWorker; });
+        s_wakePending = false;
+        return !s_stopWorker;
+    }
+
+    static inline bool onWorker()
+    {
+        return s_onWorkerThread;
+    }
+
 #endif
 
-        void JobSystem::shutdown()
+    static void resetQueue()
+    {
+        for (uint32_t i = 0; i < MAX_JOBS; ++i)
         {
-            s_enabled = false;
+            s_jobQueue[i].sequence.store(i, std::memory_order_relaxed);
+            s_jobQueue[i].job = {nullptr, nullptr, nullptr};
+        }
+        s_enqueuePos.store(0, std::memory_order_relaxed);
+        s_dequeuePos.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
 
-            if (s_workerTask)
+    static bool queuePush(const Job &job)
+    {
+        uint32_t pos = s_enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            JobSlot &slot = s_jobQueue[pos & JOB_MASK];
+            uint32_t seq = slot.sequence.load(std::memory_order_acquire);
+            int32_t diff = static_cast<int32_t>(seq - pos);
+            if (diff == 0)
             {
-                vTaskDelete(s_workerTask);
-                s_workerTask = nullptr;
+                if (s_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.job = job;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
             }
+            else
+            {
+                pos = s_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
 
-            if (s_queueMutex)
+    static bool queuePop(Job &out)
+    {
+        uint32_t pos = s_dequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            JobSlot &slot = s_jobQueue[pos & JOB_MASK];
+            uint32_t seq = slot.sequence.load(std::memory_order_acquire);
+            int32_t diff = static_cast<int32_t>(seq - (pos + 1));
+            if (diff == 0)
             {
-                vSemaphoreDelete(s_queueMutex);
-                s_queueMutex = nullptr;
+                if (s_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    out = slot.job;
+                    slot.sequence.store(pos + MAX_JOBS, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
             }
+            else
+            {
+                pos = s_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static inline void runJob(const Job &job)
+    {
+        if (job.func)
+            job.func(job.userData);
+        if (job.counter)
+            job.counter->pending.fetch_sub(1, std::memory_order_release);
+    }
 
-            if (s_jobSemaphore)
+    bool JobSystem::init()
+    {
+#if CONFIG_FREERTOS_UNICORE
+        s_enabled = false;
+        LOGW(::pip3D::Debug::LOG_MODULE_CORE,
+             "JobSystem disabled: FreeRTOS unicore configuration");
+        return false;
+#else
+        if (s_initialized)
+        {
+            s_enabled = true;
+            return true;
+        }
+
+        resetQueue();
+        s_workerIdle.store(false);
+
+        if (!startWorker(JobSystem::workerLoop))
+            return false;
+
+        s_initialized = true;
+        s_enabled = true;
+        return true;
+#endif
+    }
+
+        void JobSystem::shutdown()
+        {
+            s_enabled = false;
+            stopWorker();
+
+            // Finish whatever was queued so no counter is left waiting.
+            Job job;
+            while (queuePop(job))
             {
-                vSemaphoreDelete(s_jobSemaphore);
-                s_jobSemaphore = nullptr;
+                runJob(job);
             }
 
-            s_head = 0;
-            s_tail = 0;
+            resetQueue();
             s_initialized = false;
         }
 
-        bool JobSystem::submit(JobFunc func, void *userData)
+        bool JobSystem::submit(JobFunc func, void *userData, JobCounter *counter)
         {
             if (!s_initialized || !s_enabled || !func)
             {
@@ -132,41 +312,57 @@ namespace pip3D
                 return false;
             }
 
-            if (xSemaphoreTake(s_queueMutex, 0) != pdTRUE)
-            {
-                LOGW(::pip3D::Debug::LOG_MODULE_CORE,
-                     "JobSystem::submit could not acquire queue mutex");
-                return false;
-            }
+            if (counter)
+                counter->pending.fetch_add(1, std::memory_order_relaxed);
 
-            if (queueFull())
+            if (!queuePush({func, userData, counter}))
             {
-                xSemaphoreGive(s_queueMutex);
+                if (counter)
+                    counter->pending.fetch_sub(1, std::memory_order_relaxed);
                 LOGW(::pip3D::Debug::LOG_MODULE_CORE,
                      "JobSystem queue full, job rejected");
                 return false;
             }
 
-            int index = s_head;
-            s_jobQueue[index].func = func;
-            s_jobQueue[index].userData = userData;
-
-            int nextHead = index + 1;
-            if (nextHead >= MAX_JOBS)
-                nextHead = 0;
-            s_head = nextHead;
+            // Orders the push before the idle check; pairs with the fence
+            // in workerLoop() so one side always sees the other.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (s_workerIdle.load(std::memory_order_relaxed))
+                wakeWorker();
 
-            xSemaphoreGive(s_queueMutex);
-            xSemaphoreGive(s_jobSemaphore);
+            return true;
+        }
 
+        bool JobSystem::runPending()
+        {
+            Job job;
+            if (!queuePop(job))
+                return false;
+            runJob(job);
             return true;
         }
 
+        void JobSystem::wait(JobCounter &counter)
+        {
+            while (!counter.isDone())
+            {
+                if (!runPending())
+                {
+                    __sync_synchronize();
+                }
+            }
+        }
+
         bool JobSystem::isEnabled()
         {
             return s_enabled;
         }
 
+        bool JobSystem::isWorkerThread()
+        {
+            return onWorker();
+        }
+
         void JobSystem::workerLoop(void *param)
         {
             (void)param;
@@ -175,36 +371,28 @@ namespace pip3D
             {
                 if (!s_enabled)
                 {
-                    vTaskDelay(1);
+                    if (!sleepWorker(false))
+                        return;
                     continue;
                 }
 
-                if (xSemaphoreTake(s_jobSemaphore, portMAX_DELAY) != pdTRUE)
-                {
+                if (runPending())
                     continue;
-                }
 
-                Job job = {nullptr, nullptr};
-
-                if (xSemaphoreTake(s_queueMutex, portMAX_DELAY) == pdTRUE)
+                // Publish idle before the final check so a concurrent submit
+                // either sees the flag and notifies, or its job is found here.
+                s_workerIdle.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (runPending())
                 {
-                    if (!queueEmpty())
-                    {
-                        int index = s_tail;
-                        job = s_jobQueue[index];
-
-                        int nextTail = index + 1;
-                        if (nextTail >= MAX_JOBS)
-                            nextTail = 0;
-                        s_tail = nextTail;
-                    }
-                    xSemaphoreGive(s_queueMutex);
+                    s_workerIdle.store(false);
+                    continue;
                 }
 
-                if (job.func)
-                {
-                    job.func(job.userData);
-                }
+                const bool running = sleepWorker(true);
+                s_workerIdle.store(false);
+                if (!running)
+                    return;
             }
         }
 
@@ -223,19 +411,35 @@ namespace pip3D
         s_enabled = false;
     }
 
-    bool JobSystem::submit(JobFunc func, void *userData)
+    bool JobSystem::submit(JobFunc func, void *userData, JobCounter *counter)
     {
+        (void)counter;
         if (!func)
             return false;
         func(userData);
         return true;
     }
 
+    bool JobSystem::runPending()
+    {
+        return false;
+    }
+
+    void JobSystem::wait(JobCounter &counter)
+    {
+        (void)counter;
+    }
+
     bool JobSystem::isEnabled()
     {
         return s_enabled;
     }
 
+    bool JobSystem::isWorkerThread()
+    {
+        return false;
+    }
+
     void JobSystem::workerLoop(void *param)
     {
         (void)param;
@@ -243,6 +447,48 @@ namespace pip3D
 
 #endif
 
+        void JobSystem::parallelFor(uint32_t count, uint32_t minBatch, ParallelForFunc func, void *userData)
+        {
+            if (!func || count == 0)
+                return;
+
+            if (minBatch == 0)
+                minBatch = 1;
+
+            uint32_t chunkCount = (count + minBatch - 1) / minBatch;
+            if (chunkCount > PIP3D_JOB_PARALLEL_FOR_CHUNKS)
+                chunkCount = PIP3D_JOB_PARALLEL_FOR_CHUNKS;
+
+            if (chunkCount <= 1 || !isEnabled())
+            {
+                func(0, count, userData);
+                return;
+            }
+
+            ParallelForChunk chunks[PIP3D_JOB_PARALLEL_FOR_CHUNKS];
+            const uint32_t step = count / chunkCount;
+            const uint32_t extra = count % chunkCount;
+            uint32_t begin = 0;
+            for (uint32_t i = 0; i < chunkCount; ++i)
+            {
+                uint32_t size = step + (i < extra ? 1u : 0u);
+                chunks[i] = {func, userData, begin, begin + size};
+                begin += size;
+            }
+
+            // Chunk 0 runs here; the rest go to the queue and are picked up
+            // by whichever core gets to them first.
+            JobCounter counter;
+            for (uint32_t i = 1; i < chunkCount; ++i)
+            {
+                if (!submit(&parallelForChunkFunc, &chunks[i], &counter))
+                    parallelForChunkFunc(&chunks[i]);
+            }
+
+            parallelForChunkFunc(&chunks[0]);
+            wait(counter);
+        }
+
         void useDualCore(bool enabled)
         {
             if (enabled)
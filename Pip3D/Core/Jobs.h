@@ -2,21 +2,51 @@
 #define JOBS_H
 
 #include "Core.h"
+#include <atomic>
 
 #ifdef ARDUINO_ARCH_ESP32
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/semphr.h>
 #endif
 
+#ifndef PIP3D_JOB_QUEUE_SIZE
+#define PIP3D_JOB_QUEUE_SIZE 64
+#endif
+
+#ifndef PIP3D_JOB_PARALLEL_FOR_CHUNKS
+#define PIP3D_JOB_PARALLEL_FOR_CHUNKS 8
+#endif
+
+static_assert((PIP3D_JOB_QUEUE_SIZE & (PIP3D_JOB_QUEUE_SIZE - 1)) == 0,
+              "PIP3D_JOB_QUEUE_SIZE must be a power of two");
+
 namespace pip3D
 {
     typedef void (*JobFunc)(void *userData);
+    typedef void (*ParallelForFunc)(uint32_t begin, uint32_t end, void *userData);
+
+    // Number of unfinished jobs submitted against it. Pass it to submit()
+    // and join with JobSystem::wait().
+    struct JobCounter
+    {
+        std::atomic<int32_t> pending;
+
+        JobCounter() : pending(0) {}
+
+        JobCounter(const JobCounter &) = delete;
+        JobCounter &operator=(const JobCounter &) = delete;
+
+        bool isDone() const
+        {
+            return pending.load(std::memory_order_acquire) <= 0;
+        }
+    };
 
     struct Job
     {
         JobFunc func;
         void *userData;
+        JobCounter *counter;
     };
 
     class JobSystem
@@ -24,9 +54,25 @@ namespace pip3D
     public:
         static bool init();
         static void shutdown();
-        static bool submit(JobFunc func, void *userData = nullptr);
+        static bool submit(JobFunc func, void *userData = nullptr, JobCounter *counter = nullptr);
+
+        // Blocks until the counter drains, running queued jobs on the
+        // calling core meanwhile. Safe to call from inside a job.
+        static void wait(JobCounter &counter);
+
+        // Pops and runs one queued job on the calling core.
+        static bool runPending();
+
+        // Calls func over [0, count) split into batches of at least
+        // minBatch, shared between the calling core and the worker.
+        static void parallelFor(uint32_t count, uint32_t minBatch, ParallelForFunc func, void *userData = nullptr);
+
         static bool isEnabled();
 
+        // True inside jobs running on the worker task (not on the caller's
+        // core through wait() or parallelFor()).
+        static bool isWorkerThread();
+
     private:
         static void workerLoop(void *param);
     };
@@ -0,0 +1,851 @@
+#include "ResourceManager.h"
+#include "Jobs.h"
+
+namespace pip3D
+{
+
+    ResourceManager::Resource ResourceManager::resources[MAX_RESOURCES];
+    int16_t ResourceManager::buckets[PIP3D_RESOURCE_HASH_BUCKETS];
+    int16_t ResourceManager::freeHead = -1;
+    int16_t ResourceManager::lruHead = -1;
+    int16_t ResourceManager::lruTail = -1;
+    int ResourceManager::resourceCount = 0;
+    size_t ResourceManager::totalMemory = 0;
+    size_t ResourceManager::maxMemory = 1024 * 1024;
+    uint32_t ResourceManager::requestCounter = 0;
+    ResourceReader ResourceManager::reader = {nullptr, nullptr, nullptr, nullptr};
+    bool ResourceManager::hasReader = false;
+    ResourceManager::Stream ResourceManager::stream;
+
+    namespace
+    {
+        constexpr uint32_t HASH_MASK = PIP3D_RESOURCE_HASH_BUCKETS - 1;
+        bool s_tableReady = false;
+
+#ifdef ARDUINO_ARCH_ESP32
+        void *fsOpen(const char *path, size_t &size, void *userData)
+        {
+            fs::FS *fileSystem = static_cast<fs::FS *>(userData);
+            fs::File file = fileSystem->open(path, "r");
+            if (!file || file.isDirectory())
+                return nullptr;
+            size = file.size();
+            return new fs::File(file);
+        }
+
+        size_t fsRead(void *handle, uint8_t *dst, size_t offset, size_t bytes, void *userData)
+        {
+            (void)userData;
+            fs::File *file = static_cast<fs::File *>(handle);
+            if (file->position() != offset && !file->seek(offset))
+                return 0;
+            return file->read(dst, bytes);
+        }
+
+        void fsClose(void *handle, void *userData)
+        {
+            (void)userData;
+            fs::File *file = static_cast<fs::File *>(handle);
+            file->close();
+            delete file;
+        }
+#endif
+    }
+
+    void ResourceManager::init(size_t maxMem)
+    {
+        if (s_tableReady)
+            unloadAll();
+
+        maxMemory = maxMem;
+        totalMemory = 0;
+        resourceCount = 0;
+        requestCounter = 0;
+        lruHead = lruTail = -1;
+
+        for (int i = 0; i < PIP3D_RESOURCE_HASH_BUCKETS; ++i)
+            buckets[i] = -1;
+
+        // Free slots are chained through hashNext.
+        for (int i = 0; i < MAX_RESOURCES; ++i)
+        {
+            Resource &res = resources[i];
+            res.path[0] = '\0';
+            res.hash = 0;
+            res.data = nullptr;
+            res.size = 0;
+            res.refCount = 0;
+            res.lastAccess = 0;
+            res.requestOrder = 0;
+            res.type = RES_DATA;
+            res.state = RES_STATE_EMPTY;
+            res.priority = RES_PRIORITY_NORMAL;
+            res.hashNext = static_cast<int16_t>(i + 1 < MAX_RESOURCES ? i + 1 : -1);
+            res.lruPrev = res.lruNext = -1;
+            res.inLRU = false;
+        }
+        freeHead = 0;
+
+        stream.phase.store(STREAM_IDLE, std::memory_order_relaxed);
+        stream.cancel.store(false, std::memory_order_relaxed);
+        stream.slot = -1;
+        stream.file = nullptr;
+        stream.dst = nullptr;
+        stream.size = 0;
+        stream.offset = 0;
+        s_tableReady = true;
+
+        LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
+             "ResourceManager initialized, maxMem=%u bytes, maxResources=%d",
+             static_cast<unsigned int>(maxMemory),
+             MAX_RESOURCES);
+    }
+
+    void ResourceManager::setReader(const ResourceReader &r)
+    {
+        if (!r.open || !r.read || !r.close)
+        {
+            LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "ResourceManager::setReader: open, read and close are required");
+            return;
+        }
+        reader = r;
+        hasReader = true;
+    }
+
+    void ResourceManager::clearReader()
+    {
+        if (stream.phase.load(std::memory_order_acquire) != STREAM_IDLE)
+        {
+            LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "ResourceManager::clearReader ignored while a file is streaming");
+            return;
+        }
+        hasReader = false;
+    }
+
+#ifdef ARDUINO_ARCH_ESP32
+    void ResourceManager::setFileSystem(fs::FS &fileSystem)
+    {
+        setReader({&fsOpen, &fsRead, &fsClose, &fileSystem});
+    }
+#endif
+
+    uint32_t ResourceManager::hashPath(const char *path)
+    {
+        uint32_t hash = 2166136261u;
+        while (*path)
+        {
+            hash ^= static_cast<uint8_t>(*path++);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    int16_t ResourceManager::findSlot(const char *path, uint32_t hash)
+    {
+        for (int16_t i = buckets[hash & HASH_MASK]; i != -1; i = resources[i].hashNext)
+        {
+            if (resources[i].hash == hash && strcmp(resources[i].path, path) == 0)
+                return i;
+        }
+        return -1;
+    }
+
+    int16_t ResourceManager::allocSlot(const char *path, uint32_t hash, ResourceType type)
+    {
+        const size_t len = strlen(path);
+        if (len >= PATH_LENGTH)
+        {
+            LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "ResourceManager: path '%s' longer than %d characters",
+                 path, PATH_LENGTH - 1);
+            return -1;
+        }
+
+        if (freeHead == -1)
+        {
+            // Make room by dropping the least recently used cached entry.
+            if (lruHead != -1)
+            {
+                const int16_t victim = lruHead;
+                freeData(resources[victim]);
+                freeSlot(victim);
+            }
+            if (freeHead == -1)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "ResourceManager capacity exceeded while loading '%s' (MAX_RESOURCES=%d)",
+                     path, MAX_RESOURCES);
+                return -1;
+            }
+        }
+
+        const int16_t slot = freeHead;
+        Resource &res = resources[slot];
+        freeHead = res.hashNext;
+
+        memcpy(res.path, path, len + 1);
+        res.hash = hash;
+        res.data = nullptr;
+        res.size = 0;
+        res.refCount = 0;
+        res.lastAccess = millis();
+        res.requestOrder = 0;
+        res.type = type;
+        res.state = RES_STATE_QUEUED;
+        res.priority = RES_PRIORITY_NORMAL;
+        res.lruPrev = res.lruNext = -1;
+        res.inLRU = false;
+
+        res.hashNext = buckets[hash & HASH_MASK];
+        buckets[hash & HASH_MASK] = slot;
+        resourceCount++;
+        return slot;
+    }
+
+    void ResourceManager::freeSlot(int16_t slot)
+    {
+        Resource &res = resources[slot];
+        lruRemove(slot);
+
+        int16_t *link = &buckets[res.hash & HASH_MASK];
+        while (*link != -1 && *link != slot)
+            link = &resources[*link].hashNext;
+        if (*link == slot)
+            *link = res.hashNext;
+
+        res.state = RES_STATE_EMPTY;
+        res.path[0] = '\0';
+        res.refCount = 0;
+        res.hashNext = freeHead;
+        freeHead = slot;
+        resourceCount--;
+    }
+
+    void ResourceManager::lruPushBack(int16_t slot)
+    {
+        Resource &res = resources[slot];
+        if (res.inLRU)
+            return;
+        res.lruPrev = lruTail;
+        res.lruNext = -1;
+        if (lruTail != -1)
+            resources[lruTail].lruNext = slot;
+        else
+            lruHead = slot;
+        lruTail = slot;
+        res.inLRU = true;
+    }
+
+    void ResourceManager::lruRemove(int16_t slot)
+    {
+        Resource &res = resources[slot];
+        if (!res.inLRU)
+            return;
+        if (res.lruPrev != -1)
+            resources[res.lruPrev].lruNext = res.lruNext;
+        else
+            lruHead = res.lruNext;
+        if (res.lruNext != -1)
+            resources[res.lruNext].lruPrev = res.lruPrev;
+        else
+            lruTail = res.lruPrev;
+        res.lruPrev = res.lruNext = -1;
+        res.inLRU = false;
+    }
+
+    void ResourceManager::freeData(Resource &res)
+    {
+        if (res.data)
+        {
+            MemUtils::freeAligned(res.data);
+            totalMemory -= res.size;
+        }
+        res.data = nullptr;
+        res.size = 0;
+    }
+
+    bool ResourceManager::reserve(size_t bytes)
+    {
+        while (totalMemory + bytes > maxMemory && lruHead != -1)
+        {
+            const int16_t victim = lruHead;
+            LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "Evicting resource '%s' (size=%u bytes)",
+                 resources[victim].path,
+                 static_cast<unsigned int>(resources[victim].size));
+            freeData(resources[victim]);
+            freeSlot(victim);
+        }
+        if (totalMemory + bytes <= maxMemory)
+            return true;
+
+        LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+             "Not enough memory for resource (size=%u, used=%u, max=%u)",
+             static_cast<unsigned int>(bytes),
+             static_cast<unsigned int>(totalMemory),
+             static_cast<unsigned int>(maxMemory));
+        EventSystem::emit(EVENT_MEMORY_LOW, nullptr);
+        return false;
+    }
+
+    void ResourceManager::emitLoaded(const Resource &res)
+    {
+        EventType ev = EVENT_USER_CUSTOM;
+        if (res.type == RES_TEXTURE)
+            ev = EVENT_TEXTURE_LOADED;
+        else if (res.type == RES_MESH)
+            ev = EVENT_MESH_LOADED;
+        EventSystem::emit(ev, (void *)res.path);
+    }
+
+    void *ResourceManager::load(const char *path, ResourceType type, size_t size)
+    {
+        if (!path)
+        {
+            LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "ResourceManager::load called with null path (type=%d, size=%u)",
+                 static_cast<int>(type),
+                 static_cast<unsigned int>(size));
+            return nullptr;
+        }
+        if (!s_tableReady)
+            init(maxMemory);
+
+        const uint32_t hash = hashPath(path);
+        int16_t slot = findSlot(path, hash);
+
+        if (slot != -1 && resources[slot].state == RES_STATE_FAILED)
+        {
+            if (resources[slot].refCount > 0)
+                return nullptr;
+            freeSlot(slot);
+            slot = -1;
+        }
+
+        if (slot != -1)
+        {
+            Resource &res = resources[slot];
+            res.refCount++;
+            lruRemove(slot);
+
+            // Requested asynchronously earlier: finish it now.
+            if (res.state == RES_STATE_QUEUED || res.state == RES_STATE_LOADING)
+            {
+                res.priority = RES_PRIORITY_CRITICAL;
+                while (res.state == RES_STATE_QUEUED || res.state == RES_STATE_LOADING)
+                {
+                    update();
+                    if (JobSystem::isEnabled())
+                        JobSystem::runPending();
+                }
+                if (res.state != RES_STATE_READY)
+                    return nullptr;
+            }
+
+            res.lastAccess = millis();
+            LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "Resource '%s' already loaded, refCount=%u", path,
+                 static_cast<unsigned int>(res.refCount));
+            return res.data;
+        }
+
+        slot = allocSlot(path, hash, type);
+        if (slot == -1)
+            return nullptr;
+        Resource &res = resources[slot];
+        res.state = RES_STATE_LOADING;
+
+        void *file = nullptr;
+        size_t fileSize = 0;
+        if (hasReader)
+            file = reader.open(path, fileSize, reader.userData);
+
+        const size_t bytes = file ? fileSize : size;
+        if (bytes == 0)
+        {
+            LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "ResourceManager::load: '%s' %s",
+                 path, file ? "is empty" : (hasReader ? "not found" : "has no size and no reader is set"));
+            if (file)
+                reader.close(file, reader.userData);
+            freeSlot(slot);
+            return nullptr;
+        }
+
+        uint8_t *data = reserve(bytes) ? static_cast<uint8_t *>(MemUtils::allocAligned(bytes)) : nullptr;
+        if (!data)
+        {
+            LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "MemUtils::allocAligned failed for resource '%s' (size=%u)",
+                 path,
+                 static_cast<unsigned int>(bytes));
+            if (file)
+                reader.close(file, reader.userData);
+            freeSlot(slot);
+            return nullptr;
+        }
+
+        if (file)
+        {
+            size_t offset = 0;
+            while (offset < bytes)
+            {
+                const size_t got = reader.read(file, data + offset, offset, bytes - offset, reader.userData);
+                if (got == 0)
+                    break;
+                offset += got;
+            }
+            reader.close(file, reader.userData);
+            if (offset < bytes)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "ResourceManager::load: short read on '%s' (%u of %u bytes)",
+                     path,
+                     static_cast<unsigned int>(offset),
+                     static_cast<unsigned int>(bytes));
+                MemUtils::freeAligned(data);
+                freeSlot(slot);
+                return nullptr;
+            }
+        }
+        else
+        {
+            memset(data, 0, bytes);
+        }
+
+        res.data = data;
+        res.size = bytes;
+        res.refCount = 1;
+        res.state = RES_STATE_READY;
+        totalMemory += bytes;
+
+        LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
+             "Loaded resource '%s' (type=%d, size=%u bytes, totalMemory=%u/%u)",
+             path,
+             static_cast<int>(type),
+             static_cast<unsigned int>(bytes),
+             static_cast<unsigned int>(totalMemory),
+             static_cast<unsigned int>(maxMemory));
+
+        emitLoaded(res);
+        return data;
+    }
+
+    ResourceHandle ResourceManager::loadAsync(const char *path, ResourceType type, ResourcePriority priority)
+    {
+        if (!path)
+        {
+            LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "ResourceManager::loadAsync called with null path");
+            return INVALID_RESOURCE;
+        }
+        if (!s_tableReady)
+            init(maxMemory);
+
+        const uint32_t hash = hashPath(path);
+        int16_t slot = findSlot(path, hash);
+        if (slot != -1)
+        {
+            Resource &res = resources[slot];
+            res.refCount++;
+            lruRemove(slot);
+            res.lastAccess = millis();
+            if (res.state == RES_STATE_QUEUED && priority > res.priority)
+                res.priority = priority;
+            if (res.state == RES_STATE_FAILED && hasReader)
+            {
+                res.state = RES_STATE_QUEUED;
+                res.priority = priority;
+                res.requestOrder = ++requestCounter;
+            }
+        }
+        else
+        {
+            if (!hasReader)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "ResourceManager::loadAsync('%s'): no reader set", path);
+                return INVALID_RESOURCE;
+            }
+            slot = allocSlot(path, hash, type);
+            if (slot == -1)
+                return INVALID_RESOURCE;
+            Resource &res = resources[slot];
+            res.refCount = 1;
+            res.priority = priority;
+            res.requestOrder = ++requestCounter;
+        }
+
+        if (stream.phase.load(std::memory_order_acquire) == STREAM_IDLE)
+            startNextStream();
+        return slot;
+    }
+
+    void ResourceManager::setPriority(ResourceHandle handle, ResourcePriority priority)
+    {
+        if (valid(handle) && resources[handle].state == RES_STATE_QUEUED)
+            resources[handle].priority = priority;
+    }
+
+    ResourceHandle ResourceManager::find(const char *path)
+    {
+        if (!path || !s_tableReady)
+            return INVALID_RESOURCE;
+        return findSlot(path, hashPath(path));
+    }
+
+    ResourceState ResourceManager::getState(ResourceHandle handle)
+    {
+        return valid(handle) ? resources[handle].state : RES_STATE_EMPTY;
+    }
+
+    void *ResourceManager::getData(ResourceHandle handle)
+    {
+        if (!valid(handle) || resources[handle].state != RES_STATE_READY)
+            return nullptr;
+        resources[handle].lastAccess = millis();
+        return resources[handle].data;
+    }
+
+    size_t ResourceManager::getSize(ResourceHandle handle)
+    {
+        return valid(handle) && resources[handle].state == RES_STATE_READY ? resources[handle].size : 0;
+    }
+
+    const char *ResourceManager::getPath(ResourceHandle handle)
+    {
+        return valid(handle) ? resources[handle].path : nullptr;
+    }
+
+    void ResourceManager::release(ResourceHandle handle)
+    {
+        if (!valid(handle))
+        {
+            LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "ResourceManager::release: invalid handle %d", static_cast<int>(handle));
+            return;
+        }
+
+        Resource &res = resources[handle];
+        if (res.refCount > 0 && --res.refCount > 0)
+        {
+            LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "Decreased refCount for resource '%s' to %u",
+                 res.path,
+                 static_cast<unsigned int>(res.refCount));
+            return;
+        }
+
+        switch (res.state)
+        {
+        case RES_STATE_READY:
+            lruPushBack(handle);
+            break;
+        case RES_STATE_LOADING:
+            // finishStream() drops it once the worker lets go of the buffer.
+            stream.cancel.store(true, std::memory_order_release);
+            break;
+        default:
+            freeData(res);
+            freeSlot(handle);
+            break;
+        }
+    }
+
+    void ResourceManager::unload(const char *path)
+    {
+        const ResourceHandle handle = find(path);
+        if (handle == INVALID_RESOURCE)
+        {
+            LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "Attempt to unload unknown resource '%s'", path ? path : "<null>");
+            return;
+        }
+        release(handle);
+    }
+
+    void ResourceManager::unloadAll()
+    {
+        if (!s_tableReady)
+            return;
+
+        if (stream.phase.load(std::memory_order_acquire) != STREAM_IDLE)
+        {
+            stream.cancel.store(true, std::memory_order_release);
+            for (;;)
+            {
+                const uint8_t phase = stream.phase.load(std::memory_order_acquire);
+                if (phase != STREAM_OPENING && phase != STREAM_READING)
+                    break;
+                // With the job system on, only the worker may advance it.
+                if (!JobSystem::isEnabled())
+                    stepStream();
+                else
+                    JobSystem::runPending();
+            }
+            finishStream(false);
+        }
+
+        for (int i = 0; i < MAX_RESOURCES; ++i)
+        {
+            if (resources[i].state != RES_STATE_EMPTY)
+            {
+                freeData(resources[i]);
+                freeSlot(static_cast<int16_t>(i));
+            }
+        }
+        totalMemory = 0;
+
+        LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
+             "All resources unloaded, memory usage reset to 0");
+    }
+
+    void ResourceManager::trim()
+    {
+        while (lruHead != -1)
+        {
+            const int16_t victim = lruHead;
+            freeData(resources[victim]);
+            freeSlot(victim);
+        }
+    }
+
+    int ResourceManager::getPendingCount()
+    {
+        int pending = 0;
+        for (int i = 0; i < MAX_RESOURCES; ++i)
+        {
+            if (resources[i].state == RES_STATE_QUEUED || resources[i].state == RES_STATE_LOADING)
+                pending++;
+        }
+        return pending;
+    }
+
+    void ResourceManager::startNextStream()
+    {
+        if (!hasReader)
+            return;
+
+        int16_t best = -1;
+        for (int16_t i = 0; i < MAX_RESOURCES; ++i)
+        {
+            const Resource &res = resources[i];
+            if (res.state != RES_STATE_QUEUED)
+                continue;
+            if (best == -1 || res.priority > resources[best].priority ||
+                (res.priority == resources[best].priority &&
+                 static_cast<int32_t>(res.requestOrder - resources[best].requestOrder) < 0))
+                best = i;
+        }
+        if (best == -1)
+            return;
+
+        resources[best].state = RES_STATE_LOADING;
+        stream.slot = best;
+        stream.file = nullptr;
+        stream.dst = nullptr;
+        stream.size = 0;
+        stream.offset = 0;
+        stream.cancel.store(false, std::memory_order_relaxed);
+        stream.phase.store(STREAM_OPENING, std::memory_order_release);
+        submitStream();
+    }
+
+    bool ResourceManager::submitStream()
+    {
+        if (!JobSystem::isEnabled())
+            return false;
+        if (JobSystem::submit(&ResourceManager::streamJob, nullptr))
+            return true;
+        stream.phase.store(STREAM_STALLED, std::memory_order_release);
+        return false;
+    }
+
+    // One bounded step of the active stream: the open, or one chunk.
+    void ResourceManager::stepStream()
+    {
+        const uint8_t phase = stream.phase.load(std::memory_order_acquire);
+        if (stream.cancel.load(std::memory_order_acquire))
+        {
+            stream.phase.store(STREAM_FAILED, std::memory_order_release);
+            return;
+        }
+
+        if (phase == STREAM_OPENING)
+        {
+            size_t size = 0;
+            void *file = reader.open(resources[stream.slot].path, size, reader.userData);
+            stream.file = file;
+            stream.size = size;
+            stream.phase.store(file && size > 0 ? STREAM_OPENED : STREAM_FAILED, std::memory_order_release);
+            return;
+        }
+
+        if (phase == STREAM_READING)
+        {
+            size_t bytes = stream.size - stream.offset;
+            if (bytes > PIP3D_RESOURCE_CHUNK_BYTES)
+                bytes = PIP3D_RESOURCE_CHUNK_BYTES;
+            const size_t got = reader.read(stream.file, stream.dst + stream.offset, stream.offset, bytes,
+                                           reader.userData);
+            if (got == 0)
+            {
+                stream.phase.store(STREAM_FAILED, std::memory_order_release);
+                return;
+            }
+            stream.offset += got;
+            stream.phase.store(stream.offset >= stream.size ? STREAM_DONE : STREAM_READING,
+                               std::memory_order_release);
+        }
+    }
+
+    void ResourceManager::streamJob(void *userData)
+    {
+        (void)userData;
+        stepStream();
+        // Each chunk is its own job so a core helping out in
+        // JobSystem::wait() is never stuck behind a whole file.
+        if (stream.phase.load(std::memory_order_acquire) == STREAM_READING)
+            submitStream();
+    }
+
+    void ResourceManager::finishStream(bool ok)
+    {
+        const int16_t slot = stream.slot;
+        if (stream.file)
+            reader.close(stream.file, reader.userData);
+
+        const bool cancelled = stream.cancel.load(std::memory_order_acquire);
+        stream.slot = -1;
+        stream.file = nullptr;
+        stream.dst = nullptr;
+        stream.cancel.store(false, std::memory_order_relaxed);
+        stream.phase.store(STREAM_IDLE, std::memory_order_release);
+
+        if (slot < 0)
+            return;
+        Resource &res = resources[slot];
+
+        if (ok)
+        {
+            res.state = RES_STATE_READY;
+            res.lastAccess = millis();
+            LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "Streamed resource '%s' (size=%u bytes, totalMemory=%u/%u)",
+                 res.path,
+                 static_cast<unsigned int>(res.size),
+                 static_cast<unsigned int>(totalMemory),
+                 static_cast<unsigned int>(maxMemory));
+            if (res.refCount > 0)
+                emitLoaded(res);
+            else
+                lruPushBack(slot);
+            return;
+        }
+
+        freeData(res);
+        if (res.refCount == 0)
+        {
+            freeSlot(slot);
+            return;
+        }
+        res.state = RES_STATE_FAILED;
+        if (!cancelled)
+        {
+            LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "ResourceManager: streaming '%s' failed", res.path);
+        }
+    }
+
+    void ResourceManager::update()
+    {
+        if (!s_tableReady)
+            return;
+
+        size_t inlineBytes = 0;
+        for (;;)
+        {
+            const uint8_t phase = stream.phase.load(std::memory_order_acquire);
+            switch (phase)
+            {
+            case STREAM_IDLE:
+            {
+                startNextStream();
+                if (stream.phase.load(std::memory_order_acquire) == STREAM_IDLE)
+                    return;
+                break;
+            }
+            case STREAM_OPENED:
+            {
+                Resource &res = resources[stream.slot];
+                if (stream.cancel.load(std::memory_order_acquire))
+                {
+                    finishStream(false);
+                    break;
+                }
+                uint8_t *data = reserve(stream.size)
+                                    ? static_cast<uint8_t *>(MemUtils::allocAligned(stream.size))
+                                    : nullptr;
+                if (!data)
+                {
+                    finishStream(false);
+                    break;
+                }
+                res.data = data;
+                res.size = stream.size;
+                totalMemory += stream.size;
+                stream.dst = data;
+                stream.offset = 0;
+                stream.phase.store(STREAM_READING, std::memory_order_release);
+                submitStream();
+                break;
+            }
+            case STREAM_STALLED:
+                stream.phase.store(stream.file ? STREAM_READING : STREAM_OPENING, std::memory_order_release);
+                submitStream();
+                return;
+            case STREAM_DONE:
+            case STREAM_FAILED:
+                finishStream(phase == STREAM_DONE);
+                break;
+            default:
+                // Opening or reading: the worker owns it, or with no job
+                // system it is advanced here within a fixed byte budget.
+                if (JobSystem::isEnabled() || inlineBytes >= PIP3D_RESOURCE_INLINE_BUDGET)
+                    return;
+                stepStream();
+                inlineBytes += PIP3D_RESOURCE_CHUNK_BYTES;
+                break;
+            }
+        }
+    }
+
+    void ResourceManager::printStatus()
+    {
+        LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
+             "Resources: %d/%d, Memory: %u/%u KB, pending=%d",
+             resourceCount,
+             MAX_RESOURCES,
+             static_cast<unsigned int>(totalMemory / 1024u),
+             static_cast<unsigned int>(maxMemory / 1024u),
+             getPendingCount());
+
+        for (int i = 0; i < MAX_RESOURCES; i++)
+        {
+            const Resource &res = resources[i];
+            if (res.state != RES_STATE_EMPTY)
+            {
+                LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "  %s: %u bytes, refs=%u, state=%u%s",
+                     res.path,
+                     static_cast<unsigned int>(res.size),
+                     static_cast<unsigned int>(res.refCount),
+                     static_cast<unsigned int>(res.state),
+                     res.inLRU ? " (cached)" : "");
+            }
+        }
+    }
+
+}
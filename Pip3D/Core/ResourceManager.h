@@ -0,0 +1,228 @@
+#ifndef RESOURCEMANAGER_H
+#define RESOURCEMANAGER_H
+
+#include "Core.h"
+#include "Debug/Logging.h"
+#include <atomic>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <FS.h>
+#endif
+
+#ifndef PIP3D_RESOURCE_MAX
+#define PIP3D_RESOURCE_MAX 64
+#endif
+
+#ifndef PIP3D_RESOURCE_PATH_LENGTH
+#define PIP3D_RESOURCE_PATH_LENGTH 48
+#endif
+
+// Buckets of the path index; a power of two.
+#ifndef PIP3D_RESOURCE_HASH_BUCKETS
+#define PIP3D_RESOURCE_HASH_BUCKETS 64
+#endif
+
+// Bytes read per streaming job. This bounds how long the render core can be
+// held up when it picks a read off the job queue while waiting on a band.
+#ifndef PIP3D_RESOURCE_CHUNK_BYTES
+#define PIP3D_RESOURCE_CHUNK_BYTES 4096
+#endif
+
+// Bytes update() reads inline per call when the job system is off.
+#ifndef PIP3D_RESOURCE_INLINE_BUDGET
+#define PIP3D_RESOURCE_INLINE_BUDGET 8192
+#endif
+
+static_assert((PIP3D_RESOURCE_HASH_BUCKETS & (PIP3D_RESOURCE_HASH_BUCKETS - 1)) == 0,
+              "PIP3D_RESOURCE_HASH_BUCKETS must be a power of two");
+static_assert(PIP3D_RESOURCE_MAX < 0x7FFF, "resource handles are 16-bit");
+
+namespace pip3D
+{
+
+    enum ResourceType
+    {
+        RES_TEXTURE = 0,
+        RES_MESH = 1,
+        RES_SOUND = 2,
+        RES_DATA = 3
+    };
+
+    enum ResourcePriority : uint8_t
+    {
+        RES_PRIORITY_LOW = 0,
+        RES_PRIORITY_NORMAL = 1,
+        RES_PRIORITY_HIGH = 2,
+        RES_PRIORITY_CRITICAL = 3
+    };
+
+    enum ResourceState : uint8_t
+    {
+        RES_STATE_EMPTY = 0,
+        RES_STATE_QUEUED,
+        RES_STATE_LOADING,
+        RES_STATE_READY,
+        RES_STATE_FAILED
+    };
+
+    typedef int16_t ResourceHandle;
+    static constexpr ResourceHandle INVALID_RESOURCE = -1;
+
+    // Where resource bytes come from. open() reports the size and returns a
+    // handle (nullptr on failure); read() fills dst with up to bytes bytes
+    // at offset and returns how many it got, 0 on error. open and read run
+    // on the job worker when it is enabled, so they must not call back into
+    // ResourceManager.
+    struct ResourceReader
+    {
+        void *(*open)(const char *path, size_t &size, void *userData);
+        size_t (*read)(void *file, uint8_t *dst, size_t offset, size_t bytes, void *userData);
+        void (*close)(void *file, void *userData);
+        void *userData;
+    };
+
+    // Reference-counted resource cache with a memory budget. Sync loads go
+    // through load(); loadAsync() queues a request that update() streams in
+    // on the job worker, highest priority first, and announces with
+    // EVENT_MESH_LOADED / EVENT_TEXTURE_LOADED / EVENT_USER_CUSTOM carrying
+    // the path. Unreferenced resources stay cached and are evicted least
+    // recently released first when the budget runs out.
+    //
+    // Everything except the reader callbacks must be called from one thread,
+    // normally the loop task that renders.
+    struct ResourceManager
+    {
+        static constexpr int MAX_RESOURCES = PIP3D_RESOURCE_MAX;
+        static constexpr int PATH_LENGTH = PIP3D_RESOURCE_PATH_LENGTH;
+
+        static void init(size_t maxMem = 1024 * 1024);
+
+        static void setReader(const ResourceReader &reader);
+        static void clearReader();
+#ifdef ARDUINO_ARCH_ESP32
+        // LittleFS, SPIFFS, SD, SD_MMC or any other fs::FS.
+        static void setFileSystem(fs::FS &fs);
+#endif
+
+        // Blocks until the resource is resident. Reads the file when a
+        // reader is set; otherwise, or when size is non-zero and no file is
+        // found, allocates size zeroed bytes for the caller to fill.
+        static void *load(const char *path, ResourceType type, size_t size = 0);
+
+        // Takes a reference and queues the file if it is not resident yet.
+        // A resource that is already ready is not announced again.
+        static ResourceHandle loadAsync(const char *path, ResourceType type,
+                                        ResourcePriority priority = RES_PRIORITY_NORMAL);
+
+        // Requeues a waiting request; has no effect once its read started.
+        static void setPriority(ResourceHandle handle, ResourcePriority priority);
+
+        static ResourceHandle find(const char *path);
+        static ResourceState getState(ResourceHandle handle);
+        static bool isReady(ResourceHandle handle) { return getState(handle) == RES_STATE_READY; }
+        static void *getData(ResourceHandle handle);
+        static size_t getSize(ResourceHandle handle);
+        static const char *getPath(ResourceHandle handle);
+
+        // Drops one reference. Unreferenced resources stay cached; pending
+        // requests are cancelled.
+        static void release(ResourceHandle handle);
+        static void unload(const char *path);
+        static void unloadAll();
+
+        // Frees every unreferenced resource now instead of on demand.
+        static void trim();
+
+        // Finishes completed reads, fires their events and starts the next
+        // request. Call once per frame.
+        static void update();
+
+        static size_t getMemoryUsage() { return totalMemory; }
+        static size_t getMaxMemory() { return maxMemory; }
+        static int getResourceCount() { return resourceCount; }
+        static int getPendingCount();
+        static void printStatus();
+
+    private:
+        struct Resource
+        {
+            char path[PATH_LENGTH];
+            uint32_t hash;
+            uint8_t *data;
+            size_t size;
+            uint32_t refCount;
+            uint32_t lastAccess;
+            uint32_t requestOrder;
+            ResourceType type;
+            ResourceState state;
+            ResourcePriority priority;
+            int16_t hashNext;
+            int16_t lruPrev;
+            int16_t lruNext;
+            bool inLRU;
+        };
+
+        enum StreamPhase : uint8_t
+        {
+            STREAM_IDLE = 0,
+            STREAM_OPENING,
+            STREAM_OPENED,
+            STREAM_READING,
+            STREAM_STALLED,
+            STREAM_DONE,
+            STREAM_FAILED
+        };
+
+        // The one file being streamed. Its fields are written by the worker
+        // and published through phase.
+        struct Stream
+        {
+            std::atomic<uint8_t> phase;
+            std::atomic<bool> cancel;
+            int16_t slot;
+            void *file;
+            uint8_t *dst;
+            size_t size;
+            size_t offset;
+        };
+
+        static Resource resources[MAX_RESOURCES];
+        static int16_t buckets[PIP3D_RESOURCE_HASH_BUCKETS];
+        static int16_t freeHead;
+        static int16_t lruHead;
+        static int16_t lruTail;
+        static int resourceCount;
+        static size_t totalMemory;
+        static size_t maxMemory;
+        static uint32_t requestCounter;
+        static ResourceReader reader;
+        static bool hasReader;
+        static Stream stream;
+
+        static uint32_t hashPath(const char *path);
+        static int16_t findSlot(const char *path, uint32_t hash);
+        static int16_t allocSlot(const char *path, uint32_t hash, ResourceType type);
+        static void freeSlot(int16_t slot);
+
+        static void lruPushBack(int16_t slot);
+        static void lruRemove(int16_t slot);
+        static bool reserve(size_t bytes);
+        static void freeData(Resource &res);
+
+        static void startNextStream();
+        static void finishStream(bool ok);
+        static void stepStream();
+        static bool submitStream();
+        static void emitLoaded(const Resource &res);
+
+        static void streamJob(void *userData);
+
+        static bool valid(ResourceHandle handle)
+        {
+            return handle >= 0 && handle < MAX_RESOURCES && resources[handle].state != RES_STATE_EMPTY;
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,449 @@
+#ifndef BAKEDMESH_H
+#define BAKEDMESH_H
+
+#include "Mesh.h"
+#include "MeshLOD.h"
+#include "../Core/Debug/Logging.h"
+#include <string.h>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_partition.h>
+#include <esp_idf_version.h>
+#endif
+
+#ifndef PIP3D_BAKED_MESH_PARTITION
+#define PIP3D_BAKED_MESH_PARTITION "meshes"
+#endif
+
+namespace pip3D
+{
+
+    // Binary layout written by tools/pip3d_bake.py. All fields are little
+    // endian and every stream starts on a 4-byte boundary, so the arrays can
+    // be used in place from memory-mapped flash.
+    //
+    //   pack:  BakedMeshPackHeader, BakedMeshPackEntry[count], mesh blobs
+    //   blob:  BakedMeshHeader, BakedMeshLevel[levelCount], streams
+    //
+    // Offsets in a pack entry are from the start of the pack; offsets in a
+    // level are from the start of its blob.
+    static constexpr uint32_t BAKED_MESH_PACK_MAGIC = 0x4B443350u; // "P3DK"
+    static constexpr uint32_t BAKED_MESH_MAGIC = 0x4D443350u;      // "P3DM"
+    static constexpr uint16_t BAKED_MESH_VERSION = 1;
+    static constexpr int BAKED_MESH_NAME_LENGTH = 24;
+
+    enum BakedMeshFlags : uint16_t
+    {
+        BAKED_MESH_FACE_NORMALS = 1u << 0
+    };
+
+    struct BakedMeshPackHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t count;
+    };
+
+    struct BakedMeshPackEntry
+    {
+        char name[BAKED_MESH_NAME_LENGTH];
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct BakedMeshHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t flags;
+        float qScale;
+        float center[3];
+        float radius;
+        uint16_t color565;
+        uint8_t levelCount;
+        uint8_t reserved;
+    };
+
+    struct BakedMeshLevel
+    {
+        uint16_t vertexCount;
+        uint16_t faceCount;
+        uint32_t vertexOffset;
+        uint32_t faceOffset;
+        uint32_t faceNormalOffset;
+        float switchPixels;
+    };
+
+    static_assert(sizeof(Vertex) == 8, "baked vertex stream expects 8-byte vertices");
+    static_assert(sizeof(Face) == 6, "baked face stream expects 6-byte faces");
+    static_assert(sizeof(BakedMeshPackEntry) == 32, "pack entry layout changed");
+    static_assert(sizeof(BakedMeshHeader) == 32, "baked header layout changed");
+    static_assert(sizeof(BakedMeshLevel) == 20, "baked level layout changed");
+
+    // Meshes over baked data. Only the Mesh objects live in RAM; vertices,
+    // faces and face normals are read from the mapped blob, which must stay
+    // mapped for as long as this object is in use.
+    class BakedMesh
+    {
+    private:
+        Mesh *levels[MeshLOD::MAX_LEVELS];
+        const PackedNormal *faceNormalStreams[MeshLOD::MAX_LEVELS];
+        MeshLOD lodChain;
+        uint8_t levelCount;
+
+        static bool inBlob(uint32_t offset, size_t bytes, size_t blobSize)
+        {
+            return (offset & 3u) == 0 && offset <= blobSize && bytes <= blobSize - offset;
+        }
+
+        // Index of the first face referencing a vertex past vertexCount, or
+        // faceCount if all are in range.
+        static uint32_t firstBadFace(const Face *faces, uint32_t faceCount, uint32_t vertexCount)
+        {
+            for (uint32_t f = 0; f < faceCount; ++f)
+            {
+                if (faces[f].v0 >= vertexCount || faces[f].v1 >= vertexCount || faces[f].v2 >= vertexCount)
+                    return f;
+            }
+            return faceCount;
+        }
+
+    public:
+        BakedMesh() : levelCount(0)
+        {
+            for (int i = 0; i < MeshLOD::MAX_LEVELS; ++i)
+            {
+                levels[i] = nullptr;
+                faceNormalStreams[i] = nullptr;
+            }
+        }
+
+        ~BakedMesh()
+        {
+            release();
+        }
+
+        BakedMesh(const BakedMesh &) = delete;
+        BakedMesh &operator=(const BakedMesh &) = delete;
+
+        bool load(const void *blob, size_t size)
+        {
+            release();
+
+            const uint8_t *base = static_cast<const uint8_t *>(blob);
+            BakedMeshHeader header;
+            if (!base || size < sizeof(header) || (reinterpret_cast<uintptr_t>(base) & 3u) != 0)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "BakedMesh::load: invalid blob (ptr=%p, size=%u)",
+                     blob, static_cast<unsigned int>(size));
+                return false;
+            }
+            memcpy(&header, base, sizeof(header));
+            if (header.magic != BAKED_MESH_MAGIC || header.version != BAKED_MESH_VERSION ||
+                header.levelCount == 0 || header.qScale <= 0.0f)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "BakedMesh::load: bad header (magic=0x%08x, version=%u, levels=%u)",
+                     static_cast<unsigned int>(header.magic),
+                     static_cast<unsigned int>(header.version),
+                     static_cast<unsigned int>(header.levelCount));
+                return false;
+            }
+            if (header.levelCount > MeshLOD::MAX_LEVELS)
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "BakedMesh::load: %u levels baked, only %u used (PIP3D_MESH_LOD_MAX_LEVELS)",
+                     static_cast<unsigned int>(header.levelCount),
+                     static_cast<unsigned int>(MeshLOD::MAX_LEVELS));
+            }
+            const size_t levelTable = sizeof(header) + header.levelCount * sizeof(BakedMeshLevel);
+            if (levelTable > size)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "BakedMesh::load: truncated level table (size=%u)",
+                     static_cast<unsigned int>(size));
+                return false;
+            }
+
+            const Vector3 center(header.center[0], header.center[1], header.center[2]);
+            const Color color(header.color565);
+            const uint8_t count = header.levelCount < MeshLOD::MAX_LEVELS
+                                      ? header.levelCount
+                                      : static_cast<uint8_t>(MeshLOD::MAX_LEVELS);
+            float previousSwitch = 0.0f;
+
+            for (uint8_t i = 0; i < count; ++i)
+            {
+                BakedMeshLevel level;
+                memcpy(&level, base + sizeof(header) + i * sizeof(BakedMeshLevel), sizeof(level));
+
+                const size_t vertexBytes = static_cast<size_t>(level.vertexCount) * sizeof(Vertex);
+                const size_t faceBytes = static_cast<size_t>(level.faceCount) * sizeof(Face);
+                const size_t normalBytes = static_cast<size_t>(level.faceCount) * sizeof(PackedNormal);
+                const bool hasFaceNormals = (header.flags & BAKED_MESH_FACE_NORMALS) != 0;
+                if (level.vertexCount == 0 || level.faceCount == 0 ||
+                    !inBlob(level.vertexOffset, vertexBytes, size) ||
+                    !inBlob(level.faceOffset, faceBytes, size) ||
+                    (hasFaceNormals && !inBlob(level.faceNormalOffset, normalBytes, size)))
+                {
+                    LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                         "BakedMesh::load: level %u streams out of range (vertices=%u, faces=%u, size=%u)",
+                         static_cast<unsigned int>(i),
+                         static_cast<unsigned int>(level.vertexCount),
+                         static_cast<unsigned int>(level.faceCount),
+                         static_cast<unsigned int>(size));
+                    release();
+                    return false;
+                }
+                const Face *faces = reinterpret_cast<const Face *>(base + level.faceOffset);
+                const uint32_t badFace = firstBadFace(faces, level.faceCount, level.vertexCount);
+                if (badFace != level.faceCount)
+                {
+                    LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                         "BakedMesh::load: level %u face %u indexes past %u vertices",
+                         static_cast<unsigned int>(i),
+                         static_cast<unsigned int>(badFace),
+                         static_cast<unsigned int>(level.vertexCount));
+                    release();
+                    return false;
+                }
+
+                Mesh *mesh = new Mesh(reinterpret_cast<const Vertex *>(base + level.vertexOffset),
+                                      level.vertexCount,
+                                      faces,
+                                      level.faceCount,
+                                      color,
+                                      true);
+                mesh->setQuantScale(header.qScale);
+                // Coarser levels are bounded by the same sphere, which keeps
+                // culling identical across a switch.
+                mesh->setBoundingSphere(center, header.radius);
+                if (hasFaceNormals)
+                    mesh->setFaceNormals(reinterpret_cast<const PackedNormal *>(base + level.faceNormalOffset));
+
+                levels[i] = mesh;
+                faceNormalStreams[i] = hasFaceNormals
+                                           ? reinterpret_cast<const PackedNormal *>(base + level.faceNormalOffset)
+                                           : nullptr;
+                lodChain.addLevel(mesh, previousSwitch);
+                previousSwitch = level.switchPixels;
+                levelCount = i + 1;
+            }
+
+            LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "BakedMesh loaded: %u vertices, %u faces, %u levels",
+                 static_cast<unsigned int>(levels[0]->numVertices()),
+                 static_cast<unsigned int>(levels[0]->numFaces()),
+                 static_cast<unsigned int>(levelCount));
+            return true;
+        }
+
+        void release()
+        {
+            lodChain.clear();
+            for (int i = 0; i < MeshLOD::MAX_LEVELS; ++i)
+            {
+                delete levels[i];
+                levels[i] = nullptr;
+                faceNormalStreams[i] = nullptr;
+            }
+            levelCount = 0;
+        }
+
+        bool isLoaded() const { return levelCount > 0; }
+        uint8_t numLevels() const { return levelCount; }
+        Mesh *mesh(uint8_t level = 0) const { return level < levelCount ? levels[level] : nullptr; }
+
+        // Chain over all baked levels, for MeshInstance::setLOD.
+        MeshLOD *lod() { return levelCount > 1 ? &lodChain : nullptr; }
+
+        // One normal per face of the given level, or nullptr when the mesh
+        // was baked without them.
+        const PackedNormal *faceNormals(uint8_t level = 0) const
+        {
+            return level < levelCount ? faceNormalStreams[level] : nullptr;
+        }
+    };
+
+    // Named set of baked meshes, normally a data partition written with
+    // parttool.py and mapped into the address space at boot.
+    class BakedMeshPack
+    {
+    private:
+        const uint8_t *data;
+        size_t size;
+        uint16_t count;
+#ifdef ARDUINO_ARCH_ESP32
+#if ESP_IDF_VERSION_MAJOR >= 5
+        esp_partition_mmap_handle_t mapHandle;
+#else
+        spi_flash_mmap_handle_t mapHandle;
+#endif
+        bool mapped;
+#endif
+
+        bool validate()
+        {
+            BakedMeshPackHeader header;
+            if (!data || size < sizeof(header))
+                return false;
+            memcpy(&header, data, sizeof(header));
+            if (header.magic != BAKED_MESH_PACK_MAGIC || header.version != BAKED_MESH_VERSION ||
+                sizeof(header) + static_cast<size_t>(header.count) * sizeof(BakedMeshPackEntry) > size)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "BakedMeshPack: bad header (magic=0x%08x, version=%u, size=%u)",
+                     static_cast<unsigned int>(header.magic),
+                     static_cast<unsigned int>(header.version),
+                     static_cast<unsigned int>(size));
+                return false;
+            }
+            count = header.count;
+            return true;
+        }
+
+    public:
+        BakedMeshPack() : data(nullptr), size(0), count(0)
+#ifdef ARDUINO_ARCH_ESP32
+                          ,
+                          mapHandle(0), mapped(false)
+#endif
+        {
+        }
+
+        ~BakedMeshPack()
+        {
+            unmap();
+        }
+
+        BakedMeshPack(const BakedMeshPack &) = delete;
+        BakedMeshPack &operator=(const BakedMeshPack &) = delete;
+
+        // Maps the whole data partition with this label. Meshes loaded from
+        // the pack cost no RAM beyond their Mesh objects.
+        bool map(const char *label = PIP3D_BAKED_MESH_PARTITION)
+        {
+            unmap();
+#ifdef ARDUINO_ARCH_ESP32
+            const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                                   ESP_PARTITION_SUBTYPE_ANY,
+                                                                   label);
+            if (!part)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "BakedMeshPack::map: partition '%s' not found", label ? label : "<null>");
+                return false;
+            }
+
+            const void *ptr = nullptr;
+#if ESP_IDF_VERSION_MAJOR >= 5
+            esp_err_t err = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &mapHandle);
+#else
+            esp_err_t err = esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &ptr, &mapHandle);
+#endif
+            if (err != ESP_OK)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "BakedMeshPack::map: esp_partition_mmap failed (err=%d, size=%u)",
+                     static_cast<int>(err),
+                     static_cast<unsigned int>(part->size));
+                return false;
+            }
+            mapped = true;
+            data = static_cast<const uint8_t *>(ptr);
+            size = part->size;
+            if (!validate())
+            {
+                unmap();
+                return false;
+            }
+            return true;
+#else
+            LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "BakedMeshPack::map('%s'): flash partitions need ESP32, use attach()",
+                 label ? label : "<null>");
+            return false;
+#endif
+        }
+
+        // Uses a pack that is already addressable, e.g. a const array
+        // generated with --header (which also stays in flash).
+        bool attach(const void *pack, size_t bytes)
+        {
+            unmap();
+            data = static_cast<const uint8_t *>(pack);
+            size = bytes;
+            if (!validate())
+            {
+                data = nullptr;
+                size = 0;
+                return false;
+            }
+            return true;
+        }
+
+        void unmap()
+        {
+#ifdef ARDUINO_ARCH_ESP32
+            if (mapped)
+            {
+#if ESP_IDF_VERSION_MAJOR >= 5
+                esp_partition_munmap(mapHandle);
+#else
+                spi_flash_munmap(mapHandle);
+#endif
+                mapped = false;
+            }
+#endif
+            data = nullptr;
+            size = 0;
+            count = 0;
+        }
+
+        bool isValid() const { return data != nullptr; }
+        uint16_t numMeshes() const { return count; }
+
+        bool entry(uint16_t index, BakedMeshPackEntry &out) const
+        {
+            if (index >= count)
+                return false;
+            memcpy(&out, data + sizeof(BakedMeshPackHeader) + index * sizeof(BakedMeshPackEntry), sizeof(out));
+            out.name[BAKED_MESH_NAME_LENGTH - 1] = '\0';
+            return out.offset <= size && out.size <= size - out.offset;
+        }
+
+        const void *find(const char *name, size_t &blobSize) const
+        {
+            BakedMeshPackEntry e;
+            for (uint16_t i = 0; name && i < count; ++i)
+            {
+                if (entry(i, e) && strncmp(e.name, name, BAKED_MESH_NAME_LENGTH) == 0)
+                {
+                    blobSize = e.size;
+                    return data + e.offset;
+                }
+            }
+            blobSize = 0;
+            return nullptr;
+        }
+
+        bool load(const char *name, BakedMesh &out) const
+        {
+            size_t blobSize = 0;
+            const void *blob = find(name, blobSize);
+            if (!blob)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "BakedMeshPack::load: mesh '%s' not in pack (meshes=%u)",
+                     name ? name : "<null>",
+                     static_cast<unsigned int>(count));
+                return false;
+            }
+            return out.load(blob, blobSize);
+        }
+    };
+
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include <esp_attr.h>
 #include <soc/cpu.h>
 #include <string.h>
+#include <algorithm>
 
 #define MESH_SIMD_ALIGN __attribute__((aligned(16)))
 #define MESH_FORCE_INLINE __attribute__((always_inline)) inline
@@ -14,6 +15,23 @@
 #define MESH_COLD_PATH __attribute__((cold))
 #define MESH_PURE __attribute__((pure))
 
+// finalizeNormals() also stores one packed normal per face (2 bytes each),
+// which lets the renderer cull back faces before the vertex stage.
+#ifndef PIP3D_MESH_FACE_NORMALS
+#define PIP3D_MESH_FACE_NORMALS 1
+#endif
+
+// Primitives reorder their faces and vertices at finalize() for vertex
+// reuse and top-to-bottom locality (Mesh::optimizeOrder).
+#ifndef PIP3D_MESH_OPTIMIZE_ORDER
+#define PIP3D_MESH_OPTIMIZE_ORDER 1
+#endif
+
+// FIFO length the face order is tuned for.
+#ifndef PIP3D_MESH_ORDER_CACHE
+#define PIP3D_MESH_ORDER_CACHE 24
+#endif
+
 static constexpr float INV_255 = 1.0f / 255.0f;
 static constexpr float SCALE_255 = 255.0f;
 static constexpr float EPSILON_SQ = 1e-12f;
@@ -21,11 +39,14 @@ static constexpr float EPSILON_SQ = 1e-12f;
 namespace pip3D
 {
 
+    class Texture;
+
     struct PackedNormal
     {
         uint16_t data;
 
-        MESH_FORCE_INLINE PackedNormal() : data(0) {}
+        MESH_FORCE_INLINE constexpr PackedNormal() : data(0) {}
+        MESH_FORCE_INLINE explicit constexpr PackedNormal(uint16_t packed) : data(packed) {}
 
         MESH_HOT_PATH MESH_FORCE_INLINE void set(const Vector3 &n)
         {
@@ -75,15 +96,34 @@ namespace pip3D
         int16_t px, py, pz;
         PackedNormal normal;
 
-        MESH_FORCE_INLINE Vertex() : px(0), py(0), pz(0), normal() {}
+        MESH_FORCE_INLINE constexpr Vertex() : px(0), py(0), pz(0), normal() {}
+        MESH_FORCE_INLINE constexpr Vertex(int16_t x, int16_t y, int16_t z, PackedNormal n) : px(x), py(y), pz(z), normal(n) {}
+    };
+
+    // Texture coordinate in 4.12 fixed point: Mesh::UV_ONE is one repeat of
+    // the texture.
+    struct TexCoord
+    {
+        int16_t u, v;
     };
 
     struct Face
     {
         uint16_t v0, v1, v2;
 
-        MESH_FORCE_INLINE Face() : v0(0), v1(0), v2(0) {}
-        MESH_FORCE_INLINE Face(uint16_t a, uint16_t b, uint16_t c) : v0(a), v1(b), v2(c) {}
+        MESH_FORCE_INLINE constexpr Face() : v0(0), v1(0), v2(0) {}
+        MESH_FORCE_INLINE constexpr Face(uint16_t a, uint16_t b, uint16_t c) : v0(a), v1(b), v2(c) {}
+    };
+
+    // Undirected edge with the faces on either side. face0 walks v0 -> v1,
+    // face1 walks v1 -> v0 or is NO_FACE on a boundary; edges shared by
+    // more than two faces are split into one-sided records.
+    struct MeshEdge
+    {
+        static constexpr uint16_t NO_FACE = 0xFFFF;
+
+        uint16_t v0, v1;
+        uint16_t face0, face1;
     };
 
     struct MESH_SIMD_ALIGN MeshCache
@@ -124,6 +164,18 @@ namespace pip3D
 
         float qScale;
 
+        PackedNormal *faceNormalData;
+        uint16_t faceNormalCount;
+        bool ownsFaceNormals;
+
+        MeshEdge *edgeData;
+        uint32_t edgeCount;
+        uint16_t edgeFaceCount;
+
+        // Optional stream of maxVertices texture coordinates.
+        TexCoord *uvData;
+        const Texture *meshTexture;
+
         mutable MeshCache cache;
 
     public:
@@ -131,14 +183,17 @@ namespace pip3D
             : vertexCount(0), faceCount(0), maxVertices(maxVerts), maxFaces(maxFcs),
               position(0, 0, 0), rotation(0, 0, 0), scale(1, 1, 1),
               meshColor(color), visible(true), castShadows(true), transformDirty(true),
-              isStaticStorage(false), qScale(1.0f)
+              isStaticStorage(false), qScale(1.0f),
+              faceNormalData(nullptr), faceNormalCount(0), ownsFaceNormals(false),
+              edgeData(nullptr), edgeCount(0), edgeFaceCount(0),
+              uvData(nullptr), meshTexture(nullptr)
         {
 
             const size_t vertexSize = maxVertices * sizeof(Vertex);
             const size_t faceSize = maxFaces * sizeof(Face);
 
-            vertices = (Vertex *)MemUtils::allocData(vertexSize, 16);
-            faces = (Face *)MemUtils::allocData(faceSize, 16);
+            vertices = (Vertex *)MemUtils::allocData(vertexSize, 16, ::pip3D::Debug::LOG_MODULE_RESOURCES);
+            faces = (Face *)MemUtils::allocData(faceSize, 16, ::pip3D::Debug::LOG_MODULE_RESOURCES);
 
             if (unlikely(!vertices || !faces))
             {
@@ -167,7 +222,10 @@ namespace pip3D
               maxVertices(vertCount), maxFaces(faceCountIn),
               position(0, 0, 0), rotation(0, 0, 0), scale(1, 1, 1),
               meshColor(color), visible(true), castShadows(true), transformDirty(true),
-              isStaticStorage(staticStorage), qScale(1.0f)
+              isStaticStorage(staticStorage), qScale(1.0f),
+              faceNormalData(nullptr), faceNormalCount(0), ownsFaceNormals(false),
+              edgeData(nullptr), edgeCount(0), edgeFaceCount(0),
+              uvData(nullptr), meshTexture(nullptr)
         {
             cache.transform.identity();
         }
@@ -184,6 +242,11 @@ namespace pip3D
             qScale = half / denom;
         }
 
+        // Meshes that share quantized vertex data (LOD levels) must also
+        // share the scale.
+        MESH_PURE MESH_FORCE_INLINE float getQuantScale() const { return qScale; }
+        MESH_FORCE_INLINE void setQuantScale(float s) { qScale = s > 0.0f ? s : 1.0f; }
+
         MESH_FORCE_INLINE int16_t quantizeCoord(float x) const
         {
             if (qScale <= 0.0f)
@@ -219,6 +282,9 @@ namespace pip3D
                 MemUtils::freeData(faces);
                 faces = nullptr;
             }
+            releaseFaceNormals();
+            releaseEdges();
+            releaseUVs();
             vertexCount = 0;
             faceCount = 0;
             maxVertices = 0;
@@ -257,6 +323,8 @@ namespace pip3D
             v.py = quantizeCoord(pos.y);
             v.pz = quantizeCoord(pos.z);
             v.normal.data = 0;
+            if (uvData)
+                uvData[vertexCount].u = uvData[vertexCount].v = 0;
 
             cache.boundsValid = false;
             return vertexCount++;
@@ -406,6 +474,394 @@ namespace pip3D
             }
 
             heap_caps_free(vertexNormals);
+
+#if PIP3D_MESH_FACE_NORMALS
+            computeFaceNormals();
+#endif
+        }
+
+        // Reorders faces for post-transform vertex reuse (Forsyth's
+        // linear-speed optimizer over PIP3D_MESH_ORDER_CACHE entries), then
+        // renumbers vertices by first use so the vertex stream is read front
+        // to back. When no cached vertex has faces left, the walk restarts
+        // at the highest remaining face, so runs progress top to bottom as
+        // the bands do for upright meshes. Grids emitted row by row are
+        // often already better; the face order with fewer FIFO misses wins.
+        MESH_COLD_PATH bool optimizeOrder()
+        {
+            if (unlikely(isStaticStorage))
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "Mesh::optimizeOrder skipped for static-storage mesh");
+                return false;
+            }
+            if (unlikely(!vertices || !faces || faceCount < 2))
+                return false;
+
+            constexpr int CACHE = PIP3D_MESH_ORDER_CACHE;
+            constexpr int MAX_VALENCE_SCORE = 32;
+
+            const size_t nf = faceCount;
+            const size_t nv = vertexCount;
+            const size_t bytes = nv * (2 * sizeof(uint32_t) + 2 * sizeof(uint16_t) + sizeof(int16_t) + sizeof(float) + sizeof(Vertex)) +
+                                 nf * (3 * sizeof(uint16_t) + sizeof(uint16_t) + sizeof(Face) + 1) +
+                                 (nv + 1) * sizeof(uint32_t) + 64;
+            uint8_t *scratch = (uint8_t *)MemUtils::allocData(bytes, 4, ::pip3D::Debug::LOG_MODULE_RESOURCES);
+            if (unlikely(!scratch))
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "Mesh::optimizeOrder: failed to allocate %u bytes, face order kept",
+                     static_cast<unsigned int>(bytes));
+                return false;
+            }
+
+            uint8_t *p = scratch;
+            auto carve = [&p](size_t size) -> uint8_t *
+            {
+                uint8_t *r = p;
+                p += (size + 3) & ~static_cast<size_t>(3);
+                return r;
+            };
+            uint32_t *adjStart = (uint32_t *)carve((nv + 1) * sizeof(uint32_t));
+            uint16_t *adjCount = (uint16_t *)carve(nv * sizeof(uint16_t));
+            uint32_t *stamp = (uint32_t *)carve(nv * sizeof(uint32_t));
+            uint16_t *newIndex = (uint16_t *)carve(nv * sizeof(uint16_t));
+            int16_t *cachePos = (int16_t *)carve(nv * sizeof(int16_t));
+            float *vertexScore = (float *)carve(nv * sizeof(float));
+            Vertex *vertexCopy = (Vertex *)carve(nv * sizeof(Vertex));
+            uint16_t *adjFaces = (uint16_t *)carve(nf * 3 * sizeof(uint16_t));
+            uint16_t *restartOrder = (uint16_t *)carve(nf * sizeof(uint16_t));
+            Face *ordered = (Face *)carve(nf * sizeof(Face));
+            uint8_t *emitted = carve(nf);
+
+            float cacheScore[CACHE];
+            for (int i = 0; i < CACHE; ++i)
+                cacheScore[i] = i < 3 ? 0.75f : powf(1.0f - static_cast<float>(i - 3) / (CACHE - 3), 1.5f);
+            float valenceScore[MAX_VALENCE_SCORE];
+            valenceScore[0] = -1.0f;
+            for (int i = 1; i < MAX_VALENCE_SCORE; ++i)
+                valenceScore[i] = 2.0f / sqrtf(static_cast<float>(i));
+            auto scoreOf = [&](uint16_t v) -> float
+            {
+                const uint16_t left = adjCount[v];
+                if (left == 0)
+                    return -1.0f;
+                const float valence = left < MAX_VALENCE_SCORE ? valenceScore[left] : 2.0f / sqrtf(static_cast<float>(left));
+                return (cachePos[v] >= 0 ? cacheScore[cachePos[v]] : 0.0f) + valence;
+            };
+
+            // Vertex -> face adjacency; adjCount doubles as the number of
+            // faces not yet emitted.
+            memset(adjCount, 0, nv * sizeof(uint16_t));
+            for (size_t f = 0; f < nf; ++f)
+            {
+                ++adjCount[faces[f].v0];
+                ++adjCount[faces[f].v1];
+                ++adjCount[faces[f].v2];
+            }
+            adjStart[0] = 0;
+            for (size_t v = 0; v < nv; ++v)
+            {
+                adjStart[v + 1] = adjStart[v] + adjCount[v];
+                adjCount[v] = 0;
+            }
+            for (size_t f = 0; f < nf; ++f)
+            {
+                const uint16_t idx[3] = {faces[f].v0, faces[f].v1, faces[f].v2};
+                for (int k = 0; k < 3; ++k)
+                    adjFaces[adjStart[idx[k]] + adjCount[idx[k]]++] = static_cast<uint16_t>(f);
+            }
+
+            for (size_t v = 0; v < nv; ++v)
+            {
+                cachePos[v] = -1;
+                vertexScore[v] = scoreOf(static_cast<uint16_t>(v));
+            }
+            for (size_t f = 0; f < nf; ++f)
+            {
+                emitted[f] = 0;
+                restartOrder[f] = static_cast<uint16_t>(f);
+            }
+
+            // Restarts go by descending centroid height (sum of quantized y).
+            std::sort(restartOrder, restartOrder + nf, [this](uint16_t a, uint16_t b)
+                      {
+                          const int32_t ya = vertices[faces[a].v0].py + vertices[faces[a].v1].py + vertices[faces[a].v2].py;
+                          const int32_t yb = vertices[faces[b].v0].py + vertices[faces[b].v1].py + vertices[faces[b].v2].py;
+                          return ya != yb ? ya > yb : a < b;
+                      });
+
+            uint16_t cache[CACHE + 3];
+            int cacheSize = 0;
+            size_t restartCursor = 0;
+            int32_t best = -1;
+            for (size_t out = 0; out < nf; ++out)
+            {
+                if (best < 0)
+                {
+                    while (emitted[restartOrder[restartCursor]])
+                        ++restartCursor;
+                    best = restartOrder[restartCursor];
+                }
+
+                const Face face = faces[best];
+                ordered[out] = face;
+                emitted[best] = 1;
+
+                // Drops the face from its vertices' lists of faces left.
+                const uint16_t idx[3] = {face.v0, face.v1, face.v2};
+                for (int k = 0; k < 3; ++k)
+                {
+                    const uint16_t v = idx[k];
+                    uint16_t *list = adjFaces + adjStart[v];
+                    for (uint16_t i = 0; i < adjCount[v]; ++i)
+                    {
+                        if (list[i] == best)
+                        {
+                            list[i] = list[--adjCount[v]];
+                            break;
+                        }
+                    }
+                }
+
+                // Pushes the face's vertices to the front of the FIFO.
+                uint16_t next[CACHE + 3];
+                int nextSize = 0;
+                for (int k = 0; k < 3; ++k)
+                    next[nextSize++] = idx[k];
+                for (int i = 0; i < cacheSize; ++i)
+                {
+                    const uint16_t v = cache[i];
+                    if (v != idx[0] && v != idx[1] && v != idx[2])
+                        next[nextSize++] = v;
+                }
+                for (int i = 0; i < nextSize; ++i)
+                {
+                    const uint16_t v = next[i];
+                    cachePos[v] = static_cast<int16_t>(i < CACHE ? i : -1);
+                    vertexScore[v] = scoreOf(v);
+                }
+                cacheSize = nextSize < CACHE ? nextSize : CACHE;
+                memcpy(cache, next, cacheSize * sizeof(uint16_t));
+
+                // Only faces around touched vertices change score; the best
+                // of them is next.
+                best = -1;
+                float bestScore = -1.0f;
+                for (int i = 0; i < nextSize; ++i)
+                {
+                    const uint16_t v = next[i];
+                    const uint16_t *list = adjFaces + adjStart[v];
+                    for (uint16_t j = 0; j < adjCount[v]; ++j)
+                    {
+                        const uint16_t f = list[j];
+                        const float s = vertexScore[faces[f].v0] + vertexScore[faces[f].v1] + vertexScore[faces[f].v2];
+                        if (s > bestScore)
+                        {
+                            bestScore = s;
+                            best = f;
+                        }
+                    }
+                }
+            }
+
+            if (fifoMisses(ordered, nf, nv, CACHE, stamp) >= fifoMisses(faces, nf, nv, CACHE, stamp))
+                memcpy(ordered, faces, nf * sizeof(Face));
+
+            // Vertices in order of first use; unreferenced ones go last.
+            uint16_t used = 0;
+            for (size_t v = 0; v < nv; ++v)
+                newIndex[v] = 0xFFFFu;
+            for (size_t f = 0; f < nf; ++f)
+            {
+                uint16_t *idx[3] = {&ordered[f].v0, &ordered[f].v1, &ordered[f].v2};
+                for (int k = 0; k < 3; ++k)
+                {
+                    if (newIndex[*idx[k]] == 0xFFFFu)
+                        newIndex[*idx[k]] = used++;
+                    *idx[k] = newIndex[*idx[k]];
+                }
+            }
+            for (size_t v = 0; v < nv; ++v)
+                if (newIndex[v] == 0xFFFFu)
+                    newIndex[v] = used++;
+
+            memcpy(vertexCopy, vertices, nv * sizeof(Vertex));
+            for (size_t v = 0; v < nv; ++v)
+                vertices[newIndex[v]] = vertexCopy[v];
+            if (uvData)
+            {
+                TexCoord *uvCopy = reinterpret_cast<TexCoord *>(vertexCopy);
+                memcpy(uvCopy, uvData, nv * sizeof(TexCoord));
+                for (size_t v = 0; v < nv; ++v)
+                    uvData[newIndex[v]] = uvCopy[v];
+            }
+            memcpy(faces, ordered, nf * sizeof(Face));
+            MemUtils::freeData(scratch);
+
+            // Per-face data follows the faces.
+            releaseEdges();
+            if (hasFaceNormals())
+                computeFaceNormals();
+            return true;
+        }
+
+        // Fills the per-face normal stream from the current faces. Called by
+        // finalizeNormals(); faces added afterwards have no normal until the
+        // next call, and hasFaceNormals() reports false meanwhile.
+        MESH_COLD_PATH bool computeFaceNormals()
+        {
+            if (unlikely(!vertices || !faces || faceCount == 0))
+                return false;
+
+            if (!ownsFaceNormals)
+                releaseFaceNormals();
+            if (!faceNormalData)
+            {
+                faceNormalData = (PackedNormal *)MemUtils::allocData(maxFaces * sizeof(PackedNormal), 4, ::pip3D::Debug::LOG_MODULE_RESOURCES);
+                if (unlikely(!faceNormalData))
+                {
+                    LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                         "Mesh::computeFaceNormals: failed to allocate %u bytes, back faces are culled after projection",
+                         static_cast<unsigned int>(maxFaces * sizeof(PackedNormal)));
+                    return false;
+                }
+                ownsFaceNormals = true;
+            }
+
+            for (uint16_t f = 0; f < faceCount; f++)
+            {
+                const Face &face = faces[f];
+                const Vector3 v0 = decodePosition(vertices[face.v0]);
+                Vector3 n = (decodePosition(vertices[face.v1]) - v0).cross(decodePosition(vertices[face.v2]) - v0);
+                n.normalize();
+                faceNormalData[f].set(n);
+            }
+            faceNormalCount = faceCount;
+            return true;
+        }
+
+        // Uses externally owned normals, one per face; for baked meshes.
+        MESH_FORCE_INLINE void setFaceNormals(const PackedNormal *normals)
+        {
+            releaseFaceNormals();
+            faceNormalData = const_cast<PackedNormal *>(normals);
+            faceNormalCount = normals ? faceCount : 0;
+        }
+
+        // Builds the edge table used for silhouette extraction. Kept until
+        // faces are added or the mesh is cleared.
+        MESH_COLD_PATH bool buildEdges()
+        {
+            if (hasEdges())
+                return true;
+            releaseEdges();
+            if (unlikely(!faces || faceCount == 0))
+                return false;
+
+            struct HalfEdge
+            {
+                uint32_t key;
+                uint16_t from;
+                uint16_t face;
+            };
+            const size_t halfCount = static_cast<size_t>(faceCount) * 3;
+            HalfEdge *half = (HalfEdge *)MemUtils::allocData(halfCount * sizeof(HalfEdge), 4, ::pip3D::Debug::LOG_MODULE_RESOURCES);
+            if (unlikely(!half))
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "Mesh::buildEdges: failed to allocate %u half-edges",
+                     static_cast<unsigned int>(halfCount));
+                return false;
+            }
+
+            for (uint16_t f = 0; f < faceCount; f++)
+            {
+                const uint16_t idx[3] = {faces[f].v0, faces[f].v1, faces[f].v2};
+                for (int k = 0; k < 3; k++)
+                {
+                    const uint16_t a = idx[k];
+                    const uint16_t b = idx[(k + 1) % 3];
+                    const uint16_t lo = a < b ? a : b;
+                    const uint16_t hi = a < b ? b : a;
+                    half[f * 3 + k] = HalfEdge{(static_cast<uint32_t>(lo) << 16) | hi, a, f};
+                }
+            }
+            std::sort(half, half + halfCount, [](const HalfEdge &l, const HalfEdge &r)
+                      { return l.key < r.key; });
+
+            // Interior edges merge two half-edges; everything else stays
+            // one-sided.
+            auto paired = [&](size_t i, size_t end)
+            {
+                return end - i == 2 && half[i].from != half[i + 1].from;
+            };
+            size_t records = 0;
+            for (size_t i = 0; i < halfCount;)
+            {
+                size_t end = i + 1;
+                while (end < halfCount && half[end].key == half[i].key)
+                    ++end;
+                records += paired(i, end) ? 1 : end - i;
+                i = end;
+            }
+
+            edgeData = (MeshEdge *)MemUtils::allocData(records * sizeof(MeshEdge), 4, ::pip3D::Debug::LOG_MODULE_RESOURCES);
+            if (unlikely(!edgeData))
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "Mesh::buildEdges: failed to allocate %u edges",
+                     static_cast<unsigned int>(records));
+                MemUtils::freeData(half);
+                return false;
+            }
+
+            size_t out = 0;
+            for (size_t i = 0; i < halfCount;)
+            {
+                size_t end = i + 1;
+                while (end < halfCount && half[end].key == half[i].key)
+                    ++end;
+
+                const uint16_t lo = static_cast<uint16_t>(half[i].key >> 16);
+                const uint16_t hi = static_cast<uint16_t>(half[i].key & 0xFFFF);
+                if (paired(i, end))
+                {
+                    const HalfEdge &fwd = half[i].from == lo ? half[i] : half[i + 1];
+                    const HalfEdge &back = half[i].from == lo ? half[i + 1] : half[i];
+                    edgeData[out++] = MeshEdge{lo, hi, fwd.face, back.face};
+                }
+                else
+                {
+                    for (size_t k = i; k < end; ++k)
+                    {
+                        const uint16_t to = half[k].from == lo ? hi : lo;
+                        edgeData[out++] = MeshEdge{half[k].from, to, half[k].face, MeshEdge::NO_FACE};
+                    }
+                }
+                i = end;
+            }
+            MemUtils::freeData(half);
+
+            edgeCount = static_cast<uint32_t>(out);
+            edgeFaceCount = faceCount;
+            return true;
+        }
+
+        MESH_PURE MESH_FORCE_INLINE bool hasEdges() const
+        {
+            return edgeData && edgeFaceCount == faceCount && faceCount > 0;
+        }
+        MESH_PURE MESH_FORCE_INLINE uint32_t numEdges() const { return hasEdges() ? edgeCount : 0; }
+        MESH_PURE MESH_FORCE_INLINE const MeshEdge *edges() const { return hasEdges() ? edgeData : nullptr; }
+
+        MESH_PURE MESH_FORCE_INLINE bool hasFaceNormals() const
+        {
+            return faceNormalData && faceNormalCount == faceCount && faceCount > 0;
+        }
+        MESH_PURE MESH_FORCE_INLINE const PackedNormal *faceNormals() const
+        {
+            return hasFaceNormals() ? faceNormalData : nullptr;
         }
 
         MESH_HOT_PATH MESH_FORCE_INLINE void setPosition(float x, float y, float z)
@@ -455,6 +911,8 @@ namespace pip3D
         }
 
         MESH_PURE MESH_FORCE_INLINE Vector3 pos() const { return position; }
+        MESH_PURE MESH_FORCE_INLINE Vector3 rot() const { return rotation; }
+        MESH_PURE MESH_FORCE_INLINE Vector3 scl() const { return scale; }
 
         MESH_HOT_PATH void calculateBoundingSphere()
         {
@@ -491,6 +949,14 @@ namespace pip3D
             cache.boundsValid = true;
         }
 
+        // For baked meshes whose bounds were computed offline.
+        MESH_FORCE_INLINE void setBoundingSphere(const Vector3 &localCenter, float localRadius)
+        {
+            cache.boundingCenter = localCenter;
+            cache.boundingRadius = localRadius;
+            cache.boundsValid = true;
+        }
+
         MESH_HOT_PATH void updateTransform() const
         {
             if (likely(!transformDirty && cache.transformValid))
@@ -587,9 +1053,13 @@ namespace pip3D
         MESH_HOT_PATH MESH_FORCE_INLINE void clear()
         {
             vertexCount = faceCount = 0;
+            faceNormalCount = 0;
+            edgeFaceCount = 0;
             cache.boundsValid = false;
         }
 
+        MESH_PURE MESH_FORCE_INLINE bool hasStorage() const { return vertices && faces; }
+        MESH_PURE MESH_FORCE_INLINE uint16_t numVertices() const { return vertexCount; }
         MESH_PURE MESH_FORCE_INLINE uint16_t numFaces() const { return faceCount; }
         MESH_PURE MESH_FORCE_INLINE const Face &face(uint16_t i) const { return faces[i]; }
         MESH_PURE MESH_FORCE_INLINE const Vertex &vert(uint16_t i) const { return vertices[i]; }
@@ -602,11 +1072,117 @@ namespace pip3D
         MESH_FORCE_INLINE void setCastShadows(bool enabled) { castShadows = enabled; }
         MESH_PURE MESH_FORCE_INLINE bool getCastShadows() const { return castShadows; }
 
+        static constexpr float UV_ONE = 4096.0f;
+
+        // Allocates the texture coordinate stream, zeroed. Works on
+        // static-storage meshes too, the stream is always owned.
+        MESH_COLD_PATH bool enableUVs()
+        {
+            if (uvData)
+                return true;
+            if (unlikely(maxVertices == 0))
+                return false;
+            uvData = (TexCoord *)MemUtils::allocData(maxVertices * sizeof(TexCoord), 4, ::pip3D::Debug::LOG_MODULE_RESOURCES);
+            if (unlikely(!uvData))
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "Mesh::enableUVs: failed to allocate %u bytes",
+                     static_cast<unsigned int>(maxVertices * sizeof(TexCoord)));
+                return false;
+            }
+            memset(uvData, 0, maxVertices * sizeof(TexCoord));
+            return true;
+        }
+
+        // u and v in texture repeats, within +-8.
+        MESH_FORCE_INLINE void setUV(uint16_t index, float u, float v)
+        {
+            if (unlikely(index >= vertexCount || (!uvData && !enableUVs())))
+                return;
+            uvData[index].u = quantizeUV(u);
+            uvData[index].v = quantizeUV(v);
+        }
+
+        // Planar mapping: u and v are the dot products of each position with
+        // the two axes, times scale repeats per unit.
+        MESH_COLD_PATH bool projectUVs(const Vector3 &axisU, const Vector3 &axisV, float scaleUV = 1.0f)
+        {
+            if (!enableUVs())
+                return false;
+            for (uint16_t i = 0; i < vertexCount; ++i)
+            {
+                const Vector3 p = decodePosition(vertices[i]);
+                uvData[i].u = quantizeUV(p.dot(axisU) * scaleUV);
+                uvData[i].v = quantizeUV(p.dot(axisV) * scaleUV);
+            }
+            return true;
+        }
+
+        MESH_PURE MESH_FORCE_INLINE bool hasUVs() const { return uvData != nullptr; }
+        MESH_PURE MESH_FORCE_INLINE const TexCoord &uv(uint16_t i) const { return uvData[i]; }
+
+        // The texture is not owned; the mesh color tints it.
+        MESH_FORCE_INLINE void setTexture(const Texture *tex) { meshTexture = tex; }
+        MESH_PURE MESH_FORCE_INLINE const Texture *texture() const { return meshTexture; }
+
         MESH_HOT_PATH const Matrix4x4 &getTransform() const
         {
             updateTransform();
             return cache.transform;
         }
+
+    private:
+        // Vertex transforms a FIFO of cacheSize entries misses over faces.
+        static uint32_t fifoMisses(const Face *faceList, size_t nf, size_t nv, int cacheSize, uint32_t *stamp)
+        {
+            memset(stamp, 0, nv * sizeof(uint32_t));
+            uint32_t misses = 0;
+            for (size_t f = 0; f < nf; ++f)
+            {
+                const uint16_t idx[3] = {faceList[f].v0, faceList[f].v1, faceList[f].v2};
+                for (int k = 0; k < 3; ++k)
+                {
+                    // stamp: miss count just after insertion, 0 for never.
+                    if (stamp[idx[k]] == 0 || misses - stamp[idx[k]] >= static_cast<uint32_t>(cacheSize))
+                    {
+                        ++misses;
+                        stamp[idx[k]] = misses;
+                    }
+                }
+            }
+            return misses;
+        }
+
+        MESH_COLD_PATH void releaseFaceNormals()
+        {
+            if (faceNormalData && ownsFaceNormals)
+                MemUtils::freeData(faceNormalData);
+            faceNormalData = nullptr;
+            faceNormalCount = 0;
+            ownsFaceNormals = false;
+        }
+
+        static MESH_FORCE_INLINE int16_t quantizeUV(float t)
+        {
+            const float q = fminf(fmaxf(t * UV_ONE, -32768.0f), 32767.0f);
+            return static_cast<int16_t>(q >= 0.0f ? q + 0.5f : q - 0.5f);
+        }
+
+        MESH_COLD_PATH void releaseUVs()
+        {
+            if (uvData)
+                MemUtils::freeData(uvData);
+            uvData = nullptr;
+        }
+
+        MESH_COLD_PATH void releaseEdges()
+        {
+            if (edgeData)
+                MemUtils::freeData(edgeData);
+            edgeData = nullptr;
+            edgeCount = 0;
+            edgeFaceCount = 0;
+        }
     };
 
 }
@@ -0,0 +1,293 @@
+#ifndef MESHLOD_H
+#define MESHLOD_H
+
+#include "Mesh.h"
+#include "../Core/Debug/Logging.h"
+#include <vector>
+#include <algorithm>
+
+#ifndef PIP3D_MESH_LOD_MAX_LEVELS
+#define PIP3D_MESH_LOD_MAX_LEVELS 4
+#endif
+
+// Fraction of a switch radius an instance has to travel past it before the
+// level changes back, so objects sitting on a boundary do not flicker.
+#ifndef PIP3D_MESH_LOD_HYSTERESIS
+#define PIP3D_MESH_LOD_HYSTERESIS 0.15f
+#endif
+
+namespace pip3D
+{
+
+    // Chain of meshes ordered from finest (level 0) to coarsest. Level i is
+    // left for level i + 1 once the instance's projected radius drops below
+    // switchPixels of level i.
+    class MeshLOD
+    {
+    public:
+        static constexpr int MAX_LEVELS = PIP3D_MESH_LOD_MAX_LEVELS;
+
+    private:
+        struct Level
+        {
+            Mesh *mesh;
+            float switchPixels;
+            bool owned;
+        };
+
+        Level levels[MAX_LEVELS];
+        uint8_t levelCount;
+        float hysteresis;
+
+    public:
+        MeshLOD() : levelCount(0), hysteresis(PIP3D_MESH_LOD_HYSTERESIS)
+        {
+            for (int i = 0; i < MAX_LEVELS; ++i)
+                levels[i] = Level{nullptr, 0.0f, false};
+        }
+
+        explicit MeshLOD(Mesh *base) : MeshLOD()
+        {
+            addLevel(base, 0.0f);
+        }
+
+        ~MeshLOD()
+        {
+            clear();
+        }
+
+        MeshLOD(const MeshLOD &) = delete;
+        MeshLOD &operator=(const MeshLOD &) = delete;
+
+        void clear()
+        {
+            for (int i = 0; i < levelCount; ++i)
+            {
+                if (levels[i].owned)
+                    delete levels[i].mesh;
+                levels[i] = Level{nullptr, 0.0f, false};
+            }
+            levelCount = 0;
+        }
+
+        // switchPixels of the previous level is set to the radius below
+        // which this one takes over; it must shrink along the chain.
+        bool addLevel(Mesh *mesh, float previousSwitchPixels, bool takeOwnership = false)
+        {
+            if (!mesh || levelCount >= MAX_LEVELS)
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "MeshLOD::addLevel rejected (mesh=%p, levels=%u, max=%u)",
+                     static_cast<void *>(mesh),
+                     static_cast<unsigned int>(levelCount),
+                     static_cast<unsigned int>(MAX_LEVELS));
+                return false;
+            }
+            if (levelCount > 0)
+            {
+                Level &prev = levels[levelCount - 1];
+                if (levelCount > 1 && previousSwitchPixels >= levels[levelCount - 2].switchPixels)
+                {
+                    LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                         "MeshLOD::addLevel: switch radius %.1f is not below the previous one",
+                         static_cast<double>(previousSwitchPixels));
+                }
+                prev.switchPixels = previousSwitchPixels;
+            }
+            levels[levelCount++] = Level{mesh, 0.0f, takeOwnership};
+            return true;
+        }
+
+        // Appends an edge-collapsed copy of the current coarsest level with
+        // about targetFaces faces. Intended for setup time, not per frame.
+        Mesh *addSimplifiedLevel(uint16_t targetFaces, float previousSwitchPixels)
+        {
+            if (levelCount == 0)
+                return nullptr;
+            Mesh *mesh = simplify(*levels[levelCount - 1].mesh, targetFaces);
+            if (!mesh)
+                return nullptr;
+            if (!addLevel(mesh, previousSwitchPixels, true))
+            {
+                delete mesh;
+                return nullptr;
+            }
+            return mesh;
+        }
+
+        void setHysteresis(float fraction) { hysteresis = fminf(fmaxf(fraction, 0.0f), 0.9f); }
+        float getHysteresis() const { return hysteresis; }
+
+        uint8_t numLevels() const { return levelCount; }
+        Mesh *mesh(uint8_t level) const { return level < levelCount ? levels[level].mesh : nullptr; }
+        float switchPixels(uint8_t level) const { return level < levelCount ? levels[level].switchPixels : 0.0f; }
+
+        // Level to draw at radiusPixels given the one drawn last time. The
+        // result is a fixed point: selecting again from it returns the same
+        // level, which keeps every band of a frame on one mesh.
+        uint8_t select(float radiusPixels, uint8_t current) const
+        {
+            if (levelCount <= 1)
+                return 0;
+            if (current >= levelCount)
+                current = static_cast<uint8_t>(levelCount - 1);
+
+            while (current + 1 < levelCount &&
+                   radiusPixels < levels[current].switchPixels * (1.0f - hysteresis))
+                ++current;
+            while (current > 0 &&
+                   radiusPixels > levels[current - 1].switchPixels * (1.0f + hysteresis))
+                --current;
+            return current;
+        }
+
+        // Greedy shortest-edge collapse over the quantized positions. Each
+        // pass collapses a set of edges that share no vertex, keeping the
+        // endpoint with the larger valence so silhouettes drift less.
+        static Mesh *simplify(const Mesh &src, uint16_t targetFaces)
+        {
+            const uint16_t vertexCount = src.numVertices();
+            const uint16_t faceCount = src.numFaces();
+            if (vertexCount == 0 || faceCount == 0)
+                return nullptr;
+
+            std::vector<Face> faces(faceCount);
+            for (uint16_t i = 0; i < faceCount; ++i)
+                faces[i] = src.face(i);
+
+            std::vector<uint16_t> remap(vertexCount);
+            std::vector<uint16_t> valence(vertexCount);
+            std::vector<uint8_t> locked(vertexCount);
+            struct Edge
+            {
+                uint32_t lengthSq;
+                uint16_t a;
+                uint16_t b;
+            };
+            std::vector<Edge> edges;
+            edges.reserve(static_cast<size_t>(faceCount) * 3);
+
+            while (faces.size() > targetFaces)
+            {
+                std::fill(valence.begin(), valence.end(), 0);
+                edges.clear();
+                for (const Face &f : faces)
+                {
+                    const uint16_t idx[3] = {f.v0, f.v1, f.v2};
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const uint16_t a = idx[k];
+                        const uint16_t b = idx[(k + 1) % 3];
+                        valence[a]++;
+                        if (a < b)
+                            edges.push_back(Edge{edgeLengthSq(src.vert(a), src.vert(b)), a, b});
+                        else
+                            edges.push_back(Edge{edgeLengthSq(src.vert(a), src.vert(b)), b, a});
+                    }
+                }
+                std::sort(edges.begin(), edges.end(), [](const Edge &l, const Edge &r)
+                          { return l.lengthSq < r.lengthSq; });
+
+                for (uint16_t i = 0; i < vertexCount; ++i)
+                    remap[i] = i;
+                std::fill(locked.begin(), locked.end(), 0);
+
+                // Every collapse removes roughly two faces.
+                size_t budget = (faces.size() - targetFaces + 1) / 2;
+                size_t collapsed = 0;
+                for (const Edge &e : edges)
+                {
+                    if (collapsed >= budget)
+                        break;
+                    if (locked[e.a] || locked[e.b])
+                        continue;
+                    const uint16_t keep = valence[e.a] >= valence[e.b] ? e.a : e.b;
+                    const uint16_t drop = keep == e.a ? e.b : e.a;
+                    remap[drop] = keep;
+                    locked[e.a] = 1;
+                    locked[e.b] = 1;
+                    ++collapsed;
+                }
+                if (collapsed == 0)
+                    break;
+
+                size_t out = 0;
+                for (size_t i = 0; i < faces.size(); ++i)
+                {
+                    Face f = faces[i];
+                    f.v0 = remap[f.v0];
+                    f.v1 = remap[f.v1];
+                    f.v2 = remap[f.v2];
+                    if (f.v0 == f.v1 || f.v1 == f.v2 || f.v0 == f.v2)
+                        continue;
+                    faces[out++] = f;
+                }
+                faces.resize(out);
+            }
+
+            // Compact to the vertices still referenced.
+            std::vector<uint16_t> newIndex(vertexCount, 0xFFFFu);
+            uint16_t usedVertices = 0;
+            for (const Face &f : faces)
+            {
+                const uint16_t idx[3] = {f.v0, f.v1, f.v2};
+                for (int k = 0; k < 3; ++k)
+                    if (newIndex[idx[k]] == 0xFFFFu)
+                        newIndex[idx[k]] = usedVertices++;
+            }
+            if (faces.empty())
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "MeshLOD::simplify collapsed every face (source faces=%u)",
+                     static_cast<unsigned int>(faceCount));
+                return nullptr;
+            }
+
+            Mesh *mesh = new Mesh(usedVertices, static_cast<uint16_t>(faces.size()), src.color());
+            if (!mesh->hasStorage())
+            {
+                delete mesh;
+                return nullptr;
+            }
+            mesh->setQuantScale(src.getQuantScale());
+
+            std::vector<uint16_t> order(usedVertices);
+            for (uint16_t i = 0; i < vertexCount; ++i)
+                if (newIndex[i] != 0xFFFFu)
+                    order[newIndex[i]] = i;
+            for (uint16_t i = 0; i < usedVertices; ++i)
+                mesh->addVertex(src.decodePosition(src.vert(order[i])));
+            for (const Face &f : faces)
+                mesh->addFace(newIndex[f.v0], newIndex[f.v1], newIndex[f.v2]);
+#if PIP3D_MESH_OPTIMIZE_ORDER
+            mesh->optimizeOrder();
+#endif
+            mesh->finalizeNormals();
+            mesh->calculateBoundingSphere();
+
+            LOGI(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                 "MeshLOD::simplify: %u -> %u faces, %u -> %u vertices",
+                 static_cast<unsigned int>(faceCount),
+                 static_cast<unsigned int>(mesh->numFaces()),
+                 static_cast<unsigned int>(vertexCount),
+                 static_cast<unsigned int>(mesh->numVertices()));
+            return mesh;
+        }
+
+    private:
+        static uint32_t edgeLengthSq(const Vertex &a, const Vertex &b)
+        {
+            const int32_t dx = static_cast<int32_t>(a.px) - b.px;
+            const int32_t dy = static_cast<int32_t>(a.py) - b.py;
+            const int32_t dz = static_cast<int32_t>(a.pz) - b.pz;
+            // The full sum needs 35 bits; only the ordering matters here.
+            return static_cast<uint32_t>((static_cast<int64_t>(dx) * dx +
+                                          static_cast<int64_t>(dy) * dy +
+                                          static_cast<int64_t>(dz) * dz) >>
+                                         4);
+        }
+    };
+
+}
+
+#endif
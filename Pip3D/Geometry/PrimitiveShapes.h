@@ -51,6 +51,9 @@ namespace pip3D
     private:
         inline void finalize()
         {
+#if PIP3D_MESH_OPTIMIZE_ORDER
+            optimizeOrder();
+#endif
             finalizeNormals();
             calculateBoundingSphere();
             updateTransform();
@@ -92,6 +95,9 @@ namespace pip3D
     private:
         inline void finalize()
         {
+#if PIP3D_MESH_OPTIMIZE_ORDER
+            optimizeOrder();
+#endif
             finalizeNormals();
             calculateBoundingSphere();
             updateTransform();
@@ -166,6 +172,9 @@ namespace pip3D
     private:
         inline void finalize()
         {
+#if PIP3D_MESH_OPTIMIZE_ORDER
+            optimizeOrder();
+#endif
             finalizeNormals();
             calculateBoundingSphere();
             updateTransform();
@@ -219,6 +228,9 @@ namespace pip3D
     private:
         inline void finalize()
         {
+#if PIP3D_MESH_OPTIMIZE_ORDER
+            optimizeOrder();
+#endif
             finalizeNormals();
             calculateBoundingSphere();
             updateTransform();
@@ -275,6 +287,9 @@ namespace pip3D
     private:
         inline void finalize()
         {
+#if PIP3D_MESH_OPTIMIZE_ORDER
+            optimizeOrder();
+#endif
             finalizeNormals();
             calculateBoundingSphere();
             updateTransform();
@@ -323,6 +338,9 @@ namespace pip3D
     private:
         inline void finalize()
         {
+#if PIP3D_MESH_OPTIMIZE_ORDER
+            optimizeOrder();
+#endif
             finalizeNormals();
             calculateBoundingSphere();
             updateTransform();
@@ -355,7 +373,8 @@ namespace pip3D
             const float halfCyl = cylinderHeight * half;
             uint8_t segs = segments ? segments : 3;
             uint8_t ringCount = rings < 2 ? 2 : rings;
-            uint8_t halfRings = ringCount / 2;
+            const uint8_t halfRings = ringCount / 2;
+            const uint8_t ringTotal = halfRings * 2;
             const uint16_t topPole = addVertex(Vector3(0, halfCyl + radius, 0));
             for (uint8_t ring = 1; ring <= halfRings; ring++)
             {
@@ -372,7 +391,7 @@ namespace pip3D
             for (uint8_t ring = 1; ring <= halfRings; ring++)
             {
                 constexpr float piHalf = PI * 0.5f;
-                const float phi = piHalf * ring / halfRings;
+                const float phi = piHalf * (halfRings - ring + 1) / halfRings;
                 const float y = -halfCyl - radius * FastMath::fastCos(phi);
                 const float r = radius * FastMath::fastSin(phi);
                 for (uint8_t seg = 0; seg < segs; seg++)
@@ -385,24 +404,24 @@ namespace pip3D
             for (uint8_t seg = 0; seg < segs; seg++)
             {
                 const uint16_t next = (seg + 1) % segs;
-                addFace(topPole, 1 + seg, 1 + next);
+                addFace(topPole, 1 + next, 1 + seg);
             }
-            for (uint8_t ring = 0; ring < ringCount - 1; ring++)
+            for (uint8_t ring = 0; ring < ringTotal - 1; ring++)
             {
                 for (uint8_t seg = 0; seg < segs; seg++)
                 {
                     const uint16_t next = (seg + 1) % segs;
                     const uint16_t curr = 1 + ring * segs + seg, currNext = 1 + ring * segs + next;
                     const uint16_t below = 1 + (ring + 1) * segs + seg, belowNext = 1 + (ring + 1) * segs + next;
-                    addFace(curr, below, currNext);
-                    addFace(currNext, below, belowNext);
+                    addFace(curr, currNext, below);
+                    addFace(currNext, belowNext, below);
                 }
             }
-            const uint16_t lastRingStart = 1 + (ringCount - 1) * segs;
+            const uint16_t lastRingStart = 1 + (ringTotal - 1) * segs;
             for (uint8_t seg = 0; seg < segs; seg++)
             {
                 const uint16_t next = (seg + 1) % segs;
-                addFace(bottomPole, lastRingStart + next, lastRingStart + seg);
+                addFace(bottomPole, lastRingStart + seg, lastRingStart + next);
             }
             finalize();
         }
@@ -410,6 +429,9 @@ namespace pip3D
     private:
         inline void finalize()
         {
+#if PIP3D_MESH_OPTIMIZE_ORDER
+            optimizeOrder();
+#endif
             finalizeNormals();
             calculateBoundingSphere();
             updateTransform();
@@ -475,7 +497,7 @@ namespace pip3D
                 const int nextSeg = (seg + 1) % SEGMENTS;
                 const uint16_t v0 = bodyBase + seg;
                 const uint16_t v1 = bodyBase + nextSeg;
-                addFace(bottomCenter, v1, v0);
+                addFace(bottomCenter, v0, v1);
             }
 
             static const int LID_RINGS = 4;
@@ -519,7 +541,7 @@ namespace pip3D
                 const int nextSeg = (seg + 1) % SEGMENTS;
                 const uint16_t v0 = lastRingStart + seg;
                 const uint16_t v1 = lastRingStart + nextSeg;
-                addFace(lidTopCenter, v0, v1);
+                addFace(lidTopCenter, v1, v0);
             }
 
             static const int KNOB_SEGMENTS = 12;
@@ -542,7 +564,7 @@ namespace pip3D
                 const int nextSeg = (seg + 1) % KNOB_SEGMENTS;
                 const uint16_t v0 = knobBase + seg;
                 const uint16_t v1 = knobBase + nextSeg;
-                addFace(v0, v1, knobTop);
+                addFace(v1, v0, knobTop);
             }
 
             finalize();
@@ -551,6 +573,9 @@ namespace pip3D
     private:
         inline void finalize()
         {
+#if PIP3D_MESH_OPTIMIZE_ORDER
+            optimizeOrder();
+#endif
             finalizeNormals();
             calculateBoundingSphere();
             updateTransform();
@@ -621,6 +646,9 @@ namespace pip3D
     private:
         inline void finalize()
         {
+#if PIP3D_MESH_OPTIMIZE_ORDER
+            optimizeOrder();
+#endif
             finalizeNormals();
             calculateBoundingSphere();
             updateTransform();
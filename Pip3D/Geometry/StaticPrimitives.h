@@ -0,0 +1,343 @@
+#ifndef STATICPRIMITIVES_H
+#define STATICPRIMITIVES_H
+
+#include "Mesh.h"
+#include "../Math/ConstMath.h"
+
+namespace pip3D
+{
+
+    // Primitive geometry generated by the compiler at a fixed tessellation.
+    // Vertices, faces and face normals are const tables in flash; a mesh over
+    // them costs only the Mesh object and nothing is built at boot. Every
+    // shape is described in unit extent (coordinates within [-1, 1]) and
+    // sized at runtime through the quantization scale.
+    namespace StaticGeometry
+    {
+
+        struct Point
+        {
+            double x, y, z;
+
+            constexpr Point(double x_, double y_, double z_) : x(x_), y(y_), z(z_) {}
+        };
+
+        constexpr Point sub(const Point &a, const Point &b)
+        {
+            return Point(a.x - b.x, a.y - b.y, a.z - b.z);
+        }
+
+        constexpr Point cross(const Point &a, const Point &b)
+        {
+            return Point(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+        }
+
+        constexpr int16_t quantize(double v)
+        {
+            return static_cast<int16_t>(v >= 1.0 ? 32767.0 : (v <= -1.0 ? -32767.0 : (v >= 0.0 ? v * 32767.0 + 0.5 : v * 32767.0 - 0.5)));
+        }
+
+        // Same octahedral encoding as PackedNormal::set().
+        constexpr uint16_t packOctahedral(double u, double v)
+        {
+            return static_cast<uint16_t>((static_cast<uint32_t>((u * 0.5 + 0.5) * 255.0) << 8) |
+                                         static_cast<uint32_t>((v * 0.5 + 0.5) * 255.0));
+        }
+
+        constexpr uint16_t packFolded(double u, double v, double z)
+        {
+            return z < 0.0 ? packOctahedral((1.0 - ConstMath::abs(v)) * ConstMath::sign(u),
+                                            (1.0 - ConstMath::abs(u)) * ConstMath::sign(v))
+                           : packOctahedral(u, v);
+        }
+
+        constexpr uint16_t packScaled(const Point &n, double l1)
+        {
+            return l1 > 1e-12 ? packFolded(n.x / l1, n.y / l1, n.z) : 0;
+        }
+
+        constexpr PackedNormal packNormal(const Point &n)
+        {
+            return PackedNormal(packScaled(n, ConstMath::abs(n.x) + ConstMath::abs(n.y) + ConstMath::abs(n.z)));
+        }
+
+        template <class Shape>
+        constexpr Vertex vertex(uint16_t i)
+        {
+            return Vertex(quantize(Shape::position(i).x),
+                          quantize(Shape::position(i).y),
+                          quantize(Shape::position(i).z),
+                          packNormal(Shape::normal(i)));
+        }
+
+        template <class Shape>
+        constexpr PackedNormal faceNormal(const Face &f)
+        {
+            return packNormal(cross(sub(Shape::position(f.v1), Shape::position(f.v0)),
+                                    sub(Shape::position(f.v2), Shape::position(f.v0))));
+        }
+
+        // Shape expands into its const tables. A Shape provides VERTEX_COUNT,
+        // FACE_COUNT, BOUNDING_RADIUS and constexpr position(i), normal(i)
+        // and face(f).
+        template <class Shape,
+                  class VertexIndices = typename ConstMath::MakeIndices<Shape::VERTEX_COUNT>::type,
+                  class FaceIndices = typename ConstMath::MakeIndices<Shape::FACE_COUNT>::type>
+        struct Tables;
+
+        template <class Shape, uint16_t... Vs, uint16_t... Fs>
+        struct Tables<Shape, ConstMath::Indices<Vs...>, ConstMath::Indices<Fs...>>
+        {
+            static constexpr Vertex vertices[Shape::VERTEX_COUNT] = {vertex<Shape>(Vs)...};
+            static constexpr Face faces[Shape::FACE_COUNT] = {Shape::face(Fs)...};
+            static constexpr PackedNormal faceNormals[Shape::FACE_COUNT] = {faceNormal<Shape>(Shape::face(Fs))...};
+        };
+
+        template <class Shape, uint16_t... Vs, uint16_t... Fs>
+        constexpr Vertex Tables<Shape, ConstMath::Indices<Vs...>, ConstMath::Indices<Fs...>>::vertices[Shape::VERTEX_COUNT];
+
+        template <class Shape, uint16_t... Vs, uint16_t... Fs>
+        constexpr Face Tables<Shape, ConstMath::Indices<Vs...>, ConstMath::Indices<Fs...>>::faces[Shape::FACE_COUNT];
+
+        template <class Shape, uint16_t... Vs, uint16_t... Fs>
+        constexpr PackedNormal Tables<Shape, ConstMath::Indices<Vs...>, ConstMath::Indices<Fs...>>::faceNormals[Shape::FACE_COUNT];
+
+        // Same layout as Cube, half-size 1.
+        struct CubeShape
+        {
+            static constexpr uint16_t VERTEX_COUNT = 8;
+            static constexpr uint16_t FACE_COUNT = 12;
+            static constexpr float BOUNDING_RADIUS = 1.7320508f;
+
+            static constexpr Point position(uint16_t i)
+            {
+                return Point(((i + 1) >> 1) & 1 ? 1.0 : -1.0,
+                             (i >> 1) & 1 ? 1.0 : -1.0,
+                             i >= 4 ? 1.0 : -1.0);
+            }
+
+            static constexpr Point normal(uint16_t i)
+            {
+                return position(i);
+            }
+
+            static constexpr Face face(uint16_t f)
+            {
+                return f == 0    ? Face(0, 2, 1)
+                       : f == 1  ? Face(0, 3, 2)
+                       : f == 2  ? Face(4, 5, 6)
+                       : f == 3  ? Face(4, 6, 7)
+                       : f == 4  ? Face(4, 3, 0)
+                       : f == 5  ? Face(4, 7, 3)
+                       : f == 6  ? Face(1, 2, 6)
+                       : f == 7  ? Face(1, 6, 5)
+                       : f == 8  ? Face(3, 7, 6)
+                       : f == 9  ? Face(3, 6, 2)
+                       : f == 10 ? Face(4, 0, 1)
+                                 : Face(4, 1, 5);
+            }
+        };
+
+        // Same layout as Sphere, radius 1: poles first and last, rings of
+        // SEGMENTS vertices in between.
+        template <uint8_t SEGMENTS, uint8_t RINGS>
+        struct SphereShape
+        {
+            static_assert(SEGMENTS >= 3 && RINGS >= 2, "sphere needs at least 3 segments and 2 rings");
+
+            static constexpr uint16_t VERTEX_COUNT = 2 + SEGMENTS * (RINGS - 1);
+            static constexpr uint16_t FACE_COUNT = 2 * SEGMENTS * (RINGS - 1);
+            static constexpr float BOUNDING_RADIUS = 1.0f;
+
+            static constexpr uint16_t LAST_RING = 1 + (RINGS - 2) * SEGMENTS;
+            static constexpr uint16_t BOTTOM = VERTEX_COUNT - 1;
+
+            static constexpr Point ringPoint(double phi, double theta)
+            {
+                return Point(ConstMath::sin(phi) * ConstMath::cos(theta),
+                             ConstMath::cos(phi),
+                             ConstMath::sin(phi) * ConstMath::sin(theta));
+            }
+
+            static constexpr Point position(uint16_t i)
+            {
+                return i == 0        ? Point(0.0, 1.0, 0.0)
+                       : i == BOTTOM ? Point(0.0, -1.0, 0.0)
+                                     : ringPoint(ConstMath::PI_D * (1 + (i - 1) / SEGMENTS) / RINGS,
+                                                 ConstMath::TWO_PI_D * ((i - 1) % SEGMENTS) / SEGMENTS);
+            }
+
+            static constexpr Point normal(uint16_t i)
+            {
+                return position(i);
+            }
+
+            static constexpr uint16_t next(uint16_t j)
+            {
+                return static_cast<uint16_t>((j + 1) % SEGMENTS);
+            }
+
+            // Quad strip between ring row and row + 1, two faces per segment.
+            static constexpr Face bandFace(uint16_t row, uint16_t k)
+            {
+                return (k & 1) == 0
+                           ? Face(1 + (row - 1) * SEGMENTS + k / 2, 1 + (row - 1) * SEGMENTS + next(k / 2), 1 + row * SEGMENTS + k / 2)
+                           : Face(1 + row * SEGMENTS + k / 2, 1 + (row - 1) * SEGMENTS + next(k / 2), 1 + row * SEGMENTS + next(k / 2));
+            }
+
+            static constexpr Face face(uint16_t f)
+            {
+                return f < SEGMENTS
+                           ? Face(0, 1 + next(f), 1 + f)
+                       : f < FACE_COUNT - SEGMENTS
+                           ? bandFace(1 + (f - SEGMENTS) / (2 * SEGMENTS), (f - SEGMENTS) % (2 * SEGMENTS))
+                           : Face(BOTTOM, LAST_RING + (f - (FACE_COUNT - SEGMENTS)), LAST_RING + next(f - (FACE_COUNT - SEGMENTS)));
+            }
+        };
+
+        // Same layout as Cylinder, radius 1 and height 2: cap centers first
+        // and last, top rim, bottom rim.
+        template <uint8_t SEGMENTS>
+        struct CylinderShape
+        {
+            static_assert(SEGMENTS >= 3, "cylinder needs at least 3 segments");
+
+            static constexpr uint16_t VERTEX_COUNT = 2 + 2 * SEGMENTS;
+            static constexpr uint16_t FACE_COUNT = 4 * SEGMENTS;
+            static constexpr float BOUNDING_RADIUS = 1.4142136f;
+
+            static constexpr uint16_t BOTTOM = VERTEX_COUNT - 1;
+
+            static constexpr Point rim(uint16_t j, double y)
+            {
+                return Point(ConstMath::cos(ConstMath::TWO_PI_D * j / SEGMENTS), y,
+                             ConstMath::sin(ConstMath::TWO_PI_D * j / SEGMENTS));
+            }
+
+            static constexpr Point position(uint16_t i)
+            {
+                return i == 0             ? Point(0.0, 1.0, 0.0)
+                       : i == BOTTOM      ? Point(0.0, -1.0, 0.0)
+                       : i <= SEGMENTS    ? rim(i - 1, 1.0)
+                                          : rim(i - 1 - SEGMENTS, -1.0);
+            }
+
+            // Rim vertices are shared by cap and side, so their normal leans
+            // halfway between the two.
+            static constexpr Point normal(uint16_t i)
+            {
+                return position(i);
+            }
+
+            static constexpr Face sideFace(uint16_t k, uint16_t i, uint16_t n)
+            {
+                return k == 0   ? Face(0, 1 + n, 1 + i)
+                       : k == 1 ? Face(BOTTOM, 1 + SEGMENTS + i, 1 + SEGMENTS + n)
+                       : k == 2 ? Face(1 + i, 1 + n, 1 + SEGMENTS + i)
+                                : Face(1 + n, 1 + SEGMENTS + n, 1 + SEGMENTS + i);
+            }
+
+            static constexpr Face face(uint16_t f)
+            {
+                return sideFace(f % 4, f / 4, static_cast<uint16_t>((f / 4 + 1) % SEGMENTS));
+            }
+        };
+
+        // Same layout as Plane, a square of side 2 in XZ facing +Y.
+        template <uint8_t DIVISIONS>
+        struct PlaneShape
+        {
+            static_assert(DIVISIONS >= 1, "plane needs at least one division");
+
+            static constexpr uint16_t PITCH = DIVISIONS + 1;
+            static constexpr uint16_t VERTEX_COUNT = PITCH * PITCH;
+            static constexpr uint16_t FACE_COUNT = 2 * DIVISIONS * DIVISIONS;
+            static constexpr float BOUNDING_RADIUS = 1.4142136f;
+
+            static constexpr Point position(uint16_t i)
+            {
+                return Point(-1.0 + 2.0 * (i % PITCH) / DIVISIONS, 0.0, -1.0 + 2.0 * (i / PITCH) / DIVISIONS);
+            }
+
+            static constexpr Point normal(uint16_t)
+            {
+                return Point(0.0, 1.0, 0.0);
+            }
+
+            static constexpr Face cellFace(uint16_t i, bool second)
+            {
+                return second ? Face(i + 1, i + PITCH, i + PITCH + 1) : Face(i, i + PITCH, i + 1);
+            }
+
+            static constexpr Face face(uint16_t f)
+            {
+                return cellFace((f / 2) / DIVISIONS * PITCH + (f / 2) % DIVISIONS, (f & 1) != 0);
+            }
+        };
+
+    }
+
+    // Mesh over the flash tables of one shape. extent is the world size of
+    // one shape unit.
+    template <class Shape>
+    class StaticPrimitive : public Mesh
+    {
+    private:
+        typedef StaticGeometry::Tables<Shape> Data;
+
+    public:
+        StaticPrimitive(float extent, const Color &color)
+            : Mesh(Data::vertices, Shape::VERTEX_COUNT, Data::faces, Shape::FACE_COUNT, color, true)
+        {
+            setQuantScale(extent / 32767.0f);
+#if PIP3D_MESH_FACE_NORMALS
+            setFaceNormals(Data::faceNormals);
+#endif
+            setBoundingSphere(Vector3(0, 0, 0), extent * Shape::BOUNDING_RADIUS);
+            updateTransform();
+        }
+    };
+
+    class StaticCube : public StaticPrimitive<StaticGeometry::CubeShape>
+    {
+    public:
+        explicit StaticCube(float size = 1.0f, const Color &color = Color::WHITE)
+            : StaticPrimitive<StaticGeometry::CubeShape>(size * 0.5f, color)
+        {
+        }
+    };
+
+    template <uint8_t SEGMENTS = 16, uint8_t RINGS = 12>
+    class StaticSphere : public StaticPrimitive<StaticGeometry::SphereShape<SEGMENTS, RINGS>>
+    {
+    public:
+        explicit StaticSphere(float radius = 1.0f, const Color &color = Color::WHITE)
+            : StaticPrimitive<StaticGeometry::SphereShape<SEGMENTS, RINGS>>(radius, color)
+        {
+        }
+    };
+
+    // Height is twice the radius; scale the mesh for other proportions.
+    template <uint8_t SEGMENTS = 16>
+    class StaticCylinder : public StaticPrimitive<StaticGeometry::CylinderShape<SEGMENTS>>
+    {
+    public:
+        explicit StaticCylinder(float radius = 1.0f, const Color &color = Color::WHITE)
+            : StaticPrimitive<StaticGeometry::CylinderShape<SEGMENTS>>(radius, color)
+        {
+        }
+    };
+
+    template <uint8_t DIVISIONS = 1>
+    class StaticPlane : public StaticPrimitive<StaticGeometry::PlaneShape<DIVISIONS>>
+    {
+    public:
+        explicit StaticPlane(float size = 2.0f, const Color &color = Color::WHITE)
+            : StaticPrimitive<StaticGeometry::PlaneShape<DIVISIONS>>(size * 0.5f, color)
+        {
+        }
+    };
+
+}
+
+#endif
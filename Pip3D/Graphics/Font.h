@@ -14,37 +14,43 @@ namespace pip3D
         static constexpr uint8_t FONT_HEIGHT = 7;
         static constexpr uint8_t CHAR_SPACING = 1;
 
-        static const uint8_t font5x7[95][5];
+        static const uint8_t glyphRows[95][7];
 
     public:
-        static __attribute__((always_inline)) inline void drawChar(uint16_t *framebuffer, int16_t x, int16_t y,
-                                                                   char c, uint16_t color, int16_t screenWidth, int16_t screenHeight)
+        // Row masks of c, FONT_HEIGHT bytes; bit n is column n.
+        static __attribute__((always_inline)) inline const uint8_t *glyph(char c)
         {
             if (c < 32 || c > 126)
                 c = '?';
+            return glyphRows[c - 32];
+        }
 
+        static __attribute__((always_inline)) inline void drawChar(uint16_t *framebuffer, int16_t x, int16_t y,
+                                                                   char c, uint16_t color, int16_t screenWidth, int16_t screenHeight)
+        {
             if (x >= screenWidth || y >= screenHeight ||
                 x + FONT_WIDTH <= 0 || y + FONT_HEIGHT <= 0)
                 return;
 
-            const uint8_t *glyph = font5x7[c - 32];
+            // Clip once per glyph; rows then only visit set bits.
+            const int16_t row0 = y < 0 ? static_cast<int16_t>(-y) : 0;
+            const int16_t row1 = y + FONT_HEIGHT > screenHeight ? static_cast<int16_t>(screenHeight - y) : FONT_HEIGHT;
+            uint8_t colMask = 0x1F;
+            if (x < 0)
+                colMask &= static_cast<uint8_t>(0x1F << -x);
+            if (x + FONT_WIDTH > screenWidth)
+                colMask &= static_cast<uint8_t>((1u << (screenWidth - x)) - 1u);
 
-            for (uint8_t col = 0; col < FONT_WIDTH; col++)
+            const uint8_t *rows = glyph(c);
+            const uint16_t pixel = PixelFormat::encode(color);
+            uint16_t *line = framebuffer + static_cast<int32_t>(y + row0) * screenWidth;
+            for (int16_t row = row0; row < row1; ++row, line += screenWidth)
             {
-                uint8_t line = glyph[col];
-                if (!line)
-                    continue;
-                for (uint8_t row = 0; row < FONT_HEIGHT; row++)
+                uint32_t bits = rows[row] & colMask;
+                while (bits)
                 {
-                    if (line & (1 << row))
-                    {
-                        int16_t px = x + col;
-                        int16_t py = y + row;
-                        if (px >= 0 && px < screenWidth && py >= 0 && py < screenHeight)
-                        {
-                            framebuffer[py * screenWidth + px] = color;
-                        }
-                    }
+                    line[x + __builtin_ctz(bits)] = pixel;
+                    bits &= bits - 1;
                 }
             }
         }
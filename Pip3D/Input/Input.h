@@ -4,6 +4,16 @@
 #include <Arduino.h>
 #include <math.h>
 
+// Samples axes with the ADC continuous (DMA) driver and debounces buttons
+// from GPIO interrupts, leaving update() a read of published values.
+#ifndef PIP3D_INPUT_SAMPLED
+#define PIP3D_INPUT_SAMPLED 0
+#endif
+
+#if PIP3D_INPUT_SAMPLED
+#include "InputSampler.h"
+#endif
+
 namespace pip3D
 {
     namespace input
@@ -28,6 +38,10 @@ namespace pip3D
             bool justReleasedFlag;
             uint32_t lastChangeTime;
             bool initialized;
+#if PIP3D_INPUT_SAMPLED
+            int8_t slot;
+            uint32_t seenTransitions;
+#endif
 
         public:
             constexpr Button(const ButtonConfig &c = ButtonConfig())
@@ -38,6 +52,11 @@ namespace pip3D
                   justReleasedFlag(false),
                   lastChangeTime(0),
                   initialized(false)
+#if PIP3D_INPUT_SAMPLED
+                  ,
+                  slot(-1),
+                  seenTransitions(0)
+#endif
             {
             }
 
@@ -53,6 +72,15 @@ namespace pip3D
                 justPressedFlag = false;
                 justReleasedFlag = false;
                 initialized = true;
+#if PIP3D_INPUT_SAMPLED
+                slot = GpioSampler::instance().addButton(cfg.pin, cfg.activeLow, cfg.debounceMs);
+                if (slot >= 0)
+                {
+                    seenTransitions = 0;
+                    stableState = GpioSampler::instance().slot(slot).stableFrom(0);
+                    lastStableState = stableState;
+                }
+#endif
             }
 
         private:
@@ -63,11 +91,41 @@ namespace pip3D
                 return pressed;
             }
 
+#if PIP3D_INPUT_SAMPLED
+            // Presses and releases shorter than a frame are still reported.
+            __attribute__((always_inline)) inline void updateSampled()
+            {
+                GpioSampler::Slot &s = GpioSampler::instance().slot(slot);
+                const bool raw = s.raw.load(std::memory_order_relaxed);
+                if (raw != s.stableFrom(s.transitions.load(std::memory_order_acquire)))
+                {
+                    const uint32_t now = static_cast<uint32_t>(esp_timer_get_time());
+                    if (now - s.lastEdgeUs.load(std::memory_order_acquire) >= s.debounceUs)
+                        s.tryAccept(raw, now);
+                }
+
+                const uint32_t t = s.transitions.load(std::memory_order_acquire);
+                const uint32_t delta = t - seenTransitions;
+                seenTransitions = t;
+                lastStableState = stableState;
+                stableState = s.stableFrom(t);
+                justPressedFlag = delta >= 2 || (delta == 1 && stableState);
+                justReleasedFlag = delta >= 2 || (delta == 1 && !stableState);
+            }
+#endif
+
         public:
             __attribute__((always_inline)) inline void update()
             {
                 if (!initialized)
                     return;
+#if PIP3D_INPUT_SAMPLED
+                if (slot >= 0)
+                {
+                    updateSampled();
+                    return;
+                }
+#endif
 
                 bool raw = readRaw();
                 uint32_t now = millis();
@@ -130,10 +188,17 @@ namespace pip3D
             float rangeInv;
             float deadZone;
             float invDeadSpan;
+#if PIP3D_INPUT_SAMPLED
+            int8_t slot;
+#endif
 
         public:
             constexpr AnalogAxis(const AnalogAxisConfig &c = AnalogAxisConfig())
                 : cfg(c), filtered(0.0f), initialized(false), rangeInv(0.0f), deadZone(c.deadZone), invDeadSpan(1.0f)
+#if PIP3D_INPUT_SAMPLED
+                  ,
+                  slot(-1)
+#endif
             {
             }
 
@@ -160,6 +225,9 @@ namespace pip3D
                     deadZone = 0.999f;
                 float span = 1.0f - deadZone;
                 invDeadSpan = (span > 1e-6f) ? (1.0f / span) : 1.0f;
+#if PIP3D_INPUT_SAMPLED
+                slot = AdcSampler::instance().addPin(cfg.pin);
+#endif
             }
 
             __attribute__((always_inline)) inline float update(float deltaTime)
@@ -167,7 +235,22 @@ namespace pip3D
                 if (!initialized)
                     return filtered;
 
+#if PIP3D_INPUT_SAMPLED
+                int raw;
+                if (slot >= 0)
+                {
+                    const uint16_t sample = AdcSampler::instance().read(slot);
+                    if (sample == AdcSampler::NO_SAMPLE)
+                        return filtered;
+                    raw = sample;
+                }
+                else
+                {
+                    raw = analogRead(cfg.pin);
+                }
+#else
                 int raw = analogRead(cfg.pin);
+#endif
                 float v = 0.0f;
                 if (rangeInv > 0.0f)
                 {
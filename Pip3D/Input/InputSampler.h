@@ -0,0 +1,318 @@
+#ifndef PIP3D_INPUT_SAMPLER_H
+#define PIP3D_INPUT_SAMPLER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <esp_adc/adc_continuous.h>
+#include <driver/gpio.h>
+#include <esp_timer.h>
+#include <esp_idf_version.h>
+
+#include "../Core/Debug/Logging.h"
+
+// Conversions per second over all sampled ADC channels.
+#ifndef PIP3D_INPUT_ADC_SAMPLE_HZ
+#define PIP3D_INPUT_ADC_SAMPLE_HZ 20000
+#endif
+// DMA frame size; one ISR per frame averages each channel.
+#ifndef PIP3D_INPUT_ADC_FRAME_BYTES
+#define PIP3D_INPUT_ADC_FRAME_BYTES 256
+#endif
+#ifndef PIP3D_INPUT_MAX_ADC_CHANNELS
+#define PIP3D_INPUT_MAX_ADC_CHANNELS 8
+#endif
+#ifndef PIP3D_INPUT_MAX_BUTTONS
+#define PIP3D_INPUT_MAX_BUTTONS 16
+#endif
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define PIP3D_ADC_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define PIP3D_ADC_RESULT_CHANNEL(d) ((d)->type1.channel)
+#define PIP3D_ADC_RESULT_DATA(d) ((d)->type1.data)
+#else
+#define PIP3D_ADC_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define PIP3D_ADC_RESULT_CHANNEL(d) ((d)->type2.channel)
+#define PIP3D_ADC_RESULT_DATA(d) ((d)->type2.data)
+#endif
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+#define PIP3D_ADC_ATTEN ADC_ATTEN_DB_12
+#else
+#define PIP3D_ADC_ATTEN ADC_ATTEN_DB_11
+#endif
+
+namespace pip3D
+{
+    namespace input
+    {
+        // ADC1 converts the registered pins continuously into DMA; the
+        // frame-done ISR averages each channel and publishes the result, so
+        // reading an axis is one atomic load. The driver owns ADC1 while it
+        // runs: do not analogRead ADC1 pins alongside it.
+        class AdcSampler
+        {
+        public:
+            // Until the first DMA frame arrives.
+            static constexpr uint16_t NO_SAMPLE = 0xFFFF;
+
+            static AdcSampler &instance()
+            {
+                static AdcSampler sampler;
+                return sampler;
+            }
+
+            // Slot to read the pin from, or -1 when it is not an ADC1 pin or
+            // the driver failed; the caller then falls back to analogRead.
+            int8_t addPin(uint8_t pin)
+            {
+                adc_unit_t unit;
+                adc_channel_t channel;
+                if (adc_continuous_io_to_channel(pin, &unit, &channel) != ESP_OK || unit != ADC_UNIT_1)
+                    return -1;
+
+                for (uint8_t i = 0; i < channelCount; ++i)
+                {
+                    if (channels[i] == channel)
+                        return static_cast<int8_t>(i);
+                }
+                if (channelCount >= PIP3D_INPUT_MAX_ADC_CHANNELS)
+                {
+                    LOGW(::pip3D::Debug::LOG_MODULE_CORE,
+                         "AdcSampler: channel limit reached, pin %u falls back to analogRead",
+                         static_cast<unsigned int>(pin));
+                    return -1;
+                }
+
+                const uint8_t slot = channelCount++;
+                channels[slot] = static_cast<uint8_t>(channel);
+                slotOfChannel[channel & 15] = static_cast<int8_t>(slot);
+                values[slot].store(NO_SAMPLE, std::memory_order_relaxed);
+                if (!restart())
+                {
+                    --channelCount;
+                    slotOfChannel[channel & 15] = -1;
+                    if (channelCount > 0)
+                        restart();
+                    return -1;
+                }
+                return static_cast<int8_t>(slot);
+            }
+
+            // Latest frame average in raw 12-bit counts, or NO_SAMPLE.
+            __attribute__((always_inline)) inline uint16_t read(int8_t slot) const
+            {
+                return values[slot].load(std::memory_order_relaxed);
+            }
+
+        private:
+            adc_continuous_handle_t handle;
+            bool running;
+            uint8_t channelCount;
+            uint8_t channels[PIP3D_INPUT_MAX_ADC_CHANNELS];
+            int8_t slotOfChannel[16];
+            std::atomic<uint16_t> values[PIP3D_INPUT_MAX_ADC_CHANNELS];
+
+            AdcSampler() : handle(nullptr), running(false), channelCount(0)
+            {
+                for (uint8_t i = 0; i < 16; ++i)
+                    slotOfChannel[i] = -1;
+                for (uint8_t i = 0; i < PIP3D_INPUT_MAX_ADC_CHANNELS; ++i)
+                {
+                    channels[i] = 0;
+                    values[i].store(NO_SAMPLE, std::memory_order_relaxed);
+                }
+            }
+
+            AdcSampler(const AdcSampler &) = delete;
+            AdcSampler &operator=(const AdcSampler &) = delete;
+
+            // The pattern can only change while stopped; pins are added from
+            // setup, so a restart per pin is fine.
+            bool restart()
+            {
+                if (!handle)
+                {
+                    adc_continuous_handle_cfg_t handleCfg = {};
+                    handleCfg.max_store_buf_size = PIP3D_INPUT_ADC_FRAME_BYTES * 2;
+                    handleCfg.conv_frame_size = PIP3D_INPUT_ADC_FRAME_BYTES;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+                    // Results are consumed in the ISR, never read from the pool.
+                    handleCfg.flags.flush_pool = 1;
+#endif
+                    if (adc_continuous_new_handle(&handleCfg, &handle) != ESP_OK)
+                    {
+                        handle = nullptr;
+                        LOGE(::pip3D::Debug::LOG_MODULE_CORE, "AdcSampler: adc_continuous_new_handle failed");
+                        return false;
+                    }
+
+                    adc_continuous_evt_cbs_t cbs = {};
+                    cbs.on_conv_done = onFrame;
+                    adc_continuous_register_event_callbacks(handle, &cbs, this);
+                }
+                else if (running)
+                {
+                    adc_continuous_stop(handle);
+                    running = false;
+                }
+
+                adc_digi_pattern_config_t pattern[PIP3D_INPUT_MAX_ADC_CHANNELS] = {};
+                for (uint8_t i = 0; i < channelCount; ++i)
+                {
+                    pattern[i].atten = PIP3D_ADC_ATTEN;
+                    pattern[i].channel = channels[i];
+                    pattern[i].unit = ADC_UNIT_1;
+                    pattern[i].bit_width = ADC_BITWIDTH_12;
+                }
+
+                adc_continuous_config_t cfg = {};
+                cfg.pattern_num = channelCount;
+                cfg.adc_pattern = pattern;
+                cfg.sample_freq_hz = PIP3D_INPUT_ADC_SAMPLE_HZ;
+                cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+                cfg.format = PIP3D_ADC_OUTPUT_FORMAT;
+
+                if (adc_continuous_config(handle, &cfg) != ESP_OK || adc_continuous_start(handle) != ESP_OK)
+                {
+                    LOGE(::pip3D::Debug::LOG_MODULE_CORE,
+                         "AdcSampler: failed to start continuous conversion (%u channels)",
+                         static_cast<unsigned int>(channelCount));
+                    return false;
+                }
+                running = true;
+                return true;
+            }
+
+            static bool IRAM_ATTR onFrame(adc_continuous_handle_t, const adc_continuous_evt_data_t *edata, void *ctx)
+            {
+                AdcSampler *self = static_cast<AdcSampler *>(ctx);
+                uint32_t sum[PIP3D_INPUT_MAX_ADC_CHANNELS] = {};
+                uint16_t count[PIP3D_INPUT_MAX_ADC_CHANNELS] = {};
+
+                const uint32_t stride = sizeof(adc_digi_output_data_t);
+                for (uint32_t offset = 0; offset + stride <= edata->size; offset += stride)
+                {
+                    const adc_digi_output_data_t *d =
+                        reinterpret_cast<const adc_digi_output_data_t *>(edata->conv_frame_buffer + offset);
+                    const int8_t slot = self->slotOfChannel[PIP3D_ADC_RESULT_CHANNEL(d) & 15];
+                    if (slot < 0)
+                        continue;
+                    sum[slot] += PIP3D_ADC_RESULT_DATA(d);
+                    ++count[slot];
+                }
+
+                for (uint8_t i = 0; i < self->channelCount; ++i)
+                {
+                    if (count[i])
+                        self->values[i].store(static_cast<uint16_t>(sum[i] / count[i]), std::memory_order_relaxed);
+                }
+                return false;
+            }
+        };
+
+        // Buttons debounced from GPIO edge interrupts. Each slot keeps one
+        // atomic counter of accepted transitions, its parity being the
+        // stable state; the ISR accepts the leading edge of a bounce burst,
+        // and the frame side accepts a level the burst settled on once it
+        // has been quiet for the debounce time. Both sides accept with a
+        // CAS, so neither takes a lock.
+        class GpioSampler
+        {
+        public:
+            struct Slot
+            {
+                uint8_t pin;
+                bool activeLow;
+                bool initialPressed;
+                uint32_t debounceUs;
+                std::atomic<bool> raw;
+                std::atomic<uint32_t> lastEdgeUs;
+                std::atomic<uint32_t> acceptedUs;
+                std::atomic<uint32_t> transitions;
+
+                __attribute__((always_inline)) inline bool stableFrom(uint32_t t) const
+                {
+                    return initialPressed != ((t & 1u) != 0);
+                }
+
+                // Moves the stable state to pressed unless it already is or
+                // the last accepted transition is younger than the debounce.
+                __attribute__((always_inline)) inline void IRAM_ATTR tryAccept(bool pressed, uint32_t now)
+                {
+                    uint32_t t = transitions.load(std::memory_order_acquire);
+                    while (stableFrom(t) != pressed &&
+                           now - acceptedUs.load(std::memory_order_relaxed) >= debounceUs)
+                    {
+                        if (transitions.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel))
+                        {
+                            acceptedUs.store(now, std::memory_order_relaxed);
+                            return;
+                        }
+                    }
+                }
+            };
+
+            static GpioSampler &instance()
+            {
+                static GpioSampler sampler;
+                return sampler;
+            }
+
+            // Slot for the button, or -1 when every slot is taken.
+            int8_t addButton(uint8_t pin, bool activeLow, uint16_t debounceMs)
+            {
+                if (slotCount >= PIP3D_INPUT_MAX_BUTTONS)
+                {
+                    LOGW(::pip3D::Debug::LOG_MODULE_CORE,
+                         "GpioSampler: button limit reached, pin %u is polled",
+                         static_cast<unsigned int>(pin));
+                    return -1;
+                }
+
+                Slot &s = slots[slotCount];
+                s.pin = pin;
+                s.activeLow = activeLow;
+                s.debounceUs = static_cast<uint32_t>(debounceMs) * 1000u;
+                const uint32_t now = static_cast<uint32_t>(esp_timer_get_time());
+                const bool pressed = readPressed(s);
+                s.initialPressed = pressed;
+                s.raw.store(pressed, std::memory_order_relaxed);
+                s.lastEdgeUs.store(now, std::memory_order_relaxed);
+                s.acceptedUs.store(now - s.debounceUs, std::memory_order_relaxed);
+                s.transitions.store(0, std::memory_order_release);
+
+                attachInterruptArg(pin, onEdge, &s, CHANGE);
+                return static_cast<int8_t>(slotCount++);
+            }
+
+            __attribute__((always_inline)) inline Slot &slot(int8_t index) { return slots[index]; }
+
+        private:
+            Slot slots[PIP3D_INPUT_MAX_BUTTONS];
+            uint8_t slotCount;
+
+            GpioSampler() : slotCount(0) {}
+
+            GpioSampler(const GpioSampler &) = delete;
+            GpioSampler &operator=(const GpioSampler &) = delete;
+
+            static __attribute__((always_inline)) inline bool IRAM_ATTR readPressed(const Slot &s)
+            {
+                const bool high = gpio_get_level(static_cast<gpio_num_t>(s.pin)) != 0;
+                return s.activeLow ? !high : high;
+            }
+
+            static void IRAM_ATTR onEdge(void *arg)
+            {
+                Slot *s = static_cast<Slot *>(arg);
+                const bool pressed = readPressed(*s);
+                const uint32_t now = static_cast<uint32_t>(esp_timer_get_time());
+                s->raw.store(pressed, std::memory_order_relaxed);
+                s->lastEdgeUs.store(now, std::memory_order_release);
+                s->tryAccept(pressed, now);
+            }
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef CONSTMATH_H
+#define CONSTMATH_H
+
+#include <stdint.h>
+
+namespace pip3D
+{
+
+    // Compile-time math for tables that are emitted as const data and stay
+    // in flash. C++11 constexpr only: one return statement per function,
+    // recursion instead of loops, double precision throughout.
+    namespace ConstMath
+    {
+
+        template <uint16_t... Is>
+        struct Indices
+        {
+        };
+
+        template <class A, class B>
+        struct JoinIndices;
+
+        template <uint16_t... As, uint16_t... Bs>
+        struct JoinIndices<Indices<As...>, Indices<Bs...>>
+        {
+            typedef Indices<As..., static_cast<uint16_t>(sizeof...(As) + Bs)...> type;
+        };
+
+        // Indices<0, 1, ..., N - 1>, for expanding a table initializer. Built
+        // by halving, so large tables stay within the template depth limit.
+        template <uint16_t N>
+        struct MakeIndices
+        {
+            typedef typename JoinIndices<typename MakeIndices<N / 2>::type,
+                                         typename MakeIndices<N - N / 2>::type>::type type;
+        };
+
+        template <>
+        struct MakeIndices<0>
+        {
+            typedef Indices<> type;
+        };
+
+        template <>
+        struct MakeIndices<1>
+        {
+            typedef Indices<0> type;
+        };
+
+        constexpr double PI_D = 3.14159265358979323846;
+        constexpr double TWO_PI_D = 2.0 * PI_D;
+
+        constexpr double abs(double x)
+        {
+            return x < 0.0 ? -x : x;
+        }
+
+        constexpr double sign(double x)
+        {
+            return x >= 0.0 ? 1.0 : -1.0;
+        }
+
+        constexpr double sqrtStep(double x, double guess, int steps)
+        {
+            return steps == 0 ? guess : sqrtStep(x, 0.5 * (guess + x / guess), steps - 1);
+        }
+
+        // Newton from a guess above the root; 24 steps cover [0, 1e6].
+        constexpr double sqrt(double x)
+        {
+            return x <= 0.0 ? 0.0 : sqrtStep(x, x > 1.0 ? x : 1.0, 24);
+        }
+
+        constexpr double sinSeries(double x2, double term, double sum, int k)
+        {
+            return k > 12 ? sum
+                          : sinSeries(x2, -term * x2 / ((2 * k) * (2 * k + 1)), sum + term, k + 1);
+        }
+
+        // x is reduced to [-pi, pi] first; the series is exact to double
+        // precision there.
+        constexpr double sinReduced(double x)
+        {
+            return sinSeries(x * x, x, 0.0, 1);
+        }
+
+        constexpr double wrap(double x)
+        {
+            return x > PI_D ? wrap(x - TWO_PI_D) : (x < -PI_D ? wrap(x + TWO_PI_D) : x);
+        }
+
+        constexpr double sin(double x)
+        {
+            return sinReduced(wrap(x));
+        }
+
+        constexpr double cos(double x)
+        {
+            return sin(x + 0.5 * PI_D);
+        }
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,373 @@
+#ifndef PIP3D_PHYSICS_BATCHSOLVER_H
+#define PIP3D_PHYSICS_BATCHSOLVER_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "../Core/FrameArena.h"
+#include "Contacts.h"
+#include "Islands.h"
+
+// Default for PhysicsWorld::setBatchedSolver().
+#ifndef PIP3D_PHYSICS_BATCHED_SOLVER
+#define PIP3D_PHYSICS_BATCHED_SOLVER 0
+#endif
+
+// Open batches a contact point is tried against before it starts a new one.
+#ifndef PIP3D_PHYSICS_BATCH_WINDOW
+#define PIP3D_PHYSICS_BATCH_WINDOW 8
+#endif
+
+namespace pip3D
+{
+
+    // Four contact points that share no dynamic body, laid out lane by lane
+    // so one pass solves them together.
+    struct alignas(16) ContactBatch
+    {
+        static constexpr int LANES = 4;
+
+        float nx[LANES], ny[LANES], nz[LANES];
+        float rax[LANES], ray[LANES], raz[LANES];
+        float rbx[LANES], rby[LANES], rbz[LANES];
+        float normalMass[LANES];
+        float bias[LANES];
+        float impulse[LANES];
+        float friction[LANES];
+        float invMassSum[LANES];
+        uint16_t bodyA[LANES];
+        uint16_t bodyB[LANES];
+        // Contact constraint index * 4 + point, for writing impulses back.
+        uint32_t source[LANES];
+        uint8_t count;
+    };
+
+    // Velocity state the contact solver reads and writes, packed so one
+    // gather touches a single cache line.
+    struct alignas(16) SolverBody
+    {
+        float vx, vy, vz, invMass;
+        float wx, wy, wz, pad0;
+        float iix, iiy, iiz, pad1;
+    };
+
+    // Contact solver over packed solver bodies and structure-of-arrays
+    // contact batches. prepare() colors the contact points of the awake
+    // islands into batches, one run of batches per solver worker; the
+    // islands of a worker share no dynamic body, so they batch together.
+    // A worker then copies its bodies into solver bodies, iterates on those
+    // only and writes back at the end. Static and kinematic sides get a
+    // read-only copy per contact, so they never join the coloring.
+    class BatchSolver
+    {
+    public:
+        static constexpr int GROUPS = 2;
+
+    private:
+        static constexpr uint16_t NO_SLOT = 0xFFFF;
+
+        struct BatchRange
+        {
+            uint32_t begin;
+            uint32_t end;
+        };
+
+        std::vector<SolverBody> solverBodies;
+        std::vector<uint16_t> bodySlot;
+        std::vector<ContactBatch> batches;
+        BatchRange groups[GROUPS];
+        bool prepared;
+
+        void loadBody(uint16_t slot, const RigidBody *b)
+        {
+            SolverBody &s = solverBodies[slot];
+            s.vx = b->velocity.x;
+            s.vy = b->velocity.y;
+            s.vz = b->velocity.z;
+            s.invMass = b->invMass;
+            s.wx = b->angularVelocity.x;
+            s.wy = b->angularVelocity.y;
+            s.wz = b->angularVelocity.z;
+            s.iix = b->invInertia.x;
+            s.iiy = b->invInertia.y;
+            s.iiz = b->invInertia.z;
+        }
+
+        // Read-only copy of a static or kinematic side; impulses on it
+        // scale by zero.
+        void loadFixedBody(uint16_t slot, const RigidBody *b)
+        {
+            loadBody(slot, b);
+            SolverBody &s = solverBodies[slot];
+            s.invMass = 0.0f;
+            s.iix = s.iiy = s.iiz = 0.0f;
+        }
+
+        static bool sharesBody(const ContactBatch &batch, uint16_t a, uint16_t b)
+        {
+            for (int l = 0; l < batch.count; ++l)
+            {
+                if (batch.bodyA[l] == a || batch.bodyB[l] == a ||
+                    batch.bodyA[l] == b || batch.bodyB[l] == b)
+                    return true;
+            }
+            return false;
+        }
+
+        static __attribute__((always_inline)) inline void applyImpulse(SolverBody &a, SolverBody &b,
+                                                                      const ContactBatch &batch, int l,
+                                                                      float px, float py, float pz)
+        {
+            const float rax = batch.rax[l], ray = batch.ray[l], raz = batch.raz[l];
+            const float rbx = batch.rbx[l], rby = batch.rby[l], rbz = batch.rbz[l];
+            a.vx -= px * a.invMass, a.vy -= py * a.invMass, a.vz -= pz * a.invMass;
+            a.wx -= (ray * pz - raz * py) * a.iix;
+            a.wy -= (raz * px - rax * pz) * a.iiy;
+            a.wz -= (rax * py - ray * px) * a.iiz;
+            b.vx += px * b.invMass, b.vy += py * b.invMass, b.vz += pz * b.invMass;
+            b.wx += (rby * pz - rbz * py) * b.iix;
+            b.wy += (rbz * px - rbx * pz) * b.iiy;
+            b.wz += (rbx * py - rby * px) * b.iiz;
+        }
+
+        // Same normal and friction update as PhysicsWorld::resolveCollision.
+        // The lanes touch distinct bodies, so their order does not matter
+        // and a SIMD target can run them side by side.
+        static void solveBatch(ContactBatch &batch, SolverBody *bodies)
+        {
+            for (int l = 0; l < batch.count; ++l)
+            {
+                SolverBody a = bodies[batch.bodyA[l]];
+                SolverBody b = bodies[batch.bodyB[l]];
+                const float nx = batch.nx[l], ny = batch.ny[l], nz = batch.nz[l];
+                const float rax = batch.rax[l], ray = batch.ray[l], raz = batch.raz[l];
+                const float rbx = batch.rbx[l], rby = batch.rby[l], rbz = batch.rbz[l];
+
+                // Normal impulse, clamped on the accumulated total.
+                float rx = (b.vx + b.wy * rbz - b.wz * rby) - (a.vx + a.wy * raz - a.wz * ray);
+                float ry = (b.vy + b.wz * rbx - b.wx * rbz) - (a.vy + a.wz * rax - a.wx * raz);
+                float rz = (b.vz + b.wx * rby - b.wy * rbx) - (a.vz + a.wx * ray - a.wy * rax);
+                const float vn = rx * nx + ry * ny + rz * nz;
+
+                const float oldImpulse = batch.impulse[l];
+                float total = oldImpulse - (vn + batch.bias[l]) * batch.normalMass[l];
+                if (total < 0.0f)
+                    total = 0.0f;
+                batch.impulse[l] = total;
+                const float delta = total - oldImpulse;
+                if (delta == 0.0f)
+                    continue;
+                applyImpulse(a, b, batch, l, nx * delta, ny * delta, nz * delta);
+
+                // Friction along the remaining sliding direction.
+                rx = (b.vx + b.wy * rbz - b.wz * rby) - (a.vx + a.wy * raz - a.wz * ray);
+                ry = (b.vy + b.wz * rbx - b.wx * rbz) - (a.vy + a.wz * rax - a.wx * raz);
+                rz = (b.vz + b.wx * rby - b.wy * rbx) - (a.vz + a.wx * ray - a.wy * rax);
+                const float rn = rx * nx + ry * ny + rz * nz;
+                float tx = rx - nx * rn, ty = ry - ny * rn, tz = rz - nz * rn;
+                const float tLenSq = tx * tx + ty * ty + tz * tz;
+                if (tLenSq > 1e-8f)
+                {
+                    const float invTL = FastMath::fastInvSqrt(tLenSq);
+                    tx *= invTL, ty *= invTL, tz *= invTL;
+
+                    const float iaX = a.iix * (ray * tz - raz * ty);
+                    const float iaY = a.iiy * (raz * tx - rax * tz);
+                    const float iaZ = a.iiz * (rax * ty - ray * tx);
+                    const float ibX = b.iix * (rby * tz - rbz * ty);
+                    const float ibY = b.iiy * (rbz * tx - rbx * tz);
+                    const float ibZ = b.iiz * (rbx * ty - rby * tx);
+                    const float angular = (iaY * raz - iaZ * ray) * tx + (iaZ * rax - iaX * raz) * ty + (iaX * ray - iaY * rax) * tz +
+                                          (ibY * rbz - ibZ * rby) * tx + (ibZ * rbx - ibX * rbz) * ty + (ibX * rby - ibY * rbx) * tz;
+                    const float denom = batch.invMassSum[l] + angular;
+                    if (denom > 0.0f)
+                    {
+                        float jt = -(rx * tx + ry * ty + rz * tz) / denom;
+                        const float maxFriction = batch.friction[l] * total;
+                        if (jt > maxFriction)
+                            jt = maxFriction;
+                        if (jt < -maxFriction)
+                            jt = -maxFriction;
+                        applyImpulse(a, b, batch, l, tx * jt, ty * jt, tz * jt);
+                    }
+                }
+
+                bodies[batch.bodyA[l]] = a;
+                bodies[batch.bodyB[l]] = b;
+            }
+        }
+
+    public:
+        BatchSolver()
+            : groups(), prepared(false) {}
+
+        BatchSolver(const BatchSolver &) = delete;
+        BatchSolver &operator=(const BatchSolver &) = delete;
+
+        // Builds the batches of every awake island from the pre-stepped,
+        // warm-started contacts, grouped by PhysicsIsland::worker. Returns
+        // true when storage had to grow. Runs on one thread; the per-group
+        // calls below may then run on any core, one group each.
+        bool prepare(const std::vector<RigidBody *> &bodies,
+                     const ArenaArray<PhysicsIsland> &islands,
+                     const ArenaArray<uint16_t> &islandBodies,
+                     const ArenaArray<uint32_t> &islandContacts,
+                     const ArenaArray<CollisionInfo> &contacts)
+        {
+            const size_t bodyCount = bodies.size();
+            const size_t islandCount = islands.size();
+            const size_t capacities[3] = {solverBodies.capacity(), bodySlot.capacity(), batches.capacity()};
+
+            // One slot per island body, then one fixed copy per contact.
+            const size_t slots = islandBodies.size() + islandContacts.size();
+            prepared = slots < NO_SLOT;
+            if (!prepared)
+                return false;
+
+            if (solverBodies.size() < slots)
+                solverBodies.resize(slots);
+            bodySlot.assign(bodyCount, NO_SLOT);
+            batches.clear();
+
+            const uint16_t fixedBase = static_cast<uint16_t>(islandBodies.size());
+            for (int g = 0; g < GROUPS; ++g)
+            {
+                BatchRange &range = groups[g];
+                range.begin = static_cast<uint32_t>(batches.size());
+                for (size_t k = 0; k < islandCount; ++k)
+                {
+                    const PhysicsIsland &island = islands[k];
+                    if (island.sleeping || island.worker != g)
+                        continue;
+
+                    for (uint32_t m = island.bodyBegin; m < island.bodyEnd; ++m)
+                        bodySlot[islandBodies[m]] = static_cast<uint16_t>(m);
+
+                    for (uint32_t m = island.contactBegin; m < island.contactEnd; ++m)
+                    {
+                        const uint32_t ci = islandContacts[m];
+                        const CollisionInfo &info = contacts[ci];
+                        const RigidBody *a = info.bodyA;
+                        const RigidBody *b = info.bodyB;
+                        const uint16_t fixedSlot = static_cast<uint16_t>(fixedBase + m);
+
+                        auto slotOf = [&](const RigidBody *body)
+                        {
+                            if (body->solverIndex < bodyCount && bodies[body->solverIndex] == body &&
+                                bodySlot[body->solverIndex] != NO_SLOT)
+                                return bodySlot[body->solverIndex];
+                            loadFixedBody(fixedSlot, body);
+                            return fixedSlot;
+                        };
+                        const uint16_t slotA = slotOf(a);
+                        const uint16_t slotB = slotOf(b);
+                        const float invMassSum = a->invMass + b->invMass;
+                        if (invMassSum <= 0.0f)
+                            continue;
+
+                        const float friction = fminf(a->friction, b->friction);
+                        for (int p = 0; p < info.contactCount; ++p)
+                        {
+                            // Greedy coloring over the most recent open batches.
+                            uint32_t target = static_cast<uint32_t>(batches.size());
+                            uint32_t first = range.begin;
+                            if (target - first > PIP3D_PHYSICS_BATCH_WINDOW)
+                                first = target - PIP3D_PHYSICS_BATCH_WINDOW;
+                            for (uint32_t bi = first; bi < batches.size(); ++bi)
+                            {
+                                const ContactBatch &batch = batches[bi];
+                                if (batch.count < ContactBatch::LANES && !sharesBody(batch, slotA, slotB))
+                                {
+                                    target = bi;
+                                    break;
+                                }
+                            }
+                            if (target == batches.size())
+                                batches.push_back(ContactBatch());
+
+                            const Contact &c = info.contacts[p];
+                            ContactBatch &batch = batches[target];
+                            const int l = batch.count++;
+                            const Vector3 rA = c.pos - a->position;
+                            const Vector3 rB = c.pos - b->position;
+                            batch.nx[l] = info.normal.x;
+                            batch.ny[l] = info.normal.y;
+                            batch.nz[l] = info.normal.z;
+                            batch.rax[l] = rA.x;
+                            batch.ray[l] = rA.y;
+                            batch.raz[l] = rA.z;
+                            batch.rbx[l] = rB.x;
+                            batch.rby[l] = rB.y;
+                            batch.rbz[l] = rB.z;
+                            batch.normalMass[l] = c.normalMass;
+                            batch.bias[l] = c.bias;
+                            batch.impulse[l] = c.accumulatedImpulse;
+                            batch.friction[l] = friction;
+                            batch.invMassSum[l] = invMassSum;
+                            batch.bodyA[l] = slotA;
+                            batch.bodyB[l] = slotB;
+                            batch.source[l] = ci * 4 + static_cast<uint32_t>(p);
+                        }
+                    }
+                }
+                range.end = static_cast<uint32_t>(batches.size());
+            }
+
+            return capacities[0] != solverBodies.capacity() || capacities[1] != bodySlot.capacity() ||
+                   capacities[2] != batches.capacity();
+        }
+
+        bool isPrepared() const { return prepared; }
+
+        // Copies the island's body velocities in.
+        void gather(const std::vector<RigidBody *> &bodies,
+                    const PhysicsIsland &island,
+                    const ArenaArray<uint16_t> &islandBodies)
+        {
+            for (uint32_t m = island.bodyBegin; m < island.bodyEnd; ++m)
+                loadBody(static_cast<uint16_t>(m), bodies[islandBodies[m]]);
+        }
+
+        // Copies the island's body velocities back out.
+        void scatter(const std::vector<RigidBody *> &bodies,
+                     const PhysicsIsland &island,
+                     const ArenaArray<uint16_t> &islandBodies) const
+        {
+            for (uint32_t m = island.bodyBegin; m < island.bodyEnd; ++m)
+            {
+                RigidBody *b = bodies[islandBodies[m]];
+                const SolverBody &s = solverBodies[m];
+                b->velocity = Vector3(s.vx, s.vy, s.vz);
+                b->angularVelocity = Vector3(s.wx, s.wy, s.wz);
+            }
+        }
+
+        // One Gauss-Seidel pass over the group's batches.
+        void solve(int group)
+        {
+            const BatchRange &range = groups[group];
+            for (uint32_t bi = range.begin; bi < range.end; ++bi)
+                solveBatch(batches[bi], solverBodies.data());
+        }
+
+        // Leaves the accumulated impulses in the contacts for the cache.
+        void storeImpulses(int group, ArenaArray<CollisionInfo> &contacts) const
+        {
+            const BatchRange &range = groups[group];
+            for (uint32_t bi = range.begin; bi < range.end; ++bi)
+            {
+                const ContactBatch &batch = batches[bi];
+                for (int l = 0; l < batch.count; ++l)
+                {
+                    const uint32_t source = batch.source[l];
+                    contacts[source >> 2].contacts[source & 3].accumulatedImpulse = batch.impulse[l];
+                }
+            }
+        }
+
+        uint32_t getBatchCount() const { return static_cast<uint32_t>(batches.size()); }
+    };
+
+}
+
+#endif
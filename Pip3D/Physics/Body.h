@@ -12,6 +12,11 @@ namespace pip3D
         BODY_SHAPE_SPHERE = 1
     };
 
+    // Query layer bits; a body matches a query when its layers share a bit
+    // with the query mask.
+    static constexpr uint16_t PHYSICS_LAYER_DEFAULT = 0x0001;
+    static constexpr uint16_t PHYSICS_LAYER_ALL = 0xFFFF;
+
     struct PhysicsMaterial
     {
         float friction;
@@ -32,6 +37,8 @@ namespace pip3D
         Vector3 acceleration;
         Vector3 angularVelocity;
         Quaternion orientation;
+        // Pose at the start of the last step, for render interpolation.
+        Quaternion previousOrientation;
         Vector3 size;
         float mass;
         float invMass;
@@ -47,25 +54,36 @@ namespace pip3D
         bool canSleep;
         bool isSleeping;
         float sleepTimer;
+        // Tag shared by bodies that fell asleep as one island; 0 when awake.
+        uint16_t sleepIsland;
+        // Index in the owning world's body list, refreshed every step.
+        uint16_t solverIndex;
+        // Sweeps the body between steps so it cannot tunnel through thin
+        // geometry; boxes sweep their inscribed sphere.
+        bool continuousCollision;
+        // Matched against the layer mask of world queries.
+        uint16_t layers;
 
         RigidBody()
             : position(0, 0, 0), previousPosition(0, 0, 0), velocity(0, 0, 0), acceleration(0, 0, 0),
-              angularVelocity(0, 0, 0), orientation(), size(1, 1, 1),
+              angularVelocity(0, 0, 0), orientation(), previousOrientation(), size(1, 1, 1),
               mass(1.0f), invMass(1.0f), restitution(0.5f), friction(0.5f),
               isStatic(false), isKinematic(false), isTrigger(false), shape(BODY_SHAPE_BOX), radius(0.5f),
               invInertia(0, 0, 0), bounds(AABB::fromCenterSize(Vector3(0, 0, 0), Vector3(1, 1, 1))),
-              canSleep(true), isSleeping(false), sleepTimer(0.0f)
+              canSleep(true), isSleeping(false), sleepTimer(0.0f), sleepIsland(0), solverIndex(0),
+              continuousCollision(false), layers(PHYSICS_LAYER_DEFAULT)
         {
             computeInertia();
         }
 
         RigidBody(const Vector3 &pos, const Vector3 &size_, float m = 1.0f)
             : position(pos), previousPosition(pos), velocity(0, 0, 0), acceleration(0, 0, 0),
-              angularVelocity(0, 0, 0), orientation(), size(size_),
+              angularVelocity(0, 0, 0), orientation(), previousOrientation(), size(size_),
               mass(m), invMass(m > 0.0f ? 1.0f / m : 0.0f), restitution(0.5f), friction(0.5f),
               isStatic(false), isKinematic(false), isTrigger(false), shape(BODY_SHAPE_BOX), radius(size_.x * 0.5f),
               invInertia(0, 0, 0), bounds(AABB::fromCenterSize(pos, size_)),
-              canSleep(true), isSleeping(false), sleepTimer(0.0f)
+              canSleep(true), isSleeping(false), sleepTimer(0.0f), sleepIsland(0), solverIndex(0),
+              continuousCollision(false), layers(PHYSICS_LAYER_DEFAULT)
         {
             computeInertia();
         }
@@ -189,6 +207,29 @@ namespace pip3D
             sleepTimer = 0.0f;
         }
 
+        // Teleports without interpolating from the old pose.
+        __attribute__((always_inline)) inline void setOrientation(const Quaternion &q)
+        {
+            orientation = q;
+            previousOrientation = q;
+            updateBoundsFromTransform();
+            isSleeping = false;
+            sleepTimer = 0.0f;
+        }
+
+        // Pose alpha of the way from the previous step to the current one.
+        __attribute__((always_inline)) inline void interpolatedPose(float alpha, Vector3 &pos, Quaternion &rot) const
+        {
+            if (alpha >= 1.0f)
+            {
+                pos = position;
+                rot = orientation;
+                return;
+            }
+            pos = previousPosition + (position - previousPosition) * alpha;
+            rot = Quaternion::slerp(previousOrientation, orientation, alpha);
+        }
+
         __attribute__((always_inline)) inline void setStatic(bool s)
         {
             isStatic = s;
@@ -229,6 +270,18 @@ namespace pip3D
             isTrigger = t;
         }
 
+        __attribute__((always_inline)) inline void setContinuousCollision(bool enabled)
+        {
+            continuousCollision = enabled;
+        }
+
+        __attribute__((always_inline)) inline float sweepRadius() const
+        {
+            if (shape == BODY_SHAPE_SPHERE)
+                return radius;
+            return fminf(size.x, fminf(size.y, size.z)) * 0.5f;
+        }
+
         __attribute__((always_inline)) inline void wakeUp()
         {
             if (isSleeping)
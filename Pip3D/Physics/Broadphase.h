@@ -0,0 +1,321 @@
+#ifndef PIP3D_PHYSICS_BROADPHASE_H
+#define PIP3D_PHYSICS_BROADPHASE_H
+
+#include <vector>
+#include <algorithm>
+
+#include "../Math/Collision.h"
+#include "Body.h"
+
+namespace pip3D
+{
+
+    // Candidate pair as indices into the world body list, always a < b.
+    struct BroadphasePair
+    {
+        uint16_t a;
+        uint16_t b;
+    };
+
+    struct BroadphaseStats
+    {
+        uint32_t bodyCount;
+        uint32_t possiblePairs;
+        uint32_t overlapTests;
+        uint32_t candidatePairs;
+        uint32_t contactPairs;
+
+        BroadphaseStats()
+            : bodyCount(0), possiblePairs(0), overlapTests(0), candidatePairs(0), contactPairs(0) {}
+    };
+
+    class Broadphase
+    {
+    public:
+        virtual ~Broadphase() {}
+
+        // Fills outPairs with pairs whose bounds overlap and that may
+        // collide, sorted by (a, b) so the narrowphase runs in the same order
+        // as a plain double loop over the bodies.
+        virtual void findPairs(const std::vector<RigidBody *> &bodies,
+                               std::vector<BroadphasePair> &outPairs,
+                               BroadphaseStats &stats) = 0;
+
+        // Drops any state carried between steps.
+        virtual void reset() {}
+
+        // Spatial queries between steps. prepareQueries() runs once the
+        // bounds have settled (after a step, or after bodies were moved by
+        // hand); queryAABB() then appends the indices of bodies whose bounds
+        // overlap box. The defaults scan every body.
+        virtual void prepareQueries(const std::vector<RigidBody *> &bodies)
+        {
+            (void)bodies;
+        }
+
+        virtual void queryAABB(const std::vector<RigidBody *> &bodies,
+                               const AABB &box,
+                               std::vector<uint16_t> &out) const
+        {
+            const size_t count = bodies.size();
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (bodies[i]->bounds.intersects(box))
+                    out.push_back(static_cast<uint16_t>(i));
+            }
+        }
+
+        __attribute__((always_inline)) static inline bool canCollide(const RigidBody *a, const RigidBody *b)
+        {
+            bool aImmobile = (a->isStatic || a->isSleeping || a->isKinematic);
+            bool bImmobile = (b->isStatic || b->isSleeping || b->isKinematic);
+            return !(aImmobile && bImmobile);
+        }
+
+    protected:
+        static void beginStats(size_t bodyCount, BroadphaseStats &stats)
+        {
+            stats.bodyCount = static_cast<uint32_t>(bodyCount);
+            stats.possiblePairs = bodyCount > 1 ? static_cast<uint32_t>(bodyCount * (bodyCount - 1) / 2) : 0;
+            stats.overlapTests = 0;
+            stats.candidatePairs = 0;
+            stats.contactPairs = 0;
+        }
+
+        static void sortPairs(std::vector<BroadphasePair> &pairs)
+        {
+            std::sort(pairs.begin(), pairs.end(),
+                      [](const BroadphasePair &l, const BroadphasePair &r)
+                      {
+                          return l.a != r.a ? l.a < r.a : l.b < r.b;
+                      });
+        }
+    };
+
+    // Reference O(n^2) broadphase, matching the original pair loop.
+    class BruteForceBroadphase : public Broadphase
+    {
+    public:
+        void findPairs(const std::vector<RigidBody *> &bodies,
+                       std::vector<BroadphasePair> &outPairs,
+                       BroadphaseStats &stats) override
+        {
+            const size_t count = bodies.size();
+            beginStats(count, stats);
+            outPairs.clear();
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const RigidBody *a = bodies[i];
+                for (size_t j = i + 1; j < count; ++j)
+                {
+                    const RigidBody *b = bodies[j];
+                    if (!canCollide(a, b))
+                        continue;
+
+                    stats.overlapTests++;
+                    if (!a->bounds.intersects(b->bounds))
+                        continue;
+
+                    outPairs.push_back({static_cast<uint16_t>(i), static_cast<uint16_t>(j)});
+                }
+            }
+
+            stats.candidatePairs = static_cast<uint32_t>(outPairs.size());
+        }
+    };
+
+    // Incremental sweep-and-prune on RigidBody::bounds. The sorted order is
+    // kept between steps, so with coherent motion the insertion sort is close
+    // to linear. The sweep axis follows the largest spread of body centers.
+    // Queries binary-search the same order, starting one largest body extent
+    // before the query box.
+    class SweepAndPruneBroadphase : public Broadphase
+    {
+    private:
+        std::vector<uint16_t> order;
+        int axis;
+        float maxExtent;
+        bool queriesReady;
+
+        __attribute__((always_inline)) static inline float axisMin(const RigidBody *b, int ax)
+        {
+            return ax == 0 ? b->bounds.min.x : (ax == 1 ? b->bounds.min.y : b->bounds.min.z);
+        }
+
+        __attribute__((always_inline)) static inline float axisMax(const RigidBody *b, int ax)
+        {
+            return ax == 0 ? b->bounds.max.x : (ax == 1 ? b->bounds.max.y : b->bounds.max.z);
+        }
+
+        static int chooseAxis(const std::vector<RigidBody *> &bodies)
+        {
+            const size_t count = bodies.size();
+            Vector3 sum(0, 0, 0);
+            Vector3 sumSq(0, 0, 0);
+            for (size_t i = 0; i < count; ++i)
+            {
+                const AABB &bb = bodies[i]->bounds;
+                Vector3 c = (bb.min + bb.max) * 0.5f;
+                sum += c;
+                sumSq += Vector3(c.x * c.x, c.y * c.y, c.z * c.z);
+            }
+
+            const float inv = 1.0f / static_cast<float>(count);
+            const float vx = sumSq.x * inv - (sum.x * inv) * (sum.x * inv);
+            const float vy = sumSq.y * inv - (sum.y * inv) * (sum.y * inv);
+            const float vz = sumSq.z * inv - (sum.z * inv) * (sum.z * inv);
+
+            if (vx >= vy && vx >= vz)
+                return 0;
+            return vy >= vz ? 1 : 2;
+        }
+
+        void sortOrder(const std::vector<RigidBody *> &bodies, int ax)
+        {
+            const size_t count = order.size();
+            for (size_t i = 1; i < count; ++i)
+            {
+                const uint16_t idx = order[i];
+                const float key = axisMin(bodies[idx], ax);
+                size_t j = i;
+                while (j > 0 && axisMin(bodies[order[j - 1]], ax) > key)
+                {
+                    order[j] = order[j - 1];
+                    --j;
+                }
+                order[j] = idx;
+            }
+        }
+
+    public:
+        SweepAndPruneBroadphase() : axis(0), maxExtent(0.0f), queriesReady(false) {}
+
+        void reset() override
+        {
+            order.clear();
+            queriesReady = false;
+        }
+
+        void prepareQueries(const std::vector<RigidBody *> &bodies) override
+        {
+            const size_t count = bodies.size();
+            if (order.size() != count)
+            {
+                order.resize(count);
+                for (size_t i = 0; i < count; ++i)
+                    order[i] = static_cast<uint16_t>(i);
+            }
+
+            sortOrder(bodies, axis);
+
+            maxExtent = 0.0f;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const float extent = axisMax(bodies[i], axis) - axisMin(bodies[i], axis);
+                if (extent > maxExtent)
+                    maxExtent = extent;
+            }
+            queriesReady = true;
+        }
+
+        void queryAABB(const std::vector<RigidBody *> &bodies,
+                       const AABB &box,
+                       std::vector<uint16_t> &out) const override
+        {
+            const size_t count = bodies.size();
+            if (!queriesReady || order.size() != count)
+            {
+                Broadphase::queryAABB(bodies, box, out);
+                return;
+            }
+
+            const int ax = axis;
+            const float boxMin = ax == 0 ? box.min.x : (ax == 1 ? box.min.y : box.min.z);
+            const float boxMax = ax == 0 ? box.max.x : (ax == 1 ? box.max.y : box.max.z);
+
+            // First body whose min can still reach boxMin.
+            const float start = boxMin - maxExtent;
+            size_t lo = 0;
+            size_t hi = count;
+            while (lo < hi)
+            {
+                const size_t mid = (lo + hi) >> 1;
+                if (axisMin(bodies[order[mid]], ax) < start)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+
+            for (size_t i = lo; i < count; ++i)
+            {
+                const uint16_t idx = order[i];
+                const RigidBody *b = bodies[idx];
+                if (axisMin(b, ax) > boxMax)
+                    break;
+                if (b->bounds.intersects(box))
+                    out.push_back(idx);
+            }
+        }
+
+        void findPairs(const std::vector<RigidBody *> &bodies,
+                       std::vector<BroadphasePair> &outPairs,
+                       BroadphaseStats &stats) override
+        {
+            const size_t count = bodies.size();
+            beginStats(count, stats);
+            outPairs.clear();
+
+            if (count < 2)
+                return;
+
+            if (order.size() != count)
+            {
+                order.resize(count);
+                for (size_t i = 0; i < count; ++i)
+                    order[i] = static_cast<uint16_t>(i);
+            }
+
+            axis = chooseAxis(bodies);
+            const int ax = axis;
+            queriesReady = false;
+
+            sortOrder(bodies, ax);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const uint16_t ia = order[i];
+                const RigidBody *a = bodies[ia];
+                const float aMax = axisMax(a, ax);
+
+                for (size_t j = i + 1; j < count; ++j)
+                {
+                    const uint16_t ib = order[j];
+                    const RigidBody *b = bodies[ib];
+                    if (axisMin(b, ax) > aMax)
+                        break;
+
+                    if (!canCollide(a, b))
+                        continue;
+
+                    stats.overlapTests++;
+                    if (!a->bounds.intersects(b->bounds))
+                        continue;
+
+                    if (ia < ib)
+                        outPairs.push_back({ia, ib});
+                    else
+                        outPairs.push_back({ib, ia});
+                }
+            }
+
+            sortPairs(outPairs);
+            stats.candidatePairs = static_cast<uint32_t>(outPairs.size());
+        }
+
+        int getAxis() const { return axis; }
+    };
+
+}
+
+#endif
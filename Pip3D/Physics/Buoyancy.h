@@ -2,8 +2,16 @@
 #define PIP3D_PHYSICS_BUOYANCY_H
 
 #include <float.h>
+#include <vector>
+#include <stdint.h>
 
 #include "../Math/Collision.h"
+#include "Body.h"
+
+// Cells a side of the grid BuoyancySolver sorts bounded zones into.
+#ifndef PIP3D_BUOYANCY_GRID
+#define PIP3D_BUOYANCY_GRID 8
+#endif
 
 namespace pip3D
 {
@@ -38,6 +46,357 @@ namespace pip3D
         }
     };
 
+    // Up to four floating bodies laid out lane by lane. A box probes the
+    // water at its four bottom corners, a sphere at its lowest point only.
+    struct alignas(16) BuoyancyBatch
+    {
+        static constexpr int LANES = 4;
+        static constexpr int PROBES = 4;
+
+        float x[PROBES][LANES], y[PROBES][LANES], z[PROBES][LANES];
+        float px[LANES], pz[LANES];
+        // Box height, or sphere radius for spheres.
+        float height[LANES];
+        bool sphere[LANES];
+        // Buoyant acceleration and torque per unit mass, summed over zones.
+        float lift[LANES];
+        float tx[LANES], tz[LANES];
+        // Drag factors of the zones entered, multiplied together.
+        float linearDrag[LANES];
+        float angularDrag[LANES];
+        uint16_t body[LANES];
+        uint8_t count;
+    };
+
+    // Buoyancy stage of the physics step. Floating bodies are packed into
+    // BuoyancyBatch lanes with their probe points transformed once, the
+    // zones a batch may touch come from a grid over the bounded zones, and
+    // each candidate zone is then tested against every lane. A zone pushes
+    // up on submerged probes and damps the bodies it holds.
+    class BuoyancySolver
+    {
+    private:
+        static constexpr int GRID = PIP3D_BUOYANCY_GRID;
+        // Zones wider than this on X or Z are checked for every batch.
+        static constexpr float UNBOUNDED = FLT_MAX * 0.5f;
+
+        std::vector<BuoyancyZone> zones;
+        // Bounded zone indices by cell, cellStart[GRID * GRID] entries in all.
+        std::vector<uint32_t> cellStart;
+        std::vector<uint16_t> cellZones;
+        std::vector<uint16_t> everywhere;
+        std::vector<uint32_t> zoneStamp;
+        std::vector<uint16_t> candidates;
+        std::vector<BuoyancyBatch> batches;
+        float originX, originZ;
+        float cellX, cellZ;
+        uint32_t stamp;
+        bool gridDirty;
+
+        void buildGrid()
+        {
+            gridDirty = false;
+            everywhere.clear();
+            cellZones.clear();
+            cellStart.assign(GRID * GRID + 1, 0);
+            zoneStamp.assign(zones.size(), 0);
+            stamp = 0;
+
+            float minX = FLT_MAX, minZ = FLT_MAX, maxX = -FLT_MAX, maxZ = -FLT_MAX;
+            for (size_t i = 0; i < zones.size(); ++i)
+            {
+                const BuoyancyZone &zone = zones[i];
+                if (!bounded(zone))
+                {
+                    everywhere.push_back(static_cast<uint16_t>(i));
+                    continue;
+                }
+                minX = fminf(minX, zone.min.x);
+                minZ = fminf(minZ, zone.min.z);
+                maxX = fmaxf(maxX, zone.max.x);
+                maxZ = fmaxf(maxZ, zone.max.z);
+            }
+            originX = minX;
+            originZ = minZ;
+            cellX = maxX > minX ? (maxX - minX) / GRID : 1.0f;
+            cellZ = maxZ > minZ ? (maxZ - minZ) / GRID : 1.0f;
+            if (everywhere.size() == zones.size())
+                return;
+
+            // Counting pass, then fill.
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                for (size_t i = 0; i < zones.size(); ++i)
+                {
+                    const BuoyancyZone &zone = zones[i];
+                    if (!bounded(zone))
+                        continue;
+                    int x0, z0, x1, z1;
+                    cellRange(zone.min.x, zone.min.z, zone.max.x, zone.max.z, x0, z0, x1, z1);
+                    for (int cz = z0; cz <= z1; ++cz)
+                    {
+                        for (int cx = x0; cx <= x1; ++cx)
+                        {
+                            const int cell = cz * GRID + cx;
+                            if (pass == 0)
+                                cellStart[cell + 1]++;
+                            else
+                                cellZones[cellStart[cell]++] = static_cast<uint16_t>(i);
+                        }
+                    }
+                }
+                if (pass == 0)
+                {
+                    for (int c = 0; c < GRID * GRID; ++c)
+                        cellStart[c + 1] += cellStart[c];
+                    cellZones.resize(cellStart[GRID * GRID]);
+                }
+                else
+                {
+                    // The fill advanced every start to the next cell's.
+                    for (int c = GRID * GRID; c > 0; --c)
+                        cellStart[c] = cellStart[c - 1];
+                    cellStart[0] = 0;
+                }
+            }
+        }
+
+        static bool bounded(const BuoyancyZone &zone)
+        {
+            return zone.min.x > -UNBOUNDED && zone.max.x < UNBOUNDED &&
+                   zone.min.z > -UNBOUNDED && zone.max.z < UNBOUNDED;
+        }
+
+        void cellRange(float minX, float minZ, float maxX, float maxZ,
+                       int &x0, int &z0, int &x1, int &z1) const
+        {
+            x0 = clampCell((minX - originX) / cellX);
+            z0 = clampCell((minZ - originZ) / cellZ);
+            x1 = clampCell((maxX - originX) / cellX);
+            z1 = clampCell((maxZ - originZ) / cellZ);
+        }
+
+        static int clampCell(float c)
+        {
+            return c < 0.0f ? 0 : (c >= GRID ? GRID - 1 : static_cast<int>(c));
+        }
+
+        // Fills candidates with the zones that may hold a point of the
+        // given XZ rectangle, each once.
+        void gatherZones(float minX, float minZ, float maxX, float maxZ)
+        {
+            candidates.assign(everywhere.begin(), everywhere.end());
+            if (cellZones.empty())
+                return;
+            if (maxX < originX || maxZ < originZ ||
+                minX > originX + cellX * GRID || minZ > originZ + cellZ * GRID)
+                return;
+
+            ++stamp;
+            int x0, z0, x1, z1;
+            cellRange(minX, minZ, maxX, maxZ, x0, z0, x1, z1);
+            for (int cz = z0; cz <= z1; ++cz)
+            {
+                for (int cx = x0; cx <= x1; ++cx)
+                {
+                    const int cell = cz * GRID + cx;
+                    for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; ++k)
+                    {
+                        const uint16_t zi = cellZones[k];
+                        if (zoneStamp[zi] == stamp)
+                            continue;
+                        zoneStamp[zi] = stamp;
+                        candidates.push_back(zi);
+                    }
+                }
+            }
+        }
+
+        // Probe points of a body in world space; the box axes are rotated
+        // once and combined into the four corners.
+        static void loadBody(BuoyancyBatch &batch, int l, const RigidBody *b, uint16_t index)
+        {
+            batch.body[l] = index;
+            batch.px[l] = b->position.x;
+            batch.pz[l] = b->position.z;
+            batch.lift[l] = 0.0f;
+            batch.tx[l] = batch.tz[l] = 0.0f;
+            batch.linearDrag[l] = batch.angularDrag[l] = 1.0f;
+
+            if (b->shape == BODY_SHAPE_SPHERE)
+            {
+                batch.sphere[l] = true;
+                batch.height[l] = b->radius;
+                for (int c = 0; c < BuoyancyBatch::PROBES; ++c)
+                {
+                    batch.x[c][l] = b->position.x;
+                    batch.y[c][l] = b->position.y - b->radius;
+                    batch.z[c][l] = b->position.z;
+                }
+                return;
+            }
+
+            const Vector3 half = b->size * 0.5f;
+            const Vector3 ax = b->orientation.rotate(Vector3(half.x, 0.0f, 0.0f));
+            const Vector3 down = b->position - b->orientation.rotate(Vector3(0.0f, half.y, 0.0f));
+            const Vector3 az = b->orientation.rotate(Vector3(0.0f, 0.0f, half.z));
+            const float sx[BuoyancyBatch::PROBES] = {-1.0f, 1.0f, 1.0f, -1.0f};
+            const float sz[BuoyancyBatch::PROBES] = {-1.0f, -1.0f, 1.0f, 1.0f};
+            batch.sphere[l] = false;
+            batch.height[l] = b->size.y > 0.0f ? b->size.y : 1.0f;
+            for (int c = 0; c < BuoyancyBatch::PROBES; ++c)
+            {
+                batch.x[c][l] = down.x + ax.x * sx[c] + az.x * sz[c];
+                batch.y[c][l] = down.y + ax.y * sx[c] + az.y * sz[c];
+                batch.z[c][l] = down.z + ax.z * sx[c] + az.z * sz[c];
+            }
+        }
+
+        static void applyZone(BuoyancyBatch &batch, const BuoyancyZone &zone, float gravity, float deltaTime)
+        {
+            const float lift = zone.density * gravity;
+            const float linFactor = fmaxf(1.0f - zone.dragLinear * deltaTime, 0.0f);
+            const float angFactor = fmaxf(1.0f - zone.dragAngular * deltaTime, 0.0f);
+
+            for (int l = 0; l < batch.count; ++l)
+            {
+                float up = 0.0f;
+                float tx = 0.0f;
+                float tz = 0.0f;
+                bool inside = false;
+
+                if (batch.sphere[l])
+                {
+                    // Submerged cap of height h holds h^2 (3r - h) / (4r^3)
+                    // of the sphere's volume.
+                    const float r = batch.height[l];
+                    const Vector3 bottom(batch.x[0][l], batch.y[0][l], batch.z[0][l]);
+                    const float h = fminf(zone.surfaceLevel - bottom.y, 2.0f * r);
+                    if (zone.contains(bottom) && h > 0.0f && r > 0.0f)
+                    {
+                        inside = true;
+                        up = lift * h * h * (3.0f * r - h) / (4.0f * r * r * r);
+                    }
+                }
+                else
+                {
+                    for (int c = 0; c < BuoyancyBatch::PROBES; ++c)
+                    {
+                        const Vector3 corner(batch.x[c][l], batch.y[c][l], batch.z[c][l]);
+                        const float depth = zone.surfaceLevel - corner.y;
+                        if (!zone.contains(corner) || depth <= 0.0f)
+                            continue;
+                        inside = true;
+
+                        // A quarter of the lift per corner, full once the
+                        // corner is a body height deep.
+                        const float f = lift * 0.25f * fminf(depth / batch.height[l], 1.0f);
+                        up += f;
+                        // r x (0, f, 0) with r from the body's centre.
+                        tx -= (corner.z - batch.pz[l]) * f;
+                        tz += (corner.x - batch.px[l]) * f;
+                    }
+                }
+
+                if (!inside)
+                    continue;
+                batch.lift[l] += up;
+                // Torque added so far is damped by this zone like the
+                // body's own spin.
+                batch.tx[l] = (batch.tx[l] + tx * deltaTime) * angFactor;
+                batch.tz[l] = (batch.tz[l] + tz * deltaTime) * angFactor;
+                batch.linearDrag[l] *= linFactor;
+                batch.angularDrag[l] *= angFactor;
+            }
+        }
+
+    public:
+        BuoyancySolver()
+            : originX(0.0f), originZ(0.0f), cellX(1.0f), cellZ(1.0f), stamp(0), gridDirty(true) {}
+
+        BuoyancySolver(const BuoyancySolver &) = delete;
+        BuoyancySolver &operator=(const BuoyancySolver &) = delete;
+
+        void addZone(const BuoyancyZone &zone)
+        {
+            zones.push_back(zone);
+            gridDirty = true;
+        }
+
+        void clearZones()
+        {
+            zones.clear();
+            gridDirty = true;
+        }
+
+        bool empty() const { return zones.empty(); }
+        size_t zoneCount() const { return zones.size(); }
+        const BuoyancyZone &zone(size_t i) const { return zones[i]; }
+
+        // Pushes and damps the awake dynamic bodies in water. gravity is
+        // the magnitude lift scales with. Returns true when storage had to
+        // grow.
+        bool apply(const std::vector<RigidBody *> &bodies, float gravity, float deltaTime)
+        {
+            if (zones.empty())
+                return false;
+            const size_t capacities[4] = {batches.capacity(), candidates.capacity(),
+                                          cellZones.capacity(), zoneStamp.capacity()};
+            if (gridDirty)
+                buildGrid();
+
+            batches.clear();
+            for (size_t i = 0; i < bodies.size(); ++i)
+            {
+                const RigidBody *b = bodies[i];
+                if (!b || b->isStatic || b->isKinematic || b->isSleeping || b->mass <= 0.0f)
+                    continue;
+                if (batches.empty() || batches.back().count == BuoyancyBatch::LANES)
+                {
+                    batches.push_back(BuoyancyBatch());
+                    batches.back().count = 0;
+                }
+                BuoyancyBatch &batch = batches.back();
+                loadBody(batch, batch.count++, b, static_cast<uint16_t>(i));
+            }
+
+            for (size_t bi = 0; bi < batches.size(); ++bi)
+            {
+                BuoyancyBatch &batch = batches[bi];
+                float minX = FLT_MAX, minZ = FLT_MAX, maxX = -FLT_MAX, maxZ = -FLT_MAX;
+                for (int c = 0; c < BuoyancyBatch::PROBES; ++c)
+                {
+                    for (int l = 0; l < batch.count; ++l)
+                    {
+                        minX = fminf(minX, batch.x[c][l]);
+                        minZ = fminf(minZ, batch.z[c][l]);
+                        maxX = fmaxf(maxX, batch.x[c][l]);
+                        maxZ = fmaxf(maxZ, batch.z[c][l]);
+                    }
+                }
+
+                gatherZones(minX, minZ, maxX, maxZ);
+                for (size_t k = 0; k < candidates.size(); ++k)
+                    applyZone(batch, zones[candidates[k]], gravity, deltaTime);
+
+                for (int l = 0; l < batch.count; ++l)
+                {
+                    if (batch.lift[l] == 0.0f && batch.linearDrag[l] == 1.0f && batch.angularDrag[l] == 1.0f)
+                        continue;
+                    RigidBody *b = bodies[batch.body[l]];
+                    b->applyForce(Vector3(0.0f, b->mass * batch.lift[l], 0.0f));
+                    b->velocity *= batch.linearDrag[l];
+                    b->angularVelocity *= batch.angularDrag[l];
+                    b->angularVelocity.x += b->mass * batch.tx[l] * b->invInertia.x;
+                    b->angularVelocity.z += b->mass * batch.tz[l] * b->invInertia.z;
+                }
+            }
+
+            return capacities[0] != batches.capacity() || capacities[1] != candidates.capacity() ||
+                   capacities[2] != cellZones.capacity() || capacities[3] != zoneStamp.capacity();
+        }
+    };
+
 }
 
 #endif
@@ -0,0 +1,236 @@
+#ifndef PIP3D_PHYSICS_CONTACTCACHE_H
+#define PIP3D_PHYSICS_CONTACTCACHE_H
+
+#include <new>
+#include <stdint.h>
+
+#include "../Core/Core.h"
+#include "Contacts.h"
+
+namespace pip3D
+{
+
+    // Contact points and accumulated impulses of one body pair, as left by
+    // the solver in the step that last touched it. Pairs the broadphase
+    // reports without contact keep an entry with no points, which holds
+    // the narrowphase's last separating axis.
+    struct ContactManifold
+    {
+        static constexpr uint8_t NO_AXIS = 0xFF;
+
+        RigidBody *bodyA;
+        RigidBody *bodyB;
+        uint32_t step;
+        int contactCount;
+        Vector3 pos[4];
+        float impulse[4];
+        uint16_t feature[4];
+        uint8_t separatingAxis;
+
+        ContactManifold()
+            : bodyA(nullptr), bodyB(nullptr), step(0), contactCount(0), separatingAxis(NO_AXIS) {}
+    };
+
+    // Persistent manifolds keyed by (bodyA, bodyB), open addressing with
+    // linear probing. Pairs not acquired during a step are dropped in
+    // endStep(); the table only allocates when it has to grow, from
+    // internal RAM charged to LOG_MODULE_PHYSICS.
+    class ContactCache
+    {
+    public:
+        static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    private:
+        ContactManifold *slots;
+        uint32_t slotCount;
+        uint32_t mask;
+        uint32_t used;
+        uint32_t stepId;
+
+        static uint32_t hashPair(const RigidBody *a, const RigidBody *b)
+        {
+            uint32_t ha = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(a) >> 3);
+            uint32_t hb = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(b) >> 3);
+            uint32_t h = ha * 0x9E3779B1u ^ (hb + 0x7F4A7C15u + (ha << 6) + (ha >> 2));
+            h ^= h >> 15;
+            h *= 0x2C1B3C6Du;
+            h ^= h >> 12;
+            return h;
+        }
+
+        bool rehash(uint32_t capacity)
+        {
+            ContactManifold *fresh = static_cast<ContactManifold *>(
+                MemUtils::alloc(sizeof(ContactManifold) * capacity, MEM_INTERNAL_FIRST,
+                                ::pip3D::Debug::LOG_MODULE_PHYSICS));
+            if (!fresh)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_PHYSICS,
+                     "ContactCache: could not grow to %u pairs",
+                     static_cast<unsigned int>(capacity));
+                return false;
+            }
+            for (uint32_t i = 0; i < capacity; ++i)
+                new (fresh + i) ContactManifold();
+
+            ContactManifold *old = slots;
+            const uint32_t oldCount = slotCount;
+            slots = fresh;
+            slotCount = capacity;
+            mask = capacity - 1;
+            used = 0;
+            for (uint32_t i = 0; i < oldCount; ++i)
+            {
+                if (!old[i].bodyA)
+                    continue;
+                uint32_t idx = hashPair(old[i].bodyA, old[i].bodyB) & mask;
+                while (slots[idx].bodyA)
+                    idx = (idx + 1) & mask;
+                slots[idx] = old[i];
+                ++used;
+            }
+            MemUtils::freeData(old);
+            return true;
+        }
+
+        // Backward-shift deletion keeps probe chains intact without tombstones.
+        void erase(uint32_t hole)
+        {
+            uint32_t next = (hole + 1) & mask;
+            while (slots[next].bodyA)
+            {
+                const uint32_t home = hashPair(slots[next].bodyA, slots[next].bodyB) & mask;
+                if (((next - home) & mask) >= ((next - hole) & mask))
+                {
+                    slots[hole] = slots[next];
+                    hole = next;
+                }
+                next = (next + 1) & mask;
+            }
+            slots[hole].bodyA = nullptr;
+            slots[hole].bodyB = nullptr;
+            --used;
+        }
+
+    public:
+        ContactCache() : slots(nullptr), slotCount(0), mask(0), used(0), stepId(1) {}
+
+        ~ContactCache()
+        {
+            MemUtils::freeData(slots);
+        }
+
+        ContactCache(const ContactCache &) = delete;
+        ContactCache &operator=(const ContactCache &) = delete;
+
+        // Makes room for count new pairs, so indices returned by acquire()
+        // stay stable until endStep(). Returns true if the table had to grow.
+        bool reserve(size_t count)
+        {
+            const size_t needed = (static_cast<size_t>(used) + count) * 2;
+            if (needed <= slotCount)
+                return false;
+            uint32_t capacity = slotCount ? slotCount : 16u;
+            while (capacity < needed)
+                capacity <<= 1;
+            return rehash(capacity);
+        }
+
+        void beginStep()
+        {
+            ++stepId;
+            if (stepId == 0)
+                stepId = 1;
+        }
+
+        // Finds or inserts the manifold for (a, b). prevStep is true when it
+        // holds impulses from the previous step. Returns NONE if reserve()
+        // was not called for this pair.
+        uint32_t acquire(RigidBody *a, RigidBody *b, bool &prevStep)
+        {
+            prevStep = false;
+            if (!slots || (used + 1) * 2 > slotCount)
+                return NONE;
+
+            uint32_t idx = hashPair(a, b) & mask;
+            while (slots[idx].bodyA)
+            {
+                ContactManifold &m = slots[idx];
+                if (m.bodyA == a && m.bodyB == b)
+                {
+                    prevStep = (m.step + 1 == stepId) && m.contactCount > 0;
+                    m.step = stepId;
+                    return idx;
+                }
+                idx = (idx + 1) & mask;
+            }
+
+            ContactManifold &m = slots[idx];
+            m.bodyA = a;
+            m.bodyB = b;
+            m.step = stepId;
+            m.contactCount = 0;
+            m.separatingAxis = ContactManifold::NO_AXIS;
+            ++used;
+            return idx;
+        }
+
+        __attribute__((always_inline)) inline ContactManifold &at(uint32_t index)
+        {
+            return slots[index];
+        }
+
+        void store(uint32_t index, const CollisionInfo &info)
+        {
+            ContactManifold &m = slots[index];
+            int count = info.contactCount;
+            if (count > 4)
+                count = 4;
+            m.contactCount = count;
+            for (int i = 0; i < count; ++i)
+            {
+                m.pos[i] = info.contacts[i].pos;
+                m.impulse[i] = info.contacts[i].accumulatedImpulse;
+                m.feature[i] = info.contacts[i].feature;
+            }
+        }
+
+        // Drops pairs that were not acquired during the current step.
+        void endStep()
+        {
+            for (uint32_t i = 0; i < slotCount;)
+            {
+                if (slots[i].bodyA && slots[i].step != stepId)
+                    erase(i);
+                else
+                    ++i;
+            }
+        }
+
+        void removeBody(const RigidBody *body)
+        {
+            for (uint32_t i = 0; i < slotCount;)
+            {
+                if (slots[i].bodyA && (slots[i].bodyA == body || slots[i].bodyB == body))
+                    erase(i);
+                else
+                    ++i;
+            }
+        }
+
+        void clear()
+        {
+            for (uint32_t i = 0; i < slotCount; ++i)
+            {
+                slots[i].bodyA = nullptr;
+                slots[i].bodyB = nullptr;
+            }
+            used = 0;
+        }
+
+        uint32_t size() const { return used; }
+    };
+
+}
+
+#endif
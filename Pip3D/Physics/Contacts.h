@@ -14,13 +14,17 @@ namespace pip3D
         float accumulatedImpulse;
         float normalMass;
         float bias;
+        // Identifies the feature pair that produced the point (see
+        // Narrowphase); 0 when unknown.
+        uint16_t feature;
 
         Contact()
             : pos(0.0f, 0.0f, 0.0f),
               penetration(0.0f),
               accumulatedImpulse(0.0f),
               normalMass(0.0f),
-              bias(0.0f) {}
+              bias(0.0f),
+              feature(0) {}
     };
 
     struct CollisionInfo
@@ -0,0 +1,31 @@
+#ifndef PIP3D_PHYSICS_ISLANDS_H
+#define PIP3D_PHYSICS_ISLANDS_H
+
+#include <stdint.h>
+
+namespace pip3D
+{
+
+    // Set of dynamic bodies connected through contacts or joints in the
+    // current step. Ranges index into the world's island scratch lists.
+    struct PhysicsIsland
+    {
+        uint32_t bodyBegin;
+        uint32_t bodyEnd;
+        uint32_t contactBegin;
+        uint32_t contactEnd;
+        uint32_t jointBegin;
+        uint32_t jointEnd;
+        bool sleeping;
+        uint8_t worker;
+
+        PhysicsIsland()
+            : bodyBegin(0), bodyEnd(0), contactBegin(0), contactEnd(0),
+              jointBegin(0), jointEnd(0), sleeping(false), worker(0) {}
+    };
+
+    static constexpr uint16_t PHYSICS_NO_ISLAND = 0xFFFF;
+
+}
+
+#endif
@@ -0,0 +1,655 @@
+#ifndef PIP3D_PHYSICS_NARROWPHASE_H
+#define PIP3D_PHYSICS_NARROWPHASE_H
+
+#include "../Math/Collision.h"
+#include "Body.h"
+#include "Contacts.h"
+#include "ContactCache.h"
+#include <float.h>
+
+namespace pip3D
+{
+
+    // Contact generation for one body pair, dispatched on the two shapes.
+    // Every test fills info with the normal pointing from a to b and
+    // returns true on contact. Contacts carry feature IDs so the solver can
+    // warm-start them by identity rather than by position.
+    struct Narrowphase
+    {
+        static constexpr int SHAPE_COUNT = 2;
+        static constexpr int BOX_AXIS_COUNT = 15;
+
+        // Prefer a face of a, then a face of b, then an edge pair, unless
+        // the later axis is clearly shallower; keeps the reference face
+        // from flipping between steps on near ties.
+        static constexpr float AXIS_RELATIVE_TOLERANCE = 0.95f;
+        static constexpr float AXIS_ABSOLUTE_TOLERANCE = 5e-4f;
+        static constexpr float CONTACT_EPSILON = 1e-3f;
+
+        // Feature ID layout: face contacts set FEATURE_FACE with the
+        // reference face, incident face and clip point; edge contacts set
+        // FEATURE_EDGE with the axis and the chosen edges. 0 is unknown.
+        static constexpr uint16_t FEATURE_SINGLE = 1;
+        static constexpr uint16_t FEATURE_FACE = 0x2000;
+        static constexpr uint16_t FEATURE_EDGE = 0x4000;
+
+        // swept: sphere tests may sweep from previousPosition to catch
+        // tunnelling. axisHint: the pair's cached separating axis.
+        typedef bool (*Test)(RigidBody *a, RigidBody *b, bool swept, uint8_t &axisHint, CollisionInfo &info);
+
+        static bool collide(RigidBody *a, RigidBody *b, bool swept, uint8_t &axisHint, CollisionInfo &info)
+        {
+            static const Test table[SHAPE_COUNT][SHAPE_COUNT] = {
+                // a: BODY_SHAPE_BOX
+                {boxBox, boxSphere},
+                // a: BODY_SHAPE_SPHERE
+                {sphereBox, sphereSphere},
+            };
+            const int sa = static_cast<int>(a->shape);
+            const int sb = static_cast<int>(b->shape);
+            if (unlikely(sa < 0 || sa >= SHAPE_COUNT || sb < 0 || sb >= SHAPE_COUNT))
+                return false;
+            return table[sa][sb](a, b, swept, axisHint, info);
+        }
+
+        static void setSingleContact(RigidBody *a, RigidBody *b, const Vector3 &normal,
+                                     const Vector3 &pos, float penetration, CollisionInfo &info)
+        {
+            info.hasCollision = true;
+            info.bodyA = a;
+            info.bodyB = b;
+            info.normal = normal;
+            info.contactCount = 1;
+            info.contacts[0].pos = pos;
+            info.contacts[0].penetration = penetration;
+            info.contacts[0].accumulatedImpulse = 0.0f;
+            info.contacts[0].feature = FEATURE_SINGLE;
+        }
+
+        static bool sphereSphere(RigidBody *a, RigidBody *b, bool swept, uint8_t &, CollisionInfo &info)
+        {
+            Vector3 centerA = a->position;
+            Vector3 centerB = b->position;
+            Vector3 delta = centerB - centerA;
+            float distSq = delta.lengthSquared();
+            float radiusSum = a->radius + b->radius;
+            if (distSq > radiusSum * radiusSum)
+            {
+                if (!swept)
+                    return false;
+
+                Vector3 startA = a->previousPosition;
+                Vector3 endA = a->position;
+                Vector3 startB = b->previousPosition;
+                Vector3 endB = b->position;
+                Vector3 relStart = startA - startB;
+                Vector3 relEnd = endA - endB;
+                Vector3 relDir = relEnd - relStart;
+                float relLenSq = relDir.lengthSquared();
+                if (relLenSq <= 1e-8f)
+                    return false;
+
+                Ray ray(relStart, relDir);
+                CollisionSphere expanded(Vector3(0, 0, 0), radiusSum);
+                float t;
+                if (!ray.intersects(expanded, t) || t < 0.0f || t > 1.0f)
+                    return false;
+
+                Vector3 posA = startA + (endA - startA) * t;
+                Vector3 posB = startB + (endB - startB) * t;
+                Vector3 hitDelta = posB - posA;
+                float distHitSq = hitDelta.lengthSquared();
+                float distHit = distHitSq > 1e-8f ? sqrtf(distHitSq) : 0.0f;
+                Vector3 normal = distHit > 1e-4f ? hitDelta * (1.0f / distHit) : Vector3(0, 1, 0);
+                float penetration = radiusSum - distHit;
+                if (penetration < 0.0f)
+                    penetration = 0.0f;
+                setSingleContact(a, b, normal, posA + normal * (a->radius - penetration * 0.5f), penetration, info);
+                return true;
+            }
+
+            float dist = distSq > 1e-8f ? sqrtf(distSq) : 0.0f;
+            Vector3 normal = dist > 1e-4f ? delta * (1.0f / dist) : Vector3(0, 1, 0);
+            float penetration = radiusSum - dist;
+            setSingleContact(a, b, normal, centerA + normal * (a->radius - penetration * 0.5f), penetration, info);
+            return true;
+        }
+
+        static bool sphereBox(RigidBody *a, RigidBody *b, bool swept, uint8_t &, CollisionInfo &info)
+        {
+            Vector3 sphereCenter = a->position;
+            Vector3 boxCenter = b->position;
+            Vector3 halfExtents = b->size * 0.5f;
+
+            Quaternion invRot = b->orientation.conjugate();
+            Vector3 local = invRot.rotate(sphereCenter - boxCenter);
+
+            float lx = fmaxf(-halfExtents.x, fminf(local.x, halfExtents.x));
+            float ly = fmaxf(-halfExtents.y, fminf(local.y, halfExtents.y));
+            float lz = fmaxf(-halfExtents.z, fminf(local.z, halfExtents.z));
+            Vector3 closestLocal(lx, ly, lz);
+            Vector3 closestWorld = b->orientation.rotate(closestLocal) + boxCenter;
+
+            Vector3 diff = closestWorld - sphereCenter;
+            float distSq = diff.lengthSquared();
+            float r = a->radius;
+            if (distSq > r * r)
+            {
+                if (!swept)
+                    return false;
+
+                Vector3 start = a->previousPosition;
+                Vector3 end = a->position;
+                Vector3 dir = end - start;
+                float lenSq = dir.lengthSquared();
+                if (lenSq <= 1e-8f)
+                    return false;
+
+                AABB expanded = b->bounds;
+                expanded.min.x -= r;
+                expanded.min.y -= r;
+                expanded.min.z -= r;
+                expanded.max.x += r;
+                expanded.max.y += r;
+                expanded.max.z += r;
+
+                Ray ray(start, dir);
+                float tMin, tMax;
+                if (!ray.intersects(expanded, tMin, tMax) || tMax < 0.0f || tMin > 1.0f)
+                    return false;
+
+                float tHit = clamp(tMin, 0.0f, 1.0f);
+                Vector3 centerHit = start + dir * tHit;
+                Vector3 boxMin = b->bounds.min;
+                Vector3 boxMax = b->bounds.max;
+                float hx = fmaxf(boxMin.x, fminf(centerHit.x, boxMax.x));
+                float hy = fmaxf(boxMin.y, fminf(centerHit.y, boxMax.y));
+                float hz = fmaxf(boxMin.z, fminf(centerHit.z, boxMax.z));
+                Vector3 closestHit(hx, hy, hz);
+                Vector3 diffHit = closestHit - centerHit;
+                float distHitSq = diffHit.lengthSquared();
+                float distHit = distHitSq > 1e-8f ? sqrtf(distHitSq) : 0.0f;
+
+                Vector3 normal;
+                float penetration;
+                if (distHit > 1e-4f)
+                {
+                    normal = diffHit * (1.0f / distHit);
+                    penetration = r - distHit;
+                }
+                else
+                {
+                    normal = Vector3(0, -1, 0);
+                    penetration = r;
+                }
+                if (penetration < 0.0f)
+                    penetration = 0.0f;
+
+                setSingleContact(a, b, normal, closestHit, penetration, info);
+                return true;
+            }
+
+            float dist = distSq > 1e-8f ? sqrtf(distSq) : 0.0f;
+            Vector3 normal;
+            float penetration;
+            if (dist > 1e-4f)
+            {
+                normal = diff * (1.0f / dist);
+                penetration = r - dist;
+            }
+            else
+            {
+                float dx = halfExtents.x - fabsf(local.x);
+                float dy = halfExtents.y - fabsf(local.y);
+                float dz = halfExtents.z - fabsf(local.z);
+
+                Vector3 localN(0, -1, 0);
+                if (dx < dy && dx < dz)
+                    localN = Vector3((local.x > 0.0f) ? 1.0f : -1.0f, 0.0f, 0.0f);
+                else if (dy < dz)
+                    localN = Vector3(0.0f, (local.y > 0.0f) ? 1.0f : -1.0f, 0.0f);
+                else
+                    localN = Vector3(0.0f, 0.0f, (local.z > 0.0f) ? 1.0f : -1.0f);
+                normal = b->orientation.rotate(localN);
+                penetration = r;
+            }
+
+            setSingleContact(a, b, normal, closestWorld, penetration, info);
+            return true;
+        }
+
+        static bool boxSphere(RigidBody *a, RigidBody *b, bool swept, uint8_t &axisHint, CollisionInfo &info)
+        {
+            if (!sphereBox(b, a, swept, axisHint, info))
+                return false;
+            info.bodyA = a;
+            info.bodyB = b;
+            info.normal = info.normal * -1.0f;
+            return true;
+        }
+
+        // Separating axis test over the 15 box-box axes: 0-2 faces of a,
+        // 3-5 faces of b, 6-14 edge pairs (3 * edge of a + edge of b). The
+        // last separating axis is tested first, so pairs whose bounds
+        // overlap but that stay apart usually cost one axis.
+        static bool boxBox(RigidBody *a, RigidBody *b, bool, uint8_t &axisHint, CollisionInfo &info)
+        {
+            BoxPair p;
+            p.init(a, b);
+
+            Vector3 n;
+            if (axisHint < BOX_AXIS_COUNT && p.penetration(axisHint, n) < 0.0f)
+                return false;
+
+            int faceA = 0, faceB = 3, edge = -1;
+            float penA = FLT_MAX, penB = FLT_MAX, penEdge = FLT_MAX;
+            for (int axis = 0; axis < BOX_AXIS_COUNT; ++axis)
+            {
+                const float pen = p.penetration(axis, n);
+                if (pen < 0.0f)
+                {
+                    axisHint = static_cast<uint8_t>(axis);
+                    return false;
+                }
+                if (axis < 3)
+                {
+                    if (pen < penA)
+                    {
+                        penA = pen;
+                        faceA = axis;
+                    }
+                }
+                else if (axis < 6)
+                {
+                    if (pen < penB)
+                    {
+                        penB = pen;
+                        faceB = axis;
+                    }
+                }
+                else if (pen < penEdge)
+                {
+                    penEdge = pen;
+                    edge = axis;
+                }
+            }
+
+            int axis = faceA;
+            float pen = penA;
+            if (penB < AXIS_RELATIVE_TOLERANCE * pen - AXIS_ABSOLUTE_TOLERANCE)
+            {
+                axis = faceB;
+                pen = penB;
+            }
+            if (edge >= 0 && penEdge < AXIS_RELATIVE_TOLERANCE * pen - AXIS_ABSOLUTE_TOLERANCE)
+            {
+                axis = edge;
+                pen = penEdge;
+            }
+            p.penetration(axis, n);
+
+            info.hasCollision = true;
+            info.bodyA = a;
+            info.bodyB = b;
+            info.normal = n;
+            info.contactCount = 0;
+
+            if (axis < 6)
+                p.faceContacts(axis, n, info);
+            else
+                p.edgeContact(axis, n, pen, info);
+
+            if (info.contactCount == 0)
+            {
+                info.contactCount = 1;
+                info.contacts[0].pos = (p.ca + p.cb) * 0.5f;
+                info.contacts[0].penetration = pen;
+                info.contacts[0].accumulatedImpulse = 0.0f;
+                info.contacts[0].feature = 0;
+            }
+            return true;
+        }
+
+    private:
+        __attribute__((always_inline)) static inline float signOf(float v) { return v < 0.0f ? -1.0f : 1.0f; }
+
+        struct ClipVertex
+        {
+            Vector3 pos;
+            // Incident vertex 0-3, or 4 + 4 * edge + plane for a clip point.
+            uint8_t id;
+            // Edge the polygon leaves this vertex along: 0-3 incident face
+            // edges, 4-7 reference side planes.
+            uint8_t edge;
+        };
+
+        // Shared state of one box-box test; rotations are a's axes
+        // expressed against b's.
+        struct BoxPair
+        {
+            Vector3 ca, cb;
+            Vector3 axesA[3], axesB[3];
+            float extA[3], extB[3];
+            float R[3][3], absR[3][3];
+            float t[3];
+            Vector3 d;
+
+            void init(const RigidBody *a, const RigidBody *b)
+            {
+                ca = a->position;
+                cb = b->position;
+                axesA[0] = a->orientation.rotate(Vector3(1, 0, 0));
+                axesA[1] = a->orientation.rotate(Vector3(0, 1, 0));
+                axesA[2] = a->orientation.rotate(Vector3(0, 0, 1));
+                axesB[0] = b->orientation.rotate(Vector3(1, 0, 0));
+                axesB[1] = b->orientation.rotate(Vector3(0, 1, 0));
+                axesB[2] = b->orientation.rotate(Vector3(0, 0, 1));
+                extA[0] = a->size.x * 0.5f;
+                extA[1] = a->size.y * 0.5f;
+                extA[2] = a->size.z * 0.5f;
+                extB[0] = b->size.x * 0.5f;
+                extB[1] = b->size.y * 0.5f;
+                extB[2] = b->size.z * 0.5f;
+
+                // The epsilon keeps near-parallel edges from producing a
+                // false separating axis out of rounding noise.
+                for (int i = 0; i < 3; ++i)
+                {
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        R[i][j] = axesA[i].dot(axesB[j]);
+                        absR[i][j] = fabsf(R[i][j]) + 1e-4f;
+                    }
+                }
+
+                d = cb - ca;
+                t[0] = d.dot(axesA[0]);
+                t[1] = d.dot(axesA[1]);
+                t[2] = d.dot(axesA[2]);
+            }
+
+            // Overlap along axis (negative when it separates) and the unit
+            // axis oriented from a to b. Degenerate edge axes report FLT_MAX.
+            float penetration(int axis, Vector3 &n) const
+            {
+                if (axis < 3)
+                {
+                    const int i = axis;
+                    const float rb = extB[0] * absR[i][0] + extB[1] * absR[i][1] + extB[2] * absR[i][2];
+                    n = axesA[i] * signOf(t[i]);
+                    return extA[i] + rb - fabsf(t[i]);
+                }
+                if (axis < 6)
+                {
+                    const int j = axis - 3;
+                    const float ra = extA[0] * absR[0][j] + extA[1] * absR[1][j] + extA[2] * absR[2][j];
+                    const float dist = t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j];
+                    n = axesB[j] * signOf(dist);
+                    return ra + extB[j] - fabsf(dist);
+                }
+
+                const int i = (axis - 6) / 3;
+                const int j = (axis - 6) % 3;
+                const int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+                const int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+                const float lenSq = 1.0f - R[i][j] * R[i][j];
+                if (lenSq < 1e-6f)
+                {
+                    n = axesA[i];
+                    return FLT_MAX;
+                }
+                const float invLen = FastMath::fastInvSqrt(lenSq);
+                const float ra = extA[i1] * absR[i2][j] + extA[i2] * absR[i1][j];
+                const float rb = extB[j1] * absR[i][j2] + extB[j2] * absR[i][j1];
+                const float dist = t[i2] * R[i1][j] - t[i1] * R[i2][j];
+                n = axesA[i].cross(axesB[j]) * (invLen * signOf(dist));
+                return (ra + rb - fabsf(dist)) * invLen;
+            }
+
+            // Clips the incident face against the side planes of the
+            // reference face and keeps the points below it.
+            void faceContacts(int axis, const Vector3 &n, CollisionInfo &info) const
+            {
+                const bool refIsA = axis < 3;
+                const Vector3 *axesRef = refIsA ? axesA : axesB;
+                const Vector3 *axesInc = refIsA ? axesB : axesA;
+                const float *extRef = refIsA ? extA : extB;
+                const float *extInc = refIsA ? extB : extA;
+                const Vector3 &cRef = refIsA ? ca : cb;
+                const Vector3 &cInc = refIsA ? cb : ca;
+                // Points from the reference box into the incident one.
+                const Vector3 nRef = refIsA ? n : n * -1.0f;
+
+                const int r0 = axis % 3;
+                const float refSign = signOf(axesRef[r0].dot(nRef));
+                const Vector3 refCenter = cRef + axesRef[r0] * (refSign * extRef[r0]);
+
+                int k = 0;
+                float best = fabsf(axesInc[0].dot(nRef));
+                for (int c = 1; c < 3; ++c)
+                {
+                    const float v = fabsf(axesInc[c].dot(nRef));
+                    if (v > best)
+                    {
+                        best = v;
+                        k = c;
+                    }
+                }
+                const float incSign = -signOf(axesInc[k].dot(nRef));
+                const int k1 = (k + 1) % 3, k2 = (k + 2) % 3;
+                const Vector3 incCenter = cInc + axesInc[k] * (incSign * extInc[k]);
+                const Vector3 u = axesInc[k1] * extInc[k1];
+                const Vector3 v = axesInc[k2] * extInc[k2];
+
+                ClipVertex polyA[8], polyB[8];
+                polyA[0] = {incCenter + u + v, 0, 0};
+                polyA[1] = {incCenter - u + v, 1, 1};
+                polyA[2] = {incCenter - u - v, 2, 2};
+                polyA[3] = {incCenter + u - v, 3, 3};
+                int count = 4;
+
+                ClipVertex *in = polyA;
+                ClipVertex *out = polyB;
+                const int r1 = (r0 + 1) % 3, r2 = (r0 + 2) % 3;
+                for (int plane = 0; plane < 4 && count > 0; ++plane)
+                {
+                    const Vector3 &side = axesRef[plane < 2 ? r1 : r2];
+                    const float s = (plane & 1) ? -1.0f : 1.0f;
+                    const Vector3 m = side * s;
+                    const float offset = m.dot(cRef) + extRef[plane < 2 ? r1 : r2];
+                    count = clip(in, count, m, offset, static_cast<uint8_t>(plane), out);
+                    ClipVertex *tmp = in;
+                    in = out;
+                    out = tmp;
+                }
+
+                const uint16_t faceBits = static_cast<uint16_t>(
+                    FEATURE_FACE | (refIsA ? 0 : 0x1000) |
+                    ((r0 * 2 + (refSign > 0.0f ? 0 : 1)) << 9) |
+                    ((k * 2 + (incSign > 0.0f ? 0 : 1)) << 6));
+
+                Vector3 pos[8];
+                float depth[8];
+                uint16_t feature[8];
+                int found = 0;
+                for (int i = 0; i < count; ++i)
+                {
+                    const float sep = nRef.dot(in[i].pos - refCenter);
+                    if (sep > CONTACT_EPSILON)
+                        continue;
+                    pos[found] = in[i].pos - nRef * sep;
+                    depth[found] = fmaxf(0.0f, -sep);
+                    feature[found] = static_cast<uint16_t>(faceBits | in[i].id);
+                    ++found;
+                }
+
+                reduce(pos, depth, feature, found, n, info);
+            }
+
+            // Closest points between the two edges that meet along axis.
+            void edgeContact(int axis, const Vector3 &n, float pen, CollisionInfo &info) const
+            {
+                const int i = (axis - 6) / 3;
+                const int j = (axis - 6) % 3;
+
+                uint16_t signs = 0;
+                Vector3 pa = ca;
+                Vector3 pb = cb;
+                for (int c = 0, bit = 0; c < 3; ++c)
+                {
+                    if (c == i)
+                        continue;
+                    const float s = signOf(axesA[c].dot(n));
+                    pa += axesA[c] * (s * extA[c]);
+                    if (s > 0.0f)
+                        signs |= static_cast<uint16_t>(1u << bit);
+                    ++bit;
+                }
+                for (int c = 0, bit = 2; c < 3; ++c)
+                {
+                    if (c == j)
+                        continue;
+                    const float s = -signOf(axesB[c].dot(n));
+                    pb += axesB[c] * (s * extB[c]);
+                    if (s > 0.0f)
+                        signs |= static_cast<uint16_t>(1u << bit);
+                    ++bit;
+                }
+
+                const Vector3 &da = axesA[i];
+                const Vector3 &db = axesB[j];
+                const Vector3 r = pa - pb;
+                const float bdot = da.dot(db);
+                const float c = da.dot(r);
+                const float f = db.dot(r);
+                const float denom = 1.0f - bdot * bdot;
+                float s = denom > 1e-6f ? (bdot * f - c) / denom : 0.0f;
+                s = clamp(s, -extA[i], extA[i]);
+                float u = clamp(bdot * s + f, -extB[j], extB[j]);
+
+                info.contactCount = 1;
+                info.contacts[0].pos = (pa + da * s + pb + db * u) * 0.5f;
+                info.contacts[0].penetration = pen;
+                info.contacts[0].accumulatedImpulse = 0.0f;
+                info.contacts[0].feature = static_cast<uint16_t>(FEATURE_EDGE | ((axis - 6) << 4) | signs);
+            }
+
+            // Sutherland-Hodgman against m . p <= offset. Clip points are
+            // named after the edge they cut and the plane that cut it, so
+            // the same geometry yields the same IDs from step to step.
+            static int clip(const ClipVertex *in, int count, const Vector3 &m, float offset,
+                            uint8_t plane, ClipVertex *out)
+            {
+                int n = 0;
+                for (int i = 0; i < count; ++i)
+                {
+                    const ClipVertex &cur = in[i];
+                    const ClipVertex &next = in[(i + 1) % count];
+                    const float dc = m.dot(cur.pos) - offset;
+                    const float dn = m.dot(next.pos) - offset;
+                    if (dc <= 0.0f)
+                        out[n++] = cur;
+                    if ((dc <= 0.0f) != (dn <= 0.0f) && n < 8)
+                    {
+                        const float t = dc / (dc - dn);
+                        ClipVertex &v = out[n++];
+                        v.pos = cur.pos + (next.pos - cur.pos) * t;
+                        v.id = static_cast<uint8_t>(4 + cur.edge * 4 + plane);
+                        // Entering keeps walking the cut edge; leaving walks the plane.
+                        v.edge = dc > 0.0f ? cur.edge : static_cast<uint8_t>(4 + plane);
+                    }
+                }
+                return n;
+            }
+        };
+
+        // Keeps at most four points: the deepest, the one farthest from it,
+        // then the two that span the largest area on either side of that
+        // segment.
+        static void reduce(const Vector3 *pos, const float *depth, const uint16_t *feature, int count,
+                           const Vector3 &n, CollisionInfo &info)
+        {
+            int pick[4];
+            int picked = 0;
+            if (count <= 4)
+            {
+                for (int i = 0; i < count; ++i)
+                    pick[picked++] = i;
+            }
+            else
+            {
+                int i0 = 0;
+                for (int i = 1; i < count; ++i)
+                {
+                    if (depth[i] > depth[i0])
+                        i0 = i;
+                }
+
+                int i1 = i0 == 0 ? 1 : 0;
+                float bestDist = -1.0f;
+                for (int i = 0; i < count; ++i)
+                {
+                    if (i == i0)
+                        continue;
+                    const float distSq = (pos[i] - pos[i0]).lengthSquared();
+                    if (distSq > bestDist)
+                    {
+                        bestDist = distSq;
+                        i1 = i;
+                    }
+                }
+
+                const Vector3 e = pos[i1] - pos[i0];
+                int i2 = -1;
+                float bestArea = 0.0f;
+                float side = 1.0f;
+                for (int i = 0; i < count; ++i)
+                {
+                    if (i == i0 || i == i1)
+                        continue;
+                    const float area = e.cross(pos[i] - pos[i0]).dot(n);
+                    if (fabsf(area) > bestArea)
+                    {
+                        bestArea = fabsf(area);
+                        side = area < 0.0f ? -1.0f : 1.0f;
+                        i2 = i;
+                    }
+                }
+
+                int i3 = -1;
+                bestArea = 0.0f;
+                for (int i = 0; i < count; ++i)
+                {
+                    if (i == i0 || i == i1 || i == i2)
+                        continue;
+                    const float area = -side * e.cross(pos[i] - pos[i0]).dot(n);
+                    if (area > bestArea)
+                    {
+                        bestArea = area;
+                        i3 = i;
+                    }
+                }
+
+                pick[picked++] = i0;
+                pick[picked++] = i1;
+                if (i2 >= 0)
+                    pick[picked++] = i2;
+                if (i3 >= 0)
+                    pick[picked++] = i3;
+            }
+
+            info.contactCount = picked;
+            for (int i = 0; i < picked; ++i)
+            {
+                Contact &c = info.contacts[i];
+                c.pos = pos[pick[i]];
+                c.penetration = depth[pick[i]];
+                c.accumulatedImpulse = 0.0f;
+                c.feature = feature[pick[i]];
+            }
+        }
+    };
+
+}
+
+#endif
@@ -9,8 +9,10 @@
 
 #include "Body.h"
 #include "Contacts.h"
+#include "Broadphase.h"
 #include "Constraints.h"
 #include "World.h"
 #include "Rope.h"
+#include "RopeSystem.h"
 
 #endif
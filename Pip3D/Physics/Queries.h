@@ -0,0 +1,161 @@
+#ifndef PIP3D_PHYSICS_QUERIES_H
+#define PIP3D_PHYSICS_QUERIES_H
+
+#include <float.h>
+
+#include "../Math/Collision.h"
+#include "Body.h"
+#include "CCD.h"
+
+namespace pip3D
+{
+
+    // First contact of a swept shape. fraction is the part of the sweep
+    // travelled before touching; point and normal are on the body hit.
+    struct SweepHit
+    {
+        bool hit;
+        float fraction;
+        Vector3 point;
+        Vector3 normal;
+        RigidBody *body;
+
+        SweepHit()
+            : hit(false), fraction(1.0f), point(0.0f, 0.0f, 0.0f), normal(0.0f, 1.0f, 0.0f), body(nullptr) {}
+    };
+
+    // Narrowphase tests of one query against one body.
+    struct PhysicsQuery
+    {
+        static bool raycastBody(const Ray &ray, const RigidBody &b, float maxDistance, float &outT, Vector3 &outNormal)
+        {
+            float tMinAABB, tMaxAABB;
+            if (!ray.intersects(b.bounds, tMinAABB, tMaxAABB) || tMaxAABB < 0.0f)
+                return false;
+
+            if (b.shape == BODY_SHAPE_SPHERE)
+            {
+                CollisionSphere s(b.position, b.radius);
+                float tSphere;
+                if (!ray.intersects(s, tSphere) || tSphere < 0.0f || tSphere > maxDistance)
+                    return false;
+
+                Vector3 n = ray.at(tSphere) - b.position;
+                float nLenSq = n.lengthSquared();
+                if (nLenSq > 1e-8f)
+                    n *= FastMath::fastInvSqrt(nLenSq);
+                else
+                    n = Vector3(0.0f, 1.0f, 0.0f);
+                outT = tSphere;
+                outNormal = n;
+                return true;
+            }
+
+            Vector3 half = b.size * 0.5f;
+
+            Quaternion invRot = b.orientation.conjugate();
+            Vector3 localOrigin = invRot.rotate(ray.origin - b.position);
+            Vector3 localDir = invRot.rotate(ray.direction);
+
+            Ray localRay(localOrigin, localDir);
+            AABB localBox(Vector3(-half.x, -half.y, -half.z), Vector3(half.x, half.y, half.z));
+
+            float tMin, tMax;
+            if (!localRay.intersects(localBox, tMin, tMax))
+                return false;
+
+            float tHit = tMin >= 0.0f ? tMin : tMax;
+            if (tHit < 0.0f || tHit > maxDistance)
+                return false;
+
+            Vector3 localHit = localRay.at(tHit);
+            float dx = half.x - fabsf(localHit.x);
+            float dy = half.y - fabsf(localHit.y);
+            float dz = half.z - fabsf(localHit.z);
+
+            Vector3 localN(0.0f, 1.0f, 0.0f);
+            if (dx <= dy && dx <= dz)
+            {
+                localN = Vector3((localHit.x > 0.0f) ? 1.0f : -1.0f, 0.0f, 0.0f);
+            }
+            else if (dy <= dz)
+            {
+                localN = Vector3(0.0f, (localHit.y > 0.0f) ? 1.0f : -1.0f, 0.0f);
+            }
+            else
+            {
+                localN = Vector3(0.0f, 0.0f, (localHit.z > 0.0f) ? 1.0f : -1.0f);
+            }
+
+            outT = tHit;
+            outNormal = b.orientation.rotate(localN);
+            return true;
+        }
+
+        // Closest point of the body's surface or volume to p.
+        static Vector3 closestPoint(const RigidBody &b, const Vector3 &p)
+        {
+            if (b.shape == BODY_SHAPE_SPHERE)
+            {
+                Vector3 d = p - b.position;
+                float lenSq = d.lengthSquared();
+                if (lenSq <= b.radius * b.radius)
+                    return p;
+                return b.position + d * (b.radius * FastMath::fastInvSqrt(lenSq));
+            }
+
+            Vector3 local = b.orientation.conjugate().rotate(p - b.position);
+            Vector3 half = b.size * 0.5f;
+            local.x = fminf(fmaxf(local.x, -half.x), half.x);
+            local.y = fminf(fmaxf(local.y, -half.y), half.y);
+            local.z = fminf(fmaxf(local.z, -half.z), half.z);
+            return b.position + b.orientation.rotate(local);
+        }
+
+        // Sphere of radius moving from start by delta against one body.
+        // Sweeps that start touching and move away are not hits.
+        static bool sweepSphereBody(const Vector3 &start,
+                                    const Vector3 &delta,
+                                    float radius,
+                                    const RigidBody &b,
+                                    float &outFraction,
+                                    Vector3 &outPoint,
+                                    Vector3 &outNormal)
+        {
+            float toi;
+            if (!ContinuousCollision::timeOfImpact(start, delta, radius, b, toi))
+                return false;
+
+            const Vector3 center = start + delta * toi;
+            const Vector3 surface = closestPoint(b, center);
+            Vector3 n = center - surface;
+            const float lenSq = n.lengthSquared();
+            if (lenSq > 1e-10f)
+            {
+                n *= FastMath::fastInvSqrt(lenSq);
+            }
+            else
+            {
+                // Centre already inside: push straight back along the sweep.
+                n = delta * -1.0f;
+                n.normalize();
+            }
+
+            outFraction = toi;
+            outPoint = surface;
+            outNormal = n;
+            return true;
+        }
+
+        static AABB sweptSphereBounds(const Vector3 &start, const Vector3 &delta, float radius)
+        {
+            const Vector3 end = start + delta;
+            const Vector3 r(radius, radius, radius);
+            return AABB(Vector3(fminf(start.x, end.x), fminf(start.y, end.y), fminf(start.z, end.z)) - r,
+                        Vector3(fmaxf(start.x, end.x), fmaxf(start.y, end.y), fmaxf(start.z, end.z)) + r);
+        }
+    };
+
+}
+
+#endif
@@ -221,7 +221,7 @@ namespace pip3D
                     float penetration = floorHeight - n.position.y;
                     n.position.y = floorHeight;
                     (void)penetration;
-                    applyFriction(n, Vector3(0.0f, 1.0f, 0.0f), floorFriction);
+                    applyFriction(n.position, n.prevPosition, floorFriction);
                 }
 
                 for (size_t b = 0; b < bodyCount; ++b)
@@ -230,14 +230,7 @@ namespace pip3D
                     if (!body)
                         continue;
 
-                    if (body->shape == BODY_SHAPE_SPHERE)
-                    {
-                        resolveSphereCollision(n, *body);
-                    }
-                    else
-                    {
-                        resolveBoxCollision(n, *body);
-                    }
+                    resolveBodyCollision(n.position, n.prevPosition, *body, collisionFriction);
                 }
             }
         }
@@ -257,6 +250,8 @@ namespace pip3D
             if (vp.width == 0 || vp.height == 0)
                 return;
 
+            const uint16_t pixel = PixelFormat::encode(color);
+
             for (int i = 0; i < nodeCount - 1; ++i)
             {
                 const Node &a = nodes[i];
@@ -268,7 +263,7 @@ namespace pip3D
                 if (!projectToScreen(renderer, vp, b.position, x1, y1))
                     continue;
 
-                drawLine2D(fb, vp, x0, y0, x1, y1, color, thickness);
+                drawLine2D(fb, vp, x0, y0, x1, y1, pixel, thickness);
             }
         }
 
@@ -337,25 +332,37 @@ namespace pip3D
             }
         }
 
-        void applyFriction(Node &n, const Vector3 & /*normal*/, float friction)
+        friend class RopeSystem;
+
+        static void applyFriction(const Vector3 &position, Vector3 &prevPosition, float friction)
         {
             if (friction <= 0.0f)
                 return;
             if (friction > 1.0f)
                 friction = 1.0f;
 
-            Vector3 vel = n.position - n.prevPosition;
+            Vector3 vel = position - prevPosition;
             vel *= (1.0f - friction);
-            n.prevPosition = n.position - vel;
+            prevPosition = position - vel;
+        }
+
+        static void resolveBodyCollision(Vector3 &position, Vector3 &prevPosition,
+                                         const RigidBody &body, float friction)
+        {
+            if (body.shape == BODY_SHAPE_SPHERE)
+                resolveSphereCollision(position, prevPosition, body, friction);
+            else
+                resolveBoxCollision(position, prevPosition, body, friction);
         }
 
-        void resolveSphereCollision(Node &n, const RigidBody &body)
+        static void resolveSphereCollision(Vector3 &position, Vector3 &prevPosition,
+                                           const RigidBody &body, float friction)
         {
             float r = body.radius;
             if (r <= 0.0f)
                 return;
 
-            Vector3 toNode = n.position - body.position;
+            Vector3 toNode = position - body.position;
             float distSq = toNode.lengthSquared();
             float rSq = r * r;
             if (distSq >= rSq || distSq <= 1e-8f)
@@ -365,18 +372,19 @@ namespace pip3D
             Vector3 normal = toNode * (1.0f / dist);
             float penetration = r - dist;
 
-            n.position += normal * penetration;
-            applyFriction(n, normal, collisionFriction);
+            position += normal * penetration;
+            applyFriction(position, prevPosition, friction);
         }
 
-        void resolveBoxCollision(Node &n, const RigidBody &body)
+        static void resolveBoxCollision(Vector3 &position, Vector3 &prevPosition,
+                                        const RigidBody &body, float friction)
         {
             Vector3 half = body.size * 0.5f;
             if (half.x <= 0.0f || half.y <= 0.0f || half.z <= 0.0f)
                 return;
 
             Quaternion invRot = body.orientation.conjugate();
-            Vector3 local = invRot.rotate(n.position - body.position);
+            Vector3 local = invRot.rotate(position - body.position);
 
             float ax = fabsf(local.x);
             float ay = fabsf(local.y);
@@ -412,8 +420,8 @@ namespace pip3D
 
             Vector3 worldNormal = body.orientation.rotate(localNormal);
 
-            n.position += worldNormal * penetration;
-            applyFriction(n, worldNormal, collisionFriction);
+            position += worldNormal * penetration;
+            applyFriction(position, prevPosition, friction);
         }
 
         static bool projectToScreen(Renderer &renderer,
@@ -452,10 +460,11 @@ namespace pip3D
             int sy = (y0 < y1) ? 1 : -1;
             int err = dx - dy;
 
+            // The framebuffer only holds the current band.
             const int vpX = viewport.x;
-            const int vpY = viewport.y;
+            const int vpY = viewport.y + currentBandOffsetY();
             const int vpW = static_cast<int>(viewport.width);
-            const int vpH = static_cast<int>(viewport.height);
+            const int vpH = static_cast<int>(currentBandHeight());
 
             int half = thickness > 0 ? (thickness - 1) / 2 : 0;
 
@@ -0,0 +1,661 @@
+#ifndef PIP3D_PHYSICS_ROPESYSTEM_H
+#define PIP3D_PHYSICS_ROPESYSTEM_H
+
+#include <vector>
+
+#include "../Core/Jobs.h"
+#include "../Math/Collision.h"
+#include "Body.h"
+#include "Rope.h"
+#include "World.h"
+
+// Consecutive nodes of a strand that share one bounding box for the
+// node-body overlap test.
+#ifndef PIP3D_ROPE_CHUNK_NODES
+#define PIP3D_ROPE_CHUNK_NODES 16
+#endif
+
+// Smallest pass worth splitting between both cores.
+#ifndef PIP3D_ROPE_PARALLEL_MIN
+#define PIP3D_ROPE_PARALLEL_MIN 64
+#endif
+
+namespace pip3D
+{
+
+    // Ropes and cloth sheets simulated together. The nodes of every strand
+    // live in one set of arrays, and distance links are grouped by color so
+    // that no two links of a color share a node: a chain alternates red and
+    // black links, a cloth sheet adds two more colors for its columns. Each
+    // color is one pass that the job system splits between both cores.
+    // Node-body collisions only test chunks of nodes whose bounds overlap a
+    // body's bounds, found with a sort-and-sweep like the world broadphase.
+    class RopeSystem
+    {
+    public:
+        struct Strand
+        {
+            uint16_t firstNode;
+            uint16_t nodeCount;
+            // Nodes per row of a cloth sheet, 0 for a rope.
+            uint16_t columns;
+        };
+
+        struct Link
+        {
+            uint16_t a;
+            uint16_t b;
+            float restLength;
+        };
+
+        static constexpr int MAX_NODES = 0xFFFF;
+        // Links that fit no color go to a last group solved on one core.
+        static constexpr int MAX_COLORS = 31;
+
+    private:
+        struct ScreenNode
+        {
+            int16_t x;
+            int16_t y;
+            bool visible;
+        };
+
+        struct Chunk
+        {
+            uint16_t firstNode;
+            uint16_t nodeCount;
+            AABB bounds;
+        };
+
+        std::vector<Vector3> positions;
+        std::vector<Vector3> prevPositions;
+        std::vector<uint8_t> fixedFlags;
+        std::vector<Strand> strands;
+
+        // Links in insertion order; sorted by color into links on the next
+        // simulate() after a strand is added.
+        std::vector<Link> pendingLinks;
+        std::vector<Link> links;
+        uint32_t colorStart[MAX_COLORS + 2];
+        int colorCount;
+        bool linksDirty;
+
+        std::vector<Chunk> chunks;
+        std::vector<RigidBody *> candidates;
+        std::vector<uint16_t> bodyOrder;
+        std::vector<ScreenNode> projected;
+        uint32_t overlapTests;
+        uint32_t collisionPairs;
+
+        int iterations;
+        Vector3 gravity;
+        float airDamping;
+        float floorHeight;
+        float floorFriction;
+        float collisionFriction;
+
+        // Arguments of the pass running under parallelFor.
+        Vector3 stepGravity;
+        uint32_t passBase;
+
+        static float clamp01(float v)
+        {
+            if (v < 0.0f)
+                return 0.0f;
+            if (v > 1.0f)
+                return 1.0f;
+            return v;
+        }
+
+        __attribute__((always_inline)) static inline float axisMin(const AABB &bb, int ax)
+        {
+            return ax == 0 ? bb.min.x : (ax == 1 ? bb.min.y : bb.min.z);
+        }
+
+        __attribute__((always_inline)) static inline float axisMax(const AABB &bb, int ax)
+        {
+            return ax == 0 ? bb.max.x : (ax == 1 ? bb.max.y : bb.max.z);
+        }
+
+        bool reserveNodes(int count)
+        {
+            if (count < 1 || positions.size() + static_cast<size_t>(count) > static_cast<size_t>(MAX_NODES))
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_PHYSICS,
+                     "RopeSystem: cannot add %d nodes (have %u, max %d)",
+                     count, static_cast<unsigned int>(positions.size()), MAX_NODES);
+                return false;
+            }
+            return true;
+        }
+
+        void addNode(const Vector3 &p, bool fixed)
+        {
+            positions.push_back(p);
+            prevPositions.push_back(p);
+            fixedFlags.push_back(fixed ? 1 : 0);
+        }
+
+        void addLink(uint32_t a, uint32_t b)
+        {
+            const float rest = (positions[b] - positions[a]).length();
+            pendingLinks.push_back({static_cast<uint16_t>(a), static_cast<uint16_t>(b), rest});
+            linksDirty = true;
+        }
+
+        // Greedy coloring in insertion order, then a stable counting sort so
+        // each color keeps its links in strand order.
+        void buildLinks()
+        {
+            const size_t count = pendingLinks.size();
+            std::vector<uint32_t> used(positions.size(), 0u);
+            std::vector<uint8_t> colorOf(count);
+            uint32_t counts[MAX_COLORS + 1] = {};
+            colorCount = 0;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Link &l = pendingLinks[i];
+                const uint32_t busy = used[l.a] | used[l.b];
+                int c = 0;
+                while (c < MAX_COLORS && (busy & (1u << c)))
+                    ++c;
+                if (c < MAX_COLORS)
+                {
+                    used[l.a] |= 1u << c;
+                    used[l.b] |= 1u << c;
+                    if (c + 1 > colorCount)
+                        colorCount = c + 1;
+                }
+                colorOf[i] = static_cast<uint8_t>(c);
+                counts[c]++;
+            }
+
+            uint32_t offset = 0;
+            for (int c = 0; c < colorCount; ++c)
+            {
+                colorStart[c] = offset;
+                offset += counts[c];
+            }
+            colorStart[colorCount] = offset;
+            colorStart[colorCount + 1] = offset + counts[MAX_COLORS];
+
+            uint32_t cursor[MAX_COLORS + 1];
+            for (int c = 0; c < colorCount; ++c)
+                cursor[c] = colorStart[c];
+            cursor[MAX_COLORS] = colorStart[colorCount];
+
+            links.resize(count);
+            for (size_t i = 0; i < count; ++i)
+                links[cursor[colorOf[i]]++] = pendingLinks[i];
+
+            if (counts[MAX_COLORS] > 0)
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_PHYSICS,
+                     "RopeSystem: %u links exceed %d colors and run on one core",
+                     static_cast<unsigned int>(counts[MAX_COLORS]), MAX_COLORS);
+            }
+
+            chunks.clear();
+            for (size_t s = 0; s < strands.size(); ++s)
+            {
+                const Strand &strand = strands[s];
+                for (uint32_t n = 0; n < strand.nodeCount; n += PIP3D_ROPE_CHUNK_NODES)
+                {
+                    uint32_t size = strand.nodeCount - n;
+                    if (size > PIP3D_ROPE_CHUNK_NODES)
+                        size = PIP3D_ROPE_CHUNK_NODES;
+                    chunks.push_back({static_cast<uint16_t>(strand.firstNode + n),
+                                      static_cast<uint16_t>(size), AABB()});
+                }
+            }
+
+            linksDirty = false;
+        }
+
+        static void integrateRange(uint32_t begin, uint32_t end, void *userData)
+        {
+            RopeSystem *self = static_cast<RopeSystem *>(userData);
+            Vector3 *pos = self->positions.data();
+            Vector3 *prev = self->prevPositions.data();
+            const uint8_t *fixed = self->fixedFlags.data();
+            const Vector3 g = self->stepGravity;
+            const float damping = self->airDamping;
+
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                if (fixed[i])
+                    continue;
+
+                Vector3 cur = pos[i];
+                Vector3 vel = (cur - prev[i]) * damping;
+                prev[i] = cur;
+                pos[i] = cur + vel + g;
+            }
+        }
+
+        static void solveRange(uint32_t begin, uint32_t end, void *userData)
+        {
+            RopeSystem *self = static_cast<RopeSystem *>(userData);
+            const Link *batch = self->links.data() + self->passBase;
+            Vector3 *pos = self->positions.data();
+            const uint8_t *fixed = self->fixedFlags.data();
+
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                const Link &l = batch[i];
+                const bool fa = fixed[l.a] != 0;
+                const bool fb = fixed[l.b] != 0;
+                if (fa && fb)
+                    continue;
+
+                Vector3 &a = pos[l.a];
+                Vector3 &b = pos[l.b];
+                Vector3 delta = b - a;
+                float distSq = delta.lengthSquared();
+                if (distSq <= 1e-8f)
+                    continue;
+
+                float dist = sqrtf(distSq);
+                float diff = (dist - l.restLength) / dist;
+
+                if (!fa && !fb)
+                {
+                    Vector3 correction = delta * (0.5f * diff);
+                    a += correction;
+                    b -= correction;
+                }
+                else if (fa)
+                {
+                    b -= delta * diff;
+                }
+                else
+                {
+                    a += delta * diff;
+                }
+            }
+        }
+
+        void runPass(uint32_t count, ParallelForFunc func)
+        {
+            if (count >= PIP3D_ROPE_PARALLEL_MIN)
+                JobSystem::parallelFor(count, (count + 1) / 2, func, this);
+            else
+                func(0, count, this);
+        }
+
+    public:
+        RopeSystem()
+            : colorCount(0),
+              linksDirty(false),
+              overlapTests(0),
+              collisionPairs(0),
+              iterations(8),
+              gravity(0.0f, -9.81f, 0.0f),
+              airDamping(0.98f),
+              floorHeight(0.0f),
+              floorFriction(0.6f),
+              collisionFriction(0.6f),
+              stepGravity(0.0f, 0.0f, 0.0f),
+              passBase(0)
+        {
+            colorStart[0] = 0;
+            colorStart[1] = 0;
+        }
+
+        // Adds a straight rope of segments links; returns its strand index
+        // or -1 when the node limit would be exceeded.
+        int addRope(const Vector3 &start,
+                    const Vector3 &end,
+                    int segments,
+                    bool fixStart = true,
+                    bool fixEnd = false)
+        {
+            if (segments < 1)
+                segments = 1;
+            if (!reserveNodes(segments + 1))
+                return -1;
+
+            Vector3 delta = end - start;
+            if (delta.lengthSquared() <= 1e-10f)
+                delta = Vector3(0.0f, -1.0f, 0.0f);
+            const Vector3 step = delta * (1.0f / static_cast<float>(segments));
+
+            const uint32_t first = static_cast<uint32_t>(positions.size());
+            for (int i = 0; i <= segments; ++i)
+            {
+                const bool fixed = (i == 0 && fixStart) || (i == segments && fixEnd);
+                addNode(start + step * static_cast<float>(i), fixed);
+            }
+            for (int i = 0; i < segments; ++i)
+                addLink(first + i, first + i + 1);
+
+            strands.push_back({static_cast<uint16_t>(first), static_cast<uint16_t>(segments + 1), 0});
+            return static_cast<int>(strands.size()) - 1;
+        }
+
+        // Adds a cloth sheet of (columns + 1) x (rows + 1) nodes spanning
+        // width and height from origin, linked to its row and column
+        // neighbours. Returns its strand index or -1.
+        int addCloth(const Vector3 &origin,
+                     const Vector3 &width,
+                     const Vector3 &height,
+                     int columns,
+                     int rows,
+                     bool pinTopRow = true)
+        {
+            if (columns < 1)
+                columns = 1;
+            if (rows < 1)
+                rows = 1;
+            const int rowNodes = columns + 1;
+            if (!reserveNodes(rowNodes * (rows + 1)))
+                return -1;
+
+            const Vector3 du = width * (1.0f / static_cast<float>(columns));
+            const Vector3 dv = height * (1.0f / static_cast<float>(rows));
+
+            const uint32_t first = static_cast<uint32_t>(positions.size());
+            for (int r = 0; r <= rows; ++r)
+            {
+                for (int c = 0; c < rowNodes; ++c)
+                    addNode(origin + du * static_cast<float>(c) + dv * static_cast<float>(r), pinTopRow && r == 0);
+            }
+
+            // Even links before odd ones so greedy coloring needs four colors.
+            for (int parity = 0; parity < 2; ++parity)
+            {
+                for (int r = 0; r <= rows; ++r)
+                {
+                    for (int c = parity; c < columns; c += 2)
+                        addLink(first + r * rowNodes + c, first + r * rowNodes + c + 1);
+                }
+            }
+            for (int parity = 0; parity < 2; ++parity)
+            {
+                for (int r = parity; r < rows; r += 2)
+                {
+                    for (int c = 0; c < rowNodes; ++c)
+                        addLink(first + r * rowNodes + c, first + (r + 1) * rowNodes + c);
+                }
+            }
+
+            strands.push_back({static_cast<uint16_t>(first),
+                               static_cast<uint16_t>(rowNodes * (rows + 1)),
+                               static_cast<uint16_t>(rowNodes)});
+            return static_cast<int>(strands.size()) - 1;
+        }
+
+        void clear()
+        {
+            positions.clear();
+            prevPositions.clear();
+            fixedFlags.clear();
+            strands.clear();
+            pendingLinks.clear();
+            links.clear();
+            chunks.clear();
+            colorCount = 0;
+            colorStart[0] = 0;
+            colorStart[1] = 0;
+            linksDirty = false;
+        }
+
+        void setIterations(int it)
+        {
+            if (it < 1)
+                it = 1;
+            if (it > 32)
+                it = 32;
+            iterations = it;
+        }
+
+        void setGravity(const Vector3 &g)
+        {
+            gravity = g;
+        }
+
+        void setAirDamping(float d)
+        {
+            airDamping = clamp01(d);
+        }
+
+        void setFloorHeight(float h)
+        {
+            floorHeight = h;
+        }
+
+        void setFloorFriction(float f)
+        {
+            floorFriction = clamp01(f);
+        }
+
+        void setCollisionFriction(float f)
+        {
+            collisionFriction = clamp01(f);
+        }
+
+        int getStrandCount() const
+        {
+            return static_cast<int>(strands.size());
+        }
+
+        const Strand &getStrand(int index) const
+        {
+            return strands[index];
+        }
+
+        int getNodeCount() const
+        {
+            return static_cast<int>(positions.size());
+        }
+
+        const Vector3 &getNodePosition(int index) const
+        {
+            return positions[index];
+        }
+
+        // Moves a node without giving it velocity, e.g. to carry an anchor.
+        void setNodePosition(int index, const Vector3 &p)
+        {
+            positions[index] = p;
+            prevPositions[index] = p;
+        }
+
+        bool isNodeFixed(int index) const
+        {
+            return fixedFlags[index] != 0;
+        }
+
+        void setNodeFixed(int index, bool fixed)
+        {
+            fixedFlags[index] = fixed ? 1 : 0;
+        }
+
+        // Colors after the last simulate(), not counting the one-core group.
+        int getColorCount() const
+        {
+            return colorCount;
+        }
+
+        // Chunk-body bound tests and overlapping pairs of the last
+        // resolveCollisions().
+        uint32_t getOverlapTests() const { return overlapTests; }
+        uint32_t getCollisionPairs() const { return collisionPairs; }
+
+        void simulate(float dt)
+        {
+            if (dt <= 0.0f || positions.empty())
+                return;
+            if (linksDirty)
+                buildLinks();
+
+            stepGravity = gravity * (dt * dt);
+            runPass(static_cast<uint32_t>(positions.size()), integrateRange);
+
+            for (int it = 0; it < iterations; ++it)
+            {
+                for (int c = 0; c < colorCount; ++c)
+                {
+                    passBase = colorStart[c];
+                    runPass(colorStart[c + 1] - colorStart[c], solveRange);
+                }
+
+                passBase = colorStart[colorCount];
+                const uint32_t overflow = colorStart[colorCount + 1] - passBase;
+                if (overflow > 0)
+                    solveRange(0, overflow, this);
+            }
+        }
+
+        // Pushes nodes out of the floor and out of bodies. Bodies are culled
+        // by RigidBody::bounds, which the world keeps current; bodies moved
+        // by hand need updateBoundsFromTransform() first.
+        void resolveCollisions(RigidBody *const *bodies, size_t bodyCount)
+        {
+            overlapTests = 0;
+            collisionPairs = 0;
+
+            const size_t nodeCount = positions.size();
+            if (nodeCount == 0)
+                return;
+            if (linksDirty)
+                buildLinks();
+
+            Vector3 *pos = positions.data();
+            Vector3 *prev = prevPositions.data();
+            const uint8_t *fixed = fixedFlags.data();
+
+            for (size_t i = 0; i < nodeCount; ++i)
+            {
+                if (fixed[i] || pos[i].y >= floorHeight)
+                    continue;
+                pos[i].y = floorHeight;
+                Rope::applyFriction(pos[i], prev[i], floorFriction);
+            }
+
+            candidates.clear();
+            for (size_t b = 0; b < bodyCount; ++b)
+            {
+                if (bodies[b])
+                    candidates.push_back(bodies[b]);
+            }
+            if (candidates.empty())
+                return;
+
+            AABB all(pos[0], pos[0]);
+            for (size_t c = 0; c < chunks.size(); ++c)
+            {
+                Chunk &chunk = chunks[c];
+                const Vector3 *p = pos + chunk.firstNode;
+                chunk.bounds = AABB(p[0], p[0]);
+                for (uint32_t n = 1; n < chunk.nodeCount; ++n)
+                    chunk.bounds.expand(p[n]);
+                all.merge(chunk.bounds);
+            }
+
+            // Sweep along the longest extent of the system.
+            const Vector3 extent = all.size();
+            const int ax = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+            const size_t count = candidates.size();
+            if (bodyOrder.size() != count)
+            {
+                bodyOrder.resize(count);
+                for (size_t i = 0; i < count; ++i)
+                    bodyOrder[i] = static_cast<uint16_t>(i);
+            }
+            for (size_t i = 1; i < count; ++i)
+            {
+                const uint16_t idx = bodyOrder[i];
+                const float key = axisMin(candidates[idx]->bounds, ax);
+                size_t j = i;
+                while (j > 0 && axisMin(candidates[bodyOrder[j - 1]]->bounds, ax) > key)
+                {
+                    bodyOrder[j] = bodyOrder[j - 1];
+                    --j;
+                }
+                bodyOrder[j] = idx;
+            }
+
+            for (size_t c = 0; c < chunks.size(); ++c)
+            {
+                const Chunk &chunk = chunks[c];
+                const float cMin = axisMin(chunk.bounds, ax);
+                const float cMax = axisMax(chunk.bounds, ax);
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const RigidBody *body = candidates[bodyOrder[i]];
+                    if (axisMin(body->bounds, ax) > cMax)
+                        break;
+                    if (axisMax(body->bounds, ax) < cMin)
+                        continue;
+
+                    overlapTests++;
+                    if (!chunk.bounds.intersects(body->bounds))
+                        continue;
+
+                    collisionPairs++;
+                    const uint32_t end = chunk.firstNode + chunk.nodeCount;
+                    for (uint32_t n = chunk.firstNode; n < end; ++n)
+                    {
+                        if (fixed[n])
+                            continue;
+                        Rope::resolveBodyCollision(pos[n], prev[n], *body, collisionFriction);
+                    }
+                }
+            }
+        }
+
+        void resolveCollisions(const PhysicsWorld &world)
+        {
+            const std::vector<RigidBody *> &bodies = world.getBodies();
+            resolveCollisions(bodies.data(), bodies.size());
+        }
+
+        // Draws every link as a line; nodes are projected once per call.
+        void renderLines(Renderer &renderer,
+                         uint16_t color,
+                         uint8_t thickness = 1)
+        {
+            if (linksDirty)
+                buildLinks();
+            if (links.empty())
+                return;
+
+            uint16_t *fb = renderer.getFrameBuffer();
+            if (!fb)
+                return;
+
+            const Viewport &vp = renderer.getViewport();
+            if (vp.width == 0 || vp.height == 0)
+                return;
+
+            const uint16_t pixel = PixelFormat::encode(color);
+
+            const size_t nodeCount = positions.size();
+            projected.resize(nodeCount);
+            for (size_t i = 0; i < nodeCount; ++i)
+            {
+                int sx = 0, sy = 0;
+                const bool visible = Rope::projectToScreen(renderer, vp, positions[i], sx, sy);
+                projected[i] = {static_cast<int16_t>(sx), static_cast<int16_t>(sy), visible};
+            }
+
+            const size_t linkCount = links.size();
+            for (size_t i = 0; i < linkCount; ++i)
+            {
+                const ScreenNode &a = projected[links[i].a];
+                const ScreenNode &b = projected[links[i].b];
+                if (!a.visible || !b.visible)
+                    continue;
+
+                Rope::drawLine2D(fb, vp, a.x, a.y, b.x, b.y, pixel, thickness);
+            }
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef PIP3D_PHYSICS_SNAPSHOT_H
+#define PIP3D_PHYSICS_SNAPSHOT_H
+
+#include <atomic>
+#include <vector>
+#include "Body.h"
+
+namespace pip3D
+{
+
+    // Body transform as of the end of a published step.
+    struct PhysicsBodyState
+    {
+        const RigidBody *body;
+        Vector3 position;
+        Vector3 previousPosition;
+        Quaternion orientation;
+        Quaternion previousOrientation;
+        AABB bounds;
+        bool isSleeping;
+
+        __attribute__((always_inline)) inline void interpolatedPose(float alpha, Vector3 &pos, Quaternion &rot) const
+        {
+            if (alpha >= 1.0f)
+            {
+                pos = position;
+                rot = orientation;
+                return;
+            }
+            pos = previousPosition + (position - previousPosition) * alpha;
+            rot = Quaternion::slerp(previousOrientation, orientation, alpha);
+        }
+    };
+
+    // Read-only view of one published step, valid until released.
+    struct PhysicsSnapshot
+    {
+        const PhysicsBodyState *states;
+        uint32_t count;
+        // Increments with every published step.
+        uint32_t sequence;
+
+        PhysicsSnapshot() : states(nullptr), count(0), sequence(0) {}
+
+        // solverIndex is only a hint here: the next step may be renumbering
+        // bodies, so the slot is checked and searched on a miss.
+        const PhysicsBodyState *find(const RigidBody *body) const
+        {
+            if (!body)
+                return nullptr;
+            const uint32_t hint = body->solverIndex;
+            if (hint < count && states[hint].body == body)
+                return &states[hint];
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if (states[i].body == body)
+                    return &states[i];
+            }
+            return nullptr;
+        }
+    };
+
+    // Three slots of body states: the published one, the one a reader has
+    // pinned, and one the stepping core writes. Publishing is a single
+    // atomic store, so a reader never waits on a step and never sees a
+    // half-written one. One reader at a time.
+    class PhysicsSnapshotBuffer
+    {
+    private:
+        static constexpr uint8_t SLOTS = 3;
+        static constexpr uint8_t NONE = 0xFF;
+
+        std::vector<PhysicsBodyState> slots[SLOTS];
+        uint32_t sequences[SLOTS];
+        std::atomic<uint8_t> published;
+        std::atomic<uint8_t> reading;
+        uint32_t sequence;
+
+    public:
+        PhysicsSnapshotBuffer() : published(NONE), reading(NONE), sequence(0)
+        {
+            for (uint8_t i = 0; i < SLOTS; ++i)
+                sequences[i] = 0;
+        }
+
+        PhysicsSnapshotBuffer(const PhysicsSnapshotBuffer &) = delete;
+        PhysicsSnapshotBuffer &operator=(const PhysicsSnapshotBuffer &) = delete;
+
+        // Stepping side, after a step completed. Returns true if the slot
+        // had to grow; each slot grows once per new body count high.
+        bool publish(RigidBody *const *bodies, size_t count)
+        {
+            const uint8_t pub = published.load();
+            const uint8_t pinned = reading.load();
+            uint8_t slot = 0;
+            while (slot == pub || slot == pinned)
+                ++slot;
+
+            std::vector<PhysicsBodyState> &states = slots[slot];
+            const size_t capacity = states.capacity();
+            states.resize(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                const RigidBody *b = bodies[i];
+                PhysicsBodyState &s = states[i];
+                s.body = b;
+                s.position = b->position;
+                s.previousPosition = b->previousPosition;
+                s.orientation = b->orientation;
+                s.previousOrientation = b->previousOrientation;
+                s.bounds = b->bounds;
+                s.isSleeping = b->isSleeping;
+            }
+            sequences[slot] = ++sequence;
+            published.store(slot);
+            return states.capacity() != capacity;
+        }
+
+        // Reading side. False until the first step was published.
+        bool acquire(PhysicsSnapshot &out)
+        {
+            uint8_t slot;
+            do
+            {
+                slot = published.load();
+                if (slot == NONE)
+                    return false;
+                reading.store(slot);
+            } while (published.load() != slot);
+
+            out.states = slots[slot].empty() ? nullptr : &slots[slot][0];
+            out.count = static_cast<uint32_t>(slots[slot].size());
+            out.sequence = sequences[slot];
+            return true;
+        }
+
+        void release()
+        {
+            reading.store(NONE);
+        }
+    };
+
+}
+
+#endif
@@ -4,32 +4,22 @@
 namespace pip3D
 {
 
-    inline void PhysicsWorld::preStepConstraint(CollisionInfo &info, float deltaTime)
+    inline uint32_t PhysicsWorld::preStepConstraint(CollisionInfo &info, uint32_t slot, bool warm, float deltaTime)
     {
         RigidBody *a = info.bodyA;
         RigidBody *b = info.bodyB;
         if (!a || !b)
-            return;
+            return ContactCache::NONE;
 
         if (a->isTrigger || b->isTrigger)
-            return;
+            return ContactCache::NONE;
 
         float invMassA = a->invMass;
         float invMassB = b->invMass;
         float invMassSum = invMassA + invMassB;
         Vector3 n = info.normal;
 
-        CollisionInfo *old = nullptr;
-        size_t prevCount = previousContactConstraints.size();
-        for (size_t i = 0; i < prevCount; ++i)
-        {
-            CollisionInfo &prev = previousContactConstraints[i];
-            if (prev.bodyA == a && prev.bodyB == b)
-            {
-                old = &prev;
-                break;
-            }
-        }
+        const ContactManifold *old = (warm && slot != ContactCache::NONE) ? &contactCache.at(slot) : nullptr;
 
         bool used[4] = {false, false, false, false};
 
@@ -42,26 +32,41 @@ namespace pip3D
 
             if (old)
             {
-                float bestDistSq = 0.01f * 0.01f;
                 int bestIndex = -1;
                 int oldContactCount = old->contactCount;
                 if (oldContactCount > 4)
                     oldContactCount = 4;
-                for (int oi = 0; oi < oldContactCount; ++oi)
+                if (c.feature != 0)
                 {
-                    if (used[oi])
-                        continue;
-                    Vector3 diff = old->contacts[oi].pos - c.pos;
-                    float distSq = diff.lengthSquared();
-                    if (distSq < bestDistSq)
+                    // Same feature pair, same point: no distance guess.
+                    for (int oi = 0; oi < oldContactCount; ++oi)
                     {
-                        bestDistSq = distSq;
-                        bestIndex = oi;
+                        if (!used[oi] && old->feature[oi] == c.feature)
+                        {
+                            bestIndex = oi;
+                            break;
+                        }
+                    }
+                }
+                else
+                {
+                    float bestDistSq = 0.01f * 0.01f;
+                    for (int oi = 0; oi < oldContactCount; ++oi)
+                    {
+                        if (used[oi])
+                            continue;
+                        Vector3 diff = old->pos[oi] - c.pos;
+                        float distSq = diff.lengthSquared();
+                        if (distSq < bestDistSq)
+                        {
+                            bestDistSq = distSq;
+                            bestIndex = oi;
+                        }
                     }
                 }
                 if (bestIndex >= 0)
                 {
-                    c.accumulatedImpulse = old->contacts[bestIndex].accumulatedImpulse;
+                    c.accumulatedImpulse = old->impulse[bestIndex];
                     used[bestIndex] = true;
                 }
             }
@@ -110,6 +115,8 @@ namespace pip3D
                 c.bias += -restitution * vn;
             }
         }
+
+        return slot;
     }
 
     inline void PhysicsWorld::warmStartConstraints()
@@ -325,6 +332,423 @@ namespace pip3D
         }
     }
 
+
+    __attribute__((always_inline)) static inline bool isIslandBody(const RigidBody *b)
+    {
+        return b && !b->isStatic && !b->isKinematic && b->invMass > 0.0f;
+    }
+
+    inline void PhysicsWorld::wakeTaggedIslands()
+    {
+        // A woken body still carrying its sleep tag wakes the rest of the
+        // island it fell asleep with.
+        wakeTags.clear();
+        size_t bodyCount = bodies.size();
+        for (size_t i = 0; i < bodyCount; ++i)
+        {
+            RigidBody *b = bodies[i];
+            if (b->sleepIsland == 0 || b->isSleeping)
+                continue;
+            bool known = false;
+            for (size_t t = 0; t < wakeTags.size(); ++t)
+            {
+                if (wakeTags[t] == b->sleepIsland)
+                {
+                    known = true;
+                    break;
+                }
+            }
+            if (!known)
+                wakeTags.push_back(b->sleepIsland);
+            b->sleepIsland = 0;
+        }
+
+        if (wakeTags.empty())
+            return;
+
+        for (size_t i = 0; i < bodyCount; ++i)
+        {
+            RigidBody *b = bodies[i];
+            if (b->sleepIsland == 0)
+                continue;
+            for (size_t t = 0; t < wakeTags.size(); ++t)
+            {
+                if (wakeTags[t] == b->sleepIsland)
+                {
+                    b->wakeUp();
+                    b->sleepIsland = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    inline void PhysicsWorld::buildIslands()
+    {
+        const size_t bodyCount = bodies.size();
+        const size_t contactCount = contactConstraints.size();
+        const size_t jointCount = constraints.size();
+
+        islands.clear();
+        islandParent.resize(bodyCount);
+        bodyIsland.assign(bodyCount, PHYSICS_NO_ISLAND);
+        for (size_t i = 0; i < bodyCount; ++i)
+        {
+            bodies[i]->solverIndex = static_cast<uint16_t>(i);
+            islandParent[i] = static_cast<uint16_t>(i);
+        }
+
+        auto findRoot = [this](uint16_t i)
+        {
+            while (islandParent[i] != i)
+            {
+                islandParent[i] = islandParent[islandParent[i]];
+                i = islandParent[i];
+            }
+            return i;
+        };
+
+        auto inWorld = [this, bodyCount](const RigidBody *b)
+        {
+            return b && b->solverIndex < bodyCount && bodies[b->solverIndex] == b;
+        };
+
+        auto link = [&](const RigidBody *a, const RigidBody *b)
+        {
+            if (!isIslandBody(a) || !isIslandBody(b) || !inWorld(a) || !inWorld(b))
+                return;
+            uint16_t ra = findRoot(a->solverIndex);
+            uint16_t rb = findRoot(b->solverIndex);
+            if (ra != rb)
+                islandParent[ra] = rb;
+        };
+
+        for (size_t c = 0; c < contactCount; ++c)
+        {
+            const CollisionInfo &info = contactConstraints[c];
+            if (info.bodyA->isTrigger || info.bodyB->isTrigger)
+                continue;
+            link(info.bodyA, info.bodyB);
+        }
+
+        for (size_t j = 0; j < jointCount; ++j)
+        {
+            const Constraint *c = constraints[j];
+            if (c && c->enabled)
+                link(c->a, c->b);
+        }
+
+        for (size_t i = 0; i < bodyCount; ++i)
+        {
+            if (!isIslandBody(bodies[i]))
+                continue;
+            uint16_t root = findRoot(static_cast<uint16_t>(i));
+            if (bodyIsland[root] == PHYSICS_NO_ISLAND)
+            {
+                bodyIsland[root] = static_cast<uint16_t>(islands.size());
+                islands.push_back(PhysicsIsland());
+            }
+            bodyIsland[i] = bodyIsland[root];
+        }
+
+        const size_t islandCount = islands.size();
+
+        auto ownerIsland = [&](const RigidBody *a, const RigidBody *b)
+        {
+            if (isIslandBody(a) && inWorld(a))
+                return bodyIsland[a->solverIndex];
+            if (isIslandBody(b) && inWorld(b))
+                return bodyIsland[b->solverIndex];
+            return PHYSICS_NO_ISLAND;
+        };
+
+        // Counting sort of bodies, contacts and joints into island ranges.
+        for (size_t i = 0; i < bodyCount; ++i)
+        {
+            if (bodyIsland[i] != PHYSICS_NO_ISLAND)
+                islands[bodyIsland[i]].bodyEnd++;
+        }
+        for (size_t c = 0; c < contactCount; ++c)
+        {
+            const CollisionInfo &info = contactConstraints[c];
+            if (info.bodyA->isTrigger || info.bodyB->isTrigger)
+                continue;
+            uint16_t id = ownerIsland(info.bodyA, info.bodyB);
+            if (id != PHYSICS_NO_ISLAND)
+                islands[id].contactEnd++;
+        }
+        for (size_t j = 0; j < jointCount; ++j)
+        {
+            const Constraint *c = constraints[j];
+            if (!c || !c->enabled)
+                continue;
+            uint16_t id = ownerIsland(c->a, c->b);
+            if (id != PHYSICS_NO_ISLAND)
+                islands[id].jointEnd++;
+        }
+
+        uint32_t bodyCursor = 0;
+        uint32_t contactCursor = 0;
+        uint32_t jointCursor = 0;
+        for (size_t k = 0; k < islandCount; ++k)
+        {
+            PhysicsIsland &island = islands[k];
+            island.bodyBegin = bodyCursor;
+            bodyCursor += island.bodyEnd;
+            island.bodyEnd = island.bodyBegin;
+            island.contactBegin = contactCursor;
+            contactCursor += island.contactEnd;
+            island.contactEnd = island.contactBegin;
+            island.jointBegin = jointCursor;
+            jointCursor += island.jointEnd;
+            island.jointEnd = island.jointBegin;
+        }
+
+        islandBodies.resize(bodyCursor);
+        islandContacts.resize(contactCursor);
+        islandJoints.resize(jointCursor);
+
+        for (size_t i = 0; i < bodyCount; ++i)
+        {
+            if (bodyIsland[i] != PHYSICS_NO_ISLAND)
+                islandBodies[islands[bodyIsland[i]].bodyEnd++] = static_cast<uint16_t>(i);
+        }
+        for (size_t c = 0; c < contactCount; ++c)
+        {
+            const CollisionInfo &info = contactConstraints[c];
+            if (info.bodyA->isTrigger || info.bodyB->isTrigger)
+                continue;
+            uint16_t id = ownerIsland(info.bodyA, info.bodyB);
+            if (id != PHYSICS_NO_ISLAND)
+                islandContacts[islands[id].contactEnd++] = static_cast<uint32_t>(c);
+        }
+        for (size_t j = 0; j < jointCount; ++j)
+        {
+            const Constraint *c = constraints[j];
+            if (!c || !c->enabled)
+                continue;
+            uint16_t id = ownerIsland(c->a, c->b);
+            if (id != PHYSICS_NO_ISLAND)
+                islandJoints[islands[id].jointEnd++] = static_cast<uint16_t>(j);
+        }
+
+        // An island is awake or asleep as a whole: any awake member wakes
+        // the rest, along with the islands they fell asleep with.
+        for (size_t k = 0; k < islandCount; ++k)
+        {
+            PhysicsIsland &island = islands[k];
+            bool anyAwake = false;
+            bool anySleeping = false;
+            for (uint32_t m = island.bodyBegin; m < island.bodyEnd; ++m)
+            {
+                if (bodies[islandBodies[m]]->isSleeping)
+                    anySleeping = true;
+                else
+                    anyAwake = true;
+            }
+            if (anyAwake && anySleeping)
+            {
+                for (uint32_t m = island.bodyBegin; m < island.bodyEnd; ++m)
+                    bodies[islandBodies[m]]->wakeUp();
+            }
+        }
+
+        wakeTaggedIslands();
+
+        awakeIslandCount = 0;
+        for (size_t k = 0; k < islandCount; ++k)
+        {
+            PhysicsIsland &island = islands[k];
+            island.sleeping = true;
+            for (uint32_t m = island.bodyBegin; m < island.bodyEnd; ++m)
+            {
+                if (!bodies[islandBodies[m]]->isSleeping)
+                {
+                    island.sleeping = false;
+                    break;
+                }
+            }
+            if (!island.sleeping)
+                awakeIslandCount++;
+        }
+    }
+
+    inline void PhysicsWorld::solveIslandGroup(uint8_t worker, float deltaTime)
+    {
+        if (batchesReady)
+        {
+            solveIslandGroupBatched(worker, deltaTime);
+            return;
+        }
+
+        const size_t islandCount = islands.size();
+        for (size_t k = 0; k < islandCount; ++k)
+        {
+            const PhysicsIsland &island = islands[k];
+            if (island.sleeping || island.worker != worker)
+                continue;
+
+            for (int iter = 0; iter < SOLVER_ITERATIONS; iter++)
+            {
+                for (uint32_t c = island.contactBegin; c < island.contactEnd; ++c)
+                {
+                    resolveCollision(contactConstraints[islandContacts[c]]);
+                }
+
+                for (uint32_t j = island.jointBegin; j < island.jointEnd; ++j)
+                {
+                    constraints[islandJoints[j]]->solve(deltaTime);
+                }
+            }
+        }
+    }
+
+    inline void PhysicsWorld::solveIslandGroupBatched(uint8_t worker, float deltaTime)
+    {
+        const size_t islandCount = islands.size();
+        bool hasJoints = false;
+        for (size_t k = 0; k < islandCount; ++k)
+        {
+            const PhysicsIsland &island = islands[k];
+            if (island.sleeping || island.worker != worker)
+                continue;
+            batchSolver.gather(bodies, island, islandBodies);
+            hasJoints |= island.jointEnd > island.jointBegin;
+        }
+
+        for (int iter = 0; iter < SOLVER_ITERATIONS; iter++)
+        {
+            batchSolver.solve(worker);
+            if (!hasJoints)
+                continue;
+
+            // Joints still work on the bodies themselves.
+            for (size_t k = 0; k < islandCount; ++k)
+            {
+                const PhysicsIsland &island = islands[k];
+                if (island.sleeping || island.worker != worker || island.jointEnd == island.jointBegin)
+                    continue;
+                batchSolver.scatter(bodies, island, islandBodies);
+                for (uint32_t j = island.jointBegin; j < island.jointEnd; ++j)
+                {
+                    constraints[islandJoints[j]]->solve(deltaTime);
+                }
+                batchSolver.gather(bodies, island, islandBodies);
+            }
+        }
+
+        for (size_t k = 0; k < islandCount; ++k)
+        {
+            const PhysicsIsland &island = islands[k];
+            if (!island.sleeping && island.worker == worker)
+                batchSolver.scatter(bodies, island, islandBodies);
+        }
+        batchSolver.storeImpulses(worker, contactConstraints);
+    }
+
+    inline void PhysicsWorld::solveIslands(float deltaTime)
+    {
+        PIP3D_PROFILE_ZONE("PhysicsSolve");
+        const size_t islandCount = islands.size();
+
+        // Islands share no dynamic bodies, so they can be solved on both
+        // cores at once. wait() runs queued jobs itself, so this also works
+        // when the whole step is already running on the worker.
+        bool parallel = parallelIslands && JobSystem::isEnabled() && awakeIslandCount >= 2;
+
+        uint32_t load[2] = {0, 0};
+        for (size_t k = 0; k < islandCount; ++k)
+        {
+            PhysicsIsland &island = islands[k];
+            island.worker = 0;
+            if (!parallel || island.sleeping)
+                continue;
+            uint32_t work = (island.contactEnd - island.contactBegin) + (island.jointEnd - island.jointBegin);
+            island.worker = load[1] < load[0] ? 1 : 0;
+            load[island.worker] += work;
+        }
+
+        // Batches are built per worker, so this follows the split above.
+        batchesReady = false;
+        if (batchedSolver)
+        {
+            if (batchSolver.prepare(bodies, islands, islandBodies, islandContacts, contactConstraints))
+                memoryStats.stepAllocations++;
+            batchesReady = batchSolver.isPrepared();
+        }
+
+        if (parallel && load[1] > 0)
+        {
+            islandJob.deltaTime = deltaTime;
+            if (!JobSystem::submit(&PhysicsWorld::islandSolveJobFunc, &islandJob, &islandJobCounter))
+            {
+                solveIslandGroup(1, deltaTime);
+            }
+
+            solveIslandGroup(0, deltaTime);
+            JobSystem::wait(islandJobCounter);
+            return;
+        }
+
+        solveIslandGroup(0, deltaTime);
+    }
+
+    inline void PhysicsWorld::updateIslandSleep(float deltaTime)
+    {
+        const float sleepLinThresholdSq = 1e-4f;
+        const float sleepAngThresholdSq = 1e-4f;
+        const float sleepTime = 0.5f;
+
+        const size_t islandCount = islands.size();
+        for (size_t k = 0; k < islandCount; ++k)
+        {
+            PhysicsIsland &island = islands[k];
+            if (island.sleeping)
+                continue;
+
+            bool islandCanSleep = true;
+            for (uint32_t m = island.bodyBegin; m < island.bodyEnd; ++m)
+            {
+                RigidBody *b = bodies[islandBodies[m]];
+                if (!b->canSleep)
+                {
+                    b->sleepTimer = 0.0f;
+                    islandCanSleep = false;
+                    continue;
+                }
+
+                float v2 = b->velocity.lengthSquared();
+                float w2 = b->angularVelocity.lengthSquared();
+                if (v2 < sleepLinThresholdSq && w2 < sleepAngThresholdSq)
+                    b->sleepTimer += deltaTime;
+                else
+                    b->sleepTimer = 0.0f;
+
+                if (b->sleepTimer <= sleepTime)
+                    islandCanSleep = false;
+            }
+
+            if (!islandCanSleep)
+                continue;
+
+            uint16_t tag = nextSleepIsland++;
+            if (nextSleepIsland == 0)
+                nextSleepIsland = 1;
+
+            for (uint32_t m = island.bodyBegin; m < island.bodyEnd; ++m)
+            {
+                RigidBody *b = bodies[islandBodies[m]];
+                b->isSleeping = true;
+                b->sleepIsland = tag;
+                b->velocity = Vector3(0, 0, 0);
+                b->angularVelocity = Vector3(0, 0, 0);
+                b->acceleration = Vector3(0, 0, 0);
+            }
+            island.sleeping = true;
+            awakeIslandCount--;
+        }
+    }
+
 }
 
 #endif
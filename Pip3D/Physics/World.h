@@ -3,8 +3,10 @@
 
 #include "../Math/Collision.h"
 #include "../Core/Jobs.h"
+#include "../Core/FrameArena.h"
 #include "../Core/Debug/Logging.h"
 #include "../Core/Debug/DebugDraw.h"
+#include "../Core/Instance.h"
 #include <vector>
 #include <float.h>
 
@@ -12,10 +14,32 @@
 #include "Contacts.h"
 #include "Constraints.h"
 #include "Buoyancy.h"
+#include "Broadphase.h"
+#include "Islands.h"
+#include "ContactCache.h"
+#include "BatchSolver.h"
+#include "CCD.h"
+#include "Narrowphase.h"
+#include "Queries.h"
+#include "Snapshot.h"
 
 namespace pip3D
 {
 
+    // Scratch memory usage of the physics step. stepAllocations counts heap
+    // allocations made by the last step and is zero once sizes settle.
+    struct PhysicsMemoryStats
+    {
+        uint32_t arenaCapacity;
+        uint32_t arenaUsed;
+        uint32_t arenaHighWater;
+        uint32_t stepAllocations;
+        uint32_t totalAllocations;
+
+        PhysicsMemoryStats()
+            : arenaCapacity(0), arenaUsed(0), arenaHighWater(0), stepAllocations(0), totalAllocations(0) {}
+    };
+
     class PhysicsWorld
     {
     private:
@@ -30,15 +54,77 @@ namespace pip3D
         float fixedTimeStep;
         float accumulator;
         float currentDeltaTime;
-        std::vector<CollisionInfo> contactConstraints;
-        std::vector<CollisionInfo> previousContactConstraints;
+        // Per-step scratch lives in frameArena and is rebound every step.
+        FrameArena frameArena;
+        PhysicsMemoryStats memoryStats;
+
+        ArenaArray<CollisionInfo> contactConstraints;
+        // Manifold slot of each contact constraint, ContactCache::NONE for triggers.
+        ArenaArray<uint32_t> contactSlots;
+        ContactCache contactCache;
 
-        std::vector<BuoyancyZone> waterZones;
+        BuoyancySolver buoyancy;
+
+        SweepAndPruneBroadphase defaultBroadphase;
+        Broadphase *customBroadphase;
+        std::vector<BroadphasePair> broadphasePairs;
+        BroadphaseStats broadphaseStats;
+
+        // Instances whose transform follows a body's interpolated pose.
+        struct InstanceBinding
+        {
+            RigidBody *body;
+            MeshInstance *instance;
+        };
+        std::vector<InstanceBinding> instanceBindings;
+
+        // Transforms published at the end of every step for readers on
+        // other cores.
+        mutable PhysicsSnapshotBuffer snapshotBuffer;
+
+        // Query index state: rebuilt on the first query after a step or a
+        // change to the body list. queryBounds encloses every body.
+        std::vector<uint16_t> queryCandidates;
+        AABB queryBounds;
+        bool queriesDirty;
+
+        ArenaArray<PhysicsIsland> islands;
+        ArenaArray<uint16_t> islandParent;
+        ArenaArray<uint16_t> bodyIsland;
+        ArenaArray<uint16_t> islandBodies;
+        ArenaArray<uint32_t> islandContacts;
+        ArenaArray<uint16_t> islandJoints;
+        std::vector<uint16_t> wakeTags;
+        uint16_t nextSleepIsland;
+        uint32_t awakeIslandCount;
+        bool parallelIslands;
+        BatchSolver batchSolver;
+        bool batchedSolver;
+        bool batchesReady;
+
+        struct IslandSolveJob
+        {
+            PhysicsWorld *world;
+            float deltaTime;
+        };
+        IslandSolveJob islandJob;
+        JobCounter islandJobCounter;
+
+        __attribute__((always_inline)) inline Broadphase *activeBroadphase()
+        {
+            return customBroadphase ? customBroadphase : &defaultBroadphase;
+        }
 
     public:
         PhysicsWorld()
             : gravity(0, -9.81f, 0), asyncEnabled(true), stepInProgress(false),
-              pendingDelta(0.0f), fixedTimeStep(1.0f / 120.0f), accumulator(0.0f), currentDeltaTime(0.0f) {}
+              pendingDelta(0.0f), fixedTimeStep(1.0f / 120.0f), accumulator(0.0f), currentDeltaTime(0.0f),
+              customBroadphase(nullptr), queriesDirty(true), nextSleepIsland(1), awakeIslandCount(0), parallelIslands(true),
+              batchedSolver(PIP3D_PHYSICS_BATCHED_SOLVER != 0), batchesReady(false)
+        {
+            islandJob.world = this;
+            islandJob.deltaTime = 0.0f;
+        }
 
         bool addBody(RigidBody *body)
         {
@@ -49,6 +135,7 @@ namespace pip3D
                 return false;
             }
             bodies.push_back(body);
+            queriesDirty = true;
 
             LOGI(::pip3D::Debug::LOG_MODULE_PHYSICS,
                  "PhysicsWorld::addBody: bodyCount=%u",
@@ -83,7 +170,12 @@ namespace pip3D
 
         void addBuoyancyZone(const BuoyancyZone &zone)
         {
-            waterZones.push_back(zone);
+            buoyancy.addZone(zone);
+        }
+
+        void clearBuoyancyZones()
+        {
+            buoyancy.clearZones();
         }
 
         void removeBody(RigidBody *body)
@@ -97,6 +189,19 @@ namespace pip3D
                     break;
                 }
             }
+            contactCache.removeBody(body);
+            queriesDirty = true;
+
+            for (size_t i = 0; i < instanceBindings.size();)
+            {
+                if (instanceBindings[i].body == body)
+                {
+                    instanceBindings[i] = instanceBindings.back();
+                    instanceBindings.pop_back();
+                    continue;
+                }
+                ++i;
+            }
         }
 
         void setGravity(const Vector3 &g)
@@ -129,6 +234,295 @@ namespace pip3D
             return fixedTimeStep;
         }
 
+        // Replaces the built-in sweep-and-prune; nullptr restores it.
+        // The world does not take ownership.
+        void setBroadphase(Broadphase *bp)
+        {
+            customBroadphase = bp;
+            activeBroadphase()->reset();
+            queriesDirty = true;
+        }
+
+        Broadphase *getBroadphase()
+        {
+            return activeBroadphase();
+        }
+
+        const BroadphaseStats &getBroadphaseStats() const
+        {
+            return broadphaseStats;
+        }
+
+        const std::vector<RigidBody *> &getBodies() const
+        {
+            return bodies;
+        }
+
+        // Scene queries through the broadphase. They read the bounds left by
+        // the last step, so call them while no async step is in progress;
+        // after moving bodies by hand, call invalidateQueries() first.
+        // Bodies are matched when their layers share a bit with layerMask.
+        void invalidateQueries()
+        {
+            queriesDirty = true;
+        }
+
+        bool raycast(const Ray &ray, RaycastHit &outHit, float maxDistance = FLT_MAX,
+                     uint16_t layerMask = PHYSICS_LAYER_ALL)
+        {
+            prepareQueries();
+            return raycastPrepared(ray, outHit, maxDistance, layerMask);
+        }
+
+        // Casts count rays against one index build; returns how many hit.
+        int raycastBatch(const Ray *rays, int count, RaycastHit *outHits, float maxDistance = FLT_MAX,
+                         uint16_t layerMask = PHYSICS_LAYER_ALL)
+        {
+            if (!rays || !outHits || count <= 0)
+                return 0;
+            prepareQueries();
+            int hits = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                if (raycastPrepared(rays[i], outHits[i], maxDistance, layerMask))
+                    ++hits;
+            }
+            return hits;
+        }
+
+        // Sphere moving from start by delta; triggers and ignore are skipped.
+        bool sweepSphere(const Vector3 &start, const Vector3 &delta, float radius, SweepHit &outHit,
+                         uint16_t layerMask = PHYSICS_LAYER_ALL, const RigidBody *ignore = nullptr)
+        {
+            return sweepCapsule(start, start, radius, delta, outHit, layerMask, ignore);
+        }
+
+        // Capsule between segment ends a and b, moving by delta. It is swept
+        // as spheres spaced at most one radius apart along the segment.
+        bool sweepCapsule(const Vector3 &a, const Vector3 &b, float radius, const Vector3 &delta, SweepHit &outHit,
+                          uint16_t layerMask = PHYSICS_LAYER_ALL, const RigidBody *ignore = nullptr)
+        {
+            outHit = SweepHit();
+            if (radius <= 0.0f || delta.lengthSquared() <= 1e-12f)
+                return false;
+
+            const Vector3 axisDelta = b - a;
+            const float axisLen = axisDelta.length();
+            int spheres = 1;
+            if (axisLen > 1e-6f)
+                spheres = static_cast<int>(ceilf(axisLen / radius)) + 1;
+            const float invSteps = spheres > 1 ? 1.0f / static_cast<float>(spheres - 1) : 0.0f;
+
+            AABB box = PhysicsQuery::sweptSphereBounds(a, delta, radius);
+            box.merge(PhysicsQuery::sweptSphereBounds(b, delta, radius));
+
+            prepareQueries();
+            queryCandidates.clear();
+            activeBroadphase()->queryAABB(bodies, box, queryCandidates);
+
+            const size_t candidateCount = queryCandidates.size();
+            for (size_t c = 0; c < candidateCount; ++c)
+            {
+                RigidBody *body = bodies[queryCandidates[c]];
+                if (body == ignore || body->isTrigger || !(body->layers & layerMask))
+                    continue;
+
+                for (int s = 0; s < spheres; ++s)
+                {
+                    const Vector3 start = a + axisDelta * (static_cast<float>(s) * invSteps);
+                    float fraction;
+                    Vector3 point, normal;
+                    if (!PhysicsQuery::sweepSphereBody(start, delta, radius, *body, fraction, point, normal))
+                        continue;
+                    if (fraction < outHit.fraction || !outHit.hit)
+                    {
+                        outHit.hit = true;
+                        outHit.fraction = fraction;
+                        outHit.point = point;
+                        outHit.normal = normal;
+                        outHit.body = body;
+                    }
+                }
+            }
+            return outHit.hit;
+        }
+
+        // Appends bodies whose bounds overlap box; returns how many.
+        int overlapAABB(const AABB &box, std::vector<RigidBody *> &out, uint16_t layerMask = PHYSICS_LAYER_ALL)
+        {
+            prepareQueries();
+            queryCandidates.clear();
+            activeBroadphase()->queryAABB(bodies, box, queryCandidates);
+
+            int found = 0;
+            const size_t candidateCount = queryCandidates.size();
+            for (size_t c = 0; c < candidateCount; ++c)
+            {
+                RigidBody *body = bodies[queryCandidates[c]];
+                if (!(body->layers & layerMask))
+                    continue;
+                out.push_back(body);
+                ++found;
+            }
+            return found;
+        }
+
+        // Splits awake islands between the calling core and the job worker.
+        void setParallelIslands(bool enabled)
+        {
+            parallelIslands = enabled;
+        }
+
+        bool isParallelIslands() const
+        {
+            return parallelIslands;
+        }
+
+        // Solves contacts in batches of four over structure-of-arrays body
+        // state instead of through the body pointers.
+        void setBatchedSolver(bool enabled)
+        {
+            batchedSolver = enabled;
+        }
+
+        bool isBatchedSolver() const
+        {
+            return batchedSolver;
+        }
+
+        // Backs the step scratch with caller memory (ideally internal RAM).
+        // The world switches to its own arena if this turns out too small.
+        void setFrameArena(void *memory, size_t bytes)
+        {
+            unbindStepScratch();
+            frameArena.attach(memory, bytes);
+        }
+
+        // Preallocates an internal-RAM arena; size it from getMemoryStats().
+        bool reserveFrameArena(size_t bytes)
+        {
+            unbindStepScratch();
+            return frameArena.init(bytes, MEM_INTERNAL, ::pip3D::Debug::LOG_MODULE_PHYSICS);
+        }
+
+        const PhysicsMemoryStats &getMemoryStats() const
+        {
+            return memoryStats;
+        }
+
+        uint32_t getIslandCount() const
+        {
+            return static_cast<uint32_t>(islands.size());
+        }
+
+        uint32_t getAwakeIslandCount() const
+        {
+            return awakeIslandCount;
+        }
+
+        // How far the accumulator is into the next fixed step. Rendering
+        // bodies at previous + (current - previous) * alpha hides the step
+        // rate, so physics can run well below the frame rate.
+        float getInterpolationAlpha() const
+        {
+            if (fixedTimeStep <= 0.0f)
+                return 1.0f;
+            const float alpha = accumulator / fixedTimeStep;
+            return alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+        }
+
+        // Last completed step's pose; a body not published yet is read
+        // directly.
+        void getInterpolatedPose(const RigidBody *body, Vector3 &pos, Quaternion &rot) const
+        {
+            const float alpha = getInterpolationAlpha();
+            PhysicsSnapshot snapshot;
+            if (snapshotBuffer.acquire(snapshot))
+            {
+                const PhysicsBodyState *state = snapshot.find(body);
+                if (state)
+                    state->interpolatedPose(alpha, pos, rot);
+                snapshotBuffer.release();
+                if (state)
+                    return;
+            }
+            body->interpolatedPose(alpha, pos, rot);
+        }
+
+        // Pins the state published by the last completed step: transforms
+        // and bounds that stay consistent while the next step runs on the
+        // other core. Release before acquiring again; one reader at a time.
+        // False until the first step completed.
+        bool acquireSnapshot(PhysicsSnapshot &out) const
+        {
+            return snapshotBuffer.acquire(out);
+        }
+
+        void releaseSnapshot() const
+        {
+            snapshotBuffer.release();
+        }
+
+        // The instance follows the body's interpolated pose on every
+        // syncInstances(); scale is left alone. One body may drive several
+        // instances.
+        void bindInstance(RigidBody *body, MeshInstance *instance)
+        {
+            if (!body || !instance)
+                return;
+            unbindInstance(instance);
+            InstanceBinding binding;
+            binding.body = body;
+            binding.instance = instance;
+            instanceBindings.push_back(binding);
+        }
+
+        void unbindInstance(MeshInstance *instance)
+        {
+            for (size_t i = 0; i < instanceBindings.size(); ++i)
+            {
+                if (instanceBindings[i].instance == instance)
+                {
+                    instanceBindings[i] = instanceBindings.back();
+                    instanceBindings.pop_back();
+                    return;
+                }
+            }
+        }
+
+        // Call once per rendered frame after updateFixed(). Instances whose
+        // pose did not change (e.g. sleeping bodies) are left untouched so
+        // their cached transforms stay valid.
+        void syncInstances()
+        {
+            const float alpha = getInterpolationAlpha();
+            PhysicsSnapshot snapshot;
+            const bool haveSnapshot = snapshotBuffer.acquire(snapshot);
+            for (size_t i = 0; i < instanceBindings.size(); ++i)
+            {
+                const InstanceBinding &binding = instanceBindings[i];
+                Vector3 pos;
+                Quaternion rot;
+                const PhysicsBodyState *state = haveSnapshot ? snapshot.find(binding.body) : nullptr;
+                if (state)
+                    state->interpolatedPose(alpha, pos, rot);
+                else if (!stepInProgress)
+                    binding.body->interpolatedPose(alpha, pos, rot);
+                else
+                    continue;
+
+                MeshInstance *inst = binding.instance;
+                const Vector3 &curPos = inst->pos();
+                const Quaternion &curRot = inst->rot();
+                if (curPos.x != pos.x || curPos.y != pos.y || curPos.z != pos.z)
+                    inst->setPosition(pos);
+                if (curRot.x != rot.x || curRot.y != rot.y || curRot.z != rot.z || curRot.w != rot.w)
+                    inst->setRotation(rot);
+            }
+            if (haveSnapshot)
+                snapshotBuffer.release();
+        }
+
         void updateFixed(float frameDelta)
         {
             float dt = fixedTimeStep;
@@ -176,12 +570,12 @@ namespace pip3D
 
             pendingDelta = deltaTime;
 
-            if (JobSystem::submit(&PhysicsWorld::stepJobFunc, this))
-            {
-                stepInProgress = true;
-            }
-            else
+            // Raised before submitting: the worker may finish the step and
+            // clear it before submit() even returns.
+            stepInProgress = true;
+            if (!JobSystem::submit(&PhysicsWorld::stepJobFunc, this))
             {
+                stepInProgress = false;
                 LOGW(::pip3D::Debug::LOG_MODULE_PHYSICS,
                      "PhysicsWorld::stepAsync: JobSystem::submit failed, physics step skipped");
             }
@@ -292,6 +686,66 @@ namespace pip3D
         }
 
     private:
+        void prepareQueries()
+        {
+            if (!queriesDirty)
+                return;
+
+            activeBroadphase()->prepareQueries(bodies);
+            const size_t count = bodies.size();
+            if (count > 0)
+            {
+                queryBounds = bodies[0]->bounds;
+                for (size_t i = 1; i < count; ++i)
+                    queryBounds.merge(bodies[i]->bounds);
+            }
+            queriesDirty = false;
+        }
+
+        bool raycastPrepared(const Ray &ray, RaycastHit &outHit, float maxDistance, uint16_t layerMask)
+        {
+            outHit.hit = false;
+            outHit.body = nullptr;
+            outHit.distance = maxDistance;
+
+            // Only the part of the ray inside the world can hit anything.
+            float tEnter, tExit;
+            if (bodies.empty() || !ray.intersects(queryBounds, tEnter, tExit) || tExit < 0.0f)
+                return false;
+            const float tEnd = fminf(maxDistance, tExit);
+            const Vector3 p0 = ray.at(fmaxf(tEnter, 0.0f));
+            const Vector3 p1 = ray.at(tEnd);
+            const AABB segment(Vector3(fminf(p0.x, p1.x), fminf(p0.y, p1.y), fminf(p0.z, p1.z)),
+                               Vector3(fmaxf(p0.x, p1.x), fmaxf(p0.y, p1.y), fmaxf(p0.z, p1.z)));
+
+            queryCandidates.clear();
+            activeBroadphase()->queryAABB(bodies, segment, queryCandidates);
+
+            const size_t candidateCount = queryCandidates.size();
+            for (size_t c = 0; c < candidateCount; ++c)
+            {
+                RigidBody *b = bodies[queryCandidates[c]];
+                if (!(b->layers & layerMask))
+                    continue;
+
+                float t;
+                Vector3 normal;
+                if (!PhysicsQuery::raycastBody(ray, *b, maxDistance, t, normal))
+                    continue;
+
+                if (t < outHit.distance)
+                {
+                    outHit.hit = true;
+                    outHit.body = b;
+                    outHit.distance = t;
+                    outHit.point = ray.at(t);
+                    outHit.normal = normal;
+                }
+            }
+
+            return outHit.hit;
+        }
+
         static void stepJobFunc(void *userData)
         {
             PhysicsWorld *self = static_cast<PhysicsWorld *>(userData);
@@ -327,99 +781,36 @@ namespace pip3D
 
         void stepInternal(float deltaTime)
         {
+            PIP3D_PROFILE_ZONE("PhysicsStep");
             currentDeltaTime = deltaTime;
+            queriesDirty = true;
+            memoryStats.stepAllocations = 0;
+            const size_t pairCapacity = broadphasePairs.capacity();
+            const size_t wakeCapacity = wakeTags.capacity();
 
             size_t bodyCount = bodies.size();
 
+            wakeTaggedIslands();
+
             const float gravityMag = gravity.length();
 
             for (size_t i = 0; i < bodyCount; i++)
             {
                 RigidBody *b = bodies[i];
                 b->previousPosition = b->position;
-                if (!b->isStatic && !b->isSleeping && b->mass > 0.0f)
+                b->previousOrientation = b->orientation;
+                if (!b->isStatic && !b->isKinematic && !b->isSleeping && b->mass > 0.0f)
                 {
-                    b->applyForce(gravity * b->mass);
+                    // Not applyForce(): that resets the sleep timer every step.
+                    b->acceleration += gravity;
                 }
             }
 
-            if (!waterZones.empty())
+            if (!buoyancy.empty())
             {
-                const float effectiveGravity = (gravityMag > 0.0f) ? gravityMag : 9.81f;
-
-                for (size_t i = 0; i < bodyCount; ++i)
-                {
-                    RigidBody *b = bodies[i];
-                    if (!b || b->isStatic || b->isKinematic || b->isSleeping || b->mass <= 0.0f)
-                        continue;
-
-                    // Only box bodies use corner-based buoyancy
-                    if (b->shape != BODY_SHAPE_BOX)
-                        continue;
-
-                    Vector3 half = b->size * 0.5f;
-
-                    // Four local bottom corners in body space
-                    Vector3 localCorners[4] = {
-                        Vector3(-half.x, -half.y, -half.z),
-                        Vector3( half.x, -half.y, -half.z),
-                        Vector3( half.x, -half.y,  half.z),
-                        Vector3(-half.x, -half.y,  half.z)};
-
-                    for (size_t zi = 0; zi < waterZones.size(); ++zi)
-                    {
-                        const BuoyancyZone &zone = waterZones[zi];
-
-                        for (int c = 0; c < 4; ++c)
-                        {
-                            // World-space corner position
-                            Vector3 worldCorner = b->orientation.rotate(localCorners[c]) + b->position;
-
-                            // Must be inside zone volume horizontally (AABB) and below surface
-                            if (!zone.contains(worldCorner))
-                                continue;
-
-                            float depth = zone.surfaceLevel - worldCorner.y;
-                            if (depth <= 0.0f)
-                                continue;
-
-                            // Clamp depth relative to body height for smoother response
-                            float hRef = b->size.y;
-                            if (hRef <= 0.0f)
-                                hRef = 1.0f;
-                            float depthFactor = depth / hRef;
-                            if (depthFactor > 1.0f)
-                                depthFactor = 1.0f;
-
-                            // Per-corner buoyant force (sum of 4 corners approximates total)
-                            float cornerForceMag = (b->mass * zone.density * effectiveGravity * 0.25f) * depthFactor;
-                            Vector3 forceVec(0.0f, cornerForceMag, 0.0f);
-
-                            // Linear part
-                            b->applyForce(forceVec);
-
-                            // Approximate torque from force at corner: tau = r x F
-                            Vector3 r = worldCorner - b->position;
-                            Vector3 tau = r.cross(forceVec);
-                            Vector3 angAcc(
-                                tau.x * b->invInertia.x,
-                                tau.y * b->invInertia.y,
-                                tau.z * b->invInertia.z);
-                            b->angularVelocity += angAcc * deltaTime;
-                        }
-
-                        // Additional damping while inside water zone
-                        float linFactor = 1.0f - zone.dragLinear * deltaTime;
-                        float angFactor = 1.0f - zone.dragAngular * deltaTime;
-                        if (linFactor < 0.0f)
-                            linFactor = 0.0f;
-                        if (angFactor < 0.0f)
-                            angFactor = 0.0f;
-
-                        b->velocity *= linFactor;
-                        b->angularVelocity *= angFactor;
-                    }
-                }
+                PIP3D_PROFILE_ZONE("PhysicsBuoyancy");
+                if (buoyancy.apply(bodies, gravityMag > 0.0f ? gravityMag : 9.81f, deltaTime))
+                    memoryStats.stepAllocations++;
             }
 
             for (size_t i = 0; i < bodyCount; i++)
@@ -427,65 +818,88 @@ namespace pip3D
                 bodies[i]->update(deltaTime);
             }
 
-            contactConstraints.clear();
+            solveContinuous();
 
-            for (size_t i = 0; i < bodyCount; i++)
             {
-                RigidBody *a = bodies[i];
-                for (size_t j = i + 1; j < bodyCount; j++)
-                {
-                    RigidBody *b = bodies[j];
+                PIP3D_PROFILE_ZONE("PhysicsBroadphase");
+                activeBroadphase()->findPairs(bodies, broadphasePairs, broadphaseStats);
+            }
 
-                    bool aImmobile = (a->isStatic || a->isSleeping || a->isKinematic);
-                    bool bImmobile = (b->isStatic || b->isSleeping || b->isKinematic);
-                    if (aImmobile && bImmobile)
-                        continue;
+            size_t pairCount = broadphasePairs.size();
+            if (broadphasePairs.capacity() != pairCapacity)
+                memoryStats.stepAllocations++;
+
+            if (!bindStepScratch(pairCount))
+            {
+                finishMemoryStats();
+                return;
+            }
 
-                    CollisionInfo info = detectCollision(a, b);
-                    if (info.hasCollision && info.contactCount > 0)
+            contactCache.beginStep();
+            if (contactCache.reserve(pairCount))
+                memoryStats.stepAllocations++;
+            for (size_t p = 0; p < pairCount; p++)
+            {
+                RigidBody *a = bodies[broadphasePairs[p].a];
+                RigidBody *b = bodies[broadphasePairs[p].b];
+
+                // Acquired before the narrowphase, which reads and updates
+                // the pair's cached separating axis.
+                bool warm = false;
+                const uint32_t slot = contactCache.acquire(a, b, warm);
+                ContactManifold *cached = slot != ContactCache::NONE ? &contactCache.at(slot) : nullptr;
+
+                // Narrowphase writes straight into the next arena slot.
+                CollisionInfo &info = contactConstraints.data()[contactConstraints.size()];
+                info = detectCollision(a, b, cached);
+                if (info.hasCollision && info.contactCount > 0)
+                {
+                    if (a->isSleeping || b->isSleeping)
                     {
-                        if (a->isSleeping || b->isSleeping)
+                        Vector3 vRel = b->velocity - a->velocity;
+                        float vRelSq = vRel.lengthSquared();
+                        const float wakeThresholdSq = 1e-4f;
+                        if (vRelSq > wakeThresholdSq)
                         {
-                            Vector3 vRel = b->velocity - a->velocity;
-                            float vRelSq = vRel.lengthSquared();
-                            const float wakeThresholdSq = 1e-4f;
-                            if (vRelSq > wakeThresholdSq)
-                            {
-                                if (a->isSleeping)
-                                    a->wakeUp();
-                                if (b->isSleeping)
-                                    b->wakeUp();
-                            }
+                            if (a->isSleeping)
+                                a->wakeUp();
+                            if (b->isSleeping)
+                                b->wakeUp();
                         }
-
-                        preStepConstraint(info, deltaTime);
-                        contactConstraints.push_back(info);
                     }
+
+                    contactSlots.push_back(preStepConstraint(info, slot, warm, deltaTime));
+                    contactConstraints.resize(contactConstraints.size() + 1);
+                }
+                else if (cached)
+                {
+                    cached->contactCount = 0;
                 }
             }
+            broadphaseStats.contactPairs = static_cast<uint32_t>(contactConstraints.size());
+
+            buildIslands();
 
             preStepJoints(deltaTime);
 
             warmStartConstraints();
 
-            for (int iter = 0; iter < SOLVER_ITERATIONS; iter++)
-            {
-                size_t contactCount = contactConstraints.size();
-                for (size_t c = 0; c < contactCount; c++)
-                {
-                    resolveCollision(contactConstraints[c]);
-                }
-
-                solveJoints(deltaTime);
-            }
+            solveIslands(deltaTime);
 
             positionalCorrection();
 
-            previousContactConstraints = contactConstraints;
+            const size_t contactCount = contactConstraints.size();
+            for (size_t i = 0; i < contactCount; i++)
+            {
+                if (contactSlots[i] != ContactCache::NONE)
+                    contactCache.store(contactSlots[i], contactConstraints[i]);
+            }
+            contactCache.endStep();
 
-            const float sleepLinThresholdSq = 1e-4f;
-            const float sleepAngThresholdSq = 1e-4f;
-            const float sleepTime = 0.5f;
+            updateIslandSleep(deltaTime);
+
+            if (wakeTags.capacity() != wakeCapacity)
+                memoryStats.stepAllocations++;
 
             for (size_t i = 0; i < bodyCount; i++)
             {
@@ -500,22 +914,6 @@ namespace pip3D
                     continue;
                 if (!b->canSleep)
                     continue;
-                if (v2 < sleepLinThresholdSq && w2 < sleepAngThresholdSq)
-                {
-                    b->sleepTimer += deltaTime;
-                    if (b->sleepTimer > sleepTime)
-                    {
-                        b->isSleeping = true;
-                        b->velocity = Vector3(0, 0, 0);
-                        b->angularVelocity = Vector3(0, 0, 0);
-                        b->acceleration = Vector3(0, 0, 0);
-                    }
-                }
-                else
-                {
-                    b->sleepTimer = 0.0f;
-                    b->isSleeping = false;
-                }
 
                 float halfY = b->size.y * 0.5f;
                 float targetY = halfY;
@@ -532,148 +930,161 @@ namespace pip3D
                     }
                 }
             }
+
+            if (snapshotBuffer.publish(bodies.data(), bodyCount))
+                memoryStats.stepAllocations++;
+            finishMemoryStats();
         }
 
-        void preStepConstraint(CollisionInfo &info, float deltaTime);
+        // Returns the contact cache slot holding the pair's manifold, or
+        // NONE for trigger pairs. warm: slot holds last step's impulses.
+        uint32_t preStepConstraint(CollisionInfo &info, uint32_t slot, bool warm, float deltaTime);
 
-        void warmStartConstraints();
+        // Resets the arena and carves this step's scratch arrays from it,
+        // growing an internal arena if the current one is too small.
+        bool bindStepScratch(size_t pairCount)
+        {
+            const size_t bodyCount = bodies.size();
+            const size_t jointCount = constraints.size();
 
-        void positionalCorrection();
+            const size_t needed = FrameArena::arraySize<CollisionInfo>(pairCount) +
+                                  FrameArena::arraySize<uint32_t>(pairCount) * 2 +
+                                  FrameArena::arraySize<PhysicsIsland>(bodyCount) +
+                                  FrameArena::arraySize<uint16_t>(bodyCount) * 3 +
+                                  FrameArena::arraySize<uint16_t>(jointCount);
 
-        void preStepJoints(float deltaTime)
-        {
-            size_t count = constraints.size();
-            for (size_t i = 0; i < count; ++i)
+            if (needed > frameArena.getCapacity())
             {
-                Constraint *c = constraints[i];
-                if (c)
+                if (!frameArena.isOwned() && frameArena.getCapacity() > 0)
                 {
-                    c->preStep(deltaTime);
+                    LOGW(::pip3D::Debug::LOG_MODULE_PHYSICS,
+                         "PhysicsWorld: frame arena too small (%u < %u bytes), using internal arena",
+                         static_cast<unsigned int>(frameArena.getCapacity()),
+                         static_cast<unsigned int>(needed));
                 }
+                memoryStats.stepAllocations++;
+                unbindStepScratch();
+                if (!frameArena.init(needed + needed / 4, MEM_INTERNAL, ::pip3D::Debug::LOG_MODULE_PHYSICS))
+                    return false;
             }
+
+            frameArena.reset();
+            contactConstraints.bind(frameArena, pairCount);
+            contactSlots.bind(frameArena, pairCount);
+            islandContacts.bind(frameArena, pairCount);
+            islands.bind(frameArena, bodyCount);
+            islandParent.bind(frameArena, bodyCount);
+            bodyIsland.bind(frameArena, bodyCount);
+            islandBodies.bind(frameArena, bodyCount);
+            islandJoints.bind(frameArena, jointCount);
+            return true;
         }
 
-        void solveJoints(float deltaTime)
+        // Pulls fast continuous-collision bodies back to their first time of
+        // impact this step, leaving a small overlap for the narrowphase.
+        void solveContinuous()
         {
-            size_t count = constraints.size();
-            for (size_t i = 0; i < count; ++i)
+            const float skin = 0.01f;
+            const size_t bodyCount = bodies.size();
+            for (size_t i = 0; i < bodyCount; ++i)
             {
-                Constraint *c = constraints[i];
-                if (c)
+                RigidBody *b = bodies[i];
+                if (!b->continuousCollision || b->isStatic || b->isKinematic || b->isSleeping || b->isTrigger)
+                    continue;
+
+                const float radius = b->sweepRadius();
+                const Vector3 start = b->previousPosition;
+                const Vector3 delta = b->position - start;
+                const float distSq = delta.lengthSquared();
+                // Moving less than the radius cannot skip past anything.
+                if (distSq <= radius * radius)
+                    continue;
+
+                AABB swept = b->bounds;
+                swept.merge(AABB(b->bounds.min - delta, b->bounds.max - delta));
+
+                float firstToi = 2.0f;
+                for (size_t j = 0; j < bodyCount; ++j)
                 {
-                    c->solve(deltaTime);
+                    const RigidBody *other = bodies[j];
+                    if (other == b || other->isTrigger || !swept.intersects(other->bounds))
+                        continue;
+                    float toi;
+                    if (ContinuousCollision::timeOfImpact(start, delta, radius, *other, toi) && toi < firstToi)
+                        firstToi = toi;
                 }
+
+                if (firstToi > 1.0f)
+                    continue;
+
+                float t = firstToi + skin / sqrtf(distSq);
+                if (t > 1.0f)
+                    t = 1.0f;
+                b->position = start + delta * t;
+                b->updateBoundsFromTransform();
             }
         }
 
-        bool raycast(const Ray &ray, RaycastHit &outHit, float maxDistance = FLT_MAX)
+        void unbindStepScratch()
         {
-            outHit.hit = false;
-            outHit.body = nullptr;
-            outHit.distance = maxDistance;
+            contactConstraints.bind(nullptr, 0);
+            contactSlots.bind(nullptr, 0);
+            islandContacts.bind(nullptr, 0);
+            islands.bind(nullptr, 0);
+            islandParent.bind(nullptr, 0);
+            bodyIsland.bind(nullptr, 0);
+            islandBodies.bind(nullptr, 0);
+            islandJoints.bind(nullptr, 0);
+        }
 
-            size_t bodyCount = bodies.size();
-            for (size_t i = 0; i < bodyCount; ++i)
-            {
-                RigidBody *b = bodies[i];
-                if (!b)
-                    continue;
+        void finishMemoryStats()
+        {
+            memoryStats.totalAllocations += memoryStats.stepAllocations;
+            memoryStats.arenaCapacity = static_cast<uint32_t>(frameArena.getCapacity());
+            memoryStats.arenaUsed = static_cast<uint32_t>(frameArena.getUsed());
+            memoryStats.arenaHighWater = static_cast<uint32_t>(frameArena.getHighWater());
+        }
 
-                float tMinAABB, tMaxAABB;
-                if (!ray.intersects(b->bounds, tMinAABB, tMaxAABB))
-                    continue;
+        void wakeTaggedIslands();
 
-                if (tMaxAABB < 0.0f)
-                    continue;
+        void buildIslands();
 
-                float bestT = FLT_MAX;
-                Vector3 hitNormal(0.0f, 1.0f, 0.0f);
-                bool hitFound = false;
+        void solveIslands(float deltaTime);
 
-                if (b->shape == BODY_SHAPE_SPHERE)
-                {
-                    CollisionSphere s(b->position, b->radius);
-                    float tSphere;
-                    if (ray.intersects(s, tSphere) && tSphere >= 0.0f && tSphere <= maxDistance)
-                    {
-                        bestT = tSphere;
-                        Vector3 hitPoint = ray.at(tSphere);
-                        Vector3 n = hitPoint - b->position;
-                        float nLenSq = n.lengthSquared();
-                        if (nLenSq > 1e-8f)
-                        {
-                            float invLen = FastMath::fastInvSqrt(nLenSq);
-                            n *= invLen;
-                        }
-                        else
-                        {
-                            n = Vector3(0.0f, 1.0f, 0.0f);
-                        }
-                        hitNormal = n;
-                        hitFound = true;
-                    }
-                }
-                else
-                {
-                    Vector3 half = b->size * 0.5f;
+        void solveIslandGroup(uint8_t worker, float deltaTime);
 
-                    Quaternion invRot = b->orientation.conjugate();
-                    Vector3 localOrigin = invRot.rotate(ray.origin - b->position);
-                    Vector3 localDir = invRot.rotate(ray.direction);
+        void solveIslandGroupBatched(uint8_t worker, float deltaTime);
 
-                    Ray localRay(localOrigin, localDir);
-                    AABB localBox(Vector3(-half.x, -half.y, -half.z), Vector3(half.x, half.y, half.z));
+        void updateIslandSleep(float deltaTime);
 
-                    float tMin, tMax;
-                    if (localRay.intersects(localBox, tMin, tMax))
-                    {
-                        float tHit = tMin >= 0.0f ? tMin : tMax;
-                        if (tHit >= 0.0f && tHit <= maxDistance)
-                        {
-                            bestT = tHit;
-
-                            Vector3 localHit = localRay.at(tHit);
-                            float dx = half.x - fabsf(localHit.x);
-                            float dy = half.y - fabsf(localHit.y);
-                            float dz = half.z - fabsf(localHit.z);
-
-                            Vector3 localN(0.0f, 1.0f, 0.0f);
-                            if (dx <= dy && dx <= dz)
-                            {
-                                localN = Vector3((localHit.x > 0.0f) ? 1.0f : -1.0f, 0.0f, 0.0f);
-                            }
-                            else if (dy <= dz)
-                            {
-                                localN = Vector3(0.0f, (localHit.y > 0.0f) ? 1.0f : -1.0f, 0.0f);
-                            }
-                            else
-                            {
-                                localN = Vector3(0.0f, 0.0f, (localHit.z > 0.0f) ? 1.0f : -1.0f);
-                            }
-
-                            hitNormal = b->orientation.rotate(localN);
-                            hitFound = true;
-                        }
-                    }
-                }
+        static void islandSolveJobFunc(void *userData)
+        {
+            IslandSolveJob *job = static_cast<IslandSolveJob *>(userData);
+            job->world->solveIslandGroup(1, job->deltaTime);
+        }
 
-                if (!hitFound)
-                    continue;
+        void warmStartConstraints();
 
-                if (bestT < outHit.distance)
+        void positionalCorrection();
+
+        void preStepJoints(float deltaTime)
+        {
+            size_t count = islands.size();
+            for (size_t i = 0; i < count; ++i)
+            {
+                const PhysicsIsland &island = islands[i];
+                if (island.sleeping)
+                    continue;
+                for (uint32_t j = island.jointBegin; j < island.jointEnd; ++j)
                 {
-                    outHit.hit = true;
-                    outHit.body = b;
-                    outHit.distance = bestT;
-                    outHit.point = ray.at(bestT);
-                    outHit.normal = hitNormal;
+                    constraints[islandJoints[j]]->preStep(deltaTime);
                 }
             }
-
-            return outHit.hit;
         }
 
-        CollisionInfo detectCollision(RigidBody *a, RigidBody *b)
+        // cache is the pair's manifold; it carries the box-box separating
+        // axis from one step to the next.
+        CollisionInfo detectCollision(RigidBody *a, RigidBody *b, ContactManifold *cache)
         {
             CollisionInfo info;
 
@@ -694,443 +1105,10 @@ namespace pip3D
                 return info;
             }
 
-            if (a->shape == BODY_SHAPE_SPHERE && b->shape == BODY_SHAPE_SPHERE)
-            {
-                Vector3 centerA = a->position;
-                Vector3 centerB = b->position;
-                Vector3 delta = centerB - centerA;
-                float distSq = delta.lengthSquared();
-                float radiusSum = a->radius + b->radius;
-                if (distSq > radiusSum * radiusSum)
-                {
-                    if (currentDeltaTime > 0.0f)
-                    {
-                        Vector3 startA = a->previousPosition;
-                        Vector3 endA = a->position;
-                        Vector3 startB = b->previousPosition;
-                        Vector3 endB = b->position;
-                        Vector3 relStart = startA - startB;
-                        Vector3 relEnd = endA - endB;
-                        Vector3 relDir = relEnd - relStart;
-                        float relLenSq = relDir.lengthSquared();
-                        if (relLenSq > 1e-8f)
-                        {
-                            Ray ray(relStart, relDir);
-                            CollisionSphere expanded(Vector3(0, 0, 0), radiusSum);
-                            float t;
-                            if (ray.intersects(expanded, t) && t >= 0.0f && t <= 1.0f)
-                            {
-                                Vector3 posA = startA + (endA - startA) * t;
-                                Vector3 posB = startB + (endB - startB) * t;
-                                Vector3 hitDelta = posB - posA;
-                                float distHitSq = hitDelta.lengthSquared();
-                                float distHit = distHitSq > 1e-8f ? sqrtf(distHitSq) : 0.0f;
-                                Vector3 normal;
-                                if (distHit > 1e-4f)
-                                {
-                                    normal = hitDelta * (1.0f / distHit);
-                                }
-                                else
-                                {
-                                    normal = Vector3(0, 1, 0);
-                                }
-                                float penetration = radiusSum - distHit;
-                                if (penetration < 0.0f)
-                                    penetration = 0.0f;
-                                Vector3 contact = posA + normal * (a->radius - penetration * 0.5f);
-
-                                info.hasCollision = true;
-                                info.bodyA = a;
-                                info.bodyB = b;
-                                info.normal = normal;
-                                info.contactCount = 1;
-                                info.contacts[0].pos = contact;
-                                info.contacts[0].penetration = penetration;
-                                info.contacts[0].accumulatedImpulse = 0.0f;
-                                return info;
-                            }
-                        }
-                    }
-                    return info;
-                }
-                float dist = distSq > 1e-8f ? sqrtf(distSq) : 0.0f;
-                Vector3 normal;
-                if (dist > 1e-4f)
-                {
-                    normal = delta * (1.0f / dist);
-                }
-                else
-                {
-                    normal = Vector3(0, 1, 0);
-                }
-                float penetration = radiusSum - dist;
-                Vector3 contact = centerA + normal * (a->radius - penetration * 0.5f);
-                info.hasCollision = true;
-                info.bodyA = a;
-                info.bodyB = b;
-                info.normal = normal;
-                info.contactCount = 1;
-                info.contacts[0].pos = contact;
-                info.contacts[0].penetration = penetration;
-                info.contacts[0].accumulatedImpulse = 0.0f;
-                return info;
-            }
-
-            if (a->shape == BODY_SHAPE_SPHERE && b->shape == BODY_SHAPE_BOX)
-            {
-                Vector3 sphereCenter = a->position;
-                Vector3 boxCenter = b->position;
-                Vector3 halfExtents = b->size * 0.5f;
-
-                Quaternion invRot = b->orientation.conjugate();
-                Vector3 local = invRot.rotate(sphereCenter - boxCenter);
-
-                float lx = fmaxf(-halfExtents.x, fminf(local.x, halfExtents.x));
-                float ly = fmaxf(-halfExtents.y, fminf(local.y, halfExtents.y));
-                float lz = fmaxf(-halfExtents.z, fminf(local.z, halfExtents.z));
-                Vector3 closestLocal(lx, ly, lz);
-                Vector3 closestWorld = b->orientation.rotate(closestLocal) + boxCenter;
-
-                Vector3 diff = closestWorld - sphereCenter;
-                float distSq = diff.lengthSquared();
-                float r = a->radius;
-                if (distSq > r * r)
-                {
-                    if (currentDeltaTime > 0.0f)
-                    {
-                        Vector3 start = a->previousPosition;
-                        Vector3 end = a->position;
-                        Vector3 dir = end - start;
-                        float lenSq = dir.lengthSquared();
-                        if (lenSq > 1e-8f)
-                        {
-                            AABB expanded = b->bounds;
-                            expanded.min.x -= r;
-                            expanded.min.y -= r;
-                            expanded.min.z -= r;
-                            expanded.max.x += r;
-                            expanded.max.y += r;
-                            expanded.max.z += r;
-
-                            Ray ray(start, dir);
-                            float tMin, tMax;
-                            if (ray.intersects(expanded, tMin, tMax) && tMax >= 0.0f && tMin <= 1.0f)
-                            {
-                                float tHit = tMin;
-                                if (tHit < 0.0f)
-                                    tHit = 0.0f;
-                                if (tHit > 1.0f)
-                                    tHit = 1.0f;
-
-                                Vector3 centerHit = start + dir * tHit;
-                                Vector3 boxMin = b->bounds.min;
-                                Vector3 boxMax = b->bounds.max;
-                                float hx = fmaxf(boxMin.x, fminf(centerHit.x, boxMax.x));
-                                float hy = fmaxf(boxMin.y, fminf(centerHit.y, boxMax.y));
-                                float hz = fmaxf(boxMin.z, fminf(centerHit.z, boxMax.z));
-                                Vector3 closestHit(hx, hy, hz);
-                                Vector3 diffHit = closestHit - centerHit;
-                                float distHitSq = diffHit.lengthSquared();
-                                float distHit = distHitSq > 1e-8f ? sqrtf(distHitSq) : 0.0f;
-
-                                Vector3 normal;
-                                float penetration;
-                                if (distHit > 1e-4f)
-                                {
-                                    normal = diffHit * (1.0f / distHit);
-                                    penetration = r - distHit;
-                                }
-                                else
-                                {
-                                    normal = Vector3(0, -1, 0);
-                                    penetration = r;
-                                }
-
-                                if (penetration < 0.0f)
-                                    penetration = 0.0f;
-
-                                info.hasCollision = true;
-                                info.bodyA = a;
-                                info.bodyB = b;
-                                info.normal = normal;
-                                info.contactCount = 1;
-                                info.contacts[0].pos = closestHit;
-                                info.contacts[0].penetration = penetration;
-                                info.contacts[0].accumulatedImpulse = 0.0f;
-                                return info;
-                            }
-                        }
-                    }
-
-                    return info;
-                }
-
-                float dist = distSq > 1e-8f ? sqrtf(distSq) : 0.0f;
-                Vector3 normal;
-                float penetration;
-                if (dist > 1e-4f)
-                {
-                    normal = diff * (1.0f / dist);
-                    penetration = r - dist;
-                }
-                else
-                {
-                    float dx = halfExtents.x - fabsf(local.x);
-                    float dy = halfExtents.y - fabsf(local.y);
-                    float dz = halfExtents.z - fabsf(local.z);
-
-                    Vector3 localN(0, -1, 0);
-                    if (dx < dy && dx < dz)
-                    {
-                        localN = Vector3((local.x > 0.0f) ? 1.0f : -1.0f, 0.0f, 0.0f);
-                    }
-                    else if (dy < dz)
-                    {
-                        localN = Vector3(0.0f, (local.y > 0.0f) ? 1.0f : -1.0f, 0.0f);
-                    }
-                    else
-                    {
-                        localN = Vector3(0.0f, 0.0f, (local.z > 0.0f) ? 1.0f : -1.0f);
-                    }
-                    normal = b->orientation.rotate(localN);
-                    penetration = r;
-                }
-
-                info.hasCollision = true;
-                info.bodyA = a;
-                info.bodyB = b;
-                info.normal = normal;
-                info.contactCount = 1;
-                info.contacts[0].pos = closestWorld;
-                info.contacts[0].penetration = penetration;
-                info.contacts[0].accumulatedImpulse = 0.0f;
-                return info;
-            }
-
-            if (a->shape == BODY_SHAPE_BOX && b->shape == BODY_SHAPE_SPHERE)
-            {
-                CollisionInfo swapped = detectCollision(b, a);
-                if (!swapped.hasCollision)
-                {
-                    return info;
-                }
-                info.hasCollision = true;
-                info.bodyA = a;
-                info.bodyB = b;
-                info.normal = swapped.normal * -1.0f;
-                info.contactCount = swapped.contactCount;
-                for (int i = 0; i < swapped.contactCount && i < 4; ++i)
-                {
-                    info.contacts[i].pos = swapped.contacts[i].pos;
-                    info.contacts[i].penetration = swapped.contacts[i].penetration;
-                    info.contacts[i].accumulatedImpulse = 0.0f;
-                }
-                return info;
-            }
-
-            if (a->shape == BODY_SHAPE_BOX && b->shape == BODY_SHAPE_BOX)
-            {
-                const float eps = 1e-4f;
-
-                Vector3 Ca = a->position;
-                Vector3 Cb = b->position;
-
-                Vector3 Aa[3];
-                Aa[0] = a->orientation.rotate(Vector3(1, 0, 0));
-                Aa[1] = a->orientation.rotate(Vector3(0, 1, 0));
-                Aa[2] = a->orientation.rotate(Vector3(0, 0, 1));
-
-                Vector3 Ab[3];
-                Ab[0] = b->orientation.rotate(Vector3(1, 0, 0));
-                Ab[1] = b->orientation.rotate(Vector3(0, 1, 0));
-                Ab[2] = b->orientation.rotate(Vector3(0, 0, 1));
-
-                Vector3 Ea = a->size * 0.5f;
-                Vector3 Eb = b->size * 0.5f;
-
-                float R[3][3];
-                float AbsR[3][3];
-                for (int i = 0; i < 3; ++i)
-                {
-                    for (int j = 0; j < 3; ++j)
-                    {
-                        float v = Aa[i].dot(Ab[j]);
-                        R[i][j] = v;
-                        AbsR[i][j] = fabsf(v) + eps;
-                    }
-                }
-
-                Vector3 tWorld = Cb - Ca;
-                float t[3];
-                t[0] = tWorld.dot(Aa[0]);
-                t[1] = tWorld.dot(Aa[1]);
-                t[2] = tWorld.dot(Aa[2]);
-
-                float minPenetration = FLT_MAX;
-                Vector3 bestAxis(0, 1, 0);
-
-                for (int i = 0; i < 3; ++i)
-                {
-                    float ra = (i == 0 ? Ea.x : (i == 1 ? Ea.y : Ea.z));
-                    float rb = Eb.x * AbsR[i][0] + Eb.y * AbsR[i][1] + Eb.z * AbsR[i][2];
-                    float dist = fabsf(t[i]);
-                    float pen = ra + rb - dist;
-                    if (pen < 0.0f)
-                        return info;
-                    if (pen < minPenetration)
-                    {
-                        minPenetration = pen;
-                        bestAxis = Aa[i] * (t[i] < 0.0f ? -1.0f : 1.0f);
-                    }
-                }
-
-                for (int j = 0; j < 3; ++j)
-                {
-                    float ra = Ea.x * AbsR[0][j] + Ea.y * AbsR[1][j] + Ea.z * AbsR[2][j];
-                    float rb = (j == 0 ? Eb.x : (j == 1 ? Eb.y : Eb.z));
-                    float dist = fabsf(Cb.dot(Ab[j]) - Ca.dot(Ab[j]));
-                    float pen = ra + rb - dist;
-                    if (pen < 0.0f)
-                        return info;
-                    if (pen < minPenetration)
-                    {
-                        minPenetration = pen;
-                        float sign = (tWorld.dot(Ab[j]) < 0.0f) ? -1.0f : 1.0f;
-                        bestAxis = Ab[j] * sign;
-                    }
-                }
-
-                for (int i = 0; i < 3; ++i)
-                {
-                    for (int j = 0; j < 3; ++j)
-                    {
-                        Vector3 axis = Aa[i].cross(Ab[j]);
-                        float axisLenSq = axis.lengthSquared();
-                        if (axisLenSq < 1e-8f)
-                            continue;
-                        float invLen = FastMath::fastInvSqrt(axisLenSq);
-                        axis *= invLen;
-
-                        float ra =
-                            Ea.x * fabsf(axis.dot(Aa[0])) +
-                            Ea.y * fabsf(axis.dot(Aa[1])) +
-                            Ea.z * fabsf(axis.dot(Aa[2]));
-                        float rb =
-                            Eb.x * fabsf(axis.dot(Ab[0])) +
-                            Eb.y * fabsf(axis.dot(Ab[1])) +
-                            Eb.z * fabsf(axis.dot(Ab[2]));
-                        float dist = fabsf(axis.dot(tWorld));
-                        float pen = ra + rb - dist;
-                        if (pen < 0.0f)
-                            return info;
-                        if (pen < minPenetration)
-                        {
-                            minPenetration = pen;
-                            bestAxis = axis * (axis.dot(tWorld) < 0.0f ? -1.0f : 1.0f);
-                        }
-                    }
-                }
-
-                if (minPenetration <= 0.0f)
-                    return info;
-
-                Vector3 n = bestAxis;
-
-                // Reference face: выбираем грань коробки A, чья ось максимально сонаправлена с нормалью
-                int refIndex = 0;
-                float maxDotA = Aa[0].dot(n);
-                for (int i = 1; i < 3; ++i)
-                {
-                    float d = Aa[i].dot(n);
-                    if (d > maxDotA)
-                    {
-                        maxDotA = d;
-                        refIndex = i;
-                    }
-                }
-
-                float refExtent = (refIndex == 0 ? Ea.x : (refIndex == 1 ? Ea.y : Ea.z));
-                float refSign = (maxDotA >= 0.0f ? 1.0f : -1.0f);
-                Vector3 refCenter = Ca + Aa[refIndex] * (refSign * refExtent);
-                float planeD = n.dot(refCenter);
-
-                // Incident face: грань коробки B, чья нормаль максимально анти-параллельна нормали коллизии
-                int incIndex = 0;
-                float minDotB = Ab[0].dot(n);
-                for (int j = 1; j < 3; ++j)
-                {
-                    float d = Ab[j].dot(n);
-                    if (d < minDotB)
-                    {
-                        minDotB = d;
-                        incIndex = j;
-                    }
-                }
-
-                Vector3 incidentLocal[4];
-                if (incIndex == 0)
-                {
-                    float x = (Ab[0].dot(n) < 0.0f) ? Eb.x : -Eb.x;
-                    incidentLocal[0] = Vector3(x, -Eb.y, -Eb.z);
-                    incidentLocal[1] = Vector3(x, -Eb.y, Eb.z);
-                    incidentLocal[2] = Vector3(x, Eb.y, -Eb.z);
-                    incidentLocal[3] = Vector3(x, Eb.y, Eb.z);
-                }
-                else if (incIndex == 1)
-                {
-                    float y = (Ab[1].dot(n) < 0.0f) ? Eb.y : -Eb.y;
-                    incidentLocal[0] = Vector3(-Eb.x, y, -Eb.z);
-                    incidentLocal[1] = Vector3(-Eb.x, y, Eb.z);
-                    incidentLocal[2] = Vector3(Eb.x, y, -Eb.z);
-                    incidentLocal[3] = Vector3(Eb.x, y, Eb.z);
-                }
-                else
-                {
-                    float z = (Ab[2].dot(n) < 0.0f) ? Eb.z : -Eb.z;
-                    incidentLocal[0] = Vector3(-Eb.x, -Eb.y, z);
-                    incidentLocal[1] = Vector3(-Eb.x, Eb.y, z);
-                    incidentLocal[2] = Vector3(Eb.x, -Eb.y, z);
-                    incidentLocal[3] = Vector3(Eb.x, Eb.y, z);
-                }
-
-                Vector3 incidentWorld[4];
-                for (int i = 0; i < 4; ++i)
-                {
-                    incidentWorld[i] = b->orientation.rotate(incidentLocal[i]) + Cb;
-                }
-
-                info.hasCollision = true;
-                info.bodyA = a;
-                info.bodyB = b;
-                info.normal = n;
-                info.contactCount = 0;
-
-                const float contactEps = 1e-3f;
-                for (int i = 0; i < 4; ++i)
-                {
-                    Vector3 p = incidentWorld[i];
-                    float dist = n.dot(p) - planeD;
-                    if (dist <= contactEps && info.contactCount < 4)
-                    {
-                        Contact &c = info.contacts[info.contactCount++];
-                        c.pos = p - n * dist; // проекция на плоскость reference face
-                        c.penetration = fmaxf(0.0f, -dist);
-                        c.accumulatedImpulse = 0.0f;
-                    }
-                }
-
-                if (info.contactCount == 0)
-                {
-                    // Фолбэк: одна точка между центрами, как раньше
-                    info.contactCount = 1;
-                    info.contacts[0].pos = (Ca + Cb) * 0.5f;
-                    info.contacts[0].penetration = minPenetration;
-                    info.contacts[0].accumulatedImpulse = 0.0f;
-                }
-
-                return info;
-            }
-
+            uint8_t noHint = ContactManifold::NO_AXIS;
+            uint8_t &axisHint = cache ? cache->separatingAxis : noHint;
+            if (!Narrowphase::collide(a, b, currentDeltaTime > 0.0f, axisHint, info))
+                info = CollisionInfo();
             return info;
         }
 
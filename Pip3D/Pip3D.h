@@ -6,6 +6,7 @@
 #include "Core/Frustum.h"
 #include "Core/Instance.h"
 #include "Core/Jobs.h"
+#include "Core/ResourceManager.h"
 #include "Core/Debug/DebugConfig.h"
 #include "Core/Debug/Logging.h"
 #include "Core/Debug/DebugDraw.h"
@@ -16,19 +17,27 @@
 #include "Physics/Physics.h"
 
 #include "Geometry/Mesh.h"
+#include "Geometry/MeshLOD.h"
+#include "Geometry/BakedMesh.h"
 #include "Geometry/PrimitiveShapes.h"
+#include "Geometry/StaticPrimitives.h"
 
 #include "Rendering/Display/ZBuffer.h"
 #include "Rendering/Lighting/Lighting.h"
 #include "Rendering/Lighting/Shadow.h"
 #include "Rendering/Rasterizer/Rasterizer.h"
 #include "Rendering/Rasterizer/Shading.h"
+#include "Rendering/Rasterizer/Texture.h"
 #include "Rendering/Display/FrameBuffer.h"
 #include "Rendering/Renderer.h"
+#include "Rendering/RenderReplay.h"
 
-#include "Rendering/Display/Drivers/ST7789Driver.h"
 #include "Graphics/Font.h"
+#ifndef PIP3D_HOST
+// Direct panel access; host builds only have HeadlessDriver.
+#include "Rendering/Display/Drivers/ST7789Driver.h"
 #include "Graphics/Screen.h"
+#endif
 
 #include "Scene/SceneHelper.h"
 #include "Utils/ObjectUtils.h"
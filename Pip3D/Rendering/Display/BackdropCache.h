@@ -0,0 +1,150 @@
+#ifndef BACKDROPCACHE_H
+#define BACKDROPCACHE_H
+
+#include <string.h>
+#include "../../Core/Core.h"
+#include "ZBuffer.h"
+
+namespace pip3D
+{
+
+    // Color and depth of every band right after its static backdrop was
+    // drawn. A band is restored instead of re-rasterized while its key (the
+    // static instances drawn into it) is unchanged. Needs roughly 4 bytes per
+    // screen pixel with 16-bit depth, so it lives in PSRAM when
+    // PIP3D_USE_PSRAM is set.
+    class BackdropCache
+    {
+    public:
+        static constexpr size_t BAND_PIXELS = static_cast<size_t>(SCREEN_WIDTH) * SCREEN_BAND_CAPACITY;
+        static constexpr size_t BAND_DEPTH_BYTES = ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY>::STORAGE_BYTES;
+
+    private:
+        uint16_t *color;
+        uint8_t *depth;
+        // Per-band state; the worker core of a paired deferred band writes
+        // its own entries only.
+        uint32_t keys[SCREEN_BAND_COUNT];
+        uint8_t valid[SCREEN_BAND_COUNT];
+        uint8_t captured[SCREEN_BAND_COUNT];
+
+    public:
+        BackdropCache() : color(nullptr), depth(nullptr)
+        {
+            for (int i = 0; i < SCREEN_BAND_COUNT; ++i)
+            {
+                keys[i] = 0;
+                valid[i] = 0;
+                captured[i] = 0;
+            }
+        }
+
+        ~BackdropCache()
+        {
+            release();
+        }
+
+        BackdropCache(const BackdropCache &) = delete;
+        BackdropCache &operator=(const BackdropCache &) = delete;
+
+        bool init()
+        {
+            if (color && depth)
+                return true;
+
+            const size_t pixels = BAND_PIXELS * SCREEN_BAND_COUNT;
+            color = static_cast<uint16_t *>(MemUtils::allocData(pixels * sizeof(uint16_t), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+            depth = static_cast<uint8_t *>(MemUtils::allocData(BAND_DEPTH_BYTES * SCREEN_BAND_COUNT, 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+            if (!color || !depth)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "BackdropCache::init: allocation failed (%u bytes)",
+                     static_cast<unsigned int>(pixels * sizeof(uint16_t) + BAND_DEPTH_BYTES * SCREEN_BAND_COUNT));
+                release();
+                return false;
+            }
+            invalidate();
+            return true;
+        }
+
+        void release()
+        {
+            if (color)
+                MemUtils::freeData(color);
+            if (depth)
+                MemUtils::freeData(depth);
+            color = nullptr;
+            depth = nullptr;
+            invalidate();
+        }
+
+        __attribute__((always_inline)) inline bool isReady() const { return color != nullptr; }
+
+        void beginFrame()
+        {
+            for (int i = 0; i < SCREEN_BAND_COUNT; ++i)
+                captured[i] = 0;
+        }
+
+        void invalidate()
+        {
+            for (int i = 0; i < SCREEN_BAND_COUNT; ++i)
+                valid[i] = 0;
+        }
+
+        bool isValid(int band) const
+        {
+            return band >= 0 && band < SCREEN_BAND_COUNT && valid[band];
+        }
+
+        bool allValid() const
+        {
+            for (int i = 0; i < SCREEN_BAND_COUNT; ++i)
+            {
+                if (!valid[i])
+                    return false;
+            }
+            return isReady();
+        }
+
+        bool matches(int band, uint32_t key) const
+        {
+            return isValid(band) && keys[band] == key;
+        }
+
+        // pixels is the band framebuffer size (config width * height).
+        void store(int band, uint32_t key, const uint16_t *frameBuffer, size_t pixels,
+                   const ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> &zBuffer)
+        {
+            if (!isReady() || !frameBuffer || band < 0 || band >= SCREEN_BAND_COUNT || pixels > BAND_PIXELS)
+                return;
+            memcpy(color + band * BAND_PIXELS, frameBuffer, pixels * sizeof(uint16_t));
+            zBuffer.copyTo(depth + band * BAND_DEPTH_BYTES);
+            keys[band] = key;
+            valid[band] = 1;
+            captured[band] = 1;
+        }
+
+        bool load(int band, uint16_t *frameBuffer, size_t pixels,
+                  ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> &zBuffer) const
+        {
+            if (!isValid(band) || !frameBuffer || pixels > BAND_PIXELS)
+                return false;
+            memcpy(frameBuffer, color + band * BAND_PIXELS, pixels * sizeof(uint16_t));
+            zBuffer.copyFrom(depth + band * BAND_DEPTH_BYTES);
+            return true;
+        }
+
+        // Bands captured since beginFrame().
+        uint32_t getCaptureCount() const
+        {
+            uint32_t count = 0;
+            for (int i = 0; i < SCREEN_BAND_COUNT; ++i)
+                count += captured[i];
+            return count;
+        }
+    };
+
+}
+
+#endif
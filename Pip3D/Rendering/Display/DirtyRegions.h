@@ -2,583 +2,369 @@
 #define DIRTYREGIONS_H
 
 #include <stdint.h>
+#include <string.h>
 #include "../../Core/Core.h"
-#include "FrameBuffer.h"
 
-namespace pip3D
-{
-    class MeshInstance;
+// Edge of a square dirty tile in pixels.
+#ifndef PIP3D_DIRTY_TILE_SIZE
+#define PIP3D_DIRTY_TILE_SIZE 16
+#endif
 
-    static constexpr int MAX_WORLD_DIRTY_INSTANCES = 32;
+// Above this share of dirty tiles (percent) a band is flushed whole.
+#ifndef PIP3D_DIRTY_FULL_PERCENT
+#define PIP3D_DIRTY_FULL_PERCENT 70
+#endif
 
-    struct WorldInstanceDirtySlot
-    {
-        MeshInstance *instance;
-        int16_t curMinX;
-        int16_t curMinY;
-        int16_t curMaxX;
-        int16_t curMaxY;
-        int16_t lastMinX;
-        int16_t lastMinY;
-        int16_t lastMaxX;
-        int16_t lastMaxY;
-        bool hasCurrent;
-        bool hasLast;
-    };
+namespace pip3D
+{
 
-    class DirtyRegionHelper
+    // Screen tiles whose content changed since the last frame. Everything
+    // drawn adds a key (instance, transform version, color, text...) to the
+    // signature of each tile its screen rect touches; a tile is dirty when
+    // its signature differs from the previous frame's, which also catches
+    // content that disappeared. Explicit marks cover drawing without a key.
+    //
+    // resolve() fixes the dirty set for the frame, once the scene is known
+    // (first band flush, or before deferred bands are rasterized). Content
+    // added after that, e.g. HUD drawn by later bands, is compared apart and
+    // a change on a tile that was already treated as clean is carried into
+    // the next frame, so it shows up one frame late rather than never.
+    class DirtyTileMap
     {
     public:
-        static void addDirtyRect(MeshInstance *instance,
-                                 int16_t x, int16_t y, int16_t w, int16_t h,
-                                 const Viewport &viewport,
-                                 WorldInstanceDirtySlot worldInstanceDirty[MAX_WORLD_DIRTY_INSTANCES],
-                                 int16_t &worldDirtyMinX,
-                                 int16_t &worldDirtyMinY,
-                                 int16_t &worldDirtyMaxX,
-                                 int16_t &worldDirtyMaxY,
-                                 bool &hasWorldDirtyRegion)
+        static constexpr int TILE_SIZE = PIP3D_DIRTY_TILE_SIZE;
+        static constexpr int COLS = (SCREEN_WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+        static constexpr int ROWS = (SCREEN_HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+        static constexpr int TILES = COLS * ROWS;
+        static constexpr int WORDS = (COLS + 31) / 32;
+
+        // Screen rect to flush, in full-screen pixels.
+        struct Run
         {
-            int16_t x0 = x;
-            int16_t y0 = y;
-            int16_t x1 = x + w;
-            int16_t y1 = y + h;
-
-            if (x1 <= 0 || y1 <= 0 || x0 >= viewport.width || y0 >= viewport.height)
-                return;
+            int16_t x, y, w, h;
+        };
+
+        // Worst case for one band: every other tile dirty in every row.
+        static constexpr int MAX_BAND_RUNS = ((COLS + 1) / 2) * ((SCREEN_BAND_CAPACITY + TILE_SIZE - 1) / TILE_SIZE + 1);
+
+    private:
+        uint32_t earlySig[TILES];
+        uint32_t lastEarlySig[TILES];
+        uint32_t lateSig[TILES];
+        uint32_t lastLateSig[TILES];
+        uint32_t marked[ROWS][WORDS];
+        uint32_t carried[ROWS][WORDS];
+        uint32_t dirty[ROWS][WORDS];
+        uint16_t dirtyCount;
+        bool full;
+        bool resolved;
+        bool hasHistory;
+
+        __attribute__((always_inline)) static inline uint32_t mix(uint32_t h)
+        {
+            h ^= h >> 16;
+            h *= 0x7feb352du;
+            h ^= h >> 15;
+            h *= 0x846ca68bu;
+            h ^= h >> 16;
+            return h;
+        }
 
+        // Clips a pixel rect to the screen and converts it to tile bounds.
+        static bool tileBounds(int16_t x, int16_t y, int16_t w, int16_t h,
+                               int &c0, int &r0, int &c1, int &r1)
+        {
+            int x0 = x, y0 = y, x1 = x + w, y1 = y + h;
             if (x0 < 0)
                 x0 = 0;
             if (y0 < 0)
                 y0 = 0;
-            if (x1 > viewport.width)
-                x1 = viewport.width;
-            if (y1 > viewport.height)
-                y1 = viewport.height;
+            if (x1 > SCREEN_WIDTH)
+                x1 = SCREEN_WIDTH;
+            if (y1 > SCREEN_HEIGHT)
+                y1 = SCREEN_HEIGHT;
+            if (x1 <= x0 || y1 <= y0)
+                return false;
+
+            c0 = x0 / TILE_SIZE;
+            r0 = y0 / TILE_SIZE;
+            c1 = (x1 - 1) / TILE_SIZE;
+            r1 = (y1 - 1) / TILE_SIZE;
+            return true;
+        }
 
-            if (instance == nullptr)
+        static void setBits(uint32_t (&bits)[ROWS][WORDS], int c0, int r0, int c1, int r1)
+        {
+            for (int r = r0; r <= r1; ++r)
             {
-                if (!hasWorldDirtyRegion)
-                {
-                    worldDirtyMinX = x0;
-                    worldDirtyMinY = y0;
-                    worldDirtyMaxX = x1;
-                    worldDirtyMaxY = y1;
-                    hasWorldDirtyRegion = true;
-                }
-                else
-                {
-                    if (x0 < worldDirtyMinX)
-                        worldDirtyMinX = x0;
-                    if (y0 < worldDirtyMinY)
-                        worldDirtyMinY = y0;
-                    if (x1 > worldDirtyMaxX)
-                        worldDirtyMaxX = x1;
-                    if (y1 > worldDirtyMaxY)
-                        worldDirtyMaxY = y1;
-                }
-                return;
+                for (int c = c0; c <= c1; ++c)
+                    bits[r][c >> 5] |= 1u << (c & 31);
             }
+        }
 
-            int freeIndex = -1;
-            int slotIndex = -1;
-            for (int i = 0; i < MAX_WORLD_DIRTY_INSTANCES; ++i)
-            {
-                if (worldInstanceDirty[i].instance == instance)
-                {
-                    slotIndex = i;
-                    break;
-                }
-                if (freeIndex < 0 && worldInstanceDirty[i].instance == nullptr &&
-                    !worldInstanceDirty[i].hasCurrent && !worldInstanceDirty[i].hasLast)
-                {
-                    freeIndex = i;
-                }
-            }
+        __attribute__((always_inline)) inline bool bit(int c, int r) const
+        {
+            return (dirty[r][c >> 5] >> (c & 31)) & 1u;
+        }
+
+    public:
+        DirtyTileMap()
+        {
+            reset();
+        }
 
-            if (slotIndex < 0)
+        // Forgets the previous frame, so the next one is fully dirty.
+        void reset()
+        {
+            memset(earlySig, 0, sizeof(earlySig));
+            memset(lastEarlySig, 0, sizeof(lastEarlySig));
+            memset(lateSig, 0, sizeof(lateSig));
+            memset(lastLateSig, 0, sizeof(lastLateSig));
+            memset(marked, 0, sizeof(marked));
+            memset(carried, 0, sizeof(carried));
+            memset(dirty, 0, sizeof(dirty));
+            dirtyCount = 0;
+            full = true;
+            resolved = false;
+            hasHistory = false;
+        }
+
+        static uint32_t hash(uint32_t h, uint32_t value)
+        {
+            return mix(h ^ (value + 0x9e3779b9u + (h << 6) + (h >> 2)));
+        }
+
+        void beginFrame()
+        {
+            // Late content that changed on a tile drawn clean goes to this frame.
+            memcpy(marked, carried, sizeof(marked));
+            memset(carried, 0, sizeof(carried));
+            if (resolved)
             {
-                if (freeIndex >= 0)
+                for (int r = 0; r < ROWS; ++r)
                 {
-                    slotIndex = freeIndex;
-                    worldInstanceDirty[slotIndex].instance = instance;
-                    worldInstanceDirty[slotIndex].hasCurrent = false;
-                    worldInstanceDirty[slotIndex].hasLast = false;
-                }
-                else
-                {
-                    if (!hasWorldDirtyRegion)
-                    {
-                        worldDirtyMinX = x0;
-                        worldDirtyMinY = y0;
-                        worldDirtyMaxX = x1;
-                        worldDirtyMaxY = y1;
-                        hasWorldDirtyRegion = true;
-                    }
-                    else
+                    for (int c = 0; c < COLS; ++c)
                     {
-                        if (x0 < worldDirtyMinX)
-                            worldDirtyMinX = x0;
-                        if (y0 < worldDirtyMinY)
-                            worldDirtyMinY = y0;
-                        if (x1 > worldDirtyMaxX)
-                            worldDirtyMaxX = x1;
-                        if (y1 > worldDirtyMaxY)
-                            worldDirtyMaxY = y1;
+                        const int t = r * COLS + c;
+                        if (lateSig[t] != lastLateSig[t] && !bit(c, r))
+                            marked[r][c >> 5] |= 1u << (c & 31);
                     }
-                    return;
                 }
             }
 
-            WorldInstanceDirtySlot &slot = worldInstanceDirty[slotIndex];
-            if (!slot.hasCurrent)
-            {
-                slot.curMinX = x0;
-                slot.curMinY = y0;
-                slot.curMaxX = x1;
-                slot.curMaxY = y1;
-                slot.hasCurrent = true;
-            }
-            else
-            {
-                if (x0 < slot.curMinX)
-                    slot.curMinX = x0;
-                if (y0 < slot.curMinY)
-                    slot.curMinY = y0;
-                if (x1 > slot.curMaxX)
-                    slot.curMaxX = x1;
-                if (y1 > slot.curMaxY)
-                    slot.curMaxY = y1;
-            }
+            memcpy(lastEarlySig, earlySig, sizeof(earlySig));
+            memcpy(lastLateSig, lateSig, sizeof(lateSig));
+            memset(earlySig, 0, sizeof(earlySig));
+            memset(lateSig, 0, sizeof(lateSig));
+            hasHistory = hasHistory || resolved;
+            full = !hasHistory;
+            resolved = false;
         }
 
-        static void addHudDirtyRect(int16_t x, int16_t y, int16_t w, int16_t h,
-                                    const Viewport &viewport,
-                                    int16_t &hudDirtyMinX,
-                                    int16_t &hudDirtyMinY,
-                                    int16_t &hudDirtyMaxX,
-                                    int16_t &hudDirtyMaxY,
-                                    bool &hasHudDirtyRegion)
+        // Adds content with identity key over a pixel rect. Called once per
+        // frame per piece of content; the sum keeps it independent of order.
+        void addContent(int16_t x, int16_t y, int16_t w, int16_t h, uint32_t key)
         {
-            int16_t x0 = x;
-            int16_t y0 = y;
-            int16_t x1 = x + w;
-            int16_t y1 = y + h;
-
-            if (x1 <= 0 || y1 <= 0 || x0 >= viewport.width || y0 >= viewport.height)
+            int c0, r0, c1, r1;
+            if (!tileBounds(x, y, w, h, c0, r0, c1, r1))
                 return;
 
-            if (x0 < 0)
-                x0 = 0;
-            if (y0 < 0)
-                y0 = 0;
-            if (x1 > viewport.width)
-                x1 = viewport.width;
-            if (y1 > viewport.height)
-                y1 = viewport.height;
-
-            if (!hasHudDirtyRegion)
-            {
-                hudDirtyMinX = x0;
-                hudDirtyMinY = y0;
-                hudDirtyMaxX = x1;
-                hudDirtyMaxY = y1;
-                hasHudDirtyRegion = true;
-            }
-            else
+            uint32_t *sig = resolved ? lateSig : earlySig;
+            const uint32_t m = mix(key);
+            for (int r = r0; r <= r1; ++r)
             {
-                if (x0 < hudDirtyMinX)
-                    hudDirtyMinX = x0;
-                if (y0 < hudDirtyMinY)
-                    hudDirtyMinY = y0;
-                if (x1 > hudDirtyMaxX)
-                    hudDirtyMaxX = x1;
-                if (y1 > hudDirtyMaxY)
-                    hudDirtyMaxY = y1;
+                uint32_t *row = sig + r * COLS;
+                for (int c = c0; c <= c1; ++c)
+                    row[c] += m;
             }
         }
 
-        static void finalizeFrame(FrameBuffer &framebuffer,
-                                  PerformanceCounter &perfCounter,
-                                  WorldInstanceDirtySlot worldInstanceDirty[MAX_WORLD_DIRTY_INSTANCES],
-                                  int16_t &worldDirtyMinX,
-                                  int16_t &worldDirtyMinY,
-                                  int16_t &worldDirtyMaxX,
-                                  int16_t &worldDirtyMaxY,
-                                  int16_t &lastWorldDirtyMinX,
-                                  int16_t &lastWorldDirtyMinY,
-                                  int16_t &lastWorldDirtyMaxX,
-                                  int16_t &lastWorldDirtyMaxY,
-                                  bool &hasWorldDirtyRegion,
-                                  bool &hasLastWorldDirtyRegion,
-                                  int16_t &hudDirtyMinX,
-                                  int16_t &hudDirtyMinY,
-                                  int16_t &hudDirtyMaxX,
-                                  int16_t &hudDirtyMaxY,
-                                  bool &hasHudDirtyRegion,
-                                  bool cameraChangedThisFrame,
-                                  uint32_t statsTrianglesTotal,
-                                  uint32_t statsTrianglesBackfaceCulled,
-                                  uint32_t statsInstancesTotal,
-                                  uint32_t statsInstancesFrustumCulled,
-                                  uint32_t statsInstancesOcclusionCulled,
-                                  bool forceFullFrame,
-                                  bool showDirtyOverlay)
+        // Forces a pixel rect dirty; after resolve() it applies next frame.
+        void markRect(int16_t x, int16_t y, int16_t w, int16_t h)
         {
-            static uint32_t debugFrameCounter = 0;
-            debugFrameCounter++;
-
-            const DisplayConfig &cfg = framebuffer.getConfig();
-
-            auto flushFullFrame = [&]()
-            {
-                framebuffer.endFrame();
-                perfCounter.endFrame();
-
-                if ((debugFrameCounter & 31u) == 0u)
-                {
-                    LOGD(::pip3D::Debug::LOG_MODULE_RENDER,
-                         "Stats: tri=%lu bf=%lu inst=%lu fr=%lu occ=%lu",
-                         (unsigned long)statsTrianglesTotal,
-                         (unsigned long)statsTrianglesBackfaceCulled,
-                         (unsigned long)statsInstancesTotal,
-                         (unsigned long)statsInstancesFrustumCulled,
-                         (unsigned long)statsInstancesOcclusionCulled);
-                }
-
-                hasWorldDirtyRegion = false;
-                hasLastWorldDirtyRegion = false;
-                hasHudDirtyRegion = false;
-                for (int i = 0; i < MAX_WORLD_DIRTY_INSTANCES; ++i)
-                {
-                    worldInstanceDirty[i].instance = nullptr;
-                    worldInstanceDirty[i].hasCurrent = false;
-                    worldInstanceDirty[i].hasLast = false;
-                }
-            };
-
-            if (forceFullFrame)
-            {
-                flushFullFrame();
+            int c0, r0, c1, r1;
+            if (!tileBounds(x, y, w, h, c0, r0, c1, r1))
                 return;
-            }
+            setBits(resolved ? carried : marked, c0, r0, c1, r1);
+        }
 
-            bool anyWorldDirty = hasWorldDirtyRegion || hasLastWorldDirtyRegion;
-            for (int i = 0; i < MAX_WORLD_DIRTY_INSTANCES && !anyWorldDirty; ++i)
-            {
-                if (worldInstanceDirty[i].hasCurrent || worldInstanceDirty[i].hasLast)
-                {
-                    anyWorldDirty = true;
-                }
-            }
+        void markAll()
+        {
+            if (resolved)
+                setBits(carried, 0, 0, COLS - 1, ROWS - 1);
+            else
+                full = true;
+        }
 
-            if (cameraChangedThisFrame || (!anyWorldDirty && !hasHudDirtyRegion))
-            {
-                flushFullFrame();
+        void resolve()
+        {
+            if (resolved)
                 return;
-            }
 
-            struct Rect
+            dirtyCount = 0;
+            for (int r = 0; r < ROWS; ++r)
             {
-                int16_t x0;
-                int16_t y0;
-                int16_t x1;
-                int16_t y1;
-            };
-
-            Rect worldRects[MAX_WORLD_DIRTY_INSTANCES + 1];
-            int worldRectCount = 0;
-
-            for (int i = 0; i < MAX_WORLD_DIRTY_INSTANCES; ++i)
-            {
-                WorldInstanceDirtySlot &slot = worldInstanceDirty[i];
-                if (!slot.hasCurrent && !slot.hasLast)
-                    continue;
+                for (int w = 0; w < WORDS; ++w)
+                    dirty[r][w] = full ? ~0u : marked[r][w];
 
-                Rect r;
-
-                if (slot.hasCurrent && slot.hasLast)
-                {
-                    r.x0 = (slot.curMinX < slot.lastMinX) ? slot.curMinX : slot.lastMinX;
-                    r.y0 = (slot.curMinY < slot.lastMinY) ? slot.curMinY : slot.lastMinY;
-                    r.x1 = (slot.curMaxX > slot.lastMaxX) ? slot.curMaxX : slot.lastMaxX;
-                    r.y1 = (slot.curMaxY > slot.lastMaxY) ? slot.curMaxY : slot.lastMaxY;
-                }
-                else if (slot.hasCurrent)
+                const uint32_t *sig = earlySig + r * COLS;
+                const uint32_t *last = lastEarlySig + r * COLS;
+                for (int c = 0; c < COLS; ++c)
                 {
-                    r.x0 = slot.curMinX;
-                    r.y0 = slot.curMinY;
-                    r.x1 = slot.curMaxX;
-                    r.y1 = slot.curMaxY;
-                }
-                else
-                {
-                    r.x0 = slot.lastMinX;
-                    r.y0 = slot.lastMinY;
-                    r.x1 = slot.lastMaxX;
-                    r.y1 = slot.lastMaxY;
+                    if (sig[c] != last[c])
+                        dirty[r][c >> 5] |= 1u << (c & 31);
                 }
 
-                int16_t rw = static_cast<int16_t>(r.x1 - r.x0);
-                int16_t rh = static_cast<int16_t>(r.y1 - r.y0);
-                if (rw > 0 && rh > 0)
-                {
-                    if (worldRectCount < static_cast<int>(sizeof(worldRects) / sizeof(worldRects[0])))
-                    {
-                        worldRects[worldRectCount++] = r;
-                    }
-                }
+                // Clear padding bits so whole-word tests stay exact.
+                if (COLS & 31)
+                    dirty[r][WORDS - 1] &= (1u << (COLS & 31)) - 1u;
 
-                if (slot.hasCurrent)
-                {
-                    slot.lastMinX = slot.curMinX;
-                    slot.lastMinY = slot.curMinY;
-                    slot.lastMaxX = slot.curMaxX;
-                    slot.lastMaxY = slot.curMaxY;
-                    slot.hasLast = true;
-                }
-                else
-                {
-                    slot.instance = nullptr;
-                    slot.hasLast = false;
-                }
-                slot.hasCurrent = false;
+                for (int w = 0; w < WORDS; ++w)
+                    dirtyCount += static_cast<uint16_t>(__builtin_popcount(dirty[r][w]));
             }
+            resolved = true;
+        }
 
-            if (hasWorldDirtyRegion || hasLastWorldDirtyRegion)
-            {
-                Rect r;
-                if (hasWorldDirtyRegion && hasLastWorldDirtyRegion)
-                {
-                    r.x0 = (worldDirtyMinX < lastWorldDirtyMinX) ? worldDirtyMinX : lastWorldDirtyMinX;
-                    r.y0 = (worldDirtyMinY < lastWorldDirtyMinY) ? worldDirtyMinY : lastWorldDirtyMinY;
-                    r.x1 = (worldDirtyMaxX > lastWorldDirtyMaxX) ? worldDirtyMaxX : lastWorldDirtyMaxX;
-                    r.y1 = (worldDirtyMaxY > lastWorldDirtyMaxY) ? worldDirtyMaxY : lastWorldDirtyMaxY;
-                }
-                else if (hasWorldDirtyRegion)
-                {
-                    r.x0 = worldDirtyMinX;
-                    r.y0 = worldDirtyMinY;
-                    r.x1 = worldDirtyMaxX;
-                    r.y1 = worldDirtyMaxY;
-                }
-                else
-                {
-                    r.x0 = lastWorldDirtyMinX;
-                    r.y0 = lastWorldDirtyMinY;
-                    r.x1 = lastWorldDirtyMaxX;
-                    r.y1 = lastWorldDirtyMaxY;
-                }
-
-                int16_t rw = static_cast<int16_t>(r.x1 - r.x0);
-                int16_t rh = static_cast<int16_t>(r.y1 - r.y0);
-                if (rw > 0 && rh > 0)
-                {
-                    if (worldRectCount < static_cast<int>(sizeof(worldRects) / sizeof(worldRects[0])))
-                    {
-                        worldRects[worldRectCount++] = r;
-                    }
-                }
-
-                if (hasWorldDirtyRegion)
-                {
-                    lastWorldDirtyMinX = worldDirtyMinX;
-                    lastWorldDirtyMinY = worldDirtyMinY;
-                    lastWorldDirtyMaxX = worldDirtyMaxX;
-                    lastWorldDirtyMaxY = worldDirtyMaxY;
-                    hasLastWorldDirtyRegion = true;
-                }
-                else
-                {
-                    hasLastWorldDirtyRegion = false;
-                }
-                hasWorldDirtyRegion = false;
-            }
+        bool isResolved() const { return resolved; }
+        uint16_t getDirtyCount() const { return dirtyCount; }
 
-            bool hasWorld = worldRectCount > 0;
-            bool hasHud = hasHudDirtyRegion;
+        bool isTileDirty(int col, int row) const
+        {
+            if (col < 0 || col >= COLS || row < 0 || row >= ROWS)
+                return false;
+            return bit(col, row);
+        }
 
-            int16_t hx0 = 0, hy0 = 0, hx1 = 0, hy1 = 0;
-            int16_t hw = 0, hh = 0;
-            int32_t hudArea = 0;
+        // True if any tile under the pixel rect is dirty.
+        bool anyDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1) const
+        {
+            int c0, r0, c1, r1;
+            if (!tileBounds(x0, y0, static_cast<int16_t>(x1 - x0 + 1), static_cast<int16_t>(y1 - y0 + 1),
+                            c0, r0, c1, r1))
+                return false;
 
-            if (hasHud)
+            for (int r = r0; r <= r1; ++r)
             {
-                hx0 = hudDirtyMinX;
-                hy0 = hudDirtyMinY;
-                hx1 = hudDirtyMaxX;
-                hy1 = hudDirtyMaxY;
-
-                hw = static_cast<int16_t>(hx1 - hx0);
-                hh = static_cast<int16_t>(hy1 - hy0);
-
-                if (hw <= 0 || hh <= 0)
-                {
-                    hasHud = false;
-                }
-                else
+                for (int w = c0 >> 5; w <= (c1 >> 5); ++w)
                 {
-                    hudArea = static_cast<int32_t>(hw) * static_cast<int32_t>(hh);
+                    uint32_t bits = dirty[r][w];
+                    if (w == (c0 >> 5))
+                        bits &= ~0u << (c0 & 31);
+                    if (w == (c1 >> 5) && (c1 & 31) != 31)
+                        bits &= (1u << ((c1 & 31) + 1)) - 1u;
+                    if (bits)
+                        return true;
                 }
             }
+            return false;
+        }
 
-            if (!hasWorld && !hasHud)
-            {
-                flushFullFrame();
-                return;
-            }
-
-            Rect mergedRects[MAX_WORLD_DIRTY_INSTANCES + 1];
-            int mergedCount = worldRectCount;
-            for (int i = 0; i < worldRectCount; ++i)
+        // Dirty tiles overlapping the screen rows [y0, y1).
+        int countDirtyRows(int16_t y0, int16_t y1, int16_t &firstY, int16_t &lastY) const
+        {
+            int count = 0;
+            firstY = y1;
+            lastY = y0;
+            if (y1 <= y0)
+                return 0;
+            const int r0 = y0 / TILE_SIZE;
+            const int r1 = (y1 - 1) / TILE_SIZE;
+            for (int r = r0; r <= r1 && r < ROWS; ++r)
             {
-                mergedRects[i] = worldRects[i];
+                int rowCount = 0;
+                for (int w = 0; w < WORDS; ++w)
+                    rowCount += __builtin_popcount(dirty[r][w]);
+                if (!rowCount)
+                    continue;
+                count += rowCount;
+                const int16_t top = static_cast<int16_t>(r * TILE_SIZE);
+                const int16_t bottom = static_cast<int16_t>(top + TILE_SIZE);
+                if (top < firstY)
+                    firstY = top;
+                if (bottom > lastY)
+                    lastY = bottom;
             }
+            if (firstY < y0)
+                firstY = y0;
+            if (lastY > y1)
+                lastY = y1;
+            return count;
+        }
 
-            bool mergedSomething;
-            do
+        // Dirty tiles of the screen rows [y0, y1) as horizontal runs, one per
+        // stretch of adjacent dirty tiles in a tile row. A run with the same
+        // columns as one in the row above extends it downwards, so full-width
+        // runs over consecutive rows become one contiguous transfer.
+        int buildRuns(int16_t y0, int16_t y1, Run *out, int maxRuns) const
+        {
+            if (y1 <= y0)
+                return 0;
+
+            // Runs whose bottom edge is the top of the current tile row.
+            int open[COLS / 2 + 1];
+            int next[COLS / 2 + 1];
+            int openCount = 0;
+            int count = 0;
+
+            const int r0 = y0 / TILE_SIZE;
+            const int r1 = (y1 - 1) / TILE_SIZE;
+            for (int r = r0; r <= r1 && r < ROWS; ++r)
             {
-                mergedSomething = false;
-                for (int i = 0; i < mergedCount && !mergedSomething; ++i)
+                int top = r * TILE_SIZE;
+                int bottom = top + TILE_SIZE;
+                if (top < y0)
+                    top = y0;
+                if (bottom > y1)
+                    bottom = y1;
+
+                int nextCount = 0;
+                int c = 0;
+                while (c < COLS)
                 {
-                    for (int j = i + 1; j < mergedCount; ++j)
+                    if (!bit(c, r))
                     {
-                        Rect &a = mergedRects[i];
-                        Rect &b = mergedRects[j];
-
-                        if (!(a.x1 < b.x0 || b.x1 < a.x0 || a.y1 < b.y0 || b.y1 < a.y0))
-                        {
-                            if (b.x0 < a.x0)
-                                a.x0 = b.x0;
-                            if (b.y0 < a.y0)
-                                a.y0 = b.y0;
-                            if (b.x1 > a.x1)
-                                a.x1 = b.x1;
-                            if (b.y1 > a.y1)
-                                a.y1 = b.y1;
-
-                            for (int k = j + 1; k < mergedCount; ++k)
-                            {
-                                mergedRects[k - 1] = mergedRects[k];
-                            }
-                            mergedCount--;
-                            mergedSomething = true;
-                            break;
-                        }
+                        ++c;
+                        continue;
                     }
-                }
-            } while (mergedSomething);
-
-            int32_t worldArea = 0;
-            for (int i = 0; i < mergedCount; ++i)
-            {
-                int16_t rw = static_cast<int16_t>(mergedRects[i].x1 - mergedRects[i].x0);
-                int16_t rh = static_cast<int16_t>(mergedRects[i].y1 - mergedRects[i].y0);
-                if (rw > 0 && rh > 0)
-                {
-                    worldArea += static_cast<int32_t>(rw) * static_cast<int32_t>(rh);
-                }
-            }
-
-            int32_t fullArea = static_cast<int32_t>(cfg.width) * static_cast<int32_t>(cfg.height);
-            int32_t combinedArea = worldArea + hudArea;
-
-            if (combinedArea * 100 >= fullArea * 70)
-            {
-                flushFullFrame();
-                return;
-            }
-
-            if (showDirtyOverlay)
-            {
-                uint16_t *fb = framebuffer.getBuffer();
-                if (fb)
-                {
-                    uint16_t overlayColor = Color::fromRGB888(255, 255, 0).rgb565;
-
-                    auto drawRectBorder = [&](int16_t x0, int16_t y0, int16_t x1, int16_t y1)
+                    const int start = c;
+                    while (c < COLS && bit(c, r))
+                        ++c;
+
+                    const int16_t x = static_cast<int16_t>(start * TILE_SIZE);
+                    int xEnd = c * TILE_SIZE;
+                    if (xEnd > SCREEN_WIDTH)
+                        xEnd = SCREEN_WIDTH;
+                    const int16_t w = static_cast<int16_t>(xEnd - x);
+
+                    int index = -1;
+                    for (int k = 0; k < openCount; ++k)
                     {
-                        if (x1 <= x0 || y1 <= y0)
-                            return;
-
-                        int16_t w = cfg.width;
-                        int16_t h = cfg.height;
-
-                        if (x0 < 0)
-                            x0 = 0;
-                        if (y0 < 0)
-                            y0 = 0;
-                        if (x1 > w)
-                            x1 = w;
-                        if (y1 > h)
-                            y1 = h;
-                        if (x1 <= x0 || y1 <= y0)
-                            return;
-
-                        int16_t top = y0;
-                        int16_t bottom = y1 - 1;
-                        for (int16_t x = x0; x < x1; ++x)
-                        {
-                            fb[top * w + x] = overlayColor;
-                            fb[bottom * w + x] = overlayColor;
-                        }
-
-                        int16_t left = x0;
-                        int16_t right = x1 - 1;
-                        for (int16_t y = y0; y < y1; ++y)
+                        if (out[open[k]].x == x && out[open[k]].w == w)
                         {
-                            fb[y * w + left] = overlayColor;
-                            fb[y * w + right] = overlayColor;
+                            index = open[k];
+                            break;
                         }
-                    };
+                    }
 
-                    for (int i = 0; i < mergedCount; ++i)
+                    if (index >= 0)
                     {
-                        int16_t x0 = static_cast<int16_t>(mergedRects[i].x0 + 1);
-                        int16_t y0 = static_cast<int16_t>(mergedRects[i].y0 + 1);
-                        int16_t x1 = static_cast<int16_t>(mergedRects[i].x1 - 1);
-                        int16_t y1 = static_cast<int16_t>(mergedRects[i].y1 - 1);
-                        drawRectBorder(x0, y0, x1, y1);
+                        out[index].h = static_cast<int16_t>(bottom - out[index].y);
                     }
-
-                    if (hasHud)
+                    else
                     {
-                        int16_t x0 = static_cast<int16_t>(hx0 + 1);
-                        int16_t y0 = static_cast<int16_t>(hy0 + 1);
-                        int16_t x1 = static_cast<int16_t>(hx1 - 1);
-                        int16_t y1 = static_cast<int16_t>(hy1 - 1);
-                        drawRectBorder(x0, y0, x1, y1);
+                        if (count >= maxRuns)
+                            return count;
+                        index = count++;
+                        out[index] = {x, static_cast<int16_t>(top), w, static_cast<int16_t>(bottom - top)};
                     }
+                    next[nextCount++] = index;
                 }
-            }
 
-            for (int i = 0; i < mergedCount; ++i)
-            {
-                int16_t rw = static_cast<int16_t>(mergedRects[i].x1 - mergedRects[i].x0);
-                int16_t rh = static_cast<int16_t>(mergedRects[i].y1 - mergedRects[i].y0);
-                if (rw <= 0 || rh <= 0)
-                    continue;
-
-                framebuffer.endFrameRegion(mergedRects[i].x0, mergedRects[i].y0, rw, rh);
-            }
-
-            if (hasHud)
-            {
-                framebuffer.endFrameRegion(hx0, hy0, hw, hh);
-            }
-
-            perfCounter.endFrame();
-
-            if ((debugFrameCounter & 31u) == 0u)
-            {
-                LOGD(::pip3D::Debug::LOG_MODULE_RENDER,
-                     "Stats: tri=%lu bf=%lu inst=%lu fr=%lu occ=%lu",
-                     (unsigned long)statsTrianglesTotal,
-                     (unsigned long)statsTrianglesBackfaceCulled,
-                     (unsigned long)statsInstancesTotal,
-                     (unsigned long)statsInstancesFrustumCulled,
-                     (unsigned long)statsInstancesOcclusionCulled);
+                for (int k = 0; k < nextCount; ++k)
+                    open[k] = next[k];
+                openCount = nextCount;
             }
+            return count;
         }
     };
 }
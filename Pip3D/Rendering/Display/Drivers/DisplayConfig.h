@@ -3,6 +3,12 @@
 
 #include "../../../Core/Core.h"
 
+// 1: Renderer drives the panel over the ESP32-S3 i80 parallel bus
+// (I80Driver) instead of SPI (ILI9488Driver).
+#ifndef PIP3D_DISPLAY_I80
+#define PIP3D_DISPLAY_I80 0
+#endif
+
 namespace pip3D
 {
 
@@ -2,6 +2,7 @@
 #define DISPLAYDRIVERBASE_H
 
 #include "DisplayConfig.h"
+#include "../SpanKernels.h"
 
 namespace pip3D
 {
@@ -19,6 +20,75 @@ namespace pip3D
                                int16_t h,
                                uint16_t *buffer) = 0;
 
+        // Sends a w x h region whose rows start stride pixels apart, e.g. a
+        // rectangle inside a wider framebuffer band.
+        virtual void pushImageStrided(int16_t x,
+                                      int16_t y,
+                                      int16_t w,
+                                      int16_t h,
+                                      uint16_t *buffer,
+                                      int16_t stride)
+        {
+            if (stride == w)
+            {
+                pushImage(x, y, w, h, buffer);
+                return;
+            }
+            for (int16_t row = 0; row < h; ++row)
+                pushImage(x, static_cast<int16_t>(y + row), w, 1, buffer + static_cast<size_t>(row) * stride);
+        }
+
+        // Sends a w x h source region widened for reduced render resolution:
+        // every pixel is repeated scaleX times and every row rowRepeat times,
+        // with consecutive source rows starting rowPitch panel lines apart
+        // (rowPitch > rowRepeat skips lines, for interlaced fields). x and y
+        // are in panel pixels. This fallback widens a piece of a row at a
+        // time on the stack; drivers widen inside their own DMA staging.
+        virtual void pushImageScaled(int16_t x,
+                                     int16_t y,
+                                     int16_t w,
+                                     int16_t h,
+                                     const uint16_t *buffer,
+                                     int16_t stride,
+                                     uint8_t scaleX,
+                                     uint8_t rowRepeat,
+                                     uint8_t rowPitch)
+        {
+            static constexpr int16_t LINE_PIXELS = 128;
+            uint16_t line[LINE_PIXELS];
+            const int16_t piece = static_cast<int16_t>(LINE_PIXELS / scaleX);
+
+            for (int16_t row = 0; row < h; ++row)
+            {
+                const uint16_t *src = buffer + static_cast<size_t>(row) * stride;
+                const int16_t panelY = static_cast<int16_t>(y + row * rowPitch);
+                for (int16_t sx = 0; sx < w; sx += piece)
+                {
+                    const int16_t n = (w - sx < piece) ? static_cast<int16_t>(w - sx) : piece;
+                    SpanKernels::widen16(line, src + sx, static_cast<size_t>(n), scaleX);
+                    for (uint8_t r = 0; r < rowRepeat; ++r)
+                        pushImage(static_cast<int16_t>(x + sx * scaleX), static_cast<int16_t>(panelY + r),
+                                  static_cast<int16_t>(n * scaleX), 1, line);
+                }
+            }
+        }
+
+        // Starts a transfer of a tightly packed w x h region and returns
+        // without waiting. Returns true if the transfer is still in flight:
+        // the buffer must not be written until waitTransfer() returns.
+        // Drivers without asynchronous DMA transfer synchronously.
+        virtual bool pushImageAsync(int16_t x,
+                                    int16_t y,
+                                    int16_t w,
+                                    int16_t h,
+                                    uint16_t *buffer)
+        {
+            pushImage(x, y, w, h, buffer);
+            return false;
+        }
+
+        virtual void waitTransfer() {}
+
         virtual uint16_t getWidth() const = 0;
         virtual uint16_t getHeight() const = 0;
     };
@@ -0,0 +1,234 @@
+#ifndef HEADLESSDRIVER_H
+#define HEADLESSDRIVER_H
+
+#include <stdio.h>
+
+#include "DisplayConfig.h"
+#include "DisplayDriverBase.h"
+#include "../../../Core/Core.h"
+
+namespace pip3D
+{
+
+    // Panel stand-in for host builds: every transfer lands in a plain RGB565
+    // image in memory, which can be read back, hashed or saved as PNG.
+    class HeadlessDriver : public DisplayDriverBase
+    {
+    private:
+        uint16_t width, height;
+        uint16_t *image;
+        uint32_t pushCount;
+
+        static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t size)
+        {
+            static uint32_t table[256];
+            static bool tableReady = false;
+            if (!tableReady)
+            {
+                for (uint32_t n = 0; n < 256; ++n)
+                {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; ++k)
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    table[n] = c;
+                }
+                tableReady = true;
+            }
+
+            crc = ~crc;
+            for (size_t i = 0; i < size; ++i)
+                crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            return ~crc;
+        }
+
+        static void putBE32(uint8_t *out, uint32_t v)
+        {
+            out[0] = static_cast<uint8_t>(v >> 24);
+            out[1] = static_cast<uint8_t>(v >> 16);
+            out[2] = static_cast<uint8_t>(v >> 8);
+            out[3] = static_cast<uint8_t>(v);
+        }
+
+        static bool writeChunk(FILE *f, const char *type, const uint8_t *data, uint32_t size)
+        {
+            uint8_t header[8];
+            putBE32(header, size);
+            memcpy(header + 4, type, 4);
+            uint32_t crc = crc32Update(0, header + 4, 4);
+            crc = crc32Update(crc, data, size);
+            uint8_t footer[4];
+            putBE32(footer, crc);
+            return fwrite(header, 1, 8, f) == 8 &&
+                   (size == 0 || fwrite(data, 1, size, f) == size) &&
+                   fwrite(footer, 1, 4, f) == 4;
+        }
+
+    public:
+        HeadlessDriver() : width(0), height(0), image(nullptr), pushCount(0) {}
+
+        ~HeadlessDriver()
+        {
+            MemUtils::freeData(image);
+        }
+
+        bool init(const LCD &config = LCD()) override
+        {
+            MemUtils::freeData(image);
+            width = config.w;
+            height = config.h;
+            const size_t bytes = static_cast<size_t>(width) * height * sizeof(uint16_t);
+            image = static_cast<uint16_t *>(MemUtils::allocData(bytes, 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+            if (!image)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "HeadlessDriver init: image alloc failed (bytes=%u)",
+                     static_cast<unsigned int>(bytes));
+                width = height = 0;
+                return false;
+            }
+            memset(image, 0, bytes);
+            pushCount = 0;
+
+            LOGI(::pip3D::Debug::LOG_MODULE_RENDER,
+                 "HeadlessDriver init OK: %dx%d", width, height);
+            return true;
+        }
+
+        void pushImage(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *buffer) override
+        {
+            ++pushCount;
+            if (!image || !buffer)
+                return;
+
+            const int16_t x0 = x < 0 ? 0 : x;
+            const int16_t x1 = x + w > width ? static_cast<int16_t>(width) : static_cast<int16_t>(x + w);
+            for (int16_t row = 0; row < h; ++row)
+            {
+                const int16_t py = static_cast<int16_t>(y + row);
+                if (py < 0 || py >= height)
+                    continue;
+                const uint16_t *src = buffer + static_cast<size_t>(row) * w + (x0 - x);
+                uint16_t *dst = image + static_cast<size_t>(py) * width;
+                for (int16_t px = x0; px < x1; ++px)
+                    dst[px] = PixelFormat::decode(*src++);
+            }
+        }
+
+        __attribute__((always_inline)) inline uint16_t getWidth() const override { return width; }
+        __attribute__((always_inline)) inline uint16_t getHeight() const override { return height; }
+
+        // Plain RGB565, width * height pixels, rows top to bottom.
+        const uint16_t *pixels() const { return image; }
+
+        // Transfers received since init(); a frame takes one per band.
+        uint32_t getPushCount() const { return pushCount; }
+
+        // CRC-32 of the image, for comparing renders between revisions.
+        uint32_t checksum() const
+        {
+            if (!image)
+                return 0;
+            return crc32Update(0, reinterpret_cast<const uint8_t *>(image),
+                               static_cast<size_t>(width) * height * sizeof(uint16_t));
+        }
+
+        // 8-bit RGB PNG, zlib stored blocks (no compression).
+        bool writePng(const char *path) const
+        {
+            if (!image || !path)
+                return false;
+
+            FILE *f = fopen(path, "wb");
+            if (!f)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "HeadlessDriver writePng: cannot open '%s'", path);
+                return false;
+            }
+
+            static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+            uint8_t ihdr[13];
+            putBE32(ihdr, width);
+            putBE32(ihdr + 4, height);
+            ihdr[8] = 8;  // bit depth
+            ihdr[9] = 2;  // RGB
+            ihdr[10] = 0; // deflate
+            ihdr[11] = 0; // adaptive filters
+            ihdr[12] = 0; // no interlace
+
+            // Each row is a filter byte followed by RGB; rows are packed into
+            // stored deflate blocks of at most 65535 bytes.
+            const size_t rowBytes = 1 + static_cast<size_t>(width) * 3;
+            const size_t rawBytes = rowBytes * height;
+            const size_t blockCount = rawBytes / 65535 + 1;
+            const size_t idatBytes = 2 + rawBytes + blockCount * 5 + 4;
+            uint8_t *idat = static_cast<uint8_t *>(MemUtils::allocData(idatBytes, 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+            uint8_t *raw = static_cast<uint8_t *>(MemUtils::allocData(rawBytes, 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+            bool ok = idat && raw;
+
+            if (ok)
+            {
+                uint8_t *p = raw;
+                for (uint16_t y = 0; y < height; ++y)
+                {
+                    *p++ = 0;
+                    const uint16_t *src = image + static_cast<size_t>(y) * width;
+                    for (uint16_t x = 0; x < width; ++x)
+                    {
+                        const uint16_t c = src[x];
+                        const uint8_t r = static_cast<uint8_t>((c >> 11) & 0x1F);
+                        const uint8_t g = static_cast<uint8_t>((c >> 5) & 0x3F);
+                        const uint8_t b = static_cast<uint8_t>(c & 0x1F);
+                        *p++ = static_cast<uint8_t>((r << 3) | (r >> 2));
+                        *p++ = static_cast<uint8_t>((g << 2) | (g >> 4));
+                        *p++ = static_cast<uint8_t>((b << 3) | (b >> 2));
+                    }
+                }
+
+                uint8_t *out = idat;
+                *out++ = 0x78;
+                *out++ = 0x01;
+                uint32_t s1 = 1, s2 = 0;
+                size_t done = 0;
+                for (size_t block = 0; block < blockCount; ++block)
+                {
+                    const size_t left = rawBytes - done;
+                    const uint16_t len = static_cast<uint16_t>(left < 65535 ? left : 65535);
+                    *out++ = block + 1 == blockCount ? 1 : 0;
+                    *out++ = static_cast<uint8_t>(len);
+                    *out++ = static_cast<uint8_t>(len >> 8);
+                    *out++ = static_cast<uint8_t>(~len);
+                    *out++ = static_cast<uint8_t>(~len >> 8);
+                    memcpy(out, raw + done, len);
+                    for (uint16_t i = 0; i < len; ++i)
+                    {
+                        s1 = (s1 + out[i]) % 65521;
+                        s2 = (s2 + s1) % 65521;
+                    }
+                    out += len;
+                    done += len;
+                }
+                putBE32(out, (s2 << 16) | s1);
+
+                ok = fwrite(SIGNATURE, 1, 8, f) == 8 &&
+                     writeChunk(f, "IHDR", ihdr, sizeof(ihdr)) &&
+                     writeChunk(f, "IDAT", idat, static_cast<uint32_t>(idatBytes)) &&
+                     writeChunk(f, "IEND", nullptr, 0);
+            }
+
+            MemUtils::freeData(raw);
+            MemUtils::freeData(idat);
+            if (fclose(f) != 0)
+                ok = false;
+            if (!ok)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "HeadlessDriver writePng: failed to write '%s'", path);
+            }
+            return ok;
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,490 @@
+#ifndef I80DRIVER_H
+#define I80DRIVER_H
+
+#include <Arduino.h>
+#include <esp_lcd_panel_io.h>
+#include <driver/gpio.h>
+#include <esp_heap_caps.h>
+#include <esp_idf_version.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "DisplayConfig.h"
+#include "DisplayDriverBase.h"
+#include "../SpanKernels.h"
+#include "../../../Core/Core.h"
+
+// Parallel 8080 bus on the ESP32-S3 LCD_CAM peripheral. Pins default to the
+// common 8-bit ILI9488 boards; the 16-bit bus also needs TFT_D8..TFT_D15.
+#ifndef PIP3D_I80_BUS_WIDTH
+#define PIP3D_I80_BUS_WIDTH 8
+#endif
+#ifndef PIP3D_I80_PCLK_HZ
+#define PIP3D_I80_PCLK_HZ 20000000
+#endif
+#ifndef PIP3D_I80_QUEUE_DEPTH
+#define PIP3D_I80_QUEUE_DEPTH 10
+#endif
+// Landscape, BGR, as the SPI ILI9488 path.
+#ifndef PIP3D_I80_MADCTL
+#define PIP3D_I80_MADCTL 0xE8
+#endif
+#ifndef PIP3D_I80_INVERT
+#define PIP3D_I80_INVERT 1
+#endif
+
+#ifndef TFT_WR
+#define TFT_WR 47
+#endif
+#ifndef TFT_D0
+#define TFT_D0 9
+#endif
+#ifndef TFT_D1
+#define TFT_D1 46
+#endif
+#ifndef TFT_D2
+#define TFT_D2 3
+#endif
+#ifndef TFT_D3
+#define TFT_D3 8
+#endif
+#ifndef TFT_D4
+#define TFT_D4 18
+#endif
+#ifndef TFT_D5
+#define TFT_D5 17
+#endif
+#ifndef TFT_D6
+#define TFT_D6 16
+#endif
+#ifndef TFT_D7
+#define TFT_D7 15
+#endif
+#ifndef TFT_D8
+#define TFT_D8 -1
+#endif
+#ifndef TFT_D9
+#define TFT_D9 -1
+#endif
+#ifndef TFT_D10
+#define TFT_D10 -1
+#endif
+#ifndef TFT_D11
+#define TFT_D11 -1
+#endif
+#ifndef TFT_D12
+#define TFT_D12 -1
+#endif
+#ifndef TFT_D13
+#define TFT_D13 -1
+#endif
+#ifndef TFT_D14
+#define TFT_D14 -1
+#endif
+#ifndef TFT_D15
+#define TFT_D15 -1
+#endif
+
+namespace pip3D
+{
+
+    static constexpr int I80_SWRESET = 0x01;
+    static constexpr int I80_SLPOUT = 0x11;
+    static constexpr int I80_INVON = 0x21;
+    static constexpr int I80_DISPON = 0x29;
+    static constexpr int I80_CASET = 0x2A;
+    static constexpr int I80_PASET = 0x2B;
+    static constexpr int I80_RAMWR = 0x2C;
+    static constexpr int I80_RAMWRC = 0x3C;
+    static constexpr int I80_MADCTL = 0x36;
+    static constexpr int I80_COLMOD = 0x3A;
+
+    // MIPI DCS panel (ILI9488, ST7789, ...) on the i80 bus in native RGB565.
+    // Pixels are DMA'd straight from the caller's buffer, so the band
+    // framebuffer goes out without conversion; the peripheral swaps bytes
+    // when the bus order differs from PixelFormat. Every transfer is
+    // queued: the completion ISR counts it done and wakes waitTransfer().
+    // LCD::freq above 40 MHz is an SPI setting; the bus then runs at
+    // PIP3D_I80_PCLK_HZ.
+    class alignas(16) I80Driver : public DisplayDriverBase
+    {
+    private:
+        esp_lcd_i80_bus_handle_t bus;
+        esp_lcd_panel_io_handle_t io;
+        SemaphoreHandle_t doneSignal;
+
+        int8_t rst_pin, bl_pin;
+        uint16_t width, height;
+
+        // Transfers are numbered as queued and finish in order.
+        uint32_t queued;
+        volatile uint32_t completed;
+
+        // Two widened rows for scaled flushes, each free once its last
+        // transfer has completed.
+        uint16_t *staging;
+        size_t stagingPixels;
+        uint32_t stagingTicket[2];
+
+        static bool IRAM_ATTR onColorDone(esp_lcd_panel_io_handle_t, esp_lcd_panel_io_event_data_t *, void *ctx)
+        {
+            I80Driver *self = static_cast<I80Driver *>(ctx);
+            self->completed = self->completed + 1;
+            BaseType_t woken = pdFALSE;
+            xSemaphoreGiveFromISR(self->doneSignal, &woken);
+            return woken == pdTRUE;
+        }
+
+        __attribute__((always_inline)) inline bool isDone(uint32_t ticket) const
+        {
+            return static_cast<int32_t>(completed - ticket) >= 0;
+        }
+
+        void waitFor(uint32_t ticket)
+        {
+            while (!isDone(ticket))
+                xSemaphoreTake(doneSignal, portMAX_DELAY);
+        }
+
+        __attribute__((always_inline)) inline void sendCmdData(int cmd, const uint8_t *data, size_t len)
+        {
+            esp_lcd_panel_io_tx_param(io, cmd, data, len);
+        }
+
+        // Queues color data; returns its ticket, or 0 when nothing was queued.
+        uint32_t queueColor(int cmd, const uint16_t *pixels, size_t count)
+        {
+            esp_err_t ret = esp_lcd_panel_io_tx_color(io, cmd, pixels, count * sizeof(uint16_t));
+            if (ret != ESP_OK)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "I80Driver: tx_color failed (err=%d)", (int)ret);
+                return 0;
+            }
+            return ++queued;
+        }
+
+        // tx_param waits for queued color transfers, so a new window never
+        // cuts into pixels still being sent.
+        void setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+        {
+            uint8_t data[4];
+
+            data[0] = x0 >> 8;
+            data[1] = x0 & 0xFF;
+            data[2] = x1 >> 8;
+            data[3] = x1 & 0xFF;
+            sendCmdData(I80_CASET, data, 4);
+
+            data[0] = y0 >> 8;
+            data[1] = y0 & 0xFF;
+            data[2] = y1 >> 8;
+            data[3] = y1 & 0xFF;
+            sendCmdData(I80_PASET, data, 4);
+        }
+
+        bool ensureStaging(size_t pixels)
+        {
+            if (staging && stagingPixels >= pixels)
+                return true;
+
+            waitTransfer();
+            if (staging)
+                heap_caps_free(staging);
+
+            const size_t bytes = pixels * 2 * sizeof(uint16_t);
+            staging = (uint16_t *)heap_caps_aligned_alloc(16, bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+            if (!staging)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "I80Driver: staging alloc failed (bytes=%u)",
+                     (unsigned int)bytes);
+                stagingPixels = 0;
+                return false;
+            }
+            stagingPixels = pixels;
+            return true;
+        }
+
+        void release()
+        {
+            if (io)
+            {
+                waitTransfer();
+                esp_lcd_panel_io_del(io);
+                io = nullptr;
+            }
+            if (bus)
+            {
+                esp_lcd_del_i80_bus(bus);
+                bus = nullptr;
+            }
+            if (doneSignal)
+            {
+                vSemaphoreDelete(doneSignal);
+                doneSignal = nullptr;
+            }
+            if (staging)
+            {
+                heap_caps_free(staging);
+                staging = nullptr;
+                stagingPixels = 0;
+            }
+        }
+
+    public:
+        I80Driver() : bus(nullptr), io(nullptr), doneSignal(nullptr), rst_pin(-1), bl_pin(-1),
+                      width(480), height(320), queued(0), completed(0),
+                      staging(nullptr), stagingPixels(0)
+        {
+            stagingTicket[0] = stagingTicket[1] = 0;
+        }
+
+        ~I80Driver()
+        {
+            release();
+        }
+
+        I80Driver(const I80Driver &) = delete;
+        I80Driver &operator=(const I80Driver &) = delete;
+
+        bool init(const LCD &config = LCD()) override
+        {
+            release();
+
+            width = config.w;
+            height = config.h;
+            rst_pin = config.rst;
+            bl_pin = config.bl;
+            queued = 0;
+            completed = 0;
+            stagingTicket[0] = stagingTicket[1] = 0;
+
+            doneSignal = xSemaphoreCreateBinary();
+            if (!doneSignal)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "I80Driver init: semaphore alloc failed");
+                return false;
+            }
+
+            if (rst_pin >= 0)
+            {
+                gpio_set_direction((gpio_num_t)rst_pin, GPIO_MODE_OUTPUT);
+                gpio_set_level((gpio_num_t)rst_pin, 1);
+            }
+
+            if (bl_pin >= 0)
+            {
+                gpio_set_direction((gpio_num_t)bl_pin, GPIO_MODE_OUTPUT);
+                gpio_set_level((gpio_num_t)bl_pin, 1);
+            }
+
+            static const int dataPins[16] = {TFT_D0, TFT_D1, TFT_D2, TFT_D3, TFT_D4, TFT_D5, TFT_D6, TFT_D7,
+                                             TFT_D8, TFT_D9, TFT_D10, TFT_D11, TFT_D12, TFT_D13, TFT_D14, TFT_D15};
+
+            esp_lcd_i80_bus_config_t busCfg = {};
+            busCfg.dc_gpio_num = config.dc;
+            busCfg.wr_gpio_num = TFT_WR;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+            busCfg.clk_src = LCD_CLK_SRC_DEFAULT;
+#endif
+            for (int i = 0; i < PIP3D_I80_BUS_WIDTH; ++i)
+                busCfg.data_gpio_nums[i] = dataPins[i];
+            busCfg.bus_width = PIP3D_I80_BUS_WIDTH;
+            busCfg.max_transfer_bytes = static_cast<size_t>(width) * height * sizeof(uint16_t);
+            busCfg.psram_trans_align = 64;
+            busCfg.sram_trans_align = 4;
+
+            esp_err_t ret = esp_lcd_new_i80_bus(&busCfg, &bus);
+            if (ret != ESP_OK)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "I80Driver init: bus create failed (err=%d)", (int)ret);
+                release();
+                return false;
+            }
+
+            const uint32_t pclk = (config.freq && config.freq <= 40000000) ? config.freq : PIP3D_I80_PCLK_HZ;
+
+            esp_lcd_panel_io_i80_config_t ioCfg = {};
+            ioCfg.cs_gpio_num = config.cs;
+            ioCfg.pclk_hz = pclk;
+            ioCfg.trans_queue_depth = PIP3D_I80_QUEUE_DEPTH;
+            ioCfg.on_color_trans_done = onColorDone;
+            ioCfg.user_ctx = this;
+            ioCfg.lcd_cmd_bits = 8;
+            ioCfg.lcd_param_bits = 8;
+            ioCfg.dc_levels.dc_idle_level = 0;
+            ioCfg.dc_levels.dc_cmd_level = 0;
+            ioCfg.dc_levels.dc_dummy_level = 0;
+            ioCfg.dc_levels.dc_data_level = 1;
+            // The panel takes the high byte first: an 8-bit bus sends memory
+            // order, a 16-bit bus sends whole native words.
+            ioCfg.flags.swap_color_bytes = (PIP3D_I80_BUS_WIDTH == 8) ? !PixelFormat::NATIVE_BE : PixelFormat::NATIVE_BE;
+
+            ret = esp_lcd_new_panel_io_i80(bus, &ioCfg, &io);
+            if (ret != ESP_OK)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "I80Driver init: panel io create failed (err=%d)", (int)ret);
+                release();
+                return false;
+            }
+
+            if (rst_pin >= 0)
+            {
+                gpio_set_level((gpio_num_t)rst_pin, 0);
+                delay(10);
+                gpio_set_level((gpio_num_t)rst_pin, 1);
+                delay(120);
+            }
+
+            sendCmdData(I80_SWRESET, nullptr, 0);
+            delay(150);
+
+            sendCmdData(I80_SLPOUT, nullptr, 0);
+            delay(120);
+
+            const uint8_t colmod = 0x55; // 16-bit over the parallel bus
+            sendCmdData(I80_COLMOD, &colmod, 1);
+
+            const uint8_t madctl = PIP3D_I80_MADCTL;
+            sendCmdData(I80_MADCTL, &madctl, 1);
+
+            if (PIP3D_I80_INVERT)
+                sendCmdData(I80_INVON, nullptr, 0);
+
+            sendCmdData(I80_DISPON, nullptr, 0);
+            delay(25);
+
+            LOGI(::pip3D::Debug::LOG_MODULE_RENDER,
+                 "I80Driver init OK: %dx%d, %d-bit @ %dMHz",
+                 width,
+                 height,
+                 PIP3D_I80_BUS_WIDTH,
+                 (int)(pclk / 1000000));
+
+            return true;
+        }
+
+        __attribute__((hot)) void pushImage(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *buffer) override
+        {
+            pushImageStrided(x, y, w, h, buffer, w);
+        }
+
+        // Rows go out one transfer each, continuing the same RAMWR, and the
+        // call returns once they are sent.
+        __attribute__((hot)) void pushImageStrided(int16_t x, int16_t y, int16_t w, int16_t h,
+                                                   uint16_t *buffer, int16_t stride) override
+        {
+            if (!io || !buffer || w <= 0 || h <= 0)
+                return;
+
+            if (x >= width || y >= height || x + w <= 0 || y + h <= 0)
+                return;
+
+            const int16_t x_start = (x < 0) ? 0 : x;
+            const int16_t y_start = (y < 0) ? 0 : y;
+            const int16_t x_end = (x + w > width) ? width : (x + w);
+            const int16_t y_end = (y + h > height) ? height : (y + h);
+            const uint16_t *src = buffer + static_cast<size_t>(y_start - y) * stride + (x_start - x);
+
+            w = x_end - x_start;
+            h = y_end - y_start;
+
+            setAddrWindow(x_start, y_start, x_end - 1, y_end - 1);
+
+            if (stride == w)
+            {
+                queueColor(I80_RAMWR, src, static_cast<size_t>(w) * h);
+            }
+            else
+            {
+                for (int16_t row = 0; row < h; row++)
+                    queueColor(row == 0 ? I80_RAMWR : I80_RAMWRC, src + static_cast<size_t>(row) * stride, w);
+            }
+
+            waitTransfer();
+        }
+
+        // Band flush: one DMA transfer straight out of the band, in flight
+        // until waitTransfer().
+        bool pushImageAsync(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *buffer) override
+        {
+            if (!io || !buffer || w <= 0 || h <= 0)
+                return false;
+
+            if (x < 0 || y < 0 || x + w > width || y + h > height)
+            {
+                // Clipped regions are not contiguous in the source buffer.
+                pushImage(x, y, w, h, buffer);
+                return false;
+            }
+
+            setAddrWindow(x, y, x + w - 1, y + h - 1);
+            return queueColor(I80_RAMWR, buffer, static_cast<size_t>(w) * h) != 0;
+        }
+
+        // Rows are widened into two staging rows, one converted while the
+        // other is on the bus; a repeated row is queued again from the same
+        // staging row. Only staging is read by DMA, so the call returns with
+        // the last rows still going out. Interlaced fields set a window per
+        // line.
+        __attribute__((hot)) void pushImageScaled(int16_t x, int16_t y, int16_t w, int16_t h,
+                                                  const uint16_t *buffer, int16_t stride,
+                                                  uint8_t scaleX, uint8_t rowRepeat, uint8_t rowPitch) override
+        {
+            if (!io || !buffer || w <= 0 || h <= 0)
+                return;
+
+            const int16_t outW = static_cast<int16_t>(w * scaleX);
+            const int32_t endLine = y + static_cast<int32_t>(h - 1) * rowPitch + rowRepeat;
+            if (x < 0 || y < 0 || x + outW > width || endLine > height || !ensureStaging(outW))
+            {
+                DisplayDriverBase::pushImageScaled(x, y, w, h, buffer, stride, scaleX, rowRepeat, rowPitch);
+                return;
+            }
+
+            uint16_t *rows[2] = {staging, staging + stagingPixels};
+            const bool perLine = rowPitch != rowRepeat;
+            if (!perLine)
+                setAddrWindow(x, y, x + outW - 1, y + h * rowPitch - 1);
+
+            int cmd = I80_RAMWR;
+            for (int16_t row = 0; row < h; row++)
+            {
+                const int b = row & 1;
+                waitFor(stagingTicket[b]);
+                SpanKernels::widen16(rows[b], buffer + static_cast<size_t>(row) * stride, static_cast<size_t>(w), scaleX);
+
+                if (perLine)
+                {
+                    const int16_t line = static_cast<int16_t>(y + row * rowPitch);
+                    setAddrWindow(x, line, x + outW - 1, line + rowRepeat - 1);
+                    cmd = I80_RAMWR;
+                }
+
+                for (uint8_t r = 0; r < rowRepeat; r++)
+                {
+                    const uint32_t ticket = queueColor(cmd, rows[b], outW);
+                    if (!ticket)
+                        return;
+                    stagingTicket[b] = ticket;
+                    cmd = I80_RAMWRC;
+                }
+            }
+        }
+
+        void waitTransfer() override
+        {
+            waitFor(queued);
+        }
+
+        __attribute__((always_inline)) inline uint16_t getWidth() const override { return width; }
+        __attribute__((always_inline)) inline uint16_t getHeight() const override { return height; }
+    };
+
+}
+
+#endif
@@ -127,8 +127,8 @@ namespace pip3D
 
             for (; i < n; i += 2)
             {
-                uint16_t c0 = src[i];
-                uint16_t c1 = src[i + 1];
+                uint16_t c0 = PixelFormat::decode(src[i]);
+                uint16_t c1 = PixelFormat::decode(src[i + 1]);
 
                 uint8_t r0 = (uint8_t)((c0 >> 8) & 0xF8);
                 uint8_t g0 = (uint8_t)((c0 >> 3) & 0xFC);
@@ -150,7 +150,7 @@ namespace pip3D
             // Tail pixel if count is odd
             if (i < count)
             {
-                uint16_t c = src[i];
+                uint16_t c = PixelFormat::decode(src[i]);
                 uint8_t r = (uint8_t)((c >> 8) & 0xF8);
                 uint8_t g = (uint8_t)((c >> 3) & 0xFC);
                 uint8_t b = (uint8_t)((c << 3) & 0xF8);
@@ -160,6 +160,25 @@ namespace pip3D
             }
         }
 
+        // convert565To666 with every pixel written twice.
+        static __attribute__((always_inline)) inline void convert565To666x2(const uint16_t *src, uint8_t *dst, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const uint16_t c = PixelFormat::decode(src[i]);
+                const uint8_t r = (uint8_t)((c >> 8) & 0xF8);
+                const uint8_t g = (uint8_t)((c >> 3) & 0xFC);
+                const uint8_t b = (uint8_t)((c << 3) & 0xF8);
+                dst[0] = r;
+                dst[1] = g;
+                dst[2] = b;
+                dst[3] = r;
+                dst[4] = g;
+                dst[5] = b;
+                dst += 6;
+            }
+        }
+
     public:
         ILI9488Driver() : spi_device(nullptr), cs_pin(-1), dc_pin(-1), rst_pin(-1), bl_pin(-1),
                           cs_mask(0), dc_mask(0), width(320), height(480), rotation(0),
@@ -328,6 +347,12 @@ namespace pip3D
         }
 
         __attribute__((hot)) void pushImage(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *buffer) override
+        {
+            pushImageStrided(x, y, w, h, buffer, w);
+        }
+
+        __attribute__((hot)) void pushImageStrided(int16_t x, int16_t y, int16_t w, int16_t h,
+                                                   uint16_t *buffer, int16_t stride) override
         {
             if (!buffer || w <= 0 || h <= 0)
                 return;
@@ -346,7 +371,7 @@ namespace pip3D
             if (w <= 0 || h <= 0)
                 return;
 
-            if (x_start == 0 && w == width)
+            if (x_start == 0 && w == width && stride == w)
             {
                 setAddrWindow(0, y_start, width - 1, y_end - 1);
 
@@ -475,7 +500,7 @@ namespace pip3D
 
             for (int16_t row = 0; row < h; row++)
             {
-                uint16_t *rowPtr = buffer + (size_t)row * (size_t)w;
+                uint16_t *rowPtr = buffer + (size_t)row * (size_t)stride;
 
                 convert565To666(rowPtr, swapBuffer, rowPixels);
 
@@ -489,6 +514,137 @@ namespace pip3D
             CS_HIGH();
         }
 
+        // Widening is folded into the 565 -> 666 conversion of each row, into
+        // two staging rows so one is sent while the next is converted; a
+        // repeated row is queued again from the same staging row. Interlaced
+        // fields skip lines and set a window per line.
+        __attribute__((hot)) void pushImageScaled(int16_t x, int16_t y, int16_t w, int16_t h,
+                                                  const uint16_t *buffer, int16_t stride,
+                                                  uint8_t scaleX, uint8_t rowRepeat, uint8_t rowPitch) override
+        {
+            if (!buffer || w <= 0 || h <= 0)
+                return;
+
+            const int16_t outW = static_cast<int16_t>(w * scaleX);
+            const int32_t endLine = y + static_cast<int32_t>(h - 1) * rowPitch + rowRepeat;
+            if (x < 0 || y < 0 || x + outW > width || endLine > height || rowRepeat > 2)
+            {
+                DisplayDriverBase::pushImageScaled(x, y, w, h, buffer, stride, scaleX, rowRepeat, rowPitch);
+                return;
+            }
+
+            const size_t rowBytes = static_cast<size_t>(outW) * 3;
+            const size_t requiredBytes = rowBytes * 2;
+            if (!swapBuffer || swapBufferBytes < requiredBytes)
+            {
+                if (swapBuffer)
+                    heap_caps_free(swapBuffer);
+
+                swapBuffer = (uint8_t *)heap_caps_aligned_alloc(16, requiredBytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+                if (!swapBuffer)
+                {
+                    LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                         "ILI9488Driver pushImageScaled: DMA buffer alloc failed (bytes=%u)",
+                         (unsigned int)requiredBytes);
+                    swapBufferBytes = 0;
+                    return;
+                }
+                swapBufferBytes = requiredBytes;
+            }
+
+            uint8_t *rows[2] = {swapBuffer, swapBuffer + rowBytes};
+
+            if (rowPitch != rowRepeat)
+            {
+                for (int16_t row = 0; row < h; row++)
+                {
+                    const int16_t line = static_cast<int16_t>(y + row * rowPitch);
+                    setAddrWindow(x, line, x + outW - 1, line + rowRepeat - 1);
+
+                    DC_HIGH();
+                    CS_LOW();
+
+                    const uint16_t *src = buffer + (size_t)row * stride;
+                    if (scaleX == 2)
+                        convert565To666x2(src, rows[0], (size_t)w);
+                    else
+                        convert565To666(src, rows[0], (size_t)w);
+
+                    for (uint8_t r = 0; r < rowRepeat; r++)
+                    {
+                        spi_transaction_t trans = {};
+                        trans.length = rowBytes * 8;
+                        trans.tx_buffer = rows[0];
+                        spi_device_polling_transmit(spi_device, &trans);
+                    }
+
+                    CS_HIGH();
+                }
+                return;
+            }
+
+            setAddrWindow(x, y, x + outW - 1, y + h * rowPitch - 1);
+
+            DC_HIGH();
+            CS_LOW();
+
+            spi_transaction_t trans[2][2];
+            memset(trans, 0, sizeof(trans));
+            int pending[2] = {0, 0};
+            int queued = 0;
+
+            for (int16_t row = 0; row < h; row++)
+            {
+                const int b = row & 1;
+                while (pending[b] > 0)
+                {
+                    spi_transaction_t *retTrans = nullptr;
+                    if (spi_device_get_trans_result(spi_device, &retTrans, portMAX_DELAY) != ESP_OK)
+                        continue;
+                    pending[(retTrans == &trans[0][0] || retTrans == &trans[0][1]) ? 0 : 1]--;
+                    queued--;
+                }
+
+                const uint16_t *src = buffer + (size_t)row * stride;
+                if (scaleX == 2)
+                    convert565To666x2(src, rows[b], (size_t)w);
+                else
+                    convert565To666(src, rows[b], (size_t)w);
+
+                bool failed = false;
+                for (uint8_t r = 0; r < rowRepeat; r++)
+                {
+                    spi_transaction_t &t = trans[b][r];
+                    t.length = rowBytes * 8;
+                    t.tx_buffer = rows[b];
+                    t.flags = 0;
+
+                    esp_err_t qret = spi_device_queue_trans(spi_device, &t, portMAX_DELAY);
+                    if (qret != ESP_OK)
+                    {
+                        LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                             "ILI9488Driver pushImageScaled: queue_trans failed (err=%d)",
+                             (int)qret);
+                        failed = true;
+                        break;
+                    }
+                    pending[b]++;
+                    queued++;
+                }
+                if (failed)
+                    break;
+            }
+
+            while (queued > 0)
+            {
+                spi_transaction_t *retTrans = nullptr;
+                if (spi_device_get_trans_result(spi_device, &retTrans, portMAX_DELAY) == ESP_OK)
+                    queued--;
+            }
+
+            CS_HIGH();
+        }
+
         __attribute__((always_inline)) inline uint16_t getWidth() const override { return width; }
         __attribute__((always_inline)) inline uint16_t getHeight() const override { return height; }
     };
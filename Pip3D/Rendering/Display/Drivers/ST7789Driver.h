@@ -10,6 +10,7 @@
 #include "../../../Core/Core.h"
 #include "DisplayConfig.h"
 #include "DisplayDriverBase.h"
+#include "../SpanKernels.h"
 
 #ifndef TFT_MOSI
 #define TFT_MOSI 7
@@ -315,6 +316,12 @@ namespace pip3D
 
         void setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
         {
+            // Polling transfers may not overlap a queued async transaction.
+            if (asyncInFlight)
+            {
+                waitDMA();
+            }
+
             uint8_t data[4];
 
             data[0] = x0 >> 8;
@@ -361,21 +368,7 @@ namespace pip3D
                     swapBufferSize = chunk;
                 }
 
-                uint32_t *src32 = (uint32_t *)src;
-                uint32_t *dst32 = (uint32_t *)swapBuffer;
-                size_t chunks32 = chunk / 2;
-
-                for (size_t i = 0; i < chunks32; i++)
-                {
-                    uint32_t val = src32[i];
-                    dst32[i] = ((val & 0x00FF00FF) << 8) | ((val & 0xFF00FF00) >> 8);
-                }
-
-                if (chunk & 1)
-                {
-                    uint16_t pixel = src[chunk - 1];
-                    swapBuffer[chunk - 1] = (pixel >> 8) | (pixel << 8);
-                }
+                SpanKernels::byteSwap(swapBuffer, src, chunk);
 
                 spi_transaction_t trans = {};
                 trans.length = chunk * 16;
@@ -479,18 +472,7 @@ namespace pip3D
                         swapBufferSize = totalPixels;
                     }
 
-                    uint32_t color32 = (swapped << 16) | swapped;
-                    uint32_t *buf32 = (uint32_t *)swapBuffer;
-                    uint32_t pixels32 = totalPixels / 2;
-
-                    for (uint32_t i = 0; i < pixels32; i++)
-                    {
-                        buf32[i] = color32;
-                    }
-                    if (totalPixels & 1)
-                    {
-                        swapBuffer[totalPixels - 1] = swapped;
-                    }
+                    SpanKernels::fill16(swapBuffer, swapped, totalPixels);
 
                     spi_transaction_t trans = {};
                     trans.length = totalPixels * 16;
@@ -520,94 +502,97 @@ namespace pip3D
             fillRect(0, 0, width, height, color);
         }
 
-        void pushImageAsync(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *buffer)
+        // The source is a tightly packed w x h region (e.g. one framebuffer
+        // band). With PIP3D_PIXEL_NATIVE_BE it is sent straight from the
+        // caller's DMA-capable buffer, which stays busy until waitTransfer();
+        // otherwise it is byte-swapped into the staging buffer and the caller
+        // may reuse it as soon as this returns.
+        bool pushImageAsync(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *buffer) override
         {
             if (!buffer || w <= 0 || h <= 0)
-                return;
+                return false;
 
             if (asyncInFlight)
             {
                 waitDMA();
             }
 
-            if (x >= width || y >= height || x + w <= 0 || y + h <= 0)
-                return;
-
-            int16_t x_start = (x < 0) ? 0 : x;
-            int16_t y_start = (y < 0) ? 0 : y;
-            int16_t x_end = (x + w > width) ? width : (x + w);
-            int16_t y_end = (y + h > height) ? height : (y + h);
-
-            w = x_end - x_start;
-            h = y_end - y_start;
-
-            if (w <= 0 || h <= 0)
-                return;
-
-            setAddrWindow(x_start, y_start, x_end - 1, y_end - 1);
+            if (x < 0 || y < 0 || x + w > width || y + h > height)
+            {
+                // Clipped regions are not contiguous in the source buffer.
+                pushImage(x, y, w, h, buffer);
+                return false;
+            }
 
             size_t totalPixels = (size_t)w * h;
+            const uint16_t *txSource = buffer;
 
-            if (!swapBuffer || swapBufferSize < totalPixels)
+            if (!PixelFormat::NATIVE_BE)
             {
-                if (asyncInFlight)
-                {
-                    waitDMA();
-                }
-
-                if (swapBuffer)
+                if (!swapBuffer || swapBufferSize < totalPixels)
                 {
-                    heap_caps_free(swapBuffer);
-                    swapBuffer = nullptr;
-                    swapBufferSize = 0;
-                }
+                    if (swapBuffer)
+                    {
+                        heap_caps_free(swapBuffer);
+                        swapBuffer = nullptr;
+                        swapBufferSize = 0;
+                    }
 
-                size_t bytes = totalPixels * sizeof(uint16_t);
-                swapBuffer = (uint16_t *)heap_caps_aligned_alloc(16, bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
-                if (!swapBuffer)
-                {
-                    return;
+                    size_t bytes = totalPixels * sizeof(uint16_t);
+                    swapBuffer = (uint16_t *)heap_caps_aligned_alloc(16, bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+                    if (!swapBuffer)
+                    {
+                        LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                             "ST7789Driver pushImageAsync: DMA buffer alloc failed (bytes=%u)",
+                             (unsigned int)bytes);
+                        return false;
+                    }
+                    swapBufferSize = totalPixels;
                 }
-                swapBufferSize = totalPixels;
-            }
 
-            uint32_t *src32 = (uint32_t *)(buffer + (size_t)y_start * width + x_start);
-            uint32_t *dst32 = (uint32_t *)swapBuffer;
-            size_t chunks32 = totalPixels / 2;
+                SpanKernels::byteSwap(swapBuffer, buffer, totalPixels);
 
-            for (size_t i = 0; i < chunks32; i++)
-            {
-                uint32_t val = src32[i];
-                dst32[i] = ((val & 0x00FF00FF) << 8) | ((val & 0xFF00FF00) >> 8);
+                txSource = swapBuffer;
             }
 
-            if (totalPixels & 1)
-            {
-                uint16_t pixel = buffer[(size_t)y_start * width + x_start + (totalPixels - 1)];
-                swapBuffer[totalPixels - 1] = (pixel >> 8) | (pixel << 8);
-            }
+            setAddrWindow(x, y, x + w - 1, y + h - 1);
 
             DC_HIGH();
             CS_LOW();
 
             memset(&asyncTrans, 0, sizeof(asyncTrans));
             asyncTrans.length = totalPixels * 16;
-            asyncTrans.tx_buffer = swapBuffer;
+            asyncTrans.tx_buffer = txSource;
             asyncTrans.flags = 0;
 
             esp_err_t qret = spi_device_queue_trans(spi_device, &asyncTrans, portMAX_DELAY);
             if (qret != ESP_OK)
             {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "ST7789Driver pushImageAsync: queue_trans failed (err=%d)",
+                     (int)qret);
                 CS_HIGH();
-                return;
+                return false;
             }
 
             asyncInFlight = true;
+            return PixelFormat::NATIVE_BE;
+        }
+
+        void waitTransfer() override
+        {
+            waitDMA();
         }
 
         __attribute__((hot)) void pushImage(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *buffer) override
         {
-            if (x == 0 && y == 0 && w == width && h == height)
+            pushImageStrided(x, y, w, h, buffer, w);
+        }
+
+        __attribute__((hot)) void pushImageStrided(int16_t x, int16_t y, int16_t w, int16_t h,
+                                                   uint16_t *buffer, int16_t stride) override
+        {
+            if (x == 0 && y == 0 && w == width && h == height && stride == w)
             {
                 setAddrWindow(0, 0, width - 1, height - 1);
 
@@ -619,7 +604,7 @@ namespace pip3D
                 const size_t halfBufferPixels = DMA_CHUNK_PIXELS;
                 const size_t requiredPixels = halfBufferPixels * 2;
 
-                if (!swapBuffer || swapBufferSize < requiredPixels)
+                if (!PixelFormat::NATIVE_BE && (!swapBuffer || swapBufferSize < requiredPixels))
                 {
                     if (swapBuffer)
                         heap_caps_free(swapBuffer);
@@ -674,25 +659,16 @@ namespace pip3D
                     size_t remaining = totalPixels - offsetPixels;
                     size_t chunkPixels = (remaining > halfBufferPixels) ? halfBufferPixels : remaining;
 
-                    uint32_t *src32 = (uint32_t *)(buffer + offsetPixels);
-                    uint32_t *dst32 = (uint32_t *)dmaBuf[bufIndex];
-                    size_t chunks32 = chunkPixels / 2;
-
-                    for (size_t i = 0; i < chunks32; i++)
+                    const uint16_t *txSource = buffer + offsetPixels;
+                    if (!PixelFormat::NATIVE_BE)
                     {
-                        uint32_t val = src32[i];
-                        dst32[i] = ((val & 0x00FF00FF) << 8) | ((val & 0xFF00FF00) >> 8);
-                    }
-
-                    if (chunkPixels & 1)
-                    {
-                        uint16_t pixel = buffer[offsetPixels + chunkPixels - 1];
-                        dmaBuf[bufIndex][chunkPixels - 1] = (pixel >> 8) | (pixel << 8);
+                        SpanKernels::byteSwap(dmaBuf[bufIndex], buffer + offsetPixels, chunkPixels);
+                        txSource = dmaBuf[bufIndex];
                     }
 
                     spi_transaction_t &t = trans[bufIndex];
                     t.length = chunkPixels * 16;
-                    t.tx_buffer = dmaBuf[bufIndex];
+                    t.tx_buffer = txSource;
                     t.flags = 0;
 
                     esp_err_t qret = spi_device_queue_trans(spi_device, &t, portMAX_DELAY);
@@ -748,13 +724,22 @@ namespace pip3D
 
             for (int16_t row = 0; row < h; row++)
             {
-                // In partial update mode, the source buffer is treated as a
-                // tightly packed rectangle of size w x h starting at (0, 0).
-                // Each row is contiguous and has exactly w pixels.
-                uint16_t *rowPtr = buffer + ((size_t)row * (size_t)w);
+                // In partial update mode each source row holds w pixels and
+                // starts stride pixels after the previous one.
+                uint16_t *rowPtr = buffer + ((size_t)row * (size_t)stride);
 
                 size_t rowPixels = (size_t)w;
 
+                if (PixelFormat::NATIVE_BE)
+                {
+                    spi_transaction_t trans = {};
+                    trans.length = w * 16;
+                    trans.tx_buffer = rowPtr;
+                    trans.flags = 0;
+                    spi_device_polling_transmit(spi_device, &trans);
+                    continue;
+                }
+
                 if (!swapBuffer || swapBufferSize < rowPixels)
                 {
                     if (swapBuffer)
@@ -768,27 +753,142 @@ namespace pip3D
                     swapBufferSize = rowPixels;
                 }
 
-                uint32_t *src32 = (uint32_t *)rowPtr;
-                uint32_t *dst32 = (uint32_t *)swapBuffer;
-                size_t chunks32 = rowPixels / 2;
+                SpanKernels::byteSwap(swapBuffer, rowPtr, rowPixels);
+
+                spi_transaction_t trans = {};
+                trans.length = w * 16;
+                trans.tx_buffer = swapBuffer;
+                trans.flags = 0;
+                spi_device_polling_transmit(spi_device, &trans);
+            }
+
+            CS_HIGH();
+        }
+
+        // Rows are widened (and byte-swapped) into two staging rows, so one
+        // is sent while the next is being built; a repeated row is queued
+        // again from the same staging row. Interlaced fields skip lines and
+        // set a window per line.
+        __attribute__((hot)) void pushImageScaled(int16_t x, int16_t y, int16_t w, int16_t h,
+                                                  const uint16_t *buffer, int16_t stride,
+                                                  uint8_t scaleX, uint8_t rowRepeat, uint8_t rowPitch) override
+        {
+            if (!buffer || w <= 0 || h <= 0)
+                return;
+
+            const int16_t outW = static_cast<int16_t>(w * scaleX);
+            const int32_t endLine = y + static_cast<int32_t>(h - 1) * rowPitch + rowRepeat;
+            if (x < 0 || y < 0 || x + outW > width || endLine > height || rowRepeat > 2)
+            {
+                DisplayDriverBase::pushImageScaled(x, y, w, h, buffer, stride, scaleX, rowRepeat, rowPitch);
+                return;
+            }
+
+            if (asyncInFlight)
+            {
+                waitDMA();
+            }
+
+            const size_t rowPixels = static_cast<size_t>(outW);
+            const size_t requiredPixels = rowPixels * 2;
+            if (!swapBuffer || swapBufferSize < requiredPixels)
+            {
+                if (swapBuffer)
+                    heap_caps_free(swapBuffer);
+
+                size_t bytes = requiredPixels * sizeof(uint16_t);
+                swapBuffer = (uint16_t *)heap_caps_aligned_alloc(16, bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+                if (!swapBuffer)
+                {
+                    LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                         "ST7789Driver pushImageScaled: DMA buffer alloc failed (bytes=%u)",
+                         (unsigned int)bytes);
+                    swapBufferSize = 0;
+                    return;
+                }
+                swapBufferSize = requiredPixels;
+            }
+
+            uint16_t *rows[2] = {swapBuffer, swapBuffer + rowPixels};
+            const bool swap = !PixelFormat::NATIVE_BE;
+
+            if (rowPitch != rowRepeat)
+            {
+                for (int16_t row = 0; row < h; row++)
+                {
+                    const int16_t line = static_cast<int16_t>(y + row * rowPitch);
+                    setAddrWindow(x, line, x + outW - 1, line + rowRepeat - 1);
+
+                    DC_HIGH();
+                    CS_LOW();
+
+                    SpanKernels::widen16(rows[0], buffer + (size_t)row * stride, (size_t)w, scaleX, swap);
+                    for (uint8_t r = 0; r < rowRepeat; r++)
+                    {
+                        spi_transaction_t trans = {};
+                        trans.length = rowPixels * 16;
+                        trans.tx_buffer = rows[0];
+                        spi_device_polling_transmit(spi_device, &trans);
+                    }
+
+                    CS_HIGH();
+                }
+                return;
+            }
+
+            setAddrWindow(x, y, x + outW - 1, y + h * rowPitch - 1);
+
+            DC_HIGH();
+            CS_LOW();
+
+            spi_transaction_t trans[2][2];
+            memset(trans, 0, sizeof(trans));
+            int pending[2] = {0, 0};
+            int queued = 0;
 
-                for (size_t i = 0; i < chunks32; i++)
+            for (int16_t row = 0; row < h; row++)
+            {
+                const int b = row & 1;
+                while (pending[b] > 0)
                 {
-                    uint32_t val = src32[i];
-                    dst32[i] = ((val & 0x00FF00FF) << 8) | ((val & 0xFF00FF00) >> 8);
+                    spi_transaction_t *retTrans = nullptr;
+                    if (spi_device_get_trans_result(spi_device, &retTrans, portMAX_DELAY) != ESP_OK)
+                        continue;
+                    pending[(retTrans == &trans[0][0] || retTrans == &trans[0][1]) ? 0 : 1]--;
+                    queued--;
                 }
 
-                if (rowPixels & 1)
+                SpanKernels::widen16(rows[b], buffer + (size_t)row * stride, (size_t)w, scaleX, swap);
+
+                bool failed = false;
+                for (uint8_t r = 0; r < rowRepeat; r++)
                 {
-                    uint16_t pixel = rowPtr[rowPixels - 1];
-                    swapBuffer[rowPixels - 1] = (pixel >> 8) | (pixel << 8);
+                    spi_transaction_t &t = trans[b][r];
+                    t.length = rowPixels * 16;
+                    t.tx_buffer = rows[b];
+                    t.flags = 0;
+
+                    esp_err_t qret = spi_device_queue_trans(spi_device, &t, portMAX_DELAY);
+                    if (qret != ESP_OK)
+                    {
+                        LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                             "ST7789Driver pushImageScaled: queue_trans failed (err=%d)",
+                             (int)qret);
+                        failed = true;
+                        break;
+                    }
+                    pending[b]++;
+                    queued++;
                 }
+                if (failed)
+                    break;
+            }
 
-                spi_transaction_t trans = {};
-                trans.length = w * 16;
-                trans.tx_buffer = swapBuffer;
-                trans.flags = 0;
-                spi_device_polling_transmit(spi_device, &trans);
+            while (queued > 0)
+            {
+                spi_transaction_t *retTrans = nullptr;
+                if (spi_device_get_trans_result(spi_device, &retTrans, portMAX_DELAY) == ESP_OK)
+                    queued--;
             }
 
             CS_HIGH();
@@ -11,6 +11,10 @@ namespace pip3D
     {
     private:
         uint16_t *buffer;
+        uint16_t *backBuffer;
+        size_t bufferBytes;
+        // Buffer still being read by an asynchronous display transfer.
+        const uint16_t *pendingBuffer;
         DisplayDriverBase *display;
         DisplayConfig config;
         Skybox skybox;
@@ -20,8 +24,8 @@ namespace pip3D
         static constexpr size_t DMA_ALIGNMENT = 64;
 
         uint32_t totalPixels;
-        uint32_t pixels32;
-        bool oddPixels;
+        // Rows allocated; config.height is the height of the current band.
+        uint16_t capacityRows;
         
         uint16_t *skyboxColorCache;
         int16_t cachedScreenHeight;
@@ -29,10 +33,32 @@ namespace pip3D
         
         uint16_t colorLUT[2];
 
+        // Interlaced field being drawn: panel line parity of render rows.
+        uint8_t field;
+
+        // Sends a render-space rect; reduced render resolutions are widened
+        // to panel pixels by the driver during the transfer.
+        __attribute__((always_inline)) inline void pushRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                                                            uint16_t *src, int16_t stride)
+        {
+            if (RENDER_SCALE_X == 1 && RENDER_SCALE_Y == 1)
+            {
+                display->pushImageStrided(x, y, w, h, src, stride);
+                return;
+            }
+            display->pushImageScaled(static_cast<int16_t>(x * RENDER_SCALE_X),
+                                     static_cast<int16_t>(y * RENDER_SCALE_Y + (RENDER_INTERLACED ? field : 0)),
+                                     w, h, src, stride,
+                                     RENDER_SCALE_X,
+                                     RENDER_INTERLACED ? 1 : RENDER_SCALE_Y,
+                                     RENDER_SCALE_Y);
+        }
+
     public:
-        FrameBuffer() : buffer(nullptr), display(nullptr), useSkybox(true),
-                        clearColor(Color::BLACK), totalPixels(0), pixels32(0), oddPixels(false),
-                        skyboxColorCache(nullptr), cachedScreenHeight(0), cacheValid(false)
+        FrameBuffer() : buffer(nullptr), backBuffer(nullptr), bufferBytes(0), pendingBuffer(nullptr),
+                        display(nullptr), useSkybox(true),
+                        clearColor(Color::BLACK), totalPixels(0), capacityRows(0),
+                        skyboxColorCache(nullptr), cachedScreenHeight(0), cacheValid(false), field(0)
         {
             skybox.setPreset(SKYBOX_DAY);
             colorLUT[0] = colorLUT[1] = 0;
@@ -51,8 +77,6 @@ namespace pip3D
             display = disp;
 
             totalPixels = static_cast<uint32_t>(config.width) * static_cast<uint32_t>(config.height);
-            pixels32 = totalPixels >> 1;
-            oddPixels = (totalPixels & 1u) != 0;
 
             size_t bufferSize = totalPixels * sizeof(uint16_t);
             bufferSize = (bufferSize + DMA_ALIGNMENT - 1) & ~(DMA_ALIGNMENT - 1);
@@ -71,6 +95,8 @@ namespace pip3D
             }
             
             memset(buffer, 0, bufferSize);
+            bufferBytes = bufferSize;
+            capacityRows = config.height;
             
             skyboxColorCache = (uint16_t *)heap_caps_malloc(SCREEN_HEIGHT * 2 * sizeof(uint16_t), 
                                                             MALLOC_CAP_INTERNAL);
@@ -88,6 +114,67 @@ namespace pip3D
             return true;
         }
 
+        // Second band buffer of the same size, used when a band is rendered
+        // on the other core while this one is being finished or flushed.
+        bool initBackBuffer()
+        {
+            if (backBuffer)
+                return true;
+
+            if (!buffer)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "FrameBuffer::initBackBuffer called before init");
+                return false;
+            }
+
+            backBuffer = (uint16_t *)heap_caps_aligned_alloc(DMA_ALIGNMENT, bufferBytes,
+                                                             MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+            if (!backBuffer)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "FrameBuffer::initBackBuffer failed: could not allocate %u bytes",
+                     static_cast<unsigned int>(bufferBytes));
+                return false;
+            }
+
+            memset(backBuffer, 0, bufferBytes);
+            return true;
+        }
+
+        void releaseBackBuffer()
+        {
+            if (backBuffer)
+            {
+                waitTransfer(backBuffer);
+                heap_caps_free(backBuffer);
+                backBuffer = nullptr;
+            }
+        }
+
+        __attribute__((always_inline)) inline bool hasBackBuffer() const { return backBuffer != nullptr; }
+        __attribute__((always_inline)) inline uint16_t *getBackBuffer() { return backBuffer; }
+
+        __attribute__((always_inline)) inline void swapBuffers()
+        {
+            if (!backBuffer)
+                return;
+            uint16_t *tmp = buffer;
+            buffer = backBuffer;
+            backBuffer = tmp;
+        }
+
+        // Blocks until no display transfer reads from buf (nullptr: any buffer).
+        __attribute__((always_inline)) inline void waitTransfer(const uint16_t *buf = nullptr)
+        {
+            if (pendingBuffer && (!buf || buf == pendingBuffer))
+            {
+                if (display)
+                    display->waitTransfer();
+                pendingBuffer = nullptr;
+            }
+        }
+
         void beginFrame()
         {
             if (unlikely(!buffer))
@@ -96,6 +183,7 @@ namespace pip3D
                      "FrameBuffer::beginFrame called with null buffer");
                 return;
             }
+            waitTransfer(buffer);
         }
 
     private:
@@ -119,50 +207,61 @@ namespace pip3D
                             (b ? b - 1 : 0);
                 }
                 
-                skyboxColorCache[y * 2] = color1;
-                skyboxColorCache[y * 2 + 1] = darker;
+                skyboxColorCache[y * 2] = PixelFormat::encode(color1);
+                skyboxColorCache[y * 2 + 1] = PixelFormat::encode(darker);
             }
             
             cachedScreenHeight = SCREEN_HEIGHT;
             cacheValid = true;
         }
         
-        __attribute__((always_inline)) inline void fastClear()
+        // Columns [x0, x1) of a row that hold no geometry: the colorLUT
+        // pattern in 32-bit pairs, or a plain fill when both entries match.
+        __attribute__((always_inline)) inline void fillSkyRun(uint16_t *__restrict__ row, uint16_t x0, uint16_t x1)
         {
-            const uint16_t clearCol = clearColor.rgb565;
-            const uint32_t clearColor32 = (clearCol << 16) | clearCol;
-            uint32_t *fb32 = (uint32_t *)buffer;
-
-            uint32_t i = 0;
-            const uint32_t blocks8 = pixels32 >> 3;
-            const uint32_t limit8 = blocks8 << 3;
-            
-            for (; i < limit8; i += 8)
-            {
-                fb32[i] = clearColor32;
-                fb32[i + 1] = clearColor32;
-                fb32[i + 2] = clearColor32;
-                fb32[i + 3] = clearColor32;
-                fb32[i + 4] = clearColor32;
-                fb32[i + 5] = clearColor32;
-                fb32[i + 6] = clearColor32;
-                fb32[i + 7] = clearColor32;
-            }
-            
-            for (; i < pixels32; i++)
+            if (x0 >= x1)
+                return;
+            if (colorLUT[0] == colorLUT[1])
             {
-                fb32[i] = clearColor32;
+                SpanKernels::fill16(row + x0, colorLUT[0], x1 - x0);
+                return;
             }
 
-            if (oddPixels)
+            uint16_t x = x0;
+            if (x & 1u)
+                row[x++] = colorLUT[1];
+            if (reinterpret_cast<uintptr_t>(row + x) & 3u)
             {
-                buffer[totalPixels - 1] = clearCol;
+                for (; x < x1; ++x)
+                    row[x] = colorLUT[x & 1u];
+                return;
             }
+
+            uint32_t pair;
+            memcpy(&pair, colorLUT, sizeof(pair));
+            uint32_t *__restrict__ dst = reinterpret_cast<uint32_t *>(row + x);
+            const uint16_t pairs = static_cast<uint16_t>((x1 - x) >> 1);
+            for (uint16_t i = 0; i < pairs; ++i)
+                dst[i] = pair;
+            x = static_cast<uint16_t>(x + pairs * 2);
+            if (x < x1)
+                row[x] = colorLUT[0];
+        }
+
+        __attribute__((always_inline)) inline void fastClear()
+        {
+            const uint16_t clearCol = PixelFormat::encode(clearColor.rgb565);
+            SpanKernels::fill16(buffer, clearCol, static_cast<size_t>(config.width) * config.height);
         }
 
     public:
+        // Fills band rows [rowBegin, rowEnd) where nothing was drawn. Rows
+        // and row ends the z-buffer's coverage extents exclude are filled
+        // without reading depth; only the extents are tested per pixel.
         template <uint16_t WIDTH, uint16_t HEIGHT>
-        __attribute__((always_inline)) inline void drawSkyboxWhereEmpty(const ZBuffer<WIDTH, HEIGHT> &zbuf)
+        __attribute__((always_inline)) inline void drawSkyboxWhereEmpty(const ZBuffer<WIDTH, HEIGHT> &zbuf,
+                                                                        uint16_t rowBegin = 0,
+                                                                        uint16_t rowEnd = HEIGHT)
         {
             if (unlikely(!buffer))
             {
@@ -171,7 +270,8 @@ namespace pip3D
                 return;
             }
 
-            const int16_t *__restrict__ zb = zbuf.getBufferPtr();
+            typedef typename ZBuffer<WIDTH, HEIGHT>::Depth Depth;
+            const Depth *__restrict__ zb = zbuf.getBufferPtr();
             if (unlikely(!zb))
             {
                 LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
@@ -182,7 +282,7 @@ namespace pip3D
             const uint16_t fbWidth = config.width;
             const uint16_t fbHeight = config.height;
 
-            if (unlikely(fbWidth != WIDTH || fbHeight != HEIGHT))
+            if (unlikely(fbWidth != WIDTH || fbHeight > HEIGHT))
             {
                 LOGW(::pip3D::Debug::LOG_MODULE_RENDER,
                      "FrameBuffer::drawSkyboxWhereEmpty size mismatch (fb=%ux%u, zb=%ux%u)",
@@ -193,8 +293,8 @@ namespace pip3D
                 return;
             }
 
-            const int16_t clearDepth = ZBuffer<WIDTH, HEIGHT>::clearDepthValue();
-            const int16_t invShadowMask = ~ZBuffer<WIDTH, HEIGHT>::shadowFlagMask();
+            const Depth clearDepth = ZBuffer<WIDTH, HEIGHT>::clearDepthValue();
+            const Depth invShadowMask = static_cast<Depth>(~ZBuffer<WIDTH, HEIGHT>::shadowFlagMask());
 
             const bool shouldUseSkybox = useSkybox && skybox.enabled;
             
@@ -203,14 +303,17 @@ namespace pip3D
                 rebuildSkyboxCache();
             }
 
-            const uint16_t baseClearColor = clearColor.rgb565;
+            const uint16_t baseClearColor = PixelFormat::encode(clearColor.rgb565);
+
+            if (rowEnd > fbHeight)
+                rowEnd = fbHeight;
 
-            for (uint16_t y = 0; y < fbHeight; ++y)
+            for (uint16_t y = rowBegin; y < rowEnd; ++y)
             {
                 const int16_t globalY = currentBandOffsetY() + static_cast<int16_t>(y);
 
                 uint16_t *__restrict__ row = buffer + (static_cast<size_t>(y) * fbWidth);
-                const int16_t *__restrict__ zbRow = zb + (static_cast<size_t>(y) * WIDTH);
+                const Depth *__restrict__ zbRow = zb + (static_cast<size_t>(y) * WIDTH);
 
                 if (shouldUseSkybox && skyboxColorCache && cacheValid && globalY < SCREEN_HEIGHT)
                 {
@@ -236,37 +339,45 @@ namespace pip3D
                     }
                     
                     const uint16_t yOdd = y & 1;
-                    colorLUT[0] = color1;
-                    colorLUT[1] = yOdd ? darker : color1;
+                    colorLUT[0] = PixelFormat::encode(color1);
+                    colorLUT[1] = PixelFormat::encode(yOdd ? darker : color1);
                 }
                 else
                 {
                     colorLUT[0] = colorLUT[1] = baseClearColor;
                 }
 
-                uint16_t x = 0;
-                const uint16_t width16 = fbWidth & ~15u;
+                uint16_t coverBegin, coverEnd;
+                if (!zbuf.rowCoverage(y, coverBegin, coverEnd))
+                {
+                    fillSkyRun(row, 0, fbWidth);
+                    continue;
+                }
+                fillSkyRun(row, 0, coverBegin);
+                fillSkyRun(row, coverEnd, fbWidth);
 
-                for (; x < width16; x += 16)
+                // Only the written range can hold geometry.
+                uint16_t x = coverBegin;
+                for (; x + 16 <= coverEnd; x += 16)
                 {
                     __builtin_prefetch(&zbRow[x + 16], 0, 0);
                     
-                    const int16_t d0 = zbRow[x] & invShadowMask;
-                    const int16_t d1 = zbRow[x + 1] & invShadowMask;
-                    const int16_t d2 = zbRow[x + 2] & invShadowMask;
-                    const int16_t d3 = zbRow[x + 3] & invShadowMask;
-                    const int16_t d4 = zbRow[x + 4] & invShadowMask;
-                    const int16_t d5 = zbRow[x + 5] & invShadowMask;
-                    const int16_t d6 = zbRow[x + 6] & invShadowMask;
-                    const int16_t d7 = zbRow[x + 7] & invShadowMask;
-                    const int16_t d8 = zbRow[x + 8] & invShadowMask;
-                    const int16_t d9 = zbRow[x + 9] & invShadowMask;
-                    const int16_t d10 = zbRow[x + 10] & invShadowMask;
-                    const int16_t d11 = zbRow[x + 11] & invShadowMask;
-                    const int16_t d12 = zbRow[x + 12] & invShadowMask;
-                    const int16_t d13 = zbRow[x + 13] & invShadowMask;
-                    const int16_t d14 = zbRow[x + 14] & invShadowMask;
-                    const int16_t d15 = zbRow[x + 15] & invShadowMask;
+                    const Depth d0 = zbRow[x] & invShadowMask;
+                    const Depth d1 = zbRow[x + 1] & invShadowMask;
+                    const Depth d2 = zbRow[x + 2] & invShadowMask;
+                    const Depth d3 = zbRow[x + 3] & invShadowMask;
+                    const Depth d4 = zbRow[x + 4] & invShadowMask;
+                    const Depth d5 = zbRow[x + 5] & invShadowMask;
+                    const Depth d6 = zbRow[x + 6] & invShadowMask;
+                    const Depth d7 = zbRow[x + 7] & invShadowMask;
+                    const Depth d8 = zbRow[x + 8] & invShadowMask;
+                    const Depth d9 = zbRow[x + 9] & invShadowMask;
+                    const Depth d10 = zbRow[x + 10] & invShadowMask;
+                    const Depth d11 = zbRow[x + 11] & invShadowMask;
+                    const Depth d12 = zbRow[x + 12] & invShadowMask;
+                    const Depth d13 = zbRow[x + 13] & invShadowMask;
+                    const Depth d14 = zbRow[x + 14] & invShadowMask;
+                    const Depth d15 = zbRow[x + 15] & invShadowMask;
 
                     if (d0 == clearDepth) row[x] = colorLUT[x & 1u];
                     if (d1 == clearDepth) row[x + 1] = colorLUT[(x + 1) & 1u];
@@ -286,9 +397,9 @@ namespace pip3D
                     if (d15 == clearDepth) row[x + 15] = colorLUT[(x + 15) & 1u];
                 }
 
-                for (; x < fbWidth; ++x)
+                for (; x < coverEnd; ++x)
                 {
-                    const int16_t depthNoShadow = zbRow[x] & invShadowMask;
+                    const Depth depthNoShadow = zbRow[x] & invShadowMask;
                     if (depthNoShadow == clearDepth)
                     {
                         row[x] = colorLUT[x & 1u];
@@ -307,7 +418,8 @@ namespace pip3D
                      (void *)display);
                 return;
             }
-            display->pushImage(0, 0, config.width, config.height, buffer);
+            waitTransfer();
+            pushRect(0, 0, config.width, config.height, buffer, static_cast<int16_t>(config.width));
         }
 
         __attribute__((always_inline)) inline void endFrameRegion(int16_t x, int16_t y, int16_t w, int16_t h)
@@ -320,13 +432,67 @@ namespace pip3D
                      (void *)display);
                 return;
             }
-            display->pushImage(x, y, w, h, buffer);
+            waitTransfer();
+            pushRect(x, y, w, h, buffer, w);
         }
 
+        // Sends a rect of the current band; y is in screen space and the rect
+        // must lie inside the band.
+        __attribute__((always_inline)) inline void endFrameRect(int16_t x, int16_t y, int16_t w, int16_t h)
+        {
+            if (unlikely(!buffer || !display))
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "FrameBuffer::endFrameRect called with invalid state (buffer=%p, display=%p)",
+                     (void *)buffer,
+                     (void *)display);
+                return;
+            }
+            waitTransfer();
+            const int16_t localY = static_cast<int16_t>(y - currentBandOffsetY());
+            uint16_t *src = buffer + static_cast<size_t>(localY) * config.width + x;
+            pushRect(x, y, w, h, src, static_cast<int16_t>(config.width));
+        }
+
+        // Queues the band for transfer and returns; overlap rendering by
+        // swapping to the back buffer before drawing the next band.
+        __attribute__((always_inline)) inline void endFrameRegionAsync(int16_t x, int16_t y, int16_t w, int16_t h)
+        {
+            if (unlikely(!buffer || !display))
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "FrameBuffer::endFrameRegionAsync called with invalid state (buffer=%p, display=%p)",
+                     (void *)buffer,
+                     (void *)display);
+                return;
+            }
+            waitTransfer();
+            if (RENDER_SCALE_X != 1 || RENDER_SCALE_Y != 1)
+            {
+                // Widened rows are staged by the driver; nothing stays in flight.
+                pushRect(x, y, w, h, buffer, w);
+                return;
+            }
+            if (display->pushImageAsync(x, y, w, h, buffer))
+            {
+                pendingBuffer = buffer;
+            }
+        }
+
+        __attribute__((always_inline)) inline void setField(uint8_t value) { field = value & 1u; }
+        __attribute__((always_inline)) inline uint8_t getField() const { return field; }
+
         __attribute__((always_inline)) inline uint16_t *getBuffer() { return buffer; }
         __attribute__((always_inline)) inline const uint16_t *getBuffer() const { return buffer; }
         __attribute__((always_inline)) inline const DisplayConfig &getConfig() const { return config; }
 
+        // Height of the band drawn next, at most the rows allocated in init().
+        __attribute__((always_inline)) inline void setBandRows(uint16_t rows)
+        {
+            config.height = rows < capacityRows ? rows : capacityRows;
+        }
+        __attribute__((always_inline)) inline uint16_t getCapacityRows() const { return capacityRows; }
+
         __attribute__((always_inline)) inline void setSkyboxEnabled(bool enabled) 
         { 
             if (useSkybox != enabled)
@@ -342,6 +508,18 @@ namespace pip3D
             cacheValid = false;
         }
         
+        // Sets custom gradient stops; the row cache is only rebuilt when a
+        // stop actually changed. Returns true if it did.
+        bool setSkyboxColors(Color top, Color horizon, Color ground)
+        {
+            if (skybox.type == SKYBOX_CUSTOM && skybox.top.rgb565 == top.rgb565 &&
+                skybox.horizon.rgb565 == horizon.rgb565 && skybox.ground.rgb565 == ground.rgb565)
+                return false;
+            skybox.setCustom(top, horizon, ground);
+            cacheValid = false;
+            return true;
+        }
+
         __attribute__((always_inline)) inline void setClearColor(Color color) { clearColor = color; }
 
         __attribute__((always_inline)) inline Skybox &getSkybox() { return skybox; }
@@ -355,6 +533,7 @@ namespace pip3D
                 heap_caps_free(buffer);
                 buffer = nullptr;
             }
+            releaseBackBuffer();
             if (skyboxColorCache)
             {
                 heap_caps_free(skyboxColorCache);
@@ -0,0 +1,171 @@
+#ifndef HIZBUFFER_H
+#define HIZBUFFER_H
+
+#include "../../Core/Core.h"
+#include "ZBuffer.h"
+
+#ifndef PIP3D_HIZ_TILE_SIZE
+#define PIP3D_HIZ_TILE_SIZE 8
+#endif
+
+// Margin in raw depth units for interpolation drift in the rasterizer.
+#ifndef PIP3D_HIZ_DEPTH_BIAS
+#define PIP3D_HIZ_DEPTH_BIAS 8
+#endif
+
+namespace pip3D
+{
+
+    // Coarse max-depth grid over a ZBuffer. A tile's value is never nearer
+    // than the farthest pixel under it: drawing only lowers depths, so a tile
+    // left stale is still conservative until it is rebuilt on the next query.
+    template <uint16_t WIDTH, uint16_t HEIGHT>
+    class HiZBuffer
+    {
+    public:
+        static constexpr uint16_t TILE_SIZE = PIP3D_HIZ_TILE_SIZE;
+        static constexpr uint16_t TILES_X = (WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+        static constexpr uint16_t TILES_Y = (HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+
+    private:
+        static constexpr size_t TILE_COUNT = static_cast<size_t>(TILES_X) * TILES_Y;
+
+        int16_t maxDepth[TILE_COUNT];
+        uint8_t dirty[TILE_COUNT];
+        bool anyDirty;
+
+        typedef ZBuffer<WIDTH, HEIGHT> DepthBuffer;
+        typedef typename DepthBuffer::Depth Depth;
+
+        // Tiles hold raw depth; the stored format is ordered, so the
+        // farthest stored value decodes to the farthest raw depth.
+        void rebuildTile(uint16_t tx, uint16_t ty, const DepthBuffer &zb)
+        {
+            const Depth *buf = zb.getBufferPtr();
+            const size_t tile = static_cast<size_t>(ty) * TILES_X + tx;
+            dirty[tile] = 0;
+            if (!buf)
+            {
+                maxDepth[tile] = static_cast<int16_t>(DepthBuffer::decodeDepth(DepthBuffer::clearDepthValue()));
+                return;
+            }
+
+            const Depth depthMask = static_cast<Depth>(~DepthBuffer::shadowFlagMask());
+            const uint16_t x0 = tx * TILE_SIZE;
+            const uint16_t y0 = ty * TILE_SIZE;
+            const uint16_t x1 = (x0 + TILE_SIZE < WIDTH) ? x0 + TILE_SIZE : WIDTH;
+            const uint16_t y1 = (y0 + TILE_SIZE < HEIGHT) ? y0 + TILE_SIZE : HEIGHT;
+
+            Depth m = 0;
+            for (uint16_t y = y0; y < y1; ++y)
+            {
+                const Depth *row = buf + static_cast<size_t>(y) * WIDTH;
+                for (uint16_t x = x0; x < x1; ++x)
+                {
+                    const Depth d = static_cast<Depth>(row[x] & depthMask);
+                    if (d > m)
+                        m = d;
+                }
+            }
+            maxDepth[tile] = static_cast<int16_t>(DepthBuffer::decodeDepth(m));
+        }
+
+    public:
+        HiZBuffer()
+        {
+            clear();
+        }
+
+        HiZBuffer(const HiZBuffer &) = delete;
+        HiZBuffer &operator=(const HiZBuffer &) = delete;
+
+        void clear()
+        {
+            const int16_t clearDepth = static_cast<int16_t>(DepthBuffer::decodeDepth(DepthBuffer::clearDepthValue()));
+            for (size_t i = 0; i < TILE_COUNT; ++i)
+            {
+                maxDepth[i] = clearDepth;
+                dirty[i] = 0;
+            }
+            anyDirty = false;
+        }
+
+        // Flags tiles under a pixel rect (inclusive, in ZBuffer coordinates)
+        // for rebuild after geometry was drawn there.
+        void markDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
+        {
+            if (x1 < 0 || y1 < 0 || x0 >= (int16_t)WIDTH || y0 >= (int16_t)HEIGHT)
+                return;
+            if (x0 < 0)
+                x0 = 0;
+            if (y0 < 0)
+                y0 = 0;
+            if (x1 >= (int16_t)WIDTH)
+                x1 = WIDTH - 1;
+            if (y1 >= (int16_t)HEIGHT)
+                y1 = HEIGHT - 1;
+
+            for (int16_t ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ++ty)
+            {
+                uint8_t *row = dirty + static_cast<size_t>(ty) * TILES_X;
+                for (int16_t tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; ++tx)
+                    row[tx] = 1;
+            }
+            anyDirty = true;
+        }
+
+        void markAllDirty()
+        {
+            for (size_t i = 0; i < TILE_COUNT; ++i)
+                dirty[i] = 1;
+            anyDirty = true;
+        }
+
+        // True when every tile under the rect already holds geometry at or
+        // nearer than depth (raw ZBuffer units), so nothing in the rect could
+        // pass the depth test.
+        bool isOccluded(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                        int32_t depth,
+                        const DepthBuffer &zb)
+        {
+            if (x1 < 0 || y1 < 0 || x0 >= (int16_t)WIDTH || y0 >= (int16_t)HEIGHT)
+                return false;
+            if (x0 < 0)
+                x0 = 0;
+            if (y0 < 0)
+                y0 = 0;
+            if (x1 >= (int16_t)WIDTH)
+                x1 = WIDTH - 1;
+            if (y1 >= (int16_t)HEIGHT)
+                y1 = HEIGHT - 1;
+
+            const int32_t testDepth = depth - PIP3D_HIZ_DEPTH_BIAS;
+
+            for (int16_t ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ++ty)
+            {
+                for (int16_t tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; ++tx)
+                {
+                    const size_t tile = static_cast<size_t>(ty) * TILES_X + tx;
+                    if (maxDepth[tile] <= testDepth)
+                        continue;
+                    if (anyDirty && dirty[tile])
+                    {
+                        rebuildTile(tx, ty, zb);
+                        if (maxDepth[tile] <= testDepth)
+                            continue;
+                    }
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        __attribute__((always_inline)) inline int16_t tileDepth(uint16_t tx, uint16_t ty) const
+        {
+            return maxDepth[static_cast<size_t>(ty) * TILES_X + tx];
+        }
+    };
+
+}
+
+#endif
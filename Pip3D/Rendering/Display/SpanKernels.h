@@ -0,0 +1,298 @@
+#ifndef SPANKERNELS_H
+#define SPANKERNELS_H
+
+#include "../../Core/Core.h"
+
+// 128-bit PIE kernels on the ESP32-S3, portable 32-bit code elsewhere.
+// Define PIP3D_SPAN_PIE=0 to force the portable path on the S3.
+#ifndef PIP3D_SPAN_PIE
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+#define PIP3D_SPAN_PIE 1
+#else
+#define PIP3D_SPAN_PIE 0
+#endif
+#endif
+
+namespace pip3D
+{
+
+    // Inner loops shared by the frame and depth buffers. Vector paths work
+    // on 16-byte aligned blocks (the FrameBuffer DMA alignment and the
+    // MemUtils::allocData default), heads and tails go through scalar code.
+    // Every PIE block loads, computes and stores inside one asm statement,
+    // so no q register state lives across C code.
+    class SpanKernels
+    {
+    private:
+        static constexpr int16_t DEPTH_MASK = 0x7FFF;
+
+        __attribute__((always_inline)) static inline bool aligned16(const void *p)
+        {
+            return (reinterpret_cast<uintptr_t>(p) & 15u) == 0;
+        }
+
+        __attribute__((always_inline)) static inline void depthPixel(int16_t *__restrict__ zb, uint16_t *__restrict__ fb,
+                                                                     int16_t d, uint16_t color)
+        {
+            const int16_t stored = *zb;
+            if (d < static_cast<int16_t>(stored & DEPTH_MASK))
+            {
+                *zb = static_cast<int16_t>((stored & ~DEPTH_MASK) | d);
+                *fb = color;
+            }
+        }
+
+    public:
+        // Fills count 16-bit values, used for color and depth clears.
+        __attribute__((hot)) static void fill16(uint16_t *__restrict__ dst, uint16_t value, size_t count)
+        {
+            while (count && (reinterpret_cast<uintptr_t>(dst) & 15u))
+            {
+                *dst++ = value;
+                --count;
+            }
+
+#if PIP3D_SPAN_PIE
+            const uint16_t v = value;
+            const uint16_t *vp = &v;
+            size_t blocks = count >> 5;
+            count &= 31;
+            while (blocks--)
+            {
+                asm volatile(
+                    "ee.vldbc.16 q0, %1\n"
+                    "ee.vst.128.ip q0, %0, 16\n"
+                    "ee.vst.128.ip q0, %0, 16\n"
+                    "ee.vst.128.ip q0, %0, 16\n"
+                    "ee.vst.128.ip q0, %0, 16\n"
+                    : "+r"(dst)
+                    : "r"(vp)
+                    : "memory");
+            }
+#else
+            const uint32_t v32 = (static_cast<uint32_t>(value) << 16) | value;
+            uint32_t *__restrict__ d32 = reinterpret_cast<uint32_t *>(dst);
+            size_t blocks = count >> 4;
+            count &= 15;
+            while (blocks--)
+            {
+                d32[0] = v32;
+                d32[1] = v32;
+                d32[2] = v32;
+                d32[3] = v32;
+                d32[4] = v32;
+                d32[5] = v32;
+                d32[6] = v32;
+                d32[7] = v32;
+                d32 += 8;
+            }
+            dst = reinterpret_cast<uint16_t *>(d32);
+#endif
+
+            while (count--)
+                *dst++ = value;
+        }
+
+        // Flat depth-tested span: raw depth with FRAC_BITS fractional bits
+        // steps across count pixels; passing pixels get color and keep their
+        // shadow bit. Vector path compares and writes 8 pixels at a time.
+        template <int FRAC_BITS = 0>
+        __attribute__((hot)) static void IRAM_ATTR depthSpan(int16_t *__restrict__ zb, uint16_t *__restrict__ fb, size_t count,
+                                                             int32_t depth, int32_t step, uint16_t color)
+        {
+#if PIP3D_SPAN_PIE
+            if (((reinterpret_cast<uintptr_t>(zb) ^ reinterpret_cast<uintptr_t>(fb)) & 15u) == 0)
+            {
+                while (count && !aligned16(zb))
+                {
+                    depthPixel(zb++, fb++, static_cast<int16_t>(depth >> FRAC_BITS), color);
+                    depth += step;
+                    --count;
+                }
+
+                alignas(16) int16_t lanes[8];
+                const int16_t mask = DEPTH_MASK;
+                const int16_t *maskp = &mask;
+                const uint16_t *colorp = &color;
+
+                while (count >= 8)
+                {
+                    for (int i = 0; i < 8; ++i)
+                    {
+                        lanes[i] = static_cast<int16_t>(depth >> FRAC_BITS);
+                        depth += step;
+                    }
+
+                    const int16_t *lp = lanes;
+                    asm volatile(
+                        "ee.vld.128.ip q0, %2, 0\n"  // q0 = new depth
+                        "ee.vld.128.ip q1, %0, 0\n"  // q1 = stored depth
+                        "ee.vldbc.16 q2, %3\n"       // q2 = 0x7FFF
+                        "ee.andq q3, q1, q2\n"       // q3 = stored & 0x7FFF
+                        "ee.vcmp.lt.s16 q4, q0, q3\n" // q4 = pass mask
+                        "ee.notq q5, q2\n"
+                        "ee.andq q5, q1, q5\n"       // shadow bits
+                        "ee.orq q5, q5, q0\n"
+                        "ee.andq q5, q5, q4\n"
+                        "ee.notq q6, q4\n"
+                        "ee.andq q1, q1, q6\n"
+                        "ee.orq q1, q1, q5\n"
+                        "ee.vst.128.ip q1, %0, 16\n"
+                        "ee.vld.128.ip q3, %1, 0\n"
+                        "ee.andq q3, q3, q6\n"
+                        "ee.vldbc.16 q7, %4\n"
+                        "ee.andq q7, q7, q4\n"
+                        "ee.orq q3, q3, q7\n"
+                        "ee.vst.128.ip q3, %1, 16\n"
+                        : "+r"(zb), "+r"(fb), "+r"(lp)
+                        : "r"(maskp), "r"(colorp)
+                        : "memory");
+                    count -= 8;
+                }
+            }
+#endif
+            while (count >= 4)
+            {
+                depthPixel(zb, fb, static_cast<int16_t>(depth >> FRAC_BITS), color);
+                depth += step;
+                depthPixel(zb + 1, fb + 1, static_cast<int16_t>(depth >> FRAC_BITS), color);
+                depth += step;
+                depthPixel(zb + 2, fb + 2, static_cast<int16_t>(depth >> FRAC_BITS), color);
+                depth += step;
+                depthPixel(zb + 3, fb + 3, static_cast<int16_t>(depth >> FRAC_BITS), color);
+                depth += step;
+                zb += 4;
+                fb += 4;
+                count -= 4;
+            }
+
+            while (count--)
+            {
+                depthPixel(zb++, fb++, static_cast<int16_t>(depth >> FRAC_BITS), color);
+                depth += step;
+            }
+        }
+
+        // Color::blend over a span of framebuffer pixels; the foreground
+        // terms are computed once per span.
+        __attribute__((hot)) static void blendSpan(uint16_t *__restrict__ fb, size_t count, uint16_t color, uint8_t alpha)
+        {
+            if (alpha == 0)
+                return;
+            if (alpha == 255)
+            {
+                fill16(fb, PixelFormat::encode(color), count);
+                return;
+            }
+
+            const uint32_t ia = 255u - alpha;
+            const uint32_t rbFg = (color & 0xF81Fu) * alpha;
+            const uint32_t gFg = (color & 0x07E0u) * alpha;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const uint32_t bg = PixelFormat::decode(fb[i]);
+                const uint32_t rb = (((bg & 0xF81Fu) * ia + rbFg) >> 8) & 0xF81Fu;
+                const uint32_t g = (((bg & 0x07E0u) * ia + gFg) >> 8) & 0x07E0u;
+                fb[i] = PixelFormat::encode(static_cast<uint16_t>(rb | g));
+            }
+        }
+
+        // RGB565 byte swap for SPI panels; src and dst may alias.
+        __attribute__((hot)) static void byteSwap(uint16_t *dst, const uint16_t *src, size_t count)
+        {
+            while (count && (reinterpret_cast<uintptr_t>(dst) & 3u))
+            {
+                const uint16_t p = *src++;
+                *dst++ = static_cast<uint16_t>((p >> 8) | (p << 8));
+                --count;
+            }
+
+#if PIP3D_SPAN_PIE
+            if (aligned16(dst) && aligned16(src))
+            {
+                static const uint32_t lowBytes = 0x00FF00FFu;
+                const uint32_t *mp = &lowBytes;
+                size_t blocks = count >> 3;
+                count &= 7;
+                while (blocks--)
+                {
+                    asm volatile(
+                        "ssai 8\n"
+                        "ee.vld.128.ip q0, %1, 16\n"
+                        "ee.vldbc.32 q1, %2\n"
+                        "ee.andq q2, q0, q1\n"
+                        "ee.vsl.32 q2, q2\n"  // (v & 0x00FF00FF) << 8
+                        "ee.vsr.32 q3, q0\n"
+                        "ee.andq q3, q3, q1\n" // (v >> 8) & 0x00FF00FF
+                        "ee.orq q2, q2, q3\n"
+                        "ee.vst.128.ip q2, %0, 16\n"
+                        : "+r"(dst), "+r"(src)
+                        : "r"(mp)
+                        : "memory");
+                }
+            }
+#endif
+            if ((reinterpret_cast<uintptr_t>(src) & 3u) == 0)
+            {
+                const uint32_t *s32 = reinterpret_cast<const uint32_t *>(src);
+                uint32_t *d32 = reinterpret_cast<uint32_t *>(dst);
+                const size_t pairs = count >> 1;
+                for (size_t i = 0; i < pairs; ++i)
+                {
+                    const uint32_t v = s32[i];
+                    d32[i] = ((v & 0x00FF00FFu) << 8) | ((v & 0xFF00FF00u) >> 8);
+                }
+                src += pairs << 1;
+                dst += pairs << 1;
+                count &= 1;
+            }
+
+            while (count--)
+            {
+                const uint16_t p = *src++;
+                *dst++ = static_cast<uint16_t>((p >> 8) | (p << 8));
+            }
+        }
+
+        // Repeats each of count pixels scale (1 or 2) times; with swap the
+        // bytes are swapped on the way, as byteSwap() does.
+        __attribute__((hot)) static void widen16(uint16_t *dst, const uint16_t *src, size_t count,
+                                                 uint8_t scale, bool swap = false)
+        {
+            if (scale == 1)
+            {
+                if (swap)
+                    byteSwap(dst, src, count);
+                else
+                    memcpy(dst, src, count * sizeof(uint16_t));
+                return;
+            }
+
+            if ((reinterpret_cast<uintptr_t>(dst) & 3u) == 0)
+            {
+                uint32_t *d32 = reinterpret_cast<uint32_t *>(dst);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    uint32_t p = src[i];
+                    if (swap)
+                        p = ((p >> 8) | (p << 8)) & 0xFFFFu;
+                    d32[i] = p | (p << 16);
+                }
+                return;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint16_t p = src[i];
+                if (swap)
+                    p = static_cast<uint16_t>((p >> 8) | (p << 8));
+                dst[2 * i] = p;
+                dst[2 * i + 1] = p;
+            }
+        }
+    };
+
+}
+
+#endif
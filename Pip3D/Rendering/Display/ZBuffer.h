@@ -4,6 +4,21 @@
 #include <Arduino.h>
 #include "../../Core/Core.h"
 #include "../../Core/Debug/Logging.h"
+#include "SpanKernels.h"
+
+// Depth storage of the band z-buffers:
+//   PIP3D_DEPTH_16           int16 linear depth, shadow flag in the top bit
+//   PIP3D_DEPTH_16_REVERSED  int16, reversed depth through a square root,
+//                            shadow flag in the top bit
+//   PIP3D_DEPTH_8_LOG        uint8 logarithmic depth plus a 1-bit shadow
+//                            plane, 1.125 bytes per pixel
+#define PIP3D_DEPTH_16 0
+#define PIP3D_DEPTH_16_REVERSED 1
+#define PIP3D_DEPTH_8_LOG 2
+
+#ifndef PIP3D_DEPTH_FORMAT
+#define PIP3D_DEPTH_FORMAT PIP3D_DEPTH_16
+#endif
 
 namespace pip3D
 {
@@ -14,19 +29,147 @@ namespace pip3D
         {3.0f / 16.0f, 11.0f / 16.0f, 1.0f / 16.0f, 9.0f / 16.0f},
         {15.0f / 16.0f, 7.0f / 16.0f, 13.0f / 16.0f, 5.0f / 16.0f}};
 
-    template <uint16_t WIDTH, uint16_t HEIGHT>
+    // Depth formats map raw depth (z * 32767, near 0) to the stored value
+    // and back. encode() keeps the order, so nearer is still smaller, and
+    // decode() returns the far end of a stored value's bucket so coarse
+    // formats stay conservative for occlusion tests.
+    struct DepthFormat16
+    {
+        typedef int16_t Depth;
+        static constexpr bool LINEAR = true;
+        static constexpr bool SHADOW_PLANE = false;
+        static constexpr bool PREFER_INTERNAL = false;
+        static constexpr Depth CLEAR = static_cast<int16_t>(0x7F7F);
+        static constexpr Depth SHADOW_FLAG = static_cast<int16_t>(0x8000);
+
+        __attribute__((always_inline)) static inline Depth encode(int32_t raw)
+        {
+            return static_cast<int16_t>(raw);
+        }
+
+        __attribute__((always_inline)) static inline int32_t decode(Depth d)
+        {
+            return d;
+        }
+    };
+
+    // Perspective depth bunches up near the far plane. Storing the reversed
+    // value (1 - z) through a square root spends the codes there instead,
+    // which is what a reversed-Z float buffer gets from its exponent.
+    struct DepthFormat16Reversed
+    {
+        typedef int16_t Depth;
+        static constexpr bool LINEAR = false;
+        static constexpr bool SHADOW_PLANE = false;
+        static constexpr bool PREFER_INTERNAL = false;
+        static constexpr Depth CLEAR = static_cast<int16_t>(0x7F7F);
+        static constexpr Depth SHADOW_FLAG = static_cast<int16_t>(0x8000);
+
+        __attribute__((always_inline)) static inline Depth encode(int32_t raw)
+        {
+            const int32_t c = 32767 - (raw < 0 ? 0 : (raw > 32767 ? 32767 : raw));
+            int32_t s = static_cast<int32_t>(sqrtf(static_cast<float>(c) * 32767.0f));
+            if (s > 32767)
+                s = 32767;
+            return static_cast<int16_t>(32767 - s);
+        }
+
+        __attribute__((always_inline)) static inline int32_t decode(Depth d)
+        {
+            if (d >= CLEAR)
+                return 32767;
+            const uint32_t s = static_cast<uint32_t>(32767 - d);
+            return 32767 - static_cast<int32_t>((s * s) / 32767u);
+        }
+    };
+
+    // 4.4 log2 of the reversed depth in 8 bits: 16 steps per octave, so far
+    // geometry keeps its ordering while the near half of the range shares
+    // 16 codes. Enough for low-poly scenes, and small enough to keep the
+    // band buffers in internal SRAM.
+    struct DepthFormat8Log
+    {
+        typedef uint8_t Depth;
+        static constexpr bool LINEAR = false;
+        static constexpr bool SHADOW_PLANE = true;
+        static constexpr bool PREFER_INTERNAL = true;
+        static constexpr Depth CLEAR = 0xFF;
+        static constexpr Depth SHADOW_FLAG = 0;
+
+        __attribute__((always_inline)) static inline Depth encode(int32_t raw)
+        {
+            const uint32_t c = static_cast<uint32_t>(32767 - (raw < 0 ? 0 : (raw > 32767 ? 32767 : raw)));
+            if (!c)
+                return 240;
+            const int msb = 31 - __builtin_clz(c);
+            const uint32_t mant = (msb >= 4 ? (c >> (msb - 4)) : (c << (4 - msb))) & 15u;
+            return static_cast<uint8_t>(240 - (msb * 16 + mant + 1));
+        }
+
+        __attribute__((always_inline)) static inline int32_t decode(Depth d)
+        {
+            if (d >= 240)
+                return 32767;
+            const uint32_t code = 239u - d;
+            const int msb = static_cast<int>(code >> 4);
+            const uint32_t m = 16u + (code & 15u);
+            const uint32_t c = msb >= 4 ? (m << (msb - 4)) : (m >> (4 - msb));
+            return 32767 - static_cast<int32_t>(c);
+        }
+    };
+
+#if PIP3D_DEPTH_FORMAT == PIP3D_DEPTH_8_LOG
+    typedef DepthFormat8Log DefaultDepthFormat;
+#elif PIP3D_DEPTH_FORMAT == PIP3D_DEPTH_16_REVERSED
+    typedef DepthFormat16Reversed DefaultDepthFormat;
+#else
+    typedef DepthFormat16 DefaultDepthFormat;
+#endif
+
+    template <uint16_t WIDTH, uint16_t HEIGHT, typename Format = DefaultDepthFormat>
     class ZBuffer
     {
+    public:
+        typedef typename Format::Depth Depth;
+
+        static constexpr size_t BUFFER_SIZE = static_cast<size_t>(WIDTH) * HEIGHT;
+        static constexpr size_t SHADOW_PLANE_BYTES = Format::SHADOW_PLANE ? (BUFFER_SIZE + 7) / 8 : 0;
+        // Depth and shadow plane share one block; snapshots copy all of it.
+        static constexpr size_t STORAGE_BYTES = BUFFER_SIZE * sizeof(Depth) + SHADOW_PLANE_BYTES;
+
     private:
-        static constexpr size_t BUFFER_SIZE = WIDTH * HEIGHT;
-        int16_t *buffer;
+        Depth *buffer;
+        uint8_t *shadowBits;
+        // Per row, the x range depth was written to since clear(), a
+        // superset of the covered pixels; coverMin > coverMax when none was.
+        int16_t coverMin[HEIGHT];
+        int16_t coverMax[HEIGHT];
         static constexpr int16_t MAX_DEPTH = 32767;
-        static constexpr int16_t CLEAR_DEPTH = static_cast<int16_t>(0x7F7F);
-        static constexpr int16_t SHADOW_FLAG = static_cast<int16_t>(0x8000);
+        static constexpr Depth CLEAR_DEPTH = Format::CLEAR;
+        static constexpr Depth SHADOW_FLAG = Format::SHADOW_FLAG;
+        static constexpr Depth DEPTH_MASK = static_cast<Depth>(~Format::SHADOW_FLAG);
         static constexpr float INV_MAX_DEPTH = 1.0f / static_cast<float>(MAX_DEPTH);
 
+        __attribute__((always_inline)) inline bool shadowAt(size_t index) const
+        {
+            if (Format::SHADOW_PLANE)
+                return (shadowBits[index >> 3] >> (index & 7)) & 1u;
+            return (buffer[index] & SHADOW_FLAG) != 0;
+        }
+
+        __attribute__((always_inline)) inline void setShadowAt(size_t index)
+        {
+            if (Format::SHADOW_PLANE)
+                shadowBits[index >> 3] |= static_cast<uint8_t>(1u << (index & 7));
+            else
+                buffer[index] = static_cast<Depth>(buffer[index] | SHADOW_FLAG);
+        }
+
     public:
-        ZBuffer() : buffer(nullptr) {}
+        ZBuffer() : buffer(nullptr), shadowBits(nullptr)
+        {
+            resetCoverage(WIDTH, -1);
+        }
         ZBuffer(const ZBuffer &) = delete;
         ZBuffer &operator=(const ZBuffer &) = delete;
 
@@ -36,38 +179,99 @@ namespace pip3D
             {
                 ::pip3D::MemUtils::freeData(buffer);
                 buffer = nullptr;
+                shadowBits = nullptr;
             }
 
-            buffer = static_cast<int16_t *>(::pip3D::MemUtils::allocData(BUFFER_SIZE * sizeof(int16_t)));
+            void *block = Format::PREFER_INTERNAL ? ::pip3D::MemUtils::allocFast(STORAGE_BYTES, 16, ::pip3D::Debug::LOG_MODULE_RENDER)
+                                                  : ::pip3D::MemUtils::allocData(STORAGE_BYTES, 16, ::pip3D::Debug::LOG_MODULE_RENDER);
+            buffer = static_cast<Depth *>(block);
 
             if (!buffer)
             {
                 LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
                      "ZBuffer::init failed: could not allocate %u bytes for %ux%u buffer",
-                     static_cast<unsigned int>(BUFFER_SIZE * sizeof(int16_t)),
+                     static_cast<unsigned int>(STORAGE_BYTES),
                      static_cast<unsigned int>(WIDTH),
                      static_cast<unsigned int>(HEIGHT));
                 return false;
             }
+            if (Format::SHADOW_PLANE)
+                shadowBits = static_cast<uint8_t *>(block) + BUFFER_SIZE * sizeof(Depth);
 
             clear();
 
             LOGI(::pip3D::Debug::LOG_MODULE_RENDER,
-                 "ZBuffer::init OK: %ux%u (buffer=%p)",
+                 "ZBuffer::init OK: %ux%u, %u bytes (buffer=%p)",
                  static_cast<unsigned int>(WIDTH),
                  static_cast<unsigned int>(HEIGHT),
+                 static_cast<unsigned int>(STORAGE_BYTES),
                  static_cast<void *>(buffer));
             return true;
         }
 
-        void clear()
+        // Clears rows [0, rows); a band shorter than HEIGHT uses no others.
+        void clear(uint16_t rows = HEIGHT)
         {
-            if (buffer)
+            if (!buffer)
+                return;
+            if (rows > HEIGHT)
+                rows = HEIGHT;
+            const size_t count = static_cast<size_t>(WIDTH) * rows;
+            if (sizeof(Depth) == 2)
+                SpanKernels::fill16(reinterpret_cast<uint16_t *>(buffer), static_cast<uint16_t>(CLEAR_DEPTH), count);
+            else
+                memset(buffer, CLEAR_DEPTH, count);
+            if (shadowBits)
+                memset(shadowBits, 0, Format::SHADOW_PLANE ? (count + 7) / 8 : 0);
+            resetCoverage(WIDTH, -1, rows);
+        }
+
+        // Whole-buffer snapshots for the retained backdrop, STORAGE_BYTES each.
+        void copyTo(void *dst) const
+        {
+            if (buffer && dst)
+                memcpy(dst, buffer, STORAGE_BYTES);
+        }
+
+        // Snapshots carry no row extents, so every row counts as covered.
+        void copyFrom(const void *src)
+        {
+            if (buffer && src)
             {
-                memset(buffer, 0x7F, BUFFER_SIZE * sizeof(int16_t));
+                memcpy(buffer, src, STORAGE_BYTES);
+                resetCoverage(0, WIDTH - 1);
             }
         }
 
+        // Writers through the unchecked ...At() calls report each span here;
+        // testAndSet() and testAndSetScanline() do it themselves.
+        __attribute__((always_inline)) inline void noteSpanAt(size_t index, uint16_t count)
+        {
+            const uint16_t y = static_cast<uint16_t>(index / WIDTH);
+            const int16_t x0 = static_cast<int16_t>(index - static_cast<size_t>(y) * WIDTH);
+            const int16_t x1 = static_cast<int16_t>(x0 + count - 1);
+            if (x0 < coverMin[y])
+                coverMin[y] = x0;
+            if (x1 > coverMax[y])
+                coverMax[y] = x1;
+        }
+
+        // Columns [begin, end) of row y that may hold geometry; false when
+        // nothing was written to the row.
+        __attribute__((always_inline)) inline bool rowCoverage(uint16_t y, uint16_t &begin, uint16_t &end) const
+        {
+            if (coverMin[y] > coverMax[y])
+                return false;
+            begin = static_cast<uint16_t>(coverMin[y]);
+            end = static_cast<uint16_t>(coverMax[y] + 1);
+            return true;
+        }
+
+        // Depth is raw (z * MAX_DEPTH) with FRAC_BITS fractional bits; the
+        // fixed-point rasterizer passes FIXED_DEPTH_BITS, everything else 0.
+        static constexpr int FIXED_DEPTH_BITS = 12;
+
+        template <int FRAC_BITS = 0>
         __attribute__((always_inline, hot)) inline bool testAndSet(uint16_t x, uint16_t y, int32_t depth)
         {
             if (unlikely(x >= WIDTH || y >= HEIGHT))
@@ -80,20 +284,52 @@ namespace pip3D
                      static_cast<unsigned int>(HEIGHT));
                 return false;
             }
+            const size_t index = static_cast<size_t>(y) * WIDTH + x;
+            noteSpanAt(index, 1);
+            return testAndSetAt<FRAC_BITS>(index, depth);
+        }
 
-            const int16_t d = static_cast<int16_t>(depth);
-            int16_t *__restrict__ row = buffer + static_cast<size_t>(y) * WIDTH;
-            const int16_t stored = row[x];
-            const int16_t currentDepth = static_cast<int16_t>(stored & ~SHADOW_FLAG);
-
-            if (d < currentDepth)
+        // Unchecked variants for rasterizers that clip at triangle setup.
+        template <int FRAC_BITS = 0>
+        __attribute__((always_inline, hot)) inline bool testAndSetAt(size_t index, int32_t depth)
+        {
+            const Depth d = Format::encode(depth >> FRAC_BITS);
+            const Depth stored = buffer[index];
+            if (d < static_cast<Depth>(stored & DEPTH_MASK))
             {
-                row[x] = static_cast<int16_t>((stored & SHADOW_FLAG) | d);
+                buffer[index] = static_cast<Depth>((stored & SHADOW_FLAG) | d);
                 return true;
             }
             return false;
         }
 
+        template <int FRAC_BITS = 0>
+        __attribute__((always_inline, hot)) inline bool testAt(size_t index, int32_t depth) const
+        {
+            return Format::encode(depth >> FRAC_BITS) < static_cast<Depth>(buffer[index] & DEPTH_MASK);
+        }
+
+        template <int FRAC_BITS = 0>
+        __attribute__((always_inline, hot)) inline void writeAt(size_t index, int32_t depth)
+        {
+            buffer[index] = static_cast<Depth>((buffer[index] & SHADOW_FLAG) | Format::encode(depth >> FRAC_BITS));
+        }
+
+        // Shadow receiver test at a buffer index: flags the pixel and
+        // returns true when it holds geometry, is not shadowed yet and the
+        // caster depth (raw units) is not behind it.
+        __attribute__((always_inline, hot)) inline bool shadowPixel(size_t index, int32_t depth)
+        {
+            const Depth stored = buffer[index];
+            const Depth current = static_cast<Depth>(stored & DEPTH_MASK);
+            if (current == CLEAR_DEPTH || shadowAt(index))
+                return false;
+            if (Format::encode(depth) > current)
+                return false;
+            setShadowAt(index);
+            return true;
+        }
+
         __attribute__((always_inline)) inline bool hasGeometry(uint16_t x, uint16_t y) const
         {
             if (unlikely(x >= WIDTH || y >= HEIGHT || !buffer))
@@ -108,9 +344,8 @@ namespace pip3D
                 return false;
             }
 
-            const int16_t *row = buffer + static_cast<size_t>(y) * WIDTH;
-            const int16_t d = row[x];
-            return (d & ~SHADOW_FLAG) != CLEAR_DEPTH;
+            const Depth *row = buffer + static_cast<size_t>(y) * WIDTH;
+            return static_cast<Depth>(row[x] & DEPTH_MASK) != CLEAR_DEPTH;
         }
 
         __attribute__((always_inline)) inline bool hasShadow(uint16_t x, uint16_t y) const
@@ -127,9 +362,7 @@ namespace pip3D
                 return false;
             }
 
-            const int16_t *row = buffer + static_cast<size_t>(y) * WIDTH;
-            const int16_t d = row[x];
-            return (d & SHADOW_FLAG) != 0;
+            return shadowAt(static_cast<size_t>(y) * WIDTH + x);
         }
 
         __attribute__((always_inline)) inline float getDepth01(uint16_t x, uint16_t y) const
@@ -139,46 +372,51 @@ namespace pip3D
                 return 1.0f;
             }
 
-            const int16_t *row = buffer + static_cast<size_t>(y) * WIDTH;
-            const int16_t stored = row[x];
-            const int16_t d = static_cast<int16_t>(stored & ~SHADOW_FLAG);
+            const Depth *row = buffer + static_cast<size_t>(y) * WIDTH;
+            const Depth d = static_cast<Depth>(row[x] & DEPTH_MASK);
 
             if (d == CLEAR_DEPTH)
             {
                 return 1.0f;
             }
 
-            return static_cast<float>(d) * INV_MAX_DEPTH;
+            return static_cast<float>(Format::decode(d)) * INV_MAX_DEPTH;
         }
 
+        // Raw depth units whatever the storage format.
         __attribute__((always_inline)) inline int16_t getRawDepth(uint16_t x, uint16_t y) const
         {
             if (unlikely(x >= WIDTH || y >= HEIGHT || !buffer))
             {
-                return CLEAR_DEPTH;
+                return static_cast<int16_t>(Format::decode(CLEAR_DEPTH));
             }
 
-            const int16_t *row = buffer + static_cast<size_t>(y) * WIDTH;
-            const int16_t stored = row[x];
-            return static_cast<int16_t>(stored & ~SHADOW_FLAG);
+            const Depth *row = buffer + static_cast<size_t>(y) * WIDTH;
+            return static_cast<int16_t>(Format::decode(static_cast<Depth>(row[x] & DEPTH_MASK)));
         }
 
         // Accessors used by optimized skybox rendering pass.
-        __attribute__((always_inline)) inline const int16_t *getBufferPtr() const
+        __attribute__((always_inline)) inline const Depth *getBufferPtr() const
         {
             return buffer;
         }
 
-        static __attribute__((always_inline)) inline int16_t clearDepthValue()
+        static __attribute__((always_inline)) inline Depth clearDepthValue()
         {
             return CLEAR_DEPTH;
         }
 
-        static __attribute__((always_inline)) inline int16_t shadowFlagMask()
+        // Zero when the format keeps shadows in a separate plane.
+        static __attribute__((always_inline)) inline Depth shadowFlagMask()
         {
             return SHADOW_FLAG;
         }
 
+        static __attribute__((always_inline)) inline int32_t decodeDepth(Depth stored)
+        {
+            return Format::decode(static_cast<Depth>(stored & DEPTH_MASK));
+        }
+
         __attribute__((always_inline)) inline void markShadow(uint16_t x, uint16_t y)
         {
             if (unlikely(x >= WIDTH || y >= HEIGHT || !buffer))
@@ -193,10 +431,24 @@ namespace pip3D
                 return;
             }
 
-            int16_t *row = buffer + static_cast<size_t>(y) * WIDTH;
-            row[x] |= SHADOW_FLAG;
+            setShadowAt(static_cast<size_t>(y) * WIDTH + x);
         }
 
+        // Pixels of the band that received geometry since the last clear().
+        uint32_t countCovered() const
+        {
+            if (!buffer)
+                return 0;
+            uint32_t covered = 0;
+            for (size_t i = 0; i < BUFFER_SIZE; ++i)
+            {
+                if (static_cast<Depth>(buffer[i] & DEPTH_MASK) != CLEAR_DEPTH)
+                    ++covered;
+            }
+            return covered;
+        }
+
+        template <int FRAC_BITS = 0>
         __attribute__((always_inline, hot)) inline void testAndSetScanline(uint16_t y, uint16_t x_start, uint16_t x_end,
                                                                            int32_t depthStart, int32_t depthStep,
                                                                            uint16_t *frameBuffer, uint16_t color)
@@ -236,78 +488,37 @@ namespace pip3D
                 return;
             }
 
-            size_t index = y * WIDTH + x_start;
-            int16_t *__restrict__ buf = buffer + index;
-            uint16_t *__restrict__ fb = frameBuffer + index;
-
-            int32_t depth = depthStart;
-
-            uint16_t count = countTotal;
+            const size_t index = static_cast<size_t>(y) * WIDTH + x_start;
+            noteSpanAt(index, countTotal);
+            depthSpanAt<FRAC_BITS>(index, countTotal, depthStart, depthStep, frameBuffer, color);
+        }
 
-            while (count >= 4)
+        // testAndSetScanline without the checks; frameBuffer is indexed like
+        // the depth buffer.
+        template <int FRAC_BITS = 0>
+        __attribute__((always_inline, hot)) inline void depthSpanAt(size_t index, uint16_t count,
+                                                                    int32_t depthStart, int32_t depthStep,
+                                                                    uint16_t *frameBuffer, uint16_t color)
+        {
+            if (Format::LINEAR)
             {
-                __builtin_prefetch(buf + 16, 1, 0);
-                __builtin_prefetch(fb + 16, 1, 0);
-
-                int16_t depth0 = static_cast<int16_t>(depth);
-                int16_t stored0 = buf[0];
-                int16_t currentDepth0 = stored0 & ~SHADOW_FLAG;
-                if (depth0 < currentDepth0)
-                {
-                    buf[0] = static_cast<int16_t>((stored0 & SHADOW_FLAG) | depth0);
-                    fb[0] = color;
-                }
-                depth += depthStep;
-
-                int16_t depth1 = static_cast<int16_t>(depth);
-                int16_t stored1 = buf[1];
-                int16_t currentDepth1 = stored1 & ~SHADOW_FLAG;
-                if (depth1 < currentDepth1)
-                {
-                    buf[1] = static_cast<int16_t>((stored1 & SHADOW_FLAG) | depth1);
-                    fb[1] = color;
-                }
-                depth += depthStep;
-
-                int16_t depth2 = static_cast<int16_t>(depth);
-                int16_t stored2 = buf[2];
-                int16_t currentDepth2 = stored2 & ~SHADOW_FLAG;
-                if (depth2 < currentDepth2)
-                {
-                    buf[2] = static_cast<int16_t>((stored2 & SHADOW_FLAG) | depth2);
-                    fb[2] = color;
-                }
-                depth += depthStep;
-
-                int16_t depth3 = static_cast<int16_t>(depth);
-                int16_t stored3 = buf[3];
-                int16_t currentDepth3 = stored3 & ~SHADOW_FLAG;
-                if (depth3 < currentDepth3)
-                {
-                    buf[3] = static_cast<int16_t>((stored3 & SHADOW_FLAG) | depth3);
-                    fb[3] = color;
-                }
-                depth += depthStep;
-
-                buf += 4;
-                fb += 4;
-                count -= 4;
+                SpanKernels::depthSpan<FRAC_BITS>(reinterpret_cast<int16_t *>(buffer) + index, frameBuffer + index, count,
+                                                  depthStart, depthStep, color);
+                return;
             }
 
-            while (count > 0)
+            Depth *__restrict__ zb = buffer + index;
+            uint16_t *__restrict__ fb = frameBuffer + index;
+            int32_t depth = depthStart;
+            for (uint16_t i = 0; i < count; ++i, depth += depthStep)
             {
-                int16_t d = static_cast<int16_t>(depth);
-                int16_t stored = *buf;
-                int16_t currentDepth = stored & ~SHADOW_FLAG;
-                if (d < currentDepth)
+                const Depth d = Format::encode(depth >> FRAC_BITS);
+                const Depth stored = zb[i];
+                if (d < static_cast<Depth>(stored & DEPTH_MASK))
                 {
-                    *buf = static_cast<int16_t>((stored & SHADOW_FLAG) | d);
-                    *fb = color;
+                    zb[i] = static_cast<Depth>((stored & SHADOW_FLAG) | d);
+                    fb[i] = color;
                 }
-                depth += depthStep;
-                ++buf;
-                ++fb;
-                --count;
             }
         }
 
@@ -316,6 +527,16 @@ namespace pip3D
             if (buffer)
                 ::pip3D::MemUtils::freeData(buffer);
         }
+
+    private:
+        void resetCoverage(int16_t minX, int16_t maxX, uint16_t rows = HEIGHT)
+        {
+            for (uint16_t y = 0; y < rows; ++y)
+            {
+                coverMin[y] = minX;
+                coverMax[y] = maxX;
+            }
+        }
     };
 
 }
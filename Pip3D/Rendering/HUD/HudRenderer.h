@@ -4,6 +4,7 @@
 #include "../../Core/Core.h"
 #include "../../Graphics/Font.h"
 #include "../Display/FrameBuffer.h"
+#include "TextRunCache.h"
 
 namespace pip3D
 {
@@ -15,6 +16,14 @@ namespace pip3D
                              const char *text,
                              uint16_t color);
 
+        // Same, through cached runs; textHash is set for dirty tracking.
+        static void drawText(FrameBuffer &framebuffer,
+                             TextRunCache &cache,
+                             int16_t x, int16_t y,
+                             const char *text,
+                             uint16_t color,
+                             uint32_t &textHash);
+
         static uint16_t getAdaptiveTextColor(FrameBuffer &framebuffer,
                                              const Viewport &viewport,
                                              int16_t x, int16_t y,
@@ -41,6 +50,26 @@ namespace pip3D
                                cfg.width, cfg.height);
     }
 
+    inline __attribute__((always_inline)) void HudRenderer::drawText(FrameBuffer &framebuffer,
+                                                                     TextRunCache &cache,
+                                                                     int16_t x, int16_t y,
+                                                                     const char *text,
+                                                                     uint16_t color,
+                                                                     uint32_t &textHash)
+    {
+        textHash = 0;
+        uint16_t *fb = framebuffer.getBuffer();
+        if (!fb || !text || !*text)
+            return;
+
+        const DisplayConfig &cfg = framebuffer.getConfig();
+        const TextRunCache::Entry *entry = cache.acquire(text, textHash);
+        if (entry)
+            TextRunCache::blit(*entry, fb, cfg.width, cfg.height, x, y, color);
+        else
+            BitmapFont::drawString(fb, x, y, text, color, cfg.width, cfg.height);
+    }
+
     inline __attribute__((always_inline)) uint16_t HudRenderer::getAdaptiveTextColor(FrameBuffer &framebuffer,
                                                                                      const Viewport &viewport,
                                                                                      int16_t x, int16_t y,
@@ -74,7 +103,7 @@ namespace pip3D
                 if (!viewport.contains(sx, sy))
                     continue;
 
-                uint16_t pixel = fb[sy * cfg.width + sx];
+                uint16_t pixel = PixelFormat::decode(fb[sy * cfg.width + sx]);
                 uint8_t r = ((pixel >> 11) & 0x1F) << 3;
                 uint8_t g = ((pixel >> 5) & 0x3F) << 2;
                 uint8_t b = (pixel & 0x1F) << 3;
@@ -0,0 +1,159 @@
+#ifndef TEXTRUNCACHE_H
+#define TEXTRUNCACHE_H
+
+#include <string.h>
+#include "../../Core/Core.h"
+#include "../../Graphics/Font.h"
+
+#ifndef PIP3D_TEXT_CACHE_SLOTS
+#define PIP3D_TEXT_CACHE_SLOTS 8
+#endif
+
+// Longer strings are drawn glyph by glyph.
+#ifndef PIP3D_TEXT_CACHE_MAX_CHARS
+#define PIP3D_TEXT_CACHE_MAX_CHARS 47
+#endif
+
+namespace pip3D
+{
+
+    // HUD strings pre-rendered as one pixel mask per glyph row, so a string
+    // that did not change since the last frame is blitted without touching
+    // the font: each row is a few 32-bit words walked bit by bit.
+    class TextRunCache
+    {
+    public:
+        static constexpr uint8_t ROWS = BitmapFont::getCharHeight();
+        static constexpr int WORDS = (PIP3D_TEXT_CACHE_MAX_CHARS * BitmapFont::getCharWidth() + 31) / 32;
+
+        struct Entry
+        {
+            char text[PIP3D_TEXT_CACHE_MAX_CHARS + 1];
+            uint32_t hash;
+            uint32_t lastUsed;
+            int16_t width;
+            uint8_t words;
+            uint32_t mask[ROWS][WORDS];
+        };
+
+    private:
+        Entry entries[PIP3D_TEXT_CACHE_SLOTS];
+        uint32_t tick;
+        uint32_t builds;
+
+        void build(Entry &entry, const char *text, size_t length)
+        {
+            memset(entry.mask, 0, sizeof(entry.mask));
+            for (size_t i = 0; i < length; ++i)
+            {
+                const uint8_t *rows = BitmapFont::glyph(text[i]);
+                const int base = static_cast<int>(i) * BitmapFont::getCharWidth();
+                const int word = base >> 5;
+                const int shift = base & 31;
+                for (uint8_t row = 0; row < ROWS; ++row)
+                {
+                    const uint32_t bits = rows[row];
+                    entry.mask[row][word] |= bits << shift;
+                    // Glyphs are 5 pixels wide, so at most one spill word.
+                    if (shift > 27 && word + 1 < WORDS)
+                        entry.mask[row][word + 1] |= bits >> (32 - shift);
+                }
+            }
+            memcpy(entry.text, text, length + 1);
+            entry.width = BitmapFont::getStringWidth(text);
+            entry.words = static_cast<uint8_t>((entry.width + 31) / 32);
+            ++builds;
+        }
+
+    public:
+        TextRunCache() : tick(0), builds(0)
+        {
+            for (int i = 0; i < PIP3D_TEXT_CACHE_SLOTS; ++i)
+            {
+                entries[i].text[0] = '\0';
+                entries[i].hash = 0;
+                entries[i].lastUsed = 0;
+                entries[i].width = 0;
+                entries[i].words = 0;
+            }
+        }
+
+        TextRunCache(const TextRunCache &) = delete;
+        TextRunCache &operator=(const TextRunCache &) = delete;
+
+        static uint32_t hashText(const char *text, size_t &length)
+        {
+            uint32_t h = 2166136261u;
+            length = 0;
+            while (text[length])
+            {
+                h ^= static_cast<uint8_t>(text[length++]);
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        // Runs for text, rebuilt only when it is not cached yet. hash is set
+        // even when the text is too long to cache and nullptr is returned.
+        const Entry *acquire(const char *text, uint32_t &hash)
+        {
+            size_t length;
+            hash = hashText(text, length);
+            if (length == 0 || length > PIP3D_TEXT_CACHE_MAX_CHARS)
+                return nullptr;
+
+            ++tick;
+            Entry *victim = &entries[0];
+            for (int i = 0; i < PIP3D_TEXT_CACHE_SLOTS; ++i)
+            {
+                Entry &entry = entries[i];
+                if (entry.text[0] && entry.hash == hash && strcmp(entry.text, text) == 0)
+                {
+                    entry.lastUsed = tick;
+                    return &entry;
+                }
+                if (entry.lastUsed < victim->lastUsed)
+                    victim = &entry;
+            }
+
+            build(*victim, text, length);
+            victim->hash = hash;
+            victim->lastUsed = tick;
+            return victim;
+        }
+
+        static void blit(const Entry &entry, uint16_t *framebuffer, int16_t width, int16_t height,
+                         int16_t x, int16_t y, uint16_t color)
+        {
+            if (y >= height || y + ROWS <= 0 || x >= width || x + entry.width <= 0)
+                return;
+
+            const uint16_t pixel = PixelFormat::encode(color);
+            const uint8_t row0 = y < 0 ? static_cast<uint8_t>(-y) : 0;
+            const uint8_t row1 = y + ROWS > height ? static_cast<uint8_t>(height - y) : ROWS;
+            const bool clipped = x < 0 || x + entry.width > width;
+            for (uint8_t row = row0; row < row1; ++row)
+            {
+                uint16_t *line = framebuffer + static_cast<int32_t>(y + row) * width;
+                for (uint8_t w = 0; w < entry.words; ++w)
+                {
+                    uint32_t bits = entry.mask[row][w];
+                    const int16_t base = static_cast<int16_t>(x + w * 32);
+                    while (bits)
+                    {
+                        const int16_t px = static_cast<int16_t>(base + __builtin_ctz(bits));
+                        bits &= bits - 1;
+                        if (!clipped || (px >= 0 && px < width))
+                            line[px] = pixel;
+                    }
+                }
+            }
+        }
+
+        // Strings rendered into masks so far.
+        uint32_t getBuildCount() const { return builds; }
+    };
+
+}
+
+#endif
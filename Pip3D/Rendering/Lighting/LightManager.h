@@ -4,6 +4,12 @@
 #include <vector>
 #include "Lighting.h"
 
+// Lights the renderer reserves room for up front; more still work but
+// grow the arrays at runtime.
+#ifndef PIP3D_MAX_LIGHTS
+#define PIP3D_MAX_LIGHTS 8
+#endif
+
 namespace pip3D
 {
     class LightManager
@@ -29,6 +35,10 @@ namespace pip3D
         static void setLightTemperature(std::vector<Light> &lights, int activeLightCount, float kelvin);
         static Color getLightColor(const std::vector<Light> &lights, int activeLightCount);
         static void setLightType(std::vector<Light> &lights, int activeLightCount, LightType type);
+
+        // Copies the lights that can reach the sphere to out, in order, and
+        // returns how many: point lights whose range misses it are dropped.
+        static int cullLights(const Light *lights, int lightCount, const Vector3 &center, float radius, Light *out);
     };
 }
 
@@ -232,6 +242,23 @@ namespace pip3D
         }
         lights[0].type = type;
     }
+
+    inline int LightManager::cullLights(const Light *lights, int lightCount, const Vector3 &center, float radius, Light *out)
+    {
+        int count = 0;
+        for (int i = 0; i < lightCount; ++i)
+        {
+            const Light &light = lights[i];
+            if (light.type == LIGHT_POINT && light.range > 0.0f)
+            {
+                const float reach = light.range + radius;
+                if ((light.position - center).lengthSquared() > reach * reach)
+                    continue;
+            }
+            out[count++] = light;
+        }
+        return count;
+    }
 }
 
 #endif
@@ -38,12 +38,15 @@ namespace pip3D
         float shadowOpacity;
         float shadowOffset;
         bool softEdges;
+        // Fill the outline of each caster's lit faces once instead of
+        // rasterizing every face.
+        bool silhouette;
         ShadowProjector::ShadowPlane plane;
 
         ShadowSettings()
             : enabled(true), shadowColor(Color::fromRGB888(20, 20, 30)),
               shadowOpacity(0.7f),
-              shadowOffset(0.01f), softEdges(true), plane(Vector3(0, 1, 0), 0)
+              shadowOffset(0.01f), softEdges(true), silhouette(false), plane(Vector3(0, 1, 0), 0)
         {
         }
     };
@@ -0,0 +1,350 @@
+#ifndef SHADOWCACHE_H
+#define SHADOWCACHE_H
+
+#include <string.h>
+#include "../../Core/Core.h"
+#include "../../Core/Camera.h"
+#include "../../Geometry/Mesh.h"
+#include "Lighting.h"
+#include "Shadow.h"
+
+#ifndef PIP3D_SHADOW_CACHE_SLOTS
+#define PIP3D_SHADOW_CACHE_SLOTS 16
+#endif
+
+namespace pip3D
+{
+
+    // Shadow vertex projected onto the plane and then onto the screen.
+    struct ShadowVertex
+    {
+        int16_t x;
+        int16_t y;
+        float z;
+    };
+
+    struct ShadowCrossing
+    {
+        float x;
+        int32_t winding;
+    };
+
+    // Screen-space shadow of one caster: a vertex per mesh vertex and the
+    // faces that face the light and reach above the plane. In silhouette
+    // mode it also holds the outline of those faces as directed vertex
+    // pairs and the plane's screen depth, depth = depthA * x + depthB * y +
+    // depthC.
+    struct ShadowCaster
+    {
+        ShadowVertex *verts;
+        uint16_t *faces;
+        uint16_t *edges;
+        uint16_t vertexCapacity;
+        uint16_t faceCapacity;
+        uint16_t faceCount;
+        uint32_t edgeCapacity;
+        uint32_t edgeCount;
+        float depthBias;
+        float depthA, depthB, depthC;
+        int16_t minY, maxY;
+        bool silhouette;
+    };
+
+    // Projected planar shadows kept across bands and frames. A slot stays
+    // valid while its owner keeps the same mesh and transform version and
+    // the key (first light, shadow plane, camera projection) is unchanged,
+    // so static casters under a static light and camera only rasterize.
+    class ShadowCache
+    {
+    private:
+        struct Slot
+        {
+            const void *owner;
+            const Mesh *mesh;
+            uint32_t version;
+            uint32_t key;
+            uint32_t lastUsed;
+            uint16_t vertexCount;
+            uint16_t faceCount;
+            ShadowCaster caster;
+        };
+
+        // Last slot is a transient fallback used when every regular slot
+        // already belongs to the current frame.
+        static constexpr int SLOT_COUNT = PIP3D_SHADOW_CACHE_SLOTS + 1;
+
+        Slot slots[SLOT_COUNT];
+        uint32_t frameId;
+        uint32_t rebuilds;
+
+        // World positions and face flags of the caster being rebuilt, and
+        // the edge crossings of the scanline being filled.
+        Vector3 *scratch;
+        uint16_t scratchCapacity;
+        uint8_t *faceFlags;
+        uint16_t faceFlagCapacity;
+        ShadowCrossing *crossings;
+        uint32_t crossingCapacity;
+
+        static uint32_t hashBytes(uint32_t h, const void *data, size_t size)
+        {
+            const uint8_t *bytes = static_cast<const uint8_t *>(data);
+            for (size_t i = 0; i < size; ++i)
+            {
+                h ^= bytes[i];
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        static uint32_t hashVector(uint32_t h, const Vector3 &v)
+        {
+            h = hashBytes(h, &v.x, sizeof(float));
+            h = hashBytes(h, &v.y, sizeof(float));
+            return hashBytes(h, &v.z, sizeof(float));
+        }
+
+        static bool reserve(ShadowCaster &caster, uint16_t vertexCount, uint16_t faceCount)
+        {
+            if (!caster.verts || caster.vertexCapacity < vertexCount)
+            {
+                if (caster.verts)
+                    MemUtils::freeData(caster.verts);
+                caster.verts = static_cast<ShadowVertex *>(
+                    MemUtils::allocData(static_cast<size_t>(vertexCount) * sizeof(ShadowVertex), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+                caster.vertexCapacity = caster.verts ? vertexCount : 0;
+            }
+            if (!caster.faces || caster.faceCapacity < faceCount)
+            {
+                if (caster.faces)
+                    MemUtils::freeData(caster.faces);
+                caster.faces = static_cast<uint16_t *>(
+                    MemUtils::allocData(static_cast<size_t>(faceCount) * sizeof(uint16_t), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+                caster.faceCapacity = caster.faces ? faceCount : 0;
+            }
+            if (!caster.verts || !caster.faces)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "ShadowCache::reserve: allocation failed (vertices=%u, faces=%u)",
+                     static_cast<unsigned int>(vertexCount),
+                     static_cast<unsigned int>(faceCount));
+                return false;
+            }
+            return true;
+        }
+
+        static void freeCaster(ShadowCaster &caster)
+        {
+            if (caster.verts)
+                MemUtils::freeData(caster.verts);
+            if (caster.faces)
+                MemUtils::freeData(caster.faces);
+            if (caster.edges)
+                MemUtils::freeData(caster.edges);
+            caster = ShadowCaster();
+        }
+
+    public:
+        ShadowCache()
+            : frameId(1), rebuilds(0), scratch(nullptr), scratchCapacity(0),
+              faceFlags(nullptr), faceFlagCapacity(0), crossings(nullptr), crossingCapacity(0)
+        {
+            for (int i = 0; i < SLOT_COUNT; ++i)
+            {
+                slots[i] = {nullptr, nullptr, 0, 0, 0, 0, 0, ShadowCaster()};
+            }
+        }
+
+        ~ShadowCache()
+        {
+            release();
+        }
+
+        ShadowCache(const ShadowCache &) = delete;
+        ShadowCache &operator=(const ShadowCache &) = delete;
+
+        // Everything a shadow's screen position depends on besides the caster.
+        static uint32_t key(const ShadowSettings &settings,
+                            const Light &light,
+                            const Camera &camera,
+                            const Matrix4x4 &viewProjMatrix,
+                            const Viewport &viewport)
+        {
+            uint32_t h = 2166136261u;
+            const uint8_t type = static_cast<uint8_t>(light.type);
+            const uint8_t projection = static_cast<uint8_t>(camera.projectionType);
+            const uint8_t silhouette = settings.silhouette ? 1 : 0;
+            h = hashBytes(h, &type, sizeof(type));
+            h = hashBytes(h, &silhouette, sizeof(silhouette));
+            h = hashVector(h, light.direction);
+            h = hashVector(h, light.position);
+            h = hashVector(h, settings.plane.normal);
+            h = hashBytes(h, &settings.plane.d, sizeof(float));
+            h = hashBytes(h, &settings.shadowOffset, sizeof(float));
+            h = hashBytes(h, &projection, sizeof(projection));
+            h = hashBytes(h, viewProjMatrix.m, sizeof(viewProjMatrix.m));
+            h = hashBytes(h, &viewport, sizeof(viewport));
+            return h;
+        }
+
+        void beginFrame()
+        {
+            ++frameId;
+            if (frameId == 0)
+                frameId = 1;
+            rebuilds = 0;
+        }
+
+        // Returns the caster slot for owner. rebuild is set when the slot
+        // does not match the arguments; the caller must then refill it.
+        ShadowCaster *acquire(const void *owner,
+                              const Mesh *mesh,
+                              uint32_t version,
+                              uint32_t sceneKey,
+                              bool &rebuild)
+        {
+            rebuild = false;
+            if (!owner || !mesh)
+                return nullptr;
+
+            const uint16_t vertexCount = mesh->numVertices();
+            const uint16_t faceCount = mesh->numFaces();
+            if (vertexCount == 0 || faceCount == 0)
+                return nullptr;
+
+            Slot *target = nullptr;
+            Slot *stale = nullptr;
+            for (int i = 0; i < SLOT_COUNT - 1; ++i)
+            {
+                Slot &slot = slots[i];
+                if (slot.owner == owner)
+                {
+                    target = &slot;
+                    break;
+                }
+                if (slot.lastUsed != frameId &&
+                    (!stale || !slot.owner || (stale->owner && slot.lastUsed < stale->lastUsed)))
+                    stale = &slot;
+            }
+            if (!target && slots[SLOT_COUNT - 1].owner == owner)
+                target = &slots[SLOT_COUNT - 1];
+
+            if (target)
+            {
+                target->lastUsed = frameId;
+                if (target->mesh == mesh && target->vertexCount == vertexCount &&
+                    target->faceCount == faceCount && target->version == version &&
+                    target->key == sceneKey)
+                    return &target->caster;
+            }
+            else
+            {
+                target = stale ? stale : &slots[SLOT_COUNT - 1];
+            }
+
+            if (!reserve(target->caster, vertexCount, faceCount))
+            {
+                target->owner = nullptr;
+                return nullptr;
+            }
+
+            target->owner = owner;
+            target->mesh = mesh;
+            target->version = version;
+            target->key = sceneKey;
+            target->lastUsed = frameId;
+            target->vertexCount = vertexCount;
+            target->faceCount = faceCount;
+            target->caster.faceCount = 0;
+            target->caster.edgeCount = 0;
+            target->caster.silhouette = false;
+            ++rebuilds;
+            rebuild = true;
+            return &target->caster;
+        }
+
+        // Scratch space for world positions while a caster is rebuilt.
+        Vector3 *worldScratch(uint16_t count)
+        {
+            if (scratch && scratchCapacity >= count)
+                return scratch;
+            if (scratch)
+                MemUtils::freeData(scratch);
+            scratch = static_cast<Vector3 *>(
+                MemUtils::allocData(static_cast<size_t>(count) * sizeof(Vector3), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+            scratchCapacity = scratch ? count : 0;
+            return scratch;
+        }
+
+        uint8_t *faceScratch(uint16_t count)
+        {
+            if (faceFlags && faceFlagCapacity >= count)
+                return faceFlags;
+            if (faceFlags)
+                MemUtils::freeData(faceFlags);
+            faceFlags = static_cast<uint8_t *>(MemUtils::allocData(count, 4, ::pip3D::Debug::LOG_MODULE_RENDER));
+            faceFlagCapacity = faceFlags ? count : 0;
+            return faceFlags;
+        }
+
+        ShadowCrossing *crossingScratch(uint32_t count)
+        {
+            if (crossings && crossingCapacity >= count)
+                return crossings;
+            if (crossings)
+                MemUtils::freeData(crossings);
+            crossings = static_cast<ShadowCrossing *>(
+                MemUtils::allocData(static_cast<size_t>(count) * sizeof(ShadowCrossing), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+            crossingCapacity = crossings ? count : 0;
+            return crossings;
+        }
+
+        static bool reserveEdges(ShadowCaster &caster, uint32_t count)
+        {
+            if (caster.edges && caster.edgeCapacity >= count)
+                return true;
+            if (caster.edges)
+                MemUtils::freeData(caster.edges);
+            caster.edges = static_cast<uint16_t *>(
+                MemUtils::allocData(static_cast<size_t>(count) * 2 * sizeof(uint16_t), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+            caster.edgeCapacity = caster.edges ? count : 0;
+            return caster.edges != nullptr;
+        }
+
+        // Casters rebuilt since beginFrame().
+        uint32_t getRebuildCount() const { return rebuilds; }
+
+        void invalidate(const void *owner)
+        {
+            for (int i = 0; i < SLOT_COUNT; ++i)
+            {
+                if (slots[i].owner == owner)
+                    slots[i].owner = nullptr;
+            }
+        }
+
+        void release()
+        {
+            for (int i = 0; i < SLOT_COUNT; ++i)
+            {
+                freeCaster(slots[i].caster);
+                slots[i] = {nullptr, nullptr, 0, 0, 0, 0, 0, ShadowCaster()};
+            }
+            if (scratch)
+                MemUtils::freeData(scratch);
+            if (faceFlags)
+                MemUtils::freeData(faceFlags);
+            if (crossings)
+                MemUtils::freeData(crossings);
+            scratch = nullptr;
+            scratchCapacity = 0;
+            faceFlags = nullptr;
+            faceFlagCapacity = 0;
+            crossings = nullptr;
+            crossingCapacity = 0;
+        }
+    };
+
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "Shadow.h"
+#include "ShadowCache.h"
 #include "Lighting.h"
 #include "../Display/FrameBuffer.h"
 #include "../Display/ZBuffer.h"
@@ -33,178 +34,366 @@ namespace pip3D
             baseAlphaOut = (uint8_t)(opacity * 255.0f);
         }
 
-    public:
-        static void drawMeshShadow(Mesh *mesh,
-                                   bool shadowsEnabled,
-                                   const ShadowSettings &shadowSettings,
-                                   const Camera &camera,
-                                   const Light *lights,
-                                   int activeLightCount,
-                                   const Matrix4x4 &viewProjMatrix,
-                                   const Viewport &viewport,
-                                   FrameBuffer &framebuffer,
-                                   ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
-                                   bool &backfaceCullingEnabled)
+        __attribute__((always_inline)) static inline bool castsPlanarShadow(const Light &light)
         {
-            if (!mesh || !mesh->isVisible() || !shadowsEnabled || !shadowSettings.enabled)
-                return;
+            return light.type == LIGHT_DIRECTIONAL || light.type == LIGHT_POINT;
+        }
 
-            mesh->updateTransform();
+        __attribute__((always_inline)) static inline float planeDistance(const ShadowProjector::ShadowPlane &plane,
+                                                                          const Vector3 &p)
+        {
+            return plane.normal.x * p.x + plane.normal.y * p.y + plane.normal.z * p.z + plane.d;
+        }
 
-            if (activeLightCount == 0)
-                return;
-            const Light &light = lights[0];
-            if (light.type != LIGHT_DIRECTIONAL && light.type != LIGHT_POINT)
-                return;
+        __attribute__((always_inline)) static inline int16_t toScreenCoord(float v)
+        {
+            // Leaves room for the band offset subtracted at draw time.
+            return static_cast<int16_t>(fminf(fmaxf(v, -16384.0f), 16383.0f));
+        }
 
-            uint16_t shadowColor;
-            uint8_t baseAlpha;
-            computeShadowColorAndAlpha(shadowSettings, shadowColor, baseAlpha);
+        static Vector3 projectToPlane(const Vector3 &v,
+                                      const Light &light,
+                                      const Vector3 &dirNorm,
+                                      float planeY)
+        {
+            if (light.type == LIGHT_DIRECTIONAL)
+            {
+                float ly = dirNorm.y;
+                float signLy = (ly >= 0.0f) ? 1.0f : -1.0f;
+                float absLy = fabsf(ly);
+                float safeLy = (absLy < 0.15f) ? signLy * 0.15f : ly;
 
-            bool oldCulling = backfaceCullingEnabled;
-            backfaceCullingEnabled = false;
+                float t = (planeY - v.y) / safeLy;
+                return Vector3(v.x + t * dirNorm.x, planeY, v.z + t * dirNorm.z);
+            }
 
-            const ShadowProjector::ShadowPlane &plane = shadowSettings.plane;
+            const Vector3 &lightPos = light.position;
+            Vector3 L = v - lightPos;
+            if (fabsf(L.y) > 0.001f)
+            {
+                float t = (planeY - lightPos.y) / L.y;
+                return lightPos + L * t;
+            }
+            return Vector3(v.x, planeY, v.z);
+        }
 
-            Vector3 meshCenter = mesh->center();
-            float meshRadius = mesh->radius();
-            float centerDist = plane.normal.x * meshCenter.x + plane.normal.y * meshCenter.y + plane.normal.z * meshCenter.z + plane.d;
-            if (centerDist + meshRadius <= 0.0f)
+        // Projects every vertex once, then keeps the faces that face the
+        // light, reach above the plane and are not behind the camera.
+        static void buildCaster(ShadowCaster &caster,
+                                ShadowCache &cache,
+                                const Mesh *mesh,
+                                const Matrix4x4 &worldTransform,
+                                const ShadowSettings &shadowSettings,
+                                const Camera &camera,
+                                const Light &light,
+                                const Matrix4x4 &viewProjMatrix,
+                                const Viewport &viewport)
+        {
+            const uint16_t vertexCount = mesh->numVertices();
+            Vector3 *world = cache.worldScratch(vertexCount);
+            caster.faceCount = 0;
+            if (!world)
             {
-                backfaceCullingEnabled = oldCulling;
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "ShadowRenderer: scratch allocation failed (vertices=%u)",
+                     static_cast<unsigned int>(vertexCount));
                 return;
             }
 
+            const ShadowProjector::ShadowPlane &plane = shadowSettings.plane;
             const float planeY = -plane.d / plane.normal.y;
             const float offsetY = shadowSettings.shadowOffset;
-            const float depthBias = 0.005f;
+            const bool perspective = camera.projectionType == PERSPECTIVE;
             Vector3 dirNorm;
             if (light.type == LIGHT_DIRECTIONAL)
             {
                 dirNorm = light.direction;
                 dirNorm.normalize();
             }
-            const Vector3 lightPos = light.position;
+            caster.depthBias = perspective ? 0.005f : 0.0f;
+
+            for (uint16_t i = 0; i < vertexCount; i++)
+            {
+                world[i] = worldTransform.transformNoDiv(mesh->decodePosition(mesh->vert(i)));
+
+                Vector3 sv = projectToPlane(world[i], light, dirNorm, planeY);
+                sv.y += offsetY;
+                Vector3 p = CameraController::project(sv, viewProjMatrix, viewport);
+
+                ShadowVertex &out = caster.verts[i];
+                out.x = toScreenCoord(p.x);
+                out.y = toScreenCoord(p.y);
+                out.z = p.z;
+            }
 
+            const Vector3 toLight = Vector3(-dirNorm.x, -dirNorm.y, -dirNorm.z);
             for (uint16_t i = 0; i < mesh->numFaces(); i++)
             {
                 const Face &face = mesh->face(i);
+                const Vector3 &v0 = world[face.v0];
+                const Vector3 &v1 = world[face.v1];
+                const Vector3 &v2 = world[face.v2];
 
-                Vector3 v0 = mesh->vertex(face.v0);
-                Vector3 v1 = mesh->vertex(face.v1);
-                Vector3 v2 = mesh->vertex(face.v2);
-
-                float d0 = plane.normal.x * v0.x + plane.normal.y * v0.y + plane.normal.z * v0.z + plane.d;
-                float d1 = plane.normal.x * v1.x + plane.normal.y * v1.y + plane.normal.z * v1.z + plane.d;
-                float d2 = plane.normal.x * v2.x + plane.normal.y * v2.y + plane.normal.z * v2.z + plane.d;
-                if (d0 <= 0.0f && d1 <= 0.0f && d2 <= 0.0f)
+                if (planeDistance(plane, v0) <= 0.0f &&
+                    planeDistance(plane, v1) <= 0.0f &&
+                    planeDistance(plane, v2) <= 0.0f)
                     continue;
 
                 Vector3 n = (v1 - v0).cross(v2 - v0);
-                Vector3 L;
-                if (light.type == LIGHT_DIRECTIONAL)
-                {
-                    L = Vector3(-dirNorm.x, -dirNorm.y, -dirNorm.z);
-                }
-                else
+                Vector3 L = light.type == LIGHT_DIRECTIONAL ? toLight : light.position - v0;
+                if (n.dot(L) <= 0.0f)
+                    continue;
+
+                if (perspective &&
+                    caster.verts[face.v0].z <= 0.0f &&
+                    caster.verts[face.v1].z <= 0.0f &&
+                    caster.verts[face.v2].z <= 0.0f)
+                    continue;
+
+                caster.faces[caster.faceCount++] = i;
+            }
+
+            if (shadowSettings.silhouette)
+                caster.silhouette = buildSilhouette(caster, cache, mesh, perspective);
+        }
+
+        // Outline of the casting faces: edges with a casting face on one
+        // side only, directed as that face walks them. Filled with the
+        // non-zero rule this covers exactly the union of the casting faces.
+        static bool buildSilhouette(ShadowCaster &caster,
+                                    ShadowCache &cache,
+                                    const Mesh *mesh,
+                                    bool perspective)
+        {
+            if (caster.faceCount == 0)
+                return false;
+            // The edge table belongs to the mesh and is built on first use.
+            if (!mesh->hasEdges() && !const_cast<Mesh *>(mesh)->buildEdges())
+                return false;
+
+            const uint32_t edgeTotal = mesh->numEdges();
+            uint8_t *casting = cache.faceScratch(mesh->numFaces());
+            if (!casting || !ShadowCache::reserveEdges(caster, edgeTotal) ||
+                !cache.crossingScratch(edgeTotal))
+                return false;
+
+            memset(casting, 0, mesh->numFaces());
+            float bestArea = 0.0f;
+            uint16_t bestFace = 0;
+            for (uint16_t i = 0; i < caster.faceCount; i++)
+            {
+                const uint16_t f = caster.faces[i];
+                casting[f] = 1;
+
+                const Face &face = mesh->face(f);
+                const ShadowVertex &p0 = caster.verts[face.v0];
+                const ShadowVertex &p1 = caster.verts[face.v1];
+                const ShadowVertex &p2 = caster.verts[face.v2];
+                const float area = fabsf(static_cast<float>(p1.x - p0.x) * (p2.y - p0.y) -
+                                         static_cast<float>(p2.x - p0.x) * (p1.y - p0.y));
+                if (area > bestArea)
                 {
-                    L = light.position - v0;
+                    bestArea = area;
+                    bestFace = f;
                 }
-                float nl = n.dot(L);
-                if (nl <= 0.0f)
+            }
+            if (bestArea < 1.0f)
+                return false;
+
+            uint32_t count = 0;
+            int16_t minY = INT16_MAX;
+            int16_t maxY = INT16_MIN;
+            const MeshEdge *meshEdges = mesh->edges();
+            for (uint32_t e = 0; e < edgeTotal; e++)
+            {
+                const MeshEdge &edge = meshEdges[e];
+                const bool front = edge.face0 != MeshEdge::NO_FACE && casting[edge.face0];
+                const bool back = edge.face1 != MeshEdge::NO_FACE && casting[edge.face1];
+                if (front == back)
                     continue;
 
-                Vector3 sv0, sv1, sv2;
+                const uint16_t from = front ? edge.v0 : edge.v1;
+                const uint16_t to = front ? edge.v1 : edge.v0;
+                const ShadowVertex &a = caster.verts[from];
+                const ShadowVertex &b = caster.verts[to];
+                // Behind the camera the projection folds over; the per-face
+                // path handles that case.
+                if (perspective && (a.z <= 0.0f || b.z <= 0.0f))
+                    return false;
+
+                caster.edges[count * 2] = from;
+                caster.edges[count * 2 + 1] = to;
+                ++count;
+                minY = a.y < minY ? a.y : minY;
+                minY = b.y < minY ? b.y : minY;
+                maxY = a.y > maxY ? a.y : maxY;
+                maxY = b.y > maxY ? b.y : maxY;
+            }
+            if (count == 0)
+                return false;
+
+            // Every shadow point lies on the plane, so screen depth is affine
+            // in screen x and y; take it from the largest casting face.
+            const Face &face = mesh->face(bestFace);
+            const ShadowVertex &p0 = caster.verts[face.v0];
+            const ShadowVertex &p1 = caster.verts[face.v1];
+            const ShadowVertex &p2 = caster.verts[face.v2];
+            const float x1 = static_cast<float>(p1.x - p0.x), y1 = static_cast<float>(p1.y - p0.y);
+            const float x2 = static_cast<float>(p2.x - p0.x), y2 = static_cast<float>(p2.y - p0.y);
+            const float z1 = p1.z - p0.z, z2 = p2.z - p0.z;
+            const float invDet = 1.0f / (x1 * y2 - x2 * y1);
+            caster.depthA = (z1 * y2 - z2 * y1) * invDet;
+            caster.depthB = (x1 * z2 - x2 * z1) * invDet;
+            caster.depthC = p0.z - caster.depthA * p0.x - caster.depthB * p0.y;
+
+            caster.edgeCount = count;
+            caster.minY = minY;
+            caster.maxY = maxY;
+            return true;
+        }
+
+        static void drawSilhouette(const ShadowCaster &caster,
+                                   ShadowCache &cache,
+                                   const ShadowSettings &shadowSettings,
+                                   FrameBuffer &framebuffer,
+                                   ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer)
+        {
+            if (!zBuffer)
+                return;
+
+            const int16_t bandTop = currentBandOffsetY();
+            const int16_t bandBottom = static_cast<int16_t>(bandTop + currentBandHeight());
+            const int16_t yStart = caster.minY > bandTop ? caster.minY : bandTop;
+            const int16_t yEnd = caster.maxY < bandBottom - 1 ? caster.maxY : static_cast<int16_t>(bandBottom - 1);
+            if (yStart > yEnd)
+                return;
+
+            ShadowCrossing *crossings = cache.crossingScratch(caster.edgeCount);
+            if (!crossings)
+                return;
 
-                if (light.type == LIGHT_DIRECTIONAL)
+            uint16_t shadowColor;
+            uint8_t baseAlpha;
+            computeShadowColorAndAlpha(shadowSettings, shadowColor, baseAlpha);
+            const uint16_t sr = (shadowColor >> 11) & 0x1F;
+            const uint16_t sg = (shadowColor >> 5) & 0x3F;
+            const uint16_t sb = shadowColor & 0x1F;
+            // Same tone as the per-face path, whose spans nearly always get
+            // the edge factor; only the outline pixels are lighter here.
+            const uint8_t innerAlpha = shadowSettings.softEdges ? static_cast<uint8_t>(baseAlpha * 0.7f) : baseAlpha;
+            const uint8_t edgeAlpha = shadowSettings.softEdges ? static_cast<uint8_t>(baseAlpha * 0.35f) : baseAlpha;
+
+            const DisplayConfig &config = framebuffer.getConfig();
+            const int16_t width = static_cast<int16_t>(config.width);
+            uint16_t *fb = framebuffer.getBuffer();
+            // Depth steps in 8.8 so long spans do not drift off the plane.
+            constexpr float depthScale = 32767.0f * 256.0f;
+            const float depthC = caster.depthC - caster.depthBias;
+            const int32_t depthStep = static_cast<int32_t>(caster.depthA * depthScale);
+
+            for (int16_t y = yStart; y <= yEnd; ++y)
+            {
+                // Pixel centres sit on integer coordinates, as in the
+                // rasterizer; an edge owns its upper end row only.
+                const float yc = static_cast<float>(y);
+                uint32_t n = 0;
+                for (uint32_t e = 0; e < caster.edgeCount; e++)
                 {
-                    const Vector3 &L = dirNorm;
-                    float ly = L.y;
-                    float signLy = (ly >= 0.0f) ? 1.0f : -1.0f;
-                    float absLy = fabsf(ly);
-                    float safeLy = (absLy < 0.15f) ? signLy * 0.15f : ly;
-
-                    float t0 = (planeY - v0.y) / safeLy;
-                    float t1 = (planeY - v1.y) / safeLy;
-                    float t2 = (planeY - v2.y) / safeLy;
-
-                    sv0 = Vector3(v0.x + t0 * L.x, planeY, v0.z + t0 * L.z);
-                    sv1 = Vector3(v1.x + t1 * L.x, planeY, v1.z + t1 * L.z);
-                    sv2 = Vector3(v2.x + t2 * L.x, planeY, v2.z + t2 * L.z);
+                    const ShadowVertex &a = caster.verts[caster.edges[e * 2]];
+                    const ShadowVertex &b = caster.verts[caster.edges[e * 2 + 1]];
+                    if ((a.y <= y) == (b.y <= y))
+                        continue;
+                    const float t = (yc - a.y) / static_cast<float>(b.y - a.y);
+                    ShadowCrossing &c = crossings[n++];
+                    c.x = a.x + t * static_cast<float>(b.x - a.x);
+                    c.winding = b.y > a.y ? 1 : -1;
                 }
-                else
+                for (uint32_t i = 1; i < n; i++)
                 {
-                    Vector3 L0 = v0 - lightPos;
-                    Vector3 L1 = v1 - lightPos;
-                    Vector3 L2 = v2 - lightPos;
+                    const ShadowCrossing c = crossings[i];
+                    uint32_t j = i;
+                    for (; j > 0 && crossings[j - 1].x > c.x; --j)
+                        crossings[j] = crossings[j - 1];
+                    crossings[j] = c;
+                }
 
-                    if (fabsf(L0.y) > 0.001f)
-                    {
-                        float t0 = (planeY - lightPos.y) / L0.y;
-                        sv0 = lightPos + L0 * t0;
-                    }
-                    else
+                const bool edgeRow = y == caster.minY || y == caster.maxY;
+                const size_t rowOffset = static_cast<size_t>(y - bandTop) * width;
+                int32_t winding = 0;
+                float spanStart = 0.0f;
+                for (uint32_t i = 0; i < n; i++)
+                {
+                    const int32_t before = winding;
+                    winding += crossings[i].winding;
+                    if (before == 0 && winding != 0)
                     {
-                        sv0 = Vector3(v0.x, planeY, v0.z);
+                        spanStart = crossings[i].x;
+                        continue;
                     }
+                    if (before == 0 || winding != 0)
+                        continue;
 
-                    if (fabsf(L1.y) > 0.001f)
-                    {
-                        float t1 = (planeY - lightPos.y) / L1.y;
-                        sv1 = lightPos + L1 * t1;
-                    }
-                    else
-                    {
-                        sv1 = Vector3(v1.x, planeY, v1.z);
-                    }
+                    // One pixel of overlap on both sides, like the per-face path.
+                    int16_t xs = static_cast<int16_t>(ceilf(spanStart)) - 1;
+                    int16_t xe = static_cast<int16_t>(floorf(crossings[i].x)) + 1;
+                    if (xs < 0)
+                        xs = 0;
+                    if (xe >= width)
+                        xe = static_cast<int16_t>(width - 1);
 
-                    if (fabsf(L2.y) > 0.001f)
-                    {
-                        float t2 = (planeY - lightPos.y) / L2.y;
-                        sv2 = lightPos + L2 * t2;
-                    }
-                    else
+                    const float z = caster.depthA * xs + caster.depthB * y + depthC;
+                    int32_t depth = static_cast<int32_t>(z * depthScale);
+                    uint16_t *__restrict__ fbRow = fb + rowOffset;
+
+                    for (int16_t x = xs; x <= xe; ++x, depth += depthStep)
                     {
-                        sv2 = Vector3(v2.x, planeY, v2.z);
+                        if (!zBuffer->shadowPixel(rowOffset + x, depth >> 8))
+                            continue;
+
+                        const uint8_t a = (edgeRow || x == xs || x == xe) ? edgeAlpha : innerAlpha;
+                        const uint16_t inv = 255 - a;
+                        const uint16_t bgColor = PixelFormat::decode(fbRow[x]);
+                        const uint16_t r = (((bgColor >> 11) & 0x1F) * inv + sr * a) >> 8;
+                        const uint16_t g = (((bgColor >> 5) & 0x3F) * inv + sg * a) >> 8;
+                        const uint16_t b = ((bgColor & 0x1F) * inv + sb * a) >> 8;
+                        fbRow[x] = PixelFormat::encode((r << 11) | (g << 5) | b);
                     }
                 }
+            }
+        }
 
-                sv0.y += offsetY;
-                sv1.y += offsetY;
-                sv2.y += offsetY;
+        static void drawCaster(const ShadowCaster &caster,
+                               const Mesh *mesh,
+                               const ShadowSettings &shadowSettings,
+                               FrameBuffer &framebuffer,
+                               ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer)
+        {
+            if (caster.faceCount == 0)
+                return;
 
-                Vector3 p0 = CameraController::project(sv0, viewProjMatrix, viewport);
-                Vector3 p1 = CameraController::project(sv1, viewProjMatrix, viewport);
-                Vector3 p2 = CameraController::project(sv2, viewProjMatrix, viewport);
+            uint16_t shadowColor;
+            uint8_t baseAlpha;
+            computeShadowColorAndAlpha(shadowSettings, shadowColor, baseAlpha);
 
-                if (camera.projectionType == PERSPECTIVE)
-                {
-                    if (p0.z <= 0.0f && p1.z <= 0.0f && p2.z <= 0.0f)
-                        continue;
-                    p0.z -= depthBias;
-                    p1.z -= depthBias;
-                    p2.z -= depthBias;
-                }
+            const int16_t bandTop = currentBandOffsetY();
+            const int16_t bandBottom = static_cast<int16_t>(bandTop + currentBandHeight());
+            const float bias = caster.depthBias;
 
-                int16_t bandTop = currentBandOffsetY();
-                int16_t bandH = currentBandHeight();
-                int16_t bandBottom = static_cast<int16_t>(bandTop + bandH);
+            for (uint16_t i = 0; i < caster.faceCount; i++)
+            {
+                const Face &face = mesh->face(caster.faces[i]);
+                const ShadowVertex &p0 = caster.verts[face.v0];
+                const ShadowVertex &p1 = caster.verts[face.v1];
+                const ShadowVertex &p2 = caster.verts[face.v2];
 
-                float minY = fminf(p0.y, fminf(p1.y, p2.y));
-                float maxY = fmaxf(p0.y, fmaxf(p1.y, p2.y));
+                const int16_t minY = p0.y < p1.y ? (p0.y < p2.y ? p0.y : p2.y) : (p1.y < p2.y ? p1.y : p2.y);
+                const int16_t maxY = p0.y > p1.y ? (p0.y > p2.y ? p0.y : p2.y) : (p1.y > p2.y ? p1.y : p2.y);
                 if (maxY < bandTop || minY >= bandBottom)
                     continue;
 
-                Vector3 lp0 = p0;
-                Vector3 lp1 = p1;
-                Vector3 lp2 = p2;
-                lp0.y -= (float)bandTop;
-                lp1.y -= (float)bandTop;
-                lp2.y -= (float)bandTop;
-
-                Rasterizer::fillShadowTriangle((int16_t)lp0.x, (int16_t)lp0.y, lp0.z,
-                                               (int16_t)lp1.x, (int16_t)lp1.y, lp1.z,
-                                               (int16_t)lp2.x, (int16_t)lp2.y, lp2.z,
+                Rasterizer::fillShadowTriangle(p0.x, static_cast<int16_t>(p0.y - bandTop), p0.z - bias,
+                                               p1.x, static_cast<int16_t>(p1.y - bandTop), p1.z - bias,
+                                               p2.x, static_cast<int16_t>(p2.y - bandTop), p2.z - bias,
                                                shadowColor,
                                                baseAlpha,
                                                framebuffer.getBuffer(),
@@ -212,8 +401,60 @@ namespace pip3D
                                                framebuffer.getConfig(),
                                                shadowSettings.softEdges);
             }
+        }
+
+        static void drawCachedShadow(const void *owner,
+                                     uint32_t version,
+                                     const Mesh *mesh,
+                                     const Matrix4x4 &worldTransform,
+                                     const ShadowSettings &shadowSettings,
+                                     const Camera &camera,
+                                     const Light &light,
+                                     const Matrix4x4 &viewProjMatrix,
+                                     const Viewport &viewport,
+                                     FrameBuffer &framebuffer,
+                                     ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
+                                     ShadowCache &cache)
+        {
+            const uint32_t key = ShadowCache::key(shadowSettings, light, camera, viewProjMatrix, viewport);
+            bool rebuild;
+            ShadowCaster *caster = cache.acquire(owner, mesh, version, key, rebuild);
+            if (!caster)
+                return;
+            if (rebuild)
+                buildCaster(*caster, cache, mesh, worldTransform, shadowSettings,
+                            camera, light, viewProjMatrix, viewport);
+            if (caster->silhouette)
+                drawSilhouette(*caster, cache, shadowSettings, framebuffer, zBuffer);
+            else
+                drawCaster(*caster, mesh, shadowSettings, framebuffer, zBuffer);
+        }
+
+    public:
+        static void drawMeshShadow(Mesh *mesh,
+                                   bool shadowsEnabled,
+                                   const ShadowSettings &shadowSettings,
+                                   const Camera &camera,
+                                   const Light *lights,
+                                   int activeLightCount,
+                                   const Matrix4x4 &viewProjMatrix,
+                                   const Viewport &viewport,
+                                   FrameBuffer &framebuffer,
+                                   ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
+                                   ShadowCache &cache)
+        {
+            if (!mesh || !mesh->isVisible() || !shadowsEnabled || !shadowSettings.enabled)
+                return;
+            if (activeLightCount == 0 || !castsPlanarShadow(lights[0]))
+                return;
 
-            backfaceCullingEnabled = oldCulling;
+            mesh->updateTransform();
+            if (planeDistance(shadowSettings.plane, mesh->center()) + mesh->radius() <= 0.0f)
+                return;
+
+            drawCachedShadow(mesh, mesh->computeTransformHash(), mesh, mesh->getTransform(),
+                             shadowSettings, camera, lights[0], viewProjMatrix, viewport,
+                             framebuffer, zBuffer, cache);
         }
 
         static void drawMeshInstanceShadow(MeshInstance *instance,
@@ -225,8 +466,8 @@ namespace pip3D
                                            const Matrix4x4 &viewProjMatrix,
                                            const Viewport &viewport,
                                            FrameBuffer &framebuffer,
-                                           ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
-                                           bool &backfaceCullingEnabled)
+                                           ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
+                                           ShadowCache &cache)
         {
             if (!instance || !instance->isVisible() || !shadowsEnabled || !shadowSettings.enabled)
                 return;
@@ -234,164 +475,15 @@ namespace pip3D
             Mesh *mesh = instance->getMesh();
             if (!mesh)
                 return;
-
-            if (activeLightCount == 0)
+            if (activeLightCount == 0 || !castsPlanarShadow(lights[0]))
                 return;
-            const Light &light = lights[0];
-
-            const Matrix4x4 &worldTransform = instance->transform();
-
-            uint16_t shadowColor;
-            uint8_t baseAlpha;
-            computeShadowColorAndAlpha(shadowSettings, shadowColor, baseAlpha);
-
-            bool oldCulling = backfaceCullingEnabled;
-            backfaceCullingEnabled = false;
-
-            const ShadowProjector::ShadowPlane &plane = shadowSettings.plane;
 
-            Vector3 instCenter = instance->center();
-            float instRadius = instance->radius();
-            float centerDist = plane.normal.x * instCenter.x + plane.normal.y * instCenter.y + plane.normal.z * instCenter.z + plane.d;
-            if (centerDist + instRadius <= 0.0f)
-            {
-                backfaceCullingEnabled = oldCulling;
+            if (planeDistance(shadowSettings.plane, instance->center()) + instance->radius() <= 0.0f)
                 return;
-            }
-
-            const float planeY = -plane.d / plane.normal.y;
-            const float offsetY = shadowSettings.shadowOffset;
-            const float depthBias = 0.005f;
-            Vector3 dirNorm;
-            if (light.type == LIGHT_DIRECTIONAL)
-            {
-                dirNorm = light.direction;
-                dirNorm.normalize();
-            }
-
-            const Vector3 lightPos = light.position;
-
-            for (uint16_t i = 0; i < mesh->numFaces(); i++)
-            {
-                const Face &face = mesh->face(i);
-
-                const Vertex &vert0 = mesh->vert(face.v0);
-                const Vertex &vert1 = mesh->vert(face.v1);
-                const Vertex &vert2 = mesh->vert(face.v2);
-
-                Vector3 local0 = mesh->decodePosition(vert0);
-                Vector3 local1 = mesh->decodePosition(vert1);
-                Vector3 local2 = mesh->decodePosition(vert2);
-
-                Vector3 v0 = worldTransform.transformNoDiv(local0);
-                Vector3 v1 = worldTransform.transformNoDiv(local1);
-                Vector3 v2 = worldTransform.transformNoDiv(local2);
-
-                float d0 = plane.normal.x * v0.x + plane.normal.y * v0.y + plane.normal.z * v0.z + plane.d;
-                float d1 = plane.normal.x * v1.x + plane.normal.y * v1.y + plane.normal.z * v1.z + plane.d;
-                float d2 = plane.normal.x * v2.x + plane.normal.y * v2.y + plane.normal.z * v2.z + plane.d;
-                if (d0 <= 0.0f && d1 <= 0.0f && d2 <= 0.0f)
-                    continue;
-
-                Vector3 n = (v1 - v0).cross(v2 - v0);
-                Vector3 L;
-                if (light.type == LIGHT_DIRECTIONAL)
-                {
-                    L = Vector3(-dirNorm.x, -dirNorm.y, -dirNorm.z);
-                }
-                else
-                {
-                    L = lightPos - v0;
-                }
-                float nl = n.dot(L);
-                if (nl <= 0.0f)
-                    continue;
-
-                Vector3 sv0, sv1, sv2;
-
-                if (light.type == LIGHT_DIRECTIONAL)
-                {
-                    const Vector3 &L = dirNorm;
-
-                    float ly = L.y;
-                    float signLy = (ly >= 0.0f) ? 1.0f : -1.0f;
-                    float absLy = fabsf(ly);
-                    float safeLy = (absLy < 0.15f) ? signLy * 0.15f : ly;
-
-                    float t0 = (planeY - v0.y) / safeLy;
-                    float t1 = (planeY - v1.y) / safeLy;
-                    float t2 = (planeY - v2.y) / safeLy;
-
-                    sv0 = Vector3(v0.x + t0 * L.x, planeY, v0.z + t0 * L.z);
-                    sv1 = Vector3(v1.x + t1 * L.x, planeY, v1.z + t1 * L.z);
-                    sv2 = Vector3(v2.x + t2 * L.x, planeY, v2.z + t2 * L.z);
-                }
-                else
-                {
-                    Vector3 L0 = v0 - lightPos;
-                    Vector3 L1 = v1 - lightPos;
-                    Vector3 L2 = v2 - lightPos;
-
-                    if (fabsf(L0.y) > 0.001f)
-                    {
-                        float t0 = (planeY - lightPos.y) / L0.y;
-                        sv0 = lightPos + L0 * t0;
-                    }
-                    else
-                    {
-                        sv0 = Vector3(v0.x, planeY, v0.z);
-                    }
-
-                    if (fabsf(L1.y) > 0.001f)
-                    {
-                        float t1 = (planeY - lightPos.y) / L1.y;
-                        sv1 = lightPos + L1 * t1;
-                    }
-                    else
-                    {
-                        sv1 = Vector3(v1.x, planeY, v1.z);
-                    }
-
-                    if (fabsf(L2.y) > 0.001f)
-                    {
-                        float t2 = (planeY - lightPos.y) / L2.y;
-                        sv2 = lightPos + L2 * t2;
-                    }
-                    else
-                    {
-                        sv2 = Vector3(v2.x, planeY, v2.z);
-                    }
-                }
-
-                sv0.y += offsetY;
-                sv1.y += offsetY;
-                sv2.y += offsetY;
-
-                Vector3 p0 = CameraController::project(sv0, viewProjMatrix, viewport);
-                Vector3 p1 = CameraController::project(sv1, viewProjMatrix, viewport);
-                Vector3 p2 = CameraController::project(sv2, viewProjMatrix, viewport);
-
-                if (camera.projectionType == PERSPECTIVE)
-                {
-                    if (p0.z <= 0.0f && p1.z <= 0.0f && p2.z <= 0.0f)
-                        continue;
-                    p0.z -= depthBias;
-                    p1.z -= depthBias;
-                    p2.z -= depthBias;
-                }
-
-                Rasterizer::fillShadowTriangle(p0.x, p0.y, p0.z,
-                                               p1.x, p1.y, p1.z,
-                                               p2.x, p2.y, p2.z,
-                                               shadowColor,
-                                               baseAlpha,
-                                               framebuffer.getBuffer(),
-                                               zBuffer,
-                                               framebuffer.getConfig(),
-                                               shadowSettings.softEdges);
-            }
 
-            backfaceCullingEnabled = oldCulling;
+            drawCachedShadow(instance, instance->transformVersion(), mesh, instance->transform(),
+                             shadowSettings, camera, lights[0], viewProjMatrix, viewport,
+                             framebuffer, zBuffer, cache);
         }
     };
 }
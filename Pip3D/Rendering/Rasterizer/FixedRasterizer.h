@@ -0,0 +1,466 @@
+#ifndef FIXEDRASTERIZER_H
+#define FIXEDRASTERIZER_H
+
+#include "../../Core/Core.h"
+#include "../Display/ZBuffer.h"
+#include "Shading.h"
+#include <algorithm>
+
+namespace pip3D
+{
+
+    // Integer triangle setup shared by the fixed-point rasterizer.
+    // Vertices are 28.4 subpixel, depth is raw ZBuffer depth in 20.12 and
+    // Gouraud channels are 0..31 / 0..63 in 20.12.
+    namespace FixedPoint
+    {
+        static constexpr int SUBPIXEL_BITS = 4;
+        static constexpr int32_t SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+        static constexpr int DEPTH_BITS = ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY>::FIXED_DEPTH_BITS;
+        static constexpr int COLOR_BITS = 12;
+
+        __attribute__((always_inline)) inline int32_t toSubpixel(int16_t v)
+        {
+            return static_cast<int32_t>(v) * SUBPIXEL_ONE;
+        }
+
+        // First and last pixel row whose center line y lies in [y0, y1].
+        __attribute__((always_inline)) inline int32_t ceilRow(int32_t y)
+        {
+            return (y + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS;
+        }
+
+        __attribute__((always_inline)) inline int32_t floorRow(int32_t y)
+        {
+            return y >> SUBPIXEL_BITS;
+        }
+
+        __attribute__((always_inline)) inline void floorDiv(int64_t num, int32_t den, int32_t &q, int32_t &r)
+        {
+            int64_t qq;
+            if (num >= INT32_MIN && num <= INT32_MAX)
+                qq = static_cast<int32_t>(num) / den;
+            else
+                qq = num / den;
+            int64_t rr = num - qq * den;
+            if (rr < 0)
+            {
+                --qq;
+                rr += den;
+            }
+            q = static_cast<int32_t>(qq);
+            r = static_cast<int32_t>(rr);
+        }
+
+        // Rounded x crossing of an edge, one row at a time. This is the
+        // zero of the edge function stepped with an integer remainder, so
+        // after init() no divide is needed; x is floor(edgeX + 0.5), the
+        // same rounding the float scanline path uses.
+        struct Edge
+        {
+            int32_t x;
+            int32_t rem;
+            int32_t den;
+            int32_t stepX;
+            int32_t stepRem;
+
+            void init(int32_t xa, int32_t ya, int32_t xb, int32_t yb, int32_t row)
+            {
+                const int32_t dx = xb - xa;
+                const int32_t dy = yb - ya;
+                den = dy << SUBPIXEL_BITS;
+
+                const int64_t num = static_cast<int64_t>(dx) * ((row << SUBPIXEL_BITS) - ya) +
+                                    static_cast<int64_t>(xa + SUBPIXEL_ONE / 2) * dy;
+                floorDiv(num, den, x, rem);
+                floorDiv(static_cast<int64_t>(dx) << SUBPIXEL_BITS, den, stepX, stepRem);
+            }
+
+            __attribute__((always_inline)) inline void step()
+            {
+                x += stepX;
+                rem += stepRem;
+                if (rem >= den)
+                {
+                    rem -= den;
+                    ++x;
+                }
+            }
+        };
+
+        // Screen-space linear attribute v(x, y) = origin + dx * x + dy * y.
+        // Evaluated in wrapping unsigned math: values inside the triangle are
+        // in range even when the origin term is not.
+        struct Plane
+        {
+            int32_t dx;
+            int32_t dy;
+            uint32_t origin;
+            int32_t lo;
+            int32_t hi;
+
+            static int32_t quantize(float v)
+            {
+                const float limit = 1073741824.0f;
+                if (v > limit)
+                    v = limit;
+                else if (v < -limit)
+                    v = -limit;
+                return static_cast<int32_t>(v >= 0.0f ? v + 0.5f : v - 0.5f);
+            }
+
+            // invArea is 1 / (2 * signed area) in pixels, 0 for degenerate
+            // triangles, which then get the average value.
+            void init(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                      float v0, float v1, float v2, float scale, float invArea)
+            {
+                const float inv = 1.0f / SUBPIXEL_ONE;
+                const float ex1 = (x1 - x0) * inv, ey1 = (y1 - y0) * inv;
+                const float ex2 = (x2 - x0) * inv, ey2 = (y2 - y0) * inv;
+                const float d1 = (v1 - v0) * scale;
+                const float d2 = (v2 - v0) * scale;
+
+                float gx = 0.0f;
+                float gy = 0.0f;
+                float base = v0 * scale;
+                if (invArea != 0.0f)
+                {
+                    gx = (d1 * ey2 - d2 * ey1) * invArea;
+                    gy = (d2 * ex1 - d1 * ex2) * invArea;
+                }
+                else
+                {
+                    base = (v0 + v1 + v2) * (1.0f / 3.0f) * scale;
+                }
+
+                dx = quantize(gx);
+                dy = quantize(gy);
+                lo = quantize(std::min(v0, std::min(v1, v2)) * scale);
+                hi = quantize(std::max(v0, std::max(v1, v2)) * scale);
+
+                // Anchor at the pixel holding vertex 0; the subpixel part of
+                // the vertex goes through the gradients.
+                const int32_t px = x0 >> SUBPIXEL_BITS;
+                const int32_t py = y0 >> SUBPIXEL_BITS;
+                const float fx = (x0 - (px << SUBPIXEL_BITS)) * inv;
+                const float fy = (y0 - (py << SUBPIXEL_BITS)) * inv;
+                const int32_t anchor = quantize(base - gx * fx - gy * fy);
+
+                origin = static_cast<uint32_t>(anchor) -
+                         static_cast<uint32_t>(dx) * static_cast<uint32_t>(px) -
+                         static_cast<uint32_t>(dy) * static_cast<uint32_t>(py);
+            }
+
+            __attribute__((always_inline)) inline int32_t at(int32_t x, int32_t y) const
+            {
+                return static_cast<int32_t>(origin +
+                                            static_cast<uint32_t>(dx) * static_cast<uint32_t>(x) +
+                                            static_cast<uint32_t>(dy) * static_cast<uint32_t>(y));
+            }
+
+            // Start value and step for span [xs, xe] of row y. Pixels just
+            // outside a thin triangle would extrapolate far past its vertex
+            // values, so the span ends are clamped to [lo, hi]; the divide
+            // only happens when that clamp kicks in.
+            __attribute__((always_inline)) inline int32_t span(int32_t xs, int32_t xe, int32_t y, int32_t &step) const
+            {
+                int32_t s = at(xs, y);
+                int32_t e = at(xe, y);
+                step = dx;
+                if (likely(s >= lo && s <= hi && e >= lo && e <= hi))
+                    return s;
+
+                s = s < lo ? lo : (s > hi ? hi : s);
+                e = e < lo ? lo : (e > hi ? hi : e);
+                step = xe > xs ? (e - s) / (xe - xs) : 0;
+                return s;
+            }
+        };
+
+        __attribute__((always_inline)) inline float inverseArea(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+        {
+            const int64_t area = static_cast<int64_t>(x1 - x0) * (y2 - y0) - static_cast<int64_t>(x2 - x0) * (y1 - y0);
+            if (area == 0)
+                return 0.0f;
+            return static_cast<float>(SUBPIXEL_ONE * SUBPIXEL_ONE) / static_cast<float>(area);
+        }
+
+        // Calls span(y, xa, xb) with xa <= xb for every pixel row of the
+        // triangle inside [rowMin, rowMax]. Coverage matches the float
+        // scanline path: the upper part covers rows in [y0, y1] (only when
+        // y1 > y0), the lower part rows in (y1, y2]. The float path starts
+        // the lower short edge (and in the Gouraud path the long edge too)
+        // one row late; shortLag / longLag reproduce that.
+        template <typename SpanFn>
+        __attribute__((always_inline)) inline void walkSpans(int32_t x0, int32_t y0,
+                                                             int32_t x1, int32_t y1,
+                                                             int32_t x2, int32_t y2,
+                                                             int32_t rowMin, int32_t rowMax,
+                                                             int32_t shortLag, int32_t longLag,
+                                                             SpanFn span)
+        {
+            if (y0 > y1)
+            {
+                std::swap(x0, x1);
+                std::swap(y0, y1);
+            }
+            if (y1 > y2)
+            {
+                std::swap(x1, x2);
+                std::swap(y1, y2);
+            }
+            if (y0 > y1)
+            {
+                std::swap(x0, x1);
+                std::swap(y0, y1);
+            }
+
+            if (y0 == y2)
+                return;
+            if (x0 == x1 && x1 == x2)
+                return;
+
+            Edge longEdge;
+            Edge shortEdge;
+
+            if (y1 > y0)
+            {
+                const int32_t first = std::max(ceilRow(y0), rowMin);
+                const int32_t last = std::min(floorRow(y1), rowMax);
+                if (first <= last)
+                {
+                    longEdge.init(x0, y0, x2, y2, first);
+                    shortEdge.init(x0, y0, x1, y1, first);
+                    for (int32_t y = first;; ++y)
+                    {
+                        const int32_t a = longEdge.x;
+                        const int32_t b = shortEdge.x;
+                        if (a <= b)
+                            span(y, a, b);
+                        else
+                            span(y, b, a);
+                        if (y == last)
+                            break;
+                        longEdge.step();
+                        shortEdge.step();
+                    }
+                }
+            }
+
+            if (y2 > y1)
+            {
+                const int32_t first = std::max(floorRow(y1) + 1, rowMin);
+                const int32_t last = std::min(floorRow(y2), rowMax);
+                if (first <= last)
+                {
+                    longEdge.init(x0, y0, x2, y2, first - longLag);
+                    shortEdge.init(x1, y1, x2, y2, first - shortLag);
+                    for (int32_t y = first;; ++y)
+                    {
+                        const int32_t a = longEdge.x;
+                        const int32_t b = shortEdge.x;
+                        if (a <= b)
+                            span(y, a, b);
+                        else
+                            span(y, b, a);
+                        if (y == last)
+                            break;
+                        longEdge.step();
+                        shortEdge.step();
+                    }
+                }
+            }
+        }
+    }
+
+    // Fixed-point counterpart of the Rasterizer entry points, selected with
+    // PIP3D_RASTER_FIXED_POINT. Same arguments and coverage; span setup is
+    // integer and depth/color step incrementally without per-span divides.
+    class FixedRasterizer
+    {
+    public:
+        static void fillTriangle(int16_t x0, int16_t y0, float z0,
+                                 int16_t x1, int16_t y1, float z1,
+                                 int16_t x2, int16_t y2, float z2,
+                                 uint16_t color,
+                                 uint16_t *frameBuffer,
+                                 ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
+                                 const DisplayConfig &config)
+        {
+            using namespace FixedPoint;
+
+            if (!frameBuffer || !zBuffer)
+                return;
+
+            const int32_t width = config.width;
+            const int32_t height = config.height;
+
+            const int32_t sx0 = toSubpixel(x0), sy0 = toSubpixel(y0);
+            const int32_t sx1 = toSubpixel(x1), sy1 = toSubpixel(y1);
+            const int32_t sx2 = toSubpixel(x2), sy2 = toSubpixel(y2);
+
+            Plane depth;
+            depth.init(sx0, sy0, sx1, sy1, sx2, sy2, z0, z1, z2,
+                       32767.0f * (1 << DEPTH_BITS), inverseArea(sx0, sy0, sx1, sy1, sx2, sy2));
+
+            walkSpans(sx0, sy0, sx1, sy1, sx2, sy2, 0, height - 1, 1, 0,
+                      [&](int32_t y, int32_t xa, int32_t xb)
+                      {
+                          const int32_t xs = xa < 0 ? 0 : xa;
+                          const int32_t xe = xb >= width ? width - 1 : xb;
+                          if (xs > xe)
+                              return;
+                          int32_t step;
+                          const int32_t d = depth.span(xs, xe, y, step);
+                          zBuffer->testAndSetScanline<DEPTH_BITS>(y, xs, xe, d, step, frameBuffer, color);
+                      });
+        }
+
+        static void fillTriangleSmooth(int16_t x0, int16_t y0, float z0,
+                                       int16_t x1, int16_t y1, float z1,
+                                       int16_t x2, int16_t y2, float z2,
+                                       float r0, float g0, float b0,
+                                       float r1, float g1, float b1,
+                                       float r2, float g2, float b2,
+                                       uint16_t *frameBuffer,
+                                       ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
+                                       const DisplayConfig &config)
+        {
+            using namespace FixedPoint;
+
+            if (!frameBuffer || !zBuffer)
+                return;
+
+            const int32_t width = config.width;
+            const int32_t height = config.height;
+
+            const int32_t sx0 = toSubpixel(x0), sy0 = toSubpixel(y0);
+            const int32_t sx1 = toSubpixel(x1), sy1 = toSubpixel(y1);
+            const int32_t sx2 = toSubpixel(x2), sy2 = toSubpixel(y2);
+            const float invArea = inverseArea(sx0, sy0, sx1, sy1, sx2, sy2);
+
+            const float one = static_cast<float>(1 << COLOR_BITS);
+            Plane depth, red, green, blue;
+            depth.init(sx0, sy0, sx1, sy1, sx2, sy2, z0, z1, z2, 32767.0f * (1 << DEPTH_BITS), invArea);
+            red.init(sx0, sy0, sx1, sy1, sx2, sy2, r0, r1, r2, 31.0f * one, invArea);
+            green.init(sx0, sy0, sx1, sy1, sx2, sy2, g0, g1, g2, 63.0f * one, invArea);
+            blue.init(sx0, sy0, sx1, sy1, sx2, sy2, b0, b1, b2, 31.0f * one, invArea);
+
+            walkSpans(sx0, sy0, sx1, sy1, sx2, sy2, 0, height - 1, 1, 1,
+                      [&](int32_t y, int32_t xa, int32_t xb)
+                      {
+                          const int32_t xs = xa < 0 ? 0 : xa;
+                          const int32_t xe = xb >= width ? width - 1 : xb;
+                          if (xs > xe)
+                              return;
+
+                          int32_t dStep;
+                          int32_t d = depth.span(xs, xe, y, dStep);
+                          int32_t r = red.at(xs, y);
+                          int32_t g = green.at(xs, y);
+                          int32_t b = blue.at(xs, y);
+                          uint16_t *__restrict__ fb = frameBuffer + static_cast<size_t>(y) * width;
+
+                          for (int32_t x = xs; x <= xe; ++x)
+                          {
+                              if (zBuffer->testAndSet<DEPTH_BITS>(x, y, d))
+                                  fb[x] = Shading::applyDitheringFixed(r, g, b, x, y);
+                              d += dStep;
+                              r += red.dx;
+                              g += green.dx;
+                              b += blue.dx;
+                          }
+                      });
+        }
+
+        static void fillShadowTriangle(int16_t x0, int16_t y0, float z0,
+                                       int16_t x1, int16_t y1, float z1,
+                                       int16_t x2, int16_t y2, float z2,
+                                       uint16_t shadowColor,
+                                       uint8_t alpha,
+                                       uint16_t *frameBuffer,
+                                       ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
+                                       const DisplayConfig &config,
+                                       bool softEdges = true,
+                                       int16_t offsetY = 0,
+                                       int16_t bandHeight = -1)
+        {
+            using namespace FixedPoint;
+
+            const int32_t width = config.width;
+            const int32_t height = config.height;
+
+            if (bandHeight <= 0 || bandHeight > height)
+                bandHeight = static_cast<int16_t>(height);
+
+            if (!frameBuffer || !zBuffer)
+                return;
+
+            const uint16_t sr = (shadowColor >> 11) & 0x1F;
+            const uint16_t sg = (shadowColor >> 5) & 0x3F;
+            const uint16_t sb = shadowColor & 0x1F;
+
+            const int32_t sx0 = toSubpixel(x0), sy0 = toSubpixel(y0);
+            const int32_t sx1 = toSubpixel(x1), sy1 = toSubpixel(y1);
+            const int32_t sx2 = toSubpixel(x2), sy2 = toSubpixel(y2);
+
+            Plane depth;
+            depth.init(sx0, sy0, sx1, sy1, sx2, sy2, z0, z1, z2,
+                       32767.0f * (1 << DEPTH_BITS), inverseArea(sx0, sy0, sx1, sy1, sx2, sy2));
+
+            const int32_t topRow = std::min(y0, std::min(y1, y2));
+            const int32_t bottomRow = std::max(y0, std::max(y1, y2));
+
+            walkSpans(sx0, sy0, sx1, sy1, sx2, sy2, offsetY, offsetY + bandHeight - 1, 1, 0,
+                      [&](int32_t y, int32_t xa, int32_t xb)
+                      {
+                          const int32_t xsSrc = xa < 0 ? 0 : xa;
+                          const int32_t xeSrc = xb >= width ? width - 1 : xb;
+                          if (xsSrc > xeSrc)
+                              return;
+
+                          // Soft edges feather one pixel past each end.
+                          const int32_t xs = xsSrc > 0 ? xsSrc - 1 : xsSrc;
+                          const int32_t xe = xeSrc < width - 1 ? xeSrc + 1 : xeSrc;
+
+                          uint8_t edgeAlpha = alpha;
+                          if (softEdges)
+                          {
+                              float edgeDist = 1.0f;
+                              if (y == topRow || y == bottomRow)
+                                  edgeDist = 0.5f;
+                              if (xsSrc == xa || xeSrc == xb)
+                                  edgeDist *= 0.7f;
+                              edgeAlpha = (uint8_t)(alpha * edgeDist);
+                          }
+                          const uint16_t invEdgeAlpha = 255 - edgeAlpha;
+
+                          int32_t dStep;
+                          int32_t d = depth.span(xs, xe, y, dStep);
+                          const size_t rowOffset = static_cast<size_t>(y - offsetY) * width;
+                          uint16_t *__restrict__ fb = frameBuffer + rowOffset;
+                          const size_t zbRowStart = static_cast<size_t>(y) * width;
+
+                          for (int32_t x = xs; x <= xe; ++x, d += dStep)
+                          {
+                              if (!zBuffer->shadowPixel(zbRowStart + x, d >> DEPTH_BITS))
+                                  continue;
+
+                              const uint16_t bgColor = PixelFormat::decode(fb[x]);
+                              const uint16_t br = (bgColor >> 11) & 0x1F;
+                              const uint16_t bg = (bgColor >> 5) & 0x3F;
+                              const uint16_t bb = bgColor & 0x1F;
+
+                              const uint16_t r = (br * invEdgeAlpha + sr * edgeAlpha) >> 8;
+                              const uint16_t g = (bg * invEdgeAlpha + sg * edgeAlpha) >> 8;
+                              const uint16_t b = (bb * invEdgeAlpha + sb * edgeAlpha) >> 8;
+
+                              fb[x] = PixelFormat::encode((r << 11) | (g << 5) | b);
+                          }
+                      });
+        }
+    };
+
+}
+
+#endif
@@ -2,723 +2,436 @@
 #define RASTERIZER_H
 
 #include "../../Core/Core.h"
+#include "../../Core/Debug/FillStats.h"
 #include "../Display/ZBuffer.h"
 #include "Shading.h"
+#include "Texture.h"
+#include "FixedRasterizer.h"
 #include <algorithm>
 
+// 1 routes every Rasterizer entry point through FixedRasterizer (integer
+// edge walking, 20.12 depth); 0 keeps the float scanline code.
+#ifndef PIP3D_RASTER_FIXED_POINT
+#define PIP3D_RASTER_FIXED_POINT 0
+#endif
+
+// Pixels between perspective divides on textured spans; the texture
+// coordinates in between are stepped affinely.
+#ifndef PIP3D_TEXTURE_SUBDIV
+#define PIP3D_TEXTURE_SUBDIV 16
+#endif
+
 namespace pip3D
 {
 
-    class Rasterizer
+    enum class RasterBlend : uint8_t
     {
-    public:
-        static void fillShadowTriangle(int16_t x0, int16_t y0, float z0,
-                                       int16_t x1, int16_t y1, float z1,
-                                       int16_t x2, int16_t y2, float z2,
-                                       uint16_t shadowColor,
-                                       uint8_t alpha,
-                                       uint16_t *frameBuffer,
-                                       ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
-                                       const DisplayConfig &config,
-                                       bool softEdges = true,
-                                       int16_t offsetY = 0,
-                                       int16_t bandHeight = -1)
-        {
-            const int16_t width = config.width;
-            int16_t height = config.height;
-
-            if (bandHeight <= 0 || bandHeight > height)
-            {
-                bandHeight = height;
-            }
-
-            const int16_t bandStartY = offsetY;
-            const int16_t bandEndY = offsetY + bandHeight - 1;
-
-            if (!frameBuffer || !zBuffer)
-                return;
-
-            if (y0 > y1)
-            {
-                std::swap(x0, x1);
-                std::swap(y0, y1);
-                std::swap(z0, z1);
-            }
-            if (y1 > y2)
-            {
-                std::swap(x1, x2);
-                std::swap(y1, y2);
-                std::swap(z1, z2);
-            }
-            if (y0 > y1)
-            {
-                std::swap(x0, x1);
-                std::swap(y0, y1);
-                std::swap(z0, z1);
-            }
-
-            if (y0 == y2)
-                return;
-            if (x0 == x1 && x1 == x2)
-                return;
+        Replace,
+        // The span color is plain RGB565, mixed over the pixel by its alpha.
+        Alpha
+    };
 
-            const uint16_t sr = (shadowColor >> 11) & 0x1F;
-            const uint16_t sg = (shadowColor >> 5) & 0x3F;
-            const uint16_t sb = shadowColor & 0x1F;
+    // What a span does per pixel, fixed at compile time so every combination
+    // gets its own loop without mode branches inside it. SHADOW_RECEIVER
+    // takes the place of the depth test: the pixel passes when it holds
+    // geometry not shadowed yet and the caster is not behind it, and is
+    // flagged as shadowed.
+    template <bool DEPTH_TEST, bool DEPTH_WRITE, RasterBlend BLEND, bool GOURAUD, bool DITHER, bool SHADOW_RECEIVER>
+    struct RasterPixelOp
+    {
+        static_assert(!(GOURAUD && BLEND == RasterBlend::Alpha), "blended spans take a constant color");
+        static_assert(!(SHADOW_RECEIVER && (DEPTH_TEST || DEPTH_WRITE)), "the shadow test replaces the depth test");
+
+        static constexpr bool depthTest = DEPTH_TEST;
+        static constexpr bool depthWrite = DEPTH_WRITE;
+        static constexpr RasterBlend blend = BLEND;
+        static constexpr bool gouraud = GOURAUD;
+        static constexpr bool dither = DITHER;
+        static constexpr bool shadowReceiver = SHADOW_RECEIVER;
+    };
 
-            int16_t dy1 = y1 - y0;
-            int16_t dy2 = y2 - y0;
+    typedef RasterPixelOp<true, true, RasterBlend::Replace, false, false, false> RasterOpFlat;
+    typedef RasterPixelOp<true, true, RasterBlend::Replace, true, true, false> RasterOpSmooth;
+    typedef RasterPixelOp<false, false, RasterBlend::Alpha, false, false, true> RasterOpShadow;
 
-            if (dy1 == 0 && dy2 == 0)
-                return;
+    // One clipped row: the frame and depth buffers share the band layout,
+    // so a single index addresses both.
+    struct RasterSpan
+    {
+        size_t index;
+        uint16_t count;
+        // Pixel position of the first pixel, for the dither pattern.
+        int16_t x;
+        int16_t y;
+        int32_t depth;
+        int32_t depthStep;
+        float r, g, b;
+        float rStep, gStep, bStep;
+        // Stored pixel for Replace, RGB565 for Alpha.
+        uint16_t color;
+        uint8_t alpha;
+    };
 
-            float dax_step = 0.0f;
-            float dbx_step = 0.0f;
-            float daz_step = 0.0f;
-            float dbz_step = 0.0f;
+    class Rasterizer
+    {
+    public:
+        typedef ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> DepthBuffer;
 
-            if (dy1)
-            {
-                float invDy1 = 1.0f / dy1;
-                dax_step = (float)(x1 - x0) * invDy1;
-                daz_step = (z1 - z0) * invDy1;
-            }
-            if (dy2)
+        // Spans come clipped from triangle setup; nothing is bounds checked
+        // per pixel.
+        template <class Op>
+        __attribute__((hot)) static void IRAM_ATTR span(const RasterSpan &s, uint16_t *__restrict frameBuffer, DepthBuffer *zBuffer)
+        {
+#if ENABLE_FILL_STATS
+            // Every span takes the counting loop below.
+            uint8_t *heat = FillStats::heatFor(frameBuffer);
+            uint32_t failed = 0;
+#endif
+            if (Op::depthWrite)
+                zBuffer->noteSpanAt(s.index, s.count);
+#if !ENABLE_FILL_STATS
+            if (!Op::gouraud && Op::depthTest && Op::depthWrite && Op::blend == RasterBlend::Replace && !Op::shadowReceiver)
             {
-                float invDy2 = 1.0f / dy2;
-                dbx_step = (float)(x2 - x0) * invDy2;
-                dbz_step = (z2 - z0) * invDy2;
+                zBuffer->depthSpanAt(s.index, s.count, s.depth, s.depthStep, frameBuffer, s.color);
+                return;
             }
+#endif
 
-            float ax = x0, bx = x0;
-            float az = z0, bz = z0;
-
-            const float depthScale = 32767.0f;
+            const uint16_t sr = (s.color >> 11) & 0x1F;
+            const uint16_t sg = (s.color >> 5) & 0x3F;
+            const uint16_t sb = s.color & 0x1F;
+            const uint16_t alpha = s.alpha;
+            const uint16_t invAlpha = 255 - alpha;
 
-            const int16_t clearDepth = ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT>::clearDepthValue();
-            const int16_t shadowMask = ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT>::shadowFlagMask();
-            const int16_t invShadowMask = static_cast<int16_t>(~shadowMask);
-            const int16_t *__restrict__ zbBaseConst = zBuffer->getBufferPtr();
-            int16_t *__restrict__ zbBase = const_cast<int16_t *>(zbBaseConst);
+            size_t index = s.index;
+            int16_t x = s.x;
+            int32_t depth = s.depth;
+            float r = s.r, g = s.g, b = s.b;
 
-            if (dy1)
+            for (uint16_t n = s.count; n > 0; --n, ++index, ++x, depth += s.depthStep)
             {
-                for (int16_t y = y0; y <= y1; ++y)
+                bool pass = true;
+                if (Op::shadowReceiver)
+                    pass = zBuffer->shadowPixel(index, depth);
+                else if (Op::depthTest && Op::depthWrite)
+                    pass = zBuffer->testAndSetAt(index, depth);
+                else if (Op::depthTest)
+                    pass = zBuffer->testAt(index, depth);
+                else if (Op::depthWrite)
+                    zBuffer->writeAt(index, depth);
+
+#if ENABLE_FILL_STATS
+                failed += pass ? 0u : 1u;
+                if (heat && heat[index] != 0xFF)
+                    ++heat[index];
+#endif
+
+                if (pass)
                 {
-                    if (unlikely(y < bandStartY || y > bandEndY))
+                    if (Op::blend == RasterBlend::Alpha)
                     {
-                        ax += dax_step;
-                        az += daz_step;
-                        bx += dbx_step;
-                        bz += dbz_step;
-                        continue;
+                        const uint16_t bgColor = PixelFormat::decode(frameBuffer[index]);
+                        const uint16_t br = (bgColor >> 11) & 0x1F;
+                        const uint16_t bgc = (bgColor >> 5) & 0x3F;
+                        const uint16_t bb = bgColor & 0x1F;
+
+                        const uint16_t rr = (br * invAlpha + sr * alpha) >> 8;
+                        const uint16_t gg = (bgc * invAlpha + sg * alpha) >> 8;
+                        const uint16_t bbb = (bb * invAlpha + sb * alpha) >> 8;
+                        frameBuffer[index] = PixelFormat::encode((rr << 11) | (gg << 5) | bbb);
                     }
-
-                    int16_t xa = (int16_t)(ax + 0.5f);
-                    int16_t xb = (int16_t)(bx + 0.5f);
-                    float za = az;
-                    float zb = bz;
-                    if (xa > xb)
+                    else if (Op::gouraud)
                     {
-                        std::swap(xa, xb);
-                        std::swap(za, zb);
+                        frameBuffer[index] = Op::dither ? Shading::applyDithering(r, g, b, x, s.y)
+                                                        : Shading::packColor(r, g, b);
                     }
-
-                    int16_t x_start_src = (xa < 0) ? 0 : xa;
-                    int16_t x_end_src = (xb >= width) ? width - 1 : xb;
-
-                    if (x_start_src <= x_end_src && x_start_src < width && x_end_src >= 0)
+                    else
                     {
-                        int16_t x_start = x_start_src;
-                        int16_t x_end = x_end_src;
-                        if (x_start > 0)
-                            --x_start;
-                        if (x_end < width - 1)
-                            ++x_end;
-
-                        uint8_t edgeAlpha = alpha;
-                        if (softEdges)
-                        {
-                            float edgeDist = 1.0f;
-                            if (y == y0 || y == y2)
-                                edgeDist = 0.5f;
-                            if (x_start_src == xa || x_end_src == xb)
-                                edgeDist *= 0.7f;
-                            edgeAlpha = (uint8_t)(alpha * edgeDist);
-                        }
-
-                        const uint16_t invEdgeAlpha = 255 - edgeAlpha;
-
-                        float dx = (float)(xb - xa);
-                        float invDx = dx != 0.0f ? 1.0f / dx : 0.0f;
-                        float z_step = (zb - za) * invDx;
-                        float z = za + z_step * (float)(x_start - xa);
-
-                        int32_t depthStep = static_cast<int32_t>(z_step * depthScale);
-                        int32_t depth = static_cast<int32_t>(z * depthScale);
-
-                        int16_t yLocal = static_cast<int16_t>(y - offsetY);
-                        size_t index = (size_t)yLocal * width + x_start;
-                        int16_t *__restrict__ zbRow = zbBase + static_cast<size_t>(y) * width;
-
-                        for (int16_t x = x_start; x <= x_end; ++x, ++index)
-                        {
-                            const int16_t stored = zbRow[x];
-                            const int16_t depthNoShadow = static_cast<int16_t>(stored & invShadowMask);
-
-                            if (depthNoShadow == clearDepth || (stored & shadowMask) != 0)
-                            {
-                                depth += depthStep;
-                                continue;
-                            }
-
-                            const int16_t shadowDepth = static_cast<int16_t>(depth);
-                            if (shadowDepth > depthNoShadow)
-                            {
-                                depth += depthStep;
-                                continue;
-                            }
-
-                            uint16_t bgColor = frameBuffer[index];
-                            uint16_t br = (bgColor >> 11) & 0x1F;
-                            uint16_t bg = (bgColor >> 5) & 0x3F;
-                            uint16_t bb = bgColor & 0x1F;
-
-                            uint16_t r = (br * invEdgeAlpha + sr * edgeAlpha) >> 8;
-                            uint16_t g = (bg * invEdgeAlpha + sg * edgeAlpha) >> 8;
-                            uint16_t b = (bb * invEdgeAlpha + sb * edgeAlpha) >> 8;
-
-                            frameBuffer[index] = (r << 11) | (g << 5) | b;
-                            zbRow[x] = static_cast<int16_t>(stored | shadowMask);
-
-                            depth += depthStep;
-                        }
+                        frameBuffer[index] = s.color;
                     }
-
-                    ax += dax_step;
-                    az += daz_step;
-                    bx += dbx_step;
-                    bz += dbz_step;
                 }
-            }
 
-            dy1 = y2 - y1;
-            if (dy1)
-            {
-                float invDy1 = 1.0f / dy1;
-                dax_step = (float)(x2 - x1) * invDy1;
-                daz_step = (z2 - z1) * invDy1;
-                ax = x1;
-                az = z1;
-
-                for (int16_t y = y1 + 1; y <= y2; ++y)
+                if (Op::gouraud)
                 {
-                    if (y < bandStartY || y > bandEndY)
-                    {
-                        ax += dax_step;
-                        az += daz_step;
-                        bx += dbx_step;
-                        bz += dbz_step;
-                        continue;
-                    }
-
-                    int16_t xa = (int16_t)(ax + 0.5f);
-                    int16_t xb = (int16_t)(bx + 0.5f);
-                    float za = az;
-                    float zb = bz;
-                    if (xa > xb)
-                    {
-                        std::swap(xa, xb);
-                        std::swap(za, zb);
-                    }
-
-                    int16_t x_start_src = (xa < 0) ? 0 : xa;
-                    int16_t x_end_src = (xb >= width) ? width - 1 : xb;
-
-                    if (x_start_src <= x_end_src && x_start_src < width && x_end_src >= 0)
-                    {
-                        int16_t x_start = x_start_src;
-                        int16_t x_end = x_end_src;
-                        if (x_start > 0)
-                            --x_start;
-                        if (x_end < width - 1)
-                            ++x_end;
-
-                        uint8_t edgeAlpha = alpha;
-                        if (softEdges)
-                        {
-                            float edgeDist = 1.0f;
-                            if (y == y0 || y == y2)
-                                edgeDist = 0.5f;
-                            if (x_start_src == xa || x_end_src == xb)
-                                edgeDist *= 0.7f;
-                            edgeAlpha = (uint8_t)(alpha * edgeDist);
-                        }
-
-                        const uint16_t invEdgeAlpha = 255 - edgeAlpha;
-
-                        float dx = (float)(xb - xa);
-                        float invDx = dx != 0.0f ? 1.0f / dx : 0.0f;
-                        float z_step = (zb - za) * invDx;
-                        float z = za + z_step * (float)(x_start - xa);
-
-                        int32_t depthStep = static_cast<int32_t>(z_step * depthScale);
-                        int32_t depth = static_cast<int32_t>(z * depthScale);
-
-                        size_t index = (size_t)y * width + x_start;
-                        int16_t *__restrict__ zbRow = zbBase + static_cast<size_t>(y) * width;
-
-                        for (int16_t x = x_start; x <= x_end; ++x, ++index)
-                        {
-                            const int16_t stored = zbRow[x];
-                            const int16_t depthNoShadow = static_cast<int16_t>(stored & invShadowMask);
-
-                            if (depthNoShadow == clearDepth || (stored & shadowMask) != 0)
-                            {
-                                depth += depthStep;
-                                continue;
-                            }
-
-                            const int16_t shadowDepth = static_cast<int16_t>(depth);
-                            if (shadowDepth > depthNoShadow)
-                            {
-                                depth += depthStep;
-                                continue;
-                            }
-
-                            uint16_t bgColor = frameBuffer[index];
-                            uint16_t br = (bgColor >> 11) & 0x1F;
-                            uint16_t bg = (bgColor >> 5) & 0x3F;
-                            uint16_t bb = bgColor & 0x1F;
-
-                            uint16_t r = (br * invEdgeAlpha + sr * edgeAlpha) >> 8;
-                            uint16_t g = (bg * invEdgeAlpha + sg * edgeAlpha) >> 8;
-                            uint16_t b = (bb * invEdgeAlpha + sb * edgeAlpha) >> 8;
-
-                            frameBuffer[index] = (r << 11) | (g << 5) | b;
-                            zbRow[x] = static_cast<int16_t>(stored | shadowMask);
-
-                            depth += depthStep;
-                        }
-                    }
-
-                    ax += dax_step;
-                    az += daz_step;
-                    bx += dbx_step;
-                    bz += dbz_step;
+                    r += s.rStep;
+                    g += s.gStep;
+                    b += s.bStep;
                 }
             }
+
+#if ENABLE_FILL_STATS
+            FillStats::addSpan(s.count, failed, Op::blend == RasterBlend::Alpha);
+#endif
         }
 
-        __attribute__((always_inline, hot)) static inline void IRAM_ATTR fillTriangleSmooth(int16_t x0, int16_t y0, float z0,
-                                                                                            int16_t x1, int16_t y1, float z1,
-                                                                                            int16_t x2, int16_t y2, float z2,
-                                                                                            float r0, float g0, float b0,
-                                                                                            float r1, float g1, float b1,
-                                                                                            float r2, float g2, float b2,
-                                                                                            uint16_t *frameBuffer,
-                                                                                            ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
-                                                                                            const DisplayConfig &config)
+        static void IRAM_ATTR fillShadowTriangle(int16_t x0, int16_t y0, float z0,
+                                                 int16_t x1, int16_t y1, float z1,
+                                                 int16_t x2, int16_t y2, float z2,
+                                                 uint16_t shadowColor,
+                                                 uint8_t alpha,
+                                                 uint16_t *frameBuffer,
+                                                 DepthBuffer *zBuffer,
+                                                 const DisplayConfig &config,
+                                                 bool softEdges = true,
+                                                 int16_t offsetY = 0,
+                                                 int16_t bandHeight = -1)
         {
-            const int16_t width = config.width;
-            const int16_t height = config.height;
-
-            const float depthScale = 32767.0f;
+#if ENABLE_FILL_STATS
+            FillStats::addTriangle();
+#endif
+#if PIP3D_RASTER_FIXED_POINT
+            FixedRasterizer::fillShadowTriangle(x0, y0, z0, x1, y1, z1, x2, y2, z2,
+                                                shadowColor, alpha, frameBuffer, zBuffer, config,
+                                                softEdges, offsetY, bandHeight);
+            return;
+#endif
+            if (softEdges)
+                shadowTriangle<true>(x0, y0, z0, x1, y1, z1, x2, y2, z2, shadowColor, alpha,
+                                     frameBuffer, zBuffer, config, offsetY, bandHeight);
+            else
+                shadowTriangle<false>(x0, y0, z0, x1, y1, z1, x2, y2, z2, shadowColor, alpha,
+                                      frameBuffer, zBuffer, config, offsetY, bandHeight);
+        }
 
+        __attribute__((hot)) static void IRAM_ATTR fillTriangleSmooth(int16_t x0, int16_t y0, float z0,
+                                                                      int16_t x1, int16_t y1, float z1,
+                                                                      int16_t x2, int16_t y2, float z2,
+                                                                      float r0, float g0, float b0,
+                                                                      float r1, float g1, float b1,
+                                                                      float r2, float g2, float b2,
+                                                                      uint16_t *frameBuffer,
+                                                                      DepthBuffer *zBuffer,
+                                                                      const DisplayConfig &config)
+        {
+#if ENABLE_FILL_STATS
+            FillStats::addTriangle();
+#endif
+#if PIP3D_RASTER_FIXED_POINT
+            FixedRasterizer::fillTriangleSmooth(x0, y0, z0, x1, y1, z1, x2, y2, z2,
+                                                r0, g0, b0, r1, g1, b1, r2, g2, b2,
+                                                frameBuffer, zBuffer, config);
+            return;
+#endif
             if (!frameBuffer || !zBuffer)
                 return;
 
-            if (y0 > y1)
-            {
-                std::swap(x0, x1);
-                std::swap(y0, y1);
-                std::swap(z0, z1);
-                std::swap(r0, r1);
-                std::swap(g0, g1);
-                std::swap(b0, b1);
-            }
-            if (y1 > y2)
-            {
-                std::swap(x1, x2);
-                std::swap(y1, y2);
-                std::swap(z1, z2);
-                std::swap(r1, r2);
-                std::swap(g1, g2);
-                std::swap(b1, b2);
-            }
-            if (y0 > y1)
-            {
-                std::swap(x0, x1);
-                std::swap(y0, y1);
-                std::swap(z0, z1);
-                std::swap(r0, r1);
-                std::swap(g0, g1);
-                std::swap(b0, b1);
-            }
+            SmoothRows rows(frameBuffer, zBuffer, clipWidth(config));
+            const float a0[4] = {z0, r0, g0, b0};
+            const float a1[4] = {z1, r1, g1, b1};
+            const float a2[4] = {z2, r2, g2, b2};
+            walk<4>(rows, x0, y0, a0, x1, y1, a1, x2, y2, a2, 0, static_cast<int16_t>(clipHeight(config) - 1));
+        }
 
-            if (y0 == y2)
-                return;
-            if (x0 == x1 && x1 == x2)
+        __attribute__((hot)) static void IRAM_ATTR fillTriangle(int16_t x0, int16_t y0, float z0,
+                                                                int16_t x1, int16_t y1, float z1,
+                                                                int16_t x2, int16_t y2, float z2,
+                                                                uint16_t color,
+                                                                uint16_t *frameBuffer,
+                                                                DepthBuffer *zBuffer,
+                                                                const DisplayConfig &config)
+        {
+#if ENABLE_FILL_STATS
+            FillStats::addTriangle();
+#endif
+#if PIP3D_RASTER_FIXED_POINT
+            FixedRasterizer::fillTriangle(x0, y0, z0, x1, y1, z1, x2, y2, z2,
+                                          color, frameBuffer, zBuffer, config);
+            return;
+#endif
+            if (!frameBuffer || !zBuffer)
                 return;
 
-            int16_t dy1 = y1 - y0;
-            int16_t dy2 = y2 - y0;
-            if (dy1 == 0 && dy2 == 0)
-                return;
+            FlatRows rows(frameBuffer, zBuffer, clipWidth(config), color);
+            walk<1>(rows, x0, y0, &z0, x1, y1, &z1, x2, y2, &z2, 0, static_cast<int16_t>(clipHeight(config) - 1));
+        }
 
-            float dax_step = 0, dbx_step = 0;
-            float dz1_step = 0, dz2_step = 0;
-            float dr1_step = 0, dg1_step = 0, db1_step = 0;
-            float dr2_step = 0, dg2_step = 0, db2_step = 0;
+        // Vertices carry q = 1/w and texture coordinates in texels. modulate
+        // is an RGB565 tint multiplied into each texel, 0xFFFF for none. The
+        // fixed point build draws textured triangles through this path too.
+        __attribute__((hot)) static void IRAM_ATTR fillTriangleTextured(int16_t x0, int16_t y0, float z0, float q0, float u0, float v0,
+                                                                        int16_t x1, int16_t y1, float z1, float q1, float u1, float v1,
+                                                                        int16_t x2, int16_t y2, float z2, float q2, float u2, float v2,
+                                                                        const Texture &texture,
+                                                                        uint16_t modulate,
+                                                                        uint16_t *frameBuffer,
+                                                                        DepthBuffer *zBuffer,
+                                                                        const DisplayConfig &config)
+        {
+#if ENABLE_FILL_STATS
+            FillStats::addTriangle();
+#endif
+            if (!frameBuffer || !zBuffer || !texture.isValid())
+                return;
 
-            if (dy1)
+            // u/w and v/w are linear in screen space, u and v are not.
+            const float a0[4] = {z0, q0, u0 * q0, v0 * q0};
+            const float a1[4] = {z1, q1, u1 * q1, v1 * q1};
+            const float a2[4] = {z2, q2, u2 * q2, v2 * q2};
+            const int16_t bottom = static_cast<int16_t>(clipHeight(config) - 1);
+            const bool tinted = modulate != 0xFFFF;
+            if (texture.format() == TEXTURE_PAL8)
             {
-                float invDy1 = 1.0f / dy1;
-                dax_step = (float)(x1 - x0) * invDy1;
-                dz1_step = (z1 - z0) * invDy1;
-                dr1_step = (r1 - r0) * invDy1;
-                dg1_step = (g1 - g0) * invDy1;
-                db1_step = (b1 - b0) * invDy1;
+                if (tinted)
+                {
+                    TexturedRows<TEXTURE_PAL8, true> rows(frameBuffer, zBuffer, clipWidth(config), texture, modulate);
+                    walk<4>(rows, x0, y0, a0, x1, y1, a1, x2, y2, a2, 0, bottom);
+                }
+                else
+                {
+                    TexturedRows<TEXTURE_PAL8, false> rows(frameBuffer, zBuffer, clipWidth(config), texture, modulate);
+                    walk<4>(rows, x0, y0, a0, x1, y1, a1, x2, y2, a2, 0, bottom);
+                }
             }
-            if (dy2)
+            else if (tinted)
             {
-                float invDy2 = 1.0f / dy2;
-                dbx_step = (float)(x2 - x0) * invDy2;
-                dz2_step = (z2 - z0) * invDy2;
-                dr2_step = (r2 - r0) * invDy2;
-                dg2_step = (g2 - g0) * invDy2;
-                db2_step = (b2 - b0) * invDy2;
+                TexturedRows<TEXTURE_RGB565, true> rows(frameBuffer, zBuffer, clipWidth(config), texture, modulate);
+                walk<4>(rows, x0, y0, a0, x1, y1, a1, x2, y2, a2, 0, bottom);
             }
-
-            float ax = x0, bx = x0;
-            float az = z0, bz = z0;
-            float ar = r0, ag = g0, ab = b0;
-            float br = r0, bg = g0, bb = b0;
-
-            if (dy1)
+            else
             {
-                for (int16_t y = y0; y <= y1; y++)
-                {
-                    if (y < 0 || y >= height)
-                    {
-                        ax += dax_step;
-                        az += dz1_step;
-                        ar += dr1_step;
-                        ag += dg1_step;
-                        ab += db1_step;
-                        bx += dbx_step;
-                        bz += dz2_step;
-                        br += dr2_step;
-                        bg += dg2_step;
-                        bb += db2_step;
-                        continue;
-                    }
-
-                    int16_t xa = (int16_t)(ax + 0.5f);
-                    int16_t xb = (int16_t)(bx + 0.5f);
-                    float za = az, zb = bz;
-                    float ra = ar, ga = ag, ba = ab;
-                    float rb = br, gb = bg, bb2 = bb;
-
-                    if (xa > xb)
-                    {
-                        std::swap(xa, xb);
-                        std::swap(za, zb);
-                        std::swap(ra, rb);
-                        std::swap(ga, gb);
-                        std::swap(ba, bb2);
-                    }
+                TexturedRows<TEXTURE_RGB565, false> rows(frameBuffer, zBuffer, clipWidth(config), texture, modulate);
+                walk<4>(rows, x0, y0, a0, x1, y1, a1, x2, y2, a2, 0, bottom);
+            }
+        }
 
-                    int16_t x_start = (xa < 0) ? 0 : xa;
-                    int16_t x_end = (xb >= width) ? width - 1 : xb;
+    private:
+        static constexpr float DEPTH_SCALE = 32767.0f;
+        // Texture coordinates are stepped in 16.16 texels and kept within
+        // +-16383 texels so endpoint differences fit.
+        static constexpr float TEXEL_LIMIT = 16383.0f;
+        static constexpr float MIN_Q = 1e-6f;
 
-                    if (x_start <= x_end && x_start < width && x_end >= 0)
-                    {
-                        float dx = (float)(xb - xa);
-                        float invDx = dx != 0.0f ? 1.0f / dx : 0.0f;
-                        float z_step = (zb - za) * invDx;
-                        float r_step = (rb - ra) * invDx;
-                        float g_step = (gb - ga) * invDx;
-                        float b_step = (bb2 - ba) * invDx;
-
-                        float offset = (float)(x_start - xa);
-                        float z = za + z_step * offset;
-                        float r = ra + r_step * offset;
-                        float g = ga + g_step * offset;
-                        float b = ba + b_step * offset;
-
-                        int32_t depthStep = static_cast<int32_t>(z_step * depthScale);
-                        int32_t depth = static_cast<int32_t>(z * depthScale);
-
-                        size_t index = (size_t)y * width + x_start;
-                        uint16_t span = (uint16_t)(x_end - x_start + 1);
-                        int16_t x = x_start;
-
-                        while (span >= 4)
-                        {
-                            if (zBuffer->testAndSet(x, y, depth))
-                            {
-                                frameBuffer[index] = Shading::applyDithering(r, g, b, x, y);
-                            }
-                            depth += depthStep;
-                            r += r_step;
-                            g += g_step;
-                            b += b_step;
-                            index++;
-                            x++;
-
-                            if (zBuffer->testAndSet(x, y, depth))
-                            {
-                                frameBuffer[index] = Shading::applyDithering(r, g, b, x, y);
-                            }
-                            depth += depthStep;
-                            r += r_step;
-                            g += g_step;
-                            b += b_step;
-                            index++;
-                            x++;
-
-                            if (zBuffer->testAndSet(x, y, depth))
-                            {
-                                frameBuffer[index] = Shading::applyDithering(r, g, b, x, y);
-                            }
-                            depth += depthStep;
-                            r += r_step;
-                            g += g_step;
-                            b += b_step;
-                            index++;
-                            x++;
-
-                            if (zBuffer->testAndSet(x, y, depth))
-                            {
-                                frameBuffer[index] = Shading::applyDithering(r, g, b, x, y);
-                            }
-                            depth += depthStep;
-                            r += r_step;
-                            g += g_step;
-                            b += b_step;
-                            index++;
-                            x++;
-
-                            span -= 4;
-                        }
-
-                        while (span > 0)
-                        {
-                            if (zBuffer->testAndSet(x, y, depth))
-                            {
-                                frameBuffer[index] = Shading::applyDithering(r, g, b, x, y);
-                            }
-                            depth += depthStep;
-                            r += r_step;
-                            g += g_step;
-                            b += b_step;
-                            index++;
-                            x++;
-                            span--;
-                        }
-                    }
-
-                    ax += dax_step;
-                    az += dz1_step;
-                    ar += dr1_step;
-                    ag += dg1_step;
-                    ab += db1_step;
-                    bx += dbx_step;
-                    bz += dz2_step;
-                    br += dr2_step;
-                    bg += dg2_step;
-                    bb += db2_step;
-                }
-            }
+        struct TexturedSpan
+        {
+            size_t index;
+            uint16_t count;
+            int32_t depth;
+            int32_t depthStep;
+            float q, uq, vq;
+            float qStep, uqStep, vqStep;
+        };
+
+        __attribute__((always_inline)) static inline int32_t texelFixed(float t)
+        {
+            t = t > TEXEL_LIMIT ? TEXEL_LIMIT : (t < -TEXEL_LIMIT ? -TEXEL_LIMIT : t);
+            return static_cast<int32_t>(t * 65536.0f);
+        }
 
-            dy1 = y2 - y1;
-            if (dy1)
+        // Divides out u and v every PIP3D_TEXTURE_SUBDIV pixels and steps
+        // them affinely in between, fetching from the tiled texels with
+        // wrap-around.
+        template <TextureFormat FORMAT, bool MODULATE>
+        __attribute__((hot)) static void IRAM_ATTR texturedSpan(const TexturedSpan &s, const Texture &texture, uint16_t modulate,
+                                                                uint16_t *__restrict frameBuffer, DepthBuffer *zBuffer)
+        {
+#if ENABLE_FILL_STATS
+            uint8_t *heat = FillStats::heatFor(frameBuffer);
+            uint32_t failed = 0;
+#endif
+            const uint8_t *texels = texture.texels();
+            const uint16_t *palette = texture.getPalette();
+            const uint8_t log2W = texture.log2Width();
+            const uint32_t maskU = texture.getWidth() - 1u;
+            const uint32_t maskV = texture.getHeight() - 1u;
+            const uint16_t mr = static_cast<uint16_t>(((modulate >> 11) & 0x1F) + 1);
+            const uint16_t mg = static_cast<uint16_t>(((modulate >> 5) & 0x3F) + 1);
+            const uint16_t mb = static_cast<uint16_t>((modulate & 0x1F) + 1);
+
+            size_t index = s.index;
+            int32_t depth = s.depth;
+            float q = s.q, uq = s.uq, vq = s.vq;
+            zBuffer->noteSpanAt(s.index, s.count);
+            float w = 1.0f / fmaxf(q, MIN_Q);
+            int32_t u = texelFixed(uq * w);
+            int32_t v = texelFixed(vq * w);
+
+            for (uint16_t left = s.count; left > 0;)
             {
-                float invDy1 = 1.0f / dy1;
-                dax_step = (float)(x2 - x1) * invDy1;
-                dz1_step = (z2 - z1) * invDy1;
-                dr1_step = (r2 - r1) * invDy1;
-                dg1_step = (g2 - g1) * invDy1;
-                db1_step = (b2 - b1) * invDy1;
-
-                ax = x1;
-                az = z1;
-                ar = r1;
-                ag = g1;
-                ab = b1;
-                bx = x0 + dbx_step * (float)(y1 - y0);
-                bz = z0 + dz2_step * (float)(y1 - y0);
-                br = r0 + dr2_step * (float)(y1 - y0);
-                bg = g0 + dg2_step * (float)(y1 - y0);
-                bb = b0 + db2_step * (float)(y1 - y0);
-
-                for (int16_t y = y1 + 1; y <= y2; y++)
+                const uint16_t n = left < PIP3D_TEXTURE_SUBDIV ? left : PIP3D_TEXTURE_SUBDIV;
+                const float fn = static_cast<float>(n);
+                q += s.qStep * fn;
+                uq += s.uqStep * fn;
+                vq += s.vqStep * fn;
+                w = 1.0f / fmaxf(q, MIN_Q);
+                const int32_t uEnd = texelFixed(uq * w);
+                const int32_t vEnd = texelFixed(vq * w);
+                const int32_t du = (uEnd - u) / n;
+                const int32_t dv = (vEnd - v) / n;
+
+                for (uint16_t k = n; k > 0; --k, ++index, depth += s.depthStep, u += du, v += dv)
                 {
-                    if (y < 0 || y >= height)
-                    {
-                        ax += dax_step;
-                        az += dz1_step;
-                        ar += dr1_step;
-                        ag += dg1_step;
-                        ab += db1_step;
-                        bx += dbx_step;
-                        bz += dz2_step;
-                        br += dr2_step;
-                        bg += dg2_step;
-                        bb += db2_step;
+                    const bool pass = zBuffer->testAndSetAt(index, depth);
+#if ENABLE_FILL_STATS
+                    failed += pass ? 0u : 1u;
+                    if (heat && heat[index] != 0xFF)
+                        ++heat[index];
+#endif
+                    if (!pass)
                         continue;
-                    }
-
-                    int16_t xa = (int16_t)(ax + 0.5f);
-                    int16_t xb = (int16_t)(bx + 0.5f);
-                    float za = az, zb = bz;
-                    float ra = ar, ga = ag, ba = ab;
-                    float rb = br, gb = bg, bb2 = bb;
 
-                    if (xa > xb)
+                    const uint32_t offset = Texture::tiledOffset(static_cast<uint32_t>(u >> 16) & maskU,
+                                                                 static_cast<uint32_t>(v >> 16) & maskV, log2W);
+                    uint16_t c = FORMAT == TEXTURE_PAL8 ? palette[texels[offset]]
+                                                        : reinterpret_cast<const uint16_t *>(texels)[offset];
+                    if (MODULATE)
                     {
-                        std::swap(xa, xb);
-                        std::swap(za, zb);
-                        std::swap(ra, rb);
-                        std::swap(ga, gb);
-                        std::swap(ba, bb2);
+                        c = static_cast<uint16_t>(((((c >> 11) & 0x1F) * mr >> 5) << 11) |
+                                                  ((((c >> 5) & 0x3F) * mg >> 6) << 5) |
+                                                  ((c & 0x1F) * mb >> 5));
                     }
+                    frameBuffer[index] = PixelFormat::encode(c);
+                }
 
-                    int16_t x_start = (xa < 0) ? 0 : xa;
-                    int16_t x_end = (xb >= width) ? width - 1 : xb;
+                u = uEnd;
+                v = vEnd;
+                left = static_cast<uint16_t>(left - n);
+            }
 
-                    if (x_start <= x_end && x_start < width && x_end >= 0)
-                    {
-                        float dx = (float)(xb - xa);
-                        float invDx = dx != 0.0f ? 1.0f / dx : 0.0f;
-                        float z_step = (zb - za) * invDx;
-                        float r_step = (rb - ra) * invDx;
-                        float g_step = (gb - ga) * invDx;
-                        float b_step = (bb2 - ba) * invDx;
-
-                        float offset = (float)(x_start - xa);
-                        float z = za + z_step * offset;
-                        float r = ra + r_step * offset;
-                        float g = ga + g_step * offset;
-                        float b = ba + b_step * offset;
-
-                        int32_t depthStep = static_cast<int32_t>(z_step * depthScale);
-                        int32_t depth = static_cast<int32_t>(z * depthScale);
-
-                        size_t index = (size_t)y * width + x_start;
-                        uint16_t span = (uint16_t)(x_end - x_start + 1);
-                        int16_t x = x_start;
-
-                        while (span >= 4)
-                        {
-                            if (zBuffer->testAndSet(x, y, depth))
-                            {
-                                frameBuffer[index] = Shading::applyDithering(r, g, b, x, y);
-                            }
-                            depth += depthStep;
-                            r += r_step;
-                            g += g_step;
-                            b += b_step;
-                            index++;
-                            x++;
-
-                            if (zBuffer->testAndSet(x, y, depth))
-                            {
-                                frameBuffer[index] = Shading::applyDithering(r, g, b, x, y);
-                            }
-                            depth += depthStep;
-                            r += r_step;
-                            g += g_step;
-                            b += b_step;
-                            index++;
-                            x++;
-
-                            if (zBuffer->testAndSet(x, y, depth))
-                            {
-                                frameBuffer[index] = Shading::applyDithering(r, g, b, x, y);
-                            }
-                            depth += depthStep;
-                            r += r_step;
-                            g += g_step;
-                            b += b_step;
-                            index++;
-                            x++;
-
-                            if (zBuffer->testAndSet(x, y, depth))
-                            {
-                                frameBuffer[index] = Shading::applyDithering(r, g, b, x, y);
-                            }
-                            depth += depthStep;
-                            r += r_step;
-                            g += g_step;
-                            b += b_step;
-                            index++;
-                            x++;
-
-                            span -= 4;
-                        }
-
-                        while (span > 0)
-                        {
-                            if (zBuffer->testAndSet(x, y, depth))
-                            {
-                                frameBuffer[index] = Shading::applyDithering(r, g, b, x, y);
-                            }
-                            depth += depthStep;
-                            r += r_step;
-                            g += g_step;
-                            b += b_step;
-                            index++;
-                            x++;
-                            span--;
-                        }
-                    }
+#if ENABLE_FILL_STATS
+            FillStats::addSpan(s.count, failed, false);
+#endif
+        }
 
-                    ax += dax_step;
-                    az += dz1_step;
-                    ar += dr1_step;
-                    ag += dg1_step;
-                    ab += db1_step;
-                    bx += dbx_step;
-                    bz += dz2_step;
-                    br += dr2_step;
-                    bg += dg2_step;
-                    bb += db2_step;
-                }
-            }
+        // The depth buffer bounds the band as much as the config does.
+        __attribute__((always_inline)) static inline int16_t clipWidth(const DisplayConfig &config)
+        {
+            return config.width < SCREEN_WIDTH ? config.width : SCREEN_WIDTH;
         }
 
-        static void fillTriangle(int16_t x0, int16_t y0, float z0,
-                                 int16_t x1, int16_t y1, float z1,
-                                 int16_t x2, int16_t y2, float z2,
-                                 uint16_t color,
-                                 uint16_t *frameBuffer,
-                                 ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
-                                 const DisplayConfig &config)
+        __attribute__((always_inline)) static inline int16_t clipHeight(const DisplayConfig &config)
         {
-            const int16_t width = config.width;
-            const int16_t height = config.height;
+            return config.height < SCREEN_BAND_CAPACITY ? config.height : SCREEN_BAND_CAPACITY;
+        }
 
-            if (!frameBuffer || !zBuffer)
-                return;
+        // Walks the rows of a triangle within [clipTop, clipBottom] and hands
+        // each to rows.row() left to right. Vertices carry N attributes,
+        // depth first, stepped along the edges; rows outside the clip range
+        // are skipped at setup instead of tested one by one. The top row of
+        // a flat-topped triangle is left to its neighbour.
+        template <int N, class Rows>
+        __attribute__((always_inline)) static inline void walk(Rows &rows,
+                                                               int16_t x0, int16_t y0, const float *a0,
+                                                               int16_t x1, int16_t y1, const float *a1,
+                                                               int16_t x2, int16_t y2, const float *a2,
+                                                               int16_t clipTop, int16_t clipBottom)
+        {
             if (y0 > y1)
             {
                 std::swap(x0, x1);
                 std::swap(y0, y1);
-                std::swap(z0, z1);
+                std::swap(a0, a1);
             }
             if (y1 > y2)
             {
                 std::swap(x1, x2);
                 std::swap(y1, y2);
-                std::swap(z1, z2);
+                std::swap(a1, a2);
             }
             if (y0 > y1)
             {
                 std::swap(x0, x1);
                 std::swap(y0, y1);
-                std::swap(z0, z1);
+                std::swap(a0, a1);
             }
 
             if (y0 == y2)
@@ -726,122 +439,258 @@ namespace pip3D
             if (x0 == x1 && x1 == x2)
                 return;
 
-            int16_t dy1 = y1 - y0;
-            int16_t dy2 = y2 - y0;
-
-            if (dy1 == 0 && dy2 == 0)
-                return;
-
-            float dax_step = 0, dbx_step = 0;
-            float dz1_step = 0, dz2_step = 0;
+            const float invLong = 1.0f / (y2 - y0);
+            const float bxStep = (float)(x2 - x0) * invLong;
+            float bStep[N];
+            for (int k = 0; k < N; ++k)
+                bStep[k] = (a2[k] - a0[k]) * invLong;
 
-            if (dy1)
+            // Upper half along edge 0-1 including y1, lower half along 1-2.
+            for (int half = 0; half < 2; ++half)
             {
-                dax_step = (float)(x1 - x0) / dy1;
-                dz1_step = (z1 - z0) / dy1;
-            }
-            if (dy2)
-            {
-                dbx_step = (float)(x2 - x0) / dy2;
-                dz2_step = (z2 - z0) / dy2;
-            }
-
-            float ax = x0, bx = x0;
-            float az = z0, bz = z0;
+                const int16_t ys = half ? y1 : y0;
+                const int16_t ye = half ? y2 : y1;
+                if (ye == ys)
+                    continue;
+
+                int16_t first = half ? static_cast<int16_t>(y1 + 1) : y0;
+                int16_t last = ye;
+                if (first < clipTop)
+                    first = clipTop;
+                if (last > clipBottom)
+                    last = clipBottom;
+                if (first > last)
+                    continue;
+
+                const int16_t xs = half ? x1 : x0;
+                const int16_t xe = half ? x2 : x1;
+                const float *as = half ? a1 : a0;
+                const float *ae = half ? a2 : a1;
+
+                const float inv = 1.0f / (ye - ys);
+                const float axStep = (float)(xe - xs) * inv;
+                const float da = (float)(first - ys);
+                const float db = (float)(first - y0);
+
+                float ax = xs + axStep * da;
+                float bx = x0 + bxStep * db;
+                float aStep[N], av[N], bv[N];
+                for (int k = 0; k < N; ++k)
+                {
+                    aStep[k] = (ae[k] - as[k]) * inv;
+                    av[k] = as[k] + aStep[k] * da;
+                    bv[k] = a0[k] + bStep[k] * db;
+                }
 
-            if (dy1)
-            {
-                for (int16_t y = y0; y <= y1; y++)
+                for (int16_t y = first; y <= last; ++y)
                 {
-                    if (y < 0 || y >= height)
+                    const int16_t xa = (int16_t)(ax + 0.5f);
+                    const int16_t xb = (int16_t)(bx + 0.5f);
+                    if (xa <= xb)
+                        rows.row(y, xa, xb, av, bv);
+                    else
+                        rows.row(y, xb, xa, bv, av);
+
+                    ax += axStep;
+                    bx += bxStep;
+                    for (int k = 0; k < N; ++k)
                     {
-                        ax += dax_step;
-                        az += dz1_step;
-                        bx += dbx_step;
-                        bz += dz2_step;
-                        continue;
+                        av[k] += aStep[k];
+                        bv[k] += bStep[k];
                     }
+                }
+            }
+        }
 
-                    int16_t xa = (int16_t)(ax + 0.5f);
-                    int16_t xb = (int16_t)(bx + 0.5f);
-                    float za = az, zb = bz;
-
-                    if (xa > xb)
-                    {
-                        std::swap(xa, xb);
-                        std::swap(za, zb);
-                    }
+        struct FlatRows
+        {
+            uint16_t *frameBuffer;
+            DepthBuffer *zBuffer;
+            int16_t width;
+            uint16_t color;
 
-                    int16_t x_start = (xa < 0) ? 0 : xa;
-                    int16_t x_end = (xb >= width) ? width - 1 : xb;
+            FlatRows(uint16_t *fb, DepthBuffer *zb, int16_t w, uint16_t c)
+                : frameBuffer(fb), zBuffer(zb), width(w), color(c) {}
 
-                    if (x_start <= x_end && x_start < width && x_end >= 0)
-                    {
-                        float z_step = (xb - xa) != 0 ? (zb - za) / (xb - xa) : 0;
-                        float z = za + z_step * (x_start - xa);
+            __attribute__((always_inline)) inline void row(int16_t y, int16_t xa, int16_t xb, const float *a, const float *b)
+            {
+                const int16_t xs = xa < 0 ? 0 : xa;
+                const int16_t xe = xb >= width ? static_cast<int16_t>(width - 1) : xb;
+                if (xs > xe)
+                    return;
+
+                const float zStep = xb != xa ? (b[0] - a[0]) / (float)(xb - xa) : 0.0f;
+                const float z = a[0] + zStep * (float)(xs - xa);
+
+                RasterSpan s;
+                s.index = static_cast<size_t>(y) * width + xs;
+                s.count = static_cast<uint16_t>(xe - xs + 1);
+                s.x = xs;
+                s.y = y;
+                s.depth = static_cast<int32_t>(z * DEPTH_SCALE);
+                s.depthStep = static_cast<int32_t>(zStep * DEPTH_SCALE);
+                s.color = color;
+                span<RasterOpFlat>(s, frameBuffer, zBuffer);
+            }
+        };
 
-                        const float depthScale = 32767.0f;
-                        int32_t depthStep = static_cast<int32_t>(z_step * depthScale);
-                        int32_t depthStart = static_cast<int32_t>(z * depthScale);
-                        zBuffer->testAndSetScanline(y, x_start, x_end, depthStart, depthStep, frameBuffer, color);
-                    }
+        struct SmoothRows
+        {
+            uint16_t *frameBuffer;
+            DepthBuffer *zBuffer;
+            int16_t width;
 
-                    ax += dax_step;
-                    az += dz1_step;
-                    bx += dbx_step;
-                    bz += dz2_step;
-                }
-            }
+            SmoothRows(uint16_t *fb, DepthBuffer *zb, int16_t w)
+                : frameBuffer(fb), zBuffer(zb), width(w) {}
 
-            dy1 = y2 - y1;
-            if (dy1)
+            __attribute__((always_inline)) inline void row(int16_t y, int16_t xa, int16_t xb, const float *a, const float *b)
             {
-                dax_step = (float)(x2 - x1) / dy1;
-                dz1_step = (z2 - z1) / dy1;
-                ax = x1;
-                az = z1;
-
-                for (int16_t y = y1 + 1; y <= y2; y++)
-                {
-                    if (y < 0 || y >= height)
-                    {
-                        ax += dax_step;
-                        az += dz1_step;
-                        bx += dbx_step;
-                        bz += dz2_step;
-                        continue;
-                    }
+                const int16_t xs = xa < 0 ? 0 : xa;
+                const int16_t xe = xb >= width ? static_cast<int16_t>(width - 1) : xb;
+                if (xs > xe)
+                    return;
+
+                const float invDx = xb != xa ? 1.0f / (float)(xb - xa) : 0.0f;
+                const float zStep = (b[0] - a[0]) * invDx;
+                const float offset = (float)(xs - xa);
+
+                RasterSpan s;
+                s.index = static_cast<size_t>(y) * width + xs;
+                s.count = static_cast<uint16_t>(xe - xs + 1);
+                s.x = xs;
+                s.y = y;
+                s.depth = static_cast<int32_t>((a[0] + zStep * offset) * DEPTH_SCALE);
+                s.depthStep = static_cast<int32_t>(zStep * DEPTH_SCALE);
+                s.rStep = (b[1] - a[1]) * invDx;
+                s.gStep = (b[2] - a[2]) * invDx;
+                s.bStep = (b[3] - a[3]) * invDx;
+                s.r = a[1] + s.rStep * offset;
+                s.g = a[2] + s.gStep * offset;
+                s.b = a[3] + s.bStep * offset;
+                span<RasterOpSmooth>(s, frameBuffer, zBuffer);
+            }
+        };
 
-                    int16_t xa = (int16_t)(ax + 0.5f);
-                    int16_t xb = (int16_t)(bx + 0.5f);
-                    float za = az, zb = bz;
+        template <TextureFormat FORMAT, bool MODULATE>
+        struct TexturedRows
+        {
+            uint16_t *frameBuffer;
+            DepthBuffer *zBuffer;
+            int16_t width;
+            const Texture &texture;
+            uint16_t modulate;
 
-                    if (xa > xb)
-                    {
-                        std::swap(xa, xb);
-                        std::swap(za, zb);
-                    }
+            TexturedRows(uint16_t *fb, DepthBuffer *zb, int16_t w, const Texture &tex, uint16_t m)
+                : frameBuffer(fb), zBuffer(zb), width(w), texture(tex), modulate(m) {}
 
-                    int16_t x_start = (xa < 0) ? 0 : xa;
-                    int16_t x_end = (xb >= width) ? width - 1 : xb;
+            __attribute__((always_inline)) inline void row(int16_t y, int16_t xa, int16_t xb, const float *a, const float *b)
+            {
+                const int16_t xs = xa < 0 ? 0 : xa;
+                const int16_t xe = xb >= width ? static_cast<int16_t>(width - 1) : xb;
+                if (xs > xe)
+                    return;
+
+                const float invDx = xb != xa ? 1.0f / (float)(xb - xa) : 0.0f;
+                const float zStep = (b[0] - a[0]) * invDx;
+                const float offset = (float)(xs - xa);
+
+                TexturedSpan s;
+                s.index = static_cast<size_t>(y) * width + xs;
+                s.count = static_cast<uint16_t>(xe - xs + 1);
+                s.depth = static_cast<int32_t>((a[0] + zStep * offset) * DEPTH_SCALE);
+                s.depthStep = static_cast<int32_t>(zStep * DEPTH_SCALE);
+                s.qStep = (b[1] - a[1]) * invDx;
+                s.uqStep = (b[2] - a[2]) * invDx;
+                s.vqStep = (b[3] - a[3]) * invDx;
+                s.q = a[1] + s.qStep * offset;
+                s.uq = a[2] + s.uqStep * offset;
+                s.vq = a[3] + s.vqStep * offset;
+                texturedSpan<FORMAT, MODULATE>(s, texture, modulate, frameBuffer, zBuffer);
+            }
+        };
 
-                    if (x_start <= x_end && x_start < width && x_end >= 0)
-                    {
-                        float z_step = (xb - xa) != 0 ? (zb - za) / (xb - xa) : 0;
-                        float z = za + z_step * (x_start - xa);
+        // Rows widen by a pixel on each side to close gaps against the
+        // receiver; soft edges fade the outermost rows and unclipped ends.
+        template <bool SOFT_EDGES>
+        struct ShadowRows
+        {
+            uint16_t *frameBuffer;
+            DepthBuffer *zBuffer;
+            int16_t width;
+            int16_t offsetY;
+            int16_t top;
+            int16_t bottom;
+            uint16_t color;
+            uint8_t alpha;
+
+            __attribute__((always_inline)) inline void row(int16_t y, int16_t xa, int16_t xb, const float *a, const float *b)
+            {
+                const int16_t xsSrc = xa < 0 ? 0 : xa;
+                const int16_t xeSrc = xb >= width ? static_cast<int16_t>(width - 1) : xb;
+                if (xsSrc > xeSrc)
+                    return;
 
-                        const float depthScale = 32767.0f;
-                        int32_t depthStep = static_cast<int32_t>(z_step * depthScale);
-                        int32_t depthStart = static_cast<int32_t>(z * depthScale);
-                        zBuffer->testAndSetScanline(y, x_start, x_end, depthStart, depthStep, frameBuffer, color);
-                    }
+                const int16_t xs = xsSrc > 0 ? static_cast<int16_t>(xsSrc - 1) : xsSrc;
+                const int16_t xe = xeSrc < width - 1 ? static_cast<int16_t>(xeSrc + 1) : xeSrc;
 
-                    ax += dax_step;
-                    az += dz1_step;
-                    bx += dbx_step;
-                    bz += dz2_step;
+                uint8_t edgeAlpha = alpha;
+                if (SOFT_EDGES)
+                {
+                    float edgeDist = 1.0f;
+                    if (y == top || y == bottom)
+                        edgeDist = 0.5f;
+                    if (xsSrc == xa || xeSrc == xb)
+                        edgeDist *= 0.7f;
+                    edgeAlpha = (uint8_t)(alpha * edgeDist);
                 }
+
+                const float zStep = xb != xa ? (b[0] - a[0]) / (float)(xb - xa) : 0.0f;
+                const float z = a[0] + zStep * (float)(xs - xa);
+                const int16_t yLocal = static_cast<int16_t>(y - offsetY);
+
+                RasterSpan s;
+                s.index = static_cast<size_t>(yLocal) * width + xs;
+                s.count = static_cast<uint16_t>(xe - xs + 1);
+                s.x = xs;
+                s.y = yLocal;
+                s.depth = static_cast<int32_t>(z * DEPTH_SCALE);
+                s.depthStep = static_cast<int32_t>(zStep * DEPTH_SCALE);
+                s.color = color;
+                s.alpha = edgeAlpha;
+                span<RasterOpShadow>(s, frameBuffer, zBuffer);
             }
+        };
+
+        template <bool SOFT_EDGES>
+        __attribute__((always_inline)) static inline void shadowTriangle(int16_t x0, int16_t y0, float z0,
+                                                                         int16_t x1, int16_t y1, float z1,
+                                                                         int16_t x2, int16_t y2, float z2,
+                                                                         uint16_t shadowColor,
+                                                                         uint8_t alpha,
+                                                                         uint16_t *frameBuffer,
+                                                                         DepthBuffer *zBuffer,
+                                                                         const DisplayConfig &config,
+                                                                         int16_t offsetY,
+                                                                         int16_t bandHeight)
+        {
+            if (!frameBuffer || !zBuffer)
+                return;
+
+            const int16_t height = clipHeight(config);
+            if (bandHeight <= 0 || bandHeight > height)
+                bandHeight = height;
+
+            ShadowRows<SOFT_EDGES> rows;
+            rows.frameBuffer = frameBuffer;
+            rows.zBuffer = zBuffer;
+            rows.width = clipWidth(config);
+            rows.offsetY = offsetY;
+            rows.top = std::min(y0, std::min(y1, y2));
+            rows.bottom = std::max(y0, std::max(y1, y2));
+            rows.color = shadowColor;
+            rows.alpha = alpha;
+            walk<1>(rows, x0, y0, &z0, x1, y1, &z1, x2, y2, &z2,
+                    offsetY, static_cast<int16_t>(offsetY + bandHeight - 1));
         }
     };
 
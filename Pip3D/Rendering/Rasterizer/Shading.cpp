@@ -1,9 +0,0 @@
-#include "Shading.h"
-
-namespace pip3D
-{
-
-    float Shading::GAMMA_LUT[256];
-    bool Shading::lutInitialized = false;
-
-}
@@ -3,6 +3,7 @@
 
 #include "../../Core/Core.h"
 #include "../../Math/Math.h"
+#include "../../Math/ConstMath.h"
 #include "../Lighting/Lighting.h"
 #include "../Display/ZBuffer.h"
 
@@ -33,32 +34,56 @@ namespace pip3D
         static constexpr float INV_HDR_EXPOSURE = 1.0f / HDR_EXPOSURE;
         static constexpr float SATURATION_LUM_FACTOR = SATURATION - 1.0f;
 
-        // LUT для гамма-коррекции (sqrt) - 256 значений
-        static float GAMMA_LUT[256];
-        static bool lutInitialized;
+        // Saturation and contrast folded into one linear mix of the gamma
+        // corrected channels: out = TONE_SELF * c - sum(TONE_LUM_* * c) + offset.
+        static constexpr float TONE_SELF = CONTRAST * SATURATION;
+        static constexpr float TONE_LUM_R = CONTRAST * SATURATION_LUM_FACTOR * 0.299f;
+        static constexpr float TONE_LUM_G = CONTRAST * SATURATION_LUM_FACTOR * 0.587f;
+        static constexpr float TONE_LUM_B = CONTRAST * SATURATION_LUM_FACTOR * 0.114f;
 
-        static void initLUT()
+        // Reinhard + gamma over linear radiance [0, TONE_LUT_RANGE), sampled
+        // with linear interpolation; brighter inputs are evaluated directly.
+        static constexpr int TONE_LUT_SIZE = 256;
+        static constexpr float TONE_LUT_RANGE = 4.0f;
+        static constexpr float TONE_LUT_SCALE = TONE_LUT_SIZE / TONE_LUT_RANGE;
+
+        __attribute__((always_inline)) static inline float toneCurve(float x)
         {
-            if (lutInitialized)
-                return;
-            for (int i = 0; i < 256; i++)
-            {
-                float val = i / 255.0f;
-                GAMMA_LUT[i] = sqrtf(val);
-            }
-            lutInitialized = true;
+            return sqrtf(x / (INV_HDR_EXPOSURE + x));
         }
 
-        __attribute__((always_inline)) static inline float fastSqrt01(float x)
+        static constexpr float toneSample(uint16_t i)
+        {
+            return static_cast<float>(ConstMath::sqrt((i / (double)TONE_LUT_SCALE) /
+                                                      (INV_HDR_EXPOSURE + i / (double)TONE_LUT_SCALE)));
+        }
+
+        // The tone table is built by the compiler and stays in flash, so
+        // nothing has to run before the first frame.
+        template <class Samples>
+        struct ToneLut;
+
+        template <uint16_t... Is>
+        struct ToneLut<ConstMath::Indices<Is...>>
+        {
+            static constexpr float values[sizeof...(Is)] = {toneSample(Is)...};
+        };
+
+        typedef ToneLut<ConstMath::MakeIndices<TONE_LUT_SIZE + 1>::type> ToneTable;
+
+        __attribute__((always_inline)) static inline float toneMap(float x)
         {
             if (x <= 0.0f)
                 return 0.0f;
-            if (x >= 1.0f)
-                return 1.0f;
 
-            // Используем LUT для быстрого sqrt
-            int idx = (int)(x * 255.0f);
-            return GAMMA_LUT[idx];
+            const float t = x * TONE_LUT_SCALE;
+            if (unlikely(t >= (float)TONE_LUT_SIZE))
+                return toneCurve(x);
+
+            const int idx = (int)t;
+            const float frac = t - (float)idx;
+            const float *lut = ToneTable::values;
+            return lut[idx] + (lut[idx + 1] - lut[idx]) * frac;
         }
 
         __attribute__((always_inline, hot)) static inline void IRAM_ATTR calculateLighting(
@@ -195,26 +220,16 @@ namespace pip3D
             outG += baseG * rimAmount;
             outB += baseB * rimAmount;
 
-            // HDR tone mapping (Reinhard)
-            outR = outR / (INV_HDR_EXPOSURE + outR);
-            outG = outG / (INV_HDR_EXPOSURE + outG);
-            outB = outB / (INV_HDR_EXPOSURE + outB);
-
-            // Gamma correction через LUT
-            outR = fastSqrt01(outR);
-            outG = fastSqrt01(outG);
-            outB = fastSqrt01(outB);
-
-            // Saturation
-            float lum = outR * 0.299f + outG * 0.587f + outB * 0.114f;
-            outR += (outR - lum) * SATURATION_LUM_FACTOR;
-            outG += (outG - lum) * SATURATION_LUM_FACTOR;
-            outB += (outB - lum) * SATURATION_LUM_FACTOR;
+            // HDR tone mapping (Reinhard) + gamma через LUT
+            outR = toneMap(outR);
+            outG = toneMap(outG);
+            outB = toneMap(outB);
 
-            // Contrast
-            outR = outR * CONTRAST + CONTRAST_OFFSET;
-            outG = outG * CONTRAST + CONTRAST_OFFSET;
-            outB = outB * CONTRAST + CONTRAST_OFFSET;
+            // Saturation + contrast
+            const float lumTerm = outR * TONE_LUM_R + outG * TONE_LUM_G + outB * TONE_LUM_B - CONTRAST_OFFSET;
+            outR = outR * TONE_SELF - lumTerm;
+            outG = outG * TONE_SELF - lumTerm;
+            outB = outB * TONE_SELF - lumTerm;
 
             // Clamp
             outR = (outR < 0.0f) ? 0.0f : ((outR > 1.0f) ? 1.0f : outR);
@@ -244,10 +259,48 @@ namespace pip3D
             uint16_t gc = (ig > 63) ? 63 : ((ig < 0) ? 0 : ig);
             uint16_t bc = (ib > 31) ? 31 : ((ib < 0) ? 0 : ib);
 
-            return (rc << 11) | (gc << 5) | bc;
+            return PixelFormat::encode((rc << 11) | (gc << 5) | bc);
+        }
+
+        // Rounded RGB565 in the framebuffer format, for spans without dithering.
+        __attribute__((always_inline, hot)) static inline uint16_t IRAM_ATTR packColor(float r, float g, float b)
+        {
+            const int ir = (int)(r * 31.0f + 0.5f);
+            const int ig = (int)(g * 63.0f + 0.5f);
+            const int ib = (int)(b * 31.0f + 0.5f);
+            const uint16_t rc = (ir > 31) ? 31 : ((ir < 0) ? 0 : ir);
+            const uint16_t gc = (ig > 63) ? 63 : ((ig < 0) ? 0 : ig);
+            const uint16_t bc = (ib > 31) ? 31 : ((ib < 0) ? 0 : ib);
+            return PixelFormat::encode((rc << 11) | (gc << 5) | bc);
+        }
+
+        // Integer applyDithering for the fixed-point rasterizer: channels are
+        // already scaled to 0..31 / 0..63 with 12 fractional bits.
+        __attribute__((always_inline, hot)) static inline uint16_t IRAM_ATTR applyDitheringFixed(int32_t r, int32_t g, int32_t b, int16_t x, int16_t y)
+        {
+            static constexpr uint8_t BAYER_INDEX_4X4[4][4] = {
+                {0, 8, 2, 10},
+                {12, 4, 14, 6},
+                {3, 11, 1, 9},
+                {15, 7, 13, 5}};
+
+            // bayer / 16 * 0.5 and * 0.25 in 12-bit fixed point.
+            const int32_t bayer = BAYER_INDEX_4X4[y & 3][x & 3];
+            const int32_t ir = (r + (bayer << 7)) >> 12;
+            const int32_t ig = (g + (bayer << 6)) >> 12;
+            const int32_t ib = (b + (bayer << 7)) >> 12;
+
+            uint16_t rc = (ir > 31) ? 31 : ((ir < 0) ? 0 : ir);
+            uint16_t gc = (ig > 63) ? 63 : ((ig < 0) ? 0 : ig);
+            uint16_t bc = (ib > 31) ? 31 : ((ib < 0) ? 0 : ib);
+
+            return PixelFormat::encode((rc << 11) | (gc << 5) | bc);
         }
     };
 
+    template <uint16_t... Is>
+    constexpr float Shading::ToneLut<ConstMath::Indices<Is...>>::values[sizeof...(Is)];
+
 }
 
 #endif
\ No newline at end of file
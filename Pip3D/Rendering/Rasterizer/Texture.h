@@ -0,0 +1,319 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include "../../Core/Core.h"
+#include "../../Core/ResourceManager.h"
+
+// Internal RAM set aside for the textures drawn most recently.
+#ifndef PIP3D_TEXTURE_CACHE_BYTES
+#define PIP3D_TEXTURE_CACHE_BYTES 16384
+#endif
+
+#ifndef PIP3D_TEXTURE_CACHE_SLOTS
+#define PIP3D_TEXTURE_CACHE_SLOTS 8
+#endif
+
+namespace pip3D
+{
+
+    enum TextureFormat : uint8_t
+    {
+        TEXTURE_RGB565 = 0,
+        // 8-bit indices into a 256-entry RGB565 palette.
+        TEXTURE_PAL8 = 1
+    };
+
+    // Power-of-two texture, 4 to 256 texels a side, wrapped in both
+    // directions. Texels are stored in 4x4 tiles, so the rows a span walks
+    // across share cache lines: one RGB565 tile is 32 bytes.
+    //
+    // load() reads a RES_TEXTURE blob: "P3T", the format byte, log2 width,
+    // log2 height, two zero bytes, the palette for TEXTURE_PAL8 (256
+    // little-endian RGB565 entries) and then the texels row by row.
+    class Texture
+    {
+    public:
+        static constexpr uint8_t TILE_LOG2 = 2;
+        static constexpr uint8_t MIN_LOG2 = 2;
+        static constexpr uint8_t MAX_LOG2 = 8;
+        static constexpr size_t BLOB_HEADER = 8;
+
+        Texture() : store(nullptr), fast(nullptr), palette(nullptr), byteCount(0), lastUse(0),
+                    width(0), height(0), log2W(0), log2H(0), fmt(TEXTURE_RGB565) {}
+
+        ~Texture()
+        {
+            release();
+        }
+
+        Texture(const Texture &) = delete;
+        Texture &operator=(const Texture &) = delete;
+
+        // pixels holds width * height RGB565 values or palette indices, row
+        // by row; both are copied.
+        bool create(uint16_t w, uint16_t h, TextureFormat format, const void *pixels,
+                    const uint16_t *pal = nullptr)
+        {
+            release();
+
+            const uint8_t lw = log2Of(w);
+            const uint8_t lh = log2Of(h);
+            if (!pixels || lw == 0xFF || lh == 0xFF || (format == TEXTURE_PAL8 && !pal))
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "Texture::create: unsupported %ux%u texture (format=%u)",
+                     static_cast<unsigned int>(w), static_cast<unsigned int>(h),
+                     static_cast<unsigned int>(format));
+                return false;
+            }
+
+            const uint32_t texelBytes = format == TEXTURE_PAL8 ? 1u : 2u;
+            const uint32_t bytes = static_cast<uint32_t>(w) * h * texelBytes;
+            store = static_cast<uint8_t *>(MemUtils::allocData(bytes, 16, ::pip3D::Debug::LOG_MODULE_RESOURCES));
+            if (format == TEXTURE_PAL8)
+                palette = static_cast<uint16_t *>(MemUtils::allocFast(256 * sizeof(uint16_t), 16,
+                                                                      ::pip3D::Debug::LOG_MODULE_RESOURCES));
+            if (!store || (format == TEXTURE_PAL8 && !palette))
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "Texture::create: allocation failed (%u bytes)", static_cast<unsigned int>(bytes));
+                release();
+                return false;
+            }
+
+            width = w;
+            height = h;
+            log2W = lw;
+            log2H = lh;
+            fmt = format;
+            byteCount = bytes;
+
+            for (uint32_t y = 0; y < h; ++y)
+            {
+                for (uint32_t x = 0; x < w; ++x)
+                {
+                    const uint32_t src = y * w + x;
+                    const uint32_t dst = tiledOffset(x, y, lw);
+                    if (format == TEXTURE_PAL8)
+                        store[dst] = static_cast<const uint8_t *>(pixels)[src];
+                    else
+                        reinterpret_cast<uint16_t *>(store)[dst] = static_cast<const uint16_t *>(pixels)[src];
+                }
+            }
+            if (format == TEXTURE_PAL8)
+                memcpy(palette, pal, 256 * sizeof(uint16_t));
+            return true;
+        }
+
+        bool fromBlob(const void *blob, size_t bytes)
+        {
+            const uint8_t *b = static_cast<const uint8_t *>(blob);
+            if (!b || bytes < BLOB_HEADER || b[0] != 'P' || b[1] != '3' || b[2] != 'T' ||
+                b[3] > TEXTURE_PAL8 || b[4] < MIN_LOG2 || b[4] > MAX_LOG2 || b[5] < MIN_LOG2 || b[5] > MAX_LOG2)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES, "Texture::fromBlob: not a texture blob");
+                return false;
+            }
+
+            const TextureFormat format = static_cast<TextureFormat>(b[3]);
+            const uint16_t w = static_cast<uint16_t>(1u << b[4]);
+            const uint16_t h = static_cast<uint16_t>(1u << b[5]);
+            const size_t paletteBytes = format == TEXTURE_PAL8 ? 256 * sizeof(uint16_t) : 0;
+            const size_t texelBytes = static_cast<size_t>(w) * h * (format == TEXTURE_PAL8 ? 1 : 2);
+            if (bytes < BLOB_HEADER + paletteBytes + texelBytes)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RESOURCES,
+                     "Texture::fromBlob: truncated (%u of %u bytes)",
+                     static_cast<unsigned int>(bytes),
+                     static_cast<unsigned int>(BLOB_HEADER + paletteBytes + texelBytes));
+                return false;
+            }
+
+            // The blob may sit at any alignment.
+            uint16_t pal[256];
+            if (paletteBytes)
+                memcpy(pal, b + BLOB_HEADER, paletteBytes);
+            const uint8_t *texels = b + BLOB_HEADER + paletteBytes;
+            if (format == TEXTURE_PAL8)
+                return create(w, h, format, texels, pal);
+
+            uint16_t *aligned = static_cast<uint16_t *>(MemUtils::allocData(texelBytes, 16,
+                                                                            ::pip3D::Debug::LOG_MODULE_RESOURCES));
+            if (!aligned)
+                return false;
+            memcpy(aligned, texels, texelBytes);
+            const bool ok = create(w, h, format, aligned);
+            MemUtils::freeData(aligned);
+            return ok;
+        }
+
+        // Loads a blob through ResourceManager and keeps only the tiled copy.
+        bool load(const char *path)
+        {
+            if (!ResourceManager::load(path, RES_TEXTURE))
+                return false;
+            return fromResource(ResourceManager::find(path));
+        }
+
+        // Takes over a resource streamed with loadAsync(), typically from the
+        // EVENT_TEXTURE_LOADED handler, and drops its reference.
+        bool fromResource(ResourceHandle handle)
+        {
+            const void *data = ResourceManager::getData(handle);
+            const bool ok = data && fromBlob(data, ResourceManager::getSize(handle));
+            ResourceManager::release(handle);
+            return ok;
+        }
+
+        void release();
+
+        __attribute__((always_inline)) inline bool isValid() const { return store != nullptr; }
+        __attribute__((always_inline)) inline uint16_t getWidth() const { return width; }
+        __attribute__((always_inline)) inline uint16_t getHeight() const { return height; }
+        __attribute__((always_inline)) inline uint8_t log2Width() const { return log2W; }
+        __attribute__((always_inline)) inline uint8_t log2Height() const { return log2H; }
+        __attribute__((always_inline)) inline TextureFormat format() const { return fmt; }
+        __attribute__((always_inline)) inline uint32_t bytes() const { return byteCount; }
+        __attribute__((always_inline)) inline const uint16_t *getPalette() const { return palette; }
+
+        // The internal RAM copy when the texture is cached, else the main one.
+        __attribute__((always_inline)) inline const uint8_t *texels() const { return fast ? fast : store; }
+        __attribute__((always_inline)) inline bool isResident() const { return fast != nullptr; }
+
+        // Index of texel (u, v) within the tiled storage.
+        __attribute__((always_inline)) static inline uint32_t tiledOffset(uint32_t u, uint32_t v, uint8_t log2W)
+        {
+            return ((v >> TILE_LOG2) << (log2W + TILE_LOG2)) | ((u >> TILE_LOG2) << (2 * TILE_LOG2)) |
+                   ((v & 3u) << TILE_LOG2) | (u & 3u);
+        }
+
+    private:
+        friend class TextureCache;
+
+        uint8_t *store;
+        // Set and cleared by TextureCache only.
+        mutable uint8_t *fast;
+        uint16_t *palette;
+        uint32_t byteCount;
+        mutable uint32_t lastUse;
+        uint16_t width, height;
+        uint8_t log2W, log2H;
+        TextureFormat fmt;
+
+        static uint8_t log2Of(uint16_t n)
+        {
+            for (uint8_t k = MIN_LOG2; k <= MAX_LOG2; ++k)
+            {
+                if (n == (1u << k))
+                    return k;
+            }
+            return 0xFF;
+        }
+    };
+
+    // Keeps the textures drawn lately in internal RAM within
+    // PIP3D_TEXTURE_CACHE_BYTES, least recently drawn out first. Only
+    // textures living in PSRAM are copied. Rasterizers read through
+    // Texture::texels(), so a texture that is not resident still draws
+    // from its main copy. Textures unused for two frames are the only ones
+    // evicted, as bands of the previous frame may still be rasterizing.
+    class TextureCache
+    {
+    public:
+        // Called by the renderer for every textured mesh it draws.
+        static void use(const Texture *tex, uint32_t frame)
+        {
+            if (!tex || !tex->isValid())
+                return;
+            tex->lastUse = frame;
+            if (tex->fast || !MemUtils::isInPSRAM(tex->store) || tex->byteCount > PIP3D_TEXTURE_CACHE_BYTES)
+                return;
+
+            State &s = state();
+            int freeSlot = -1;
+            for (int i = 0; i < PIP3D_TEXTURE_CACHE_SLOTS; ++i)
+            {
+                if (!s.slots[i])
+                {
+                    freeSlot = i;
+                    break;
+                }
+            }
+
+            while (freeSlot < 0 || s.bytes + tex->byteCount > PIP3D_TEXTURE_CACHE_BYTES)
+            {
+                int victim = -1;
+                for (int i = 0; i < PIP3D_TEXTURE_CACHE_SLOTS; ++i)
+                {
+                    const Texture *t = s.slots[i];
+                    if (t && t->lastUse + 1 < frame && (victim < 0 || t->lastUse < s.slots[victim]->lastUse))
+                        victim = i;
+                }
+                if (victim < 0)
+                    return;
+                evict(victim);
+                freeSlot = victim;
+            }
+
+            uint8_t *copy = static_cast<uint8_t *>(MemUtils::alloc(tex->byteCount, MEM_INTERNAL,
+                                                                   ::pip3D::Debug::LOG_MODULE_RENDER));
+            if (!copy)
+                return;
+            memcpy(copy, tex->store, tex->byteCount);
+            tex->fast = copy;
+            s.slots[freeSlot] = tex;
+            s.bytes += tex->byteCount;
+        }
+
+        static void forget(const Texture *tex)
+        {
+            State &s = state();
+            for (int i = 0; i < PIP3D_TEXTURE_CACHE_SLOTS; ++i)
+            {
+                if (s.slots[i] == tex)
+                    evict(i);
+            }
+        }
+
+        static uint32_t residentBytes() { return state().bytes; }
+
+    private:
+        struct State
+        {
+            const Texture *slots[PIP3D_TEXTURE_CACHE_SLOTS];
+            uint32_t bytes;
+        };
+
+        static State &state()
+        {
+            static State s = {};
+            return s;
+        }
+
+        static void evict(int slot)
+        {
+            State &s = state();
+            const Texture *t = s.slots[slot];
+            MemUtils::freeData(t->fast);
+            t->fast = nullptr;
+            s.bytes -= t->byteCount;
+            s.slots[slot] = nullptr;
+        }
+    };
+
+    inline void Texture::release()
+    {
+        if (fast)
+            TextureCache::forget(this);
+        MemUtils::freeData(store);
+        MemUtils::freeData(palette);
+        store = nullptr;
+        palette = nullptr;
+        byteCount = 0;
+        width = height = 0;
+        log2W = log2H = 0;
+    }
+
+}
+
+#endif
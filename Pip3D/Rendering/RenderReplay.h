@@ -0,0 +1,584 @@
+#ifndef RENDERREPLAY_H
+#define RENDERREPLAY_H
+
+#include "Renderer.h"
+#include "../Core/FixedPool.h"
+#include <vector>
+
+namespace pip3D
+{
+
+    // Plays back a RenderCapture stream on a renderer: the same camera,
+    // lights, settings and draw calls, frame by frame. Meshes are not part
+    // of the stream; bind one to every mesh ID before playing. The player
+    // owns the instances it draws, so per-instance caches warm up over the
+    // frames replayed just as they did while recording.
+    //
+    // Bound meshes get the recorded transform, color and visibility of
+    // each draw; only values that changed are written, which keeps the
+    // renderer's caches valid between identical frames.
+    class RenderReplay
+    {
+    public:
+        RenderReplay() : stream(nullptr), streamSize(0), instanceTable(nullptr), instanceCount(0),
+                         listedStamp(nullptr), instanceOwner(nullptr), pass(0), passFrame(0),
+                         warnedUnbound(false) {}
+
+        ~RenderReplay()
+        {
+            release();
+        }
+
+        RenderReplay(const RenderReplay &) = delete;
+        RenderReplay &operator=(const RenderReplay &) = delete;
+
+        // Indexes the frames of a stream, which is not copied and must
+        // outlive the player.
+        bool load(const uint8_t *data, size_t size)
+        {
+            release();
+            if (!data || size < RenderCapture::HEADER_SIZE || data[0] != 'P' || data[1] != '3' ||
+                data[2] != 'R' || data[3] != 'C' || data[4] != RenderCapture::VERSION)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_PERFORMANCE, "RenderReplay::load: not a capture stream");
+                return false;
+            }
+            if (data[5] != SCREEN_BAND_COUNT)
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
+                     "RenderReplay::load: captured with %u bands, playing with %u",
+                     static_cast<unsigned int>(data[5]), static_cast<unsigned int>(SCREEN_BAND_COUNT));
+            }
+
+            uint32_t maxInstance = 0;
+            uint32_t maxManager = 0;
+            size_t at = RenderCapture::HEADER_SIZE;
+            while (at < size)
+            {
+                const uint8_t cmd = data[at];
+                const size_t bytes = commandSize(data, size, at);
+                if (bytes == 0 || at + bytes > size || (frames.empty() && cmd != RenderCapture::CMD_FRAME))
+                {
+                    LOGE(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
+                         "RenderReplay::load: bad command %u at offset %u",
+                         static_cast<unsigned int>(cmd), static_cast<unsigned int>(at));
+                    release();
+                    return false;
+                }
+
+                const uint8_t *p = data + at + 1;
+                if (cmd == RenderCapture::CMD_FRAME)
+                {
+                    if (!frames.empty() && passes.size() < frames.size())
+                        passes.push_back(static_cast<uint32_t>(at));
+                    frames.push_back(static_cast<uint32_t>(at));
+                }
+                else if (cmd == RenderCapture::CMD_BAND_PASS)
+                {
+                    if (passes.size() < frames.size())
+                        passes.push_back(static_cast<uint32_t>(at));
+                }
+                else if (cmd == RenderCapture::CMD_MESH)
+                {
+                    const uint16_t id = read16(p);
+                    if (id >= meshes.size())
+                        meshes.resize(id + 1u);
+                    meshes[id].vertices = read16(p + 2);
+                    meshes[id].faces = read16(p + 4);
+                }
+                else if (cmd == RenderCapture::CMD_DRAW_INSTANCE)
+                {
+                    maxInstance = noteInstance(maxInstance, read16(p + 2));
+                }
+                else if (cmd == RenderCapture::CMD_DRAW_INSTANCES)
+                {
+                    const uint16_t manager = read16(p);
+                    if (manager + 1u > maxManager)
+                        maxManager = manager + 1u;
+                    const uint16_t count = read16(p + 3);
+                    for (uint16_t i = 0; i < count; ++i)
+                        maxInstance = noteInstance(maxInstance, read16(p + RenderCapture::DRAW_INSTANCES_HEADER +
+                                                                       i * RenderCapture::INSTANCE_RECORD_SIZE));
+                }
+                at += bytes;
+            }
+            if (passes.size() < frames.size())
+                passes.push_back(static_cast<uint32_t>(size));
+
+            if (maxInstance)
+            {
+                instanceTable = static_cast<MeshInstance **>(MemUtils::allocFast(maxInstance * sizeof(MeshInstance *), 16,
+                                                                                  ::pip3D::Debug::LOG_MODULE_PERFORMANCE));
+                listedStamp = static_cast<uint32_t *>(MemUtils::allocFast(maxInstance * sizeof(uint32_t), 16,
+                                                                           ::pip3D::Debug::LOG_MODULE_PERFORMANCE));
+                instanceOwner = static_cast<uint16_t *>(MemUtils::allocFast(maxInstance * sizeof(uint16_t), 16,
+                                                                             ::pip3D::Debug::LOG_MODULE_PERFORMANCE));
+                if (!instanceTable || !listedStamp || !instanceOwner ||
+                    !pool.init(static_cast<uint16_t>(maxInstance), MEM_INTERNAL_FIRST, ::pip3D::Debug::LOG_MODULE_PERFORMANCE))
+                {
+                    LOGE(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
+                         "RenderReplay::load: no room for %u instances", static_cast<unsigned int>(maxInstance));
+                    release();
+                    return false;
+                }
+                memset(instanceTable, 0, maxInstance * sizeof(MeshInstance *));
+                memset(listedStamp, 0, maxInstance * sizeof(uint32_t));
+                memset(instanceOwner, 0xFF, maxInstance * sizeof(uint16_t));
+                instanceCount = maxInstance;
+            }
+            for (uint32_t i = 0; i < maxManager; ++i)
+                managers.push_back(new InstanceManager());
+
+            stream = data;
+            streamSize = size;
+            return true;
+        }
+
+        void release()
+        {
+            for (uint32_t i = 0; i < instanceCount; ++i)
+            {
+                if (instanceTable[i] && instanceOwner[i] == RenderCapture::NO_ID)
+                    pool.destroy(instanceTable[i]);
+            }
+            for (size_t i = 0; i < managers.size(); ++i)
+                delete managers[i];
+            managers.clear();
+            pool.release();
+            MemUtils::freeData(instanceTable);
+            MemUtils::freeData(listedStamp);
+            MemUtils::freeData(instanceOwner);
+            instanceTable = nullptr;
+            listedStamp = nullptr;
+            instanceOwner = nullptr;
+            instanceCount = 0;
+            frames.clear();
+            passes.clear();
+            meshes.clear();
+            stream = nullptr;
+            streamSize = 0;
+            pass = 0;
+            warnedUnbound = false;
+        }
+
+        // The mesh must match the vertex and face count it was recorded with.
+        bool bindMesh(uint16_t id, Mesh *mesh)
+        {
+            if (id >= meshes.size() || !mesh)
+                return false;
+            if (mesh->numVertices() != meshes[id].vertices || mesh->numFaces() != meshes[id].faces)
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
+                     "RenderReplay::bindMesh: mesh %u has %u/%u vertices/faces, recorded %u/%u",
+                     static_cast<unsigned int>(id),
+                     static_cast<unsigned int>(mesh->numVertices()), static_cast<unsigned int>(mesh->numFaces()),
+                     static_cast<unsigned int>(meshes[id].vertices), static_cast<unsigned int>(meshes[id].faces));
+                return false;
+            }
+            meshes[id].mesh = mesh;
+            return true;
+        }
+
+        uint16_t frameCount() const { return static_cast<uint16_t>(frames.size()); }
+        uint16_t meshCount() const { return static_cast<uint16_t>(meshes.size()); }
+
+        // A whole frame: every band, or one deferred pass when the renderer
+        // is in deferred mode.
+        void play(Renderer &r, uint16_t frame)
+        {
+            if (frame >= frames.size())
+                return;
+            applyState(r, frame);
+            if (r.isDeferredRendering())
+            {
+                r.beginFrameDeferred();
+                draw(r, frame);
+                passFrame = frame;
+                r.endFrameDeferred(&RenderReplay::bandPass, this);
+                return;
+            }
+            for (int band = 0; band < SCREEN_BAND_COUNT; ++band)
+            {
+                r.beginFrameBand(band);
+                draw(r, frame);
+                drawBandPass(r, frame);
+                r.endFrameBand(band);
+            }
+        }
+
+        // Camera, lights, shading mode and shadow settings of the frame;
+        // call before the frame begins.
+        void applyState(Renderer &r, uint16_t frame)
+        {
+            if (frame >= frames.size())
+                return;
+            const uint8_t *p = stream + frames[frame] + 1;
+
+            Camera &cam = r.getCamera();
+            const Vector3 position = readVec(p);
+            const Vector3 target = readVec(p + 12);
+            const Vector3 up = readVec(p + 24);
+            const ProjectionType projection = static_cast<ProjectionType>(p[36]);
+            const float fov = readF(p + 37);
+            const float nearPlane = readF(p + 41);
+            const float farPlane = readF(p + 45);
+            const float orthoWidth = readF(p + 49);
+            const float orthoHeight = readF(p + 53);
+            const float fisheye = readF(p + 57);
+            if (!same(cam.position, position) || !same(cam.target, target) || !same(cam.up, up) ||
+                cam.projectionType != projection || cam.fov != fov || cam.nearPlane != nearPlane ||
+                cam.farPlane != farPlane || cam.orthoWidth != orthoWidth || cam.orthoHeight != orthoHeight ||
+                cam.fisheyeStrength != fisheye)
+            {
+                cam.position = position;
+                cam.target = target;
+                cam.up = up;
+                cam.projectionType = projection;
+                cam.fov = fov;
+                cam.nearPlane = nearPlane;
+                cam.farPlane = farPlane;
+                cam.orthoWidth = orthoWidth;
+                cam.orthoHeight = orthoHeight;
+                cam.fisheyeStrength = fisheye;
+                cam.markDirty();
+            }
+            p += 61;
+
+            r.setShadingMode(static_cast<Renderer::ShadingMode>(p[0]));
+            const uint8_t shadowFlags = p[1];
+            ShadowSettings &shadow = r.getShadowSettings();
+            shadow.enabled = (shadowFlags & RenderCapture::SHADOW_ENABLED) != 0;
+            shadow.softEdges = (shadowFlags & RenderCapture::SHADOW_SOFT_EDGES) != 0;
+            shadow.silhouette = (shadowFlags & RenderCapture::SHADOW_SILHOUETTE) != 0;
+            r.setShadowsEnabled((shadowFlags & RenderCapture::SHADOWS_ON) != 0);
+            shadow.shadowColor = Color(read16(p + 2));
+            shadow.shadowOpacity = readF(p + 4);
+            shadow.shadowOffset = readF(p + 8);
+            shadow.plane.normal = readVec(p + 12);
+            shadow.plane.d = readF(p + 24);
+            p += 28;
+
+            const uint8_t lightCount = p[0];
+            ++p;
+            r.clearLights();
+            for (uint8_t i = 0; i < lightCount; ++i, p += RenderCapture::LIGHT_SIZE)
+            {
+                Light light;
+                light.type = static_cast<LightType>(p[0]);
+                light.intensity = readF(p + 1);
+                light.direction = readVec(p + 5);
+                light.position = readVec(p + 17);
+                light.color = Color(read16(p + 29));
+                light.setRange(readF(p + 31));
+                r.addLight(light);
+            }
+        }
+
+        // The draw calls of the frame; call once per band, between the
+        // renderer's begin and end of the band.
+        void draw(Renderer &r, uint16_t frame)
+        {
+            if (frame >= frames.size())
+                return;
+            const size_t at = frames[frame];
+            drawRange(r, at + commandSize(stream, streamSize, at), passes[frame]);
+        }
+
+        // The calls a deferred frame made from its band pass callback; the
+        // BandPassFunc of a replayed deferred frame, or after draw() in a
+        // band of a banded one.
+        void drawBandPass(Renderer &r, uint16_t frame)
+        {
+            if (frame >= frames.size())
+                return;
+            const size_t end = frame + 1u < frames.size() ? frames[frame + 1] : streamSize;
+            if (passes[frame] < end)
+                drawRange(r, passes[frame] + 1, end);
+        }
+
+    private:
+        struct MeshSlot
+        {
+            Mesh *mesh;
+            uint16_t vertices;
+            uint16_t faces;
+
+            MeshSlot() : mesh(nullptr), vertices(0), faces(0) {}
+        };
+
+        const uint8_t *stream;
+        size_t streamSize;
+        std::vector<uint32_t> frames;
+        // Per frame, the offset of its CMD_BAND_PASS or of its end.
+        std::vector<uint32_t> passes;
+        std::vector<MeshSlot> meshes;
+
+        // Instances by captured ID; managed ones belong to the InstanceManager
+        // numbered in instanceOwner, the others to the pool.
+        FixedPool<MeshInstance> pool;
+        MeshInstance **instanceTable;
+        uint32_t instanceCount;
+        uint32_t *listedStamp;
+        uint16_t *instanceOwner;
+        std::vector<InstanceManager *> managers;
+        uint32_t pass;
+        uint16_t passFrame;
+        bool warnedUnbound;
+
+        static void bandPass(Renderer &r, int, void *userData)
+        {
+            RenderReplay *self = static_cast<RenderReplay *>(userData);
+            self->drawBandPass(r, self->passFrame);
+        }
+
+        void drawRange(Renderer &r, size_t at, size_t end)
+        {
+            ++pass;
+            while (at < end)
+            {
+                const uint8_t *p = stream + at + 1;
+                switch (stream[at])
+                {
+                case RenderCapture::CMD_DRAW_MESH:
+                    drawMesh(r, p);
+                    break;
+                case RenderCapture::CMD_DRAW_INSTANCE:
+                    drawInstance(r, p);
+                    break;
+                case RenderCapture::CMD_DRAW_INSTANCES:
+                    drawInstances(r, p);
+                    break;
+                case RenderCapture::CMD_WATER:
+                    r.drawWater(readF(p), readF(p + 4), Color(read16(p + 8)), readF(p + 10), readF(p + 14));
+                    break;
+                case RenderCapture::CMD_TEXT:
+                {
+                    char text[256];
+                    const uint8_t len = p[6];
+                    memcpy(text, p + RenderCapture::TEXT_HEADER, len);
+                    text[len] = '\0';
+                    r.drawText(static_cast<int16_t>(read16(p)), static_cast<int16_t>(read16(p + 2)), text, read16(p + 4));
+                    break;
+                }
+                case RenderCapture::CMD_TRIANGLE:
+                    r.drawTriangle3D(readVec(p), readVec(p + 12), readVec(p + 24), read16(p + 36));
+                    break;
+                case RenderCapture::CMD_SUN:
+                    r.drawSunSprite(readVec(p), Color(read16(p + 12)), readF(p + 14));
+                    break;
+                case RenderCapture::CMD_SKYBOX:
+                    r.drawSkyboxBackground();
+                    break;
+                default:
+                    break;
+                }
+                at += commandSize(stream, streamSize, at);
+            }
+        }
+
+        // Size of the command at offset at, opcode included; 0 if it is
+        // unknown or runs past the stream.
+        static size_t commandSize(const uint8_t *data, size_t size, size_t at)
+        {
+            const uint8_t *p = data + at + 1;
+            const size_t left = size - at - 1;
+            size_t bytes;
+            switch (data[at])
+            {
+            case RenderCapture::CMD_FRAME:
+                if (left < RenderCapture::FRAME_HEADER)
+                    return 0;
+                bytes = RenderCapture::FRAME_HEADER + p[RenderCapture::FRAME_HEADER - 1] * RenderCapture::LIGHT_SIZE;
+                break;
+            case RenderCapture::CMD_MESH:
+                bytes = RenderCapture::MESH_SIZE;
+                break;
+            case RenderCapture::CMD_DRAW_MESH:
+                bytes = RenderCapture::DRAW_MESH_SIZE;
+                break;
+            case RenderCapture::CMD_DRAW_INSTANCE:
+                bytes = RenderCapture::DRAW_INSTANCE_SIZE;
+                break;
+            case RenderCapture::CMD_DRAW_INSTANCES:
+                if (left < RenderCapture::DRAW_INSTANCES_HEADER)
+                    return 0;
+                bytes = RenderCapture::DRAW_INSTANCES_HEADER + read16(p + 3) * RenderCapture::INSTANCE_RECORD_SIZE;
+                break;
+            case RenderCapture::CMD_WATER:
+                bytes = RenderCapture::WATER_SIZE;
+                break;
+            case RenderCapture::CMD_TEXT:
+                if (left < RenderCapture::TEXT_HEADER)
+                    return 0;
+                bytes = RenderCapture::TEXT_HEADER + p[6];
+                break;
+            case RenderCapture::CMD_TRIANGLE:
+                bytes = RenderCapture::TRIANGLE_SIZE;
+                break;
+            case RenderCapture::CMD_SUN:
+                bytes = RenderCapture::SUN_SIZE;
+                break;
+            case RenderCapture::CMD_SKYBOX:
+            case RenderCapture::CMD_BAND_PASS:
+                bytes = 0;
+                break;
+            default:
+                return 0;
+            }
+            return bytes <= left ? bytes + 1 : 0;
+        }
+
+        static uint32_t noteInstance(uint32_t maxInstance, uint16_t id)
+        {
+            return id != RenderCapture::NO_ID && id + 1u > maxInstance ? id + 1u : maxInstance;
+        }
+
+        static __attribute__((always_inline)) inline uint16_t read16(const uint8_t *p)
+        {
+            uint16_t v;
+            memcpy(&v, p, 2);
+            return v;
+        }
+
+        static __attribute__((always_inline)) inline float readF(const uint8_t *p)
+        {
+            float v;
+            memcpy(&v, p, 4);
+            return v;
+        }
+
+        static __attribute__((always_inline)) inline Vector3 readVec(const uint8_t *p)
+        {
+            return Vector3(readF(p), readF(p + 4), readF(p + 8));
+        }
+
+        static __attribute__((always_inline)) inline bool same(const Vector3 &a, const Vector3 &b)
+        {
+            return a.x == b.x && a.y == b.y && a.z == b.z;
+        }
+
+        Mesh *boundMesh(uint16_t id)
+        {
+            Mesh *mesh = id < meshes.size() ? meshes[id].mesh : nullptr;
+            if (!mesh && !warnedUnbound)
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
+                     "RenderReplay: mesh %u is not bound, its draws are skipped", static_cast<unsigned int>(id));
+                warnedUnbound = true;
+            }
+            return mesh;
+        }
+
+        void drawMesh(Renderer &r, const uint8_t *p)
+        {
+            Mesh *mesh = boundMesh(read16(p + 2));
+            if (!mesh)
+                return;
+
+            const Vector3 position = readVec(p + 4);
+            const Vector3 rotation = readVec(p + 16);
+            const Vector3 scale = readVec(p + 28);
+            if (!same(mesh->pos(), position))
+                mesh->setPosition(position.x, position.y, position.z);
+            if (!same(mesh->rot(), rotation))
+                mesh->setRotation(rotation.x, rotation.y, rotation.z);
+            if (!same(mesh->scl(), scale))
+                mesh->setScale(scale.x, scale.y, scale.z);
+            mesh->color(Color(read16(p + 40)));
+            const uint8_t flags = p[42];
+            if (flags & RenderCapture::MESH_VISIBLE)
+                mesh->show();
+            else
+                mesh->hide();
+            mesh->setCastShadows((flags & RenderCapture::MESH_CASTS_SHADOWS) != 0);
+
+            r.setShadingMode(static_cast<Renderer::ShadingMode>(p[1]));
+            if (p[0] == RenderCapture::DRAW_SHADOW)
+                r.drawMeshShadow(mesh);
+            else
+                r.drawMesh(mesh);
+        }
+
+        // Creates the instance on first use and applies the record to it.
+        MeshInstance *instanceFor(const uint8_t *rec, uint16_t manager)
+        {
+            const uint16_t id = read16(rec);
+            if (id >= instanceCount)
+                return nullptr;
+            Mesh *mesh = read16(rec + 2) == RenderCapture::NO_ID ? nullptr : boundMesh(read16(rec + 2));
+
+            MeshInstance *inst = instanceTable[id];
+            if (!inst)
+            {
+                inst = manager == RenderCapture::NO_ID ? pool.acquire(mesh) : managers[manager]->create(mesh);
+                if (!inst)
+                    return nullptr;
+                instanceTable[id] = inst;
+                instanceOwner[id] = manager;
+            }
+            else if (inst->getMesh() != mesh)
+            {
+                inst->setMesh(mesh);
+            }
+
+            const Vector3 position = readVec(rec + 4);
+            const Quaternion rotation(readF(rec + 16), readF(rec + 20), readF(rec + 24), readF(rec + 28));
+            const Vector3 scale = readVec(rec + 32);
+            if (!same(inst->pos(), position))
+                inst->setPosition(position);
+            const Quaternion &q = inst->rot();
+            if (q.x != rotation.x || q.y != rotation.y || q.z != rotation.z || q.w != rotation.w)
+                inst->setRotation(rotation);
+            if (!same(inst->scl(), scale))
+                inst->setScale(scale);
+            inst->setColor(Color(read16(rec + 44)));
+            const uint8_t flags = rec[46];
+            if (flags & RenderCapture::INSTANCE_VISIBLE)
+                inst->show();
+            else
+                inst->hide();
+            inst->setOccluder((flags & RenderCapture::INSTANCE_OCCLUDER) != 0);
+            return inst;
+        }
+
+        void drawInstance(Renderer &r, const uint8_t *p)
+        {
+            MeshInstance *inst = instanceFor(p + 2, RenderCapture::NO_ID);
+            if (!inst || !inst->getMesh())
+                return;
+            r.setShadingMode(static_cast<Renderer::ShadingMode>(p[1]));
+            if (p[0] == RenderCapture::DRAW_STATIC)
+                r.drawMeshInstanceStatic(inst);
+            else if (p[0] == RenderCapture::DRAW_SHADOW)
+                r.drawMeshInstanceShadow(inst);
+            else
+                r.drawMeshInstance(inst);
+        }
+
+        void drawInstances(Renderer &r, const uint8_t *p)
+        {
+            const uint16_t manager = read16(p);
+            const uint16_t count = read16(p + 3);
+            const uint8_t *rec = p + RenderCapture::DRAW_INSTANCES_HEADER;
+            for (uint16_t i = 0; i < count; ++i, rec += RenderCapture::INSTANCE_RECORD_SIZE)
+            {
+                const uint16_t id = read16(rec);
+                if (id < instanceCount && instanceFor(rec, manager))
+                    listedStamp[id] = pass;
+            }
+
+            // Instances no longer listed were removed while recording.
+            for (uint32_t id = 0; id < instanceCount; ++id)
+            {
+                if (instanceOwner[id] == manager && listedStamp[id] != pass)
+                    instanceTable[id]->hide();
+            }
+
+            r.setShadingMode(static_cast<Renderer::ShadingMode>(p[2]));
+            r.drawInstances(*managers[manager]);
+        }
+    };
+
+}
+
+#endif
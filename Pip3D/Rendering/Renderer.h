@@ -5,13 +5,17 @@
 #include "../Core/Debug/DebugDraw.h"
 #include "../Core/Camera.h"
 #include "../Core/Frustum.h"
+#include "../Core/FrameArena.h"
 #include "../Core/Instance.h"
 #include "../Core/Jobs.h"
 #include "../Math/Math.h"
 #include "../Geometry/Mesh.h"
 #include "../Graphics/Font.h"
 #include "Display/ZBuffer.h"
+#include "Display/HiZBuffer.h"
+#include "Display/SpanKernels.h"
 #include "Display/DirtyRegions.h"
+#include "Display/BackdropCache.h"
 #include "Lighting/Lighting.h"
 #include "Lighting/LightManager.h"
 #include "Lighting/Shadow.h"
@@ -20,14 +24,33 @@
 #include "Rasterizer/Shading.h"
 #include "Display/FrameBuffer.h"
 #include "Display/Drivers/DisplayDriverBase.h"
+#ifdef PIP3D_HOST
+#include "Display/Drivers/HeadlessDriver.h"
+#else
 #include "Display/Drivers/ST7789Driver.h"
 #include "Display/Drivers/ILI9488Driver.h"
+#if PIP3D_DISPLAY_I80
+#include "Display/Drivers/I80Driver.h"
+#endif
+#endif
 #include "HUD/HudRenderer.h"
 #include "SceneRendering/Culling.h"
 #include "SceneRendering/MeshRenderer.h"
+#include "SceneRendering/VertexCache.h"
+#include "SceneRendering/LightingCache.h"
+#include "SceneRendering/DisplayList.h"
+#include "SceneRendering/WaterGrid.h"
+#include "SceneRendering/QualityGovernor.h"
+#include "SceneRendering/BandBalancer.h"
 #include "SceneRendering/CameraController.h"
+#include "SceneRendering/RenderCapture.h"
 #include <vector>
 
+// Per-frame scratch handed out by Renderer::getFrameArena().
+#ifndef PIP3D_RENDER_FRAME_ARENA_BYTES
+#define PIP3D_RENDER_FRAME_ARENA_BYTES 4096
+#endif
+
 namespace pip3D
 {
 
@@ -39,6 +62,10 @@ namespace pip3D
             SHADING_FLAT = 0
         };
 
+        // Per-band callback for deferred frames, invoked after the band's
+        // bin and skybox are drawn (shadows, water, HUD go here).
+        typedef void (*BandPassFunc)(Renderer &renderer, int bandIndex, void *userData);
+
     private:
         static constexpr int TILE_COLS = 4;
         static constexpr int TILE_ROWS = 4;
@@ -47,37 +74,108 @@ namespace pip3D
 
         // Banded rendering: horizontal bands for the physical 320x240 screen.
         static constexpr int BAND_COUNT = SCREEN_BAND_COUNT;
-        static constexpr int BAND_HEIGHT = SCREEN_BAND_HEIGHT;
 
         FrameBuffer framebuffer;
-        ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer;
+        ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer;
+        // Second band depth buffer for parallel rasterization (paired with the
+        // framebuffer back buffer).
+        ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBufferBack;
         DisplayDriverBase *display;
 
         // Full screen configuration (320x240) separate from banded framebuffer config
         DisplayConfig screenConfig;
 
         std::vector<Camera> cameras;
+        // Matrices and frustum per camera, kept across camera switches.
+        std::vector<CameraView> cameraViews;
         int activeCameraIndex;
 
+        // Active camera's view as this frame uses it; the camera index and
+        // view version it was taken from decide whether the image moved.
         Matrix4x4 viewMatrix;
         Matrix4x4 projMatrix;
         Matrix4x4 viewProjMatrix;
-        bool viewProjMatrixDirty;
+        int frameCameraIndex;
+        uint32_t frameCameraVersion;
 
         Viewport viewport;
         Frustum frustum;
 
         std::vector<Light> lights;
         int activeLightCount;
+        // Lights reaching the mesh being drawn, see lightsFor().
+        std::vector<Light> drawLights;
 
         bool shadowsEnabled;
         bool backfaceCullingEnabled;
         bool occlusionCullingEnabled;
 
+        // Coarse max-depth tiles of the current band for occlusion tests.
+        HiZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> hiZBuffer;
+
         ShadowSettings shadowSettings;
 
         PerformanceCounter perfCounter;
 
+        // Adaptive quality: the governor picks a level from the frame times,
+        // quality holds what the current frame may use.
+        QualityGovernor qualityGovernor;
+        bool qualityGovernorEnabled;
+        QualityLevel quality;
+
+        // Band heights follow last frame's per-band cost, see setBandBalancing().
+        BandBalancer bandBalancer;
+        bool bandBalancing;
+        // Set while an immediate band is being timed for the balancer.
+        bool bandTimed;
+        uint32_t bandStartUs;
+        uint32_t bandStartTriangles;
+
+        // Transformed vertices of drawn instances, shared by all bands of a frame.
+        VertexCache vertexCache;
+
+        // Shaded face colors of drawn instances, kept until lights, camera
+        // position or the instance change.
+        LightingCache lightingCache;
+
+        // Projected planar shadows, kept until the light, shadow plane,
+        // camera or the caster change.
+        ShadowCache shadowCache;
+
+        // Projected water heightfield, reused by every band of a frame.
+        WaterGrid waterGrid;
+
+        // HUD strings kept as pixel runs until they change.
+        TextRunCache textCache;
+
+        // Deferred mode: triangles are recorded once and rasterized per band.
+        DisplayList displayList;
+        bool deferredRendering;
+        bool parallelRasterization;
+        bool bandDoubleBuffering;
+        bool pairedBandInProgress;
+
+        // Band rasterized on the JobSystem worker core during deferred frames.
+        struct BandRasterJob
+        {
+            const DisplayList *list;
+            const DirtyTileMap *tiles;
+            // Set when the band restores or captures the retained backdrop.
+            BackdropCache *backdrop;
+            uint32_t backdropKey;
+            uint16_t backdropSplit;
+            bool restoreBackdrop;
+            int bandIndex;
+            uint16_t *frameBuffer;
+            ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer;
+            DisplayConfig config;
+            // Rasterization time, written by whichever core ran the job.
+            uint32_t elapsedUs;
+        };
+
+        BandRasterJob bandJob;
+        JobCounter bandJobCounter;
+
         ShadingMode shadingMode;
 
         uint32_t statsTrianglesTotal;
@@ -85,86 +183,111 @@ namespace pip3D
         uint32_t statsInstancesTotal;
         uint32_t statsInstancesFrustumCulled;
         uint32_t statsInstancesOcclusionCulled;
-        WorldInstanceDirtySlot worldInstanceDirty[MAX_WORLD_DIRTY_INSTANCES];
-
-        int16_t worldDirtyMinX;
-        int16_t worldDirtyMinY;
-        int16_t worldDirtyMaxX;
-        int16_t worldDirtyMaxY;
-        int16_t lastWorldDirtyMinX;
-        int16_t lastWorldDirtyMinY;
-        int16_t lastWorldDirtyMaxX;
-        int16_t lastWorldDirtyMaxY;
-        bool hasWorldDirtyRegion;
-        bool hasLastWorldDirtyRegion;
-
-        int16_t hudDirtyMinX;
-        int16_t hudDirtyMinY;
-        int16_t hudDirtyMaxX;
-        int16_t hudDirtyMaxY;
-        bool hasHudDirtyRegion;
+        uint32_t statsInstancesReducedLOD;
+        // Partial updates: only tiles whose content changed are flushed,
+        // and deferred frames only rasterize triangles over them.
+        DirtyTileMap dirtyTiles;
+        DirtyTileMap::Run dirtyRuns[DirtyTileMap::MAX_BAND_RUNS];
+        bool dirtyTilesEnabled;
+        uint32_t dirtySceneKey;
+
+        // Retained backdrop: static instances drawn at the start of a band
+        // are rasterized once and then restored from the cache. The list
+        // holds this band's (or deferred frame's) static instances in case a
+        // restored band has to be redrawn.
+        BackdropCache backdropCache;
+        std::vector<MeshInstance *> backdropInstances;
+        bool retainedBackdrop;
+        bool backdropOpen;
+        bool backdropRestored;
+        uint32_t backdropKey;
+        uint32_t backdropSceneKey;
+        // Deferred frames: display list triangles [0, split) are the backdrop.
+        uint16_t backdropSplit;
 
         bool cameraChangedThisFrame;
 
+        // Counts frames from 1; instances remember the last one they were
+        // drawn in, which drawInstances uses to prime the depth buffer.
+        uint32_t frameStamp;
+
+        // Scratch that lives for one frame, emptied by beginFrameState().
+        FrameArena frameArena;
+
         bool debugShowDirtyRegions;
 
+        // Receives the draw calls while it is recording, see setCapture().
+        RenderCapture *capture;
+
         // Current band index for banded rendering (0..BAND_COUNT-1)
         int currentBandIndex;
 
     public:
         Renderer() : zBuffer(nullptr),
+                     zBufferBack(nullptr),
                      display(nullptr),
                      cameras(1),
+                     cameraViews(1),
                      activeCameraIndex(0),
-                     viewProjMatrixDirty(true),
+                     frameCameraIndex(-1),
+                     frameCameraVersion(0),
                      lights(1),
                      activeLightCount(1),
                      shadowsEnabled(true),
                      backfaceCullingEnabled(true),
                      // Occlusion culling disabled by default in banded mode
                      occlusionCullingEnabled(false),
+                     qualityGovernorEnabled(false),
+                     quality(QualityGovernor::levelInfo(0)),
+                     bandBalancing(false),
+                     bandTimed(false),
+                     bandStartUs(0),
+                     bandStartTriangles(0),
+                     deferredRendering(false),
+                     parallelRasterization(false),
+                     bandDoubleBuffering(false),
+                     pairedBandInProgress(false),
                      shadingMode(SHADING_FLAT),
                      statsTrianglesTotal(0),
                      statsTrianglesBackfaceCulled(0),
                      statsInstancesTotal(0),
                      statsInstancesFrustumCulled(0),
-                     statsInstancesOcclusionCulled(0)
+                     statsInstancesOcclusionCulled(0),
+                     statsInstancesReducedLOD(0),
+                     frameStamp(0),
+                     capture(nullptr)
         {
             lights[0].type = LIGHT_DIRECTIONAL;
             lights[0].direction = Vector3(-0.5f, -1.0f, -0.5f);
             lights[0].direction.normalize();
             lights[0].color = Color::WHITE;
             lights[0].intensity = 1.0f;
-
-            hasWorldDirtyRegion = false;
-            hasLastWorldDirtyRegion = false;
-            hasHudDirtyRegion = false;
+            lights.reserve(PIP3D_MAX_LIGHTS);
+            drawLights.reserve(PIP3D_MAX_LIGHTS);
+
+            dirtyTilesEnabled = false;
+            dirtySceneKey = 0;
+            retainedBackdrop = false;
+            backdropOpen = false;
+            backdropRestored = false;
+            backdropKey = 0;
+            backdropSceneKey = 0;
+            backdropSplit = 0;
             cameraChangedThisFrame = false;
             debugShowDirtyRegions = false;
-            worldDirtyMinX = 0;
-            worldDirtyMinY = 0;
-            worldDirtyMaxX = 0;
-            worldDirtyMaxY = 0;
-            lastWorldDirtyMinX = 0;
-            lastWorldDirtyMinY = 0;
-            lastWorldDirtyMaxX = 0;
-            lastWorldDirtyMaxY = 0;
-            hudDirtyMinX = 0;
-            hudDirtyMinY = 0;
-            hudDirtyMaxX = 0;
-            hudDirtyMaxY = 0;
-
-            for (int i = 0; i < MAX_WORLD_DIRTY_INSTANCES; ++i)
-            {
-                worldInstanceDirty[i].instance = nullptr;
-                worldInstanceDirty[i].hasCurrent = false;
-                worldInstanceDirty[i].hasLast = false;
-            }
+            bandJob.list = nullptr;
+            bandJob.tiles = nullptr;
+            bandJob.backdrop = nullptr;
+            bandJob.backdropKey = 0;
+            bandJob.backdropSplit = 0;
+            bandJob.restoreBackdrop = false;
+            bandJob.bandIndex = 0;
+            bandJob.frameBuffer = nullptr;
+            bandJob.zBuffer = nullptr;
         }
 
         bool init(const DisplayConfig &cfg)
         {
-            Shading::initLUT();
             useDualCore(true);
 
             LOGI(::pip3D::Debug::LOG_MODULE_RENDER,
@@ -179,11 +302,17 @@ namespace pip3D
 
             if (!display)
             {
+#ifdef PIP3D_HOST
+                display = new HeadlessDriver();
+#elif PIP3D_DISPLAY_I80
+                display = new I80Driver();
+#else
                 display = new ILI9488Driver();
+#endif
                 if (!display)
                 {
                     LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
-                         "Renderer::init: failed to allocate ILI9488Driver");
+                         "Renderer::init: failed to allocate display driver");
                     return false;
                 }
             }
@@ -217,12 +346,16 @@ namespace pip3D
                 return false;
             }
 
-            // Store full-screen configuration (e.g., 320x240)
+            // Full-screen configuration at render resolution; the display
+            // flush widens it back to the panel.
             screenConfig = cfg;
+            screenConfig.width = static_cast<uint16_t>(cfg.width / RENDER_SCALE_X);
+            screenConfig.height = static_cast<uint16_t>(cfg.height / RENDER_SCALE_Y);
 
-            // Framebuffer only keeps a single band in memory.
-            DisplayConfig fbCfg = cfg;
-            fbCfg.height = cfg.height / BAND_COUNT;
+            // Framebuffer only keeps a single band in memory, with room for
+            // the tallest one.
+            DisplayConfig fbCfg = screenConfig;
+            fbCfg.height = SCREEN_BAND_CAPACITY;
 
             if (!framebuffer.init(fbCfg, display))
             {
@@ -236,7 +369,7 @@ namespace pip3D
             }
 
             // Z-buffer also allocated per-band (same dimensions as framebuffer)
-            zBuffer = new ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT>();
+            zBuffer = new ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY>();
             if (!zBuffer || !zBuffer->init())
             {
                 if (!zBuffer)
@@ -260,12 +393,19 @@ namespace pip3D
             }
 
             // Viewport still covers the full screen; projection stays unchanged.
-            viewport = Viewport(0, 0, cfg.width, cfg.height);
+            viewport = Viewport(0, 0, screenConfig.width, screenConfig.height);
+
+            if (!frameArena.init(PIP3D_RENDER_FRAME_ARENA_BYTES, MEM_INTERNAL_FIRST,
+                                 ::pip3D::Debug::LOG_MODULE_RENDER))
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "Renderer::init: no frame arena, getFrameArena() hands out nothing");
+            }
 
             LOGI(::pip3D::Debug::LOG_MODULE_RENDER,
                  "Renderer::init OK: viewport %dx%d",
-                 cfg.width,
-                 cfg.height);
+                 screenConfig.width,
+                 screenConfig.height);
             return true;
         }
 
@@ -277,6 +417,9 @@ namespace pip3D
 
         void endFrame()
         {
+            sealBackdrop();
+            resolveFillStats(0);
+
         #if ENABLE_DEBUG_DRAW
             ::pip3D::Debug::DebugDraw::render(*this);
         #endif
@@ -285,13 +428,15 @@ namespace pip3D
             framebuffer.endFrameRegion(0, 0,
                                        framebuffer.getConfig().width,
                                        framebuffer.getConfig().height);
-            perfCounter.endFrame();
+            finishFrameTiming();
         }
 
         void endFrameRegion(int16_t x, int16_t y, int16_t w, int16_t h)
         {
+            sealBackdrop();
+            resolveFillStats(currentBandIndex);
             framebuffer.endFrameRegion(x, y, w, h);
-            perfCounter.endFrame();
+            finishFrameTiming();
         }
 
         // Banded rendering API: render a specific horizontal band (0..BAND_COUNT-1).
@@ -302,55 +447,257 @@ namespace pip3D
             if (bandIndex >= BAND_COUNT)
                 bandIndex = BAND_COUNT - 1;
 
-            currentBandIndex = bandIndex;
-
-            // Update global band state (used by rasterizer, mesh renderer, shadows, etc.).
-            int16_t bandTop = static_cast<int16_t>(bandIndex * BAND_HEIGHT);
-            currentBandOffsetY() = bandTop;
-            currentBandHeight() = BAND_HEIGHT;
+            if (bandIndex == 0)
+                balanceBands();
+            setBandState(bandIndex);
 
             // Only once per full frame, on the first band
             if (bandIndex == 0)
             {
-                perfCounter.begin();
+                beginFrameState();
+            }
+
+            bandTimed = bandBalancing;
+            if (bandTimed)
+            {
+                bandStartUs = micros();
+                bandStartTriangles = statsTrianglesTotal;
+            }
+
+            framebuffer.beginFrame();
+            if (zBuffer)
+                zBuffer->clear(static_cast<uint16_t>(currentBandHeight()));
+            hiZBuffer.clear();
+
+        #if ENABLE_FILL_STATS
+            FillStats::beginBand(bandIndex, framebuffer.getBuffer());
+        #endif
+
+            if (retainedBackdrop && zBuffer)
+            {
+                const DisplayConfig &fbCfg = framebuffer.getConfig();
+                const bool restored = backdropCache.load(bandIndex, framebuffer.getBuffer(),
+                                                         static_cast<size_t>(fbCfg.width) * fbCfg.height, *zBuffer);
+                if (restored)
+                    hiZBuffer.markAllDirty();
+                openBackdrop(restored);
+            }
+
+        #if ENABLE_DEBUG_DRAW
+            ::pip3D::Debug::DebugDraw::beginFrame();
+        #endif
+        }
+
+        // Deferred rendering: walk the scene once between beginFrameDeferred()
+        // and endFrameDeferred(); mesh triangles are shaded, projected and
+        // binned per band, then every band is rasterized from its bin.
+        bool setDeferredRendering(bool enabled)
+        {
+            if (enabled && !displayList.init())
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "Renderer::setDeferredRendering: display list unavailable, staying in immediate mode");
+                deferredRendering = false;
+                return false;
+            }
+            deferredRendering = enabled;
+            return true;
+        }
+
+        bool isDeferredRendering() const { return deferredRendering; }
+
+        // Ping-pong band buffers: each band is flushed asynchronously and the
+        // next band renders into the other buffer while it is on the wire.
+        bool setBandDoubleBuffering(bool enabled)
+        {
+            if (!enabled)
+            {
+                bandDoubleBuffering = false;
+                framebuffer.waitTransfer();
+                if (!parallelRasterization)
+                    framebuffer.releaseBackBuffer();
+                return true;
+            }
+
+            if (!framebuffer.initBackBuffer())
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "Renderer::setBandDoubleBuffering: back framebuffer allocation failed");
+                return false;
+            }
+
+            bandDoubleBuffering = true;
+            return true;
+        }
+
+        bool isBandDoubleBuffering() const { return bandDoubleBuffering; }
 
-                for (int i = 0; i < MAX_WORLD_DIRTY_INSTANCES; ++i)
+        // Deferred frames only: rasterize every other band on the JobSystem
+        // worker core into a second framebuffer/ZBuffer pair.
+        bool setParallelRasterization(bool enabled)
+        {
+            if (!enabled)
+            {
+                parallelRasterization = false;
+                framebuffer.waitTransfer();
+                if (!bandDoubleBuffering)
+                    framebuffer.releaseBackBuffer();
+                if (zBufferBack)
                 {
-                    worldInstanceDirty[i].hasCurrent = false;
-                    worldInstanceDirty[i].hasLast = false;
-                    worldInstanceDirty[i].instance = nullptr;
+                    delete zBufferBack;
+                    zBufferBack = nullptr;
                 }
+                return true;
+            }
 
-                hasWorldDirtyRegion = false;
-                hasLastWorldDirtyRegion = false;
-                hasHudDirtyRegion = false;
-                cameraChangedThisFrame = false;
+            if (!JobSystem::isEnabled())
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "Renderer::setParallelRasterization: JobSystem disabled, bands will run on one core");
+            }
 
-                CameraController::updateViewProjectionIfNeeded(cameras[activeCameraIndex],
-                                                               viewport,
-                                                               viewMatrix,
-                                                               projMatrix,
-                                                               viewProjMatrix,
-                                                               frustum,
-                                                               viewProjMatrixDirty,
-                                                               cameraChangedThisFrame);
+            if (!framebuffer.initBackBuffer())
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "Renderer::setParallelRasterization: back framebuffer allocation failed");
+                return false;
+            }
 
-                statsTrianglesTotal = 0;
-                statsTrianglesBackfaceCulled = 0;
-                statsInstancesTotal = 0;
-                statsInstancesFrustumCulled = 0;
-                statsInstancesOcclusionCulled = 0;
+            if (!zBufferBack)
+            {
+                zBufferBack = new ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY>();
+                if (!zBufferBack || !zBufferBack->init())
+                {
+                    LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                         "Renderer::setParallelRasterization: back ZBuffer allocation failed");
+                    if (zBufferBack)
+                    {
+                        delete zBufferBack;
+                        zBufferBack = nullptr;
+                    }
+                    framebuffer.releaseBackBuffer();
+                    return false;
+                }
             }
 
-            framebuffer.beginFrame();
-            if (zBuffer)
-                zBuffer->clear();
+            parallelRasterization = true;
+            return true;
+        }
+
+        bool isParallelRasterization() const { return parallelRasterization; }
+
+        void beginFrameDeferred()
+        {
+            if (!deferredRendering && !setDeferredRendering(true))
+            {
+                // Legacy single-band fallback.
+                beginFrameBand(0);
+                return;
+            }
+
+            balanceBands();
+
+            // Record against the full screen so no triangle is band-rejected.
+            currentBandIndex = 0;
+            currentBandOffsetY() = 0;
+            currentBandHeight() = SCREEN_HEIGHT;
+
+            beginFrameState();
+
+            displayList.clear();
+            activeDisplayList() = &displayList;
+
+            // Restored bands skip the static instances entirely; they are
+            // only recorded when the backdrop has to be captured.
+            backdropSplit = 0;
+            if (retainedBackdrop)
+                openBackdrop(backdropCache.allValid());
 
         #if ENABLE_DEBUG_DRAW
             ::pip3D::Debug::DebugDraw::beginFrame();
         #endif
         }
 
+        void endFrameDeferred(BandPassFunc bandPass = nullptr, void *userData = nullptr)
+        {
+            if (activeDisplayList() != &displayList)
+            {
+                if (bandPass)
+                    bandPass(*this, currentBandIndex, userData);
+                endFrameBand(currentBandIndex);
+                return;
+            }
+
+            sealBackdrop();
+            activeDisplayList() = nullptr;
+            displayList.finalize();
+            if (bandBalancing)
+            {
+                for (uint16_t i = 0; i < displayList.size(); ++i)
+                {
+                    int minY, maxY;
+                    displayList.rowSpan(i, minY, maxY);
+                    bandBalancer.countRows(minY, maxY);
+                }
+            }
+
+            const DirtyTileMap *tiles = nullptr;
+            if (dirtyTilesEnabled)
+            {
+                dirtyTiles.resolve();
+                tiles = &dirtyTiles;
+            }
+
+            const bool parallel = parallelRasterization && zBufferBack && framebuffer.hasBackBuffer();
+            pairedBandInProgress = parallel;
+
+            for (int band = 0; band < BAND_COUNT; ++band)
+            {
+                // Hand band+1 to the worker core; it only touches the back
+                // buffers and the read-only display list.
+                const bool split = parallel && band + 1 < BAND_COUNT;
+                if (split)
+                {
+                    // The back buffer may still be on the wire from the
+                    // previous pair.
+                    framebuffer.waitTransfer(framebuffer.getBackBuffer());
+                    bandJob = deferredBandJob(band + 1, framebuffer.getBackBuffer(), zBufferBack, tiles);
+                    if (!JobSystem::submit(&Renderer::bandRasterJobFunc, &bandJob, &bandJobCounter))
+                    {
+                        bandRasterJobFunc(&bandJob);
+                    }
+                }
+
+                setBandState(band);
+                framebuffer.beginFrame();
+
+                {
+                    PIP3D_PROFILE_ZONE("RasterBand");
+                    const uint32_t us = rasterizeDeferredBand(deferredBandJob(band, framebuffer.getBuffer(), zBuffer, tiles));
+                    if (bandBalancing)
+                        bandBalancer.record(band, us, displayList.binSize(band));
+                }
+                finishDeferredBand(band, bandPass, userData);
+
+                if (split)
+                {
+                    // Deterministic join before the worker's band is finished
+                    // and flushed on this core.
+                    waitBandJob();
+                    if (bandBalancing)
+                        bandBalancer.record(band + 1, bandJob.elapsedUs, displayList.binSize(band + 1));
+
+                    ++band;
+                    swapBandBuffers();
+                    setBandState(band);
+                    finishDeferredBand(band, bandPass, userData);
+                    swapBandBuffers();
+                }
+            }
+
+            pairedBandInProgress = false;
+        }
+
         void endFrameBand(int bandIndex)
         {
             if (bandIndex < 0)
@@ -358,15 +705,43 @@ namespace pip3D
             if (bandIndex >= BAND_COUNT)
                 bandIndex = BAND_COUNT - 1;
 
+            sealBackdrop();
+            resolveFillStats(bandIndex);
+
+            if (bandTimed)
+            {
+                bandTimed = false;
+                bandBalancer.record(bandIndex, micros() - bandStartUs, statsTrianglesTotal - bandStartTriangles);
+            }
+
+            PIP3D_PROFILE_ZONE("BandFlush");
             const DisplayConfig &fbCfg = framebuffer.getConfig();
-            int16_t bandY = static_cast<int16_t>(bandIndex * fbCfg.height);
+            int16_t bandY = bandLayout().top[bandIndex];
 
-            framebuffer.endFrameRegion(0, bandY, fbCfg.width, fbCfg.height);
+            if (dirtyTilesEnabled)
+                dirtyTiles.resolve();
+
+            // Partial flushes are synchronous, so the buffer is free again.
+            if (!dirtyTilesEnabled || !flushDirtyTiles(bandY, fbCfg))
+            {
+                if (bandDoubleBuffering)
+                {
+                    // Band goes out over DMA while the next one renders into the
+                    // other buffer. Paired deferred bands swap buffers themselves.
+                    framebuffer.endFrameRegionAsync(0, bandY, fbCfg.width, fbCfg.height);
+                    if (!pairedBandInProgress)
+                        framebuffer.swapBuffers();
+                }
+                else
+                {
+                    framebuffer.endFrameRegion(0, bandY, fbCfg.width, fbCfg.height);
+                }
+            }
 
             // Finish performance counter after the last band is flushed
             if (bandIndex == BAND_COUNT - 1)
             {
-                perfCounter.endFrame();
+                finishFrameTiming();
             }
         }
 
@@ -375,6 +750,9 @@ namespace pip3D
         // transparent overlays (water, HUD) so they remain on top.
         void drawSkyboxBackground()
         {
+            sealBackdrop();
+            if (RenderCapture *rec = capturing())
+                rec->drawSkybox();
             framebuffer.drawSkyboxWhereEmpty(*zBuffer);
         }
 
@@ -385,6 +763,9 @@ namespace pip3D
 
         void drawSunSprite(const Vector3 &worldPos, const Color &color, float glow)
         {
+            sealBackdrop();
+            if (RenderCapture *rec = capturing())
+                rec->drawSun(worldPos, color, glow);
             Vector3 p = project(worldPos);
             if (cameras[activeCameraIndex].projectionType == PERSPECTIVE && p.z <= 0.0f)
             {
@@ -398,7 +779,8 @@ namespace pip3D
                 return;
             }
 
-            int16_t minDim = cfg.width < cfg.height ? cfg.width : cfg.height;
+            // Sized from the uniform band so it stays put when bands are resized.
+            int16_t minDim = cfg.width < SCREEN_BAND_HEIGHT ? cfg.width : SCREEN_BAND_HEIGHT;
             if (minDim <= 0)
             {
                 return;
@@ -429,6 +811,7 @@ namespace pip3D
             int16_t cx = (int16_t)p.x;
             int16_t cy = (int16_t)p.y;
             int r2 = radius * radius;
+            const uint16_t sunPixel = PixelFormat::encode(color.rgb565);
 
             for (int dy = -radius; dy <= radius; ++dy)
             {
@@ -449,7 +832,7 @@ namespace pip3D
                     int d2 = dx * dx + dy * dy;
                     if (d2 <= r2)
                     {
-                        fb[yy * cfg.width + xx] = color.rgb565;
+                        fb[yy * cfg.width + xx] = sunPixel;
                     }
                 }
             }
@@ -457,6 +840,9 @@ namespace pip3D
 
         void drawWater(float yLevel, float size, Color color, float alpha, float time)
         {
+            sealBackdrop();
+            if (RenderCapture *rec = capturing())
+                rec->drawWater(yLevel, size, color, alpha, time);
             uint16_t *fb = framebuffer.getBuffer();
             if (!fb || !zBuffer)
             {
@@ -475,11 +861,6 @@ namespace pip3D
             const uint8_t alphaByte = static_cast<uint8_t>(alpha * 255.0f);
             const DisplayConfig &cfg = framebuffer.getConfig();
 
-            Camera &cam = cameras[activeCameraIndex];
-
-            // Mark the full world region as dirty since water animates every frame
-            addDirtyRect(nullptr, 0, 0, cfg.width, cfg.height);
-
             // Frustum cull: simple sphere around water patch
             const Vector3 center(0.0f, yLevel, 0.0f);
             const float radius = size * 0.75f;
@@ -488,49 +869,54 @@ namespace pip3D
                 return;
             }
 
-            const int GRID = 32;
-            const float half = size * 0.5f;
-            const float step = size / static_cast<float>(GRID);
-
-            const float freq = 0.6f;
-            const float amp = size * 0.02f;
+            // Built once per frame and shared by the remaining bands.
+            if (waterGrid.update(yLevel, size, time, cameras[activeCameraIndex].position, viewProjMatrix, viewport))
+            {
+                int16_t x0, y0, x1, y1;
+                if (waterGrid.changedBounds(x0, y0, x1, y1))
+                    markDirtyRect(x0, y0, static_cast<int16_t>(x1 - x0 + 1), static_cast<int16_t>(y1 - y0 + 1));
+            }
+            if (!waterGrid.isValid())
+            {
+                return;
+            }
 
-            for (int iz = 0; iz < GRID; ++iz)
+            const int16_t bandTop = currentBandOffsetY();
+            const int16_t bandBottom = static_cast<int16_t>(bandTop + currentBandHeight());
+            const int grid = waterGrid.size();
+            for (int iz = 0; iz < grid; ++iz)
             {
-                float z0 = -half + step * static_cast<float>(iz);
-                float z1 = z0 + step;
+                if (!waterGrid.rowOverlaps(iz, bandTop, bandBottom))
+                    continue;
 
-                for (int ix = 0; ix < GRID; ++ix)
+                for (int ix = 0; ix < grid; ++ix)
                 {
-                    float x0 = -half + step * static_cast<float>(ix);
-                    float x1 = x0 + step;
-
-                    Vector3 v00(x0,
-                                yLevel + FastMath::fastSin(x0 * freq + time) * amp +
-                                    FastMath::fastCos(z0 * freq + time) * amp,
-                                z0);
-                    Vector3 v10(x1,
-                                yLevel + FastMath::fastSin(x1 * freq + time) * amp +
-                                    FastMath::fastCos(z0 * freq + time) * amp,
-                                z0);
-                    Vector3 v01(x0,
-                                yLevel + FastMath::fastSin(x0 * freq + time) * amp +
-                                    FastMath::fastCos(z1 * freq + time) * amp,
-                                z1);
-                    Vector3 v11(x1,
-                                yLevel + FastMath::fastSin(x1 * freq + time) * amp +
-                                    FastMath::fastCos(z1 * freq + time) * amp,
-                                z1);
-
-                    // Triangle 1
-                    drawWaterTriangleInternal(v00, v10, v11, color, alphaByte, cam, cfg, fb);
-                    // Triangle 2
-                    drawWaterTriangleInternal(v00, v11, v01, color, alphaByte, cam, cfg, fb);
+                    const Vector3 &v00 = waterGrid.vertex(ix, iz);
+                    const Vector3 &v10 = waterGrid.vertex(ix + 1, iz);
+                    const Vector3 &v01 = waterGrid.vertex(ix, iz + 1);
+                    const Vector3 &v11 = waterGrid.vertex(ix + 1, iz + 1);
+
+                    drawWaterTriangleInternal(v00, v10, v11, color, alphaByte, cfg, fb);
+                    drawWaterTriangleInternal(v00, v11, v01, color, alphaByte, cfg, fb);
                 }
             }
         }
 
         void drawTriangle3D(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2, uint16_t color)
+        {
+            sealBackdrop();
+            if (RenderCapture *rec = capturing())
+                rec->drawTriangle(v0, v1, v2, color);
+            drawWorldTriangle(v0, v1, v2, color);
+        }
+
+        // Capture and replay: while rec is recording, the draw calls of
+        // each frame are written to it. nullptr detaches it.
+        void setCapture(RenderCapture *rec) { capture = rec; }
+        RenderCapture *getCapture() const { return capture; }
+
+    private:
+        void drawWorldTriangle(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2, uint16_t color)
         {
             MeshRenderer::drawTriangle3D(v0, v1, v2, color,
                                          cameras[activeCameraIndex],
@@ -545,6 +931,13 @@ namespace pip3D
                                          statsTrianglesBackfaceCulled);
         }
 
+        // Draw calls are captured once per frame, like dirty instances.
+        __attribute__((always_inline)) inline RenderCapture *capturing() const
+        {
+            return capture && currentBandIndex == 0 && capture->isRecording() ? capture : nullptr;
+        }
+
+    public:
         Camera &getCamera() { return cameras[activeCameraIndex]; }
         Camera &getCamera(int index)
         {
@@ -559,17 +952,31 @@ namespace pip3D
         int getActiveCameraIndex() const { return activeCameraIndex; }
         int getCameraCount() const { return cameras.size(); }
         uint16_t *getFrameBuffer() const { return const_cast<uint16_t *>(framebuffer.getBuffer()); }
+        DisplayDriverBase *getDisplay() const { return display; }
         const Frustum &getFrustum() const { return frustum; }
+        const Matrix4x4 &getViewProjMatrix() const { return viewProjMatrix; }
+
+        // Bump arena for scratch that only has to last until the next frame
+        // starts; allocations fail (nullptr) once it is full.
+        FrameArena &getFrameArena() { return frameArena; }
 
         uint32_t getStatsTrianglesTotal() const { return statsTrianglesTotal; }
         uint32_t getStatsTrianglesBackfaceCulled() const { return statsTrianglesBackfaceCulled; }
         uint32_t getStatsInstancesTotal() const { return statsInstancesTotal; }
         uint32_t getStatsInstancesFrustumCulled() const { return statsInstancesFrustumCulled; }
         uint32_t getStatsInstancesOcclusionCulled() const { return statsInstancesOcclusionCulled; }
+        uint32_t getStatsInstancesReducedLOD() const { return statsInstancesReducedLOD; }
+        // Shadow casters whose projection was redone this frame.
+        uint32_t getStatsShadowCastersRebuilt() const { return shadowCache.getRebuildCount(); }
+        uint32_t getStatsDeferredTriangles() const { return displayList.size(); }
+        uint32_t getStatsDeferredDropped() const { return displayList.droppedCount(); }
+        // Scans the current band's depth buffer; meant for benchmarks, not per-frame use.
+        uint32_t countBandCoveredPixels() const { return zBuffer ? zBuffer->countCovered() : 0; }
 
         int createCamera()
         {
             cameras.push_back(Camera());
+            cameraViews.push_back(CameraView());
             return cameras.size() - 1;
         }
 
@@ -578,7 +985,6 @@ namespace pip3D
             if (index >= 0 && index < (int)cameras.size())
             {
                 activeCameraIndex = index;
-                viewProjMatrixDirty = true;
             }
         }
 
@@ -637,16 +1043,84 @@ namespace pip3D
         Color getLightColor() const { return LightManager::getLightColor(lights, activeLightCount); }
 
         void setShadowsEnabled(bool enabled) { shadowsEnabled = enabled; }
-        bool getShadowsEnabled() const { return shadowsEnabled; }
+        // False while the quality governor has shadows turned off.
+        bool getShadowsEnabled() const { return shadowsEnabled && quality.shadows; }
         void setBackfaceCullingEnabled(bool enabled) { backfaceCullingEnabled = enabled; }
         bool getBackfaceCullingEnabled() const { return backfaceCullingEnabled; }
 
         void setOcclusionCullingEnabled(bool enabled) { occlusionCullingEnabled = enabled; }
         bool getOcclusionCullingEnabled() const { return occlusionCullingEnabled; }
 
+        // Trades LOD, small-object culling and shadows for frame time to hold
+        // the governor's target (30 fps unless set).
+        void setQualityGovernorEnabled(bool enabled)
+        {
+            qualityGovernorEnabled = enabled;
+            qualityGovernor.reset();
+            quality = QualityGovernor::levelInfo(0);
+        }
+        bool isQualityGovernorEnabled() const { return qualityGovernorEnabled; }
+        QualityGovernor &getQualityGovernor() { return qualityGovernor; }
+
+        // Resizes the bands every frame from the previous frame's per-band
+        // time so that paired bands finish together on both cores. Needs
+        // PIP3D_SCREEN_BAND_CAPACITY above SCREEN_BAND_HEIGHT; disabling
+        // goes back to uniform bands.
+        bool setBandBalancing(bool enabled)
+        {
+            if (enabled && (BAND_COUNT < 2 || SCREEN_BAND_CAPACITY <= SCREEN_BAND_HEIGHT))
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "Renderer::setBandBalancing: no room to resize bands (PIP3D_SCREEN_BAND_CAPACITY=%u)",
+                     static_cast<unsigned int>(SCREEN_BAND_CAPACITY));
+                return false;
+            }
+            if (bandBalancing != enabled)
+            {
+                bandBalancing = enabled;
+                bandBalancer.reset();
+                invalidateBackdrop();
+            }
+            return true;
+        }
+        bool isBandBalancing() const { return bandBalancing; }
+        const BandBalancer &getBandBalancer() const { return bandBalancer; }
+
         void setDebugShowDirtyRegions(bool enabled) { debugShowDirtyRegions = enabled; }
         bool getDebugShowDirtyRegions() const { return debugShowDirtyRegions; }
 
+        // Partial updates for mostly static screens: bands flush only the
+        // tiles whose content changed, and deferred frames skip triangles
+        // over unchanged tiles. Instances, their shadows and text are
+        // tracked; anything drawn straight into the framebuffer (FX,
+        // ropes, sprites) must call markDirtyRect() or markScreenDirty().
+        // The display keeps the previous frame, so the first frame after
+        // enabling is flushed whole.
+        void setDirtyTilesEnabled(bool enabled)
+        {
+            if (enabled && !dirtyTilesEnabled)
+                dirtyTiles.reset();
+            dirtyTilesEnabled = enabled;
+        }
+
+        bool isDirtyTilesEnabled() const { return dirtyTilesEnabled; }
+
+        // Screen-space rect to redraw this frame; once the first band is
+        // flushed (or a deferred frame is rasterizing) it applies next frame.
+        void markDirtyRect(int16_t x, int16_t y, int16_t w, int16_t h)
+        {
+            if (dirtyTilesEnabled)
+                dirtyTiles.markRect(x, y, w, h);
+        }
+
+        void markScreenDirty()
+        {
+            if (dirtyTilesEnabled)
+                dirtyTiles.markAll();
+        }
+
+        const DirtyTileMap &getDirtyTiles() const { return dirtyTiles; }
+
         void setShadingMode(ShadingMode mode)
         {
             shadingMode = mode;
@@ -667,16 +1141,35 @@ namespace pip3D
             float temp = framebuffer.getSkybox().getRecommendedLightTemperature();
             setLightTemperature(temp);
         }
+        void setSkyboxColors(Color top, Color horizon, Color ground)
+        {
+            if (framebuffer.setSkyboxColors(top, horizon, ground))
+                markScreenDirty();
+        }
         void setClearColor(Color color) { framebuffer.setClearColor(color); }
         Skybox &getSkybox() { return framebuffer.getSkybox(); }
         bool isSkyboxEnabled() const { return framebuffer.isSkyboxEnabled(); }
 
+        // Screen coordinates; each band draws the rows of the text it covers.
         void drawText(int16_t x, int16_t y, const char *text, uint16_t color = 0xFFFF)
         {
-            HudRenderer::drawText(framebuffer, x, y, text, color);
+            sealBackdrop();
+            if (RenderCapture *rec = capturing())
+                rec->drawText(x, y, text, color);
+            const int16_t localY = static_cast<int16_t>(y - currentBandOffsetY());
+            if (localY >= currentBandHeight() || localY + BitmapFont::getCharHeight() <= 0)
+                return;
 
-            int16_t w = HudRenderer::getTextWidth(text);
-            addHudDirtyRect(x, y, w, 8);
+            uint32_t textHash;
+            HudRenderer::drawText(framebuffer, textCache, x, localY, text, color, textHash);
+
+            // Unchanged text keeps the tile signatures, so it is not dirty.
+            if (dirtyTilesEnabled && text)
+            {
+                uint32_t key = DirtyTileMap::hash(textHash, color);
+                key = DirtyTileMap::hash(key, (static_cast<uint32_t>(static_cast<uint16_t>(x)) << 16) | static_cast<uint16_t>(y));
+                addDirtyContent(x, y, HudRenderer::getTextWidth(text), 8, key);
+            }
         }
 
         void drawText(int16_t x, int16_t y, const char *text, Color color)
@@ -692,7 +1185,8 @@ namespace pip3D
 
         uint16_t getAdaptiveTextColor(int16_t x, int16_t y, int16_t width = 40, int16_t height = 8)
         {
-            return HudRenderer::getAdaptiveTextColor(framebuffer, viewport, x, y, width, height);
+            return HudRenderer::getAdaptiveTextColor(framebuffer, viewport, x,
+                                                     static_cast<int16_t>(y - currentBandOffsetY()), width, height);
         }
 
         int16_t getTextWidth(const char *text)
@@ -702,6 +1196,15 @@ namespace pip3D
 
         void drawMesh(Mesh *mesh)
         {
+            sealBackdrop();
+            if (RenderCapture *rec = capturing())
+                rec->drawMesh(RenderCapture::DRAW_NORMAL, mesh, shadingMode);
+            if (!mesh)
+                return;
+            mesh->updateTransform();
+            const Light *meshLights;
+            const int meshLightCount = lightsFor(mesh->center(), mesh->radius(), meshLights);
+            TextureCache::use(mesh->texture(), frameStamp);
             MeshRenderer::drawMesh(mesh,
                                    cameras[activeCameraIndex],
                                    viewport,
@@ -709,8 +1212,8 @@ namespace pip3D
                                    viewProjMatrix,
                                    framebuffer,
                                    zBuffer,
-                                   lights.data(),
-                                   activeLightCount,
+                                   meshLights,
+                                   meshLightCount,
                                    backfaceCullingEnabled,
                                    statsTrianglesTotal,
                                    statsTrianglesBackfaceCulled);
@@ -739,7 +1242,7 @@ namespace pip3D
 
             if (performFrustumCull)
             {
-                if (!frustum.sphere(center, radius))
+                if (!frustum.sphere(center, radius, instance->frustumCullPlane()))
                 {
                     statsInstancesFrustumCulled++;
                     return;
@@ -747,7 +1250,8 @@ namespace pip3D
             }
 
             // Contribution culling: skip instances that project to < 1 pixel
-            // on screen for perspective cameras.
+            // on screen for perspective cameras. The same radius picks the
+            // LOD level; other cameras keep the level drawn last.
             const Camera &cam = cameras[activeCameraIndex];
             if (cam.projectionType == PERSPECTIVE)
             {
@@ -762,37 +1266,107 @@ namespace pip3D
                         float projScale = 1.0f / tanHalf;
                         float radiusPixels = fabsf(radius * projScale / distForward) *
                                              (static_cast<float>(viewport.height) * 0.5f);
-                        if (radiusPixels < 1.0f)
+                        if (radiusPixels < quality.minPixels)
                         {
                             statsInstancesTotal++;
                             return;
                         }
+                        if (instance->getLOD())
+                            instance->selectLOD(radiusPixels * quality.lodScale);
                     }
                 }
             }
 
             statsInstancesTotal++;
 
-            if (occlusionCullingEnabled &&
-                Culling::isInstanceOccluded(center, radius,
-                                            cameras[activeCameraIndex],
-                                            viewport,
-                                            viewProjMatrix,
-                                            zBuffer,
-                                            framebuffer.getConfig()))
+            if (instance->getLOD())
             {
-                statsInstancesOcclusionCulled++;
-                return;
+                mesh = instance->lodMesh();
+                if (unlikely(!mesh))
+                    return;
+                if (instance->getLODLevel() > 0)
+                    statsInstancesReducedLOD++;
+            }
+
+            // Deferred frames record without depth, so there is nothing to test against.
+            if (occlusionCullingEnabled && zBuffer && !activeDisplayList())
+            {
+                ScreenRect rect;
+                int32_t nearDepth;
+                if (Culling::sphereScreenBounds(center, radius, cam, viewport, viewProjMatrix, rect, nearDepth))
+                {
+                    if (!instance->isOccluder() &&
+                        Culling::isInstanceOccluded(rect, nearDepth, hiZBuffer, zBuffer))
+                    {
+                        statsInstancesOcclusionCulled++;
+                        return;
+                    }
+                    Culling::markDrawn(rect, hiZBuffer);
+                }
+                else
+                {
+                    hiZBuffer.markAllDirty();
+                }
             }
+            instance->markVisible(frameStamp);
 
-            if (trackDirty)
+            if (trackDirty && tracksDirtyInstances())
             {
-                addDirtyFromSphere(instance, center, radius);
+                addDirtyFromSphere(instanceDirtyKey(instance, mesh), center, radius);
             }
 
             const Matrix4x4 &worldTransform = instance->transform();
             const uint16_t instColor565 = instance->color().rgb565;
 
+            // Back faces are rejected against the mesh's face normals before
+            // any vertex is transformed, so the eye is taken into model space.
+            BackfaceCullParams cullParams;
+            const BackfaceCullParams *cull = nullptr;
+            if (backfaceCullingEnabled && mesh->hasFaceNormals())
+            {
+                const Vector3 &s = instance->scl();
+                if (fabsf(s.x) > 1e-6f && fabsf(s.y) > 1e-6f && fabsf(s.z) > 1e-6f)
+                {
+                    const Quaternion inv = instance->rot().conjugate();
+                    cullParams.directional = cam.projectionType != PERSPECTIVE;
+                    cullParams.eye = cullParams.directional
+                                         ? inv.rotate(cam.forward() * -1.0f)
+                                         : inv.rotate(cam.position - instance->pos());
+                    cullParams.eye = Vector3(cullParams.eye.x / s.x,
+                                             cullParams.eye.y / s.y,
+                                             cullParams.eye.z / s.z);
+                    cull = &cullParams;
+                }
+            }
+
+            const uint8_t *faceVisible = nullptr;
+            const TransformedVertex *verts = vertexCache.acquire(instance, mesh, worldTransform,
+                                                                 cam, viewProjMatrix, viewport,
+                                                                 cull, &faceVisible);
+            if (verts)
+            {
+                const Light *instLights;
+                const int instLightCount = lightsFor(center, radius, instLights);
+                LitFace *litFaces = lightingCache.acquire(instance, mesh,
+                                                          instance->transformVersion(),
+                                                          instColor565);
+                TextureCache::use(mesh->texture(), frameStamp);
+                MeshRenderer::drawTransformedFaces(mesh, verts, litFaces, instColor565,
+                                                   cam,
+                                                   viewport,
+                                                   viewProjMatrix,
+                                                   framebuffer,
+                                                   zBuffer,
+                                                   instLights,
+                                                   instLightCount,
+                                                   backfaceCullingEnabled,
+                                                   statsTrianglesTotal,
+                                                   statsTrianglesBackfaceCulled,
+                                                   faceVisible);
+                return;
+            }
+
+            // Vertex cache unavailable (allocation failure): transform per face.
             for (uint16_t i = 0; i < mesh->numFaces(); i++)
             {
                 const Face &face = mesh->face(i);
@@ -808,12 +1382,15 @@ namespace pip3D
                 Vector3 v1 = worldTransform.transformNoDiv(local1);
                 Vector3 v2 = worldTransform.transformNoDiv(local2);
 
-                drawTriangle3D(v0, v1, v2, instColor565);
+                drawWorldTriangle(v0, v1, v2, instColor565);
             }
         }
 
         void drawMeshInstance(MeshInstance *instance)
         {
+            sealBackdrop();
+            if (RenderCapture *rec = capturing())
+                rec->drawInstance(RenderCapture::DRAW_NORMAL, instance, shadingMode);
             drawMeshInstanceInternal(instance, true, true);
         }
 
@@ -825,28 +1402,110 @@ namespace pip3D
             shadingMode = prev;
         }
 
+        // With a retained backdrop, static instances drawn before any other
+        // draw call of the band are cached; later ones are drawn every frame.
         void drawMeshInstanceStatic(MeshInstance *instance)
         {
+            if (RenderCapture *rec = capturing())
+                rec->drawInstance(RenderCapture::DRAW_STATIC, instance, shadingMode);
+            if (backdropOpen && instance)
+            {
+                backdropInstances.push_back(instance);
+                backdropKey = DirtyTileMap::hash(backdropKey, instanceDirtyKey(instance, instance->getMesh()));
+                backdropKey = DirtyTileMap::hash(backdropKey, instance->isVisible() ? 1u : 0u);
+                if (backdropRestored)
+                    return;
+            }
             drawMeshInstanceInternal(instance, true, false);
         }
 
+        // Retained mode for static scenes; needs about 4 bytes per screen
+        // pixel of cache (PSRAM with PIP3D_USE_PSRAM). The backdrop is
+        // re-rasterized when the camera, the lights or one of its instances
+        // change; call invalidateBackdrop() after editing a mesh in place.
+        bool setRetainedBackdrop(bool enabled)
+        {
+            if (!enabled)
+            {
+                retainedBackdrop = false;
+                backdropOpen = false;
+                backdropRestored = false;
+                backdropCache.release();
+                backdropInstances.clear();
+                backdropInstances.shrink_to_fit();
+                return true;
+            }
+
+            if (!backdropCache.init())
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "Renderer::setRetainedBackdrop: backdrop cache unavailable, staying in immediate mode");
+                retainedBackdrop = false;
+                return false;
+            }
+            retainedBackdrop = true;
+            return true;
+        }
+
+        bool isRetainedBackdrop() const { return retainedBackdrop; }
+        void invalidateBackdrop() { backdropCache.invalidate(); }
+        const BackdropCache &getBackdropCache() const { return backdropCache; }
+
         void drawInstances(InstanceManager &manager)
         {
+            sealBackdrop();
+            if (RenderCapture *rec = capturing())
+                rec->drawInstances(manager, shadingMode);
             static std::vector<MeshInstance *> visibleInstances;
-            manager.cull(frustum, visibleInstances);
+            manager.cullOrdered(frustum, cameras[activeCameraIndex].position, visibleInstances);
+
+            // Occluders go first so their depth is in the Hi-Z tiles before
+            // anything else is tested, then whatever was drawn last frame:
+            // it most likely still is, and primes the depth buffer for the
+            // rest. Each part keeps front-to-back order.
+            size_t firstGrouped = 0;
+            size_t firstUnseen = visibleInstances.size();
+            if (occlusionCullingEnabled)
+            {
+                auto split = std::stable_partition(visibleInstances.begin(), visibleInstances.end(),
+                                                   [](const MeshInstance *inst)
+                                                   { return inst->isOccluder(); });
+                const uint32_t since = frameStamp > 1 ? frameStamp - 1 : 1;
+                auto unseen = std::stable_partition(split, visibleInstances.end(),
+                                                    [since](const MeshInstance *inst)
+                                                    { return inst->wasVisibleSince(since); });
+                firstGrouped = static_cast<size_t>(split - visibleInstances.begin());
+                firstUnseen = static_cast<size_t>(unseen - visibleInstances.begin());
+            }
 
-            manager.sort(cameras[activeCameraIndex].position, visibleInstances);
+            // Instances sharing a mesh are drawn in a run, the mesh decoded
+            // once for all of them; runs keep the order of their nearest
+            // instance.
+            manager.groupByMesh(visibleInstances, firstGrouped, firstUnseen);
+            manager.groupByMesh(visibleInstances, firstUnseen);
 
-            for (auto *instance : visibleInstances)
+            const size_t count = visibleInstances.size();
+            for (size_t i = 0; i < count; ++i)
             {
+                MeshInstance *instance = visibleInstances[i];
+                if (i >= firstGrouped && i + 1 < count)
+                {
+                    const Mesh *mesh = instance->lodMesh();
+                    if ((i == firstGrouped || visibleInstances[i - 1]->lodMesh() != mesh) &&
+                        visibleInstances[i + 1]->lodMesh() == mesh)
+                        vertexCache.stageMesh(mesh);
+                }
                 drawMeshInstanceInternal(instance, false, true);
             }
         }
 
         void drawMeshShadow(Mesh *mesh)
         {
+            sealBackdrop();
+            if (RenderCapture *rec = capturing())
+                rec->drawMesh(RenderCapture::DRAW_SHADOW, mesh, shadingMode);
             ShadowRenderer::drawMeshShadow(mesh,
-                                           shadowsEnabled,
+                                           getShadowsEnabled(),
                                            shadowSettings,
                                            cameras[activeCameraIndex],
                                            lights.data(),
@@ -855,12 +1514,17 @@ namespace pip3D
                                            viewport,
                                            framebuffer,
                                            zBuffer,
-                                           backfaceCullingEnabled);
+                                           shadowCache);
         }
         void drawMeshInstanceShadow(MeshInstance *instance)
         {
+            sealBackdrop();
+            if (RenderCapture *rec = capturing())
+                rec->drawInstance(RenderCapture::DRAW_SHADOW, instance, shadingMode);
+            if (tracksDirtyInstances())
+                addShadowDirty(instance);
             ShadowRenderer::drawMeshInstanceShadow(instance,
-                                                   shadowsEnabled,
+                                                   getShadowsEnabled(),
                                                    shadowSettings,
                                                    cameras[activeCameraIndex],
                                                    lights.data(),
@@ -869,7 +1533,7 @@ namespace pip3D
                                                    viewport,
                                                    framebuffer,
                                                    zBuffer,
-                                                   backfaceCullingEnabled);
+                                                   shadowCache);
         }
         void setShadowOpacity(float opacity)
         {
@@ -881,6 +1545,11 @@ namespace pip3D
             shadowSettings.shadowColor = color;
         }
 
+        void setShadowSilhouetteEnabled(bool enabled)
+        {
+            shadowSettings.silhouette = enabled;
+        }
+
         void setShadowPlane(const Vector3 &normal, float distance)
         {
             shadowSettings.plane = ShadowProjector::ShadowPlane(normal, distance);
@@ -894,30 +1563,399 @@ namespace pip3D
         ShadowSettings &getShadowSettings() { return shadowSettings; }
 
     private:
-        __attribute__((always_inline)) inline void addDirtyRect(MeshInstance *instance, int16_t x, int16_t y, int16_t w, int16_t h)
+        static void bandRasterJobFunc(void *userData)
+        {
+            PIP3D_PROFILE_ZONE("RasterBand");
+            BandRasterJob *job = static_cast<BandRasterJob *>(userData);
+            job->elapsedUs = rasterizeDeferredBand(*job);
+        }
+
+        BandRasterJob deferredBandJob(int band, uint16_t *frameBuffer,
+                                      ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *bandZBuffer,
+                                      const DirtyTileMap *tiles)
+        {
+            BandRasterJob job;
+            job.list = &displayList;
+            job.tiles = tiles;
+            job.backdrop = retainedBackdrop ? &backdropCache : nullptr;
+            job.backdropKey = backdropKey;
+            job.backdropSplit = backdropSplit;
+            job.restoreBackdrop = backdropRestored;
+            job.bandIndex = band;
+            job.frameBuffer = frameBuffer;
+            job.zBuffer = bandZBuffer;
+            job.config = framebuffer.getConfig();
+            job.config.height = static_cast<uint16_t>(bandLayout().height(band));
+            job.elapsedUs = 0;
+            return job;
+        }
+
+        // Clears or restores the band, then rasterizes its bin. A captured
+        // backdrop is drawn whole (clean tiles included) and stored before
+        // the rest of the bin goes on top. Returns the time taken.
+        static uint32_t rasterizeDeferredBand(const BandRasterJob &job)
+        {
+            if (!job.zBuffer)
+                return 0;
+            const uint32_t start = micros();
+            PIP3D_FILL_BAND(job.bandIndex, job.frameBuffer);
+
+            const size_t pixels = static_cast<size_t>(job.config.width) * job.config.height;
+            if (job.backdrop && job.restoreBackdrop &&
+                job.backdrop->load(job.bandIndex, job.frameBuffer, pixels, *job.zBuffer))
+            {
+                job.list->rasterizeBand(job.bandIndex, job.frameBuffer, job.zBuffer, job.config, job.tiles);
+                return micros() - start;
+            }
+
+            job.zBuffer->clear(job.config.height);
+            uint16_t first = 0;
+            if (job.backdrop)
+            {
+                job.list->rasterizeBand(job.bandIndex, job.frameBuffer, job.zBuffer, job.config,
+                                        nullptr, 0, job.backdropSplit);
+                job.backdrop->store(job.bandIndex, job.backdropKey, job.frameBuffer, pixels, *job.zBuffer);
+                first = job.backdropSplit;
+            }
+            job.list->rasterizeBand(job.bandIndex, job.frameBuffer, job.zBuffer, job.config, job.tiles, first);
+            return micros() - start;
+        }
+
+        void openBackdrop(bool restored)
+        {
+            backdropInstances.clear();
+            backdropKey = DirtyTileMap::hash(backdropSceneKey, backfaceCullingEnabled ? 1u : 0u);
+            backdropOpen = true;
+            backdropRestored = restored;
+        }
+
+        // Lights that reach the sphere, once per draw so every face of the
+        // mesh loops over only those; the full set when none drops out.
+        int lightsFor(const Vector3 &center, float radius, const Light *&out)
+        {
+            out = lights.data();
+            if (activeLightCount <= 0)
+                return activeLightCount;
+            if (drawLights.size() < static_cast<size_t>(activeLightCount))
+                drawLights.resize(activeLightCount);
+            const int count = LightManager::cullLights(lights.data(), activeLightCount, center, radius, drawLights.data());
+            if (count < activeLightCount)
+                out = drawLights.data();
+            return count;
+        }
+
+        __attribute__((always_inline)) inline void sealBackdrop()
+        {
+            if (backdropOpen)
+                closeBackdrop();
+        }
+
+        // Ends the backdrop at the first draw call that is not static. A
+        // restored band whose static instances changed is redrawn from the
+        // list; immediate bands are captured here, deferred frames while
+        // their bands are rasterized.
+        void closeBackdrop()
+        {
+            backdropOpen = false;
+            const bool deferred = activeDisplayList() == &displayList;
+
+            bool matches = true;
+            if (deferred)
+            {
+                for (int band = 0; band < BAND_COUNT && matches; ++band)
+                    matches = backdropCache.matches(band, backdropKey);
+            }
+            else
+            {
+                matches = backdropCache.matches(currentBandIndex, backdropKey);
+            }
+            if (backdropRestored && matches)
+                return;
+
+            if (backdropRestored)
+            {
+                backdropRestored = false;
+                if (!deferred && zBuffer)
+                {
+                    zBuffer->clear(static_cast<uint16_t>(currentBandHeight()));
+                    hiZBuffer.clear();
+                }
+                for (MeshInstance *instance : backdropInstances)
+                    drawMeshInstanceInternal(instance, true, false);
+            }
+
+            if (deferred)
+            {
+                backdropSplit = displayList.size();
+            }
+            else if (zBuffer)
+            {
+                const DisplayConfig &fbCfg = framebuffer.getConfig();
+                backdropCache.store(currentBandIndex, backdropKey, framebuffer.getBuffer(),
+                                    static_cast<size_t>(fbCfg.width) * fbCfg.height, *zBuffer);
+            }
+        }
+
+        void waitBandJob()
+        {
+            JobSystem::wait(bandJobCounter);
+        }
+
+        void swapBandBuffers()
+        {
+            framebuffer.swapBuffers();
+            ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *tmp = zBuffer;
+            zBuffer = zBufferBack;
+            zBufferBack = tmp;
+        }
+
+        // Skybox, user overlays and flush for a band whose bin is rasterized.
+        void finishDeferredBand(int band, BandPassFunc bandPass, void *userData)
+        {
+            if (RenderCapture *rec = capturing())
+                rec->beginBandPass();
+
+            if (dirtyTilesEnabled)
+            {
+                // Rows without a dirty tile are never flushed.
+                const int16_t bandTop = currentBandOffsetY();
+                int16_t firstY, lastY;
+                if (dirtyTiles.countDirtyRows(bandTop, static_cast<int16_t>(bandTop + currentBandHeight()), firstY, lastY) > 0)
+                    framebuffer.drawSkyboxWhereEmpty(*zBuffer, static_cast<uint16_t>(firstY - bandTop),
+                                                     static_cast<uint16_t>(lastY - bandTop));
+            }
+            else
+            {
+                sealBackdrop();
+                framebuffer.drawSkyboxWhereEmpty(*zBuffer);
+            }
+
+            if (bandPass)
+                bandPass(*this, band, userData);
+
+            endFrameBand(band);
+        }
+
+        // Sends the dirty runs of the band at bandY. Returns false when the
+        // band is dirty enough to go out whole.
+        bool flushDirtyTiles(int16_t bandY, const DisplayConfig &fbCfg)
+        {
+            const int16_t bandEnd = static_cast<int16_t>(bandY + fbCfg.height);
+            int16_t firstY, lastY;
+            const int dirtyCount = dirtyTiles.countDirtyRows(bandY, bandEnd, firstY, lastY);
+            const int tileRows = (fbCfg.height + DirtyTileMap::TILE_SIZE - 1) / DirtyTileMap::TILE_SIZE;
+            if (dirtyCount * 100 >= tileRows * DirtyTileMap::COLS * PIP3D_DIRTY_FULL_PERCENT)
+                return false;
+
+            const int runCount = dirtyTiles.buildRuns(bandY, bandEnd, dirtyRuns, DirtyTileMap::MAX_BAND_RUNS);
+
+            if (debugShowDirtyRegions)
+            {
+                uint16_t *fb = framebuffer.getBuffer();
+                const uint16_t overlay = PixelFormat::encode(Color::fromRGB888(255, 255, 0).rgb565);
+                for (int i = 0; fb && i < runCount; ++i)
+                {
+                    const DirtyTileMap::Run &run = dirtyRuns[i];
+                    uint16_t *top = fb + static_cast<size_t>(run.y - bandY) * fbCfg.width;
+                    uint16_t *bottom = top + static_cast<size_t>(run.h - 1) * fbCfg.width;
+                    for (int16_t x = run.x; x < run.x + run.w; ++x)
+                        top[x] = bottom[x] = overlay;
+                    for (int16_t y = 0; y < run.h; ++y)
+                        top[y * fbCfg.width + run.x] = top[y * fbCfg.width + run.x + run.w - 1] = overlay;
+                }
+            }
+
+            // Full-width runs are contiguous and go out as one transfer.
+            for (int i = 0; i < runCount; ++i)
+                framebuffer.endFrameRect(dirtyRuns[i].x, dirtyRuns[i].y, dirtyRuns[i].w, dirtyRuns[i].h);
+            return true;
+        }
+
+        void setBandState(int bandIndex)
+        {
+            currentBandIndex = bandIndex;
+
+            // Update global band state (used by rasterizer, mesh renderer, shadows, etc.).
+            const BandLayout &bands = bandLayout();
+            currentBandOffsetY() = bands.top[bandIndex];
+            currentBandHeight() = bands.height(bandIndex);
+            framebuffer.setBandRows(static_cast<uint16_t>(currentBandHeight()));
+        }
+
+        // Moves the band edges between frames; cached bands covered other rows.
+        void balanceBands()
+        {
+            if (bandBalancing && bandBalancer.rebalance())
+                invalidateBackdrop();
+        }
+
+        // Closes the band's fill counters (unless its rasterization did) and
+        // swaps in the overdraw heatmap before the band goes out.
+        void resolveFillStats(int bandIndex)
+        {
+        #if ENABLE_FILL_STATS
+            const DisplayConfig &fbCfg = framebuffer.getConfig();
+            FillStats::endBand(bandIndex);
+            FillStats::resolveHeatmap(framebuffer.getBuffer(), static_cast<size_t>(fbCfg.width) * fbCfg.height);
+        #else
+            (void)bandIndex;
+        #endif
+        }
+
+        void finishFrameTiming()
+        {
+            perfCounter.endFrame();
+            if (qualityGovernorEnabled &&
+                qualityGovernor.update(perfCounter.getFrameTime(), statsTrianglesTotal))
+            {
+                // Cached pixels were drawn at the old level.
+                quality = qualityGovernor.current();
+                markScreenDirty();
+                invalidateBackdrop();
+            }
+        }
+
+        void beginFrameState()
+        {
+            if (qualityGovernorEnabled)
+                qualityGovernor.pace();
+            PIP3D_PROFILE_FRAME();
+            perfCounter.begin();
+            if (++frameStamp == 0)
+                frameStamp = 1;
+            frameArena.reset();
+        #if ENABLE_FILL_STATS
+            FillStats::beginFrame();
+        #endif
+            EventSystem::dispatchDeferred();
+            vertexCache.beginFrame();
+            shadowCache.beginFrame();
+            if (capture)
+                capture->beginFrame(cameras[activeCameraIndex], lights.data(), activeLightCount,
+                                    shadingMode, shadowsEnabled, shadowSettings);
+            CameraView &camView = cameraViews[activeCameraIndex];
+            CameraController::refresh(cameras[activeCameraIndex], viewport, camView);
+            cameraChangedThisFrame = activeCameraIndex != frameCameraIndex ||
+                                     camView.version != frameCameraVersion;
+
+            // Interlaced fields alternate panel line parity; each samples a
+            // quarter render row off the row centre, towards its own lines,
+            // so the image moves every frame.
+            if (RENDER_INTERLACED)
+            {
+                framebuffer.setField(static_cast<uint8_t>(framebuffer.getField() ^ 1u));
+                cameraChangedThisFrame = true;
+            }
+
+            if (cameraChangedThisFrame)
+            {
+                frameCameraIndex = activeCameraIndex;
+                frameCameraVersion = camView.version;
+                viewMatrix = camView.view;
+                projMatrix = camView.proj;
+                viewProjMatrix = camView.viewProj;
+                frustum = camView.frustum;
+                if (RENDER_INTERLACED)
+                {
+                    const float fieldJitter = (framebuffer.getField() ? 0.5f : -0.5f) / static_cast<float>(viewport.height);
+                    CameraController::applyJitterY(projMatrix, fieldJitter);
+                    CameraController::applyJitterY(viewProjMatrix, fieldJitter);
+                    frustum.extractFromViewProjection(viewProjMatrix);
+                }
+            }
+
+            // Keyed on the eye the matrices were built from, so suppressed
+            // jitter keeps the shaded faces too.
+            const uint32_t sceneKey = LightingCache::sceneKey(camView.eye,
+                                                              lights.data(),
+                                                              activeLightCount);
+            lightingCache.beginFrame(sceneKey);
+
+            if (retainedBackdrop)
+            {
+                backdropCache.beginFrame();
+                if (cameraChangedThisFrame || sceneKey != backdropSceneKey)
+                    backdropCache.invalidate();
+                backdropSceneKey = sceneKey;
+            }
+
+            if (dirtyTilesEnabled)
+            {
+                dirtyTiles.beginFrame();
+                // Camera and lights change every pixel.
+                if (cameraChangedThisFrame || sceneKey != dirtySceneKey)
+                    dirtyTiles.markAll();
+                dirtySceneKey = sceneKey;
+            }
+
+            statsTrianglesTotal = 0;
+            statsTrianglesBackfaceCulled = 0;
+            statsInstancesTotal = 0;
+            statsInstancesFrustumCulled = 0;
+            statsInstancesOcclusionCulled = 0;
+            statsInstancesReducedLOD = 0;
+        }
+
+        __attribute__((always_inline)) inline void addDirtyContent(int16_t x, int16_t y, int16_t w, int16_t h, uint32_t key)
         {
-            DirtyRegionHelper::addDirtyRect(instance, x, y, w, h,
-                                            viewport,
-                                            worldInstanceDirty,
-                                            worldDirtyMinX,
-                                            worldDirtyMinY,
-                                            worldDirtyMaxX,
-                                            worldDirtyMaxY,
-                                            hasWorldDirtyRegion);
+            if (dirtyTilesEnabled)
+                dirtyTiles.addContent(x, y, w, h, key);
         }
 
-        void addHudDirtyRect(int16_t x, int16_t y, int16_t w, int16_t h)
+        // Instances are tracked once per frame, while band 0 or the deferred
+        // recording draws them.
+        __attribute__((always_inline)) inline bool tracksDirtyInstances() const
         {
-            DirtyRegionHelper::addHudDirtyRect(x, y, w, h,
-                                               viewport,
-                                               hudDirtyMinX,
-                                               hudDirtyMinY,
-                                               hudDirtyMaxX,
-                                               hudDirtyMaxY,
-                                               hasHudDirtyRegion);
+            return dirtyTilesEnabled && currentBandIndex == 0;
         }
 
-        void addDirtyFromSphere(MeshInstance *instance, const Vector3 &c, float r)
+        uint32_t instanceDirtyKey(const MeshInstance *instance, const Mesh *mesh) const
+        {
+            uint32_t key = DirtyTileMap::hash(0, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(instance)));
+            key = DirtyTileMap::hash(key, instance->transformVersion());
+            key = DirtyTileMap::hash(key, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(mesh)));
+            return DirtyTileMap::hash(key, instance->color().rgb565 | (static_cast<uint32_t>(shadingMode) << 16));
+        }
+
+        // Shadow footprint: the bounding sphere pushed along the first light
+        // onto the shadow plane, widened by the grazing angle.
+        void addShadowDirty(MeshInstance *instance)
+        {
+            if (!getShadowsEnabled() || !instance || !instance->isVisible() || !instance->getMesh() || activeLightCount < 1)
+                return;
+
+            const Light &light = lights[0];
+            const Vector3 c = instance->center();
+            const float r = instance->radius();
+            const Vector3 &n = shadowSettings.plane.normal;
+
+            Vector3 dir = light.type == LIGHT_DIRECTIONAL ? light.direction : c - light.position;
+            dir.normalize();
+            const float nd = n.dot(dir);
+            if (fabsf(nd) < 0.05f)
+            {
+                markDirtyRect(0, 0, viewport.width, viewport.height);
+                return;
+            }
+
+            const float t = -(n.dot(c) + shadowSettings.plane.d) / nd;
+            if (t < 0.0f)
+                return;
+
+            float scale = 1.0f / fabsf(nd);
+            if (light.type != LIGHT_DIRECTIONAL)
+            {
+                const float toCaster = (c - light.position).length();
+                if (toCaster > 1e-4f)
+                    scale *= (toCaster + t) / toCaster;
+            }
+
+            uint32_t key = DirtyTileMap::hash(instanceDirtyKey(instance, instance->getMesh()), 0x5badu);
+            key = DirtyTileMap::hash(key, static_cast<uint32_t>(shadowSettings.shadowOpacity * 255.0f));
+            addDirtyFromSphere(key, c + dir * t, r * scale);
+        }
+
+        void addDirtyFromSphere(uint32_t key, const Vector3 &c, float r)
         {
             if (r <= 0.0f)
                 return;
@@ -951,22 +1989,18 @@ namespace pip3D
             int16_t x1 = (int16_t)(pc.x + rScr + 1.0f);
             int16_t y1 = (int16_t)(pc.y + rScr + 1.0f);
 
-            addDirtyRect(instance, x0, y0, x1 - x0, y1 - y0);
+            addDirtyContent(x0, y0, x1 - x0, y1 - y0, key);
         }
 
-        __attribute__((always_inline)) inline void drawWaterTriangleInternal(const Vector3 &v0,
-                                                                             const Vector3 &v1,
-                                                                             const Vector3 &v2,
+        // Corners are already projected to screen space.
+        __attribute__((always_inline)) inline void drawWaterTriangleInternal(const Vector3 &p0,
+                                                                             const Vector3 &p1,
+                                                                             const Vector3 &p2,
                                                                              const Color &waterColor,
                                                                              uint8_t alphaByte,
-                                                                             const Camera &cam,
                                                                              const DisplayConfig &cfg,
                                                                              uint16_t *frameBufferPtr)
         {
-            Vector3 p0 = CameraController::project(v0, viewProjMatrix, viewport);
-            Vector3 p1 = CameraController::project(v1, viewProjMatrix, viewport);
-            Vector3 p2 = CameraController::project(v2, viewProjMatrix, viewport);
-
             float x0 = p0.x, y0 = p0.y, z0 = p0.z;
             float x1 = p1.x, y1 = p1.y, z1 = p1.z;
             float x2 = p2.x, y2 = p2.y, z2 = p2.z;
@@ -1018,33 +2052,56 @@ namespace pip3D
             }
             float invDenom = 1.0f / denom;
 
+            // Barycentric weights are linear in px along a row, so the
+            // covered pixels form one span; w = a * px + b >= 0 bounds it.
+            const float a0 = (y1 - y2) * invDenom;
+            const float a1 = (y2 - y0) * invDenom;
+            const float a2 = -a0 - a1;
+
             for (int16_t y = minY; y <= maxY; ++y)
             {
                 float py = static_cast<float>(y) + 0.5f;
                 int16_t yLocal = static_cast<int16_t>(y - bandTop);
 
-                for (int16_t x = minX; x <= maxX; ++x)
-                {
-                    float px = static_cast<float>(x) + 0.5f;
+                const float b0 = ((x2 - x1) * (py - y2) - (y1 - y2) * x2) * invDenom;
+                const float b1 = ((x0 - x2) * (py - y2) - (y2 - y0) * x2) * invDenom;
+                const float b2 = 1.0f - b0 - b1;
 
-                    float w0 = ((y1 - y2) * (px - x2) + (x2 - x1) * (py - y2)) * invDenom;
-                    float w1 = ((y2 - y0) * (px - x2) + (x0 - x2) * (py - y2)) * invDenom;
-                    float w2 = 1.0f - w0 - w1;
+                float lo = static_cast<float>(minX) + 0.5f;
+                float hi = static_cast<float>(maxX) + 0.5f;
+                if (!clipWaterSpan(a0, b0, lo, hi) || !clipWaterSpan(a1, b1, lo, hi) || !clipWaterSpan(a2, b2, lo, hi))
+                    continue;
 
-                    if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
-                        continue;
+                const int16_t xs = static_cast<int16_t>(ceilf(lo - 0.5f));
+                const int16_t xe = static_cast<int16_t>(floorf(hi - 0.5f));
+                if (xs > xe)
+                    continue;
 
-                    uint16_t &dst = frameBufferPtr[yLocal * cfg.width + x];
-                    Color bg(dst);
-                    dst = bg.blend(waterColor, alphaByte).rgb565;
-                }
+                SpanKernels::blendSpan(frameBufferPtr + yLocal * cfg.width + xs,
+                                       static_cast<size_t>(xe - xs + 1),
+                                       waterColor.rgb565, alphaByte);
             }
         }
 
+        // Narrows [lo, hi] to where a * px + b >= 0; false when empty.
+        static __attribute__((always_inline)) inline bool clipWaterSpan(float a, float b, float &lo, float &hi)
+        {
+            if (a > 0.0f)
+                lo = fmaxf(lo, -b / a);
+            else if (a < 0.0f)
+                hi = fminf(hi, -b / a);
+            else if (b < 0.0f)
+                return false;
+            return lo <= hi;
+        }
+
         ~Renderer()
         {
+            framebuffer.waitTransfer();
             if (zBuffer)
                 delete zBuffer;
+            if (zBufferBack)
+                delete zBufferBack;
             if (display)
                 delete display;
         }
@@ -0,0 +1,248 @@
+#ifndef BANDBALANCER_H
+#define BANDBALANCER_H
+
+#include "../../Core/Core.h"
+#include "../Display/DirtyRegions.h"
+
+// Rows a band edge moves by; the dirty tile size keeps tile rows whole.
+#ifndef PIP3D_BAND_BALANCE_STEP
+#define PIP3D_BAND_BALANCE_STEP PIP3D_DIRTY_TILE_SIZE
+#endif
+
+namespace pip3D
+{
+
+    // Moves the band edges between frames so every band costs about the
+    // same to render, which is what lets paired bands on two cores finish
+    // together. A band's cost is its time last frame, or its triangle count
+    // when the frame was too quick to time. It is spread over the band's
+    // PIP3D_BAND_BALANCE_STEP row slices by the triangles touching each
+    // (countRows()), or evenly when they were not counted, into a per-row
+    // cost profile; the edges go where the profile splits the total evenly.
+    // No band outgrows SCREEN_BAND_CAPACITY.
+    class BandBalancer
+    {
+    private:
+        // Frames rendered faster than this are balanced by triangle count.
+        static constexpr uint32_t MIN_TIMED_US = 200;
+        // Bands within this fraction of the mean cost are left alone.
+        static constexpr float TOLERANCE = 0.10f;
+        // Weight of the latest frame in the profile.
+        static constexpr float RESPONSE = 0.5f;
+        static constexpr int STEP = PIP3D_BAND_BALANCE_STEP;
+        static constexpr int SLICES = (SCREEN_HEIGHT + STEP - 1) / STEP;
+        static constexpr int MIN_ROWS = STEP < SCREEN_BAND_HEIGHT ? STEP : SCREEN_BAND_HEIGHT;
+
+        uint32_t timeUs[SCREEN_BAND_COUNT];
+        uint32_t triangles[SCREEN_BAND_COUNT];
+        bool measured[SCREEN_BAND_COUNT];
+
+        // Triangles starting minus triangles ending at each slice.
+        int32_t spans[SLICES + 1];
+        bool rowsCounted;
+
+        float profile[SLICES];
+        bool primed;
+        bool timedProfile;
+
+        void forget()
+        {
+            for (int b = 0; b < SCREEN_BAND_COUNT; ++b)
+                measured[b] = false;
+            for (int s = 0; s <= SLICES; ++s)
+                spans[s] = 0;
+            rowsCounted = false;
+        }
+
+        static int sliceRows(int s)
+        {
+            const int end = (s + 1) * STEP;
+            return (end < SCREEN_HEIGHT ? end : SCREEN_HEIGHT) - s * STEP;
+        }
+
+        void learn(const BandLayout &layout, const uint32_t *cost)
+        {
+            // Triangles touching each slice, and their total per band.
+            int32_t touching[SLICES];
+            float bandTouching[SCREEN_BAND_COUNT] = {};
+            int32_t running = 0;
+            for (int s = 0; s < SLICES; ++s)
+            {
+                running += spans[s];
+                touching[s] = running;
+                bandTouching[layout.bandAt(s * STEP + sliceRows(s) / 2)] += running;
+            }
+
+            for (int b = 0; b < SCREEN_BAND_COUNT; ++b)
+            {
+                const int top = layout.top[b];
+                const int bottom = layout.top[b + 1];
+                const bool byTriangles = rowsCounted && bandTouching[b] > 0.0f;
+                for (int s = top / STEP; s < SLICES && s * STEP < bottom; ++s)
+                {
+                    const int from = s * STEP > top ? s * STEP : top;
+                    const int to = s * STEP + sliceRows(s) < bottom ? s * STEP + sliceRows(s) : bottom;
+                    float perRow;
+                    float share;
+                    if (byTriangles)
+                    {
+                        // The slice belongs to the band holding its middle.
+                        if (layout.bandAt(s * STEP + sliceRows(s) / 2) != b)
+                            continue;
+                        perRow = cost[b] * (touching[s] / bandTouching[b]) / sliceRows(s);
+                        share = 1.0f;
+                    }
+                    else
+                    {
+                        perRow = static_cast<float>(cost[b]) / (bottom - top);
+                        share = static_cast<float>(to - from) / sliceRows(s);
+                    }
+                    profile[s] += (perRow - profile[s]) * (primed ? RESPONSE * share : share);
+                }
+            }
+            primed = true;
+        }
+
+    public:
+        BandBalancer()
+        {
+            for (int b = 0; b < SCREEN_BAND_COUNT; ++b)
+            {
+                timeUs[b] = 0;
+                triangles[b] = 0;
+            }
+            for (int s = 0; s < SLICES; ++s)
+                profile[s] = 0.0f;
+            primed = false;
+            timedProfile = false;
+            forget();
+        }
+
+        // Back to uniform bands.
+        void reset()
+        {
+            forget();
+            primed = false;
+            bandLayout().reset();
+        }
+
+        // Cost of a band of the frame being rendered.
+        void record(int band, uint32_t micros, uint32_t triangleCount)
+        {
+            if (band < 0 || band >= SCREEN_BAND_COUNT)
+                return;
+            timeUs[band] = micros;
+            triangles[band] = triangleCount;
+            measured[band] = true;
+        }
+
+        // Rows [minY, maxY] of a triangle of the frame being rendered.
+        __attribute__((always_inline)) inline void countRows(int minY, int maxY)
+        {
+            minY = minY < 0 ? 0 : minY;
+            maxY = maxY >= SCREEN_HEIGHT ? SCREEN_HEIGHT - 1 : maxY;
+            if (minY > maxY)
+                return;
+            spans[minY / STEP]++;
+            spans[maxY / STEP + 1]--;
+            rowsCounted = true;
+        }
+
+        // Moves the edges of bandLayout() from the costs recorded since the
+        // last call; needs every band measured. True when an edge moved.
+        bool rebalance()
+        {
+            bool complete = true;
+            uint32_t totalUs = 0;
+            uint32_t totalTriangles = 0;
+            for (int b = 0; b < SCREEN_BAND_COUNT; ++b)
+            {
+                complete = complete && measured[b];
+                totalUs += timeUs[b];
+                totalTriangles += triangles[b];
+            }
+
+            const bool timed = totalUs >= MIN_TIMED_US;
+            const uint32_t *cost = timed ? timeUs : triangles;
+            const uint32_t total = timed ? totalUs : totalTriangles;
+            if (!complete || total == 0)
+            {
+                forget();
+                return false;
+            }
+
+            // Times and triangle counts do not mix.
+            if (timed != timedProfile)
+            {
+                primed = false;
+                timedProfile = timed;
+            }
+
+            BandLayout &layout = bandLayout();
+            learn(layout, cost);
+            forget();
+
+            uint32_t worst = 0;
+            for (int b = 0; b < SCREEN_BAND_COUNT; ++b)
+                worst = cost[b] > worst ? cost[b] : worst;
+            if (worst <= total * (1.0f + TOLERANCE) / SCREEN_BAND_COUNT)
+                return false;
+
+            float sum = 0.0f;
+            for (int s = 0; s < SLICES; ++s)
+                sum += profile[s] * sliceRows(s);
+            if (sum <= 0.0f)
+                return false;
+
+            bool moved = false;
+            int prev = 0;
+            int s = 0;
+            float done = 0.0f;
+            for (int k = 1; k < SCREEN_BAND_COUNT; ++k)
+            {
+                // Slice boundary nearest to where the profile reaches k
+                // shares of the total.
+                const float want = sum * k / SCREEN_BAND_COUNT;
+                while (s < SLICES && done + profile[s] * sliceRows(s) * 0.5f < want)
+                {
+                    done += profile[s] * sliceRows(s);
+                    ++s;
+                }
+                int edge = s * STEP < SCREEN_HEIGHT ? s * STEP : SCREEN_HEIGHT;
+
+                // Small moves are not worth a new layout.
+                if (edge - layout.top[k] < STEP && layout.top[k] - edge < STEP)
+                    edge = layout.top[k];
+
+                // Leave the bands below room to fit in between MIN_ROWS and
+                // SCREEN_BAND_CAPACITY rows each.
+                const int left = SCREEN_BAND_COUNT - k;
+                int lo = prev + MIN_ROWS;
+                if (lo < SCREEN_HEIGHT - left * SCREEN_BAND_CAPACITY)
+                    lo = SCREEN_HEIGHT - left * SCREEN_BAND_CAPACITY;
+                int hi = prev + SCREEN_BAND_CAPACITY;
+                if (hi > SCREEN_HEIGHT - left * MIN_ROWS)
+                    hi = SCREEN_HEIGHT - left * MIN_ROWS;
+                edge = edge < lo ? lo : (edge > hi ? hi : edge);
+
+                moved = moved || edge != layout.top[k];
+                layout.top[k] = static_cast<int16_t>(edge);
+                prev = edge;
+            }
+            return moved;
+        }
+
+        // Last recorded cost of a band, for telemetry.
+        uint32_t bandTime(int band) const
+        {
+            return band >= 0 && band < SCREEN_BAND_COUNT ? timeUs[band] : 0;
+        }
+        uint32_t bandTriangles(int band) const
+        {
+            return band >= 0 && band < SCREEN_BAND_COUNT ? triangles[band] : 0;
+        }
+    };
+
+}
+
+#endif
@@ -8,28 +8,74 @@
 
 namespace pip3D
 {
+    // Matrices and frustum last built for one camera, with the camera state
+    // they were built from. version changes only when they are rebuilt.
+    struct CameraView
+    {
+        Matrix4x4 view, proj, viewProj;
+        CameraFrustum frustum;
+
+        Vector3 eye, target, up;
+        float fov, nearPlane, farPlane, orthoWidth, orthoHeight, fisheyeStrength, aspect;
+        ProjectionType projectionType;
+
+        uint32_t version;
+        bool valid;
+
+        CameraView() : fov(0), nearPlane(0), farPlane(0), orthoWidth(0), orthoHeight(0),
+                       fisheyeStrength(0), aspect(0), projectionType(PERSPECTIVE),
+                       version(0), valid(false) {}
+    };
+
     class CameraController
     {
     public:
-        static void updateViewProjectionIfNeeded(Camera &camera,
-                                                 const Viewport &viewport,
-                                                 Matrix4x4 &viewMatrix,
-                                                 Matrix4x4 &projMatrix,
-                                                 Matrix4x4 &viewProjMatrix,
-                                                 Frustum &frustum,
-                                                 bool &viewProjMatrixDirty,
-                                                 bool &cameraChangedThisFrame)
+        // Rebuilds cached when the camera moved by at least
+        // camera.config.jitterPixels on screen or its projection changed;
+        // smaller moves keep the old matrices. Returns true on a rebuild.
+        static bool refresh(Camera &camera, const Viewport &viewport, CameraView &cached)
         {
-            if (viewProjMatrixDirty || camera.cache.flags.viewDirty || camera.cache.flags.projDirty)
+            // Aspect of the panel, which differs from the viewport's at
+            // reduced render resolution.
+            const float aspect = (float)(viewport.width * RENDER_SCALE_X) / (viewport.height * RENDER_SCALE_Y);
+
+            if (cached.valid && sameProjection(camera, cached, aspect) &&
+                screenShift(camera, viewport, cached) < camera.config.jitterPixels)
             {
-                cameraChangedThisFrame = true;
-                float aspect = (float)viewport.width / viewport.height;
-                viewMatrix = camera.getViewMatrix();
-                projMatrix = camera.getProjectionMatrix(aspect);
-                viewProjMatrix = projMatrix * viewMatrix;
-                viewProjMatrixDirty = false;
-                frustum.extractFromViewProjection(viewProjMatrix);
+                return false;
             }
+
+            // The camera's own flags may have been cleared by another caller;
+            // the snapshot above is what decides a rebuild.
+            camera.markDirty();
+            cached.view = camera.getViewMatrix();
+            cached.proj = camera.getProjectionMatrix(aspect);
+            cached.viewProj = cached.proj * cached.view;
+            cached.frustum.extractFromViewProjection(cached.viewProj);
+
+            cached.eye = camera.position;
+            cached.target = camera.target;
+            cached.up = camera.up;
+            cached.fov = camera.fov;
+            cached.nearPlane = camera.nearPlane;
+            cached.farPlane = camera.farPlane;
+            cached.orthoWidth = camera.orthoWidth;
+            cached.orthoHeight = camera.orthoHeight;
+            cached.fisheyeStrength = camera.fisheyeStrength;
+            cached.aspect = aspect;
+            cached.projectionType = camera.projectionType;
+            cached.version++;
+            cached.valid = true;
+            return true;
+        }
+
+        // Sub-pixel vertical shift of the image in NDC, for interlaced
+        // fields. The row operation commutes with the view matrix, so it
+        // applies to projection and view-projection alike.
+        static void applyJitterY(Matrix4x4 &m, float jitterY)
+        {
+            for (int c = 0; c < 4; ++c)
+                m.m[c * 4 + 1] += jitterY * m.m[c * 4 + 3];
         }
 
         static Vector3 project(const Vector3 &v,
@@ -41,6 +87,40 @@ namespace pip3D
             projected.y = (1.0f - projected.y) * viewport.height * 0.5f + viewport.y;
             return projected;
         }
+
+    private:
+        static bool sameProjection(const Camera &camera, const CameraView &cached, float aspect)
+        {
+            return camera.projectionType == cached.projectionType &&
+                   camera.fov == cached.fov &&
+                   camera.nearPlane == cached.nearPlane &&
+                   camera.farPlane == cached.farPlane &&
+                   camera.orthoWidth == cached.orthoWidth &&
+                   camera.orthoHeight == cached.orthoHeight &&
+                   camera.fisheyeStrength == cached.fisheyeStrength &&
+                   fabsf(aspect - cached.aspect) <= camera.config.aspectEps;
+        }
+
+        // Rough on-screen movement, in pixels, of content around the target
+        // since the cached matrices were built.
+        static float screenShift(const Camera &camera, const Viewport &viewport, const CameraView &cached)
+        {
+            float pixelsPerUnit;
+            if (camera.projectionType == ORTHOGRAPHIC)
+            {
+                pixelsPerUnit = viewport.height / camera.orthoHeight;
+            }
+            else
+            {
+                const float dist = fmaxf((cached.target - cached.eye).length(), camera.nearPlane);
+                const float focal = viewport.height * 0.5f / tanf(fminf(camera.fov, 170.0f) * 0.5f * DEG2RAD);
+                pixelsPerUnit = focal / dist;
+            }
+
+            const float moved = (camera.position - cached.eye).length() + (camera.target - cached.target).length();
+            const float rolled = (camera.up - cached.up).length() * viewport.width * 0.5f;
+            return moved * pixelsPerUnit + rolled;
+        }
     };
 }
 
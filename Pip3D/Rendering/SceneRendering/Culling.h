@@ -5,6 +5,7 @@
 #include "../../Core/Camera.h"
 #include "../../Math/Math.h"
 #include "../Display/ZBuffer.h"
+#include "../Display/HiZBuffer.h"
 #include "CameraController.h"
 
 #ifndef IRAM_ATTR
@@ -13,81 +14,93 @@
 
 namespace pip3D
 {
+    // Inclusive pixel rect in full-screen coordinates.
+    struct ScreenRect
+    {
+        int16_t x0, y0;
+        int16_t x1, y1;
+    };
+
     class Culling
     {
     public:
-        static bool IRAM_ATTR isInstanceOccluded(const Vector3 &center,
+        // Conservative screen rect and nearest raw depth of a bounding sphere,
+        // from the projected corners of its enclosing cube. Returns false when
+        // the sphere reaches the near plane and cannot be bounded.
+        static bool IRAM_ATTR sphereScreenBounds(const Vector3 &center,
                                                  float radius,
                                                  const Camera &camera,
                                                  const Viewport &viewport,
                                                  const Matrix4x4 &viewProjMatrix,
-                                                 ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
-                                                 const DisplayConfig &cfg)
+                                                 ScreenRect &rect,
+                                                 int32_t &nearDepth)
         {
-            if (!zBuffer || radius <= 0.0f)
+            if (radius <= 0.0f)
                 return false;
 
-            Vector3 pc = CameraController::project(center, viewProjMatrix, viewport);
+            const Vector3 fwd = camera.forward();
+            const float distForward = (center - camera.position).dot(fwd);
 
-            if (camera.projectionType == PERSPECTIVE && pc.z <= 0.0f)
+            if (camera.projectionType == PERSPECTIVE &&
+                distForward - radius * 1.7320508f <= camera.nearPlane)
                 return false;
 
-            Vector3 toCenter = center - camera.position;
-            float distSq = toCenter.dot(toCenter);
-            if (distSq <= 1e-8f)
-                return false;
-
-            float distToCenter = sqrtf(distSq);
-            Vector3 dirToCenter = toCenter * (1.0f / distToCenter);
-
-            Vector3 frontWorld = center - dirToCenter * radius;
-            Vector3 frontProj = viewProjMatrix.transform(frontWorld);
-            float objDepth = frontProj.z;
-
-            Vector3 py = CameraController::project(Vector3(center.x, center.y + radius, center.z),
-                                                   viewProjMatrix, viewport);
-
-            float rScr = fabsf(py.y - pc.y);
-            if (rScr < 1.0f)
-                rScr = 1.0f;
-
-            int16_t cx = (int16_t)pc.x;
-            int16_t cy = (int16_t)pc.y;
-
-            const float eps = 1e-3f;
-
-            const int16_t offsets[5][2] = {
-                {0, 0},
-                {(int16_t)rScr, 0},
-                {(int16_t)-rScr, 0},
-                {0, (int16_t)rScr},
-                {0, (int16_t)-rScr}};
-
-            int validSamples = 0;
-
-            for (int i = 0; i < 5; ++i)
+            float minX = 1e30f, minY = 1e30f;
+            float maxX = -1e30f, maxY = -1e30f;
+            for (int i = 0; i < 8; ++i)
             {
-                int16_t sx = cx + offsets[i][0];
-                int16_t sy = cy + offsets[i][1];
+                Vector3 corner(center.x + ((i & 1) ? radius : -radius),
+                               center.y + ((i & 2) ? radius : -radius),
+                               center.z + ((i & 4) ? radius : -radius));
+                Vector3 p = CameraController::project(corner, viewProjMatrix, viewport);
+                minX = fminf(minX, p.x);
+                maxX = fmaxf(maxX, p.x);
+                minY = fminf(minY, p.y);
+                maxY = fmaxf(maxY, p.y);
+            }
 
-                if (sx < 0 || sy < 0 || sx >= cfg.width || sy >= cfg.height)
-                    continue;
+            // Depth only depends on distance along the view axis, so the
+            // point pushed toward the camera is the sphere's nearest depth.
+            Vector3 nearest = viewProjMatrix.transform(center - fwd * radius);
+            if (nearest.z <= 0.0f)
+                return false;
 
-                ++validSamples;
+            rect.x0 = static_cast<int16_t>(fmaxf(floorf(minX), -16384.0f));
+            rect.y0 = static_cast<int16_t>(fmaxf(floorf(minY), -16384.0f));
+            rect.x1 = static_cast<int16_t>(fminf(ceilf(maxX), 16383.0f));
+            rect.y1 = static_cast<int16_t>(fminf(ceilf(maxY), 16383.0f));
+            nearDepth = static_cast<int32_t>(nearest.z * 32767.0f);
+            return true;
+        }
 
-                float depth = zBuffer->getDepth01((uint16_t)sx, (uint16_t)sy);
+        // Tests a bounded instance against the current band's Hi-Z tiles.
+        static bool IRAM_ATTR isInstanceOccluded(const ScreenRect &rect,
+                                                 int32_t nearDepth,
+                                                 HiZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> &hiZ,
+                                                 const ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer)
+        {
+            if (!zBuffer)
+                return false;
 
-                if (depth >= 1.0f)
-                    return false;
+            const int16_t bandTop = currentBandOffsetY();
+            const int16_t bandBottom = static_cast<int16_t>(bandTop + currentBandHeight() - 1);
+            if (rect.y1 < bandTop || rect.y0 > bandBottom)
+                return false;
 
-                if (depth >= objDepth - eps)
-                    return false;
-            }
+            const int16_t y0 = rect.y0 > bandTop ? rect.y0 : bandTop;
+            const int16_t y1 = rect.y1 < bandBottom ? rect.y1 : bandBottom;
 
-            if (validSamples == 0)
-                return false;
+            return hiZ.isOccluded(rect.x0, static_cast<int16_t>(y0 - bandTop),
+                                  rect.x1, static_cast<int16_t>(y1 - bandTop),
+                                  nearDepth, *zBuffer);
+        }
 
-            return true;
+        static void markDrawn(const ScreenRect &rect,
+                              HiZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> &hiZ)
+        {
+            const int16_t bandTop = currentBandOffsetY();
+            hiZ.markDirty(rect.x0, static_cast<int16_t>(rect.y0 - bandTop),
+                          rect.x1, static_cast<int16_t>(rect.y1 - bandTop));
         }
     };
 }
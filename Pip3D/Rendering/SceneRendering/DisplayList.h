@@ -0,0 +1,346 @@
+#ifndef DISPLAYLIST_H
+#define DISPLAYLIST_H
+
+#include "../../Core/Core.h"
+#include "../../Math/Math.h"
+#include "../Display/ZBuffer.h"
+#include "../Display/DirtyRegions.h"
+#include "../Rasterizer/Rasterizer.h"
+
+#ifndef PIP3D_DISPLAY_LIST_CAPACITY
+#define PIP3D_DISPLAY_LIST_CAPACITY 2048
+#endif
+
+// Textured triangles a frame can record; their attributes (40 bytes each)
+// are allocated on first use.
+#ifndef PIP3D_DISPLAY_LIST_TEXTURED_CAPACITY
+#define PIP3D_DISPLAY_LIST_TEXTURED_CAPACITY PIP3D_DISPLAY_LIST_CAPACITY
+#endif
+
+namespace pip3D
+{
+
+    // Shaded, projected triangle in full-screen coordinates. Textured ones
+    // carry the tint in color and index their TexturedAttrib.
+    struct BinnedTriangle
+    {
+        static constexpr uint16_t NO_TEXTURE = 0xFFFF;
+
+        int16_t x0, y0;
+        int16_t x1, y1;
+        int16_t x2, y2;
+        float z0, z1, z2;
+        uint16_t color;
+        uint8_t firstBand;
+        uint8_t lastBand;
+        uint16_t textured;
+    };
+
+    struct TexturedAttrib
+    {
+        const Texture *texture;
+        float q[3];
+        float u[3];
+        float v[3];
+    };
+
+    // Deferred triangle list: filled once per frame, then binned per band so
+    // each band only rasterizes the triangles that overlap it.
+    class DisplayList
+    {
+    private:
+        BinnedTriangle *triangles;
+        uint16_t capacity;
+        uint16_t count;
+        uint32_t dropped;
+
+        TexturedAttrib *texturedAttribs;
+        uint16_t texturedCount;
+
+        uint16_t *binIndices;
+        uint32_t binIndexCapacity;
+        uint32_t binOffset[SCREEN_BAND_COUNT + 1];
+        bool binned;
+
+    public:
+        DisplayList() : triangles(nullptr), capacity(0), count(0), dropped(0),
+                        texturedAttribs(nullptr), texturedCount(0),
+                        binIndices(nullptr), binIndexCapacity(0), binned(false)
+        {
+            for (int i = 0; i <= SCREEN_BAND_COUNT; ++i)
+                binOffset[i] = 0;
+        }
+
+        ~DisplayList()
+        {
+            release();
+        }
+
+        DisplayList(const DisplayList &) = delete;
+        DisplayList &operator=(const DisplayList &) = delete;
+
+        bool init(uint16_t maxTriangles = PIP3D_DISPLAY_LIST_CAPACITY)
+        {
+            if (triangles && capacity >= maxTriangles)
+                return true;
+
+            release();
+
+            triangles = static_cast<BinnedTriangle *>(
+                MemUtils::allocData(static_cast<size_t>(maxTriangles) * sizeof(BinnedTriangle), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+            if (!triangles)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "DisplayList::init: allocation failed (triangles=%u)",
+                     static_cast<unsigned int>(maxTriangles));
+                return false;
+            }
+            capacity = maxTriangles;
+            return true;
+        }
+
+        void release()
+        {
+            if (triangles)
+                MemUtils::freeData(triangles);
+            if (binIndices)
+                MemUtils::freeData(binIndices);
+            if (texturedAttribs)
+                MemUtils::freeData(texturedAttribs);
+            triangles = nullptr;
+            binIndices = nullptr;
+            texturedAttribs = nullptr;
+            texturedCount = 0;
+            capacity = 0;
+            binIndexCapacity = 0;
+            count = 0;
+            binned = false;
+        }
+
+        __attribute__((always_inline)) inline bool isReady() const { return triangles != nullptr; }
+
+        void clear()
+        {
+            count = 0;
+            texturedCount = 0;
+            dropped = 0;
+            binned = false;
+        }
+
+        void add(const Vector3 &p0, const Vector3 &p1, const Vector3 &p2, uint16_t color)
+        {
+            if (unlikely(count >= capacity))
+            {
+                if (dropped++ == 0)
+                {
+                    LOGW(::pip3D::Debug::LOG_MODULE_RENDER,
+                         "DisplayList::add: capacity %u reached, dropping triangles",
+                         static_cast<unsigned int>(capacity));
+                }
+                return;
+            }
+
+            float minY = fminf(p0.y, fminf(p1.y, p2.y));
+            float maxY = fmaxf(p0.y, fmaxf(p1.y, p2.y));
+            if (maxY < 0.0f || minY >= static_cast<float>(SCREEN_HEIGHT))
+                return;
+
+            const BandLayout &bands = bandLayout();
+            const int first = bands.bandAt(static_cast<int>(minY));
+            const int last = bands.bandAt(static_cast<int>(maxY));
+
+            BinnedTriangle &t = triangles[count++];
+            t.x0 = (int16_t)p0.x;
+            t.y0 = (int16_t)p0.y;
+            t.x1 = (int16_t)p1.x;
+            t.y1 = (int16_t)p1.y;
+            t.x2 = (int16_t)p2.x;
+            t.y2 = (int16_t)p2.y;
+            t.z0 = p0.z;
+            t.z1 = p1.z;
+            t.z2 = p2.z;
+            t.color = color;
+            t.firstBand = static_cast<uint8_t>(first);
+            t.lastBand = static_cast<uint8_t>(last);
+            t.textured = BinnedTriangle::NO_TEXTURE;
+        }
+
+        // q is 1/w and u, v are in texels per corner; modulate is a plain
+        // RGB565 tint. Past the textured capacity the triangle is recorded
+        // flat in the tint color.
+        void addTextured(const Vector3 &p0, const Vector3 &p1, const Vector3 &p2,
+                         const float *q, const float *u, const float *v,
+                         const Texture *texture, uint16_t modulate)
+        {
+            if (!texturedAttribs)
+            {
+                texturedAttribs = static_cast<TexturedAttrib *>(
+                    MemUtils::allocData(PIP3D_DISPLAY_LIST_TEXTURED_CAPACITY * sizeof(TexturedAttrib), 16,
+                                        ::pip3D::Debug::LOG_MODULE_RENDER));
+                if (!texturedAttribs)
+                {
+                    LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                         "DisplayList::addTextured: allocation failed (triangles=%u)",
+                         static_cast<unsigned int>(PIP3D_DISPLAY_LIST_TEXTURED_CAPACITY));
+                }
+            }
+
+            const uint16_t before = count;
+            add(p0, p1, p2, PixelFormat::encode(modulate));
+            if (count == before || !texturedAttribs)
+                return;
+            if (unlikely(texturedCount >= PIP3D_DISPLAY_LIST_TEXTURED_CAPACITY))
+            {
+                if (texturedCount++ == PIP3D_DISPLAY_LIST_TEXTURED_CAPACITY)
+                {
+                    LOGW(::pip3D::Debug::LOG_MODULE_RENDER,
+                         "DisplayList::addTextured: capacity %u reached, drawing untextured",
+                         static_cast<unsigned int>(PIP3D_DISPLAY_LIST_TEXTURED_CAPACITY));
+                }
+                return;
+            }
+
+            TexturedAttrib &a = texturedAttribs[texturedCount];
+            a.texture = texture;
+            for (int k = 0; k < 3; ++k)
+            {
+                a.q[k] = q[k];
+                a.u[k] = u[k];
+                a.v[k] = v[k];
+            }
+            triangles[before].color = modulate;
+            triangles[before].textured = texturedCount++;
+        }
+
+        // Counting sort of triangle indices into per-band bins, keeping
+        // submission order inside each bin.
+        bool finalize()
+        {
+            for (int b = 0; b <= SCREEN_BAND_COUNT; ++b)
+                binOffset[b] = 0;
+
+            for (uint16_t i = 0; i < count; ++i)
+            {
+                const BinnedTriangle &t = triangles[i];
+                for (int b = t.firstBand; b <= t.lastBand; ++b)
+                    binOffset[b + 1]++;
+            }
+
+            for (int b = 0; b < SCREEN_BAND_COUNT; ++b)
+                binOffset[b + 1] += binOffset[b];
+
+            const uint32_t total = binOffset[SCREEN_BAND_COUNT];
+            if (total > binIndexCapacity)
+            {
+                if (binIndices)
+                    MemUtils::freeData(binIndices);
+                binIndices = static_cast<uint16_t *>(MemUtils::allocData(total * sizeof(uint16_t), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+                if (!binIndices)
+                {
+                    LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                         "DisplayList::finalize: bin allocation failed (entries=%u)",
+                         static_cast<unsigned int>(total));
+                    binIndexCapacity = 0;
+                    binned = false;
+                    return false;
+                }
+                binIndexCapacity = total;
+            }
+
+            uint32_t cursor[SCREEN_BAND_COUNT];
+            for (int b = 0; b < SCREEN_BAND_COUNT; ++b)
+                cursor[b] = binOffset[b];
+
+            for (uint16_t i = 0; i < count; ++i)
+            {
+                const BinnedTriangle &t = triangles[i];
+                for (int b = t.firstBand; b <= t.lastBand; ++b)
+                    binIndices[cursor[b]++] = i;
+            }
+
+            binned = true;
+            return true;
+        }
+
+        void rasterizeBand(int bandIndex,
+                           uint16_t *frameBuffer,
+                           ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
+                           const DisplayConfig &config,
+                           const DirtyTileMap *tiles = nullptr,
+                           uint16_t firstTriangle = 0,
+                           uint16_t endTriangle = 0xFFFF) const
+        {
+            if (!binned || bandIndex < 0 || bandIndex >= SCREEN_BAND_COUNT)
+                return;
+
+            const int16_t bandTop = bandLayout().top[bandIndex];
+
+            for (uint32_t k = binOffset[bandIndex]; k < binOffset[bandIndex + 1]; ++k)
+            {
+                // Bins keep submission order, so a triangle range is a run.
+                const uint16_t index = binIndices[k];
+                if (index < firstTriangle)
+                    continue;
+                if (index >= endTriangle)
+                    break;
+                const BinnedTriangle &t = triangles[index];
+                if (tiles)
+                {
+                    // Triangles over clean tiles only would never be flushed.
+                    const int16_t minX = t.x0 < t.x1 ? (t.x0 < t.x2 ? t.x0 : t.x2) : (t.x1 < t.x2 ? t.x1 : t.x2);
+                    const int16_t maxX = t.x0 > t.x1 ? (t.x0 > t.x2 ? t.x0 : t.x2) : (t.x1 > t.x2 ? t.x1 : t.x2);
+                    const int16_t minY = t.y0 < t.y1 ? (t.y0 < t.y2 ? t.y0 : t.y2) : (t.y1 < t.y2 ? t.y1 : t.y2);
+                    const int16_t maxY = t.y0 > t.y1 ? (t.y0 > t.y2 ? t.y0 : t.y2) : (t.y1 > t.y2 ? t.y1 : t.y2);
+                    if (!tiles->anyDirty(minX, minY, maxX, maxY))
+                        continue;
+                }
+                if (t.textured != BinnedTriangle::NO_TEXTURE)
+                {
+                    const TexturedAttrib &a = texturedAttribs[t.textured];
+                    Rasterizer::fillTriangleTextured(t.x0, static_cast<int16_t>(t.y0 - bandTop), t.z0, a.q[0], a.u[0], a.v[0],
+                                                     t.x1, static_cast<int16_t>(t.y1 - bandTop), t.z1, a.q[1], a.u[1], a.v[1],
+                                                     t.x2, static_cast<int16_t>(t.y2 - bandTop), t.z2, a.q[2], a.u[2], a.v[2],
+                                                     *a.texture,
+                                                     t.color,
+                                                     frameBuffer,
+                                                     zBuffer,
+                                                     config);
+                    continue;
+                }
+                Rasterizer::fillTriangle(t.x0, static_cast<int16_t>(t.y0 - bandTop), t.z0,
+                                         t.x1, static_cast<int16_t>(t.y1 - bandTop), t.z1,
+                                         t.x2, static_cast<int16_t>(t.y2 - bandTop), t.z2,
+                                         t.color,
+                                         frameBuffer,
+                                         zBuffer,
+                                         config);
+            }
+        }
+
+        __attribute__((always_inline)) inline uint16_t size() const { return count; }
+        __attribute__((always_inline)) inline uint32_t droppedCount() const { return dropped; }
+        __attribute__((always_inline)) inline void rowSpan(uint16_t index, int &minY, int &maxY) const
+        {
+            const BinnedTriangle &t = triangles[index];
+            minY = t.y0 < t.y1 ? (t.y0 < t.y2 ? t.y0 : t.y2) : (t.y1 < t.y2 ? t.y1 : t.y2);
+            maxY = t.y0 > t.y1 ? (t.y0 > t.y2 ? t.y0 : t.y2) : (t.y1 > t.y2 ? t.y1 : t.y2);
+        }
+        __attribute__((always_inline)) inline uint32_t binSize(int bandIndex) const
+        {
+            if (bandIndex < 0 || bandIndex >= SCREEN_BAND_COUNT)
+                return 0;
+            return binOffset[bandIndex + 1] - binOffset[bandIndex];
+        }
+    };
+
+    // Display list receiving triangles while a deferred frame is being
+    // recorded; nullptr in immediate mode.
+    __attribute__((always_inline)) inline DisplayList *&activeDisplayList()
+    {
+        static DisplayList *list = nullptr;
+        return list;
+    }
+
+}
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef LIGHTINGCACHE_H
+#define LIGHTINGCACHE_H
+
+#include <string.h>
+#include "../../Core/Core.h"
+#include "../../Core/Camera.h"
+#include "../../Geometry/Mesh.h"
+#include "../Lighting/Lighting.h"
+
+#ifndef PIP3D_LIGHTING_CACHE_SLOTS
+#define PIP3D_LIGHTING_CACHE_SLOTS 16
+#endif
+
+namespace pip3D
+{
+
+    // Tone-mapped face color, 0..65535 per channel. lit == 0 means the face
+    // has not been shaded since the slot was last invalidated.
+    struct LitFace
+    {
+        uint16_t r;
+        uint16_t g;
+        uint16_t b;
+        uint16_t lit;
+    };
+
+    // Face lighting results kept across bands and frames. A slot stays valid
+    // while its owner keeps the same mesh, transform version and color and
+    // the scene key (camera position + light set) is unchanged; faces are
+    // shaded lazily on first draw.
+    class LightingCache
+    {
+    private:
+        struct Slot
+        {
+            const void *owner;
+            const Mesh *mesh;
+            uint32_t version;
+            uint32_t sceneKey;
+            uint32_t lastUsed;
+            LitFace *faces;
+            uint16_t color;
+            uint16_t capacity;
+            uint16_t count;
+        };
+
+        static constexpr int SLOT_COUNT = PIP3D_LIGHTING_CACHE_SLOTS;
+
+        Slot slots[SLOT_COUNT];
+        uint32_t frameId;
+        uint32_t currentSceneKey;
+
+        static uint32_t hashBytes(uint32_t h, const void *data, size_t size)
+        {
+            const uint8_t *bytes = static_cast<const uint8_t *>(data);
+            for (size_t i = 0; i < size; ++i)
+            {
+                h ^= bytes[i];
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        static uint32_t hashVector(uint32_t h, const Vector3 &v)
+        {
+            h = hashBytes(h, &v.x, sizeof(float));
+            h = hashBytes(h, &v.y, sizeof(float));
+            return hashBytes(h, &v.z, sizeof(float));
+        }
+
+        bool reserve(Slot &slot, uint16_t count)
+        {
+            if (slot.faces && slot.capacity >= count)
+                return true;
+
+            if (slot.faces)
+            {
+                MemUtils::freeData(slot.faces);
+                slot.faces = nullptr;
+                slot.capacity = 0;
+            }
+
+            slot.faces = static_cast<LitFace *>(
+                MemUtils::allocData(static_cast<size_t>(count) * sizeof(LitFace), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+            if (!slot.faces)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "LightingCache::reserve: allocation failed (faces=%u)",
+                     static_cast<unsigned int>(count));
+                return false;
+            }
+            slot.capacity = count;
+            return true;
+        }
+
+    public:
+        LightingCache() : frameId(1), currentSceneKey(0)
+        {
+            for (int i = 0; i < SLOT_COUNT; ++i)
+            {
+                slots[i] = {nullptr, nullptr, 0, 0, 0, nullptr, 0, 0, 0};
+            }
+        }
+
+        ~LightingCache()
+        {
+            release();
+        }
+
+        LightingCache(const LightingCache &) = delete;
+        LightingCache &operator=(const LightingCache &) = delete;
+
+        // Everything calculateLighting reads besides the face itself.
+        static uint32_t sceneKey(const Vector3 &eye, const Light *lights, int lightCount)
+        {
+            uint32_t h = 2166136261u;
+            h = hashVector(h, eye);
+            h = hashBytes(h, &lightCount, sizeof(lightCount));
+            for (int i = 0; i < lightCount; ++i)
+            {
+                const Light &light = lights[i];
+                const uint8_t type = static_cast<uint8_t>(light.type);
+                const uint16_t rgb = light.color.rgb565;
+                h = hashBytes(h, &type, sizeof(type));
+                h = hashBytes(h, &light.intensity, sizeof(float));
+                h = hashVector(h, light.direction);
+                h = hashVector(h, light.position);
+                h = hashBytes(h, &rgb, sizeof(rgb));
+                h = hashBytes(h, &light.range, sizeof(float));
+            }
+            return h;
+        }
+
+        void beginFrame(uint32_t key)
+        {
+            currentSceneKey = key;
+            ++frameId;
+            if (frameId == 0)
+                frameId = 1;
+        }
+
+        // Returns one LitFace per mesh face for owner, cleared whenever any
+        // part of the key changed since the previous call.
+        LitFace *acquire(const void *owner, const Mesh *mesh, uint32_t version, uint16_t color)
+        {
+            if (!owner || !mesh)
+                return nullptr;
+
+            const uint16_t count = mesh->numFaces();
+            if (count == 0)
+                return nullptr;
+
+            Slot *target = nullptr;
+            Slot *oldest = nullptr;
+            for (int i = 0; i < SLOT_COUNT; ++i)
+            {
+                Slot &slot = slots[i];
+                if (slot.owner == owner)
+                {
+                    target = &slot;
+                    break;
+                }
+                if (!oldest || !slot.owner ||
+                    (oldest->owner && slot.lastUsed < oldest->lastUsed))
+                    oldest = &slot;
+            }
+
+            if (target)
+            {
+                target->lastUsed = frameId;
+                if (target->mesh == mesh && target->count == count &&
+                    target->version == version && target->color == color &&
+                    target->sceneKey == currentSceneKey)
+                    return target->faces;
+            }
+            else
+            {
+                if (!oldest)
+                    return nullptr;
+                target = oldest;
+            }
+
+            if (!reserve(*target, count))
+            {
+                target->owner = nullptr;
+                return nullptr;
+            }
+
+            target->owner = owner;
+            target->mesh = mesh;
+            target->version = version;
+            target->color = color;
+            target->sceneKey = currentSceneKey;
+            target->lastUsed = frameId;
+            target->count = count;
+            memset(target->faces, 0, static_cast<size_t>(count) * sizeof(LitFace));
+            return target->faces;
+        }
+
+        void invalidate(const void *owner)
+        {
+            for (int i = 0; i < SLOT_COUNT; ++i)
+            {
+                if (slots[i].owner == owner)
+                    slots[i].owner = nullptr;
+            }
+        }
+
+        void release()
+        {
+            for (int i = 0; i < SLOT_COUNT; ++i)
+            {
+                if (slots[i].faces)
+                    MemUtils::freeData(slots[i].faces);
+                slots[i] = {nullptr, nullptr, 0, 0, 0, nullptr, 0, 0, 0};
+            }
+        }
+    };
+
+}
+
+#endif
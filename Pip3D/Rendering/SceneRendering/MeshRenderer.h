@@ -12,13 +12,55 @@
 #include "../Rasterizer/Rasterizer.h"
 #include "../Rasterizer/Shading.h"
 #include "CameraController.h"
+#include "VertexCache.h"
+#include "LightingCache.h"
+#include "DisplayList.h"
 
 namespace pip3D
 {
 
+    // Texture of a face being drawn and its corner coordinates in texels.
+    struct TexturedFace
+    {
+        const Texture *texture;
+        float u[3];
+        float v[3];
+    };
+
     class MeshRenderer
     {
     private:
+        // The texture a mesh is drawn with, nullptr when it has none or no
+        // coordinates to map it with.
+        static const Texture *meshTexture(const Mesh *mesh)
+        {
+            const Texture *tex = mesh->texture();
+            return tex && tex->isValid() && mesh->hasUVs() ? tex : nullptr;
+        }
+
+        static void setTexturedFace(const Mesh *mesh, const Texture *tex, const Face &face, TexturedFace &out)
+        {
+            const float su = tex->getWidth() * (1.0f / Mesh::UV_ONE);
+            const float sv = tex->getHeight() * (1.0f / Mesh::UV_ONE);
+            const uint16_t idx[3] = {face.v0, face.v1, face.v2};
+            out.texture = tex;
+            for (int k = 0; k < 3; ++k)
+            {
+                const TexCoord &c = mesh->uv(idx[k]);
+                out.u[k] = c.u * su;
+                out.v[k] = c.v * sv;
+            }
+        }
+
+        // Lit color as the plain RGB565 tint of a textured face.
+        static uint16_t packModulate(float r, float g, float b)
+        {
+            const uint16_t r5 = static_cast<uint16_t>(fminf(fmaxf(r, 0.0f), 1.0f) * 31.0f + 0.5f);
+            const uint16_t g6 = static_cast<uint16_t>(fminf(fmaxf(g, 0.0f), 1.0f) * 63.0f + 0.5f);
+            const uint16_t b5 = static_cast<uint16_t>(fminf(fmaxf(b, 0.0f), 1.0f) * 31.0f + 0.5f);
+            return static_cast<uint16_t>((r5 << 11) | (g6 << 5) | b5);
+        }
+
         static void decodeColorToFloat(uint16_t color,
                                        float &baseR,
                                        float &baseG,
@@ -38,12 +80,14 @@ namespace pip3D
                                                       const Viewport &viewport,
                                                       const Matrix4x4 &viewProjMatrix,
                                                       FrameBuffer &framebuffer,
-                                                      ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
+                                                      ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
                                                       const Light *lights,
                                                       int activeLightCount,
                                                       bool backfaceCullingEnabled,
                                                       uint32_t &statsTrianglesTotal,
-                                                      uint32_t &statsTrianglesBackfaceCulled)
+                                                      uint32_t &statsTrianglesBackfaceCulled,
+                                                      LitFace *litFace = nullptr,
+                                                      const TexturedFace *textured = nullptr)
         {
             int16_t bandTop = currentBandOffsetY();
             int16_t bandH = currentBandHeight();
@@ -61,28 +105,90 @@ namespace pip3D
             lp1.y -= (float)bandTop;
             lp2.y -= (float)bandTop;
 
-            Vector3 edge1 = v1 - v0;
-            Vector3 edge2 = v2 - v0;
-            Vector3 normal = edge1.cross(edge2);
-            Vector3 viewDir = camera.position - v0;
-
             if (camera.projectionType == PERSPECTIVE)
             {
                 if (p0.z <= 0.0f && p1.z <= 0.0f && p2.z <= 0.0f)
                     return;
             }
-            normal.normalize();
-            viewDir.normalize();
-            Vector3 fragPos = (v0 + v1 + v2) * (1.0f / 3.0f);
 
             float finalR, finalG, finalB;
-            Shading::calculateLighting(fragPos, normal, viewDir,
-                                       lights, activeLightCount,
-                                       baseR, baseG, baseB,
-                                       finalR, finalG, finalB);
+            if (litFace && litFace->lit)
+            {
+                finalR = litFace->r * (1.0f / 65535.0f);
+                finalG = litFace->g * (1.0f / 65535.0f);
+                finalB = litFace->b * (1.0f / 65535.0f);
+            }
+            else
+            {
+                Vector3 edge1 = v1 - v0;
+                Vector3 edge2 = v2 - v0;
+                Vector3 normal = edge1.cross(edge2);
+                Vector3 viewDir = camera.position - v0;
+                normal.normalize();
+                viewDir.normalize();
+                Vector3 fragPos = (v0 + v1 + v2) * (1.0f / 3.0f);
+
+                Shading::calculateLighting(fragPos, normal, viewDir,
+                                           lights, activeLightCount,
+                                           baseR, baseG, baseB,
+                                           finalR, finalG, finalB);
+
+                if (litFace)
+                {
+                    // Shade with the stored value too, so a face looks the
+                    // same whether or not its lighting came from the cache.
+                    litFace->r = static_cast<uint16_t>(finalR * 65535.0f + 0.5f);
+                    litFace->g = static_cast<uint16_t>(finalG * 65535.0f + 0.5f);
+                    litFace->b = static_cast<uint16_t>(finalB * 65535.0f + 0.5f);
+                    litFace->lit = 1;
+                    finalR = litFace->r * (1.0f / 65535.0f);
+                    finalG = litFace->g * (1.0f / 65535.0f);
+                    finalB = litFace->b * (1.0f / 65535.0f);
+                }
+            }
+
+            // Deferred frame: record in full-screen space, bands rasterize later.
+            DisplayList *deferred = activeDisplayList();
+
+            if (textured)
+            {
+                // 1/w per corner for perspective-correct texture coordinates.
+                const float *m = viewProjMatrix.m;
+                const Vector3 *world[3] = {&v0, &v1, &v2};
+                float q[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    const Vector3 &p = *world[k];
+                    const float w = m[3] * p.x + m[7] * p.y + m[11] * p.z + m[15];
+                    q[k] = w > 1e-6f ? 1.0f / w : 1e6f;
+                }
+                const uint16_t modulate = packModulate(finalR, finalG, finalB);
+
+                if (deferred)
+                {
+                    deferred->addTextured(p0, p1, p2, q, textured->u, textured->v, textured->texture, modulate);
+                    return;
+                }
+
+                Rasterizer::fillTriangleTextured((int16_t)lp0.x, (int16_t)lp0.y, lp0.z, q[0], textured->u[0], textured->v[0],
+                                                 (int16_t)lp1.x, (int16_t)lp1.y, lp1.z, q[1], textured->u[1], textured->v[1],
+                                                 (int16_t)lp2.x, (int16_t)lp2.y, lp2.z, q[2], textured->u[2], textured->v[2],
+                                                 *textured->texture,
+                                                 modulate,
+                                                 framebuffer.getBuffer(),
+                                                 zBuffer,
+                                                 framebuffer.getConfig());
+                return;
+            }
 
             uint16_t shadedColor = Shading::applyDithering(finalR, finalG, finalB, (int16_t)lp0.x, (int16_t)lp0.y);
 
+            if (deferred)
+            {
+                deferred->add(p0, p1, p2, shadedColor);
+                return;
+            }
+
             Rasterizer::fillTriangle((int16_t)lp0.x, (int16_t)lp0.y, lp0.z,
                                      (int16_t)lp1.x, (int16_t)lp1.y, lp1.z,
                                      (int16_t)lp2.x, (int16_t)lp2.y, lp2.z,
@@ -92,101 +198,201 @@ namespace pip3D
                                      framebuffer.getConfig());
         }
 
-        static void drawTriangle3D_Color(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2,
-                                         float baseR,
-                                         float baseG,
-                                         float baseB,
-                                         const Camera &camera,
-                                         const Viewport &viewport,
-                                         const Matrix4x4 &viewProjMatrix,
-                                         FrameBuffer &framebuffer,
-                                         ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
-                                         const Light *lights,
-                                         int activeLightCount,
-                                         bool backfaceCullingEnabled,
-                                         uint32_t &statsTrianglesTotal,
-                                         uint32_t &statsTrianglesBackfaceCulled)
+        // Real clipping for the few faces that need it, in homogeneous clip
+        // space: against the near plane when a vertex is behind it, against
+        // the guard band when one lies past it. All pieces share the lighting
+        // of the first one, so no seams show along the cuts.
+        static void drawTriangle3D_ClipSpace(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2,
+                                             uint8_t planes,
+                                             float baseR,
+                                             float baseG,
+                                             float baseB,
+                                             const Camera &camera,
+                                             const Viewport &viewport,
+                                             const Matrix4x4 &viewProjMatrix,
+                                             const ClipGuard &guard,
+                                             FrameBuffer &framebuffer,
+                                             ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
+                                             const Light *lights,
+                                             int activeLightCount,
+                                             bool backfaceCullingEnabled,
+                                             uint32_t &statsTrianglesTotal,
+                                             uint32_t &statsTrianglesBackfaceCulled,
+                                             LitFace *litFace = nullptr,
+                                             const TexturedFace *textured = nullptr)
         {
-            Vector3 p0 = CameraController::project(v0, viewProjMatrix, viewport);
-            Vector3 p1 = CameraController::project(v1, viewProjMatrix, viewport);
-            Vector3 p2 = CameraController::project(v2, viewProjMatrix, viewport);
+            struct ClipVertex
+            {
+                float h[4];
+                Vector3 world;
+                float u, v;
+            };
+
+            // Each plane adds at most one vertex.
+            static constexpr int MAX_CLIP_VERTS = 3 + 5;
+            ClipVertex bufA[MAX_CLIP_VERTS];
+            ClipVertex bufB[MAX_CLIP_VERTS];
+            ClipVertex *in = bufA;
+            ClipVertex *out = bufB;
+            int count = 3;
+
+            const Vector3 *src[3] = {&v0, &v1, &v2};
+            const float *m = viewProjMatrix.m;
+            for (int i = 0; i < 3; ++i)
+            {
+                const Vector3 &p = *src[i];
+                in[i].h[0] = m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12];
+                in[i].h[1] = m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13];
+                in[i].h[2] = m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14];
+                in[i].h[3] = m[3] * p.x + m[7] * p.y + m[11] * p.z + m[15];
+                in[i].world = p;
+                in[i].u = textured ? textured->u[i] : 0.0f;
+                in[i].v = textured ? textured->v[i] : 0.0f;
+            }
 
-            drawTriangle3D_Color_Preprojected(v0, v1, v2,
-                                              p0, p1, p2,
-                                              baseR, baseG, baseB,
-                                              camera, viewport, viewProjMatrix,
-                                              framebuffer, zBuffer,
-                                              lights, activeLightCount,
-                                              backfaceCullingEnabled,
-                                              statsTrianglesTotal,
-                                              statsTrianglesBackfaceCulled);
-        }
+            // Plane k keeps h[axis] * sign + limit * w >= 0.
+            static const uint8_t planeAxis[5] = {2, 0, 0, 1, 1};
+            static const float planeSign[5] = {1.0f, 1.0f, -1.0f, 1.0f, -1.0f};
+            const float planeLimit[5] = {1.0f, guard.guardX, guard.guardX, guard.guardY, guard.guardY};
 
-        static void drawTriangle3D_Clipped_Preprojected(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2,
-                                                        const Vector3 &p0, const Vector3 &p1, const Vector3 &p2,
-                                                        float baseR,
-                                                        float baseG,
-                                                        float baseB,
-                                                        const Camera &camera,
-                                                        const Viewport &viewport,
-                                                        const Matrix4x4 &viewProjMatrix,
-                                                        FrameBuffer &framebuffer,
-                                                        ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
-                                                        const Light *lights,
-                                                        int activeLightCount,
-                                                        bool backfaceCullingEnabled,
-                                                        uint32_t &statsTrianglesTotal,
-                                                        uint32_t &statsTrianglesBackfaceCulled)
-        {
-            if (camera.projectionType == PERSPECTIVE)
+            for (int k = 0; k < 5 && count >= 3; ++k)
             {
-                const Vector3 camPos = camera.position;
-                const Vector3 camFwd = camera.forward();
-                const float nearD = camera.nearPlane;
+                if (k == 0 ? !(planes & VERTEX_CLIP_NEAR) : !(planes & VERTEX_CLIP_GUARD))
+                    continue;
 
-                float d0 = (v0 - camPos).dot(camFwd);
-                float d1 = (v1 - camPos).dot(camFwd);
-                float d2 = (v2 - camPos).dot(camFwd);
+                const int axis = planeAxis[k];
+                const float sign = planeSign[k];
+                const float limit = planeLimit[k];
 
-                if (d0 < nearD && d1 < nearD && d2 < nearD)
+                int outCount = 0;
+                for (int i = 0; i < count; ++i)
                 {
-                    return;
+                    const ClipVertex &a = in[i];
+                    const ClipVertex &b = in[(i + 1) % count];
+                    const float da = a.h[axis] * sign + limit * a.h[3];
+                    const float db = b.h[axis] * sign + limit * b.h[3];
+
+                    if (da >= 0.0f)
+                        out[outCount++] = a;
+                    if ((da >= 0.0f) != (db >= 0.0f))
+                    {
+                        const float t = da / (da - db);
+                        ClipVertex &c = out[outCount++];
+                        for (int j = 0; j < 4; ++j)
+                            c.h[j] = a.h[j] + (b.h[j] - a.h[j]) * t;
+                        c.world = a.world + (b.world - a.world) * t;
+                        c.u = a.u + (b.u - a.u) * t;
+                        c.v = a.v + (b.v - a.v) * t;
+                    }
                 }
 
-                if (d0 >= nearD && d1 >= nearD && d2 >= nearD)
+                ClipVertex *tmp = in;
+                in = out;
+                out = tmp;
+                count = outCount;
+            }
+
+            if (count < 3)
+                return;
+
+            Vector3 screen[MAX_CLIP_VERTS];
+            for (int i = 0; i < count; ++i)
+            {
+                const float invW = 1.0f / in[i].h[3];
+                screen[i].x = (in[i].h[0] * invW + 1.0f) * viewport.width * 0.5f + viewport.x;
+                screen[i].y = (1.0f - in[i].h[1] * invW) * viewport.height * 0.5f + viewport.y;
+                screen[i].z = in[i].h[2] * invW;
+            }
+
+            LitFace pieceLight = {0, 0, 0, 0};
+            LitFace *lit = litFace ? litFace : &pieceLight;
+
+            TexturedFace piece;
+            if (textured)
+            {
+                piece.texture = textured->texture;
+                piece.u[0] = in[0].u;
+                piece.v[0] = in[0].v;
+            }
+
+            for (int i = 1; i + 1 < count; ++i)
+            {
+                if (textured)
                 {
-                    drawTriangle3D_Color_Preprojected(v0, v1, v2,
-                                                      p0, p1, p2,
-                                                      baseR, baseG, baseB,
-                                                      camera, viewport, viewProjMatrix,
-                                                      framebuffer, zBuffer,
-                                                      lights, activeLightCount,
-                                                      backfaceCullingEnabled,
-                                                      statsTrianglesTotal,
-                                                      statsTrianglesBackfaceCulled);
-                    return;
+                    piece.u[1] = in[i].u;
+                    piece.v[1] = in[i].v;
+                    piece.u[2] = in[i + 1].u;
+                    piece.v[2] = in[i + 1].v;
                 }
+                drawTriangle3D_Color_Preprojected(in[0].world, in[i].world, in[i + 1].world,
+                                                  screen[0], screen[i], screen[i + 1],
+                                                  baseR, baseG, baseB,
+                                                  camera, viewport, viewProjMatrix,
+                                                  framebuffer, zBuffer,
+                                                  lights, activeLightCount,
+                                                  backfaceCullingEnabled,
+                                                  statsTrianglesTotal,
+                                                  statsTrianglesBackfaceCulled,
+                                                  lit,
+                                                  textured ? &piece : nullptr);
+            }
+        }
 
-                drawTriangle3D_Clipped(v0, v1, v2,
-                                       baseR, baseG, baseB,
-                                       camera, viewport, viewProjMatrix,
-                                       framebuffer, zBuffer,
-                                       lights, activeLightCount,
-                                       backfaceCullingEnabled,
-                                       statsTrianglesTotal,
-                                       statsTrianglesBackfaceCulled);
+        // Face dispatch on per-vertex outcodes: trivially rejected when all
+        // vertices share an outside plane, trivially accepted inside the
+        // guard band, clipped only when a vertex is behind the near plane or
+        // past the guard band.
+        static void drawClassifiedTriangle(const TransformedVertex &t0,
+                                           const TransformedVertex &t1,
+                                           const TransformedVertex &t2,
+                                           float baseR,
+                                           float baseG,
+                                           float baseB,
+                                           const Camera &camera,
+                                           const Viewport &viewport,
+                                           const Matrix4x4 &viewProjMatrix,
+                                           const ClipGuard &guard,
+                                           FrameBuffer &framebuffer,
+                                           ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
+                                           const Light *lights,
+                                           int activeLightCount,
+                                           bool backfaceCullingEnabled,
+                                           uint32_t &statsTrianglesTotal,
+                                           uint32_t &statsTrianglesBackfaceCulled,
+                                           LitFace *litFace = nullptr,
+                                           const TexturedFace *textured = nullptr)
+        {
+            if (t0.clip & t1.clip & t2.clip & (VERTEX_CLIP_NEAR | VERTEX_CLIP_SCREEN))
+                return;
+
+            const uint8_t planes = (t0.clip | t1.clip | t2.clip) & VERTEX_CLIP_NEEDS_CLIP;
+            if (planes)
+            {
+                drawTriangle3D_ClipSpace(t0.world, t1.world, t2.world,
+                                         planes,
+                                         baseR, baseG, baseB,
+                                         camera, viewport, viewProjMatrix, guard,
+                                         framebuffer, zBuffer,
+                                         lights, activeLightCount,
+                                         backfaceCullingEnabled,
+                                         statsTrianglesTotal,
+                                         statsTrianglesBackfaceCulled,
+                                         litFace,
+                                         textured);
                 return;
             }
 
-            drawTriangle3D_Color_Preprojected(v0, v1, v2,
-                                              p0, p1, p2,
+            drawTriangle3D_Color_Preprojected(t0.world, t1.world, t2.world,
+                                              t0.screen, t1.screen, t2.screen,
                                               baseR, baseG, baseB,
                                               camera, viewport, viewProjMatrix,
                                               framebuffer, zBuffer,
                                               lights, activeLightCount,
                                               backfaceCullingEnabled,
                                               statsTrianglesTotal,
-                                              statsTrianglesBackfaceCulled);
+                                              statsTrianglesBackfaceCulled,
+                                              litFace,
+                                              textured);
         }
 
         static void drawTriangle3D_Clipped(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2,
@@ -197,121 +403,29 @@ namespace pip3D
                                            const Viewport &viewport,
                                            const Matrix4x4 &viewProjMatrix,
                                            FrameBuffer &framebuffer,
-                                           ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
+                                           ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
                                            const Light *lights,
                                            int activeLightCount,
                                            bool backfaceCullingEnabled,
                                            uint32_t &statsTrianglesTotal,
                                            uint32_t &statsTrianglesBackfaceCulled)
         {
-            if (camera.projectionType == PERSPECTIVE)
-            {
-                const Vector3 camPos = camera.position;
-                const Vector3 camFwd = camera.forward();
-                const float nearD = camera.nearPlane;
-
-                Vector3 inVerts[3] = {v0, v1, v2};
-                float dist[3];
-                for (int i = 0; i < 3; ++i)
-                {
-                    dist[i] = (inVerts[i] - camPos).dot(camFwd);
-                }
-
-                auto isInside = [&](int i) -> bool
-                {
-                    return dist[i] >= nearD;
-                };
-
-                auto intersect = [&](const Vector3 &a, const Vector3 &b, float da, float db) -> Vector3
-                {
-                    float denom = (db - da);
-                    if (fabsf(denom) < 1e-6f)
-                        return a;
-                    float t = (nearD - da) / denom;
-                    if (t < 0.0f)
-                        t = 0.0f;
-                    if (t > 1.0f)
-                        t = 1.0f;
-                    return a + (b - a) * t;
-                };
-
-                Vector3 clipped[4];
-                int outCount = 0;
-
-                for (int i = 0; i < 3; ++i)
-                {
-                    int j = (i + 1) % 3;
-                    bool in0 = isInside(i);
-                    bool in1 = isInside(j);
-                    const Vector3 &P0 = inVerts[i];
-                    const Vector3 &P1 = inVerts[j];
-                    float d0 = dist[i];
-                    float d1 = dist[j];
-
-                    if (in0 && in1)
-                    {
-                        clipped[outCount++] = P1;
-                    }
-                    else if (in0 && !in1)
-                    {
-                        clipped[outCount++] = intersect(P0, P1, d0, d1);
-                    }
-                    else if (!in0 && in1)
-                    {
-                        clipped[outCount++] = intersect(P0, P1, d0, d1);
-                        clipped[outCount++] = P1;
-                    }
-                }
-
-                if (outCount < 3)
-                {
-                    return;
-                }
-
-                if (outCount == 3)
-                {
-                    drawTriangle3D_Color(clipped[0], clipped[1], clipped[2],
-                                         baseR, baseG, baseB,
-                                         camera, viewport, viewProjMatrix,
-                                         framebuffer, zBuffer,
-                                         lights, activeLightCount,
-                                         backfaceCullingEnabled,
-                                         statsTrianglesTotal,
-                                         statsTrianglesBackfaceCulled);
-                    return;
-                }
-
-                if (outCount == 4)
-                {
-                    drawTriangle3D_Color(clipped[0], clipped[1], clipped[2],
-                                         baseR, baseG, baseB,
-                                         camera, viewport, viewProjMatrix,
-                                         framebuffer, zBuffer,
-                                         lights, activeLightCount,
-                                         backfaceCullingEnabled,
-                                         statsTrianglesTotal,
-                                         statsTrianglesBackfaceCulled);
-
-                    drawTriangle3D_Color(clipped[0], clipped[2], clipped[3],
-                                         baseR, baseG, baseB,
-                                         camera, viewport, viewProjMatrix,
-                                         framebuffer, zBuffer,
-                                         lights, activeLightCount,
-                                         backfaceCullingEnabled,
-                                         statsTrianglesTotal,
-                                         statsTrianglesBackfaceCulled);
-                    return;
-                }
-            }
-
-            drawTriangle3D_Color(v0, v1, v2,
-                                 baseR, baseG, baseB,
-                                 camera, viewport, viewProjMatrix,
-                                 framebuffer, zBuffer,
-                                 lights, activeLightCount,
-                                 backfaceCullingEnabled,
-                                 statsTrianglesTotal,
-                                 statsTrianglesBackfaceCulled);
+            const ClipGuard guard(camera, viewport);
+            TransformedVertex t[3];
+            t[0].world = v0;
+            t[1].world = v1;
+            t[2].world = v2;
+            for (int i = 0; i < 3; ++i)
+                t[i].clip = guard.classify(t[i].world, viewProjMatrix, viewport, t[i].screen);
+
+            drawClassifiedTriangle(t[0], t[1], t[2],
+                                   baseR, baseG, baseB,
+                                   camera, viewport, viewProjMatrix, guard,
+                                   framebuffer, zBuffer,
+                                   lights, activeLightCount,
+                                   backfaceCullingEnabled,
+                                   statsTrianglesTotal,
+                                   statsTrianglesBackfaceCulled);
         }
 
     public:
@@ -321,7 +435,7 @@ namespace pip3D
                                    const Viewport &viewport,
                                    const Matrix4x4 &viewProjMatrix,
                                    FrameBuffer &framebuffer,
-                                   ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
+                                   ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
                                    const Light *lights,
                                    int activeLightCount,
                                    bool backfaceCullingEnabled,
@@ -343,13 +457,107 @@ namespace pip3D
                                    statsTrianglesBackfaceCulled);
         }
 
+        // Face setup over a vertex stage produced by VertexCache. Faces inside
+        // the guard band skip per-face transform and projection; the rest are
+        // clipped in clip space. litFaces (optional, one per face) carries
+        // shaded colors over from earlier bands and frames.
+        static void drawTransformedFaces(const Mesh *mesh,
+                                         const TransformedVertex *verts,
+                                         LitFace *litFaces,
+                                         uint16_t color,
+                                         const Camera &camera,
+                                         const Viewport &viewport,
+                                         const Matrix4x4 &viewProjMatrix,
+                                         FrameBuffer &framebuffer,
+                                         ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
+                                         const Light *lights,
+                                         int activeLightCount,
+                                         bool backfaceCullingEnabled,
+                                         uint32_t &statsTrianglesTotal,
+                                         uint32_t &statsTrianglesBackfaceCulled,
+                                         const uint8_t *faceVisible = nullptr)
+        {
+            if (!mesh || !verts)
+                return;
+
+            float baseR;
+            float baseG;
+            float baseB;
+            decodeColorToFloat(color, baseR, baseG, baseB);
+
+            const float bandTop = static_cast<float>(currentBandOffsetY());
+            const float bandBottom = bandTop + static_cast<float>(currentBandHeight());
+            const ClipGuard guard(camera, viewport);
+            const Texture *texture = meshTexture(mesh);
+            TexturedFace textured;
+
+            const uint16_t faceCount = mesh->numFaces();
+            for (uint16_t i = 0; i < faceCount; ++i)
+            {
+                statsTrianglesTotal++;
+                // Rejected in object space by the vertex cache; its vertices
+                // may not have been transformed.
+                if (faceVisible && !faceVisible[i])
+                {
+                    statsTrianglesBackfaceCulled++;
+                    continue;
+                }
+
+                const Face &face = mesh->face(i);
+                const TransformedVertex &t0 = verts[face.v0];
+                const TransformedVertex &t1 = verts[face.v1];
+                const TransformedVertex &t2 = verts[face.v2];
+
+                if (t0.clip & t1.clip & t2.clip & (VERTEX_CLIP_NEAR | VERTEX_CLIP_SCREEN))
+                    continue;
+
+                if ((t0.clip | t1.clip | t2.clip) & VERTEX_CLIP_NEEDS_CLIP)
+                {
+                    if (texture)
+                        setTexturedFace(mesh, texture, face, textured);
+                    drawTriangle3D_ClipSpace(t0.world, t1.world, t2.world,
+                                             (t0.clip | t1.clip | t2.clip) & VERTEX_CLIP_NEEDS_CLIP,
+                                             baseR, baseG, baseB,
+                                             camera, viewport, viewProjMatrix, guard,
+                                             framebuffer, zBuffer,
+                                             lights, activeLightCount,
+                                             backfaceCullingEnabled,
+                                             statsTrianglesTotal,
+                                             statsTrianglesBackfaceCulled,
+                                             litFaces ? &litFaces[i] : nullptr,
+                                             texture ? &textured : nullptr);
+                    continue;
+                }
+
+                const float minY = fminf(t0.screen.y, fminf(t1.screen.y, t2.screen.y));
+                const float maxY = fmaxf(t0.screen.y, fmaxf(t1.screen.y, t2.screen.y));
+                if (maxY < bandTop || minY >= bandBottom)
+                    continue;
+
+                if (texture)
+                    setTexturedFace(mesh, texture, face, textured);
+
+                drawTriangle3D_Color_Preprojected(t0.world, t1.world, t2.world,
+                                                  t0.screen, t1.screen, t2.screen,
+                                                  baseR, baseG, baseB,
+                                                  camera, viewport, viewProjMatrix,
+                                                  framebuffer, zBuffer,
+                                                  lights, activeLightCount,
+                                                  backfaceCullingEnabled,
+                                                  statsTrianglesTotal,
+                                                  statsTrianglesBackfaceCulled,
+                                                  litFaces ? &litFaces[i] : nullptr,
+                                                  texture ? &textured : nullptr);
+            }
+        }
+
         static void drawMesh(Mesh *mesh,
                              const Camera &camera,
                              const Viewport &viewport,
                              const Frustum &frustum,
                              const Matrix4x4 &viewProjMatrix,
                              FrameBuffer &framebuffer,
-                             ZBuffer<SCREEN_WIDTH, SCREEN_BAND_HEIGHT> *zBuffer,
+                             ZBuffer<SCREEN_WIDTH, SCREEN_BAND_CAPACITY> *zBuffer,
                              const Light *lights,
                              int activeLightCount,
                              bool backfaceCullingEnabled,
@@ -391,50 +599,42 @@ namespace pip3D
             }
 
             const uint16_t vertexCountUsed = static_cast<uint16_t>(maxIndex + 1);
-            const size_t vertexBufferSize = static_cast<size_t>(vertexCountUsed) * sizeof(Vector3);
+            const size_t vertexBufferSize = static_cast<size_t>(vertexCountUsed) * sizeof(TransformedVertex);
 
-            Vector3 *worldVerts = (Vector3 *)MemUtils::allocAligned(vertexBufferSize, 16);
-            if (!worldVerts)
+            TransformedVertex *verts = (TransformedVertex *)MemUtils::allocAligned(vertexBufferSize, 16);
+            if (!verts)
             {
                 return;
             }
 
-            Vector3 *screenVerts = (Vector3 *)MemUtils::allocAligned(vertexBufferSize, 16);
-            if (!screenVerts)
-            {
-                MemUtils::freeAligned(worldVerts);
-                return;
-            }
-
             const Matrix4x4 &meshTransform = mesh->getTransform();
+            const ClipGuard guard(camera, viewport);
+            const Texture *texture = meshTexture(mesh);
+            TexturedFace textured;
 
             for (uint16_t i = 0; i < vertexCountUsed; ++i)
             {
-                const Vertex &v = mesh->vert(i);
-                Vector3 localPos = mesh->decodePosition(v);
-                Vector3 worldPos = meshTransform.transformNoDiv(localPos);
-                worldVerts[i] = worldPos;
-                screenVerts[i] = CameraController::project(worldPos, viewProjMatrix, viewport);
+                TransformedVertex &tv = verts[i];
+                tv.world = meshTransform.transformNoDiv(mesh->decodePosition(mesh->vert(i)));
+                tv.clip = guard.classify(tv.world, viewProjMatrix, viewport, tv.screen);
             }
 
             for (uint16_t i = 0; i < faceCount; ++i)
             {
                 const Face &face = mesh->face(i);
-                uint16_t i0 = face.v0;
-                uint16_t i1 = face.v1;
-                uint16_t i2 = face.v2;
-
-                const Vector3 &v0 = worldVerts[i0];
-                const Vector3 &v1 = worldVerts[i1];
-                const Vector3 &v2 = worldVerts[i2];
-
-                const Vector3 &p0 = screenVerts[i0];
-                const Vector3 &p1 = screenVerts[i1];
-                const Vector3 &p2 = screenVerts[i2];
+                const TransformedVertex &t0 = verts[face.v0];
+                const TransformedVertex &t1 = verts[face.v1];
+                const TransformedVertex &t2 = verts[face.v2];
 
                 statsTrianglesTotal++;
-                if (backfaceCullingEnabled)
+                // Screen winding is only defined when no vertex is behind
+                // the near plane.
+                if (backfaceCullingEnabled && !((t0.clip | t1.clip | t2.clip) & VERTEX_CLIP_NEAR))
                 {
+                    const Vector3 &p0 = t0.screen;
+                    const Vector3 &p1 = t1.screen;
+                    const Vector3 &p2 = t2.screen;
+
                     // 2D screen-space backface culling using winding order.
                     // Screen Y grows downward, so front-facing triangles have
                     // negative signed area in this coordinate system.
@@ -451,19 +651,21 @@ namespace pip3D
                     }
                 }
 
-                drawTriangle3D_Clipped_Preprojected(v0, v1, v2,
-                                                    p0, p1, p2,
-                                                    baseR, baseG, baseB,
-                                                    camera, viewport, viewProjMatrix,
-                                                    framebuffer, zBuffer,
-                                                    lights, activeLightCount,
-                                                    backfaceCullingEnabled,
-                                                    statsTrianglesTotal,
-                                                    statsTrianglesBackfaceCulled);
+                if (texture)
+                    setTexturedFace(mesh, texture, face, textured);
+                drawClassifiedTriangle(t0, t1, t2,
+                                       baseR, baseG, baseB,
+                                       camera, viewport, viewProjMatrix, guard,
+                                       framebuffer, zBuffer,
+                                       lights, activeLightCount,
+                                       backfaceCullingEnabled,
+                                       statsTrianglesTotal,
+                                       statsTrianglesBackfaceCulled,
+                                       nullptr,
+                                       texture ? &textured : nullptr);
             }
 
-            MemUtils::freeAligned(screenVerts);
-            MemUtils::freeAligned(worldVerts);
+            MemUtils::freeAligned(verts);
         }
     };
 }
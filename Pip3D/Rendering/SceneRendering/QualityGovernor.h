@@ -0,0 +1,218 @@
+#ifndef QUALITYGOVERNOR_H
+#define QUALITYGOVERNOR_H
+
+#include "../../Core/Core.h"
+
+// Default frame budget: 30 fps.
+#ifndef PIP3D_GOVERNOR_TARGET_US
+#define PIP3D_GOVERNOR_TARGET_US 33333
+#endif
+
+// Frames to wait after a step before the next one.
+#ifndef PIP3D_GOVERNOR_COOLDOWN
+#define PIP3D_GOVERNOR_COOLDOWN 8
+#endif
+
+namespace pip3D
+{
+
+    // What the renderer may do at one quality level. Level 0 is full quality;
+    // each further level gives up a bit more.
+    struct QualityLevel
+    {
+        // Multiplies the projected radius used for LOD selection.
+        float lodScale;
+        // Instances with a smaller projected radius are skipped.
+        float minPixels;
+        bool shadows;
+    };
+
+    // Holds a target frame time by stepping through QualityLevels. Steps
+    // down when the smoothed frame time runs over budget, or at once on a
+    // spike that comes with a jump in triangle count; steps back up only
+    // after a long stretch well under budget. An upgrade that is undone
+    // straight away doubles the wait before the next attempt, so the level
+    // settles instead of oscillating.
+    class QualityGovernor
+    {
+    public:
+        static constexpr int LEVEL_COUNT = 5;
+
+    private:
+        static constexpr float OVER_BUDGET = 1.10f;
+        static constexpr float UNDER_BUDGET = 0.70f;
+        static constexpr float SPIKE = 1.50f;
+        static constexpr uint16_t UPGRADE_DELAY = PIP3D_GOVERNOR_COOLDOWN * 4;
+        static constexpr uint16_t MAX_UPGRADE_DELAY = 512;
+
+        uint32_t targetUs;
+        float avgFrameUs;
+        float avgTriangles;
+        uint8_t level;
+        uint8_t maxLevel;
+        uint16_t cooldown;
+        uint16_t calmFrames;
+        uint16_t upgradeDelay;
+        uint16_t sinceUpgrade;
+        bool primed;
+
+        uint32_t pacingLast;
+        bool pacing;
+
+        void step(int delta)
+        {
+            level = static_cast<uint8_t>(level + delta);
+            cooldown = PIP3D_GOVERNOR_COOLDOWN;
+            calmFrames = 0;
+        }
+
+    public:
+        QualityGovernor()
+            : targetUs(PIP3D_GOVERNOR_TARGET_US),
+              avgFrameUs(0.0f),
+              avgTriangles(0.0f),
+              level(0),
+              maxLevel(LEVEL_COUNT - 1),
+              cooldown(0),
+              calmFrames(0),
+              upgradeDelay(UPGRADE_DELAY),
+              sinceUpgrade(0xFFFF),
+              primed(false),
+              pacingLast(0),
+              pacing(false) {}
+
+        static const QualityLevel &levelInfo(uint8_t index)
+        {
+            static const QualityLevel levels[LEVEL_COUNT] = {
+                {1.00f, 1.0f, true},
+                {0.75f, 1.0f, true},
+                {0.75f, 1.5f, false},
+                {0.50f, 2.0f, false},
+                {0.35f, 3.0f, false},
+            };
+            return levels[index < LEVEL_COUNT ? index : LEVEL_COUNT - 1];
+        }
+
+        void setTargetFrameTime(uint32_t micros)
+        {
+            targetUs = micros > 0 ? micros : 1;
+        }
+        void setTargetFPS(float fps)
+        {
+            if (fps > 0.0f)
+                setTargetFrameTime(static_cast<uint32_t>(1000000.0f / fps));
+        }
+        uint32_t getTargetFrameTime() const { return targetUs; }
+
+        // Caps how far quality may drop.
+        void setMaxLevel(uint8_t value)
+        {
+            maxLevel = value < LEVEL_COUNT ? value : LEVEL_COUNT - 1;
+            if (level > maxLevel)
+                level = maxLevel;
+        }
+
+        void reset()
+        {
+            level = 0;
+            primed = false;
+            cooldown = 0;
+            calmFrames = 0;
+            upgradeDelay = UPGRADE_DELAY;
+            sinceUpgrade = 0xFFFF;
+        }
+
+        // Feeds one finished frame; returns true when the level changed.
+        bool update(uint32_t frameUs, uint32_t triangles)
+        {
+            const float t = static_cast<float>(frameUs);
+            const float tris = static_cast<float>(triangles);
+            if (!primed)
+            {
+                avgFrameUs = t;
+                avgTriangles = tris;
+                primed = true;
+                return false;
+            }
+
+            const bool spike = t > targetUs * SPIKE && tris > avgTriangles * SPIKE;
+            avgFrameUs += (t - avgFrameUs) * 0.125f;
+            avgTriangles += (tris - avgTriangles) * 0.125f;
+            if (sinceUpgrade < 0xFFFF)
+                ++sinceUpgrade;
+            if (cooldown)
+                --cooldown;
+
+            if (level < maxLevel && (spike || (!cooldown && avgFrameUs > targetUs * OVER_BUDGET)))
+            {
+                if (sinceUpgrade < UPGRADE_DELAY)
+                {
+                    upgradeDelay = static_cast<uint16_t>(upgradeDelay * 2 < MAX_UPGRADE_DELAY ? upgradeDelay * 2 : MAX_UPGRADE_DELAY);
+                }
+                sinceUpgrade = 0xFFFF;
+                step(1);
+                // The average still holds the slow frames; judge the new
+                // level on its own.
+                avgFrameUs = targetUs;
+                return true;
+            }
+
+            if (avgFrameUs < targetUs * UNDER_BUDGET)
+            {
+                if (++calmFrames >= upgradeDelay && level > 0 && !cooldown)
+                {
+                    step(-1);
+                    sinceUpgrade = 0;
+                    return true;
+                }
+            }
+            else
+            {
+                calmFrames = 0;
+            }
+
+            if (sinceUpgrade == MAX_UPGRADE_DELAY)
+                upgradeDelay = UPGRADE_DELAY;
+            return false;
+        }
+
+        uint8_t getLevel() const { return level; }
+        const QualityLevel &current() const { return levelInfo(level); }
+        float getAverageFrameTime() const { return avgFrameUs; }
+
+        // Frame pacing: pace() at frame start sleeps off what is left of the
+        // frame budget, so frames leave at a steady rate instead of as fast
+        // as each one happens to render.
+        void setPacing(bool enabled)
+        {
+            pacing = enabled;
+            pacingLast = 0;
+        }
+        bool isPacing() const { return pacing; }
+
+        void pace()
+        {
+            if (!pacing)
+                return;
+
+            const uint32_t now = micros();
+            if (pacingLast)
+            {
+                const uint32_t elapsed = now - pacingLast;
+                if (elapsed < targetUs)
+                {
+                    const uint32_t wait = targetUs - elapsed;
+                    if (wait >= 1000u)
+                        delay(wait / 1000u);
+                    delayMicroseconds(wait % 1000u);
+                    pacingLast += targetUs;
+                    return;
+                }
+            }
+            pacingLast = now;
+        }
+    };
+
+}
+
+#endif
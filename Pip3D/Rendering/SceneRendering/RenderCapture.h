@@ -0,0 +1,581 @@
+#ifndef RENDERCAPTURE_H
+#define RENDERCAPTURE_H
+
+#include "../../Core/Core.h"
+#include "../../Core/Camera.h"
+#include "../../Core/Instance.h"
+#include "../../Geometry/Mesh.h"
+#include "../Lighting/Lighting.h"
+#include "../Lighting/Shadow.h"
+
+// Largest capture stream; recording stops at the last whole frame that fits.
+#ifndef PIP3D_CAPTURE_MAX_BYTES
+#define PIP3D_CAPTURE_MAX_BYTES 65536
+#endif
+
+namespace pip3D
+{
+
+    // Records what the application asks the renderer to draw, frame by
+    // frame, into a compact stream that RenderReplay plays back with the
+    // same work. Attach it with Renderer::setCapture() and call start().
+    //
+    // The stream starts with "P3RC", the version, the band count and the
+    // screen size, followed by commands: an opcode byte and a fixed
+    // payload of little-endian values. Every frame opens with CMD_FRAME,
+    // which holds the active camera, the lights, the shading mode and the
+    // shadow settings as they were when the frame began. Draw calls are
+    // recorded once per frame, while band 0 (or the deferred pass) runs;
+    // in deferred frames, CMD_BAND_PASS separates the calls made from the
+    // band pass callback.
+    //
+    // Meshes are referenced by ID: bindMesh() assigns one, otherwise IDs
+    // follow first use. CMD_MESH carries the vertex and face count of
+    // each ID so the player can check what it is given. Instances keep
+    // their own IDs, in first-use order. LOD chains are not recorded, and
+    // neither is drawing that bypasses the renderer's draw calls (FX,
+    // rope lines).
+    class RenderCapture
+    {
+    public:
+        enum Command : uint8_t
+        {
+            CMD_FRAME = 1,
+            CMD_MESH,
+            CMD_DRAW_MESH,
+            CMD_DRAW_INSTANCE,
+            CMD_DRAW_INSTANCES,
+            CMD_WATER,
+            CMD_TEXT,
+            CMD_TRIANGLE,
+            CMD_SUN,
+            CMD_SKYBOX,
+            // What follows ran in the deferred band pass.
+            CMD_BAND_PASS
+        };
+
+        enum DrawKind : uint8_t
+        {
+            DRAW_NORMAL = 0,
+            DRAW_STATIC,
+            DRAW_SHADOW
+        };
+
+        enum InstanceFlags : uint8_t
+        {
+            INSTANCE_VISIBLE = 1,
+            INSTANCE_OCCLUDER = 2
+        };
+
+        enum MeshFlags : uint8_t
+        {
+            MESH_VISIBLE = 1,
+            MESH_CASTS_SHADOWS = 2
+        };
+
+        enum ShadowFlags : uint8_t
+        {
+            SHADOW_ENABLED = 1,
+            SHADOW_SOFT_EDGES = 2,
+            SHADOW_SILHOUETTE = 4,
+            SHADOWS_ON = 8
+        };
+
+        static constexpr uint8_t VERSION = 1;
+        static constexpr size_t HEADER_SIZE = 12;
+        static constexpr uint16_t NO_ID = 0xFFFF;
+
+        // Payload sizes after the opcode.
+        static constexpr size_t MESH_SIZE = 6;
+        static constexpr size_t DRAW_MESH_SIZE = 43;
+        static constexpr size_t INSTANCE_RECORD_SIZE = 47;
+        static constexpr size_t DRAW_INSTANCE_SIZE = 2 + INSTANCE_RECORD_SIZE;
+        static constexpr size_t DRAW_INSTANCES_HEADER = 5;
+        static constexpr size_t WATER_SIZE = 18;
+        static constexpr size_t TEXT_HEADER = 7;
+        static constexpr size_t TRIANGLE_SIZE = 38;
+        static constexpr size_t SUN_SIZE = 18;
+        static constexpr size_t FRAME_HEADER = 90;
+        static constexpr size_t LIGHT_SIZE = 35;
+
+        RenderCapture() : buffer(nullptr), used(0), capacity(0), frameStart(0),
+                          framesWanted(0), frames(0), recording(false), truncated(false),
+                          nextMeshId(0), lastMesh(0) {}
+
+        ~RenderCapture()
+        {
+            release();
+        }
+
+        RenderCapture(const RenderCapture &) = delete;
+        RenderCapture &operator=(const RenderCapture &) = delete;
+
+        // Records the next frameCount frames; 0 records until stop().
+        // Drops the previous stream.
+        bool start(uint16_t frameCount, uint16_t screenWidth = SCREEN_WIDTH, uint16_t screenHeight = SCREEN_HEIGHT)
+        {
+            used = 0;
+            frames = 0;
+            frameStart = 0;
+            truncated = false;
+            recording = false;
+            instances.clear();
+            managers.clear();
+            for (size_t i = 0; i < meshes.size(); ++i)
+                meshes[i].defined = false;
+
+            if (!reserve(HEADER_SIZE))
+                return false;
+            const uint8_t header[4] = {'P', '3', 'R', 'C'};
+            put(header, 4);
+            put8(VERSION);
+            put8(static_cast<uint8_t>(SCREEN_BAND_COUNT));
+            put16(screenWidth);
+            put16(screenHeight);
+            put16(0);
+
+            framesWanted = frameCount;
+            recording = true;
+            return true;
+        }
+
+        // Ends the stream after the frame being recorded.
+        void stop() { recording = false; }
+
+        void release()
+        {
+            MemUtils::freeData(buffer);
+            buffer = nullptr;
+            used = capacity = 0;
+            frames = 0;
+            recording = false;
+            meshes.clear();
+            meshes.shrink_to_fit();
+            instances.release();
+            managers.release();
+        }
+
+        // Gives a mesh a fixed ID, so a player built elsewhere can bind the
+        // same mesh to it. IDs are below NO_ID.
+        void bindMesh(Mesh *mesh, uint16_t id)
+        {
+            if (!mesh || id == NO_ID)
+                return;
+            for (size_t i = 0; i < meshes.size(); ++i)
+            {
+                if (meshes[i].mesh == mesh || meshes[i].id == id)
+                {
+                    meshes[i].mesh = mesh;
+                    meshes[i].id = id;
+                    meshes[i].defined = false;
+                    return;
+                }
+            }
+            meshes.push_back({mesh, id, false});
+            if (id >= nextMeshId)
+                nextMeshId = static_cast<uint16_t>(id + 1);
+        }
+
+        // The mesh recorded under id, for replaying in the same program.
+        Mesh *meshFor(uint16_t id) const
+        {
+            for (size_t i = 0; i < meshes.size(); ++i)
+            {
+                if (meshes[i].id == id)
+                    return meshes[i].mesh;
+            }
+            return nullptr;
+        }
+
+        __attribute__((always_inline)) inline bool isRecording() const { return recording; }
+        bool isTruncated() const { return truncated; }
+        uint16_t frameCount() const { return frames; }
+        const uint8_t *data() const { return buffer; }
+        size_t size() const { return used; }
+
+        // Called by the renderer when a frame begins; shading is its
+        // Renderer::ShadingMode.
+        void beginFrame(const Camera &cam, const Light *lights, int lightCount, uint8_t shading,
+                        bool shadowsOn, const ShadowSettings &shadow)
+        {
+            if (!recording)
+                return;
+            if (framesWanted && frames >= framesWanted)
+            {
+                recording = false;
+                return;
+            }
+
+            if (lightCount < 0)
+                lightCount = 0;
+            if (lightCount > 255)
+                lightCount = 255;
+            frameStart = used;
+            ++frames;
+            if (!open(CMD_FRAME, FRAME_HEADER + static_cast<size_t>(lightCount) * LIGHT_SIZE))
+                return;
+
+            putVec(cam.position);
+            putVec(cam.target);
+            putVec(cam.up);
+            put8(static_cast<uint8_t>(cam.projectionType));
+            putF(cam.fov);
+            putF(cam.nearPlane);
+            putF(cam.farPlane);
+            putF(cam.orthoWidth);
+            putF(cam.orthoHeight);
+            putF(cam.fisheyeStrength);
+
+            put8(shading);
+            put8(static_cast<uint8_t>((shadow.enabled ? SHADOW_ENABLED : 0) |
+                                      (shadow.softEdges ? SHADOW_SOFT_EDGES : 0) |
+                                      (shadow.silhouette ? SHADOW_SILHOUETTE : 0) |
+                                      (shadowsOn ? SHADOWS_ON : 0)));
+            put16(shadow.shadowColor.rgb565);
+            putF(shadow.shadowOpacity);
+            putF(shadow.shadowOffset);
+            putVec(shadow.plane.normal);
+            putF(shadow.plane.d);
+
+            put8(static_cast<uint8_t>(lightCount));
+            for (int i = 0; i < lightCount; ++i)
+            {
+                const Light &l = lights[i];
+                put8(static_cast<uint8_t>(l.type));
+                putF(l.intensity);
+                putVec(l.direction);
+                putVec(l.position);
+                put16(l.color.rgb565);
+                putF(l.range);
+            }
+        }
+
+        void drawMesh(DrawKind kind, Mesh *mesh, uint8_t shading)
+        {
+            if (!mesh)
+                return;
+            const uint16_t id = meshId(mesh);
+            if (id == NO_ID || !open(CMD_DRAW_MESH, DRAW_MESH_SIZE))
+                return;
+            put8(kind);
+            put8(shading);
+            put16(id);
+            putVec(mesh->pos());
+            putVec(mesh->rot());
+            putVec(mesh->scl());
+            put16(mesh->color().rgb565);
+            put8(static_cast<uint8_t>((mesh->isVisible() ? MESH_VISIBLE : 0) |
+                                      (mesh->getCastShadows() ? MESH_CASTS_SHADOWS : 0)));
+        }
+
+        void drawInstance(DrawKind kind, MeshInstance *instance, uint8_t shading)
+        {
+            if (!instance)
+                return;
+            const uint16_t meshRef = instance->getMesh() ? meshId(instance->getMesh()) : NO_ID;
+            if (!open(CMD_DRAW_INSTANCE, DRAW_INSTANCE_SIZE))
+                return;
+            put8(kind);
+            put8(shading);
+            putInstance(instance, meshRef);
+        }
+
+        // Every instance of the manager, hidden ones included, so removed
+        // instances disappear on replay.
+        void drawInstances(const InstanceManager &manager, uint8_t shading)
+        {
+            const std::vector<MeshInstance *> &all = manager.all();
+            const size_t count = all.size() < NO_ID ? all.size() : NO_ID - 1;
+
+            // Mesh definitions go before the command that uses them.
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (all[i]->getMesh())
+                    meshId(all[i]->getMesh());
+            }
+            const uint16_t managerId = managers.idFor(&manager);
+            if (managerId == NO_ID ||
+                !open(CMD_DRAW_INSTANCES, DRAW_INSTANCES_HEADER + count * INSTANCE_RECORD_SIZE))
+                return;
+            put16(managerId);
+            put8(shading);
+            put16(static_cast<uint16_t>(count));
+            for (size_t i = 0; i < count; ++i)
+            {
+                MeshInstance *inst = all[i];
+                putInstance(inst, inst->getMesh() ? meshId(inst->getMesh()) : NO_ID);
+            }
+        }
+
+        void drawWater(float yLevel, float waterSize, Color color, float alpha, float time)
+        {
+            if (!open(CMD_WATER, WATER_SIZE))
+                return;
+            putF(yLevel);
+            putF(waterSize);
+            put16(color.rgb565);
+            putF(alpha);
+            putF(time);
+        }
+
+        void drawText(int16_t x, int16_t y, const char *text, uint16_t color)
+        {
+            const size_t len = text ? strnlen(text, 255) : 0;
+            if (!open(CMD_TEXT, TEXT_HEADER + len))
+                return;
+            put16(static_cast<uint16_t>(x));
+            put16(static_cast<uint16_t>(y));
+            put16(color);
+            put8(static_cast<uint8_t>(len));
+            put(text, len);
+        }
+
+        void drawTriangle(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2, uint16_t color)
+        {
+            if (!open(CMD_TRIANGLE, TRIANGLE_SIZE))
+                return;
+            putVec(v0);
+            putVec(v1);
+            putVec(v2);
+            put16(color);
+        }
+
+        void drawSun(const Vector3 &worldPos, Color color, float glow)
+        {
+            if (!open(CMD_SUN, SUN_SIZE))
+                return;
+            putVec(worldPos);
+            put16(color.rgb565);
+            putF(glow);
+        }
+
+        void drawSkybox()
+        {
+            open(CMD_SKYBOX, 0);
+        }
+
+        void beginBandPass()
+        {
+            open(CMD_BAND_PASS, 0);
+        }
+
+    private:
+        struct MeshEntry
+        {
+            Mesh *mesh;
+            uint16_t id;
+            bool defined;
+        };
+
+        // Open-addressed pointer to ID table; IDs follow first use.
+        class PointerIds
+        {
+        public:
+            PointerIds() : keys(nullptr), ids(nullptr), capacity(0), count(0) {}
+            ~PointerIds() { release(); }
+
+            void clear()
+            {
+                if (keys)
+                    memset(keys, 0, capacity * sizeof(const void *));
+                count = 0;
+            }
+
+            void release()
+            {
+                MemUtils::freeData(keys);
+                MemUtils::freeData(ids);
+                keys = nullptr;
+                ids = nullptr;
+                capacity = count = 0;
+            }
+
+            uint16_t idFor(const void *ptr)
+            {
+                if ((count + 1) * 4 > capacity * 3 && !grow())
+                    return NO_ID;
+                uint32_t slot = find(ptr);
+                if (keys[slot])
+                    return ids[slot];
+                if (count >= NO_ID)
+                    return NO_ID;
+                keys[slot] = ptr;
+                ids[slot] = static_cast<uint16_t>(count++);
+                return ids[slot];
+            }
+
+        private:
+            const void **keys;
+            uint16_t *ids;
+            uint32_t capacity;
+            uint32_t count;
+
+            uint32_t find(const void *ptr) const
+            {
+                uint32_t slot = (static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr) >> 4) * 2654435761u) & (capacity - 1);
+                while (keys[slot] && keys[slot] != ptr)
+                    slot = (slot + 1) & (capacity - 1);
+                return slot;
+            }
+
+            bool grow()
+            {
+                const uint32_t newCapacity = capacity ? capacity * 2 : 64;
+                const void **oldKeys = keys;
+                uint16_t *oldIds = ids;
+                const uint32_t oldCapacity = capacity;
+
+                keys = static_cast<const void **>(MemUtils::allocData(newCapacity * sizeof(const void *), 16,
+                                                                       ::pip3D::Debug::LOG_MODULE_PERFORMANCE));
+                ids = static_cast<uint16_t *>(MemUtils::allocData(newCapacity * sizeof(uint16_t), 16,
+                                                                   ::pip3D::Debug::LOG_MODULE_PERFORMANCE));
+                if (!keys || !ids)
+                {
+                    MemUtils::freeData(keys);
+                    MemUtils::freeData(ids);
+                    keys = oldKeys;
+                    ids = oldIds;
+                    return false;
+                }
+                memset(keys, 0, newCapacity * sizeof(const void *));
+                capacity = newCapacity;
+                for (uint32_t i = 0; i < oldCapacity; ++i)
+                {
+                    if (!oldKeys[i])
+                        continue;
+                    const uint32_t slot = find(oldKeys[i]);
+                    keys[slot] = oldKeys[i];
+                    ids[slot] = oldIds[i];
+                }
+                MemUtils::freeData(oldKeys);
+                MemUtils::freeData(oldIds);
+                return true;
+            }
+        };
+
+        uint8_t *buffer;
+        size_t used;
+        size_t capacity;
+        size_t frameStart;
+        uint16_t framesWanted;
+        uint16_t frames;
+        bool recording;
+        bool truncated;
+
+        std::vector<MeshEntry> meshes;
+        uint16_t nextMeshId;
+        size_t lastMesh;
+        PointerIds instances;
+        PointerIds managers;
+
+        uint16_t meshId(Mesh *mesh)
+        {
+            size_t index = lastMesh;
+            if (index >= meshes.size() || meshes[index].mesh != mesh)
+            {
+                for (index = 0; index < meshes.size() && meshes[index].mesh != mesh; ++index)
+                {
+                }
+                if (index == meshes.size())
+                {
+                    if (nextMeshId == NO_ID)
+                        return NO_ID;
+                    meshes.push_back({mesh, nextMeshId++, false});
+                }
+                lastMesh = index;
+            }
+
+            MeshEntry &entry = meshes[index];
+            if (!entry.defined && open(CMD_MESH, MESH_SIZE))
+            {
+                put16(entry.id);
+                put16(mesh->numVertices());
+                put16(mesh->numFaces());
+                entry.defined = true;
+            }
+            return entry.id;
+        }
+
+        void putInstance(MeshInstance *inst, uint16_t meshRef)
+        {
+            put16(instances.idFor(inst));
+            put16(meshRef);
+            putVec(inst->pos());
+            const Quaternion &q = inst->rot();
+            putF(q.x);
+            putF(q.y);
+            putF(q.z);
+            putF(q.w);
+            putVec(inst->scl());
+            put16(inst->color().rgb565);
+            put8(static_cast<uint8_t>((inst->isVisible() ? INSTANCE_VISIBLE : 0) |
+                                      (inst->isOccluder() ? INSTANCE_OCCLUDER : 0)));
+        }
+
+        // Starts a command of payload bytes inside a frame; on overflow the
+        // frame being recorded is dropped and recording stops.
+        bool open(Command cmd, size_t payload)
+        {
+            if (!recording || !frames)
+                return false;
+            if (!reserve(1 + payload))
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_PERFORMANCE,
+                     "RenderCapture: stream full at %u bytes, keeping %u frames",
+                     static_cast<unsigned int>(used), static_cast<unsigned int>(frames - 1));
+                used = frameStart;
+                --frames;
+                recording = false;
+                truncated = true;
+                return false;
+            }
+            put8(cmd);
+            return true;
+        }
+
+        bool reserve(size_t bytes)
+        {
+            if (used + bytes <= capacity)
+                return true;
+            if (used + bytes > PIP3D_CAPTURE_MAX_BYTES)
+                return false;
+
+            size_t newCapacity = capacity ? capacity * 2 : 4096;
+            while (newCapacity < used + bytes)
+                newCapacity *= 2;
+            if (newCapacity > PIP3D_CAPTURE_MAX_BYTES)
+                newCapacity = PIP3D_CAPTURE_MAX_BYTES;
+
+            uint8_t *grown = static_cast<uint8_t *>(MemUtils::allocData(newCapacity, 16, ::pip3D::Debug::LOG_MODULE_PERFORMANCE));
+            if (!grown)
+                return false;
+            if (used)
+                memcpy(grown, buffer, used);
+            MemUtils::freeData(buffer);
+            buffer = grown;
+            capacity = newCapacity;
+            return true;
+        }
+
+        // ESP32 and the host builds are little-endian, so values are
+        // stored as they are in memory.
+        __attribute__((always_inline)) inline void put(const void *src, size_t bytes)
+        {
+            if (bytes)
+                memcpy(buffer + used, src, bytes);
+            used += bytes;
+        }
+        __attribute__((always_inline)) inline void put8(uint8_t v) { buffer[used++] = v; }
+        __attribute__((always_inline)) inline void put16(uint16_t v) { put(&v, 2); }
+        __attribute__((always_inline)) inline void putF(float v) { put(&v, 4); }
+        __attribute__((always_inline)) inline void putVec(const Vector3 &v)
+        {
+            putF(v.x);
+            putF(v.y);
+            putF(v.z);
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,423 @@
+#ifndef VERTEXCACHE_H
+#define VERTEXCACHE_H
+
+#include "../../Core/Core.h"
+#include "../../Core/Camera.h"
+#include "../../Math/Math.h"
+#include "../../Geometry/Mesh.h"
+#include "CameraController.h"
+
+#ifndef PIP3D_VERTEX_CACHE_SLOTS
+#define PIP3D_VERTEX_CACHE_SLOTS 16
+#endif
+
+// A face is only culled when the eye is behind its plane by more than this
+// fraction of the eye distance, which covers the error of packed normals.
+#ifndef PIP3D_BACKFACE_CULL_MARGIN
+#define PIP3D_BACKFACE_CULL_MARGIN 0.035f
+#endif
+
+// Guard band past each viewport edge, in pixels. Faces inside it go to the
+// rasterizer unclipped; it has to stay well inside int16 range after the
+// band offset is applied.
+#ifndef PIP3D_GUARD_BAND_PIXELS
+#define PIP3D_GUARD_BAND_PIXELS 8192
+#endif
+
+namespace pip3D
+{
+
+    enum VertexClipFlags : uint8_t
+    {
+        VERTEX_CLIP_NONE = 0,
+        VERTEX_CLIP_NEAR = 1 << 0,
+        VERTEX_CLIP_LEFT = 1 << 1,
+        VERTEX_CLIP_RIGHT = 1 << 2,
+        VERTEX_CLIP_TOP = 1 << 3,
+        VERTEX_CLIP_BOTTOM = 1 << 4,
+        VERTEX_CLIP_GUARD = 1 << 5,
+        VERTEX_CLIP_SCREEN = VERTEX_CLIP_LEFT | VERTEX_CLIP_RIGHT | VERTEX_CLIP_TOP | VERTEX_CLIP_BOTTOM,
+        // Faces touching these need real clipping before rasterization.
+        VERTEX_CLIP_NEEDS_CLIP = VERTEX_CLIP_NEAR | VERTEX_CLIP_GUARD
+    };
+
+    // Clip-space classification setup for one camera and viewport. Guard
+    // limits are in units of w, so a vertex is inside when |x| <= guardX * w.
+    struct ClipGuard
+    {
+        float guardX;
+        float guardY;
+        bool nearPlane;
+
+        ClipGuard(const Camera &camera, const Viewport &viewport)
+            : guardX(1.0f + 2.0f * PIP3D_GUARD_BAND_PIXELS / static_cast<float>(viewport.width)),
+              guardY(1.0f + 2.0f * PIP3D_GUARD_BAND_PIXELS / static_cast<float>(viewport.height)),
+              nearPlane(camera.projectionType == PERSPECTIVE)
+        {
+        }
+
+        // Homogeneous outcodes of one world-space vertex. screen is only
+        // written for vertices in front of the near plane.
+        __attribute__((always_inline)) inline uint8_t classify(const Vector3 &world,
+                                                               const Matrix4x4 &viewProjMatrix,
+                                                               const Viewport &viewport,
+                                                               Vector3 &screen) const
+        {
+            const float *m = viewProjMatrix.m;
+            const float x = m[0] * world.x + m[4] * world.y + m[8] * world.z + m[12];
+            const float y = m[1] * world.x + m[5] * world.y + m[9] * world.z + m[13];
+            const float z = m[2] * world.x + m[6] * world.y + m[10] * world.z + m[14];
+            const float w = m[3] * world.x + m[7] * world.y + m[11] * world.z + m[15];
+
+            // Projection is meaningless behind the near plane.
+            if (nearPlane && z < -w)
+                return VERTEX_CLIP_NEAR;
+
+            uint8_t clip = VERTEX_CLIP_NONE;
+            if (x < -w)
+                clip |= VERTEX_CLIP_LEFT;
+            else if (x > w)
+                clip |= VERTEX_CLIP_RIGHT;
+            if (y > w)
+                clip |= VERTEX_CLIP_TOP;
+            else if (y < -w)
+                clip |= VERTEX_CLIP_BOTTOM;
+            if (fabsf(x) > guardX * w || fabsf(y) > guardY * w)
+                clip |= VERTEX_CLIP_GUARD;
+
+            const float invW = 1.0f / w;
+            screen.x = (x * invW + 1.0f) * viewport.width * 0.5f + viewport.x;
+            screen.y = (1.0f - y * invW) * viewport.height * 0.5f + viewport.y;
+            screen.z = z * invW;
+            return clip;
+        }
+    };
+
+    struct TransformedVertex
+    {
+        Vector3 world;
+        Vector3 screen;
+        uint8_t clip;
+    };
+
+    // Eye in the mesh's own space, for culling against its face normals.
+    // Orthographic cameras pass the direction towards the viewer instead of
+    // a point.
+    struct BackfaceCullParams
+    {
+        Vector3 eye;
+        bool directional;
+    };
+
+    // Per-frame cache of transformed and projected mesh vertices.
+    // Each slot is keyed by its owner (usually a MeshInstance) and stays valid
+    // until beginFrame(), so every band of a frame reuses the same vertex stage.
+    class VertexCache
+    {
+    private:
+        struct Slot
+        {
+            const void *owner;
+            const Mesh *mesh;
+            uint32_t frame;
+            TransformedVertex *verts;
+            uint16_t capacity;
+            uint16_t count;
+            uint8_t *faceVisible;
+            uint16_t faceCapacity;
+            bool culled;
+        };
+
+        // Last slot is a transient fallback used when every regular slot
+        // already belongs to the current frame.
+        static constexpr int SLOT_COUNT = PIP3D_VERTEX_CACHE_SLOTS + 1;
+
+        Slot slots[SLOT_COUNT];
+        uint32_t frameId;
+
+        // Scratch mask of vertices referenced by front faces.
+        uint8_t *vertexUsed;
+        uint16_t vertexUsedCapacity;
+
+        // Decoded positions of the mesh staged for a run of instances;
+        // decoding waits for the first vertex stage that needs them.
+        const Mesh *stageRequest;
+        const Mesh *stagedMesh;
+        uint32_t stagedFrame;
+        Vector3 *stagedPositions;
+        uint16_t stagedCount;
+        uint16_t stagedCapacity;
+
+        bool reserve(Slot &slot, uint16_t count)
+        {
+            if (slot.verts && slot.capacity >= count)
+                return true;
+
+            if (slot.verts)
+            {
+                MemUtils::freeData(slot.verts);
+                slot.verts = nullptr;
+                slot.capacity = 0;
+            }
+
+            slot.verts = static_cast<TransformedVertex *>(
+                MemUtils::allocData(static_cast<size_t>(count) * sizeof(TransformedVertex), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+            if (!slot.verts)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "VertexCache::reserve: allocation failed (vertices=%u)",
+                     static_cast<unsigned int>(count));
+                return false;
+            }
+            slot.capacity = count;
+            return true;
+        }
+
+        static bool reserveBytes(uint8_t *&buffer, uint16_t &capacity, uint16_t count)
+        {
+            if (buffer && capacity >= count)
+                return true;
+            if (buffer)
+                MemUtils::freeData(buffer);
+            buffer = static_cast<uint8_t *>(MemUtils::allocData(count, 4, ::pip3D::Debug::LOG_MODULE_RENDER));
+            capacity = buffer ? count : 0;
+            return buffer != nullptr;
+        }
+
+        // Marks front faces in slot.faceVisible and the vertices they use in
+        // vertexUsed, so the vertex stage skips what only back faces touch.
+        static void cullFaces(Slot &slot,
+                              const Mesh *mesh,
+                              const BackfaceCullParams &cull,
+                              const Vector3 *__restrict local,
+                              uint8_t *__restrict vertexUsed)
+        {
+            const PackedNormal *__restrict normals = mesh->faceNormals();
+            const uint16_t faceCount = mesh->numFaces();
+            constexpr float marginSq = PIP3D_BACKFACE_CULL_MARGIN * PIP3D_BACKFACE_CULL_MARGIN;
+
+            memset(vertexUsed, 0, slot.count);
+            for (uint16_t i = 0; i < faceCount; ++i)
+            {
+                const Face &face = mesh->face(i);
+                const Vector3 n = normals[i].get();
+                const Vector3 toEye = cull.directional
+                                          ? cull.eye
+                                          : cull.eye - (local ? local[face.v0] : mesh->decodePosition(mesh->vert(face.v0)));
+                const float d = n.dot(toEye);
+                const bool front = d >= 0.0f ||
+                                   d * d <= marginSq * n.lengthSquared() * toEye.lengthSquared();
+                slot.faceVisible[i] = front ? 1 : 0;
+                if (front)
+                {
+                    vertexUsed[face.v0] = 1;
+                    vertexUsed[face.v1] = 1;
+                    vertexUsed[face.v2] = 1;
+                }
+            }
+        }
+
+        static void fill(Slot &slot,
+                         const Mesh *mesh,
+                         const Matrix4x4 &worldTransform,
+                         const Camera &camera,
+                         const Matrix4x4 &viewProjMatrix,
+                         const Viewport &viewport,
+                         const Vector3 *__restrict local,
+                         const uint8_t *__restrict vertexUsed)
+        {
+            const ClipGuard guard(camera, viewport);
+
+            TransformedVertex *__restrict out = slot.verts;
+            const uint16_t count = slot.count;
+
+            for (uint16_t i = 0; i < count; ++i)
+            {
+                if (vertexUsed && !vertexUsed[i])
+                    continue;
+
+                TransformedVertex &tv = out[i];
+                tv.world = worldTransform.transformNoDiv(local ? local[i] : mesh->decodePosition(mesh->vert(i)));
+                tv.clip = guard.classify(tv.world, viewProjMatrix, viewport, tv.screen);
+            }
+        }
+
+    public:
+        VertexCache()
+            : frameId(1), vertexUsed(nullptr), vertexUsedCapacity(0),
+              stageRequest(nullptr), stagedMesh(nullptr), stagedFrame(0), stagedPositions(nullptr), stagedCount(0), stagedCapacity(0)
+        {
+            for (int i = 0; i < SLOT_COUNT; ++i)
+            {
+                slots[i] = {nullptr, nullptr, 0, nullptr, 0, 0, nullptr, 0, false};
+            }
+        }
+
+        ~VertexCache()
+        {
+            release();
+        }
+
+        VertexCache(const VertexCache &) = delete;
+        VertexCache &operator=(const VertexCache &) = delete;
+
+        void beginFrame()
+        {
+            stageRequest = nullptr;
+            ++frameId;
+            if (frameId == 0)
+                frameId = 1;
+        }
+
+        // The following acquire() calls for the mesh transform from its
+        // positions decoded once into internal RAM, instead of reading the
+        // vertex data again per instance. Meant for runs of instances
+        // sharing a mesh; holds until the next stageMesh() or beginFrame().
+        void stageMesh(const Mesh *mesh)
+        {
+            stageRequest = mesh;
+        }
+
+    private:
+        const Vector3 *stagedPositionsFor(const Mesh *mesh)
+        {
+            if (mesh != stageRequest)
+                return nullptr;
+            if (mesh == stagedMesh && stagedFrame == frameId && stagedCount == mesh->numVertices())
+                return stagedPositions;
+            stagedMesh = nullptr;
+
+            const uint16_t count = mesh->numVertices();
+            if (count == 0)
+                return nullptr;
+            if (!stagedPositions || stagedCapacity < count)
+            {
+                MemUtils::freeData(stagedPositions);
+                stagedPositions = static_cast<Vector3 *>(
+                    MemUtils::allocFast(static_cast<size_t>(count) * sizeof(Vector3), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+                stagedCapacity = stagedPositions ? count : 0;
+                if (!stagedPositions)
+                    return nullptr;
+            }
+
+            for (uint16_t i = 0; i < count; ++i)
+                stagedPositions[i] = mesh->decodePosition(mesh->vert(i));
+            stagedMesh = mesh;
+            stagedFrame = frameId;
+            stagedCount = count;
+            return stagedPositions;
+        }
+
+    public:
+        // Returns transformed vertices for (owner, mesh) in the current frame,
+        // running the vertex stage only on the first request of the frame.
+        // With cull set and face normals on the mesh, back faces are rejected
+        // first and their vertices left untransformed; faceVisible then gets
+        // the per-face mask, otherwise nullptr.
+        const TransformedVertex *acquire(const void *owner,
+                                         const Mesh *mesh,
+                                         const Matrix4x4 &worldTransform,
+                                         const Camera &camera,
+                                         const Matrix4x4 &viewProjMatrix,
+                                         const Viewport &viewport,
+                                         const BackfaceCullParams *cull = nullptr,
+                                         const uint8_t **faceVisible = nullptr)
+        {
+            if (faceVisible)
+                *faceVisible = nullptr;
+            if (!owner || !mesh)
+                return nullptr;
+
+            const uint16_t count = mesh->numVertices();
+            if (count == 0)
+                return nullptr;
+
+            Slot *target = nullptr;
+            Slot *stale = nullptr;
+            for (int i = 0; i < SLOT_COUNT - 1; ++i)
+            {
+                Slot &slot = slots[i];
+                if (slot.owner == owner)
+                {
+                    if (slot.frame == frameId && slot.mesh == mesh && slot.count == count)
+                    {
+                        if (faceVisible && slot.culled)
+                            *faceVisible = slot.faceVisible;
+                        return slot.verts;
+                    }
+                    target = &slot;
+                    break;
+                }
+                if (slot.frame != frameId && (!stale || !slot.owner))
+                    stale = &slot;
+            }
+
+            if (!target)
+                target = stale ? stale : &slots[SLOT_COUNT - 1];
+
+            if (!reserve(*target, count))
+            {
+                target->owner = nullptr;
+                return nullptr;
+            }
+
+            target->owner = owner;
+            target->mesh = mesh;
+            target->frame = frameId;
+            target->count = count;
+            target->culled = false;
+
+            const Vector3 *local = stagedPositionsFor(mesh);
+            const uint8_t *used = nullptr;
+            if (cull && mesh->hasFaceNormals() &&
+                reserveBytes(target->faceVisible, target->faceCapacity, mesh->numFaces()) &&
+                reserveBytes(vertexUsed, vertexUsedCapacity, count))
+            {
+                cullFaces(*target, mesh, *cull, local, vertexUsed);
+                target->culled = true;
+                used = vertexUsed;
+                if (faceVisible)
+                    *faceVisible = target->faceVisible;
+            }
+            fill(*target, mesh, worldTransform, camera, viewProjMatrix, viewport, local, used);
+            return target->verts;
+        }
+
+        void invalidate(const void *owner)
+        {
+            for (int i = 0; i < SLOT_COUNT; ++i)
+            {
+                if (slots[i].owner == owner)
+                {
+                    slots[i].owner = nullptr;
+                    slots[i].frame = 0;
+                }
+            }
+        }
+
+        void release()
+        {
+            for (int i = 0; i < SLOT_COUNT; ++i)
+            {
+                if (slots[i].verts)
+                    MemUtils::freeData(slots[i].verts);
+                if (slots[i].faceVisible)
+                    MemUtils::freeData(slots[i].faceVisible);
+                slots[i] = {nullptr, nullptr, 0, nullptr, 0, 0, nullptr, 0, false};
+            }
+            if (vertexUsed)
+                MemUtils::freeData(vertexUsed);
+            vertexUsed = nullptr;
+            vertexUsedCapacity = 0;
+            MemUtils::freeData(stagedPositions);
+            stagedPositions = nullptr;
+            stageRequest = nullptr;
+            stagedMesh = nullptr;
+            stagedCount = 0;
+            stagedCapacity = 0;
+        }
+    };
+
+}
+
+#endif
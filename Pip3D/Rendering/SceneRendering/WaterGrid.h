@@ -0,0 +1,198 @@
+#ifndef WATERGRID_H
+#define WATERGRID_H
+
+#include <string.h>
+#include "../../Core/Core.h"
+#include "../../Math/Math.h"
+#include "CameraController.h"
+
+#ifndef PIP3D_WATER_MAX_GRID
+#define PIP3D_WATER_MAX_GRID 32
+#endif
+
+#ifndef PIP3D_WATER_MIN_GRID
+#define PIP3D_WATER_MIN_GRID 8
+#endif
+
+namespace pip3D
+{
+
+    // Projected water heightfield shared by every band of a frame. Heights
+    // are separable, sin(x) + cos(z), so a grid of N cells costs 2(N+1) trig
+    // calls and (N+1)^2 projections, and is only rebuilt when its inputs or
+    // the camera change.
+    class WaterGrid
+    {
+    public:
+        static constexpr int MAX_GRID = PIP3D_WATER_MAX_GRID;
+        static constexpr int MIN_GRID = PIP3D_WATER_MIN_GRID;
+        static constexpr int MAX_VERTS = (MAX_GRID + 1) * (MAX_GRID + 1);
+
+    private:
+        Vector3 *verts;
+        float waveX[MAX_GRID + 1];
+        float waveZ[MAX_GRID + 1];
+        // Screen rows covered by each row of cells, for band rejection.
+        int16_t rowMinY[MAX_GRID];
+        int16_t rowMaxY[MAX_GRID];
+        int grid;
+        uint32_t key;
+        bool valid;
+        int16_t minX, minY, maxX, maxY;
+        int16_t prevMinX, prevMinY, prevMaxX, prevMaxY;
+
+        static uint32_t hashBytes(uint32_t h, const void *data, size_t size)
+        {
+            const uint8_t *bytes = static_cast<const uint8_t *>(data);
+            for (size_t i = 0; i < size; ++i)
+            {
+                h ^= bytes[i];
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+    public:
+        WaterGrid() : verts(nullptr), grid(0), key(0), valid(false),
+                      minX(0), minY(0), maxX(-1), maxY(-1),
+                      prevMinX(0), prevMinY(0), prevMaxX(-1), prevMaxY(-1) {}
+
+        ~WaterGrid()
+        {
+            if (verts)
+                MemUtils::freeData(verts);
+        }
+
+        WaterGrid(const WaterGrid &) = delete;
+        WaterGrid &operator=(const WaterGrid &) = delete;
+
+        // Cells per side: full density up close, down to MIN_GRID once the
+        // patch is several of its own sizes away.
+        static int densityFor(float size, float distance)
+        {
+            if (distance <= size)
+                return MAX_GRID;
+            int n = static_cast<int>(MAX_GRID * size / distance);
+            n &= ~1;
+            return n < MIN_GRID ? MIN_GRID : n;
+        }
+
+        // Returns true when the grid was rebuilt.
+        bool update(float yLevel, float size, float time, const Vector3 &eye,
+                    const Matrix4x4 &viewProjMatrix, const Viewport &viewport)
+        {
+            const float half = size * 0.5f;
+            const float dx = fmaxf(fabsf(eye.x) - half, 0.0f);
+            const float dz = fmaxf(fabsf(eye.z) - half, 0.0f);
+            const float dy = eye.y - yLevel;
+            const int n = densityFor(size, sqrtf(dx * dx + dy * dy + dz * dz));
+
+            uint32_t h = 2166136261u;
+            h = hashBytes(h, &yLevel, sizeof(float));
+            h = hashBytes(h, &size, sizeof(float));
+            h = hashBytes(h, &time, sizeof(float));
+            h = hashBytes(h, &n, sizeof(n));
+            h = hashBytes(h, viewProjMatrix.m, sizeof(viewProjMatrix.m));
+            h = hashBytes(h, &viewport, sizeof(viewport));
+            if (valid && h == key)
+                return false;
+
+            if (!verts)
+            {
+                verts = static_cast<Vector3 *>(MemUtils::allocData(MAX_VERTS * sizeof(Vector3), 16, ::pip3D::Debug::LOG_MODULE_RENDER));
+                if (!verts)
+                {
+                    LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                         "WaterGrid::update: allocation failed (%u vertices)",
+                         static_cast<unsigned int>(MAX_VERTS));
+                    valid = false;
+                    return false;
+                }
+            }
+
+            const float step = size / static_cast<float>(n);
+            const float freq = 0.6f;
+            const float amp = size * 0.02f;
+            for (int i = 0; i <= n; ++i)
+            {
+                const float c = -half + step * static_cast<float>(i);
+                waveX[i] = FastMath::fastSin(c * freq + time) * amp;
+                waveZ[i] = FastMath::fastCos(c * freq + time) * amp;
+            }
+
+            float bx0 = 1e30f, by0 = 1e30f, bx1 = -1e30f, by1 = -1e30f;
+            float prevMin = 0.0f, prevMax = 0.0f;
+            for (int iz = 0; iz <= n; ++iz)
+            {
+                const float z = -half + step * static_cast<float>(iz);
+                float lo = 1e30f, hi = -1e30f;
+                Vector3 *row = verts + iz * (n + 1);
+                for (int ix = 0; ix <= n; ++ix)
+                {
+                    const float x = -half + step * static_cast<float>(ix);
+                    const Vector3 p = CameraController::project(Vector3(x, yLevel + waveX[ix] + waveZ[iz], z),
+                                                                viewProjMatrix, viewport);
+                    row[ix] = p;
+                    lo = fminf(lo, p.y);
+                    hi = fmaxf(hi, p.y);
+                    bx0 = fminf(bx0, p.x);
+                    bx1 = fmaxf(bx1, p.x);
+                }
+                by0 = fminf(by0, lo);
+                by1 = fmaxf(by1, hi);
+                if (iz > 0)
+                {
+                    rowMinY[iz - 1] = static_cast<int16_t>(clamp(floorf(fminf(prevMin, lo)), -32768.0f, 32767.0f));
+                    rowMaxY[iz - 1] = static_cast<int16_t>(clamp(ceilf(fmaxf(prevMax, hi)), -32768.0f, 32767.0f));
+                }
+                prevMin = lo;
+                prevMax = hi;
+            }
+
+            prevMinX = minX;
+            prevMinY = minY;
+            prevMaxX = maxX;
+            prevMaxY = maxY;
+            minX = static_cast<int16_t>(clamp(floorf(bx0), -32768.0f, 32767.0f));
+            minY = static_cast<int16_t>(clamp(floorf(by0), -32768.0f, 32767.0f));
+            maxX = static_cast<int16_t>(clamp(ceilf(bx1), -32768.0f, 32767.0f));
+            maxY = static_cast<int16_t>(clamp(ceilf(by1), -32768.0f, 32767.0f));
+            grid = n;
+            key = h;
+            valid = true;
+            return true;
+        }
+
+        __attribute__((always_inline)) inline bool isValid() const { return valid; }
+        __attribute__((always_inline)) inline int size() const { return grid; }
+        __attribute__((always_inline)) inline const Vector3 &vertex(int ix, int iz) const
+        {
+            return verts[iz * (grid + 1) + ix];
+        }
+        __attribute__((always_inline)) inline bool rowOverlaps(int iz, int16_t top, int16_t bottom) const
+        {
+            return rowMaxY[iz] >= top && rowMinY[iz] < bottom;
+        }
+
+        // Screen rect (inclusive) covering the grid before and after the
+        // last rebuild. False when it is empty.
+        bool changedBounds(int16_t &x0, int16_t &y0, int16_t &x1, int16_t &y1) const
+        {
+            x0 = minX;
+            y0 = minY;
+            x1 = maxX;
+            y1 = maxY;
+            if (prevMaxX >= prevMinX && prevMaxY >= prevMinY)
+            {
+                x0 = x0 < prevMinX ? x0 : prevMinX;
+                y0 = y0 < prevMinY ? y0 : prevMinY;
+                x1 = x1 > prevMaxX ? x1 : prevMaxX;
+                y1 = y1 > prevMaxY ? y1 : prevMaxY;
+            }
+            return x1 >= x0 && y1 >= y0;
+        }
+    };
+
+}
+
+#endif
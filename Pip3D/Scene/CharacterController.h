@@ -5,6 +5,7 @@
 #include "../Core/Instance.h"
 #include "../Core/Camera.h"
 #include "../Geometry/PrimitiveShapes.h"
+#include "../Physics/World.h"
 #include "SceneNode.h"
 
 namespace pip3D
@@ -36,6 +37,13 @@ namespace pip3D
         bool onGround;
         MeshInstance *visual;
 
+        // Collision against the physics world, as a sphere of radius; without
+        // a world only the y = radius floor applies.
+        PhysicsWorld *world;
+        uint16_t collisionMask;
+        float stepHeight;
+        float maxSlopeCos;
+
         Node *visualRoot;
         Node *visualBody;
         Node *visualHead;
@@ -46,6 +54,7 @@ namespace pip3D
         float walkTime;
         float walkAmount;
         bool ownsVisualNodes;
+        NodeList visualNodes;
 
     public:
         CharacterController()
@@ -60,6 +69,10 @@ namespace pip3D
               gravity(-9.81f),
               onGround(true),
               visual(nullptr),
+              world(nullptr),
+              collisionMask(PHYSICS_LAYER_ALL),
+              stepHeight(0.35f),
+              maxSlopeCos(0.7f),
               visualRoot(nullptr),
               visualBody(nullptr),
               visualHead(nullptr),
@@ -237,6 +250,20 @@ namespace pip3D
 
         const Vector3 &getPosition() const { return position; }
 
+        // Moves through the world's sweep queries with slide and step-up.
+        void setPhysicsWorld(PhysicsWorld *w, uint16_t layerMask = PHYSICS_LAYER_ALL)
+        {
+            world = w;
+            collisionMask = layerMask;
+        }
+
+        void setStepHeight(float h) { stepHeight = h > 0.0f ? h : 0.0f; }
+
+        // Steepest walkable slope, in degrees from horizontal.
+        void setMaxSlope(float degrees) { maxSlopeCos = cosf(degrees * DEG2RAD); }
+
+        bool isOnGround() const { return onGround; }
+
         float getYaw() const { return yaw; }
 
         void setYaw(float y)
@@ -295,7 +322,10 @@ namespace pip3D
                 velocity.y += gravity * deltaTime;
             }
 
-            position += velocity * deltaTime;
+            if (world)
+                moveInWorld(velocity * deltaTime, input.jump);
+            else
+                position += velocity * deltaTime;
 
             float minY = radius;
             if (position.y < minY)
@@ -386,6 +416,118 @@ namespace pip3D
             }
         }
 
+    private:
+        static constexpr float SKIN = 0.01f;
+        static constexpr int MAX_SLIDES = 3;
+
+        // Moves from pos by delta, sliding along what it hits. Returns the
+        // end position; blocked is set when a non-walkable surface stopped it.
+        Vector3 slide(Vector3 pos, Vector3 delta, bool &blocked)
+        {
+            blocked = false;
+            for (int i = 0; i < MAX_SLIDES; ++i)
+            {
+                const float lenSq = delta.lengthSquared();
+                if (lenSq <= 1e-10f)
+                    break;
+
+                SweepHit hit;
+                if (!world->sweepSphere(pos, delta, radius, hit, collisionMask))
+                {
+                    pos += delta;
+                    break;
+                }
+
+                const float len = sqrtf(lenSq);
+                const float travel = fmaxf(hit.fraction - SKIN / len, 0.0f);
+                pos += delta * travel;
+                if (hit.normal.y < maxSlopeCos)
+                    blocked = true;
+
+                Vector3 rest = delta * (1.0f - travel);
+                delta = rest - hit.normal * rest.dot(hit.normal);
+            }
+            return pos;
+        }
+
+        // Finds walkable ground within depth below pos.
+        bool probeGround(const Vector3 &pos, float depth, float &outDrop)
+        {
+            SweepHit hit;
+            if (!world->sweepSphere(pos, Vector3(0.0f, -depth, 0.0f), radius, hit, collisionMask) ||
+                hit.normal.y < maxSlopeCos)
+                return false;
+            outDrop = fmaxf(hit.fraction * depth - SKIN, 0.0f);
+            return true;
+        }
+
+        void moveInWorld(const Vector3 &delta, bool jumped)
+        {
+            const Vector3 horizontal(delta.x, 0.0f, delta.z);
+            const bool grounded = onGround && !jumped;
+
+            if (horizontal.lengthSquared() > 1e-10f)
+            {
+                bool blocked;
+                Vector3 moved = slide(position, horizontal, blocked);
+
+                // Step up: lift, move across, settle back onto the step.
+                if (blocked && grounded && stepHeight > 0.0f)
+                {
+                    bool liftBlocked, acrossBlocked;
+                    Vector3 lifted = slide(position, Vector3(0.0f, stepHeight, 0.0f), liftBlocked);
+                    Vector3 stepped = slide(lifted, horizontal, acrossBlocked);
+                    float drop;
+                    const float lift = lifted.y - position.y;
+                    if (probeGround(stepped, lift + SKIN, drop))
+                    {
+                        stepped.y -= drop;
+                        const float movedSq = (moved - position).lengthSquared();
+                        const float steppedSq = Vector3(stepped.x - position.x, 0.0f, stepped.z - position.z).lengthSquared();
+                        if (steppedSq > movedSq + 1e-8f)
+                            moved = stepped;
+                    }
+                }
+                position = moved;
+            }
+
+            if (grounded)
+            {
+                // Follow the ground down slopes and small steps; walking off
+                // a ledge starts a fall.
+                float drop;
+                if (probeGround(position, stepHeight + SKIN, drop))
+                    position.y -= drop;
+                else if (position.y > radius + SKIN)
+                    onGround = false;
+                return;
+            }
+
+            if (delta.y == 0.0f)
+                return;
+
+            // Falls slide off steep surfaces and land on walkable ones.
+            bool blocked;
+            const float startY = position.y;
+            position = slide(position, Vector3(0.0f, delta.y, 0.0f), blocked);
+            const float movedY = position.y - startY;
+            float drop;
+            if (delta.y < 0.0f)
+            {
+                if (movedY > delta.y + 1e-5f && probeGround(position, 2.0f * SKIN, drop))
+                {
+                    position.y -= drop;
+                    velocity.y = 0.0f;
+                    onGround = true;
+                }
+            }
+            else if (movedY < delta.y - 1e-5f)
+            {
+                velocity.y = 0.0f;
+            }
+        }
+
+    public:
         void applyToCamera(Camera &cam, const Vector3 &offset) const
         {
             float yawRad = yaw * DEG2RAD;
@@ -434,7 +576,8 @@ namespace pip3D
 
             if (visualRoot)
             {
-                visualRoot->render(renderer);
+                visualNodes.setRoot(visualRoot);
+                visualNodes.render(renderer);
             }
         }
     };
@@ -5,6 +5,12 @@
 #include "../Rendering/Renderer.h"
 #include "../Utils/ObjectUtils.h"
 
+// Lights handed to the renderer per frame; each mesh is only shaded by the
+// ones whose range reaches it.
+#ifndef PIP3D_SCENE_MAX_LIGHTS
+#define PIP3D_SCENE_MAX_LIGHTS 8
+#endif
+
 namespace pip3D
 {
 
@@ -30,6 +36,29 @@ namespace pip3D
         Node::render(renderer);
     }
 
+    inline void NodeList::draw(Renderer *renderer) const
+    {
+        if (!renderer)
+            return;
+
+        for (const DrawItem &item : drawItems)
+        {
+            Mesh *mesh = item.mesh;
+            mesh->setPosition(item.position.x, item.position.y, item.position.z);
+            mesh->setRotation(item.rotation.x, item.rotation.y, item.rotation.z);
+            mesh->setScale(item.scale.x, item.scale.y, item.scale.z);
+
+            if (item.castShadows)
+            {
+                ObjectHelper::renderWithShadow(renderer, mesh);
+            }
+            else
+            {
+                renderer->drawMesh(mesh);
+            }
+        }
+    }
+
     class SceneGraph
     {
     private:
@@ -37,12 +66,14 @@ namespace pip3D
         Renderer *renderer;
         CameraNode *activeCamera;
         std::vector<LightNode *> lights;
+        NodeList nodes;
 
     public:
         SceneGraph(Renderer *rend)
             : renderer(rend), activeCamera(nullptr)
         {
             root = new Node("Root");
+            nodes.setRoot(root);
         }
 
         ~SceneGraph()
@@ -100,6 +131,8 @@ namespace pip3D
             if (!renderer)
                 return;
 
+            nodes.refresh();
+
             if (activeCamera)
             {
                 activeCamera->applyToCamera(renderer->getCamera());
@@ -108,7 +141,7 @@ namespace pip3D
             renderer->clearLights();
 
             int lightIndex = 0;
-            for (size_t i = 0; i < lights.size() && lightIndex < 4; i++)
+            for (size_t i = 0; i < lights.size() && lightIndex < PIP3D_SCENE_MAX_LIGHTS; i++)
             {
                 LightNode *node = lights[i];
                 if (!node || !node->isEnabled() || !node->isVisible())
@@ -121,32 +154,17 @@ namespace pip3D
             }
 
             renderer->beginFrame();
-            root->render(renderer);
+            nodes.draw(renderer);
             renderer->endFrame();
         }
 
         Node *findNode(const String &name)
         {
-            return findNodeRecursive(root, name);
+            return nodes.find(name);
         }
 
-    private:
-        Node *findNodeRecursive(Node *node, const String &name)
-        {
-            if (node->getName() == name)
-            {
-                return node;
-            }
-
-            for (size_t i = 0; i < node->getChildCount(); i++)
-            {
-                Node *found = findNodeRecursive(node->getChild(i), name);
-                if (found)
-                    return found;
-            }
-
-            return nullptr;
-        }
+        // Flattened nodes and the draw list of the last render().
+        NodeList &getNodeList() { return nodes; }
     };
 
     class SceneBuilder
@@ -30,9 +30,30 @@ namespace pip3D
         Matrix4x4 worldTransform;
         bool transformDirty;
 
+        // A node's world transform is stale when its own transform changed
+        // or its parent's world stamp moved on since it was built, so moving
+        // a node never has to walk its subtree.
+        uint32_t worldStamp;
+        uint32_t parentStamp;
+
+        static uint32_t nextStamp()
+        {
+            static uint32_t counter = 0;
+            return ++counter;
+        }
+
+        static uint32_t &hierarchyCounter()
+        {
+            static uint32_t counter = 0;
+            return counter;
+        }
+
+        friend class NodeList;
+
     public:
         Node(const String &nodeName = "Node")
-            : name(nodeName), visible(true), enabled(true), position(0, 0, 0), rotation(0, 0, 0), scale(1, 1, 1), parent(nullptr), transformDirty(true)
+            : name(nodeName), visible(true), enabled(true), position(0, 0, 0), rotation(0, 0, 0), scale(1, 1, 1), parent(nullptr), transformDirty(true),
+              worldStamp(0), parentStamp(0)
         {
             localTransform.identity();
             worldTransform.identity();
@@ -45,8 +66,13 @@ namespace pip3D
                 delete child;
             }
             children.clear();
+            ++hierarchyCounter();
         }
 
+        // Changes whenever a node anywhere is attached, detached, renamed or
+        // destroyed; NodeList rebuilds on it.
+        static uint32_t hierarchyVersion() { return hierarchyCounter(); }
+
         void addChild(Node *child)
         {
             if (!child)
@@ -65,6 +91,7 @@ namespace pip3D
             child->parent = this;
             children.push_back(child);
             child->markTransformDirty();
+            ++hierarchyCounter();
         }
 
         void removeChild(Node *child)
@@ -81,7 +108,9 @@ namespace pip3D
             if (it != children.end())
             {
                 (*it)->parent = nullptr;
+                (*it)->markTransformDirty();
                 children.erase(it);
+                ++hierarchyCounter();
             }
             else
             {
@@ -242,22 +271,38 @@ namespace pip3D
 
         void updateWorldTransform()
         {
+            if (parent)
+            {
+                parent->updateWorldTransform();
+            }
+            refreshWorldTransform();
+        }
+
+        // Like updateWorldTransform() for a node whose parent is already up
+        // to date, as in NodeList's parent-first pass.
+        void refreshWorldTransform()
+        {
+            const uint32_t stamp = parent ? parent->worldStamp : 0;
+            if (!transformDirty && worldStamp && stamp == parentStamp)
+                return;
+
             if (transformDirty)
             {
                 updateLocalTransform();
+            }
 
-                if (parent)
-                {
-                    parent->updateWorldTransform();
-                    worldTransform = parent->worldTransform * localTransform;
-                }
-                else
-                {
-                    worldTransform = localTransform;
-                }
-
-                transformDirty = false;
+            if (parent)
+            {
+                worldTransform = parent->worldTransform * localTransform;
+            }
+            else
+            {
+                worldTransform = localTransform;
             }
+
+            parentStamp = stamp;
+            worldStamp = nextStamp();
+            transformDirty = false;
         }
 
         const Matrix4x4 &getWorldTransform()
@@ -278,11 +323,6 @@ namespace pip3D
         void markTransformDirty()
         {
             transformDirty = true;
-
-            for (Node *child : children)
-            {
-                child->markTransformDirty();
-            }
         }
 
         void setVisible(bool vis) { visible = vis; }
@@ -291,7 +331,11 @@ namespace pip3D
         void setEnabled(bool en) { enabled = en; }
         bool isEnabled() const { return enabled; }
 
-        void setName(const String &newName) { name = newName; }
+        void setName(const String &newName)
+        {
+            name = newName;
+            ++hierarchyCounter();
+        }
         const String &getName() const { return name; }
 
         virtual void update(float deltaTime)
@@ -315,6 +359,8 @@ namespace pip3D
                 child->render(renderer);
             }
         }
+
+        virtual class MeshNode *asMeshNode() { return nullptr; }
     };
 
     class MeshNode : public Node
@@ -355,6 +401,8 @@ namespace pip3D
         bool getCastShadows() const { return castShadows; }
 
         void render(class Renderer *renderer) override;
+
+        MeshNode *asMeshNode() override { return this; }
     };
 
     class CameraNode : public Node
@@ -442,6 +490,174 @@ namespace pip3D
         }
     };
 
+    // A subtree flattened parent-before-child, depth first with children in
+    // order, so world transforms update in one linear pass and the visible
+    // meshes come out as a flat draw list in the order Node::render would
+    // draw them. The flat array and the name index are rebuilt only when the
+    // hierarchy changes.
+    class NodeList
+    {
+    public:
+        struct DrawItem
+        {
+            Mesh *mesh;
+            Vector3 position; // world
+            Vector3 rotation; // local, as MeshNode::render applies it
+            Vector3 scale;
+            bool castShadows;
+        };
+
+    private:
+        struct Entry
+        {
+            Node *node;
+            MeshNode *meshNode;
+            int32_t parent;
+        };
+
+        Node *root;
+        uint32_t builtVersion;
+        bool built;
+        std::vector<Entry> entries;
+        std::vector<uint8_t> visibility;
+        std::vector<std::pair<Node *, int32_t>> stack;
+        // (name hash, entry index), sorted, so equal names keep tree order.
+        std::vector<std::pair<uint32_t, uint32_t>> names;
+        std::vector<DrawItem> drawItems;
+
+        static uint32_t hashName(const String &name)
+        {
+            uint32_t h = 2166136261u;
+            for (const char *c = name.c_str(); *c; ++c)
+            {
+                h ^= static_cast<uint8_t>(*c);
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        void ensureBuilt()
+        {
+            if (!built || builtVersion != Node::hierarchyVersion())
+                rebuild();
+        }
+
+    public:
+        NodeList(Node *rootNode = nullptr)
+            : root(rootNode), builtVersion(0), built(false) {}
+
+        void setRoot(Node *rootNode)
+        {
+            if (root == rootNode)
+                return;
+            root = rootNode;
+            built = false;
+        }
+
+        Node *getRoot() const { return root; }
+
+        void rebuild()
+        {
+            entries.clear();
+            names.clear();
+            stack.clear();
+            builtVersion = Node::hierarchyVersion();
+            built = true;
+            if (!root)
+                return;
+
+            // Children are pushed last to first so they pop in order.
+            stack.push_back({root, -1});
+            while (!stack.empty())
+            {
+                Node *node = stack.back().first;
+                const int32_t parentIndex = stack.back().second;
+                stack.pop_back();
+
+                const int32_t index = static_cast<int32_t>(entries.size());
+                entries.push_back({node, node->asMeshNode(), parentIndex});
+                names.push_back({hashName(node->getName()), static_cast<uint32_t>(index)});
+
+                for (size_t i = node->children.size(); i-- > 0;)
+                {
+                    stack.push_back({node->children[i], index});
+                }
+            }
+
+            std::sort(names.begin(), names.end());
+            visibility.resize(entries.size());
+        }
+
+        // Brings every world transform up to date, parents first, and
+        // collects the visible meshes.
+        void refresh()
+        {
+            ensureBuilt();
+            drawItems.clear();
+
+            const size_t count = entries.size();
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Entry &entry = entries[i];
+                Node *node = entry.node;
+                if (i == 0)
+                    node->updateWorldTransform();
+                else
+                    node->refreshWorldTransform();
+
+                bool shown = node->isVisible() && (entry.parent < 0 || visibility[entry.parent]);
+                if (entry.meshNode)
+                {
+                    Mesh *mesh = entry.meshNode->getMesh();
+                    shown = shown && mesh;
+                    if (shown)
+                    {
+                        const Matrix4x4 &world = node->worldTransform;
+                        drawItems.push_back({mesh,
+                                             Vector3(world.m[12], world.m[13], world.m[14]),
+                                             node->getRotation(),
+                                             node->getScale(),
+                                             entry.meshNode->getCastShadows()});
+                    }
+                }
+                visibility[i] = shown ? 1 : 0;
+            }
+        }
+
+        // Draw list from the last refresh().
+        const std::vector<DrawItem> &getDrawList() const { return drawItems; }
+
+        // Draws the last refresh()'s list; defined in SceneGraph.h.
+        void draw(class Renderer *renderer) const;
+
+        void render(class Renderer *renderer)
+        {
+            refresh();
+            draw(renderer);
+        }
+
+        // First node in tree order with this name.
+        Node *find(const String &name)
+        {
+            ensureBuilt();
+            const uint32_t h = hashName(name);
+            auto it = std::lower_bound(names.begin(), names.end(), std::make_pair(h, 0u));
+            for (; it != names.end() && it->first == h; ++it)
+            {
+                Node *node = entries[it->second].node;
+                if (node->getName() == name)
+                    return node;
+            }
+            return nullptr;
+        }
+
+        size_t size()
+        {
+            ensureBuilt();
+            return entries.size();
+        }
+    };
+
 }
 
 #endif
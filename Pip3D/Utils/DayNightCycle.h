@@ -2,7 +2,6 @@
 #define DAYNIGHTCYCLE_H
 
 #include "../Core/Core.h"
-#include "../Core/Jobs.h"
 #include "../Rendering/Renderer.h"
 
 namespace pip3D
@@ -15,17 +14,32 @@ namespace pip3D
         float baseIntensity;
         float nightIntensity;
         bool autoAdvance;
+        // Sky states baked per day; 1440 is one per in-game minute.
+        uint16_t keyframeCount;
 
         TimeOfDayConfig()
-            : dayLengthSeconds(120.0f), startHour(10.0f), baseIntensity(1.0f), nightIntensity(0.05f), autoAdvance(true) {}
+            : dayLengthSeconds(120.0f), startHour(10.0f), baseIntensity(1.0f), nightIntensity(0.05f), autoAdvance(true),
+              keyframeCount(1440) {}
     };
 
+    // The sky over a day is baked into a keyframe table at init; update()
+    // looks the current minute up and only touches the renderer when the
+    // keyframe changes, and the skybox gradient only when its RGB565 stops
+    // differ from the ones already shown.
     class TimeOfDayController
     {
     public:
         TimeOfDayController(Renderer *r = nullptr)
             : renderer(r), timeMinutes(600.0f), dayLengthSeconds(120.0f), baseIntensity(1.0f), nightIntensity(0.05f), autoAdvance(true),
-              pendingTime01(0.0f), cachedValid(false), jobInProgress(false) {}
+              keyframes(nullptr), keyframeCount(1440), appliedKeyframe(-1) {}
+
+        ~TimeOfDayController()
+        {
+            MemUtils::freeData(keyframes);
+        }
+
+        TimeOfDayController(const TimeOfDayController &) = delete;
+        TimeOfDayController &operator=(const TimeOfDayController &) = delete;
 
         void init(Renderer *r, const TimeOfDayConfig &cfg)
         {
@@ -34,10 +48,15 @@ namespace pip3D
             baseIntensity = cfg.baseIntensity;
             nightIntensity = cfg.nightIntensity;
             autoAdvance = cfg.autoAdvance;
+            bake(cfg.keyframeCount);
             setTime(cfg.startHour, 0.0f);
         }
 
-        void setRenderer(Renderer *r) { renderer = r; }
+        void setRenderer(Renderer *r)
+        {
+            renderer = r;
+            appliedKeyframe = -1;
+        }
 
         void setDayLengthSeconds(float seconds)
         {
@@ -46,14 +65,17 @@ namespace pip3D
 
         void setAutoAdvance(bool enabled) { autoAdvance = enabled; }
 
+        // Intensities are applied at lookup and need no re-bake.
         void setBaseIntensity(float intensity)
         {
             baseIntensity = intensity;
+            appliedKeyframe = -1;
         }
 
         void setNightIntensity(float intensity)
         {
             nightIntensity = intensity;
+            appliedKeyframe = -1;
         }
 
         void setTime(float hours, float minutes = 0.0f)
@@ -65,8 +87,6 @@ namespace pip3D
                 h -= 24.0f;
             float m = clamp(minutes, 0.0f, 59.999f);
             timeMinutes = h * 60.0f + m;
-            cachedValid = false;
-            jobInProgress = false;
             applyToRenderer();
         }
 
@@ -80,6 +100,8 @@ namespace pip3D
             return timeMinutes / 1440.0f;
         }
 
+        uint16_t getKeyframeCount() const { return keyframes ? keyframeCount : 0; }
+
         __attribute__((hot)) void update(float deltaSeconds)
         {
             if (!renderer)
@@ -96,30 +118,23 @@ namespace pip3D
                         timeMinutes += 1440.0f;
                 }
             }
-            if (JobSystem::isEnabled())
-            {
-                float t = timeMinutes / 1440.0f;
-                if (!jobInProgress)
-                {
-                    pendingTime01 = t;
-                    if (JobSystem::submit(&TimeOfDayController::skyJobFunc, this))
-                    {
-                        jobInProgress = true;
-                    }
-                }
-
-                if (cachedValid)
-                {
-                    applySkyStateToRenderer(cachedState);
-                }
-            }
-            else
-            {
-                applyToRenderer();
-            }
+            applyToRenderer();
         }
 
     private:
+        // RGB565 stops and light of one point of the day; daylight scales
+        // between the night and base intensities, the direction is in
+        // 1/32767 units.
+        struct SkyKeyframe
+        {
+            uint16_t top;
+            uint16_t horizon;
+            uint16_t ground;
+            uint16_t sunColor;
+            int16_t sunDir[3];
+            uint16_t daylight;
+        };
+
         struct SkyState
         {
             Color top;
@@ -127,7 +142,7 @@ namespace pip3D
             Color ground;
             Color sunColor;
             Vector3 sunDir;
-            float intensity;
+            float daylight;
         };
 
         Renderer *renderer;
@@ -136,10 +151,45 @@ namespace pip3D
         float baseIntensity;
         float nightIntensity;
         bool autoAdvance;
-        SkyState cachedState;
-        float pendingTime01;
-        bool cachedValid;
-        bool jobInProgress;
+        SkyKeyframe *keyframes;
+        uint16_t keyframeCount;
+        int32_t appliedKeyframe;
+
+        void bake(uint16_t count)
+        {
+            if (count < 4)
+                count = 4;
+            if (keyframes && count == keyframeCount)
+                return;
+
+            MemUtils::freeData(keyframes);
+            keyframes = static_cast<SkyKeyframe *>(MemUtils::allocData(sizeof(SkyKeyframe) * count, 16, ::pip3D::Debug::LOG_MODULE_SCENE));
+            keyframeCount = count;
+            appliedKeyframe = -1;
+            if (!keyframes)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "TimeOfDayController: keyframe table alloc failed (%u entries)",
+                     static_cast<unsigned int>(count));
+                return;
+            }
+
+            const float invCount = 1.0f / count;
+            for (uint16_t i = 0; i < count; ++i)
+            {
+                SkyState state;
+                computeSkyState(i * invCount, state);
+                SkyKeyframe &k = keyframes[i];
+                k.top = state.top.rgb565;
+                k.horizon = state.horizon.rgb565;
+                k.ground = state.ground.rgb565;
+                k.sunColor = state.sunColor.rgb565;
+                k.sunDir[0] = static_cast<int16_t>(lroundf(state.sunDir.x * 32767.0f));
+                k.sunDir[1] = static_cast<int16_t>(lroundf(state.sunDir.y * 32767.0f));
+                k.sunDir[2] = static_cast<int16_t>(lroundf(state.sunDir.z * 32767.0f));
+                k.daylight = static_cast<uint16_t>(lroundf(state.daylight * 65535.0f));
+            }
+        }
 
         void computeSkyState(float t, SkyState &out) const
         {
@@ -218,8 +268,6 @@ namespace pip3D
             float dayFactor = elevation > 0.0f ? elevation : 0.0f;
             dayFactor = clamp(dayFactor, 0.0f, 1.0f);
 
-            float intensity = nightIntensity + (baseIntensity - nightIntensity) * dayFactor;
-
             float azimuth = t * TWO_PI;
             float sunX = cosf(azimuth) * 0.6f;
             float sunZ = sinf(azimuth) * 0.6f;
@@ -233,45 +281,32 @@ namespace pip3D
             out.ground = ground;
             out.sunColor = sunColor;
             out.sunDir = sunDir;
-            out.intensity = intensity;
+            out.daylight = dayFactor;
         }
 
-        void applySkyStateToRenderer(const SkyState &state)
+        __attribute__((hot)) void applyToRenderer()
         {
             if (!renderer)
                 return;
+            if (!keyframes)
+                bake(keyframeCount);
+            if (!keyframes)
+                return;
 
-            Skybox &sky = renderer->getSkybox();
-            sky.setCustom(state.top, state.horizon, state.ground);
-            renderer->setMainDirectionalLight(state.sunDir, state.sunColor, state.intensity);
-        }
-
-        static void skyJobFunc(void *userData)
-        {
-            TimeOfDayController *self = static_cast<TimeOfDayController *>(userData);
-            if (self)
-                self->runSkyJob();
-        }
-
-        void runSkyJob()
-        {
-            SkyState local;
-            float t = pendingTime01;
-            computeSkyState(t, local);
-            cachedState = local;
-            cachedValid = true;
-            jobInProgress = false;
-        }
-
-        __attribute__((hot)) void applyToRenderer()
-        {
-            if (!renderer)
+            int32_t index = static_cast<int32_t>(timeMinutes * (keyframeCount / 1440.0f));
+            if (index >= keyframeCount)
+                index = keyframeCount - 1;
+            if (index == appliedKeyframe)
                 return;
+            appliedKeyframe = index;
+
+            const SkyKeyframe &k = keyframes[index];
+            renderer->setSkyboxColors(Color(k.top), Color(k.horizon), Color(k.ground));
 
-            float t = timeMinutes / 1440.0f;
-            SkyState state;
-            computeSkyState(t, state);
-            applySkyStateToRenderer(state);
+            const float invDir = 1.0f / 32767.0f;
+            const Vector3 sunDir(k.sunDir[0] * invDir, k.sunDir[1] * invDir, k.sunDir[2] * invDir);
+            const float intensity = nightIntensity + (baseIntensity - nightIntensity) * (k.daylight * (1.0f / 65535.0f));
+            renderer->setMainDirectionalLight(sunDir, Color(k.sunColor), intensity);
         }
     };
 
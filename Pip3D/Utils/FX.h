@@ -2,31 +2,31 @@
 #define FX_H
 
 #include "../Core/Core.h"
+#include "../Core/FixedPool.h"
 #include "../Core/Debug/Logging.h"
 #include "../Math/Math.h"
 #include "../Rendering/Renderer.h"
 #include <vector>
+#include <algorithm>
+#include <string.h>
+
+#ifndef PIP3D_FX_MAX_EMITTERS
+#define PIP3D_FX_MAX_EMITTERS 16
+#endif
 
 namespace pip3D
 {
 
-    struct Particle
+    // Screen-space particle disc produced by the projection pass.
+    struct ParticleSplat
     {
-        Vector3 position;
-        Vector3 velocity;
-        float lifetime;
-        float age;
-        Color startColor;
-        Color endColor;
-        float startSize;
-        float endSize;
-        bool alive;
-
-        Particle()
-            : position(0, 0, 0), velocity(0, 0, 0), lifetime(1.0f), age(0.0f),
-              startColor(Color::WHITE), endColor(Color::WHITE),
-              startSize(4.0f), endSize(0.0f),
-              alive(false) {}
+        float depth;
+        int16_t cx;
+        int16_t cy;
+        int16_t radius;
+        uint16_t color;
+        uint8_t alpha;
+        bool additive;
     };
 
     struct ParticleEmitterConfig
@@ -56,24 +56,188 @@ namespace pip3D
               looping(true), additive(false) {}
     };
 
+    // Rasterizes splats into the current band of the framebuffer.
+    class ParticleSplatter
+    {
+    public:
+        // Far to near, so alpha-blended splats composite correctly; additive
+        // splats are order independent.
+        static void sortBackToFront(std::vector<ParticleSplat> &splats)
+        {
+            std::sort(splats.begin(), splats.end(),
+                      [](const ParticleSplat &a, const ParticleSplat &b)
+                      { return a.depth > b.depth; });
+        }
+
+        static void draw(const std::vector<ParticleSplat> &splats, Renderer &renderer)
+        {
+            if (splats.empty())
+                return;
+
+            uint16_t *fb = renderer.getFrameBuffer();
+            if (!fb)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
+                     "ParticleSplatter::draw: framebuffer is null");
+                return;
+            }
+
+            const Viewport &vp = renderer.getViewport();
+            const int width = vp.width;
+            const int bandTop = currentBandOffsetY();
+            const int rowMin = bandTop > 0 ? bandTop : 0;
+            int rowMax = bandTop + currentBandHeight() - 1;
+            if (rowMax > vp.height - 1)
+                rowMax = vp.height - 1;
+
+            for (size_t i = 0; i < splats.size(); ++i)
+            {
+                const ParticleSplat &s = splats[i];
+                const int y0 = s.cy - s.radius > rowMin ? s.cy - s.radius : rowMin;
+                const int y1 = s.cy + s.radius < rowMax ? s.cy + s.radius : rowMax;
+                if (y0 > y1)
+                    continue;
+                drawSplat(s, fb, width, bandTop, y0, y1);
+            }
+        }
+
+    private:
+        static void drawSplat(const ParticleSplat &s, uint16_t *fb, int width, int bandTop, int y0, int y1)
+        {
+            const int r2 = s.radius * s.radius;
+            // Falloff alpha * (1 - d^2 / r^2) in 16.16 fixed point.
+            const int32_t alphaFix = static_cast<int32_t>(s.alpha) << 16;
+            const int32_t alphaPerDist2 = alphaFix / r2;
+
+            const uint32_t src = s.color;
+            const uint32_t rSrc = (src >> 11) & 0x1F;
+            const uint32_t gSrc = (src >> 5) & 0x3F;
+            const uint32_t bSrc = src & 0x1F;
+            const uint32_t rbSrc = src & 0xF81Fu;
+            const uint32_t gBlendSrc = src & 0x07E0u;
+
+            for (int y = y0; y <= y1; ++y)
+            {
+                const int dy = y - s.cy;
+                const int dy2 = dy * dy;
+                const int span = static_cast<int>(sqrtf(static_cast<float>(r2 - dy2)));
+                int x0 = s.cx - span;
+                int x1 = s.cx + span;
+                if (x0 < 0)
+                    x0 = 0;
+                if (x1 > width - 1)
+                    x1 = width - 1;
+                if (x0 > x1)
+                    continue;
+
+                uint16_t *row = fb + static_cast<size_t>(y - bandTop) * width;
+                int dx = x0 - s.cx;
+                int32_t dist2 = dx * dx + dy2;
+
+                for (int x = x0; x <= x1; ++x)
+                {
+                    const int32_t aFix = alphaFix - dist2 * alphaPerDist2;
+                    dist2 += 2 * dx + 1;
+                    ++dx;
+
+                    const uint32_t a = aFix > 0 ? static_cast<uint32_t>(aFix >> 16) : 0u;
+                    if (a == 0)
+                        continue;
+
+                    const uint32_t dst = PixelFormat::decode(row[x]);
+                    if (s.additive)
+                    {
+                        uint32_t r = ((dst >> 11) & 0x1F) + ((rSrc * a) >> 8);
+                        uint32_t g = ((dst >> 5) & 0x3F) + ((gSrc * a) >> 8);
+                        uint32_t b = (dst & 0x1F) + ((bSrc * a) >> 8);
+                        if (r > 31u)
+                            r = 31u;
+                        if (g > 63u)
+                            g = 63u;
+                        if (b > 31u)
+                            b = 31u;
+                        row[x] = PixelFormat::encode(static_cast<uint16_t>((r << 11) | (g << 5) | b));
+                    }
+                    else
+                    {
+                        const uint32_t ia = 255u - a;
+                        const uint32_t rb = (((dst & 0xF81Fu) * ia + rbSrc * a) >> 8) & 0xF81Fu;
+                        const uint32_t g = (((dst & 0x07E0u) * ia + gBlendSrc * a) >> 8) & 0x07E0u;
+                        row[x] = PixelFormat::encode(static_cast<uint16_t>(rb | g));
+                    }
+                }
+            }
+        }
+    };
+
+    // Particles live in a structure-of-arrays pool; [0, liveCount) is dense,
+    // dead particles are swap-removed so every pass touches live data only.
+    // The pool is sized once from maxParticles, in internal RAM if it fits.
     class ParticleEmitter
     {
     private:
         Vector3 position;
         Vector3 velocityOffset;
         ParticleEmitterConfig config;
-        std::vector<Particle> particles;
         float emitAccumulator;
         bool enabled;
 
+        float *pool;
+        float *posX;
+        float *posY;
+        float *posZ;
+        float *velX;
+        float *velY;
+        float *velZ;
+        float *age;
+        float *lifetime;
+        uint16_t capacity;
+        uint16_t liveCount;
+
+        // Bumped on every state change so cached splats can be reused
+        // by every band of a frame.
+        uint32_t revision;
+
+        mutable std::vector<ParticleSplat> splats;
+        mutable Matrix4x4 splatViewProj;
+        mutable uint32_t splatRevision;
+
     public:
         ParticleEmitter(const ParticleEmitterConfig &cfg, const Vector3 &pos = Vector3())
             : position(pos), velocityOffset(0, 0, 0), config(cfg),
-              emitAccumulator(0.0f), enabled(true)
+              emitAccumulator(0.0f), enabled(true),
+              capacity(cfg.maxParticles), liveCount(0),
+              revision(1), splatRevision(0)
+        {
+            pool = static_cast<float *>(MemUtils::allocFast(static_cast<size_t>(capacity) * 8 * sizeof(float), 16,
+                                                            ::pip3D::Debug::LOG_MODULE_SCENE));
+            if (!pool)
+            {
+                LOGE(::pip3D::Debug::LOG_MODULE_SCENE,
+                     "ParticleEmitter: could not allocate %u particles",
+                     static_cast<unsigned int>(capacity));
+                capacity = 0;
+            }
+            float *base = pool;
+            posX = base;
+            posY = base + capacity;
+            posZ = base + capacity * 2;
+            velX = base + capacity * 3;
+            velY = base + capacity * 4;
+            velZ = base + capacity * 5;
+            age = base + capacity * 6;
+            lifetime = base + capacity * 7;
+            splats.reserve(capacity);
+        }
+
+        ~ParticleEmitter()
         {
-            particles.resize(config.maxParticles);
+            MemUtils::freeData(pool);
         }
 
+        ParticleEmitter(const ParticleEmitter &) = delete;
+        ParticleEmitter &operator=(const ParticleEmitter &) = delete;
+
         void setPosition(const Vector3 &pos) { position = pos; }
         const Vector3 &getPosition() const { return position; }
 
@@ -82,6 +246,10 @@ namespace pip3D
         void setEnabled(bool e) { enabled = e; }
         bool isEnabled() const { return enabled; }
 
+        uint16_t getLiveCount() const { return liveCount; }
+        uint16_t getCapacity() const { return capacity; }
+        uint32_t getRevision() const { return revision; }
+
         void triggerBurst(int count)
         {
             if (count <= 0)
@@ -116,287 +284,156 @@ namespace pip3D
                 }
             }
 
-            for (size_t i = 0; i < particles.size(); ++i)
-            {
-                Particle &p = particles[i];
-                if (!p.alive)
-                    continue;
+            if (liveCount == 0)
+                return;
 
-                p.age += dt;
-                if (p.age >= p.lifetime)
-                {
-                    p.alive = false;
-                    continue;
-                }
+            ++revision;
 
-                p.velocity += config.acceleration * dt;
-                p.position += p.velocity * dt;
-            }
-        }
+            for (uint16_t i = 0; i < liveCount; ++i)
+                age[i] += dt;
 
-        void render(Renderer &renderer) const
-        {
-            const Viewport &vp = renderer.getViewport();
-            const int16_t width = vp.width;
-            const int16_t height = vp.height;
-
-#if PIP3D_TILED_RENDERING
-            // В тайловом режиме рисуем частицы в текущий тайл через tileColorBuffer.
-            // Предполагается, что beginTileRender уже вызван, tileActive=true.
-            if (!renderer.isTileActive() || !renderer.getTileColorBuffer())
+            for (uint16_t i = 0; i < liveCount;)
             {
-                return;
+                if (age[i] >= lifetime[i])
+                    kill(i);
+                else
+                    ++i;
             }
 
-            uint16_t *tileBuffer = renderer.getTileColorBuffer();
-            int16_t tileX = renderer.getCurrentTileX();
-            int16_t tileY = renderer.getCurrentTileY();
-            int16_t tileW = renderer.getCurrentTileW();
-            int16_t tileH = renderer.getCurrentTileH();
-
-            for (size_t i = 0; i < particles.size(); ++i)
+            const uint16_t n = liveCount;
+            const float ax = config.acceleration.x * dt;
+            const float ay = config.acceleration.y * dt;
+            const float az = config.acceleration.z * dt;
+            for (uint16_t i = 0; i < n; ++i)
             {
-                const Particle &p = particles[i];
-                if (!p.alive)
-                    continue;
-
-                float t = p.age / p.lifetime;
-                if (t < 0.0f)
-                    t = 0.0f;
-                if (t > 1.0f)
-                    t = 1.0f;
-
-                uint8_t alpha = (uint8_t)((1.0f - t) * 255.0f);
-                if (alpha == 0)
-                    continue;
-
-                Color col = p.startColor.blend(p.endColor, (uint8_t)(t * 255.0f));
-                float size = p.startSize + (p.endSize - p.startSize) * t;
-                if (size <= 0.25f)
-                    size = 0.25f;
-
-                Vector3 screen = renderer.project(p.position);
-                if (screen.z <= 0.0f)
-                    continue;
-
-                int cx = (int)screen.x;
-                int cy = (int)screen.y;
-                int radius = (int)size;
-                if (radius <= 0)
-                    radius = 1;
-
-                int r2 = radius * radius;
-
-                int y0 = clamp(cy - radius, 0, (int)height - 1);
-                int y1 = clamp(cy + radius, 0, (int)height - 1);
-
-                // Ограничиваем по текущему тайлу
-                if (y1 < tileY || y0 >= tileY + tileH)
-                    continue;
-
-                for (int y = y0; y <= y1; ++y)
-                {
-                    if (y < tileY || y >= tileY + tileH)
-                        continue;
-
-                    int dy = y - cy;
-                    int dy2 = dy * dy;
-
-                    int x0 = clamp(cx - radius, 0, (int)width - 1);
-                    int x1 = clamp(cx + radius, 0, (int)width - 1);
-
-                    if (x1 < tileX || x0 >= tileX + tileW)
-                        continue;
-
-                    for (int x = x0; x <= x1; ++x)
-                    {
-                        if (x < tileX || x >= tileX + tileW)
-                            continue;
-
-                        int dx = x - cx;
-                        int dist2 = dx * dx + dy2;
-                        if (dist2 > r2)
-                            continue;
-
-                        float k = 1.0f - (float)dist2 / (float)r2;
-                        uint8_t a = (uint8_t)(alpha * k);
-                        if (a == 0)
-                            continue;
-
-                        int localX = x - tileX;
-                        int localY = y - tileY;
-                        size_t idx = (size_t)localY * (size_t)tileW + (size_t)localX;
-
-                        if (config.additive)
-                        {
-                            const uint16_t dst = tileBuffer[idx];
-                            const uint16_t src = col.rgb565;
-
-                            uint32_t rDst = (dst >> 11) & 0x1F;
-                            uint32_t gDst = (dst >> 5) & 0x3F;
-                            uint32_t bDst = dst & 0x1F;
-
-                            const uint32_t rSrc = (src >> 11) & 0x1F;
-                            const uint32_t gSrc = (src >> 5) & 0x3F;
-                            const uint32_t bSrc = src & 0x1F;
-
-                            rDst += (rSrc * a) >> 8;
-                            gDst += (gSrc * a) >> 8;
-                            bDst += (bSrc * a) >> 8;
-
-                            if (rDst > 31u)
-                                rDst = 31u;
-                            if (gDst > 63u)
-                                gDst = 63u;
-                            if (bDst > 31u)
-                                bDst = 31u;
-
-                            tileBuffer[idx] = (uint16_t)((rDst << 11) | (gDst << 5) | bDst);
-                        }
-                        else
-                        {
-                            Color base(tileBuffer[idx]);
-                            Color blended = base.blend(col, a);
-                            tileBuffer[idx] = blended.rgb565;
-                        }
-                    }
-                }
+                velX[i] += ax;
+                velY[i] += ay;
+                velZ[i] += az;
             }
-#else
-            uint16_t *fb = renderer.getFrameBuffer();
-            if (!fb)
+            for (uint16_t i = 0; i < n; ++i)
             {
-                LOGE(::pip3D::Debug::LOG_MODULE_RENDER,
-                     "ParticleEmitter::render: framebuffer is null");
-                return;
+                posX[i] += velX[i] * dt;
+                posY[i] += velY[i] * dt;
+                posZ[i] += velZ[i] * dt;
             }
+        }
 
-            for (size_t i = 0; i < particles.size(); ++i)
-            {
-                const Particle &p = particles[i];
-                if (!p.alive)
-                    continue;
+        // Projection pass: appends one splat per visible live particle.
+        void appendSplats(const Matrix4x4 &viewProj, const Viewport &vp, std::vector<ParticleSplat> &out) const
+        {
+            const float *m = viewProj.m;
+            const float halfW = vp.width * 0.5f;
+            const float halfH = vp.height * 0.5f;
+            const float sizeDelta = config.endSize - config.startSize;
 
-                float t = p.age / p.lifetime;
+            for (uint16_t i = 0; i < liveCount; ++i)
+            {
+                float t = age[i] / lifetime[i];
                 if (t < 0.0f)
                     t = 0.0f;
                 if (t > 1.0f)
                     t = 1.0f;
 
-                uint8_t alpha = (uint8_t)((1.0f - t) * 255.0f);
+                const uint8_t alpha = (uint8_t)((1.0f - t) * 255.0f);
                 if (alpha == 0)
                     continue;
 
-                Color col = p.startColor.blend(p.endColor, (uint8_t)(t * 255.0f));
-                float size = p.startSize + (p.endSize - p.startSize) * t;
-                if (size <= 0.25f)
-                    size = 0.25f;
-
-                Vector3 screen = renderer.project(p.position);
-                if (screen.z <= 0.0f)
+                const float x = posX[i];
+                const float y = posY[i];
+                const float z = posZ[i];
+                const float w = m[3] * x + m[7] * y + m[11] * z + m[15];
+                if (w <= 1e-6f)
                     continue;
+                const float invW = 1.0f / w;
+                const float sz = (m[2] * x + m[6] * y + m[10] * z + m[14]) * invW;
+                if (sz <= 0.0f)
+                    continue;
+                const float sx = ((m[0] * x + m[4] * y + m[8] * z + m[12]) * invW + 1.0f) * halfW + vp.x;
+                const float sy = (1.0f - (m[1] * x + m[5] * y + m[9] * z + m[13]) * invW) * halfH + vp.y;
 
-                int cx = (int)screen.x;
-                int cy = (int)screen.y;
+                float size = config.startSize + sizeDelta * t;
+                if (size <= 0.25f)
+                    size = 0.25f;
                 int radius = (int)size;
                 if (radius <= 0)
                     radius = 1;
 
-                int r2 = radius * radius;
+                const int cx = (int)sx;
+                const int cy = (int)sy;
+                if (cx + radius < 0 || cx - radius >= vp.width ||
+                    cy + radius < 0 || cy - radius >= vp.height)
+                    continue;
 
-                int y0 = clamp(cy - radius, 0, (int)height - 1);
-                int y1 = clamp(cy + radius, 0, (int)height - 1);
+                ParticleSplat s;
+                s.depth = sz;
+                s.cx = (int16_t)cx;
+                s.cy = (int16_t)cy;
+                s.radius = (int16_t)radius;
+                s.color = config.startColor.blend(config.endColor, (uint8_t)(t * 255.0f)).rgb565;
+                s.alpha = alpha;
+                s.additive = config.additive;
+                out.push_back(s);
+            }
+        }
 
-                for (int y = y0; y <= y1; ++y)
-                {
-                    int dy = y - cy;
-                    int dy2 = dy * dy;
-                    int x0 = clamp(cx - radius, 0, (int)width - 1);
-                    int x1 = clamp(cx + radius, 0, (int)width - 1);
-                    size_t idx = (size_t)y * width + x0;
-                    for (int x = x0; x <= x1; ++x, ++idx)
-                    {
-                        int dx = x - cx;
-                        int dist2 = dx * dx + dy2;
-                        if (dist2 > r2)
-                            continue;
-                        float k = 1.0f - (float)dist2 / (float)r2;
-                        uint8_t a = (uint8_t)(alpha * k);
-                        if (a == 0)
-                            continue;
-
-                        if (config.additive)
-                        {
-                            const uint16_t dst = fb[idx];
-                            const uint16_t src = col.rgb565;
-
-                            uint32_t rDst = (dst >> 11) & 0x1F;
-                            uint32_t gDst = (dst >> 5) & 0x3F;
-                            uint32_t bDst = dst & 0x1F;
-
-                            const uint32_t rSrc = (src >> 11) & 0x1F;
-                            const uint32_t gSrc = (src >> 5) & 0x3F;
-                            const uint32_t bSrc = src & 0x1F;
-
-                            rDst += (rSrc * a) >> 8;
-                            gDst += (gSrc * a) >> 8;
-                            bDst += (bSrc * a) >> 8;
-
-                            if (rDst > 31u)
-                                rDst = 31u;
-                            if (gDst > 63u)
-                                gDst = 63u;
-                            if (bDst > 31u)
-                                bDst = 31u;
-
-                            fb[idx] = (uint16_t)((rDst << 11) | (gDst << 5) | bDst);
-                        }
-                        else
-                        {
-                            Color base(fb[idx]);
-                            Color blended = base.blend(col, a);
-                            fb[idx] = blended.rgb565;
-                        }
-                    }
-                }
+        void render(Renderer &renderer) const
+        {
+            const Matrix4x4 &viewProj = renderer.getViewProjMatrix();
+            if (splatRevision != revision || memcmp(splatViewProj.m, viewProj.m, sizeof(viewProj.m)) != 0)
+            {
+                splats.clear();
+                appendSplats(viewProj, renderer.getViewport(), splats);
+                ParticleSplatter::sortBackToFront(splats);
+                splatViewProj = viewProj;
+                splatRevision = revision;
             }
-#endif
+            ParticleSplatter::draw(splats, renderer);
         }
 
     private:
+        void kill(uint16_t i)
+        {
+            const uint16_t last = --liveCount;
+            posX[i] = posX[last];
+            posY[i] = posY[last];
+            posZ[i] = posZ[last];
+            velX[i] = velX[last];
+            velY[i] = velY[last];
+            velZ[i] = velZ[last];
+            age[i] = age[last];
+            lifetime[i] = lifetime[last];
+        }
+
         void spawnParticle()
         {
-            for (size_t i = 0; i < particles.size(); ++i)
+            if (liveCount >= capacity)
             {
-                Particle &p = particles[i];
-                if (p.alive)
-                    continue;
-
-                float life = randomRange(config.minLifetime, config.maxLifetime);
-                if (life <= 0.0f)
-                    life = 0.1f;
-
-                float rx = random01() - 0.5f;
-                float rz = random01() - 0.5f;
-                Vector3 dir(rx * config.spread, 1.0f, rz * config.spread);
-                dir.normalize();
-                Vector3 vel = dir * config.initialSpeed + velocityOffset;
-
-                p.position = position;
-                p.velocity = vel;
-                p.lifetime = life;
-                p.age = 0.0f;
-                p.startColor = config.startColor;
-                p.endColor = config.endColor;
-                p.startSize = config.startSize;
-                p.endSize = config.endSize;
-                p.alive = true;
+                LOGW(::pip3D::Debug::LOG_MODULE_SCENE,
+                     "ParticleEmitter::spawnParticle: no free particles (maxParticles=%u)",
+                     static_cast<unsigned int>(capacity));
                 return;
             }
 
-            LOGW(::pip3D::Debug::LOG_MODULE_SCENE,
-                 "ParticleEmitter::spawnParticle: no free particles (maxParticles=%u)",
-                 static_cast<unsigned int>(particles.size()));
+            float life = randomRange(config.minLifetime, config.maxLifetime);
+            if (life <= 0.0f)
+                life = 0.1f;
+
+            float rx = random01() - 0.5f;
+            float rz = random01() - 0.5f;
+            Vector3 dir(rx * config.spread, 1.0f, rz * config.spread);
+            dir.normalize();
+            Vector3 vel = dir * config.initialSpeed + velocityOffset;
+
+            const uint16_t i = liveCount++;
+            posX[i] = position.x;
+            posY[i] = position.y;
+            posZ[i] = position.z;
+            velX[i] = vel.x;
+            velY[i] = vel.y;
+            velZ[i] = vel.z;
+            age[i] = 0.0f;
+            lifetime[i] = life;
+            ++revision;
         }
 
         static float random01()
@@ -411,13 +448,34 @@ namespace pip3D
         }
     };
 
+    // Emitters come from a fixed pool of PIP3D_FX_MAX_EMITTERS, set up by
+    // the first createEmitter(); creating and destroying them afterwards
+    // does not touch the heap.
     class FXSystem
     {
     private:
+        FixedPool<ParticleEmitter> emitterPool;
         std::vector<ParticleEmitter *> emitters;
 
+        // Splats of all emitters, sorted together and reused by every band
+        // until an emitter or the camera changes.
+        mutable std::vector<ParticleSplat> splats;
+        mutable Matrix4x4 splatViewProj;
+        mutable uint32_t splatKey;
+        mutable bool splatsValid;
+
+        uint32_t stateKey() const
+        {
+            uint32_t key = static_cast<uint32_t>(emitters.size());
+            for (size_t i = 0; i < emitters.size(); ++i)
+            {
+                key = key * 31u + emitters[i]->getRevision();
+            }
+            return key;
+        }
+
     public:
-        FXSystem() {}
+        FXSystem() : splatKey(0), splatsValid(false) {}
 
         FXSystem(const FXSystem &) = delete;
         FXSystem &operator=(const FXSystem &) = delete;
@@ -431,8 +489,27 @@ namespace pip3D
 
         ParticleEmitter *createEmitter(const ParticleEmitterConfig &cfg, const Vector3 &pos = Vector3())
         {
-            ParticleEmitter *e = new ParticleEmitter(cfg, pos);
+            if (emitterPool.getCapacity() == 0)
+            {
+                if (!emitterPool.init(PIP3D_FX_MAX_EMITTERS, MEM_INTERNAL_FIRST, ::pip3D::Debug::LOG_MODULE_SCENE))
+                    return nullptr;
+                emitters.reserve(PIP3D_FX_MAX_EMITTERS);
+            }
+
+            ParticleEmitter *e = emitterPool.acquire(cfg, pos);
+            if (!e)
+            {
+                LOGW(::pip3D::Debug::LOG_MODULE_SCENE,
+                     "FXSystem::createEmitter: all %u emitters in use",
+                     static_cast<unsigned int>(PIP3D_FX_MAX_EMITTERS));
+                return nullptr;
+            }
             emitters.push_back(e);
+
+            size_t particles = 0;
+            for (size_t i = 0; i < emitters.size(); ++i)
+                particles += emitters[i]->getCapacity();
+            splats.reserve(particles);
             return e;
         }
 
@@ -448,9 +525,10 @@ namespace pip3D
             {
                 if (emitters[i] == emitter)
                 {
-                    delete emitters[i];
+                    emitterPool.destroy(emitters[i]);
                     emitters[i] = emitters.back();
                     emitters.pop_back();
+                    splatsValid = false;
                     return;
                 }
             }
@@ -464,9 +542,11 @@ namespace pip3D
         {
             for (size_t i = 0; i < emitters.size(); ++i)
             {
-                delete emitters[i];
+                emitterPool.destroy(emitters[i]);
             }
             emitters.clear();
+            splats.clear();
+            splatsValid = false;
         }
 
         void update(float dt)
@@ -479,10 +559,22 @@ namespace pip3D
 
         void render(Renderer &renderer) const
         {
-            for (size_t i = 0; i < emitters.size(); ++i)
+            const Matrix4x4 &viewProj = renderer.getViewProjMatrix();
+            const uint32_t key = stateKey();
+            if (!splatsValid || splatKey != key ||
+                memcmp(splatViewProj.m, viewProj.m, sizeof(viewProj.m)) != 0)
             {
-                emitters[i]->render(renderer);
+                splats.clear();
+                for (size_t i = 0; i < emitters.size(); ++i)
+                {
+                    emitters[i]->appendSplats(viewProj, renderer.getViewport(), splats);
+                }
+                ParticleSplatter::sortBackToFront(splats);
+                splatViewProj = viewProj;
+                splatKey = key;
+                splatsValid = true;
             }
+            ParticleSplatter::draw(splats, renderer);
         }
 
         ParticleEmitter *createFire(const Vector3 &pos)
@@ -541,7 +633,8 @@ namespace pip3D
             cfg.additive = true;
 
             ParticleEmitter *e = createEmitter(cfg, pos);
-            e->triggerBurst(cfg.maxParticles);
+            if (e)
+                e->triggerBurst(cfg.maxParticles);
             return e;
         }
 
@@ -563,7 +656,8 @@ namespace pip3D
             cfg.additive = true;
 
             ParticleEmitter *e = createEmitter(cfg, pos);
-            e->triggerBurst(cfg.maxParticles / 2);
+            if (e)
+                e->triggerBurst(cfg.maxParticles / 2);
             return e;
         }
 
@@ -0,0 +1,588 @@
+// PIP3D benchmark: fixed, seeded scenes rendered for a fixed number of
+// frames with a fixed simulation step, so runs are comparable between
+// engine revisions and devices. Results go to Serial as a readable report
+// followed by one CSV line per scene.
+//
+// Resolution and band count are build-time settings; the height must be
+// divisible by the band count. Triangles and instances are counted per
+// band they are submitted to, pixels are unique depth-buffer coverage.
+
+#ifndef PIP3D_SCREEN_BAND_COUNT
+#define PIP3D_SCREEN_BAND_COUNT 2
+#endif
+
+#include <Pip3D/Pip3D.h>
+#include <algorithm>
+
+using namespace pip3D;
+
+#ifndef BENCH_WIDTH
+#define BENCH_WIDTH 480
+#endif
+
+#ifndef BENCH_HEIGHT
+#define BENCH_HEIGHT 320
+#endif
+
+#ifndef BENCH_PIN_CS
+#define BENCH_PIN_CS 10
+#endif
+
+#ifndef BENCH_PIN_DC
+#define BENCH_PIN_DC 9
+#endif
+
+#ifndef BENCH_PIN_RST
+#define BENCH_PIN_RST 8
+#endif
+
+#ifndef BENCH_WARMUP_FRAMES
+#define BENCH_WARMUP_FRAMES 30
+#endif
+
+#ifndef BENCH_MEASURE_FRAMES
+#define BENCH_MEASURE_FRAMES 240
+#endif
+
+#ifndef BENCH_INSTANCES
+#define BENCH_INSTANCES 16
+#endif
+
+#ifndef BENCH_SEED
+#define BENCH_SEED 12345
+#endif
+
+// The display is the panel; scaled or interlaced modes render less and
+// stretch it on the way out.
+static_assert(BENCH_WIDTH <= PANEL_WIDTH && BENCH_HEIGHT <= PANEL_HEIGHT,
+              "benchmark resolution exceeds the engine's panel size");
+static_assert(BENCH_HEIGHT % PIP3D_SCREEN_BAND_COUNT == 0,
+              "BENCH_HEIGHT must be divisible by PIP3D_SCREEN_BAND_COUNT");
+
+static constexpr float BENCH_DT = 1.0f / 30.0f;
+
+struct BenchScene
+{
+    const char *name;
+    void (*setup)(Renderer &r);
+    void (*update)(float t, float dt);
+    void (*draw)(Renderer &r, float t);
+    void (*teardown)(Renderer &r);
+};
+
+struct BenchResult
+{
+    uint32_t p50;
+    uint32_t p95;
+    uint32_t p99;
+    uint32_t totalMicros;
+    uint64_t triangles;
+    uint64_t pixels;
+    uint32_t instances;
+    uint32_t frustumCulled;
+    uint32_t occlusionCulled;
+};
+
+static uint32_t frameTimes[BENCH_MEASURE_FRAMES];
+
+// ---------------------------------------------------------------------------
+// Scene state
+
+static Mesh *meshA = nullptr;
+static Plane *ground = nullptr;
+static MeshInstance instances[BENCH_INSTANCES];
+
+static PhysicsWorld *world = nullptr;
+static RigidBody *floorBody = nullptr;
+static RigidBody *stack[12];
+static MeshInstance stackInstances[12];
+
+static Rope rope;
+static RigidBody *ropeBall = nullptr;
+static MeshInstance ropeBallInstance;
+
+static RopeSystem *bridge = nullptr;
+
+static FXSystem *fx = nullptr;
+
+static Texture *checker = nullptr;
+static Texture *stripes = nullptr;
+
+static Color paletteColor(int i)
+{
+    static const Color palette[] = {
+        Color::fromRGB888(230, 90, 80), Color::fromRGB888(240, 180, 70),
+        Color::fromRGB888(110, 200, 90), Color::fromRGB888(70, 170, 220),
+        Color::fromRGB888(150, 110, 230), Color::fromRGB888(220, 220, 220)};
+    return palette[i % (sizeof(palette) / sizeof(palette[0]))];
+}
+
+static void placeCamera(Renderer &r, const Vector3 &pos, const Vector3 &target)
+{
+    Camera &cam = r.getCamera();
+    cam.position = pos;
+    cam.lookAt(target);
+    cam.markDirty();
+}
+
+static void layoutGrid(Mesh *mesh, float spacing)
+{
+    const int side = static_cast<int>(ceilf(sqrtf(static_cast<float>(BENCH_INSTANCES))));
+    for (int i = 0; i < BENCH_INSTANCES; ++i)
+    {
+        const float x = (i % side - (side - 1) * 0.5f) * spacing;
+        const float z = (i / side - (side - 1) * 0.5f) * spacing;
+        instances[i].reset(mesh);
+        instances[i].setPosition(x, 0.0f, z);
+        instances[i].setColor(paletteColor(i));
+    }
+}
+
+static void spinGrid(float t)
+{
+    for (int i = 0; i < BENCH_INSTANCES; ++i)
+        instances[i].setRotation(Quaternion::fromEuler(0.0f, t + i * 0.4f, 0.0f));
+}
+
+static void drawGrid(Renderer &r, float)
+{
+    for (int i = 0; i < BENCH_INSTANCES; ++i)
+        r.drawMeshInstance(&instances[i]);
+}
+
+static void freeMeshes()
+{
+    delete meshA;
+    delete ground;
+    meshA = nullptr;
+    ground = nullptr;
+}
+
+// Teapot grid.
+
+static void teapotSetup(Renderer &r)
+{
+    meshA = new Teapot(0.6f);
+    layoutGrid(meshA, 2.2f);
+    placeCamera(r, Vector3(0.0f, 4.0f, 9.0f), Vector3(0.0f, 0.0f, 0.0f));
+}
+
+static void teapotUpdate(float t, float)
+{
+    spinGrid(t);
+}
+
+static void meshTeardown(Renderer &)
+{
+    freeMeshes();
+}
+
+// Sphere grid.
+
+static void sphereSetup(Renderer &r)
+{
+    meshA = new Sphere(0.7f, 16, 12);
+    layoutGrid(meshA, 2.0f);
+    placeCamera(r, Vector3(0.0f, 4.0f, 9.0f), Vector3(0.0f, 0.0f, 0.0f));
+}
+
+// Physics box stack.
+
+static void stackSetup(Renderer &r)
+{
+    meshA = new Cube(1.0f);
+    ground = new Plane(12.0f, 12.0f, 1, Color::fromRGB888(90, 90, 90));
+
+    world = new PhysicsWorld();
+    // Stepped inline so every run simulates the same frames and poses
+    // are never read mid-step.
+    world->setAsyncEnabled(false);
+    floorBody = new RigidBody(Vector3(0.0f, -0.5f, 0.0f), Vector3(20.0f, 1.0f, 20.0f), 0.0f);
+    floorBody->setStatic(true);
+    world->addBody(floorBody);
+
+    for (int i = 0; i < 12; ++i)
+    {
+        const Vector3 pos((i % 3 - 1) * 1.05f, 0.5f + (i / 3) * 1.02f, (i % 2) * 0.1f);
+        stack[i] = new RigidBody(pos, Vector3(1.0f, 1.0f, 1.0f), 1.0f);
+        world->addBody(stack[i]);
+        stackInstances[i].reset(meshA);
+        stackInstances[i].setColor(paletteColor(i));
+    }
+
+    // Knock the stack over so the solver has work to do.
+    stack[11]->velocity = Vector3(-4.0f, 0.0f, 1.0f);
+    placeCamera(r, Vector3(6.0f, 4.0f, 8.0f), Vector3(0.0f, 1.5f, 0.0f));
+}
+
+static void stackUpdate(float, float dt)
+{
+    world->updateFixed(dt);
+    for (int i = 0; i < 12; ++i)
+    {
+        stackInstances[i].setPosition(stack[i]->position);
+        stackInstances[i].setRotation(stack[i]->orientation);
+    }
+}
+
+static void stackDraw(Renderer &r, float)
+{
+    r.drawMesh(ground);
+    for (int i = 0; i < 12; ++i)
+        r.drawMeshInstance(&stackInstances[i]);
+}
+
+static void stackTeardown(Renderer &r)
+{
+    while (world->isStepInProgress())
+        delay(1);
+    for (int i = 0; i < 12; ++i)
+        delete stack[i];
+    delete floorBody;
+    delete world;
+    world = nullptr;
+    floorBody = nullptr;
+    meshTeardown(r);
+}
+
+// Rope with a swinging ball knocking into it.
+
+static void ropeSetup(Renderer &r)
+{
+    meshA = new Sphere(0.5f, 12, 8, Color::fromRGB888(220, 80, 60));
+    ground = new Plane(12.0f, 12.0f, 1, Color::fromRGB888(90, 90, 90));
+
+    rope = Rope();
+    rope.initLinear(Vector3(0.0f, 4.0f, 0.0f), Vector3(3.0f, 4.0f, 0.0f), 40);
+
+    ropeBall = new RigidBody(Vector3(1.5f, 1.5f, 0.0f), Vector3(1.0f, 1.0f, 1.0f), 0.0f);
+    ropeBall->setSphere(0.5f);
+    ropeBall->setStatic(true);
+    ropeBallInstance.reset(meshA);
+    placeCamera(r, Vector3(1.5f, 2.5f, 7.0f), Vector3(1.5f, 2.0f, 0.0f));
+}
+
+static void ropeUpdate(float t, float dt)
+{
+    ropeBall->position = Vector3(1.5f + sinf(t * 1.5f) * 2.0f, 1.5f, sinf(t * 0.7f) * 0.5f);
+    ropeBallInstance.setPosition(ropeBall->position);
+    rope.simulate(dt);
+    rope.resolveCollisions(&ropeBall, 1);
+}
+
+static void ropeDraw(Renderer &r, float)
+{
+    r.drawMesh(ground);
+    r.drawMeshInstance(&ropeBallInstance);
+    rope.renderLines(r, Color::fromRGB888(240, 220, 120).rgb565, 2);
+}
+
+static void ropeTeardown(Renderer &r)
+{
+    delete ropeBall;
+    ropeBall = nullptr;
+    meshTeardown(r);
+}
+
+// Rope bridge: twelve ropes pinned at both ends with a ball rolling over.
+
+static void bridgeSetup(Renderer &r)
+{
+    meshA = new Sphere(0.5f, 12, 8, Color::fromRGB888(220, 80, 60));
+    ground = new Plane(12.0f, 12.0f, 1, Color::fromRGB888(90, 90, 90));
+
+    bridge = new RopeSystem();
+    for (int i = 0; i < 12; ++i)
+    {
+        const float z = -1.1f + i * 0.2f;
+        bridge->addRope(Vector3(-3.0f, 2.5f, z), Vector3(3.0f, 2.5f, z), 40, true, true);
+    }
+
+    ropeBall = new RigidBody(Vector3(-2.5f, 2.5f, 0.0f), Vector3(1.0f, 1.0f, 1.0f), 0.0f);
+    ropeBall->setSphere(0.5f);
+    ropeBall->setStatic(true);
+    ropeBallInstance.reset(meshA);
+    placeCamera(r, Vector3(0.0f, 4.5f, 7.0f), Vector3(0.0f, 2.0f, 0.0f));
+}
+
+static void bridgeUpdate(float t, float dt)
+{
+    ropeBall->position = Vector3(sinf(t * 0.8f) * 2.5f, 2.6f, sinf(t * 0.5f) * 0.6f);
+    ropeBall->updateBoundsFromTransform();
+    ropeBallInstance.setPosition(ropeBall->position);
+    bridge->simulate(dt);
+    bridge->resolveCollisions(&ropeBall, 1);
+}
+
+static void bridgeDraw(Renderer &r, float)
+{
+    r.drawMesh(ground);
+    r.drawMeshInstance(&ropeBallInstance);
+    bridge->renderLines(r, Color::fromRGB888(190, 150, 90).rgb565, 1);
+}
+
+static void bridgeTeardown(Renderer &r)
+{
+    delete bridge;
+    bridge = nullptr;
+    ropeTeardown(r);
+}
+
+// Particle storm: fire and smoke columns spread over the floor.
+
+static void particleSetup(Renderer &r)
+{
+    ground = new Plane(12.0f, 12.0f, 1, Color::fromRGB888(60, 60, 70));
+    fx = new FXSystem();
+    for (int i = 0; i < 6; ++i)
+    {
+        const Vector3 pos((i % 3 - 1) * 2.5f, 0.0f, (i / 3) * 2.5f - 1.25f);
+        fx->createFire(pos);
+        fx->createSmoke(pos + Vector3(0.0f, 0.8f, 0.0f));
+    }
+    placeCamera(r, Vector3(0.0f, 3.0f, 8.0f), Vector3(0.0f, 1.0f, 0.0f));
+}
+
+static void particleUpdate(float, float dt)
+{
+    fx->update(dt);
+}
+
+static void particleDraw(Renderer &r, float)
+{
+    r.drawMesh(ground);
+    fx->render(r);
+}
+
+static void particleTeardown(Renderer &r)
+{
+    delete fx;
+    fx = nullptr;
+    meshTeardown(r);
+}
+
+// Water plane plus shadow-casting teapots.
+
+static void waterSetup(Renderer &r)
+{
+    meshA = new Teapot(0.6f);
+    ground = new Plane(16.0f, 16.0f, 1, Color::fromRGB888(120, 110, 90));
+    ground->setPosition(0.0f, -0.6f, 0.0f);
+    layoutGrid(meshA, 2.2f);
+    r.setShadowsEnabled(true);
+    r.setShadowPlaneY(-0.6f);
+    placeCamera(r, Vector3(0.0f, 4.0f, 9.0f), Vector3(0.0f, 0.0f, 0.0f));
+}
+
+static void waterDraw(Renderer &r, float t)
+{
+    r.drawMesh(ground);
+    for (int i = 0; i < BENCH_INSTANCES; ++i)
+    {
+        r.drawMeshInstanceShadow(&instances[i]);
+        r.drawMeshInstance(&instances[i]);
+    }
+    r.drawWater(-0.2f, 16.0f, Color::fromRGB888(40, 110, 190), 0.55f, t);
+}
+
+static void waterTeardown(Renderer &r)
+{
+    r.setShadowsEnabled(false);
+    meshTeardown(r);
+}
+
+// Textured ground and spheres: an RGB565 checker and a palettized stripe.
+
+static void texturedSetup(Renderer &r)
+{
+    static uint16_t checkerTexels[64 * 64];
+    for (int y = 0; y < 64; ++y)
+        for (int x = 0; x < 64; ++x)
+            checkerTexels[y * 64 + x] = ((x >> 3) ^ (y >> 3)) & 1 ? Color::fromRGB888(230, 220, 200).rgb565
+                                                                  : Color::fromRGB888(60, 90, 140).rgb565;
+    static uint8_t stripeTexels[32 * 32];
+    static uint16_t stripePalette[256];
+    for (int i = 0; i < 256; ++i)
+        stripePalette[i] = paletteColor(i).rgb565;
+    for (int y = 0; y < 32; ++y)
+        for (int x = 0; x < 32; ++x)
+            stripeTexels[y * 32 + x] = static_cast<uint8_t>(((x + y) >> 2) % 6);
+
+    checker = new Texture();
+    stripes = new Texture();
+    checker->create(64, 64, TEXTURE_RGB565, checkerTexels);
+    stripes->create(32, 32, TEXTURE_PAL8, stripeTexels, stripePalette);
+
+    ground = new Plane(16.0f, 16.0f, 8, Color::WHITE);
+    ground->setPosition(0.0f, -0.8f, 0.0f);
+    ground->projectUVs(Vector3(1.0f, 0.0f, 0.0f), Vector3(0.0f, 0.0f, 1.0f), 0.25f);
+    ground->setTexture(checker);
+
+    meshA = new Sphere(0.7f, 16, 12);
+    meshA->projectUVs(Vector3(1.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f), 1.0f);
+    meshA->setTexture(stripes);
+    layoutGrid(meshA, 2.0f);
+    placeCamera(r, Vector3(0.0f, 4.0f, 9.0f), Vector3(0.0f, 0.0f, 0.0f));
+}
+
+static void texturedDraw(Renderer &r, float t)
+{
+    r.drawMesh(ground);
+    drawGrid(r, t);
+}
+
+static void texturedTeardown(Renderer &r)
+{
+    meshTeardown(r);
+    delete checker;
+    delete stripes;
+    checker = nullptr;
+    stripes = nullptr;
+}
+
+static const BenchScene scenes[] = {
+    {"teapots", teapotSetup, teapotUpdate, drawGrid, meshTeardown},
+    {"spheres", sphereSetup, teapotUpdate, drawGrid, meshTeardown},
+    {"box_stack", stackSetup, stackUpdate, stackDraw, stackTeardown},
+    {"rope", ropeSetup, ropeUpdate, ropeDraw, ropeTeardown},
+    {"rope_bridge", bridgeSetup, bridgeUpdate, bridgeDraw, bridgeTeardown},
+    {"particles", particleSetup, particleUpdate, particleDraw, particleTeardown},
+    {"water_shadows", waterSetup, teapotUpdate, waterDraw, waterTeardown},
+    {"textured", texturedSetup, teapotUpdate, texturedDraw, texturedTeardown},
+};
+
+// ---------------------------------------------------------------------------
+// Harness
+
+// Nearest-rank percentile of the sorted frame times.
+static uint32_t percentile(const uint32_t *sorted, int count, int pct)
+{
+    int rank = (pct * count + 99) / 100;
+    if (rank < 1)
+        rank = 1;
+    return sorted[rank - 1];
+}
+
+static BenchResult runScene(Renderer &r, const BenchScene &scene)
+{
+    BenchResult res = {};
+    randomSeed(BENCH_SEED);
+    scene.setup(r);
+
+    float t = 0.0f;
+    for (int frame = 0; frame < BENCH_WARMUP_FRAMES + BENCH_MEASURE_FRAMES; ++frame)
+    {
+        const bool measured = frame >= BENCH_WARMUP_FRAMES;
+#ifdef BENCH_ON_FRAME
+        // Host builds hook in here to capture frames.
+        BENCH_ON_FRAME(r, scene, frame);
+#endif
+        uint32_t countMicros = 0;
+        uint32_t pixels = 0;
+        const uint32_t start = micros();
+
+        scene.update(t, BENCH_DT);
+        for (int band = 0; band < SCREEN_BAND_COUNT; ++band)
+        {
+            r.beginFrameBand(band);
+            scene.draw(r, t);
+            // Band buffers are reused, so every band is filled in full.
+            r.drawSkyboxBackground();
+            if (measured)
+            {
+                // Coverage scan is excluded from the frame time.
+                const uint32_t countStart = micros();
+                pixels += r.countBandCoveredPixels();
+                countMicros += micros() - countStart;
+            }
+            r.endFrameBand(band);
+        }
+
+        const uint32_t elapsed = micros() - start - countMicros;
+        t += BENCH_DT;
+        if (!measured)
+            continue;
+
+        frameTimes[frame - BENCH_WARMUP_FRAMES] = elapsed;
+        res.totalMicros += elapsed;
+        // Renderer stats accumulate over all bands of the frame.
+        res.triangles += r.getStatsTrianglesTotal();
+        res.pixels += pixels;
+        res.instances += r.getStatsInstancesTotal();
+        res.frustumCulled += r.getStatsInstancesFrustumCulled();
+        res.occlusionCulled += r.getStatsInstancesOcclusionCulled();
+    }
+
+#ifdef BENCH_ON_SCENE_END
+    // Host builds hook in here to save or hash the last frame.
+    BENCH_ON_SCENE_END(r, scene);
+#endif
+    scene.teardown(r);
+
+    std::sort(frameTimes, frameTimes + BENCH_MEASURE_FRAMES);
+    res.p50 = percentile(frameTimes, BENCH_MEASURE_FRAMES, 50);
+    res.p95 = percentile(frameTimes, BENCH_MEASURE_FRAMES, 95);
+    res.p99 = percentile(frameTimes, BENCH_MEASURE_FRAMES, 99);
+    return res;
+}
+
+static void report(const BenchScene &scene, const BenchResult &res)
+{
+    const float seconds = res.totalMicros * 1e-6f;
+    const float trisPerSec = seconds > 0.0f ? res.triangles / seconds : 0.0f;
+    const float pixelsPerSec = seconds > 0.0f ? res.pixels / seconds : 0.0f;
+
+    Serial.printf("%-14s p50 %6.2fms  p95 %6.2fms  p99 %6.2fms  %8.0f tri/s  %9.0f px/s\n",
+                  scene.name, res.p50 / 1000.0f, res.p95 / 1000.0f, res.p99 / 1000.0f,
+                  trisPerSec, pixelsPerSec);
+    Serial.printf("%-14s per frame: %.1f instances, %.1f frustum culled, %.1f occlusion culled\n",
+                  "", res.instances / static_cast<float>(BENCH_MEASURE_FRAMES),
+                  res.frustumCulled / static_cast<float>(BENCH_MEASURE_FRAMES),
+                  res.occlusionCulled / static_cast<float>(BENCH_MEASURE_FRAMES));
+}
+
+static void reportCsv(const BenchScene &scene, const BenchResult &res)
+{
+    const float seconds = res.totalMicros * 1e-6f;
+    Serial.printf("BENCH,%s,%s,%dx%d,%d,%lu,%lu,%lu,%.0f,%.0f,%lu,%lu,%lu\n",
+                  getVersion(), scene.name, BENCH_WIDTH, BENCH_HEIGHT, SCREEN_BAND_COUNT,
+                  static_cast<unsigned long>(res.p50),
+                  static_cast<unsigned long>(res.p95),
+                  static_cast<unsigned long>(res.p99),
+                  seconds > 0.0f ? res.triangles / seconds : 0.0f,
+                  seconds > 0.0f ? res.pixels / seconds : 0.0f,
+                  static_cast<unsigned long>(res.instances),
+                  static_cast<unsigned long>(res.frustumCulled),
+                  static_cast<unsigned long>(res.occlusionCulled));
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    delay(500);
+
+    Renderer &r = begin3D(static_cast<uint16_t>(BENCH_WIDTH), static_cast<uint16_t>(BENCH_HEIGHT),
+                          BENCH_PIN_CS, BENCH_PIN_DC, BENCH_PIN_RST);
+    r.setShadowsEnabled(false);
+
+    Serial.printf("PIP3D %s benchmark: %dx%d, %d bands, %d frames per scene, %d instances\n",
+                  getVersion(), BENCH_WIDTH, BENCH_HEIGHT, SCREEN_BAND_COUNT,
+                  BENCH_MEASURE_FRAMES, BENCH_INSTANCES);
+
+    const int sceneCount = sizeof(scenes) / sizeof(scenes[0]);
+    BenchResult results[sceneCount];
+    for (int i = 0; i < sceneCount; ++i)
+    {
+        results[i] = runScene(r, scenes[i]);
+        report(scenes[i], results[i]);
+    }
+
+    Serial.println("BENCH,version,scene,resolution,bands,p50_us,p95_us,p99_us,tris_per_s,pixels_per_s,instances,frustum_culled,occlusion_culled");
+    for (int i = 0; i < sceneCount; ++i)
+        reportCsv(scenes[i], results[i]);
+}
+
+void loop()
+{
+    delay(1000);
+}
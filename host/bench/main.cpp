@@ -0,0 +1,147 @@
+// Host runner for examples/Benchmark: same scenes, seeds and frame counts,
+// rendered into HeadlessDriver instead of a panel.
+//
+//   pip3d_bench [--png DIR] [--capture DIR] [--replay]
+//
+// Prints the benchmark report, then a CRC of each scene's last frame so
+// renders can be compared between revisions; with --png the frame is also
+// written to DIR/<scene>.png. MEM lines give the MemUtils totals per module
+// once every scene has been torn down.
+//
+// --capture records each scene's last frame with RenderCapture into
+// DIR/<scene>.p3rc. --replay plays it back BENCH_MEASURE_FRAMES times and
+// prints a REPLAY line: stream size, CRC of the last replayed frame and
+// the p50 frame time, which can be compared between revisions. The CRC
+// equals the scene's FRAME CRC unless the scene draws around the
+// renderer's draw calls (ropes, particles), which is not captured. The replay leaves the renderer's caches in another state, so
+// FRAME lines of later scenes only compare with runs using --replay too.
+
+#include <Arduino.h>
+#include <Pip3D/Pip3D.h>
+#include <stdio.h>
+#include <string>
+
+struct BenchScene;
+static void benchFrame(pip3D::Renderer &r, const BenchScene &scene, int frame);
+static void benchSceneEnd(pip3D::Renderer &r, const BenchScene &scene);
+
+#define BENCH_ON_FRAME(r, scene, frame) benchFrame(r, scene, frame)
+#define BENCH_ON_SCENE_END(r, scene) benchSceneEnd(r, scene)
+#include "../../examples/Benchmark/Benchmark.ino"
+
+static const char *s_pngDir = nullptr;
+static const char *s_captureDir = nullptr;
+static bool s_replay = false;
+static RenderCapture s_capture;
+
+static void benchFrame(pip3D::Renderer &r, const BenchScene &, int frame)
+{
+    if ((s_captureDir || s_replay) && frame == BENCH_WARMUP_FRAMES + BENCH_MEASURE_FRAMES - 1)
+    {
+        r.setCapture(&s_capture);
+        s_capture.start(1, BENCH_WIDTH, BENCH_HEIGHT);
+    }
+}
+
+static void replayScene(pip3D::Renderer &r, const BenchScene &scene)
+{
+    s_capture.stop();
+    r.setCapture(nullptr);
+
+    if (s_captureDir)
+    {
+        const std::string path = std::string(s_captureDir) + "/" + scene.name + ".p3rc";
+        FILE *f = fopen(path.c_str(), "wb");
+        if (!f || fwrite(s_capture.data(), 1, s_capture.size(), f) != s_capture.size())
+            Serial.printf("failed to write %s\n", path.c_str());
+        if (f)
+            fclose(f);
+    }
+
+    if (s_replay)
+    {
+        RenderReplay replay;
+        if (replay.load(s_capture.data(), s_capture.size()) && replay.frameCount() > 0)
+        {
+            for (uint16_t id = 0; id < replay.meshCount(); ++id)
+                replay.bindMesh(id, s_capture.meshFor(id));
+
+            static uint32_t times[BENCH_MEASURE_FRAMES];
+            for (int i = 0; i < BENCH_MEASURE_FRAMES; ++i)
+            {
+                const uint32_t start = micros();
+                replay.play(r, 0);
+                times[i] = micros() - start;
+            }
+            std::sort(times, times + BENCH_MEASURE_FRAMES);
+
+            const HeadlessDriver *display = static_cast<const HeadlessDriver *>(r.getDisplay());
+            const uint32_t crc = display->checksum();
+            Serial.printf("REPLAY,%s,%u,%08x,%.2f\n", scene.name,
+                          static_cast<unsigned int>(s_capture.size()), static_cast<unsigned int>(crc),
+                          percentile(times, BENCH_MEASURE_FRAMES, 50) / 1000.0f);
+        }
+    }
+    s_capture.release();
+}
+
+static void benchSceneEnd(pip3D::Renderer &r, const BenchScene &scene)
+{
+    const HeadlessDriver *display = static_cast<const HeadlessDriver *>(r.getDisplay());
+    if (!display)
+        return;
+
+    Serial.printf("FRAME,%s,%08x\n", scene.name, static_cast<unsigned int>(display->checksum()));
+    if (s_pngDir)
+    {
+        const std::string path = std::string(s_pngDir) + "/" + scene.name + ".png";
+        if (!display->writePng(path.c_str()))
+            Serial.printf("failed to write %s\n", path.c_str());
+    }
+    if (r.getCapture())
+        replayScene(r, scene);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--png" && i + 1 < argc)
+        {
+            s_pngDir = argv[++i];
+        }
+        else if (arg == "--capture" && i + 1 < argc)
+        {
+            s_captureDir = argv[++i];
+        }
+        else if (arg == "--replay")
+        {
+            s_replay = true;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--png DIR] [--capture DIR] [--replay]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    setup();
+
+    static const char *const MODULES[] = {"core", "render", "physics", "camera",
+                                          "scene", "resources", "perf", "user"};
+    for (unsigned int i = 0; i < sizeof(MODULES) / sizeof(MODULES[0]); ++i)
+    {
+        const pip3D::MemModuleStats s = pip3D::MemUtils::moduleStats(static_cast<uint16_t>(1u << i));
+        if (s.allocCount == 0)
+            continue;
+        Serial.printf("MEM,%s,live=%u,peak=%u,allocs=%u,failed=%u\n", MODULES[i],
+                      static_cast<unsigned int>(s.liveBytes), static_cast<unsigned int>(s.highWater),
+                      static_cast<unsigned int>(s.allocCount), static_cast<unsigned int>(s.failCount));
+    }
+    Serial.flush();
+
+    // Joins the job worker before static destructors run.
+    useDualCore(false);
+    return 0;
+}
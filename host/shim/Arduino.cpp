@@ -0,0 +1,77 @@
+#include "Arduino.h"
+#include <stdarg.h>
+#include <chrono>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const Clock::time_point s_start = Clock::now();
+
+    std::minstd_rand s_random;
+}
+
+int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - s_start).count();
+}
+
+// 32 bits wide like the ESP32 core, so wrap-around behaves the same.
+unsigned long micros()
+{
+    return static_cast<uint32_t>(esp_timer_get_time());
+}
+
+unsigned long millis()
+{
+    return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+void delay(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+void randomSeed(unsigned long seed)
+{
+    if (seed != 0)
+        s_random.seed(static_cast<std::minstd_rand::result_type>(seed));
+}
+
+long random(long howbig)
+{
+    if (howbig <= 0)
+        return 0;
+    return static_cast<long>(s_random() % static_cast<unsigned long>(howbig));
+}
+
+long random(long howsmall, long howbig)
+{
+    if (howsmall >= howbig)
+        return howsmall;
+    return random(howbig - howsmall) + howsmall;
+}
+
+size_t HardwareSerial::printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const int n = vprintf(format, args);
+    va_end(args);
+    return n < 0 ? 0 : static_cast<size_t>(n);
+}
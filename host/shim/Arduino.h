@@ -0,0 +1,131 @@
+#ifndef PIP3D_HOST_ARDUINO_H
+#define PIP3D_HOST_ARDUINO_H
+
+// The slice of the Arduino-ESP32 core the engine uses, implemented on the
+// host: monotonic micros()/millis(), Serial on stdout, heap queries that
+// report nothing and GPIO that reads idle.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+#include "esp_attr.h"
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+using std::max;
+using std::min;
+
+unsigned long micros();
+unsigned long millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void randomSeed(unsigned long seed);
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline uint16_t analogRead(uint8_t) { return 2048; }
+inline void attachInterruptArg(uint8_t, void (*)(void *), void *, int) {}
+inline void detachInterrupt(uint8_t) {}
+
+class String : public std::string
+{
+public:
+    String() {}
+    String(const char *s) : std::string(s ? s : "") {}
+    String(const std::string &s) : std::string(s) {}
+    explicit String(int v) : std::string(std::to_string(v)) {}
+
+    bool isEmpty() const { return empty(); }
+    unsigned int length() const { return static_cast<unsigned int>(size()); }
+};
+
+class HardwareSerial
+{
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    void flush() { fflush(stdout); }
+    int available() { return 0; }
+    int read() { return -1; }
+    operator bool() const { return true; }
+
+    size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+    size_t write(const uint8_t *data, size_t size) { return fwrite(data, 1, size, stdout); }
+    size_t write(const char *s) { return fputs(s, stdout) < 0 ? 0 : strlen(s); }
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(const String &s) { return write(s.c_str()); }
+    size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+
+    size_t println() { return write("\n"); }
+    template <typename T>
+    size_t println(const T &v)
+    {
+        const size_t n = print(v);
+        return n + println();
+    }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+// Heap queries have no meaning on the host; they report zero.
+class EspClass
+{
+public:
+    uint32_t getFreeHeap() { return 0; }
+    uint32_t getFreePsram() { return 0; }
+    uint32_t getMaxAllocHeap() { return 0; }
+    uint32_t getHeapSize() { return 0; }
+    uint32_t getPsramSize() { return 0; }
+};
+
+extern EspClass ESP;
+
+inline bool psramFound() { return false; }
+inline void *ps_malloc(size_t size) { return malloc(size); }
+
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef PIP3D_HOST_SPI_H
+#define PIP3D_HOST_SPI_H
+
+// Panels are replaced by HeadlessDriver on the host; nothing talks SPI.
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef PIP3D_HOST_DRIVER_GPIO_H
+#define PIP3D_HOST_DRIVER_GPIO_H
+
+#include <stdint.h>
+#include "../esp_err.h"
+
+typedef int gpio_num_t;
+
+// Inputs read idle (pulled up) on the host.
+inline int gpio_get_level(gpio_num_t) { return 1; }
+inline esp_err_t gpio_set_level(gpio_num_t, uint32_t) { return ESP_OK; }
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef PIP3D_HOST_ESP_ATTR_H
+#define PIP3D_HOST_ESP_ATTR_H
+
+// Placement attributes only matter to the ESP32 linker script.
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define EXT_RAM_ATTR
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef PIP3D_HOST_ESP_ERR_H
+#define PIP3D_HOST_ESP_ERR_H
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NOT_SUPPORTED 0x106
+
+#endif
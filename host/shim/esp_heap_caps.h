@@ -0,0 +1,44 @@
+#ifndef PIP3D_HOST_ESP_HEAP_CAPS_H
+#define PIP3D_HOST_ESP_HEAP_CAPS_H
+
+// One heap on the host: capabilities are accepted and ignored.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_EXEC (1 << 0)
+#define MALLOC_CAP_32BIT (1 << 1)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+inline void *heap_caps_malloc(size_t size, uint32_t)
+{
+    return malloc(size);
+}
+
+inline void *heap_caps_calloc(size_t n, size_t size, uint32_t)
+{
+    return calloc(n, size);
+}
+
+inline void *heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t)
+{
+    if (alignment < sizeof(void *))
+        alignment = sizeof(void *);
+    void *ptr = nullptr;
+    return posix_memalign(&ptr, alignment, size) == 0 ? ptr : nullptr;
+}
+
+inline void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+inline size_t heap_caps_get_free_size(uint32_t) { return 0; }
+inline size_t heap_caps_get_largest_free_block(uint32_t) { return 0; }
+
+#endif
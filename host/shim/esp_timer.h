@@ -0,0 +1,9 @@
+#ifndef PIP3D_HOST_ESP_TIMER_H
+#define PIP3D_HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+// Microseconds since the process started, like micros() but 64-bit.
+int64_t esp_timer_get_time();
+
+#endif
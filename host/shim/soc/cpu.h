@@ -0,0 +1,6 @@
+#ifndef PIP3D_HOST_SOC_CPU_H
+#define PIP3D_HOST_SOC_CPU_H
+
+// Included by Mesh.h on the device; nothing from it is used.
+
+#endif
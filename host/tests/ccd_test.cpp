@@ -0,0 +1,52 @@
+// ContinuousCollision::timeOfImpact against a unit box at the origin.
+// Exits non-zero when a case fails.
+
+#include <Arduino.h>
+#include <Pip3D/Pip3D.h>
+#include <math.h>
+#include <stdio.h>
+
+using namespace pip3D;
+
+static int s_failures = 0;
+
+static void expectSweep(const char *name, const RigidBody &box, const Vector3 &start, const Vector3 &delta,
+                        float radius, bool hit, float toi = 0.0f)
+{
+    float t = -1.0f;
+    const bool got = ContinuousCollision::timeOfImpact(start, delta, radius, box, t);
+    const bool ok = got == hit && (!hit || fabsf(t - toi) <= 0.01f);
+    printf("%s %s: hit=%d toi=%.3f\n", ok ? "PASS" : "FAIL", name, got ? 1 : 0, got ? t : 0.0f);
+    if (!ok)
+        ++s_failures;
+}
+
+int main()
+{
+    RigidBody box(Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f), 0.0f);
+    box.setStatic(true);
+
+    // Head on into the -X face at x = -0.6 for the centre.
+    expectSweep("hit", box, Vector3(-3.0f, 0.0f, 0.0f), Vector3(6.0f, 0.0f, 0.0f), 0.1f, true, 2.4f / 6.0f);
+
+    // Ten degrees onto the top face; takes more steps than the advancement
+    // budget without clipping.
+    const float a = 10.0f * 3.14159265f / 180.0f;
+    const Vector3 dir(cosf(a), -sinf(a), 0.0f);
+    const Vector3 target(0.0f, 0.6f, 0.0f);
+    expectSweep("shallow hit", box, target - dir * 3.0f, dir * 6.0f, 0.1f, true, 0.5f);
+
+    // Passing over the top face with 5 cm and 8 mm to spare.
+    expectSweep("near miss", box, Vector3(-3.0f, 0.65f, 0.0f), Vector3(6.0f, 0.0f, 0.0f), 0.1f, false);
+    expectSweep("grazing miss", box, Vector3(-3.0f, 0.608f, 0.0f), Vector3(6.0f, 0.0f, 0.0f), 0.1f, false);
+
+    // Into the rounded top edge of the -X face, 7 cm above the face.
+    expectSweep("edge hit", box, Vector3(-3.0f, 0.57f, 0.0f), Vector3(6.0f, 0.0f, 0.0f), 0.1f, true,
+                (3.0f - 0.5f - sqrtf(0.01f - 0.0049f)) / 6.0f);
+
+    // Diagonally past the top corner 1 cm out: inside the grown box,
+    // outside the rounded one.
+    expectSweep("corner miss", box, Vector3(-3.0f, 0.57f, 4.12f), Vector3(6.0f, 0.0f, -6.0f), 0.1f, false);
+
+    return s_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,592 @@
+#!/usr/bin/env python3
+"""Bake OBJ / glTF meshes into the PIP3D flash mesh pack.
+
+The output matches Pip3D/Geometry/BakedMesh.h: a pack of named meshes, each
+with 16-bit quantized vertices, packed normals, bounds and optional LOD
+levels and face normals. Write it to a data partition and map it at boot:
+
+    python3 tools/pip3d_bake.py -o meshes.bin ship.obj rock=models/rock.glb \\
+        --lod 400:48 --lod 120:16 --face-normals
+    parttool.py write_partition --partition-name meshes --input meshes.bin
+
+    BakedMeshPack pack;
+    BakedMesh ship;
+    pack.map("meshes");
+    pack.load("ship", ship);
+
+The partition table needs an entry such as
+    meshes, data, 0x99, , 0x40000
+
+With --header the pack is also written as a const array, which the linker
+keeps in flash as well (BakedMeshPack::attach).
+
+Only the standard library is used.
+"""
+
+import argparse
+import base64
+import json
+import math
+import os
+import struct
+import sys
+
+PACK_MAGIC = 0x4B443350  # "P3DK"
+MESH_MAGIC = 0x4D443350  # "P3DM"
+VERSION = 1
+NAME_LENGTH = 24
+FLAG_FACE_NORMALS = 1
+
+PACK_HEADER = struct.Struct("<IHH")
+PACK_ENTRY = struct.Struct("<%dsII" % NAME_LENGTH)
+MESH_HEADER = struct.Struct("<IHHf3ffHBB")
+MESH_LEVEL = struct.Struct("<HHIIIf")
+VERTEX = struct.Struct("<hhhH")
+FACE = struct.Struct("<HHH")
+
+MAX_INDEX = 0xFFFF
+
+
+class BakeError(Exception):
+    pass
+
+
+# ---------------------------------------------------------------------------
+# Input formats
+
+
+def load_obj(path):
+    positions = []
+    triangles = []
+    with open(path, "r", encoding="utf-8", errors="replace") as f:
+        for lineno, line in enumerate(f, 1):
+            parts = line.split()
+            if not parts:
+                continue
+            if parts[0] == "v":
+                positions.append(tuple(float(c) for c in parts[1:4]))
+            elif parts[0] == "f":
+                idx = []
+                for token in parts[1:]:
+                    i = int(token.split("/")[0])
+                    i = i - 1 if i > 0 else len(positions) + i
+                    if i < 0 or i >= len(positions):
+                        raise BakeError("%s:%d: face index out of range" % (path, lineno))
+                    idx.append(i)
+                for k in range(1, len(idx) - 1):
+                    triangles.append((idx[0], idx[k], idx[k + 1]))
+    return positions, triangles
+
+
+COMPONENT_FORMATS = {5120: "b", 5121: "B", 5122: "h", 5123: "H", 5125: "I", 5126: "f"}
+TYPE_SIZES = {"SCALAR": 1, "VEC2": 2, "VEC3": 3, "VEC4": 4}
+
+
+def mat_mul(a, b):
+    # Column-major 4x4, as glTF stores them.
+    out = [0.0] * 16
+    for c in range(4):
+        for r in range(4):
+            out[c * 4 + r] = sum(a[k * 4 + r] * b[c * 4 + k] for k in range(4))
+    return out
+
+
+def node_matrix(node):
+    if "matrix" in node:
+        return [float(v) for v in node["matrix"]]
+    tx, ty, tz = node.get("translation", [0.0, 0.0, 0.0])
+    qx, qy, qz, qw = node.get("rotation", [0.0, 0.0, 0.0, 1.0])
+    sx, sy, sz = node.get("scale", [1.0, 1.0, 1.0])
+    r = [
+        1 - 2 * (qy * qy + qz * qz), 2 * (qx * qy + qz * qw), 2 * (qx * qz - qy * qw), 0.0,
+        2 * (qx * qy - qz * qw), 1 - 2 * (qx * qx + qz * qz), 2 * (qy * qz + qx * qw), 0.0,
+        2 * (qx * qz + qy * qw), 2 * (qy * qz - qx * qw), 1 - 2 * (qx * qx + qy * qy), 0.0,
+        tx, ty, tz, 1.0,
+    ]
+    for i in range(3):
+        r[i] *= sx
+        r[4 + i] *= sy
+        r[8 + i] *= sz
+    return r
+
+
+def load_gltf(path):
+    with open(path, "rb") as f:
+        raw = f.read()
+
+    glb_bin = None
+    if raw[:4] == b"glTF":
+        _, _, length = struct.unpack_from("<III", raw, 0)
+        offset = 12
+        doc = None
+        while offset < length:
+            chunk_len, chunk_type = struct.unpack_from("<II", raw, offset)
+            chunk = raw[offset + 8: offset + 8 + chunk_len]
+            if chunk_type == 0x4E4F534A:
+                doc = json.loads(chunk.decode("utf-8"))
+            elif chunk_type == 0x004E4942:
+                glb_bin = chunk
+            offset += 8 + chunk_len
+        if doc is None:
+            raise BakeError("%s: GLB without JSON chunk" % path)
+    else:
+        doc = json.loads(raw.decode("utf-8"))
+
+    base_dir = os.path.dirname(os.path.abspath(path))
+    buffers = []
+    for buf in doc.get("buffers", []):
+        uri = buf.get("uri")
+        if uri is None:
+            if glb_bin is None:
+                raise BakeError("%s: buffer without data" % path)
+            buffers.append(glb_bin)
+        elif uri.startswith("data:"):
+            buffers.append(base64.b64decode(uri.split(",", 1)[1]))
+        else:
+            with open(os.path.join(base_dir, uri), "rb") as bf:
+                buffers.append(bf.read())
+
+    def read_accessor(index):
+        acc = doc["accessors"][index]
+        if acc.get("sparse"):
+            raise BakeError("%s: sparse accessors are not supported" % path)
+        fmt = COMPONENT_FORMATS[acc["componentType"]]
+        width = TYPE_SIZES[acc["type"]]
+        view = doc["bufferViews"][acc["bufferView"]]
+        data = buffers[view["buffer"]]
+        start = view.get("byteOffset", 0) + acc.get("byteOffset", 0)
+        elem = struct.Struct("<" + fmt * width)
+        stride = view.get("byteStride", elem.size)
+        values = [elem.unpack_from(data, start + i * stride) for i in range(acc["count"])]
+        if acc.get("normalized"):
+            scale = float((1 << (8 * struct.calcsize(fmt) - (0 if fmt.isupper() else 1))) - 1)
+            values = [tuple(max(v / scale, -1.0) for v in value) for value in values]
+        return values
+
+    positions = []
+    triangles = []
+
+    def add_mesh(mesh_index, matrix):
+        for prim in doc["meshes"][mesh_index]["primitives"]:
+            mode = prim.get("mode", 4)
+            if mode != 4:
+                print("warning: %s: skipping primitive with mode %d" % (path, mode), file=sys.stderr)
+                continue
+            pos = read_accessor(prim["attributes"]["POSITION"])
+            base = len(positions)
+            m = matrix
+            for x, y, z in pos:
+                positions.append((
+                    m[0] * x + m[4] * y + m[8] * z + m[12],
+                    m[1] * x + m[5] * y + m[9] * z + m[13],
+                    m[2] * x + m[6] * y + m[10] * z + m[14],
+                ))
+            if "indices" in prim:
+                idx = [v[0] for v in read_accessor(prim["indices"])]
+            else:
+                idx = list(range(len(pos)))
+            for k in range(0, len(idx) - 2, 3):
+                triangles.append((base + idx[k], base + idx[k + 1], base + idx[k + 2]))
+
+    identity = [1.0, 0, 0, 0, 0, 1.0, 0, 0, 0, 0, 1.0, 0, 0, 0, 0, 1.0]
+
+    def visit(node_index, parent):
+        node = doc["nodes"][node_index]
+        matrix = mat_mul(parent, node_matrix(node))
+        if "mesh" in node:
+            add_mesh(node["mesh"], matrix)
+        for child in node.get("children", []):
+            visit(child, matrix)
+
+    scenes = doc.get("scenes")
+    if scenes:
+        for root in scenes[doc.get("scene", 0)].get("nodes", []):
+            visit(root, identity)
+    else:
+        for i in range(len(doc.get("meshes", []))):
+            add_mesh(i, identity)
+    return positions, triangles
+
+
+def load_model(path):
+    ext = os.path.splitext(path)[1].lower()
+    if ext == ".obj":
+        return load_obj(path)
+    if ext in (".gltf", ".glb"):
+        return load_gltf(path)
+    raise BakeError("%s: unsupported format (expected .obj, .gltf or .glb)" % path)
+
+
+# ---------------------------------------------------------------------------
+# Engine-side encodings, kept in step with Mesh.h / MeshLOD.h
+
+
+def pack_normal(n):
+    # PackedNormal::set
+    l1 = abs(n[0]) + abs(n[1]) + abs(n[2])
+    if l1 <= 1e-6:
+        return 0
+    nx = n[0] / l1
+    ny = n[1] / l1
+    if n[2] < 0.0:
+        tx = nx
+        nx = (1.0 - abs(ny)) * (1.0 if nx >= 0.0 else -1.0)
+        ny = (1.0 - abs(tx)) * (1.0 if ny >= 0.0 else -1.0)
+    px = int((nx * 0.5 + 0.5) * 255.0)
+    py = int((ny * 0.5 + 0.5) * 255.0)
+    return ((px & 0xFF) << 8) | (py & 0xFF)
+
+
+def quantize(x, q_scale):
+    # Mesh::quantizeCoord
+    v = max(min(x / q_scale, 32767.0), -32768.0)
+    return int(v + 0.5) if v >= 0.0 else int(v - 0.5)
+
+
+def sub(a, b):
+    return (a[0] - b[0], a[1] - b[1], a[2] - b[2])
+
+
+def cross(a, b):
+    return (a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0])
+
+
+def normalize(v):
+    length = math.sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2])
+    if length <= 0.0:
+        return (0.0, 0.0, 0.0)
+    return (v[0] / length, v[1] / length, v[2] / length)
+
+
+def simplify(qverts, faces, target):
+    # MeshLOD::simplify: greedy shortest-edge collapse, one independent set
+    # of edges per pass, keeping the endpoint used by more faces.
+    faces = list(faces)
+    count = len(qverts)
+    while len(faces) > target:
+        valence = [0] * count
+        edges = []
+        for f in faces:
+            for k in range(3):
+                a, b = f[k], f[(k + 1) % 3]
+                valence[a] += 1
+                pa, pb = qverts[a], qverts[b]
+                d = ((pa[0] - pb[0]) ** 2 + (pa[1] - pb[1]) ** 2 + (pa[2] - pb[2]) ** 2) >> 4
+                edges.append((d, min(a, b), max(a, b)))
+        edges.sort(key=lambda e: e[0])
+
+        remap = list(range(count))
+        locked = [False] * count
+        budget = (len(faces) - target + 1) // 2
+        collapsed = 0
+        for _, a, b in edges:
+            if collapsed >= budget:
+                break
+            if locked[a] or locked[b]:
+                continue
+            keep, drop = (a, b) if valence[a] >= valence[b] else (b, a)
+            remap[drop] = keep
+            locked[a] = locked[b] = True
+            collapsed += 1
+        if collapsed == 0:
+            break
+
+        out = []
+        for f in faces:
+            g = (remap[f[0]], remap[f[1]], remap[f[2]])
+            if g[0] != g[1] and g[1] != g[2] and g[0] != g[2]:
+                out.append(g)
+        faces = out
+    return faces
+
+
+def compact(qverts, faces):
+    new_index = {}
+    order = []
+    out_faces = []
+    for f in faces:
+        g = []
+        for i in f:
+            if i not in new_index:
+                new_index[i] = len(order)
+                order.append(i)
+            g.append(new_index[i])
+        out_faces.append(tuple(g))
+    return [qverts[i] for i in order], out_faces
+
+
+def fifo_misses(faces, cache_size):
+    stamp = {}
+    misses = 0
+    for f in faces:
+        for v in f:
+            if v not in stamp or misses - stamp[v] >= cache_size:
+                misses += 1
+                stamp[v] = misses
+    return misses
+
+
+def optimize_order(qverts, faces, cache_size=24):
+    # Mesh::optimizeOrder: Forsyth's vertex cache optimizer over cache_size
+    # entries, restarting at the highest remaining face; the source order
+    # stays if it misses a FIFO less. compact() then renumbers vertices by
+    # first use.
+    if len(faces) < 2:
+        return list(faces)
+    cache_score = [0.75 if i < 3 else (1.0 - (i - 3) / float(cache_size - 3)) ** 1.5
+                   for i in range(cache_size)]
+    adj = {}
+    for fi, f in enumerate(faces):
+        for v in f:
+            adj.setdefault(v, []).append(fi)
+    cache_pos = {}
+
+    def score(v):
+        left = len(adj[v])
+        if left == 0:
+            return -1.0
+        pos = cache_pos.get(v, -1)
+        return (cache_score[pos] if pos >= 0 else 0.0) + 2.0 / math.sqrt(left)
+
+    vscore = {v: score(v) for v in adj}
+    restart = sorted(range(len(faces)),
+                     key=lambda fi: (-sum(qverts[v][1] for v in faces[fi]), fi))
+    emitted = [False] * len(faces)
+    cursor = 0
+    cache = []
+    out = []
+    best = -1
+    while len(out) < len(faces):
+        if best < 0:
+            while emitted[restart[cursor]]:
+                cursor += 1
+            best = restart[cursor]
+        f = faces[best]
+        out.append(f)
+        emitted[best] = True
+        for v in f:
+            adj[v].remove(best)
+        touched = list(f) + [v for v in cache if v not in f]
+        for i, v in enumerate(touched):
+            cache_pos[v] = i if i < cache_size else -1
+            vscore[v] = score(v)
+        cache = touched[:cache_size]
+        best, best_score = -1, -1.0
+        for v in touched:
+            for fi in adj[v]:
+                s = vscore[faces[fi][0]] + vscore[faces[fi][1]] + vscore[faces[fi][2]]
+                if s > best_score:
+                    best, best_score = fi, s
+    if fifo_misses(out, cache_size) >= fifo_misses(faces, cache_size):
+        return list(faces)
+    return out
+
+
+def vertex_normals(points, faces):
+    # Mesh::finalizeNormals: area-weighted sum of face normals.
+    acc = [[0.0, 0.0, 0.0] for _ in points]
+    for f in faces:
+        n = cross(sub(points[f[1]], points[f[0]]), sub(points[f[2]], points[f[0]]))
+        if n[0] * n[0] + n[1] * n[1] + n[2] * n[2] > 1e-12:
+            for i in f:
+                acc[i][0] += n[0]
+                acc[i][1] += n[1]
+                acc[i][2] += n[2]
+    return [pack_normal(normalize(a)) for a in acc]
+
+
+def face_normals(points, faces):
+    return [pack_normal(normalize(cross(sub(points[f[1]], points[f[0]]), sub(points[f[2]], points[f[0]]))))
+            for f in faces]
+
+
+# ---------------------------------------------------------------------------
+# Baking
+
+
+def align4(buf):
+    while len(buf) % 4:
+        buf.append(0)
+
+
+def bake_mesh(positions, triangles, args):
+    if not triangles:
+        raise BakeError("no triangles")
+
+    pts = [(x * args.scale, y * args.scale, z * args.scale) for x, y, z in positions]
+    if args.center:
+        lo = [min(p[i] for p in pts) for i in range(3)]
+        hi = [max(p[i] for p in pts) for i in range(3)]
+        mid = [(lo[i] + hi[i]) * 0.5 for i in range(3)]
+        pts = [(p[0] - mid[0], p[1] - mid[1], p[2] - mid[2]) for p in pts]
+
+    extent = max(max(abs(c) for c in p) for p in pts)
+    q_scale = extent / 32767.0 if extent > 0.0 else 1.0
+
+    # Weld on the quantized grid, which is also how the engine shares
+    # vertices for smooth normals.
+    qverts = []
+    lookup = {}
+    remap = []
+    for p in pts:
+        q = (quantize(p[0], q_scale), quantize(p[1], q_scale), quantize(p[2], q_scale))
+        if args.no_weld:
+            remap.append(len(qverts))
+            qverts.append(q)
+            continue
+        if q not in lookup:
+            lookup[q] = len(qverts)
+            qverts.append(q)
+        remap.append(lookup[q])
+    faces = []
+    for f in triangles:
+        g = (remap[f[0]], remap[f[1]], remap[f[2]])
+        if g[0] != g[1] and g[1] != g[2] and g[0] != g[2]:
+            faces.append(g)
+    qverts, faces = compact(qverts, faces)
+
+    if len(qverts) > MAX_INDEX or len(faces) > MAX_INDEX:
+        raise BakeError("%d vertices / %d faces exceed the 16-bit index limit" % (len(qverts), len(faces)))
+
+    levels = [(qverts, faces, 0.0)]
+    prev_faces = faces
+    for spec in args.lod:
+        target, pixels = spec
+        if target >= len(prev_faces):
+            print("  LOD %d not below %d faces, skipped" % (target, len(prev_faces)))
+            continue
+        reduced = simplify(qverts, prev_faces, target)
+        if not reduced:
+            print("warning: LOD %d collapsed every face, skipped" % target, file=sys.stderr)
+            continue
+        levels.append((qverts, reduced, 0.0))
+        # switchPixels belongs to the level being left.
+        levels[-2] = (levels[-2][0], levels[-2][1], float(pixels))
+        prev_faces = reduced
+
+    decoded = [(q[0] * q_scale, q[1] * q_scale, q[2] * q_scale) for q in qverts]
+    center = tuple(sum(p[i] for p in decoded) / len(decoded) for i in range(3))
+    radius = math.sqrt(max((p[0] - center[0]) ** 2 + (p[1] - center[1]) ** 2 + (p[2] - center[2]) ** 2
+                           for p in decoded))
+
+    flags = FLAG_FACE_NORMALS if args.face_normals else 0
+    blob = bytearray(MESH_HEADER.size + MESH_LEVEL.size * len(levels))
+    MESH_HEADER.pack_into(blob, 0, MESH_MAGIC, VERSION, flags, q_scale,
+                          center[0], center[1], center[2], radius, args.color, len(levels), 0)
+
+    for li, (lv_q, lv_faces, switch) in enumerate(levels):
+        if not args.no_reorder:
+            lv_faces = optimize_order(lv_q, lv_faces)
+        lv_q, lv_faces = compact(lv_q, lv_faces)
+        lv_points = [(q[0] * q_scale, q[1] * q_scale, q[2] * q_scale) for q in lv_q]
+        normals = vertex_normals(lv_points, lv_faces)
+
+        align4(blob)
+        vertex_offset = len(blob)
+        for q, n in zip(lv_q, normals):
+            blob += VERTEX.pack(q[0], q[1], q[2], n)
+        align4(blob)
+        face_offset = len(blob)
+        for f in lv_faces:
+            blob += FACE.pack(*f)
+        normal_offset = 0
+        if args.face_normals:
+            align4(blob)
+            normal_offset = len(blob)
+            for n in face_normals(lv_points, lv_faces):
+                blob += struct.pack("<H", n)
+
+        MESH_LEVEL.pack_into(blob, MESH_HEADER.size + li * MESH_LEVEL.size,
+                             len(lv_q), len(lv_faces), vertex_offset, face_offset, normal_offset, switch)
+        print("  level %d: %d vertices, %d faces%s" %
+              (li, len(lv_q), len(lv_faces), (", below %.0f px" % switch) if switch else ""))
+    align4(blob)
+    return bytes(blob)
+
+
+def write_pack(named_blobs):
+    table = PACK_HEADER.size + PACK_ENTRY.size * len(named_blobs)
+    out = bytearray(table)
+    PACK_HEADER.pack_into(out, 0, PACK_MAGIC, VERSION, len(named_blobs))
+    for i, (name, blob) in enumerate(named_blobs):
+        align4(out)
+        PACK_ENTRY.pack_into(out, PACK_HEADER.size + i * PACK_ENTRY.size,
+                             name.encode("ascii"), len(out), len(blob))
+        out += blob
+    return bytes(out)
+
+
+def write_header(path, symbol, data):
+    with open(path, "w", newline="\n") as f:
+        f.write("// Generated by tools/pip3d_bake.py, do not edit.\n")
+        f.write("#pragma once\n#include <stdint.h>\n#include <stddef.h>\n\n")
+        f.write("alignas(4) static const uint8_t %s[] = {\n" % symbol)
+        for i in range(0, len(data), 16):
+            f.write("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",\n")
+        f.write("};\nstatic const size_t %s_size = sizeof(%s);\n" % (symbol, symbol))
+
+
+def parse_lod(text):
+    try:
+        faces, pixels = text.split(":")
+        return int(faces), float(pixels)
+    except ValueError:
+        raise argparse.ArgumentTypeError("expected FACES:PIXELS, got '%s'" % text)
+
+
+def parse_color(text):
+    value = int(text.lstrip("#"), 16)
+    r, g, b = (value >> 16) & 0xFF, (value >> 8) & 0xFF, value & 0xFF
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("inputs", nargs="+", metavar="[NAME=]FILE",
+                        help="models to bake; NAME defaults to the file name")
+    parser.add_argument("-o", "--output", required=True, help="pack file to write")
+    parser.add_argument("--header", help="also write the pack as a C array to this header")
+    parser.add_argument("--symbol", default="pip3d_mesh_pack", help="array name for --header")
+    parser.add_argument("--lod", type=parse_lod, action="append", default=[], metavar="FACES:PIXELS",
+                        help="add a level with about FACES faces, used below PIXELS of projected "
+                             "radius; repeat from finest to coarsest")
+    parser.add_argument("--face-normals", action="store_true", help="store one normal per face")
+    parser.add_argument("--scale", type=float, default=1.0, help="uniform scale applied before quantizing")
+    parser.add_argument("--center", action="store_true", help="move the bounding box centre to the origin")
+    parser.add_argument("--no-weld", action="store_true", help="keep coincident vertices separate")
+    parser.add_argument("--no-reorder", action="store_true",
+                        help="keep the source face order instead of optimizing it for vertex reuse")
+    parser.add_argument("--color", type=parse_color, default=0xFFFF, metavar="RRGGBB",
+                        help="mesh colour (default white)")
+    args = parser.parse_args(argv)
+
+    pixels = [p for _, p in args.lod]
+    if any(b >= a for a, b in zip(pixels, pixels[1:])):
+        parser.error("--lod switch radii must decrease from level to level")
+
+    named = []
+    try:
+        for item in args.inputs:
+            name, path = item.split("=", 1) if "=" in item else (os.path.splitext(os.path.basename(item))[0], item)
+            if len(name.encode("ascii")) >= NAME_LENGTH:
+                raise BakeError("mesh name '%s' is longer than %d characters" % (name, NAME_LENGTH - 1))
+            if any(n == name for n, _ in named):
+                raise BakeError("duplicate mesh name '%s'" % name)
+            print("%s <- %s" % (name, path))
+            positions, triangles = load_model(path)
+            named.append((name, bake_mesh(positions, triangles, args)))
+    except (BakeError, OSError, KeyError, ValueError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+
+    pack = write_pack(named)
+    with open(args.output, "wb") as f:
+        f.write(pack)
+    if args.header:
+        write_header(args.header, args.symbol, pack)
+    print("wrote %s (%d bytes, %d meshes)" % (args.output, len(pack), len(named)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())